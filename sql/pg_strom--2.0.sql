@@ -91,6 +91,41 @@ CREATE FUNCTION pgstrom.pgstrom_device_preserved_meminfo()
 CREATE VIEW pgstrom.device_preserved_meminfo
   AS SELECT * FROM pgstrom.pgstrom_device_preserved_meminfo();
 
+CREATE TYPE pgstrom.__pgstrom_gpu_context_info AS (
+  pid           int4,
+  device_nr     int4,
+  num_workers   int4,
+  ctime         timestamp with time zone,
+  pending_tasks int4,
+  running_tasks int4,
+  done_tasks    int8,
+  busy_time     float8,
+  sm_occupancy  float8,
+  device_memory int8
+);
+CREATE FUNCTION pgstrom.pgstrom_gpu_context_info()
+  RETURNS SETOF pgstrom.__pgstrom_gpu_context_info
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.gpu_context_info
+  AS SELECT * FROM pgstrom.pgstrom_gpu_context_info();
+
+CREATE TYPE pgstrom.__pgstrom_gpu_context_meminfo AS (
+  pid           int4,
+  device_nr     int4,
+  kind          text,
+  segments      int4,
+  total_size    int8,
+  free_size     int8,
+  largest_free  int8
+);
+CREATE FUNCTION pgstrom.pgstrom_gpu_context_meminfo()
+  RETURNS SETOF pgstrom.__pgstrom_gpu_context_meminfo
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.gpu_context_meminfo
+  AS SELECT * FROM pgstrom.pgstrom_gpu_context_meminfo();
+
 --
 -- Functions/Languages to support PL/CUDA
 --
@@ -206,7 +241,9 @@ CREATE TYPE pgstrom.__pgstrom_ccache_info AS (
     nitems       bigint,
     length       bigint,
     ctime        timestamp with time zone,
-    atime        timestamp with time zone
+    atime        timestamp with time zone,
+    nrefs        bigint,
+    gpu_device   int
 );
 CREATE FUNCTION pgstrom.pgstrom_ccache_info()
     RETURNS SETOF pgstrom.__pgstrom_ccache_info
@@ -234,6 +271,27 @@ CREATE FUNCTION public.pgstrom_ccache_prewarm(regclass)
   AS 'MODULE_PATHNAME','pgstrom_ccache_prewarm'
   LANGUAGE C STRICT;
 
+CREATE FUNCTION public.pgstrom_ccache_prewarm(regclass, bool)
+  RETURNS int
+  AS 'MODULE_PATHNAME','pgstrom_ccache_prewarm'
+  LANGUAGE C STRICT;
+
+CREATE TYPE pgstrom.__pgstrom_ccache_prewarm_info AS (
+    database_id  oid,
+    table_id     regclass,
+    nchunks      int,
+    nprocessed   int,
+    nloaded      int,
+    start_time   timestamptz,
+    end_time     timestamptz
+);
+CREATE FUNCTION pgstrom.pgstrom_ccache_prewarm_info()
+    RETURNS SETOF pgstrom.__pgstrom_ccache_prewarm_info
+    AS 'MODULE_PATHNAME'
+    LANGUAGE C STRICT;
+CREATE VIEW pgstrom.ccache_prewarm_info AS
+    SELECT * FROM pgstrom.pgstrom_ccache_prewarm_info();
+
 --
 -- Handlers for gstore_fdw extension
 --
@@ -315,6 +373,12 @@ CREATE FUNCTION public.gstore_fdw_rawsize(reggstore)
   AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_rawsize'
   LANGUAGE C STRICT;
 
+CREATE FUNCTION public.gstore_fdw_load(reggstore, text,
+                                       text = 'csv', bool = false)
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_load'
+  LANGUAGE C STRICT VOLATILE;
+
 CREATE FUNCTION public.gstore_export_ipchandle(reggstore)
   RETURNS bytea
   AS 'MODULE_PATHNAME','pgstrom_gstore_export_ipchandle'
@@ -329,7 +393,10 @@ CREATE TYPE pgstrom.__gstore_fdw_chunk_info AS (
   pinning		int,
   format		text,
   rawsize		bigint,
-  nitems		bigint
+  nitems		bigint,
+  shard_id		int,
+  nshards		int,
+  delta_id		int
 );
 CREATE FUNCTION pgstrom.gstore_fdw_chunk_info()
   RETURNS SETOF pgstrom.__gstore_fdw_chunk_info
@@ -348,6 +415,34 @@ CREATE FUNCTION public.lo_export_gpu(oid, int, bytea, bigint, bigint)
   AS 'MODULE_PATHNAME','pgstrom_lo_export_gpu'
   LANGUAGE C STRICT VOLATILE;
 
+--
+-- Handlers for arrow_fdw extension
+--
+CREATE FUNCTION pgstrom.arrow_fdw_handler()
+  RETURNS fdw_handler
+  AS  'MODULE_PATHNAME','pgstrom_arrow_fdw_handler'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION pgstrom.arrow_fdw_validator(text[],oid)
+  RETURNS void
+  AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_validator'
+  LANGUAGE C STRICT;
+
+CREATE FOREIGN DATA WRAPPER arrow_fdw
+  HANDLER   pgstrom.arrow_fdw_handler
+  VALIDATOR pgstrom.arrow_fdw_validator;
+
+CREATE SERVER arrow_fdw
+  FOREIGN DATA WRAPPER arrow_fdw;
+
+--
+-- Functions to support GpuSort
+--
+CREATE FUNCTION public.pgstrom_gpusort_cluster(regclass, regclass)
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_gpusort_cluster'
+  LANGUAGE C STRICT VOLATILE;
+
 --
 -- Type re-interpretation routines
 --
@@ -464,6 +559,89 @@ CREATE AGGREGATE pgstrom.favg_numeric(float8[])
   parallel = safe
 );
 
+-- SUM()/AVG() of numeric with bounded precision, on fixed-point
+CREATE FUNCTION pgstrom.numeric_fixed_hi(numeric,int4)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_numeric_fixed_hi'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.numeric_fixed_lo(numeric,int4)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_numeric_fixed_lo'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.psum_fixed(int8,int8,int4)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME','pgstrom_partial_sum_fixed'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.pavg_fixed(int8,int8,int8,int4)
+  RETURNS numeric[]
+  AS 'MODULE_PATHNAME','pgstrom_partial_avg_fixed'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.favg_accum(numeric[], numeric[])
+  RETURNS numeric[]
+  AS 'MODULE_PATHNAME', 'pgstrom_final_avg_numeric_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.favg_final(numeric[])
+  RETURNS numeric
+  AS 'MODULE_PATHNAME', 'pgstrom_final_avg_fixed_final'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.favg(numeric[])
+(
+  sfunc = pgstrom.favg_accum,
+  stype = numeric[],
+  finalfunc = pgstrom.favg_final,
+  parallel = safe
+);
+
+-- HLL_COUNT(), approximate number of distinct values by HyperLogLog
+CREATE FUNCTION pgstrom.hll_register(int8,int4)
+  RETURNS int2
+  AS 'MODULE_PATHNAME','pgstrom_hll_register'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch(int2[])
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_accum(bytea,int8)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_merge(bytea,bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_merge'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_count_final(bytea)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_count_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.hll_count(int8)
+(
+  sfunc = pgstrom.hll_accum,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.fhll_count(bytea)
+(
+  sfunc = pgstrom.hll_merge,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_merge,
+  parallel = safe
+);
+
 -- PMIN()/PMAX()
 CREATE FUNCTION pgstrom.pmin(int2)
   RETURNS int2
@@ -966,53 +1144,97 @@ CREATE FUNCTION pgstrom.array_matrix_final_float8(internal)
   AS 'MODULE_PATHNAME','array_matrix_final_float8'
   LANGUAGE C CALLED ON NULL INPUT;
 
+-- support functions of parallel aggregation; also used by rbind
+CREATE FUNCTION pgstrom.array_matrix_combine(internal, internal)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_combine'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.array_matrix_serialize(internal)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','array_matrix_serialize'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.array_matrix_deserialize(bytea, internal)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_deserialize'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
 CREATE AGGREGATE pg_catalog.array_matrix(variadic bool[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_bool
+  finalfunc = pgstrom.array_matrix_final_bool,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic int2[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int2
+  finalfunc = pgstrom.array_matrix_final_int2,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic int4[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int4
+  finalfunc = pgstrom.array_matrix_final_int4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic int8[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int8
+  finalfunc = pgstrom.array_matrix_final_int8,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic float4[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_float4
+  finalfunc = pgstrom.array_matrix_final_float4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic float8[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_float8
+  finalfunc = pgstrom.array_matrix_final_float8,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(bit)
 (
   sfunc = pgstrom.array_matrix_accum_varbit,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int4
+  finalfunc = pgstrom.array_matrix_final_int4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE FUNCTION pg_catalog.array_matrix_validation(anyarray)
@@ -1284,42 +1506,66 @@ CREATE AGGREGATE pg_catalog.rbind(bool[])
 (
   sfunc = pgstrom.array_matrix_rbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_rbind_final_bool
+  finalfunc = pgstrom.array_matrix_rbind_final_bool,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.rbind(int2[])
 (
   sfunc = pgstrom.array_matrix_rbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_rbind_final_int2
+  finalfunc = pgstrom.array_matrix_rbind_final_int2,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.rbind(int4[])
 (
   sfunc = pgstrom.array_matrix_rbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_rbind_final_int4
+  finalfunc = pgstrom.array_matrix_rbind_final_int4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.rbind(int8[])
 (
   sfunc = pgstrom.array_matrix_rbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_rbind_final_int8
+  finalfunc = pgstrom.array_matrix_rbind_final_int8,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.rbind(float4[])
 (
   sfunc = pgstrom.array_matrix_rbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_rbind_final_float4
+  finalfunc = pgstrom.array_matrix_rbind_final_float4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.rbind(float8[])
 (
   sfunc = pgstrom.array_matrix_rbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_rbind_final_float8
+  finalfunc = pgstrom.array_matrix_rbind_final_float8,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 
@@ -1358,46 +1604,85 @@ CREATE FUNCTION pgstrom.array_matrix_cbind_final_float8(internal)
   AS 'MODULE_PATHNAME','array_matrix_cbind_final_float8'
   LANGUAGE C CALLED ON NULL INPUT;
 
+CREATE FUNCTION pgstrom.array_matrix_cbind_combine(internal, internal)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_cbind_combine'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.array_matrix_cbind_serialize(internal)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','array_matrix_cbind_serialize'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.array_matrix_cbind_deserialize(bytea, internal)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_cbind_deserialize'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
 CREATE AGGREGATE pg_catalog.cbind(bool[])
 (
   sfunc = pgstrom.array_matrix_cbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_cbind_final_bool
+  finalfunc = pgstrom.array_matrix_cbind_final_bool,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.cbind(int2[])
 (
   sfunc = pgstrom.array_matrix_cbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_cbind_final_int2
+  finalfunc = pgstrom.array_matrix_cbind_final_int2,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.cbind(int4[])
 (
   sfunc = pgstrom.array_matrix_cbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_cbind_final_int4
+  finalfunc = pgstrom.array_matrix_cbind_final_int4,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.cbind(int8[])
 (
   sfunc = pgstrom.array_matrix_cbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_cbind_final_int8
+  finalfunc = pgstrom.array_matrix_cbind_final_int8,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.cbind(float4[])
 (
   sfunc = pgstrom.array_matrix_cbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_cbind_final_float4
+  finalfunc = pgstrom.array_matrix_cbind_final_float4,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.cbind(float8[])
 (
   sfunc = pgstrom.array_matrix_cbind_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_cbind_final_float8
+  finalfunc = pgstrom.array_matrix_cbind_final_float8,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
 );
 
 CREATE FUNCTION pg_catalog.transpose(bool[])
@@ -1430,6 +1715,16 @@ CREATE FUNCTION pg_catalog.transpose(float8[])
   AS 'MODULE_PATHNAME','array_matrix_transpose_float8'
   LANGUAGE C STRICT;
 
+CREATE FUNCTION pg_catalog.matrix_multiply(float4[], float4[])
+  RETURNS float4[]
+  AS 'MODULE_PATHNAME','array_matrix_multiply_float4'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION pg_catalog.matrix_multiply(float8[], float8[])
+  RETURNS float8[]
+  AS 'MODULE_PATHNAME','array_matrix_multiply_float8'
+  LANGUAGE C STRICT;
+
 -- ==================================================================
 --
 -- float2 - half-precision floating point data support
@@ -2354,6 +2649,67 @@ CREATE AGGREGATE pg_catalog.stddev(float2) (
   initcond = "{0,0,0}"
 );
 
+--
+-- Array-matrix support
+--
+CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic float2[])
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_accum'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE FUNCTION pgstrom.array_matrix_final_float2(internal)
+  RETURNS float2[]
+  AS 'MODULE_PATHNAME','array_matrix_final_float2'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE AGGREGATE pg_catalog.array_matrix(variadic float2[])
+(
+  sfunc = pgstrom.array_matrix_accum,
+  stype = internal,
+  finalfunc = pgstrom.array_matrix_final_float2,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
+);
+
+CREATE FUNCTION pgstrom.array_matrix_rbind_final_float2(internal)
+  RETURNS float2[]
+  AS 'MODULE_PATHNAME','array_matrix_rbind_final_float2'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE AGGREGATE pg_catalog.rbind(float2[])
+(
+  sfunc = pgstrom.array_matrix_rbind_accum,
+  stype = internal,
+  finalfunc = pgstrom.array_matrix_rbind_final_float2,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
+);
+
+CREATE FUNCTION pgstrom.array_matrix_cbind_final_float2(internal)
+  RETURNS float2[]
+  AS 'MODULE_PATHNAME','array_matrix_cbind_final_float2'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE AGGREGATE pg_catalog.cbind(float2[])
+(
+  sfunc = pgstrom.array_matrix_cbind_accum,
+  stype = internal,
+  finalfunc = pgstrom.array_matrix_cbind_final_float2,
+  combinefunc = pgstrom.array_matrix_cbind_combine,
+  serialfunc = pgstrom.array_matrix_cbind_serialize,
+  deserialfunc = pgstrom.array_matrix_cbind_deserialize,
+  parallel = safe
+);
+
+CREATE FUNCTION pg_catalog.transpose(float2[])
+  RETURNS float2[]
+  AS 'MODULE_PATHNAME','array_matrix_transpose_float2'
+  LANGUAGE C STRICT;
+
 --
 -- Index Support
 --
@@ -2372,6 +2728,21 @@ CREATE OPERATOR CLASS pg_catalog.float2_ops
   using hash family pg_catalog.float_ops as
   function 1 (float2) pgstrom.float2_hash(float2);
 
+-- ==================================================================
+--
+-- time_bucket(), fixed-width bucketing of timestamp values
+--
+-- ==================================================================
+CREATE FUNCTION pgstrom.time_bucket(interval, timestamp)
+  RETURNS timestamp
+  AS 'MODULE_PATHNAME','pgstrom_time_bucket_timestamp'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.time_bucket(interval, timestamptz)
+  RETURNS timestamptz
+  AS 'MODULE_PATHNAME','pgstrom_time_bucket_timestamptz'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
 -- ==================================================================
 --
 -- SQL functions to support PG-Strom regression test
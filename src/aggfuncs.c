@@ -16,6 +16,7 @@
  * GNU General Public License for more details.
  */
 #include "pg_strom.h"
+#include "cuda_misc.h"
 #include "cuda_numeric.h"
 
 /*
@@ -29,8 +30,18 @@ Datum pgstrom_final_avg_int8_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_final_avg_int8_final(PG_FUNCTION_ARGS);
 Datum pgstrom_final_avg_float8_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_final_avg_float8_final(PG_FUNCTION_ARGS);
-//Datum pgstrom_final_avg_numeric_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_final_avg_numeric_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_final_avg_numeric_final(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_hi(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_lo(PG_FUNCTION_ARGS);
+Datum pgstrom_partial_sum_fixed(PG_FUNCTION_ARGS);
+Datum pgstrom_partial_avg_fixed(PG_FUNCTION_ARGS);
+Datum pgstrom_final_avg_fixed_final(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_register(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_sketch(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_merge(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_count_final(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_min_any(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_max_any(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_sum_any(PG_FUNCTION_ARGS);
@@ -208,7 +219,6 @@ pgstrom_final_avg_float8_final(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_final_avg_float8_final);
 
-#ifdef NOT_USED
 Datum
 pgstrom_final_avg_numeric_accum(PG_FUNCTION_ARGS)
 {
@@ -256,7 +266,6 @@ pgstrom_final_avg_numeric_accum(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(xarray);
 }
 PG_FUNCTION_INFO_V1(pgstrom_final_avg_numeric_accum);
-#endif
 
 Datum
 pgstrom_final_avg_numeric_final(PG_FUNCTION_ARGS)
@@ -272,6 +281,306 @@ pgstrom_final_avg_numeric_final(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_final_avg_numeric_final);
 
+/*
+ * Fixed-point numeric support
+ *
+ * SUM/AVG(numeric) whose argument has bounded precision run on a pair
+ * of int8 partial sums; upper and lower bits of the scaled integer
+ * (X * 10^scale). See NUMERIC_FIXED_SHIFT in cuda_numeric.h.
+ */
+static Datum
+numeric_fixed_unit(int32 exponent)
+{
+	char		temp[40];
+
+	snprintf(temp, sizeof(temp), "1e%d", exponent);
+	return DirectFunctionCall3(numeric_in,
+							   CStringGetDatum(temp),
+							   ObjectIdGetDatum(InvalidOid),
+							   Int32GetDatum(-1));
+}
+
+static int64
+numeric_to_fixed(Datum value, int32 scale)
+{
+	value = DirectFunctionCall2(numeric_mul, value,
+								numeric_fixed_unit(scale));
+	return DatumGetInt64(DirectFunctionCall1(numeric_int8, value));
+}
+
+static Datum
+numeric_from_fixed(int64 fixed_hi, int64 fixed_lo, int32 scale)
+{
+	int64		fixed_unit = (1L << NUMERIC_FIXED_SHIFT);
+	Datum		value;
+
+	value = DirectFunctionCall2(numeric_mul,
+								DirectFunctionCall1(int8_numeric,
+													Int64GetDatum(fixed_hi)),
+								DirectFunctionCall1(int8_numeric,
+													Int64GetDatum(fixed_unit)));
+	value = DirectFunctionCall2(numeric_add, value,
+								DirectFunctionCall1(int8_numeric,
+													Int64GetDatum(fixed_lo)));
+	/* multiplication by 1e-scale keeps dscale of the original typmod */
+	return DirectFunctionCall2(numeric_mul, value,
+							   numeric_fixed_unit(-scale));
+}
+
+/*
+ * pgstrom.numeric_fixed_hi(numeric,int4)
+ */
+Datum
+pgstrom_numeric_fixed_hi(PG_FUNCTION_ARGS)
+{
+	int64		fixed = numeric_to_fixed(PG_GETARG_DATUM(0),
+										 PG_GETARG_INT32(1));
+
+	PG_RETURN_INT64(fixed >> NUMERIC_FIXED_SHIFT);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_hi);
+
+/*
+ * pgstrom.numeric_fixed_lo(numeric,int4)
+ */
+Datum
+pgstrom_numeric_fixed_lo(PG_FUNCTION_ARGS)
+{
+	int64		fixed = numeric_to_fixed(PG_GETARG_DATUM(0),
+										 PG_GETARG_INT32(1));
+
+	PG_RETURN_INT64(fixed & NUMERIC_FIXED_MASK);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_lo);
+
+/*
+ * pgstrom.psum_fixed(int8,int8,int4)
+ */
+Datum
+pgstrom_partial_sum_fixed(PG_FUNCTION_ARGS)
+{
+	return numeric_from_fixed(PG_GETARG_INT64(0),	/* p_sum(hi) */
+							  PG_GETARG_INT64(1),	/* p_sum(lo) */
+							  PG_GETARG_INT32(2));	/* scale */
+}
+PG_FUNCTION_INFO_V1(pgstrom_partial_sum_fixed);
+
+/*
+ * pgstrom.pavg_fixed(int8,int8,int8,int4)
+ */
+Datum
+pgstrom_partial_avg_fixed(PG_FUNCTION_ARGS)
+{
+	ArrayType  *result;
+	Datum		items[2];
+
+	items[0] = DirectFunctionCall1(int8_numeric,
+								   PG_GETARG_DATUM(0));	/* nrows(int8) */
+	items[1] = numeric_from_fixed(PG_GETARG_INT64(1),	/* p_sum(hi) */
+								  PG_GETARG_INT64(2),	/* p_sum(lo) */
+								  PG_GETARG_INT32(3));	/* scale */
+	result = construct_array(items, 2, NUMERICOID,
+							 -1, false, 'i');
+	PG_RETURN_ARRAYTYPE_P(result);
+}
+PG_FUNCTION_INFO_V1(pgstrom_partial_avg_fixed);
+
+/*
+ * pgstrom.favg_final(numeric[])
+ */
+Datum
+pgstrom_final_avg_fixed_final(PG_FUNCTION_ARGS)
+{
+	ArrayType	   *xarray = PG_GETARG_ARRAYTYPE_P(0);
+	Datum			nrows, sum;
+	bool			isnull[2];
+
+	nrows = numeric_array_ref(xarray, 1, &isnull[0]);
+	sum   = numeric_array_ref(xarray, 2, &isnull[1]);
+	if (isnull[0] || isnull[1])
+		elog(ERROR, "unexpected internal state");
+	/* SQL defines AVG of no values to be NULL */
+	if (DatumGetInt64(DirectFunctionCall1(numeric_int8, nrows)) == 0)
+		PG_RETURN_NULL();
+
+	return DirectFunctionCall2(numeric_div, sum, nrows);
+}
+PG_FUNCTION_INFO_V1(pgstrom_final_avg_fixed_final);
+
+/*
+ * HyperLogLog sketch is a bytea that contains HLL_NUM_REGISTERS of uint8
+ * registers. See cuda_misc.h for the hash and register values.
+ */
+#define HLL_SKETCH_LENGTH		(VARHDRSZ + HLL_NUM_REGISTERS)
+
+static bytea *
+hll_sketch_alloc(void)
+{
+	bytea	   *hll = palloc0(HLL_SKETCH_LENGTH);
+
+	SET_VARSIZE(hll, HLL_SKETCH_LENGTH);
+	return hll;
+}
+
+static bytea *
+hll_sketch_getarg(FunctionCallInfo fcinfo, int argno)
+{
+	bytea	   *hll = PG_GETARG_BYTEA_P(argno);
+
+	if (VARSIZE(hll) != HLL_SKETCH_LENGTH)
+		elog(ERROR, "corrupted HyperLogLog sketch");
+	return hll;
+}
+
+/*
+ * hll_sketch_state - transition state of the HLL aggregates; it is
+ * allocated on the aggregate context on the first call.
+ */
+static bytea *
+hll_sketch_state(FunctionCallInfo fcinfo, const char *fname)
+{
+	MemoryContext	aggcxt;
+	MemoryContext	oldcxt;
+	bytea		   *hll;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "%s called in non-aggregate context", fname);
+	if (!PG_ARGISNULL(0))
+		return hll_sketch_getarg(fcinfo, 0);
+
+	oldcxt = MemoryContextSwitchTo(aggcxt);
+	hll = hll_sketch_alloc();
+	MemoryContextSwitchTo(oldcxt);
+
+	return hll;
+}
+
+/*
+ * pgstrom.hll_register(int8,int4)
+ */
+Datum
+pgstrom_hll_register(PG_FUNCTION_ARGS)
+{
+	cl_ulong	hash;
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		PG_RETURN_INT16(0);
+	hash = hll_hash_int8(PG_GETARG_INT64(0));
+	if (hll_register_index(hash) != PG_GETARG_INT32(1))
+		PG_RETURN_INT16(0);
+	PG_RETURN_INT16(hll_register_rho(hash));
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_register);
+
+/*
+ * pgstrom.hll_sketch(int2[])
+ */
+Datum
+pgstrom_hll_sketch(PG_FUNCTION_ARGS)
+{
+	ArrayType  *array = PG_GETARG_ARRAYTYPE_P(0);
+	bytea	   *hll = hll_sketch_alloc();
+	uint8	   *regs = (uint8 *) VARDATA(hll);
+	Datum	   *values;
+	bool	   *isnull;
+	int			i, nitems;
+
+	deconstruct_array(array, INT2OID, sizeof(int16), true, 's',
+					  &values, &isnull, &nitems);
+	if (nitems != HLL_NUM_REGISTERS)
+		elog(ERROR, "unexpected number of HyperLogLog registers: %d",
+			 nitems);
+	for (i=0; i < nitems; i++)
+	{
+		/* NULL means no rows were distributed to the register */
+		if (!isnull[i])
+			regs[i] = (uint8) DatumGetInt16(values[i]);
+	}
+	PG_RETURN_BYTEA_P(hll);
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_sketch);
+
+/*
+ * pgstrom.hll_accum(bytea,int8)
+ */
+Datum
+pgstrom_hll_accum(PG_FUNCTION_ARGS)
+{
+	bytea	   *hll = hll_sketch_state(fcinfo, "hll_accum");
+	uint8	   *regs = (uint8 *) VARDATA(hll);
+	cl_ulong	hash;
+	cl_uint		index;
+	cl_int		rho;
+
+	if (!PG_ARGISNULL(1))
+	{
+		hash = hll_hash_int8(PG_GETARG_INT64(1));
+		index = hll_register_index(hash);
+		rho = hll_register_rho(hash);
+		if (regs[index] < rho)
+			regs[index] = rho;
+	}
+	PG_RETURN_BYTEA_P(hll);
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_accum);
+
+/*
+ * pgstrom.hll_merge(bytea,bytea)
+ */
+Datum
+pgstrom_hll_merge(PG_FUNCTION_ARGS)
+{
+	bytea	   *hll = hll_sketch_state(fcinfo, "hll_merge");
+	bytea	   *arg;
+	uint8	   *regs = (uint8 *) VARDATA(hll);
+	uint8	   *temp;
+	int			i;
+
+	if (!PG_ARGISNULL(1))
+	{
+		arg = hll_sketch_getarg(fcinfo, 1);
+		temp = (uint8 *) VARDATA(arg);
+		for (i=0; i < HLL_NUM_REGISTERS; i++)
+			regs[i] = Max(regs[i], temp[i]);
+	}
+	PG_RETURN_BYTEA_P(hll);
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_merge);
+
+/*
+ * pgstrom.hll_count_final(bytea)
+ */
+Datum
+pgstrom_hll_count_final(PG_FUNCTION_ARGS)
+{
+	bytea	   *hll;
+	uint8	   *regs;
+	double		m = (double) HLL_NUM_REGISTERS;
+	double		sum = 0.0;
+	double		estimate;
+	int			nzeros = 0;
+	int			i;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+	hll = hll_sketch_getarg(fcinfo, 0);
+	regs = (uint8 *) VARDATA(hll);
+	for (i=0; i < HLL_NUM_REGISTERS; i++)
+	{
+		sum += ldexp(1.0, -((int) regs[i]));
+		if (regs[i] == 0)
+			nzeros++;
+	}
+	/* alpha = 0.709 for 64 registers */
+	estimate = 0.709 * m * m / sum;
+	/* linear counting for the small range */
+	if (estimate <= 2.5 * m && nzeros > 0)
+		estimate = m * log(m / (double) nzeros);
+
+	PG_RETURN_INT64((int64) rint(estimate));
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_count_final);
+
 /*
  * pgstrom.pmin(anyelement)
  */
@@ -0,0 +1,1520 @@
+/*
+ * arrow_fdw.c
+ *
+ * Routines to map Apache Arrow files as PG's Foreign-Table.
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "pg_strom.h"
+#include <fcntl.h>
+
+/*
+ * Arrow type identifiers (Type union of Schema.fbs)
+ */
+#define ArrowType__Int				2
+#define ArrowType__FloatingPoint	3
+#define ArrowType__Binary			4
+#define ArrowType__Utf8				5
+#define ArrowType__Bool				6
+#define ArrowType__Date				8
+#define ArrowType__Time				9
+#define ArrowType__Timestamp		10
+
+#define ArrowPrecision__Half		0
+#define ArrowPrecision__Single		1
+#define ArrowPrecision__Double		2
+
+#define ArrowDateUnit__Day			0
+#define ArrowDateUnit__MilliSecond	1
+
+#define ArrowTimeUnit__Second		0
+#define ArrowTimeUnit__MilliSecond	1
+#define ArrowTimeUnit__MicroSecond	2
+#define ArrowTimeUnit__NanoSecond	3
+
+#define ArrowMessageHeader__RecordBatch	3
+
+#define ARROW_FILE_MAGIC			"ARROW1"
+#define ARROW_FILE_MAGIC_LEN		6
+
+/*
+ * Conversion from the Arrow values to PostgreSQL datum
+ */
+#define ARROW_CONV__COPY			1	/* binary compatible */
+#define ARROW_CONV__INT				2	/* integer expansion */
+#define ARROW_CONV__FLOAT			3	/* float4 -> float8 */
+#define ARROW_CONV__BOOL			4	/* bitmap -> bool */
+#define ARROW_CONV__DATE			5	/* unix epoch -> date */
+#define ARROW_CONV__TIME			6	/* any unit -> time */
+#define ARROW_CONV__TIMESTAMP		7	/* unix epoch -> timestamp */
+#define ARROW_CONV__VARLENA			8	/* offsets + data -> varlena */
+
+/*
+ * ArrowField - definition of a field in the schema
+ */
+typedef struct
+{
+	char	   *name;
+	int			type_tag;		/* one of ArrowType__* */
+	int			bitWidth;		/* Int, Time */
+	bool		is_signed;		/* Int */
+	int			precision;		/* FloatingPoint */
+	int			unit;			/* Date, Time, Timestamp */
+	bool		has_tz;			/* Timestamp */
+} ArrowField;
+
+/*
+ * RecordBatchColumn - location of the buffers of a field in a record batch
+ */
+typedef struct
+{
+	int64		null_count;
+	off_t		nullmap_offset;	/* absolute position in the file */
+	size_t		nullmap_length;
+	off_t		values_offset;
+	size_t		values_length;
+	off_t		extra_offset;	/* only Utf8 and Binary */
+	size_t		extra_length;
+} RecordBatchColumn;
+
+/*
+ * RecordBatchInfo - a record batch to be loaded as a KDS_FORMAT_COLUMN
+ */
+typedef struct
+{
+	struct ArrowFileInfo *afile;	/* file which contains this batch */
+	size_t		nitems;			/* number of rows */
+	int			ncols;			/* number of fields */
+	RecordBatchColumn columns[FLEXIBLE_ARRAY_MEMBER];
+} RecordBatchInfo;
+
+/*
+ * ArrowFileInfo - metadata of an Arrow file
+ */
+typedef struct ArrowFileInfo
+{
+	const char *filename;
+	size_t		file_size;
+	int			nfields;
+	ArrowField *fields;
+	int		   *attr_to_field;	/* field index for each attribute, or -1 */
+	List	   *rbatches;		/* list of RecordBatchInfo */
+} ArrowFileInfo;
+
+/*
+ * ArrowFdwState - executor state to scan arrow_fdw foreign table
+ */
+struct ArrowFdwState
+{
+	List	   *files;			/* list of ArrowFileInfo */
+	RecordBatchInfo **rbatches;	/* all the record batches to be scanned */
+	int			num_rbatches;
+	int			rbatch_index;	/* next record batch to be loaded */
+	Bitmapset  *referenced;		/* referenced columns, by (attnum - 1) */
+	MemoryContext memcxt;		/* per-query memory context */
+	/* state of the row-by-row scan */
+	kern_data_store *curr_kds;
+	size_t		curr_index;
+};
+
+/* static functions */
+static void arrowBeginForeignScan(ForeignScanState *node, int eflags);
+
+Datum pgstrom_arrow_fdw_handler(PG_FUNCTION_ARGS);
+Datum pgstrom_arrow_fdw_validator(PG_FUNCTION_ARGS);
+
+/* ----------------------------------------------------------------
+ *
+ * Minimum flatbuffers reader
+ *
+ * Arrow file keeps its metadata (schema, location of the record batches)
+ * using flatbuffers serialization. We need to walk on a few tables only,
+ * so simple routines with boundary checks are here, instead of the code
+ * generated by flatc.
+ *
+ * ----------------------------------------------------------------
+ */
+typedef struct
+{
+	const char *base;		/* head of the flatbuffer */
+	size_t		length;		/* length of the flatbuffer */
+	size_t		table;		/* offset of the table */
+	size_t		vtable;		/* offset of the vtable */
+	int			vlen;		/* length of the vtable */
+	const char *filename;	/* for error messages */
+} FBTable;
+
+#define fbtable_corrupted(t)									\
+	elog(ERROR, "arrow_fdw: metadata of \"%s\" is corrupted",	\
+		 (t)->filename)
+
+static void
+fbtable_init(FBTable *t, const char *base, size_t length, size_t table,
+			 const char *filename)
+{
+	int32		soffset;
+	int64		vtable;
+	uint16		vlen;
+
+	t->base = base;
+	t->length = length;
+	t->filename = filename;
+	if (table + sizeof(int32) > length)
+		fbtable_corrupted(t);
+	memcpy(&soffset, base + table, sizeof(int32));
+	vtable = (int64)table - (int64)soffset;
+	if (vtable < 0 || vtable + 2 * sizeof(uint16) > length)
+		fbtable_corrupted(t);
+	memcpy(&vlen, base + vtable, sizeof(uint16));
+	if (vlen < 2 * sizeof(uint16) || vtable + vlen > length)
+		fbtable_corrupted(t);
+	t->table = table;
+	t->vtable = vtable;
+	t->vlen = vlen;
+}
+
+/*
+ * fbtable_field - returns position of the field, or 0 if not present
+ */
+static size_t
+fbtable_field(FBTable *t, int index, size_t width)
+{
+	uint16		offset;
+
+	if (sizeof(uint16) * (index + 3) > t->vlen)
+		return 0;
+	memcpy(&offset, t->base + t->vtable + sizeof(uint16) * (index + 2),
+		   sizeof(uint16));
+	if (offset == 0)
+		return 0;
+	if (t->table + offset + width > t->length)
+		fbtable_corrupted(t);
+	return t->table + offset;
+}
+
+static int64
+fbtable_get_int(FBTable *t, int index, size_t width, int64 defval)
+{
+	size_t		pos = fbtable_field(t, index, width);
+	int8		ival8;
+	int16		ival16;
+	int32		ival32;
+	int64		ival64;
+
+	if (pos == 0)
+		return defval;
+	switch (width)
+	{
+		case sizeof(int8):
+			memcpy(&ival8, t->base + pos, sizeof(int8));
+			return ival8;
+		case sizeof(int16):
+			memcpy(&ival16, t->base + pos, sizeof(int16));
+			return ival16;
+		case sizeof(int32):
+			memcpy(&ival32, t->base + pos, sizeof(int32));
+			return ival32;
+		case sizeof(int64):
+			memcpy(&ival64, t->base + pos, sizeof(int64));
+			return ival64;
+		default:
+			elog(ERROR, "Bug? unexpected scalar width: %zu", width);
+	}
+	return defval;	/* not reachable */
+}
+
+/*
+ * fbtable_get_offset - returns position of the object referenced by
+ * the field (table, vector or string), or 0 if not present
+ */
+static size_t
+fbtable_get_offset(FBTable *t, int index)
+{
+	size_t		pos = fbtable_field(t, index, sizeof(uint32));
+	uint32		rel;
+
+	if (pos == 0)
+		return 0;
+	memcpy(&rel, t->base + pos, sizeof(uint32));
+	if (pos + rel + sizeof(uint32) > t->length)
+		fbtable_corrupted(t);
+	return pos + rel;
+}
+
+static bool
+fbtable_get_table(FBTable *t, int index, FBTable *sub)
+{
+	size_t		pos = fbtable_get_offset(t, index);
+
+	if (pos == 0)
+		return false;
+	fbtable_init(sub, t->base, t->length, pos, t->filename);
+	return true;
+}
+
+/*
+ * fbtable_get_vector - returns position of the first element of the vector,
+ * or 0 if not present.
+ */
+static size_t
+fbtable_get_vector(FBTable *t, int index, size_t unitsz, size_t *p_nitems)
+{
+	size_t		pos = fbtable_get_offset(t, index);
+	uint32		nitems;
+
+	*p_nitems = 0;
+	if (pos == 0)
+		return 0;
+	memcpy(&nitems, t->base + pos, sizeof(uint32));
+	pos += sizeof(uint32);
+	if (pos + unitsz * (size_t)nitems > t->length)
+		fbtable_corrupted(t);
+	*p_nitems = nitems;
+	return pos;
+}
+
+static void
+fbtable_vector_table(FBTable *t, size_t vpos, size_t index, FBTable *sub)
+{
+	size_t		pos = vpos + sizeof(uint32) * index;
+	uint32		rel;
+
+	memcpy(&rel, t->base + pos, sizeof(uint32));
+	fbtable_init(sub, t->base, t->length, pos + rel, t->filename);
+}
+
+static char *
+fbtable_get_string(FBTable *t, int index)
+{
+	size_t		pos;
+	size_t		len;
+
+	pos = fbtable_get_vector(t, index, sizeof(char), &len);
+	if (pos == 0)
+		return NULL;
+	return pnstrdup(t->base + pos, len);
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Routines to read Arrow file metadata
+ *
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * __preadFile - read the supplied range of the file, or raise an error
+ */
+static void
+__preadFile(int fdesc, const char *filename,
+			char *buffer, size_t length, off_t offset)
+{
+	while (length > 0)
+	{
+		ssize_t		nbytes = pread(fdesc, buffer, length, offset);
+
+		if (nbytes < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			elog(ERROR, "failed on pread('%s'): %m", filename);
+		}
+		if (nbytes == 0)
+			elog(ERROR, "arrow_fdw: unexpected EOF on \"%s\"", filename);
+		buffer += nbytes;
+		length -= nbytes;
+		offset += nbytes;
+	}
+}
+
+/*
+ * arrowReadSchemaField
+ */
+static void
+arrowReadSchemaField(FBTable *t, ArrowField *field)
+{
+	FBTable		type;
+	size_t		nchildren;
+
+	memset(field, 0, sizeof(ArrowField));
+	field->name = fbtable_get_string(t, 0);
+	field->type_tag = fbtable_get_int(t, 2, sizeof(uint8), 0);
+	if (fbtable_get_offset(t, 4) != 0)
+		elog(ERROR, "arrow_fdw: dictionary encoded field \"%s\" in \"%s\" is not supported",
+			 field->name, t->filename);
+	fbtable_get_vector(t, 5, sizeof(uint32), &nchildren);
+	if (nchildren > 0)
+		elog(ERROR, "arrow_fdw: nested field \"%s\" in \"%s\" is not supported",
+			 field->name, t->filename);
+	if (!fbtable_get_table(t, 3, &type))
+		return;
+
+	switch (field->type_tag)
+	{
+		case ArrowType__Int:
+			field->bitWidth = fbtable_get_int(&type, 0, sizeof(int32), 0);
+			field->is_signed = fbtable_get_int(&type, 1, sizeof(uint8), 0);
+			break;
+		case ArrowType__FloatingPoint:
+			field->precision = fbtable_get_int(&type, 0, sizeof(int16),
+											   ArrowPrecision__Half);
+			break;
+		case ArrowType__Date:
+			field->unit = fbtable_get_int(&type, 0, sizeof(int16),
+										  ArrowDateUnit__MilliSecond);
+			break;
+		case ArrowType__Time:
+			field->unit = fbtable_get_int(&type, 0, sizeof(int16),
+										  ArrowTimeUnit__MilliSecond);
+			field->bitWidth = fbtable_get_int(&type, 1, sizeof(int32), 32);
+			break;
+		case ArrowType__Timestamp:
+			field->unit = fbtable_get_int(&type, 0, sizeof(int16),
+										  ArrowTimeUnit__Second);
+			field->has_tz = (fbtable_get_offset(&type, 1) != 0);
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * arrowFieldNumBuffers - number of buffers in a record batch per field
+ */
+static int
+arrowFieldNumBuffers(ArrowField *field)
+{
+	switch (field->type_tag)
+	{
+		case ArrowType__Binary:
+		case ArrowType__Utf8:
+			return 3;	/* validity, offsets and data */
+		case 1:			/* ArrowType__Null */
+			return 0;
+		default:
+			return 2;	/* validity and values */
+	}
+}
+
+/*
+ * arrowReadRecordBatch - reads the metadata of a record batch
+ */
+static RecordBatchInfo *
+arrowReadRecordBatch(int fdesc, ArrowFileInfo *afile,
+					 off_t offset, int32 meta_length, int64 body_length)
+{
+	const char *filename = afile->filename;
+	char	   *buffer;
+	char	   *fbuf;
+	size_t		flen;
+	uint32		prefix;
+	off_t		body_offset;
+	FBTable		message;
+	FBTable		rbatch;
+	size_t		pos_nodes;
+	size_t		pos_buffers;
+	size_t		nnodes;
+	size_t		nbuffers;
+	size_t		bindex = 0;
+	RecordBatchInfo *rb;
+	int			j;
+
+	if (offset < 0 ||
+		meta_length < (int32)(2 * sizeof(uint32)) ||
+		body_length < 0 ||
+		(size_t)(offset + meta_length + body_length) > afile->file_size)
+		elog(ERROR, "arrow_fdw: record batch in \"%s\" is out of range",
+			 filename);
+	buffer = palloc(meta_length);
+	__preadFile(fdesc, filename, buffer, meta_length, offset);
+
+	/* encapsulated message may have a continuation token */
+	memcpy(&prefix, buffer, sizeof(uint32));
+	if (prefix == 0xffffffffU)
+	{
+		memcpy(&prefix, buffer + sizeof(uint32), sizeof(uint32));
+		fbuf = buffer + 2 * sizeof(uint32);
+	}
+	else
+		fbuf = buffer + sizeof(uint32);
+	flen = Min((size_t)prefix, meta_length - (fbuf - buffer));
+	if (flen < sizeof(uint32))
+		elog(ERROR, "arrow_fdw: message in \"%s\" is corrupted", filename);
+	fbtable_init(&message, fbuf, flen, *((uint32 *)fbuf), filename);
+	if (fbtable_get_int(&message, 1, sizeof(uint8), 0)
+		!= ArrowMessageHeader__RecordBatch ||
+		!fbtable_get_table(&message, 2, &rbatch))
+		elog(ERROR, "arrow_fdw: block in \"%s\" is not a record batch",
+			 filename);
+	if (fbtable_get_offset(&rbatch, 3) != 0)
+		elog(ERROR, "arrow_fdw: compressed record batch in \"%s\" is not supported",
+			 filename);
+	pos_nodes = fbtable_get_vector(&rbatch, 1, 2 * sizeof(int64), &nnodes);
+	pos_buffers = fbtable_get_vector(&rbatch, 2, 2 * sizeof(int64), &nbuffers);
+	if (nnodes != afile->nfields)
+		elog(ERROR, "arrow_fdw: record batch in \"%s\" has %zu nodes, but schema has %d fields",
+			 filename, nnodes, afile->nfields);
+
+	body_offset = offset + meta_length;
+	rb = palloc0(offsetof(RecordBatchInfo, columns[afile->nfields]));
+	rb->afile = afile;
+	rb->nitems = fbtable_get_int(&rbatch, 0, sizeof(int64), 0);
+	if (rb->nitems > UINT_MAX)
+		elog(ERROR, "arrow_fdw: record batch in \"%s\" has too many rows",
+			 filename);
+	rb->ncols = afile->nfields;
+	for (j=0; j < afile->nfields; j++)
+	{
+		RecordBatchColumn *rc = &rb->columns[j];
+		int64		node[2];	/* FieldNode { length, null_count } */
+		int64		bufs[3][2];	/* Buffer { offset, length } */
+		int			i, n = arrowFieldNumBuffers(&afile->fields[j]);
+
+		memcpy(node, fbuf + pos_nodes + sizeof(node) * j, sizeof(node));
+		if (node[0] != rb->nitems)
+			elog(ERROR, "arrow_fdw: field \"%s\" in \"%s\" has inconsistent length",
+				 afile->fields[j].name, filename);
+		if (bindex + n > nbuffers)
+			elog(ERROR, "arrow_fdw: record batch in \"%s\" has too short buffers",
+				 filename);
+		for (i=0; i < n; i++)
+		{
+			memcpy(bufs[i], fbuf + pos_buffers + sizeof(bufs[i]) * bindex++,
+				   sizeof(bufs[i]));
+			if (bufs[i][0] < 0 || bufs[i][1] < 0 ||
+				bufs[i][0] + bufs[i][1] > body_length)
+				elog(ERROR, "arrow_fdw: buffer of field \"%s\" in \"%s\" is out of range",
+					 afile->fields[j].name, filename);
+		}
+		rc->null_count = node[1];
+		if (n > 0)
+		{
+			rc->nullmap_offset = body_offset + bufs[0][0];
+			rc->nullmap_length = bufs[0][1];
+			rc->values_offset  = body_offset + bufs[1][0];
+			rc->values_length  = bufs[1][1];
+		}
+		if (n > 2)
+		{
+			rc->extra_offset   = body_offset + bufs[2][0];
+			rc->extra_length   = bufs[2][1];
+		}
+	}
+	pfree(buffer);
+
+	return rb;
+}
+
+/*
+ * arrowReadFileInfo - reads the footer of the Arrow file
+ */
+static ArrowFileInfo *
+arrowReadFileInfo(const char *filename)
+{
+	ArrowFileInfo *afile = palloc0(sizeof(ArrowFileInfo));
+	struct stat	stat_buf;
+	int			fdesc;
+	char		tail[sizeof(int32) + ARROW_FILE_MAGIC_LEN];
+	char		magic[ARROW_FILE_MAGIC_LEN];
+	char	   *fbuf = NULL;
+	int32		flen;
+	FBTable		footer;
+	FBTable		schema;
+	FBTable		sub;
+	size_t		pos, nitems;
+	size_t		i;
+
+	afile->filename = pstrdup(filename);
+	fdesc = open(filename, O_RDONLY);
+	if (fdesc < 0)
+		elog(ERROR, "failed on open('%s'): %m", filename);
+	PG_TRY();
+	{
+		if (fstat(fdesc, &stat_buf) != 0)
+			elog(ERROR, "failed on fstat('%s'): %m", filename);
+		afile->file_size = stat_buf.st_size;
+		if (afile->file_size < 2 * ARROW_FILE_MAGIC_LEN + 2 + sizeof(tail))
+			elog(ERROR, "arrow_fdw: \"%s\" is not an Arrow file", filename);
+		/* "ARROW1" + padding ... footer + int32 length + "ARROW1" */
+		__preadFile(fdesc, filename, magic, sizeof(magic), 0);
+		__preadFile(fdesc, filename, tail, sizeof(tail),
+					afile->file_size - sizeof(tail));
+		if (memcmp(magic, ARROW_FILE_MAGIC, ARROW_FILE_MAGIC_LEN) != 0 ||
+			memcmp(tail + sizeof(int32), ARROW_FILE_MAGIC,
+				   ARROW_FILE_MAGIC_LEN) != 0)
+			elog(ERROR, "arrow_fdw: \"%s\" is not an Arrow file", filename);
+		memcpy(&flen, tail, sizeof(int32));
+		if (flen < (int32)sizeof(uint32) ||
+			(size_t)flen > afile->file_size - sizeof(tail) - ARROW_FILE_MAGIC_LEN)
+			elog(ERROR, "arrow_fdw: footer of \"%s\" is corrupted", filename);
+		fbuf = palloc(flen);
+		__preadFile(fdesc, filename, fbuf, flen,
+					afile->file_size - sizeof(tail) - flen);
+
+		/* Footer { version, schema, dictionaries, recordBatches } */
+		fbtable_init(&footer, fbuf, flen, *((uint32 *)fbuf), filename);
+		if (!fbtable_get_table(&footer, 1, &schema))
+			elog(ERROR, "arrow_fdw: \"%s\" has no schema", filename);
+		if (fbtable_get_int(&schema, 0, sizeof(int16), 0) != 0)
+			elog(ERROR, "arrow_fdw: big-endian file \"%s\" is not supported",
+				 filename);
+		pos = fbtable_get_vector(&schema, 1, sizeof(uint32), &nitems);
+		afile->nfields = nitems;
+		afile->fields = palloc0(sizeof(ArrowField) * Max(nitems, 1));
+		for (i=0; i < nitems; i++)
+		{
+			fbtable_vector_table(&schema, pos, i, &sub);
+			arrowReadSchemaField(&sub, &afile->fields[i]);
+		}
+
+		/* Block { offset: long, metaDataLength: int, bodyLength: long } */
+		pos = fbtable_get_vector(&footer, 3, 24, &nitems);
+		for (i=0; i < nitems; i++)
+		{
+			const char *block = fbuf + pos + 24 * i;
+			int64		offset;
+			int32		meta_length;
+			int64		body_length;
+			RecordBatchInfo *rb;
+
+			memcpy(&offset, block, sizeof(int64));
+			memcpy(&meta_length, block + 8, sizeof(int32));
+			memcpy(&body_length, block + 16, sizeof(int64));
+			rb = arrowReadRecordBatch(fdesc, afile, offset,
+									  meta_length, body_length);
+			if (rb->nitems > 0)
+				afile->rbatches = lappend(afile->rbatches, rb);
+		}
+	}
+	PG_CATCH();
+	{
+		close(fdesc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	close(fdesc);
+	pfree(fbuf);
+
+	return afile;
+}
+
+/*
+ * arrowTypeConversion - returns ARROW_CONV__* to load the Arrow field to
+ * the attribute, or -1 if not compatible.
+ */
+static int
+arrowTypeConversion(ArrowField *field, Form_pg_attribute attr)
+{
+	int		width = field->bitWidth;
+
+	switch (attr->atttypid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			if (field->type_tag != ArrowType__Int ||
+				(width != 8 && width != 16 && width != 32 && width != 64))
+				break;
+			if (field->is_signed && width == 8 * attr->attlen)
+				return ARROW_CONV__COPY;
+			if (field->is_signed ? width < 8 * attr->attlen
+								 : width < 8 * attr->attlen - 1)
+				return ARROW_CONV__INT;
+			break;
+		case FLOAT4OID:
+			if (field->type_tag == ArrowType__FloatingPoint &&
+				field->precision == ArrowPrecision__Single)
+				return ARROW_CONV__COPY;
+			break;
+		case FLOAT8OID:
+			if (field->type_tag == ArrowType__FloatingPoint)
+			{
+				if (field->precision == ArrowPrecision__Double)
+					return ARROW_CONV__COPY;
+				if (field->precision == ArrowPrecision__Single)
+					return ARROW_CONV__FLOAT;
+			}
+			break;
+		case BOOLOID:
+			if (field->type_tag == ArrowType__Bool)
+				return ARROW_CONV__BOOL;
+			break;
+		case DATEOID:
+			if (field->type_tag == ArrowType__Date)
+				return ARROW_CONV__DATE;
+			break;
+		case TIMEOID:
+			if (field->type_tag == ArrowType__Time &&
+				width == ((field->unit == ArrowTimeUnit__Second ||
+						   field->unit == ArrowTimeUnit__MilliSecond)
+						  ? 32 : 64))
+				return (field->unit == ArrowTimeUnit__MicroSecond
+						? ARROW_CONV__COPY
+						: ARROW_CONV__TIME);
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			if (field->type_tag == ArrowType__Timestamp)
+				return ARROW_CONV__TIMESTAMP;
+			break;
+		case TEXTOID:
+		case VARCHAROID:
+			if (field->type_tag == ArrowType__Utf8)
+				return ARROW_CONV__VARLENA;
+			break;
+		case BYTEAOID:
+			if (field->type_tag == ArrowType__Binary)
+				return ARROW_CONV__VARLENA;
+			break;
+		default:
+			break;
+	}
+	return -1;
+}
+
+/*
+ * arrowCheckFileSchema - checks compatibility of the Arrow file with
+ * the definition of the foreign table, then maps the attributes to the
+ * fields in the same order.
+ */
+static void
+arrowCheckFileSchema(ArrowFileInfo *afile, TupleDesc tupdesc)
+{
+	int		i, k = 0;
+
+	afile->attr_to_field = palloc(sizeof(int) * Max(tupdesc->natts, 1));
+	for (i=0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+
+		if (attr->attisdropped)
+		{
+			afile->attr_to_field[i] = -1;
+			continue;
+		}
+		if (k >= afile->nfields)
+			elog(ERROR, "arrow_fdw: \"%s\" has less fields than the foreign table",
+				 afile->filename);
+		if (arrowTypeConversion(&afile->fields[k], attr) < 0)
+			elog(ERROR, "arrow_fdw: field \"%s\" in \"%s\" is not compatible to column \"%s\" of %s",
+				 afile->fields[k].name ? afile->fields[k].name : "",
+				 afile->filename,
+				 NameStr(attr->attname),
+				 format_type_be(attr->atttypid));
+		afile->attr_to_field[i] = k++;
+	}
+	if (k != afile->nfields)
+		elog(ERROR, "arrow_fdw: \"%s\" has more fields than the foreign table",
+			 afile->filename);
+}
+
+/*
+ * arrowFdwExtractFilesList
+ */
+static List *
+__arrowFdwExtractFilesList(List *options_list)
+{
+	ListCell   *lc;
+	List	   *filesList = NIL;
+
+	foreach (lc, options_list)
+	{
+		DefElem	   *defel = lfirst(lc);
+
+		if (strcmp(defel->defname, "file") == 0)
+		{
+			char   *temp = pstrdup(defGetString(defel));
+
+			canonicalize_path(temp);
+			filesList = lappend(filesList, temp);
+		}
+		else if (strcmp(defel->defname, "files") == 0)
+		{
+			char   *temp = pstrdup(defGetString(defel));
+			List   *namelist;
+
+			if (!SplitDirectoriesString(temp, ',', &namelist))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("arrow_fdw: invalid list syntax in \"files\" option")));
+			filesList = list_concat(filesList, namelist);
+		}
+		else
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("arrow_fdw: unknown option \"%s\"",
+							defel->defname)));
+		}
+	}
+	if (filesList == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("arrow_fdw: no files are specified")));
+	return filesList;
+}
+
+static List *
+arrowFdwExtractFilesList(Oid ftable_oid)
+{
+	ForeignTable   *ft = GetForeignTable(ftable_oid);
+
+	return __arrowFdwExtractFilesList(ft->options);
+}
+
+/*
+ * arrowLoadColumn - loads a column of the record batch onto the KDS.
+ * It returns the length consumed at @dest.
+ */
+static size_t
+arrowLoadColumn(int fdesc, ArrowFileInfo *afile, ArrowField *field,
+				RecordBatchColumn *rc, Form_pg_attribute attr,
+				kern_colmeta *cmeta, size_t nitems, char *dest)
+{
+	const char *filename = afile->filename;
+	int			conv = arrowTypeConversion(field, attr);
+	int			unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+	int			srcsz;
+	bits8	   *nullmap = NULL;
+	char	   *temp;
+	size_t		nbytes;
+	size_t		i;
+
+	Assert(conv > 0);
+	/* validity bitmap has the same layout to PostgreSQL's isnull bitmap */
+	if (rc->null_count > 0)
+	{
+		nbytes = BITMAPLEN(nitems);
+		if (rc->nullmap_length < nbytes)
+			elog(ERROR, "arrow_fdw: validity bitmap of \"%s\" in \"%s\" is too short",
+				 field->name, filename);
+		nullmap = palloc(nbytes);
+		__preadFile(fdesc, filename, (char *)nullmap, nbytes,
+					rc->nullmap_offset);
+	}
+
+	if (conv == ARROW_CONV__VARLENA)
+	{
+		cl_uint	   *vl_offsets = (cl_uint *)dest;
+		int32	   *offsets;
+		size_t		extra_pos = MAXALIGN(sizeof(cl_uint) * nitems);
+
+		if (rc->values_length < sizeof(int32) * (nitems + 1))
+			elog(ERROR, "arrow_fdw: offsets of \"%s\" in \"%s\" is too short",
+				 field->name, filename);
+		offsets = palloc(sizeof(int32) * (nitems + 1));
+		__preadFile(fdesc, filename, (char *)offsets,
+					sizeof(int32) * (nitems + 1), rc->values_offset);
+		temp = palloc(Max(rc->extra_length, 1));
+		__preadFile(fdesc, filename, temp, rc->extra_length,
+					rc->extra_offset);
+		for (i=0; i < nitems; i++)
+		{
+			int32		head = offsets[i];
+			int32		len = offsets[i+1] - head;
+			char	   *vl;
+
+			if (nullmap && att_isnull(i, nullmap))
+			{
+				vl_offsets[i] = 0;
+				continue;
+			}
+			if (head < 0 || len < 0 || head + len > rc->extra_length ||
+				len > MaxAllocSize - VARHDRSZ)
+				elog(ERROR, "arrow_fdw: offsets of \"%s\" in \"%s\" is corrupted",
+					 field->name, filename);
+			vl = dest + extra_pos;
+			SET_VARSIZE(vl, VARHDRSZ + len);
+			memcpy(VARDATA(vl), temp + head, len);
+			vl_offsets[i] = extra_pos / MAXIMUM_ALIGNOF;
+			extra_pos += MAXALIGN(VARHDRSZ + len);
+		}
+		pfree(offsets);
+		pfree(temp);
+		if (nullmap)
+			pfree(nullmap);
+		nbytes = MAXALIGN(sizeof(cl_uint) * nitems);
+		cmeta->extra_sz = (extra_pos - nbytes) / MAXIMUM_ALIGNOF;
+
+		return extra_pos;
+	}
+
+	/* fixed-length values */
+	if (conv == ARROW_CONV__BOOL)
+		srcsz = 0;
+	else if (field->type_tag == ArrowType__FloatingPoint)
+		srcsz = (field->precision == ArrowPrecision__Single ? 4 : 8);
+	else if (field->type_tag == ArrowType__Date)
+		srcsz = (field->unit == ArrowDateUnit__Day ? 4 : 8);
+	else if (field->type_tag == ArrowType__Timestamp)
+		srcsz = 8;
+	else
+		srcsz = field->bitWidth / BITS_PER_BYTE;
+	nbytes = (srcsz > 0 ? srcsz * nitems : BITMAPLEN(nitems));
+	if (rc->values_length < nbytes)
+		elog(ERROR, "arrow_fdw: values of \"%s\" in \"%s\" is too short",
+			 field->name, filename);
+
+	if (conv == ARROW_CONV__COPY)
+	{
+		/* binary compatible, so we can read the array as is */
+		Assert(srcsz == unitsz);
+		__preadFile(fdesc, filename, dest, nbytes, rc->values_offset);
+	}
+	else
+	{
+		temp = palloc(nbytes);
+		__preadFile(fdesc, filename, temp, nbytes, rc->values_offset);
+		for (i=0; i < nitems; i++)
+		{
+			char   *addr = dest + unitsz * i;
+			int64	ival;
+
+			switch (conv)
+			{
+				case ARROW_CONV__INT:
+					if (srcsz == sizeof(int8))
+						ival = (field->is_signed
+								? (int64)((int8 *)temp)[i]
+								: (int64)((uint8 *)temp)[i]);
+					else if (srcsz == sizeof(int16))
+						ival = (field->is_signed
+								? (int64)((int16 *)temp)[i]
+								: (int64)((uint16 *)temp)[i]);
+					else
+						ival = (field->is_signed
+								? (int64)((int32 *)temp)[i]
+								: (int64)((uint32 *)temp)[i]);
+					if (unitsz == sizeof(int16))
+						*((int16 *)addr) = ival;
+					else if (unitsz == sizeof(int32))
+						*((int32 *)addr) = ival;
+					else
+						*((int64 *)addr) = ival;
+					break;
+
+				case ARROW_CONV__FLOAT:
+					*((float8 *)addr) = ((float4 *)temp)[i];
+					break;
+
+				case ARROW_CONV__BOOL:
+					*((bool *)addr) = ((((bits8 *)temp)[i / BITS_PER_BYTE]
+										& (1 << (i % BITS_PER_BYTE))) != 0);
+					break;
+
+				case ARROW_CONV__DATE:
+					if (field->unit == ArrowDateUnit__Day)
+						ival = ((int32 *)temp)[i];
+					else
+					{
+						ival = ((int64 *)temp)[i];
+						ival = (ival >= 0
+								? ival / 86400000L
+								: (ival - 86399999L) / 86400000L);
+					}
+					*((DateADT *)addr) =
+						ival - (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE);
+					break;
+
+				case ARROW_CONV__TIME:
+					if (field->unit == ArrowTimeUnit__Second)
+						ival = (int64)((int32 *)temp)[i] * 1000000L;
+					else if (field->unit == ArrowTimeUnit__MilliSecond)
+						ival = (int64)((int32 *)temp)[i] * 1000L;
+					else
+						ival = ((int64 *)temp)[i] / 1000L;
+					*((TimeADT *)addr) = ival;
+					break;
+
+				case ARROW_CONV__TIMESTAMP:
+					ival = ((int64 *)temp)[i];
+					if (field->unit == ArrowTimeUnit__Second)
+						ival *= 1000000L;
+					else if (field->unit == ArrowTimeUnit__MilliSecond)
+						ival *= 1000L;
+					else if (field->unit == ArrowTimeUnit__NanoSecond)
+						ival /= 1000L;
+					*((Timestamp *)addr) =
+						ival - ((POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) *
+								USECS_PER_DAY);
+					break;
+
+				default:
+					elog(ERROR, "Bug? unexpected arrow conversion: %d", conv);
+			}
+		}
+		pfree(temp);
+	}
+	nbytes = MAXALIGN(unitsz * nitems);
+	if (!nullmap)
+		cmeta->extra_sz = 0;
+	else
+	{
+		memcpy(dest + nbytes, nullmap, BITMAPLEN(nitems));
+		pfree(nullmap);
+		cmeta->extra_sz = MAXALIGN(BITMAPLEN(nitems)) / MAXIMUM_ALIGNOF;
+		nbytes += MAXALIGN(BITMAPLEN(nitems));
+	}
+	return nbytes;
+}
+
+/*
+ * arrowRecordBatchLength - length of KDS_FORMAT_COLUMN to load the record
+ * batch, in the worst case.
+ */
+static size_t
+arrowRecordBatchLength(RecordBatchInfo *rb, TupleDesc tupdesc,
+					   Bitmapset *referenced)
+{
+	ArrowFileInfo *afile = rb->afile;
+	size_t		nitems = rb->nitems;
+	size_t		length;
+	int			j, k;
+
+	length = STROMALIGN(offsetof(kern_data_store,
+								 colmeta[tupdesc->natts + NumOfSystemAttrs]));
+	for (j = bms_next_member(referenced, -1);
+		 j >= 0;
+		 j = bms_next_member(referenced, j))
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		RecordBatchColumn *rc;
+
+		if ((k = afile->attr_to_field[j]) < 0)
+			continue;
+		rc = &rb->columns[k];
+		if (attr->attlen > 0)
+		{
+			length += MAXALIGN(TYPEALIGN(typealign_get_width(attr->attalign),
+										 attr->attlen) * nitems);
+			if (rc->null_count > 0)
+				length += MAXALIGN(BITMAPLEN(nitems));
+		}
+		else
+		{
+			length += (MAXALIGN(sizeof(cl_uint) * nitems) +
+					   MAXALIGN(rc->extra_length) +
+					   (VARHDRSZ + MAXIMUM_ALIGNOF) * nitems);
+		}
+	}
+	return length;
+}
+
+/*
+ * arrowLoadRecordBatch - loads the referenced columns of the record batch
+ * onto the KDS_FORMAT_COLUMN buffer.
+ */
+static void
+arrowLoadRecordBatch(RecordBatchInfo *rb, Relation frel,
+					 Bitmapset *referenced,
+					 kern_data_store *kds, size_t length)
+{
+	ArrowFileInfo *afile = rb->afile;
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	size_t		offset;
+	int			fdesc;
+	int			j, k;
+
+	init_kernel_data_store(kds, tupdesc, length,
+						   KDS_FORMAT_COLUMN, rb->nitems);
+	kds->table_oid = RelationGetRelid(frel);
+
+	fdesc = open(afile->filename, O_RDONLY);
+	if (fdesc < 0)
+		elog(ERROR, "failed on open('%s'): %m", afile->filename);
+	PG_TRY();
+	{
+		offset = STROMALIGN(offsetof(kern_data_store, colmeta[kds->ncols]));
+		for (j = bms_next_member(referenced, -1);
+			 j >= 0;
+			 j = bms_next_member(referenced, j))
+		{
+			kern_colmeta   *cmeta = &kds->colmeta[j];
+
+			if ((k = afile->attr_to_field[j]) < 0)
+				continue;
+			Assert(offset == MAXALIGN(offset));
+			cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
+			offset += arrowLoadColumn(fdesc, afile,
+									  &afile->fields[k],
+									  &rb->columns[k],
+									  tupdesc->attrs[j],
+									  cmeta, rb->nitems,
+									  (char *)kds + offset);
+		}
+		Assert(offset <= length);
+		kds->nitems = rb->nitems;
+	}
+	PG_CATCH();
+	{
+		close(fdesc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	close(fdesc);
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Interface for GpuScan/GpuJoin/GpuPreAgg
+ *
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * baseRelIsArrowFdw
+ */
+bool
+baseRelIsArrowFdw(RelOptInfo *baserel)
+{
+	if (baserel->reloptkind == RELOPT_BASEREL &&
+		baserel->rtekind == RTE_RELATION &&
+		baserel->fdwroutine &&
+		baserel->fdwroutine->BeginForeignScan == arrowBeginForeignScan)
+		return true;
+	return false;
+}
+
+/*
+ * RelationIsArrowFdw
+ */
+bool
+RelationIsArrowFdw(Relation frel)
+{
+	if (RelationGetForm(frel)->relkind == RELKIND_FOREIGN_TABLE)
+	{
+		FdwRoutine *routine = GetFdwRoutineForRelation(frel, false);
+
+		if (routine->BeginForeignScan == arrowBeginForeignScan)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * ExecInitArrowFdw
+ *
+ * @referenced is a set of (attnum - 1) of the columns to be loaded.
+ */
+ArrowFdwState *
+ExecInitArrowFdw(Relation frel, Bitmapset *referenced)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	ArrowFdwState *af_state;
+	List	   *filesList;
+	List	   *rbatches = NIL;
+	ListCell   *lc;
+	int			i;
+
+	filesList = arrowFdwExtractFilesList(RelationGetRelid(frel));
+	af_state = palloc0(sizeof(ArrowFdwState));
+	foreach (lc, filesList)
+	{
+		ArrowFileInfo *afile = arrowReadFileInfo(lfirst(lc));
+
+		arrowCheckFileSchema(afile, tupdesc);
+		af_state->files = lappend(af_state->files, afile);
+		rbatches = list_concat(rbatches, list_copy(afile->rbatches));
+	}
+	af_state->num_rbatches = list_length(rbatches);
+	af_state->rbatches = palloc0(sizeof(RecordBatchInfo *) *
+								 Max(af_state->num_rbatches, 1));
+	i = 0;
+	foreach (lc, rbatches)
+		af_state->rbatches[i++] = lfirst(lc);
+	af_state->rbatch_index = 0;
+	af_state->referenced = bms_copy(referenced);
+	af_state->memcxt = CurrentMemoryContext;
+
+	return af_state;
+}
+
+/*
+ * ExecScanChunkArrowFdw
+ *
+ * It loads the next record batch onto the managed memory, then returns
+ * a PDS of KDS_FORMAT_COLUMN, or NULL if end of the scan.
+ */
+pgstrom_data_store *
+ExecScanChunkArrowFdw(GpuTaskState *gts)
+{
+	ArrowFdwState  *af_state = gts->af_state;
+	Relation		frel = gts->css.ss.ss_currentRelation;
+	RecordBatchInfo *rb;
+	pgstrom_data_store *pds;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	size_t			length;
+
+	if (af_state->rbatch_index >= af_state->num_rbatches)
+		return NULL;
+	rb = af_state->rbatches[af_state->rbatch_index++];
+	length = arrowRecordBatchLength(rb, RelationGetDescr(frel),
+									af_state->referenced);
+	rc = gpuMemAllocManaged(gts->gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store, kds) + length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "out of managed memory");
+	pds = (pgstrom_data_store *)m_deviceptr;
+	memset(&pds->chain, 0, sizeof(dlist_node));
+	pds->gcontext = gts->gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = -1;
+	arrowLoadRecordBatch(rb, frel, af_state->referenced, &pds->kds, length);
+
+	return pds;
+}
+
+/*
+ * ExecReScanArrowFdw
+ */
+void
+ExecReScanArrowFdw(ArrowFdwState *af_state)
+{
+	if (af_state->curr_kds)
+		pfree(af_state->curr_kds);
+	af_state->curr_kds = NULL;
+	af_state->curr_index = 0;
+	af_state->rbatch_index = 0;
+}
+
+/*
+ * ExecEndArrowFdw
+ */
+void
+ExecEndArrowFdw(ArrowFdwState *af_state)
+{
+	if (af_state->curr_kds)
+		pfree(af_state->curr_kds);
+	af_state->curr_kds = NULL;
+}
+
+/*
+ * ExplainArrowFdw
+ */
+void
+ExplainArrowFdw(Relation frel, ExplainState *es)
+{
+	List	   *filesList = arrowFdwExtractFilesList(RelationGetRelid(frel));
+	ListCell   *lc;
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	foreach (lc, filesList)
+	{
+		if (buf.len > 0)
+			appendStringInfoString(&buf, ", ");
+		appendStringInfoString(&buf, (char *)lfirst(lc));
+	}
+	ExplainPropertyText("Arrow Files", buf.data, es);
+	pfree(buf.data);
+}
+
+/* ----------------------------------------------------------------
+ *
+ * FDW callbacks
+ *
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * arrowGetForeignRelSize
+ */
+static void
+arrowGetForeignRelSize(PlannerInfo *root,
+					   RelOptInfo *baserel,
+					   Oid foreigntableid)
+{
+	Relation	frel = heap_open(foreigntableid, NoLock);
+	List	   *filesList = arrowFdwExtractFilesList(foreigntableid);
+	size_t		nitems = 0;
+	size_t		total_size = 0;
+	ListCell   *lc1, *lc2;
+
+	foreach (lc1, filesList)
+	{
+		ArrowFileInfo *afile = arrowReadFileInfo(lfirst(lc1));
+
+		arrowCheckFileSchema(afile, RelationGetDescr(frel));
+		foreach (lc2, afile->rbatches)
+			nitems += ((RecordBatchInfo *) lfirst(lc2))->nitems;
+		total_size += afile->file_size;
+	}
+	heap_close(frel, NoLock);
+
+	baserel->tuples = (double) nitems;
+	baserel->pages	= (total_size + BLCKSZ - 1) / BLCKSZ;
+	baserel->rows	= clamp_row_est(baserel->tuples *
+									clauselist_selectivity(root,
+												baserel->baserestrictinfo,
+														   0,
+														   JOIN_INNER,
+														   NULL));
+}
+
+/*
+ * arrowGetForeignPaths
+ */
+static void
+arrowGetForeignPaths(PlannerInfo *root,
+					 RelOptInfo *baserel,
+					 Oid foreigntableid)
+{
+	ParamPathInfo *param_info;
+	ForeignPath *fpath;
+	Cost		startup_cost = baserel->baserestrictcost.startup;
+	Cost		per_tuple = baserel->baserestrictcost.per_tuple;
+	Cost		run_cost;
+	double		spc_seq_page_cost;
+	QualCost	qcost;
+
+	param_info = get_baserel_parampathinfo(root, baserel, NULL);
+	if (param_info)
+	{
+		cost_qual_eval(&qcost, param_info->ppi_clauses, root);
+		startup_cost += qcost.startup;
+		per_tuple += qcost.per_tuple;
+	}
+	get_tablespace_page_costs(baserel->reltablespace,
+							  NULL, &spc_seq_page_cost);
+	run_cost = (spc_seq_page_cost * baserel->pages +
+				(cpu_tuple_cost + per_tuple) * baserel->tuples);
+
+	fpath = create_foreignscan_path(root,
+									baserel,
+									NULL,	/* default pathtarget */
+									baserel->rows,
+									startup_cost,
+									startup_cost + run_cost,
+									NIL,	/* no pathkeys */
+									NULL,	/* no outer rel either */
+									NULL,	/* no extra plan */
+									NIL);	/* no fdw_private */
+	add_path(baserel, (Path *) fpath);
+}
+
+/*
+ * arrowGetForeignPlan
+ */
+static ForeignScan *
+arrowGetForeignPlan(PlannerInfo *root,
+					RelOptInfo *baserel,
+					Oid foreigntableid,
+					ForeignPath *best_path,
+					List *tlist,
+					List *scan_clauses,
+					Plan *outer_plan)
+{
+	Bitmapset  *varattnos = NULL;
+	List	   *scan_quals = NIL;
+	List	   *referenced = NIL;
+	ListCell   *lc;
+	int			i, j;
+
+	foreach (lc, scan_clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		Assert(IsA(rinfo, RestrictInfo));
+		if (rinfo->pseudoconstant)
+			continue;
+		scan_quals = lappend(scan_quals, rinfo->clause);
+	}
+
+	/* pickup referenced attributes, to load only these columns */
+	pull_varattnos((Node *)baserel->reltarget->exprs,
+				   baserel->relid, &varattnos);
+	pull_varattnos((Node *)scan_quals, baserel->relid, &varattnos);
+	for (i = bms_next_member(varattnos, -1);
+		 i >= 0;
+		 i = bms_next_member(varattnos, i))
+	{
+		j = i + FirstLowInvalidHeapAttributeNumber;
+		if (j == InvalidAttrNumber)
+		{
+			/* whole-row reference */
+			for (j=1; j <= baserel->max_attr; j++)
+				referenced = list_append_unique_int(referenced, j - 1);
+		}
+		else if (j > 0)
+			referenced = list_append_unique_int(referenced, j - 1);
+	}
+
+	return make_foreignscan(tlist,
+							scan_quals,
+							baserel->relid,
+							NIL,		/* fdw_exprs */
+							list_make1(referenced),	/* fdw_private */
+							NIL,		/* fdw_scan_tlist */
+							NIL,		/* fdw_recheck_quals */
+							NULL);		/* outer_plan */
+}
+
+/*
+ * arrowBeginForeignScan
+ */
+static void
+arrowBeginForeignScan(ForeignScanState *node, int eflags)
+{
+	Relation	frel = node->ss.ss_currentRelation;
+	ForeignScan *fscan = (ForeignScan *) node->ss.ps.plan;
+	Bitmapset  *referenced = NULL;
+	ListCell   *lc;
+
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	foreach (lc, (List *) linitial(fscan->fdw_private))
+		referenced = bms_add_member(referenced, lfirst_int(lc));
+	node->fdw_state = ExecInitArrowFdw(frel, referenced);
+}
+
+/*
+ * arrowIterateForeignScan
+ */
+static TupleTableSlot *
+arrowIterateForeignScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = (ArrowFdwState *) node->fdw_state;
+	Relation		frel = node->ss.ss_currentRelation;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	ExecClearTuple(slot);
+	for (;;)
+	{
+		if (!af_state->curr_kds)
+		{
+			RecordBatchInfo *rb;
+			size_t		length;
+
+			if (af_state->rbatch_index >= af_state->num_rbatches)
+				break;		/* end of the scan */
+			rb = af_state->rbatches[af_state->rbatch_index++];
+			length = arrowRecordBatchLength(rb, RelationGetDescr(frel),
+											af_state->referenced);
+			af_state->curr_kds = MemoryContextAllocHuge(af_state->memcxt,
+														length);
+			arrowLoadRecordBatch(rb, frel, af_state->referenced,
+								 af_state->curr_kds, length);
+			af_state->curr_index = 0;
+		}
+		if (KDS_fetch_tuple_column(slot, af_state->curr_kds,
+								   af_state->curr_index++))
+			break;
+		/* move to the next record batch */
+		pfree(af_state->curr_kds);
+		af_state->curr_kds = NULL;
+	}
+	return slot;
+}
+
+/*
+ * arrowReScanForeignScan
+ */
+static void
+arrowReScanForeignScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = (ArrowFdwState *) node->fdw_state;
+
+	ExecReScanArrowFdw(af_state);
+}
+
+/*
+ * arrowEndForeignScan
+ */
+static void
+arrowEndForeignScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = (ArrowFdwState *) node->fdw_state;
+
+	if (af_state)
+		ExecEndArrowFdw(af_state);
+}
+
+/*
+ * arrowExplainForeignScan
+ */
+static void
+arrowExplainForeignScan(ForeignScanState *node, ExplainState *es)
+{
+	ExplainArrowFdw(node->ss.ss_currentRelation, es);
+}
+
+/*
+ * pgstrom_arrow_fdw_validator
+ */
+Datum
+pgstrom_arrow_fdw_validator(PG_FUNCTION_ARGS)
+{
+	List	   *options = untransformRelOptions(PG_GETARG_DATUM(0));
+	Oid			catalog = PG_GETARG_OID(1);
+
+	switch (catalog)
+	{
+		case ForeignTableRelationId:
+			/* files on the server side are accessible only by superuser */
+			if (!superuser())
+				ereport(ERROR,
+						(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+						 errmsg("only superuser can specify files of arrow_fdw")));
+			__arrowFdwExtractFilesList(options);
+			break;
+
+		case AttributeRelationId:
+			if (options)
+				elog(ERROR, "arrow_fdw: no options are supported on columns");
+			break;
+
+		case ForeignServerRelationId:
+			if (options)
+				elog(ERROR, "arrow_fdw: no options are supported on SERVER");
+			break;
+
+		case ForeignDataWrapperRelationId:
+			if (options)
+				elog(ERROR, "arrow_fdw: no options are supported on FOREIGN DATA WRAPPER");
+			break;
+
+		default:
+			elog(ERROR, "arrow_fdw: no options are supported on catalog %s",
+				 get_rel_name(catalog));
+			break;
+	}
+	PG_RETURN_VOID();
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_validator);
+
+/*
+ * pgstrom_arrow_fdw_handler
+ */
+Datum
+pgstrom_arrow_fdw_handler(PG_FUNCTION_ARGS)
+{
+	FdwRoutine *routine = makeNode(FdwRoutine);
+
+	/* functions for scanning foreign tables */
+	routine->GetForeignRelSize	= arrowGetForeignRelSize;
+	routine->GetForeignPaths	= arrowGetForeignPaths;
+	routine->GetForeignPlan		= arrowGetForeignPlan;
+	routine->BeginForeignScan	= arrowBeginForeignScan;
+	routine->IterateForeignScan	= arrowIterateForeignScan;
+	routine->ReScanForeignScan	= arrowReScanForeignScan;
+	routine->EndForeignScan		= arrowEndForeignScan;
+	routine->ExplainForeignScan	= arrowExplainForeignScan;
+
+	PG_RETURN_POINTER(routine);
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_handler);
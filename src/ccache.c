@@ -40,6 +40,30 @@ typedef struct
 	Latch	   *latch;
 } ccacheBuilder;
 
+/*
+ * ccachePrewarm - request of the asynchronous prewarm
+ *
+ * pgstrom_ccache_prewarm(regclass, true) puts a request on the shared slot,
+ * then ccache-builders connected to the database pick up chunks of the table
+ * one by one. Every builder on the database works on the same request, so
+ * chunks are built in parallel. The slot is kept until it is reused by
+ * the next request, for the progress reporting.
+ */
+#define CCACHE_MAX_NUM_PREWARMS		32
+
+typedef struct
+{
+	Oid			database_oid;	/* InvalidOid, if free slot */
+	Oid			table_oid;
+	cl_uint		nchunks;		/* total number of chunks */
+	cl_uint		next_chunk;		/* next chunk to be built */
+	cl_uint		ninflight;		/* number of chunks in-progress */
+	cl_uint		nprocessed;		/* number of chunks processed */
+	cl_uint		nloaded;		/* number of chunks actually loaded */
+	TimestampTz	start_time;
+	TimestampTz	end_time;		/* 0, if in-progress */
+} ccachePrewarm;
+
 typedef struct
 {
 	pg_atomic_uint32 builder_log_output;
@@ -50,12 +74,17 @@ typedef struct
 	dlist_head		lru_active_list;
 	dlist_head		free_chunks_list;
 	dlist_head	   *active_slots;
+	/* management of the device tier */
+	dlist_head		dev_active_list;
+	dlist_head		dev_release_list;
+	size_t		   *dev_tier_usage;	/* per GPU device */
 	/* management of ccache builder workers */
 	pg_atomic_uint32 generation;
 	slock_t			lock;
 	int				rr_count;
 	int				num_databases;
 	ccacheDatabase	databases[CCACHE_MAX_NUM_DATABASES];
+	ccachePrewarm	prewarms[CCACHE_MAX_NUM_PREWARMS];
 	ccacheBuilder	builders[FLEXIBLE_ARRAY_MEMBER];
 } ccacheState;
 
@@ -81,9 +110,121 @@ struct ccacheChunk
 	TimestampTz	ctime;			/* timestamp of the cache creation.
 								 * may be zero, if not constructed yet. */
 	TimestampTz	atime;			/* time of the latest access */
+	TimestampTz	atime_prev;		/* time of the previous access, or zero if
+								 * referenced only once (LRU-2) */
+	cl_uint		nrefs;			/* number of uncorrelated accesses */
+	cl_ulong	cols_mask;		/* columns to be cached, or actually cached
+								 * on the ccache file; see CCACHE_COLS_MASK */
+	dlist_node	dev_chain;		/* link to the device tier list */
+	cl_int		dev_dindex;		/* GPU device of the device image */
+	bool		dev_in_progress;/* true, if device image is under build */
+	size_t		dev_length;		/* length of the device image, or zero if
+								 * the chunk is on the host tier only */
+	CUipcMemHandle dev_handle;	/* IPC handle of the device image */
+	cl_uint		ndirty;			/* number of dirty blocks */
+	bits8		dirty_map[CCACHE_CHUNK_NBLOCKS / BITS_PER_BYTE];
+								/* bitmap of the blocks modified after the
+								 * construction. rows in the dirty blocks
+								 * are read from the heap on scan. */
 };
 typedef struct ccacheChunk		ccacheChunk;
 
+/*
+ * Column encoding on the ccache file
+ *
+ * Fixed-length integer columns may be written out using frame-of-reference
+ * and bit-packing encoding. The encoding of the column is saved on the
+ * attcacheoff of kern_colmeta on the ccache file, because it does not make
+ * sense for KDS_FORMAT_COLUMN. The encoded region begins with
+ * ccacheEncodeHeader, packed values, then NULL-bitmap if any.
+ * It shall be decoded on pgstrom_ccache_load_chunk().
+ */
+#define CCACHE_ENCODE__NONE			(-1)
+#define CCACHE_ENCODE__FOR_BITPACK	1
+
+typedef struct
+{
+	cl_long		base;			/* frame of reference (min value) */
+	cl_int		nbits;			/* width of packed values in bits */
+	cl_int		hasnull;		/* true, if NULL-bitmap follows */
+} ccacheEncodeHeader;
+
+#define CCACHE_ENCODE_PACKED_LENGTH(nbits,nitems)		\
+	MAXALIGN(sizeof(cl_ulong) * (((size_t)(nbits) * (nitems) + 63) / 64))
+
+/*
+ * Zone-map of the ccache chunk
+ *
+ * min/max values and number of NULLs for each column, of the data types
+ * which are comparable as signed integer. It is written out just after
+ * the KDS (at kds->length) on the ccache file, then consulted prior to
+ * loading the chunk by pgstrom_ccache_skip_chunk().
+ */
+#define CCACHE_ZONEMAP_MAGIC		0x5a4d4150		/* 'ZMAP' */
+
+typedef struct
+{
+	cl_long		min_value;
+	cl_long		max_value;
+	cl_uint		nullcount;
+	cl_bool		is_valid;
+} ccacheZoneMapItem;
+
+typedef struct
+{
+	cl_uint		magic;
+	cl_uint		ncols;
+	cl_uint		nitems;
+	ccacheZoneMapItem items[FLEXIBLE_ARRAY_MEMBER];
+} ccacheZoneMap;
+
+typedef struct
+{
+	int			colidx;			/* index of the column on KDS */
+	int			strategy;		/* BT*StrategyNumber, as (Var OP Arg) */
+	Oid			arg_type;		/* type of the argument */
+	ExprState  *arg_state;		/* Const or Param */
+} ccacheZoneMapKey;
+
+/*
+ * Access-frequency driven admission and eviction
+ *
+ * Every access to a chunk (either hit or miss) is recorded on the ccacheChunk;
+ * the time of the latest and the previous one. Accesses within the correlated
+ * reference period (e.g, rescan of the same chunk) are counted once.
+ * When ccache usage reaches pg_strom.ccache_total_size, the victim is the chunk
+ * with the oldest previous access among the tail of the active list (LRU-2),
+ * so chunks referenced only once are evicted first. A misshit chunk is admitted
+ * only if its previous access is more recent than the one of the victim, thus
+ * one-off full table scans never push out the chunks scanned repeatedly.
+ *
+ * Columns referenced by the GPU queries are also recorded on the misshit chunk,
+ * then ccache-builder writes out only these columns. A chunk that lacks the
+ * columns referenced later is dropped and rebuilt with the union of them.
+ * The last bit of the mask stands for all the columns after.
+ */
+#define CCACHE_CORRELATED_REFERENCE_PERIOD	(1000000L)	/* 1sec */
+#define CCACHE_EVICTION_CANDIDATES			16
+#define CCACHE_ADMISSION_CANDIDATES			16
+#define CCACHE_COLS_MASK_NBITS		(sizeof(cl_ulong) * BITS_PER_BYTE)
+#define CCACHE_COLS_MASK_ALL		(~0UL)
+#define CCACHE_COLS_MASK(colidx)										(1UL << Min((colidx), CCACHE_COLS_MASK_NBITS - 1))
+
+/*
+ * Device tier of the ccache
+ *
+ * If pg_strom.ccache_device_tier_size is configured, ccache-builder promotes
+ * the hottest chunks (referenced twice at least, and no dirty blocks) to the
+ * preserved device memory, as a decoded KDS_FORMAT_COLUMN image of the cached
+ * columns. GpuScan and GpuPreAgg run their kernels on the image in place,
+ * instead of loading the ccache file over PCIe. The chunk is pinned during
+ * the query, then demoted to the host tier under the memory pressure of the
+ * device tier; the image of the coldest chunk is released.
+ * The ccache file is kept as is, so demotion is just release of the image.
+ * Device memory of the chunks released is freed by ccache-builder, because
+ * it never happen under the spinlock.
+ */
+
 #define CCACHE_CTIME_NOT_BUILD		(0)
 #define CCACHE_CTIME_IN_PROGRESS	(DT_NOEND)
 #define CCACHE_CTIME_IS_READY(ctime)			\
@@ -96,6 +237,10 @@ static int			ccache_num_builders;		/* GUC */
 static bool			__ccache_log_output;		/* GUC */
 static size_t		ccache_total_size;			/* GUC */
 static char		   *ccache_base_dir_name;		/* GUC */
+static bool			ccache_compression;			/* GUC */
+static int			ccache_max_dirty_blocks;	/* GUC */
+static size_t		ccache_device_tier_size;	/* GUC */
+static int			ccache_builder_nthreads;	/* GUC */
 static DIR		   *ccache_base_dir = NULL;
 static ccacheState *ccache_state = NULL;		/* shmem */
 static cl_int		ccache_num_chunks;
@@ -108,12 +253,23 @@ static HTAB		   *ccache_relations_htab = NULL;
 static oidvector   *ccache_relations_oid = NULL;
 static Oid			ccache_invalidator_func_oid = InvalidOid;
 
+/* pins of the device images in use by this backend */
+typedef struct
+{
+	dlist_node	chain;
+	ResourceOwner resowner;
+	ccacheChunk *cc_chunk;
+} ccacheDevicePin;
+static dlist_head	ccache_device_pins;
+
 /* functions */
 void ccache_builder_main(Datum arg);
 Datum pgstrom_ccache_invalidator(PG_FUNCTION_ARGS);
 Datum pgstrom_ccache_info(PG_FUNCTION_ARGS);
 Datum pgstrom_ccache_builder_info(PG_FUNCTION_ARGS);
+Datum pgstrom_ccache_prewarm_info(PG_FUNCTION_ARGS);
 Datum pgstrom_ccache_prewarm(PG_FUNCTION_ARGS);
+static void refresh_ccache_source_relations(void);
 
 /*
  * ccache_compute_hashvalue
@@ -239,6 +395,15 @@ ccache_put_chunk_nolock(ccacheChunk *cc_chunk)
 														   cc_chunk->length));
 			ccache_state->ccache_usage -= TYPEALIGN(BLCKSZ, cc_chunk->length);
 		}
+		if (cc_chunk->dev_length > 0)
+		{
+			/* device image shall be freed by ccache-builder */
+			Assert(!cc_chunk->dev_in_progress);
+			dlist_delete(&cc_chunk->dev_chain);
+			dlist_push_tail(&ccache_state->dev_release_list,
+							&cc_chunk->dev_chain);
+			return;
+		}
 		/* back to the free list */
 		memset(cc_chunk, 0, sizeof(ccacheChunk));
 		dlist_push_head(&ccache_state->free_chunks_list,
@@ -260,11 +425,31 @@ pgstrom_ccache_is_empty(ccacheChunk *cc_chunk)
 	return (cc_chunk->nitems == 0);
 }
 
+/*
+ * ccache_touch_chunk_nolock - records an access to the chunk
+ */
+static void
+ccache_touch_chunk_nolock(ccacheChunk *cc_chunk)
+{
+	TimestampTz	now = GetCurrentTimestamp();
+
+	if (cc_chunk->nrefs == 0)
+		cc_chunk->nrefs = 1;
+	else if (now - cc_chunk->atime >= CCACHE_CORRELATED_REFERENCE_PERIOD)
+	{
+		cc_chunk->atime_prev = cc_chunk->atime;
+		if (cc_chunk->nrefs < UINT_MAX)
+			cc_chunk->nrefs++;
+	}
+	cc_chunk->atime = now;
+}
+
 /*
  * pgstrom_ccache_get_chunk
  */
 ccacheChunk *
-pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
+pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr,
+						 Relids ccache_refs)
 {
 	Oid			table_oid = RelationGetRelid(relation);
 	pg_crc32	hash;
@@ -273,6 +458,16 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 	dlist_node *dnode;
 	ccacheChunk *cc_chunk = NULL;
 	ccacheChunk *cc_temp;
+	cl_ulong	refs_mask = 0;
+	TimestampTz	atime = 0;
+	TimestampTz	atime_prev = 0;
+	cl_uint		nrefs = 0;
+	int			j;
+
+	for (j = bms_next_member(ccache_refs, -1);
+		 j >= 0;
+		 j = bms_next_member(ccache_refs, j))
+		refs_mask |= CCACHE_COLS_MASK(j);
 
 	hash = ccache_compute_hashvalue(MyDatabaseId, table_oid, block_nr);
 	index = hash % ccache_num_slots;
@@ -286,7 +481,6 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 			cc_temp->table_oid == table_oid &&
 			cc_temp->block_nr == block_nr)
 		{
-			cc_temp->atime = GetCurrentTimestamp();
 			if (cc_temp->ctime == CCACHE_CTIME_NOT_BUILD)
 			{
 				Assert(cc_temp->length == 0 &&
@@ -294,14 +488,35 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 					   cc_temp->lru_chain.prev != NULL);
 				dlist_move_head(&ccache_state->lru_misshit_list,
 								&cc_temp->lru_chain);
-				cc_temp->atime = GetCurrentTimestamp();
+				cc_temp->cols_mask |= refs_mask;
+				ccache_touch_chunk_nolock(cc_temp);
 			}
 			else if (cc_temp->ctime == CCACHE_CTIME_IN_PROGRESS)
 			{
 				Assert(cc_temp->length == 0 &&
 					   cc_temp->lru_chain.next == NULL &&
 					   cc_temp->lru_chain.prev == NULL);
-				cc_temp->atime = GetCurrentTimestamp();
+				ccache_touch_chunk_nolock(cc_temp);
+			}
+			else if ((refs_mask & ~cc_temp->cols_mask) != 0)
+			{
+				/*
+				 * The chunk lacks a part of the referenced columns, so it
+				 * is dropped, then tracked as misshit entry to be rebuilt
+				 * with the union of the columns.
+				 */
+				Assert(cc_temp->length > 0);
+				refs_mask |= cc_temp->cols_mask;
+				/* the new entry inherits the access history */
+				atime = cc_temp->atime;
+				atime_prev = cc_temp->atime_prev;
+				nrefs = cc_temp->nrefs;
+				dlist_delete(&cc_temp->hash_chain);
+				dlist_delete(&cc_temp->lru_chain);
+				memset(&cc_temp->hash_chain, 0, sizeof(dlist_node));
+				memset(&cc_temp->lru_chain, 0, sizeof(dlist_node));
+				ccache_put_chunk_nolock(cc_temp);
+				break;
 			}
 			else
 			{
@@ -310,7 +525,7 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 								&cc_temp->lru_chain);
 				cc_chunk = cc_temp;
 				cc_chunk->refcnt++;
-				cc_chunk->atime = GetCurrentTimestamp();
+				ccache_touch_chunk_nolock(cc_chunk);
 			}
 			goto found;
 		}
@@ -346,7 +561,11 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 		cc_chunk->table_oid = table_oid;
 		cc_chunk->block_nr = block_nr;
 		cc_chunk->refcnt = 1;
-		cc_chunk->atime = GetCurrentTimestamp();
+		cc_chunk->atime = atime;
+		cc_chunk->atime_prev = atime_prev;
+		cc_chunk->nrefs = nrefs;
+		cc_chunk->cols_mask = refs_mask;
+		ccache_touch_chunk_nolock(cc_chunk);
 		dlist_push_tail(&ccache_state->active_slots[index],
 						&cc_chunk->hash_chain);
 		dlist_push_head(&ccache_state->lru_misshit_list,
@@ -359,6 +578,619 @@ found:
 	return cc_chunk;
 }
 
+/*
+ * pgstrom_ccache_residency_ratio
+ *
+ * It returns the ratio of blocks of the relation which are already held by
+ * the columnar cache, for the planner to discount i/o and DMA cost. Dirty
+ * blocks are not counted because they are read from the heap on scan.
+ * Chunks of a huge relation are sampled, not to hold the spinlock long.
+ */
+#define CCACHE_RESIDENCY_MAX_PROBES		2000
+
+double
+pgstrom_ccache_residency_ratio(Oid table_oid, BlockNumber nblocks)
+{
+	BlockNumber	nchunks = nblocks / CCACHE_CHUNK_NBLOCKS;
+	BlockNumber	step;
+	BlockNumber	i;
+	cl_long		nprobes = 0;
+	cl_long		nvalids = 0;
+
+	if (!ccache_state || nchunks == 0)
+		return 0.0;
+	refresh_ccache_source_relations();
+	if (!ccache_relations_htab ||
+		!hash_search(ccache_relations_htab, &table_oid, HASH_FIND, NULL))
+		return 0.0;
+
+	step = nchunks / CCACHE_RESIDENCY_MAX_PROBES + 1;
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	for (i=0; i < nchunks; i += step)
+	{
+		BlockNumber	block_nr = i * CCACHE_CHUNK_NBLOCKS;
+		pg_crc32	hash;
+		dlist_iter	iter;
+
+		hash = ccache_compute_hashvalue(MyDatabaseId, table_oid, block_nr);
+		dlist_foreach (iter, &ccache_state->active_slots[hash %
+														 ccache_num_slots])
+		{
+			ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+												   hash_chain, iter.cur);
+			if (cc_temp->hash == hash &&
+				cc_temp->database_oid == MyDatabaseId &&
+				cc_temp->table_oid == table_oid &&
+				cc_temp->block_nr == block_nr)
+			{
+				if (CCACHE_CTIME_IS_READY(cc_temp->ctime))
+					nvalids += CCACHE_CHUNK_NBLOCKS - cc_temp->ndirty;
+				break;
+			}
+		}
+		nprobes++;
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	/* blocks on the last partial chunk are never cached */
+	return (((double)nvalids / (double)(nprobes * CCACHE_CHUNK_NBLOCKS)) *
+			((double)(nchunks * CCACHE_CHUNK_NBLOCKS) / (double)nblocks));
+}
+
+/*
+ * ccache_zonemap_datum - fetch a Datum as signed 64bit integer, if the data
+ * type is comparable by zone-map
+ */
+static inline bool
+ccache_zonemap_datum(Oid type_oid, Datum datum, cl_long *p_value)
+{
+	switch (type_oid)
+	{
+		case INT2OID:
+			*p_value = DatumGetInt16(datum);
+			return true;
+		case INT4OID:
+		case DATEOID:
+			*p_value = DatumGetInt32(datum);
+			return true;
+		case INT8OID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			*p_value = DatumGetInt64(datum);
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+/*
+ * ccache_build_zonemap - construction of the zone-map from KDS_FORMAT_COLUMN
+ */
+static void
+ccache_build_zonemap(kern_data_store *kds, ccacheZoneMap *zmap)
+{
+	size_t		i, nitems = kds->nitems;
+	int			j;
+
+	memset(zmap, 0, offsetof(ccacheZoneMap, items[kds->ncols]));
+	zmap->magic = CCACHE_ZONEMAP_MAGIC;
+	zmap->ncols = kds->ncols;
+	zmap->nitems = nitems;
+	for (j=0; j < kds->ncols; j++)
+	{
+		kern_colmeta *cmeta = &kds->colmeta[j];
+		ccacheZoneMapItem *zitem = &zmap->items[j];
+		char	   *addr;
+		bits8	   *nullmap = NULL;
+		cl_long		value;
+
+		if (cmeta->va_offset == 0 ||
+			!ccache_zonemap_datum(cmeta->atttypid, 0, &value))
+			continue;
+		addr = (char *)kds + cmeta->va_offset * MAXIMUM_ALIGNOF;
+		if (cmeta->extra_sz > 0)
+			nullmap = (bits8 *)(addr + MAXALIGN(TYPEALIGN(cmeta->attalign,
+														  cmeta->attlen) *
+												nitems));
+		zitem->min_value = LONG_MAX;
+		zitem->max_value = LONG_MIN;
+		for (i=0; i < nitems; i++)
+		{
+			if (nullmap && att_isnull(i, nullmap))
+			{
+				zitem->nullcount++;
+				continue;
+			}
+			if (cmeta->attlen == sizeof(cl_short))
+				value = ((cl_short *)addr)[i];
+			else if (cmeta->attlen == sizeof(cl_int))
+				value = ((cl_int *)addr)[i];
+			else
+				value = ((cl_long *)addr)[i];
+			zitem->min_value = Min(zitem->min_value, value);
+			zitem->max_value = Max(zitem->max_value, value);
+		}
+		zitem->is_valid = true;
+	}
+}
+
+/*
+ * pgstrom_ccache_init_zonemap
+ *
+ * It picks up (Var OP Const/Param) form of the scan qualifiers, to check
+ * zone-map of the ccache chunks.
+ */
+void
+pgstrom_ccache_init_zonemap(GpuTaskState *gts, List *quals)
+{
+	ListCell   *lc;
+
+	if (!gts->ccache_refs)
+		return;
+	foreach (lc, quals)
+	{
+		OpExpr	   *op = lfirst(lc);
+		Node	   *larg;
+		Node	   *rarg;
+		Var		   *var;
+		Expr	   *arg;
+		List	   *interp_list;
+		ListCell   *cell;
+		int			strategy = 0;
+		cl_long		dummy;
+		ccacheZoneMapKey *zkey;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+		larg = linitial(op->args);
+		rarg = lsecond(op->args);
+		if (IsA(larg, Var) && (IsA(rarg, Const) || IsA(rarg, Param)))
+		{
+			var = (Var *)larg;
+			arg = (Expr *)rarg;
+		}
+		else if (IsA(rarg, Var) && (IsA(larg, Const) || IsA(larg, Param)))
+		{
+			var = (Var *)rarg;
+			arg = (Expr *)larg;
+		}
+		else
+			continue;
+		if (var->varattno <= 0 ||
+			!ccache_zonemap_datum(var->vartype, 0, &dummy) ||
+			!ccache_zonemap_datum(exprType((Node *)arg), 0, &dummy))
+			continue;
+		/*
+		 * Unit of the value is consistent on integer types, but not on
+		 * the date and time types; e.g) date vs timestamp
+		 */
+		if (var->vartype != exprType((Node *)arg) &&
+			((var->vartype != INT2OID &&
+			  var->vartype != INT4OID &&
+			  var->vartype != INT8OID) ||
+			 (exprType((Node *)arg) != INT2OID &&
+			  exprType((Node *)arg) != INT4OID &&
+			  exprType((Node *)arg) != INT8OID)))
+			continue;
+
+		interp_list = get_op_btree_interpretation(op->opno);
+		foreach (cell, interp_list)
+		{
+			OpBtreeInterpretation *interp = lfirst(cell);
+
+			if (interp->strategy >= BTLessStrategyNumber &&
+				interp->strategy <= BTGreaterStrategyNumber)
+			{
+				strategy = interp->strategy;
+				break;
+			}
+		}
+		list_free_deep(interp_list);
+		if (strategy == 0)
+			continue;
+		/* commute the operator, if (Arg OP Var) form */
+		if ((Node *)var == rarg)
+			strategy = (BTMaxStrategyNumber + 1) - strategy;
+
+		zkey = palloc0(sizeof(ccacheZoneMapKey));
+		zkey->colidx = var->varattno - 1;
+		zkey->strategy = strategy;
+		zkey->arg_type = exprType((Node *)arg);
+		zkey->arg_state = ExecInitExpr(arg, &gts->css.ss.ps);
+		gts->ccache_zmap_keys = lappend(gts->ccache_zmap_keys, zkey);
+	}
+}
+
+/*
+ * pgstrom_ccache_skip_chunk
+ *
+ * It checks zone-map of the ccache chunk, then returns true if no rows in
+ * the chunk can satisfy the scan qualifiers.
+ */
+bool
+pgstrom_ccache_skip_chunk(ccacheChunk *cc_chunk, GpuTaskState *gts)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	ExprContext *econtext = gts->css.ss.ps.ps_ExprContext;
+	kern_data_store kds_head;
+	ccacheZoneMap *zmap = NULL;
+	char		fname[MAXPGPATH];
+	size_t		length;
+	int			fdesc;
+	bool		retval = false;
+	ListCell   *lc;
+
+	if (gts->ccache_zmap_keys == NIL)
+		return false;
+	Assert(CCACHE_CTIME_IS_READY(cc_chunk->ctime));
+	/* rows on the dirty blocks are out of the zone-map */
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	if (cc_chunk->ndirty > 0)
+		retval = true;
+	SpinLockRelease(&ccache_state->chunks_lock);
+	if (retval)
+		return false;
+	ccache_chunk_filename(fname,
+						  MyDatabaseId,
+						  RelationGetRelid(relation),
+						  cc_chunk->block_nr);
+	fdesc = openat(dirfd(ccache_base_dir), fname, O_RDONLY);
+	if (fdesc < 0)
+		return false;
+	/* length of the KDS, then zone-map follows */
+	if (pread(fdesc, &kds_head, offsetof(kern_data_store, colmeta), 0)
+		!= offsetof(kern_data_store, colmeta))
+		goto out;
+	length = offsetof(ccacheZoneMap, items[kds_head.ncols]);
+	zmap = palloc(length);
+	if (pread(fdesc, zmap, length, MAXALIGN(kds_head.length)) != length ||
+		zmap->magic != CCACHE_ZONEMAP_MAGIC ||
+		zmap->ncols != kds_head.ncols)
+		goto out;
+
+	foreach (lc, gts->ccache_zmap_keys)
+	{
+		ccacheZoneMapKey *zkey = lfirst(lc);
+		ccacheZoneMapItem *zitem;
+		Datum		datum;
+		bool		isnull;
+		cl_long		value;
+
+		if (zkey->colidx >= zmap->ncols)
+			continue;
+		zitem = &zmap->items[zkey->colidx];
+		if (!zitem->is_valid)
+			continue;
+		/* strict operators never match to all-null chunk */
+		if (zitem->nullcount >= zmap->nitems)
+		{
+			retval = true;
+			break;
+		}
+#if PG_VERSION_NUM < 100000
+		datum = ExecEvalExpr(zkey->arg_state, econtext, &isnull, NULL);
+#else
+		datum = ExecEvalExpr(zkey->arg_state, econtext, &isnull);
+#endif
+		if (isnull ||
+			!ccache_zonemap_datum(zkey->arg_type, datum, &value))
+			continue;
+		switch (zkey->strategy)
+		{
+			case BTLessStrategyNumber:
+				retval = (zitem->min_value >= value);
+				break;
+			case BTLessEqualStrategyNumber:
+				retval = (zitem->min_value > value);
+				break;
+			case BTEqualStrategyNumber:
+				retval = (value < zitem->min_value ||
+						  value > zitem->max_value);
+				break;
+			case BTGreaterEqualStrategyNumber:
+				retval = (zitem->max_value < value);
+				break;
+			case BTGreaterStrategyNumber:
+				retval = (zitem->max_value <= value);
+				break;
+			default:
+				break;
+		}
+		if (retval)
+			break;
+	}
+out:
+	if (zmap)
+		pfree(zmap);
+	close(fdesc);
+	return retval;
+}
+
+/*
+ * ccache_load_encoded_column - read and decode an encoded column
+ *
+ * It returns true, if NULL-bitmap is also loaded.
+ */
+static bool
+ccache_load_encoded_column(int fdesc, kern_colmeta *cmeta,
+						   size_t nitems, char *dest)
+{
+	ccacheEncodeHeader *ehead;
+	size_t		nbytes = cmeta->extra_sz * MAXIMUM_ALIGNOF;
+	size_t		unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+	cl_ulong   *packed;
+	cl_ulong	mask;
+	size_t		i, bitpos;
+	char	   *buffer;
+	bool		hasnull;
+
+	buffer = palloc_huge(nbytes);
+	if (pread(fdesc, buffer, nbytes,
+			  cmeta->va_offset * MAXIMUM_ALIGNOF) != nbytes)
+		elog(ERROR, "failed on pread(2): %m");
+	ehead = (ccacheEncodeHeader *)buffer;
+	packed = (cl_ulong *)(buffer + MAXALIGN(sizeof(ccacheEncodeHeader)));
+	mask = (ehead->nbits < 64 ? (1UL << ehead->nbits) - 1 : ~0UL);
+	for (i=0, bitpos=0; i < nitems; i++, bitpos += ehead->nbits)
+	{
+		cl_ulong	value = 0;
+		cl_uint		shift = bitpos % 64;
+
+		if (ehead->nbits > 0)
+		{
+			value = packed[bitpos / 64] >> shift;
+			if (shift + ehead->nbits > 64)
+				value |= packed[bitpos / 64 + 1] << (64 - shift);
+			value &= mask;
+		}
+		value += (cl_ulong)ehead->base;
+
+		switch (cmeta->attlen)
+		{
+			case sizeof(cl_short):
+				((cl_short *)dest)[i] = (cl_short)value;
+				break;
+			case sizeof(cl_int):
+				((cl_int *)dest)[i] = (cl_int)value;
+				break;
+			case sizeof(cl_long):
+				((cl_long *)dest)[i] = (cl_long)value;
+				break;
+			default:
+				elog(ERROR, "unexpected attlen %d on encoded column",
+					 cmeta->attlen);
+		}
+	}
+	/* NULL-bitmap if any */
+	hasnull = (ehead->hasnull != 0);
+	if (hasnull)
+		memcpy(dest + MAXALIGN(unitsz * nitems),
+			   (char *)packed +
+			   CCACHE_ENCODE_PACKED_LENGTH(ehead->nbits, nitems),
+			   MAXALIGN(BITMAPLEN(nitems)));
+	pfree(buffer);
+
+	return hasnull;
+}
+
+/*
+ * ccache_remove_dirty_rows
+ *
+ * It removes rows on the dirty blocks from the PDS_column loaded, according
+ * to the ctid system column on the ccache file.
+ */
+static void
+ccache_remove_dirty_rows(pgstrom_data_store *pds,
+						 kern_data_store *kds_head,
+						 int fdesc, Relids ccache_refs,
+						 BlockNumber chunk_nr, bits8 *dirty_map)
+{
+	kern_data_store *kds = &pds->kds;
+	kern_colmeta *cmeta;
+	size_t		nitems = kds->nitems;
+	size_t		nkeeps = 0;
+	size_t		i, k, nbytes;
+	ItemPointerData *ctids;
+	bits8	   *rowmap;
+	bits8	   *nullmap_temp;
+	int			j;
+
+	cmeta = &kds_head->colmeta[kds_head->ncols + SelfItemPointerAttributeNumber];
+	Assert(cmeta->attnum == SelfItemPointerAttributeNumber &&
+		   cmeta->attlen == sizeof(ItemPointerData) &&
+		   cmeta->attcacheoff != CCACHE_ENCODE__FOR_BITPACK);
+	nbytes = sizeof(ItemPointerData) * nitems;
+	ctids = palloc_huge(nbytes);
+	if (pread(fdesc, ctids, nbytes,
+			  cmeta->va_offset * MAXIMUM_ALIGNOF) != nbytes)
+		elog(ERROR, "failed on pread(2): %m");
+	rowmap = palloc0(BITMAPLEN(nitems));
+	for (i=0; i < nitems; i++)
+	{
+		BlockNumber	k = ItemPointerGetBlockNumber(&ctids[i]) - chunk_nr;
+
+		Assert(k < CCACHE_CHUNK_NBLOCKS);
+		if ((dirty_map[k / BITS_PER_BYTE] & (1 << (k % BITS_PER_BYTE))) == 0)
+		{
+			rowmap[i / BITS_PER_BYTE] |= (1 << (i % BITS_PER_BYTE));
+			nkeeps++;
+		}
+	}
+	pfree(ctids);
+	if (nkeeps == nitems)
+	{
+		pfree(rowmap);
+		return;
+	}
+
+	nullmap_temp = palloc(MAXALIGN(BITMAPLEN(nkeeps)));
+	for (j = bms_next_member(ccache_refs, -1);
+		 j >= 0;
+		 j = bms_next_member(ccache_refs, j))
+	{
+		kern_colmeta *dmeta = &kds->colmeta[j];
+		char	   *addr;
+
+		if (dmeta->attnum == TableOidAttributeNumber ||
+			kds_head->colmeta[j].va_offset == 0)
+			continue;
+		addr = (char *)kds + dmeta->va_offset * MAXIMUM_ALIGNOF;
+		if (dmeta->attlen < 0)
+		{
+			cl_uint	   *base = (cl_uint *)addr;
+
+			for (i=0, k=0; i < nitems; i++)
+			{
+				if (att_isnull(i, rowmap))
+					continue;
+				base[k++] = base[i];
+			}
+			/* offset of varlena body is relative to the base */
+			dmeta->extra_sz += (MAXALIGN(sizeof(cl_uint) * nitems) -
+								MAXALIGN(sizeof(cl_uint) * nkeeps))
+				/ MAXIMUM_ALIGNOF;
+		}
+		else
+		{
+			int		unitsz = TYPEALIGN(dmeta->attalign, dmeta->attlen);
+			bits8  *nullmap = NULL;
+
+			if (dmeta->extra_sz > 0)
+			{
+				nullmap = (bits8 *)(addr + MAXALIGN(unitsz * nitems));
+				memset(nullmap_temp, 0, MAXALIGN(BITMAPLEN(nkeeps)));
+			}
+			for (i=0, k=0; i < nitems; i++)
+			{
+				if (att_isnull(i, rowmap))
+					continue;
+				if (nullmap && !att_isnull(i, nullmap))
+					nullmap_temp[k / BITS_PER_BYTE]
+						|= (1 << (k % BITS_PER_BYTE));
+				if (k != i)
+					memcpy(addr + unitsz * k, addr + unitsz * i, unitsz);
+				k++;
+			}
+			if (nullmap)
+			{
+				memcpy(addr + MAXALIGN(unitsz * nkeeps), nullmap_temp,
+					   MAXALIGN(BITMAPLEN(nkeeps)));
+				dmeta->extra_sz = MAXALIGN(BITMAPLEN(nkeeps)) / MAXIMUM_ALIGNOF;
+			}
+		}
+	}
+	kds->nitems = nkeeps;
+	pfree(nullmap_temp);
+	pfree(rowmap);
+}
+
+/*
+ * ccache_decoded_length - length of KDS_FORMAT_COLUMN to load the columns
+ */
+static size_t
+ccache_decoded_length(kern_data_store *kds_head, Relids ccache_refs)
+{
+	size_t		nitems = kds_head->nitems;
+	size_t		length;
+	int			i;
+
+	length = STROMALIGN(offsetof(kern_data_store,
+								 colmeta[kds_head->ncols]));
+	for (i = bms_next_member(ccache_refs, -1);
+		 i >= 0;
+		 i = bms_next_member(ccache_refs, i))
+	{
+		kern_colmeta   *cmeta = &kds_head->colmeta[i];
+
+		/* pgstrom_ccache_get_chunk() checks cols_mask in advance */
+		if (cmeta->va_offset == 0)
+			elog(ERROR, "Bug? column %d is not cached on the chunk", i);
+		if (cmeta->attcacheoff == CCACHE_ENCODE__FOR_BITPACK)
+		{
+			/* decoded values + NULL-bitmap in the worst case */
+			length += (MAXALIGN(TYPEALIGN(cmeta->attalign,
+										  cmeta->attlen) * nitems) +
+					   MAXALIGN(BITMAPLEN(nitems)));
+			continue;
+		}
+		length += cmeta->extra_sz * MAXIMUM_ALIGNOF;
+		if (cmeta->attlen > 0)
+			length += MAXALIGN(TYPEALIGN(cmeta->attalign,
+										 cmeta->attlen) * nitems);
+		else
+			length += MAXALIGN(sizeof(cl_uint) * nitems);
+	}
+	return length;
+}
+
+/*
+ * ccache_decode_columns - load the columns from the ccache file
+ *
+ * @kds has to be initialized with the length by ccache_decoded_length().
+ */
+static void
+ccache_decode_columns(int fdesc, kern_data_store *kds_head,
+					  Relids ccache_refs, kern_data_store *kds)
+{
+	size_t		nitems = kds_head->nitems;
+	size_t		offset;
+	int			i;
+
+	offset = STROMALIGN(offsetof(kern_data_store,
+								 colmeta[kds_head->ncols]));
+	for (i = bms_next_member(ccache_refs, -1);
+		 i >= 0;
+		 i = bms_next_member(ccache_refs, i))
+	{
+		kern_colmeta   *cmeta = &kds_head->colmeta[i];
+		size_t			nbytes;
+
+		Assert(kds->colmeta[i].attbyval  == cmeta->attbyval &&
+			   kds->colmeta[i].attalign  == cmeta->attalign &&
+			   kds->colmeta[i].attlen    == cmeta->attlen &&
+			   kds->colmeta[i].attnum    == cmeta->attnum &&
+			   kds->colmeta[i].atttypid  == cmeta->atttypid &&
+			   kds->colmeta[i].atttypmod == cmeta->atttypmod);
+		Assert(offset == MAXALIGN(offset));
+		kds->colmeta[i].va_offset = offset / MAXIMUM_ALIGNOF;
+		if (cmeta->attcacheoff == CCACHE_ENCODE__FOR_BITPACK)
+		{
+			nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
+										cmeta->attlen) * nitems);
+			if (ccache_load_encoded_column(fdesc, cmeta, nitems,
+										   (char *)kds + offset))
+			{
+				kds->colmeta[i].extra_sz
+					= MAXALIGN(BITMAPLEN(nitems)) / MAXIMUM_ALIGNOF;
+				nbytes += MAXALIGN(BITMAPLEN(nitems));
+			}
+			else
+				kds->colmeta[i].extra_sz = 0;
+			offset += nbytes;
+			continue;
+		}
+		kds->colmeta[i].extra_sz = cmeta->extra_sz;
+
+		nbytes = cmeta->extra_sz * MAXIMUM_ALIGNOF;
+		if (cmeta->attlen > 0)
+			nbytes += MAXALIGN(TYPEALIGN(cmeta->attalign,
+										 cmeta->attlen) * nitems);
+		else
+			nbytes += MAXALIGN(sizeof(cl_uint) * nitems);
+
+		if (pread(fdesc,
+				  (char *)kds + offset,
+				  nbytes,
+				  cmeta->va_offset * MAXIMUM_ALIGNOF) != nbytes)
+			elog(ERROR, "failed on pread(2): %m");
+		offset += nbytes;
+	}
+	kds->nitems = nitems;
+	Assert(offset <= kds->length);
+}
+
 /*
  * pgstrom_ccache_load_chunk
  */
@@ -366,14 +1198,18 @@ pgstrom_data_store *
 pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 						  GpuContext *gcontext,
 						  Relation relation,
-						  Relids ccache_refs)
+						  Relids ccache_refs,
+						  BlockNumber **p_delta_blocks,
+						  cl_uint *p_delta_nblocks)
 {
 	TupleDesc	tupdesc = RelationGetDescr(relation);
+	bits8		dirty_map[CCACHE_CHUNK_NBLOCKS / BITS_PER_BYTE];
+	cl_uint		ndirty;
+	BlockNumber *delta_blocks = NULL;
 	int			i, ncols;
 	int			fdesc = -1;
 	ssize_t		nitems;
 	ssize_t		length;
-	ssize_t		offset;
 	CUdeviceptr	m_deviceptr;
 	CUresult	rc;
 	char		buffer[MAXPGPATH];
@@ -402,19 +1238,7 @@ pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 			elog(ERROR, "failed on pread(2): %m");
 		nitems = kds_head->nitems;
 		/* count length of the PDS_column */
-		for (i = bms_next_member(ccache_refs, -1);
-			 i >= 0;
-			 i = bms_next_member(ccache_refs, i))
-		{
-			kern_colmeta   *cmeta = &kds_head->colmeta[i];
-
-			length += cmeta->extra_sz * MAXIMUM_ALIGNOF;
-			if (cmeta->attlen > 0)
-				length += MAXALIGN(TYPEALIGN(cmeta->attalign,
-											 cmeta->attlen) * nitems);
-			else
-				length += MAXALIGN(sizeof(cl_uint) * nitems);
-		}
+		length = ccache_decoded_length(kds_head, ccache_refs);
 		/* allocation of pds_column buffer */
 		rc = gpuMemAllocManaged(gcontext,
 								&m_deviceptr,
@@ -432,40 +1256,32 @@ pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 		init_kernel_data_store(&pds->kds, tupdesc, length,
 							   KDS_FORMAT_COLUMN, nitems);
 		/* load from the ccache file */
-		offset = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
-		for (i = bms_next_member(ccache_refs, -1);
-			 i >= 0;
-			 i = bms_next_member(ccache_refs, i))
-		{
-			kern_colmeta   *cmeta = &kds_head->colmeta[i];
-			size_t			nbytes;
-
-			Assert(pds->kds.colmeta[i].attbyval  == cmeta->attbyval &&
-				   pds->kds.colmeta[i].attalign  == cmeta->attalign &&
-				   pds->kds.colmeta[i].attlen    == cmeta->attlen &&
-				   pds->kds.colmeta[i].attnum    == cmeta->attnum &&
-				   pds->kds.colmeta[i].atttypid  == cmeta->atttypid &&
-				   pds->kds.colmeta[i].atttypmod == cmeta->atttypmod);
-			Assert(offset == MAXALIGN(offset));
-			pds->kds.colmeta[i].va_offset = offset / MAXIMUM_ALIGNOF;
-			pds->kds.colmeta[i].extra_sz = cmeta->extra_sz;
-
-			nbytes = cmeta->extra_sz * MAXIMUM_ALIGNOF;
-			if (cmeta->attlen > 0)
-				nbytes += MAXALIGN(TYPEALIGN(cmeta->attalign,
-											 cmeta->attlen) * nitems);
-			else
-				nbytes += MAXALIGN(sizeof(cl_uint) * nitems);
+		ccache_decode_columns(fdesc, kds_head, ccache_refs, &pds->kds);
 
-			if (pread(fdesc,
-					  (char *)&pds->kds + offset,
-					  nbytes,
-					  cmeta->va_offset * MAXIMUM_ALIGNOF) != nbytes)
-				elog(ERROR, "failed on pread(2): %m");
-			offset += nbytes;
+		/*
+		 * Rows on the dirty blocks are removed from the PDS, then caller
+		 * shall read these blocks from the heap.
+		 */
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		ndirty = cc_chunk->ndirty;
+		if (ndirty > 0)
+			memcpy(dirty_map, cc_chunk->dirty_map, sizeof(dirty_map));
+		SpinLockRelease(&ccache_state->chunks_lock);
+		if (ndirty > 0)
+		{
+			cl_uint		k = 0;
+
+			ccache_remove_dirty_rows(pds, kds_head, fdesc, ccache_refs,
+									 cc_chunk->block_nr, dirty_map);
+			delta_blocks = palloc(sizeof(BlockNumber) * ndirty);
+			for (i=0; i < CCACHE_CHUNK_NBLOCKS; i++)
+			{
+				if ((dirty_map[i / BITS_PER_BYTE] &
+					 (1 << (i % BITS_PER_BYTE))) != 0)
+					delta_blocks[k++] = cc_chunk->block_nr + i;
+			}
+			Assert(k == ndirty);
 		}
-		pds->kds.nitems = nitems;
-		Assert(offset == length);
 	}
 	PG_CATCH();
 	{
@@ -477,9 +1293,131 @@ pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 	if ((char *)kds_head != buffer)
 		pfree(kds_head);
 
+	*p_delta_blocks = delta_blocks;
+	*p_delta_nblocks = ndirty;
+
 	return pds;
 }
 
+/*
+ * pgstrom_ccache_open_device_image
+ *
+ * It opens the device tier image of the chunk, if any, for GPU kernels to
+ * run on the image in place. The PDS returned has only the header portion
+ * of the KDS like gstore_fdw_open_data_store(), so caller has to copy back
+ * the entire image from *p_m_kds on CPU fallback. It returns NULL, if the
+ * chunk is on the host tier only, or has dirty blocks.
+ * The chunk is pinned until release of the resource owner of GpuContext,
+ * not to be demoted while GPU kernels are running on the image.
+ */
+pgstrom_data_store *
+pgstrom_ccache_open_device_image(ccacheChunk *cc_chunk,
+								 GpuContext *gcontext,
+								 CUdeviceptr *p_m_kds)
+{
+	ccacheDevicePin *pin;
+	CUipcMemHandle m_handle;
+	CUdeviceptr	m_kds;
+	CUdeviceptr	m_deviceptr;
+	CUresult	rc;
+	size_t		head_sz;
+	pgstrom_data_store *pds;
+
+	if (ccache_device_tier_size == 0)
+		return NULL;
+	pin = MemoryContextAllocZero(TopMemoryContext,
+								 sizeof(ccacheDevicePin));
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	if (cc_chunk->dev_length == 0 ||
+		cc_chunk->dev_in_progress ||
+		cc_chunk->ndirty > 0)
+	{
+		SpinLockRelease(&ccache_state->chunks_lock);
+		pfree(pin);
+		return NULL;
+	}
+	memcpy(&m_handle, &cc_chunk->dev_handle, sizeof(CUipcMemHandle));
+	cc_chunk->refcnt++;
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	pin->resowner = gcontext->resowner;
+	pin->cc_chunk = cc_chunk;
+	dlist_push_tail(&ccache_device_pins, &pin->chain);
+
+	rc = gpuIpcOpenMemHandle(gcontext,
+							 &m_kds,
+							 m_handle,
+							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+	{
+		/* e.g, no peer access to the device; use the host tier */
+		elog(DEBUG2, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+		dlist_delete(&pin->chain);
+		pfree(pin);
+		pgstrom_ccache_put_chunk(cc_chunk);
+		return NULL;
+	}
+
+	head_sz = STROMALIGN(offsetof(kern_data_store,
+								  colmeta[cc_chunk->nattrs +
+										  NumOfSystemAttrs]));
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store, kds) + head_sz,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	pds = (pgstrom_data_store *) m_deviceptr;
+	memset(&pds->chain, 0, sizeof(dlist_node));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = -1;
+
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	rc = cuMemcpyDtoH(&pds->kds, m_kds, head_sz);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	Assert(pds->kds.format == KDS_FORMAT_COLUMN);
+
+	*p_m_kds = m_kds;
+	return pds;
+}
+
+/*
+ * ccache_device_pins_cleanup_callback
+ *
+ * It unpins the device images at release of the resource owner. IPC handles
+ * are already closed by the release of GpuContext at BEFORE_LOCKS phase.
+ */
+static void
+ccache_device_pins_cleanup_callback(ResourceReleasePhase phase,
+									bool isCommit,
+									bool isTopLevel,
+									void *arg)
+{
+	dlist_mutable_iter iter;
+
+	if (phase != RESOURCE_RELEASE_AFTER_LOCKS)
+		return;
+
+	dlist_foreach_modify(iter, &ccache_device_pins)
+	{
+		ccacheDevicePin *pin = dlist_container(ccacheDevicePin,
+											   chain, iter.cur);
+		if (pin->resowner != CurrentResourceOwner)
+			continue;
+		dlist_delete(&pin->chain);
+		pgstrom_ccache_put_chunk(pin->cc_chunk);
+		pfree(pin);
+	}
+}
+
 /*
  * ccache_invalidator_oid - returns OID of invalidator trigger function
  */
@@ -851,6 +1789,60 @@ RelationCanUseColumnarCache(Relation relation)
 			has_stmt_truncate);
 }
 
+/*
+ * ccache_invalidate_block
+ *
+ * It marks the block on the ccache chunk dirty, if any. Once number of the
+ * dirty blocks exceeds pg_strom.ccache_max_dirty_blocks, or the chunk is not
+ * constructed yet, the chunk is dropped.
+ */
+static void
+ccache_invalidate_block(Relation rel, BlockNumber block_nr)
+{
+	BlockNumber	chunk_nr = (block_nr & ~(CCACHE_CHUNK_NBLOCKS - 1));
+	cl_uint		k = block_nr - chunk_nr;
+	pg_crc32	hash;
+	int			index;
+	dlist_iter	iter;
+
+	hash = ccache_compute_hashvalue(MyDatabaseId,
+									RelationGetRelid(rel),
+									chunk_nr);
+	index = hash % ccache_num_slots;
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->active_slots[index])
+	{
+		ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+											   hash_chain,
+											   iter.cur);
+		if (cc_temp->hash == hash &&
+			cc_temp->database_oid == MyDatabaseId &&
+			cc_temp->table_oid == RelationGetRelid(rel) &&
+			cc_temp->block_nr == chunk_nr)
+		{
+			if ((cc_temp->dirty_map[k / BITS_PER_BYTE] &
+				 (1 << (k % BITS_PER_BYTE))) != 0)
+				break;		/* already dirty */
+			if (CCACHE_CTIME_IS_READY(cc_temp->ctime) &&
+				cc_temp->ndirty < ccache_max_dirty_blocks)
+			{
+				cc_temp->dirty_map[k / BITS_PER_BYTE]
+					|= (1 << (k % BITS_PER_BYTE));
+				cc_temp->ndirty++;
+				break;
+			}
+			dlist_delete(&cc_temp->hash_chain);
+			memset(&cc_temp->hash_chain, 0, sizeof(dlist_node));
+			ccache_put_chunk_nolock(cc_temp);
+			elog(BUILDER_LOG,
+				 "ccache: relation %s, block %u invalidation",
+				 RelationGetRelationName(rel), chunk_nr);
+			break;
+		}
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+}
+
 /*
  * pgstrom_ccache_invalidator
  */
@@ -870,55 +1862,35 @@ pgstrom_ccache_invalidator(PG_FUNCTION_ARGS)
 		HeapTuple	tuple = trigdata->tg_trigtuple;
 		BlockNumber	block_nr;
 		BlockNumber	block_nr_last;
-		pg_crc32	hash;
-		int			index;
-		dlist_iter	iter;
 
 		if (!TRIGGER_FIRED_BY_INSERT(trigdata->tg_event) &&
 			!TRIGGER_FIRED_BY_DELETE(trigdata->tg_event) &&
 			!TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
-			elog(ERROR, "%s: triggered by unknown event", __FUNCTION__);
-
-		block_nr_last = DatumGetInt32(flinfo->fn_extra);
-		block_nr = BlockIdGetBlockNumber(&tuple->t_self.ip_blkid);
-		block_nr &= ~(CCACHE_CHUNK_NBLOCKS - 1);
-		if ((block_nr_last & ~(CCACHE_CHUNK_NBLOCKS - 1)) != 0)
-		{
-			block_nr_last &= ~(CCACHE_CHUNK_NBLOCKS - 1);
-			if (block_nr == block_nr_last)
-				PG_RETURN_VOID();
-		}
-		hash = ccache_compute_hashvalue(MyDatabaseId,
-										RelationGetRelid(rel),
-										block_nr);
-		index = hash % ccache_num_slots;
-		SpinLockAcquire(&ccache_state->chunks_lock);
-		dlist_foreach(iter, &ccache_state->active_slots[index])
-		{
-			ccacheChunk *cc_temp = dlist_container(ccacheChunk,
-												   hash_chain,
-												   iter.cur);
-			if (cc_temp->hash == hash &&
-				cc_temp->database_oid == MyDatabaseId &&
-				cc_temp->table_oid == RelationGetRelid(rel) &&
-				cc_temp->block_nr == block_nr)
-			{
-				dlist_delete(&cc_temp->hash_chain);
-				memset(&cc_temp->hash_chain, 0, sizeof(dlist_node));
-				ccache_put_chunk_nolock(cc_temp);
-				elog(BUILDER_LOG,
-					 "ccache: relation %s, block %u invalidation",
-					 RelationGetRelationName(rel), block_nr);
-				break;
-			}
-		}
-		SpinLockRelease(&ccache_state->chunks_lock);
+			elog(ERROR, "%s: triggered by unknown event", __FUNCTION__);
 
 		/*
-		 * Several least bits of @block_nr should be always zero.
-		 * So, we use the least bit as a mark of valid @block_nr_last.
+		 * @fn_extra keeps the last block number + 1 already invalidated,
+		 * to avoid spinlock contention on bulk modification.
 		 */
-		flinfo->fn_extra = DatumGetPointer((Datum)(block_nr + 1));
+		block_nr_last = (BlockNumber)((Datum)flinfo->fn_extra);
+		block_nr = BlockIdGetBlockNumber(&tuple->t_self.ip_blkid);
+		if (block_nr_last != block_nr + 1)
+		{
+			ccache_invalidate_block(rel, block_nr);
+			flinfo->fn_extra = DatumGetPointer((Datum)(block_nr + 1));
+		}
+		/* new version of the tuple may be put on the other block */
+		if (TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event) &&
+			trigdata->tg_newtuple)
+		{
+			tuple = trigdata->tg_newtuple;
+			block_nr = BlockIdGetBlockNumber(&tuple->t_self.ip_blkid);
+			if (block_nr + 1 != (BlockNumber)((Datum)flinfo->fn_extra))
+			{
+				ccache_invalidate_block(rel, block_nr);
+				flinfo->fn_extra = DatumGetPointer((Datum)(block_nr + 1));
+			}
+		}
 	}
 	else
 	{
@@ -967,8 +1939,8 @@ pgstrom_ccache_info(PG_FUNCTION_ARGS)
 	ccacheChunk	   *cc_chunk;
 	List		   *cc_chunks_list = NIL;
 	HeapTuple		tuple;
-	bool			isnull[7];
-	Datum			values[7];
+	bool			isnull[9];
+	Datum			values[9];
 
 	if (SRF_IS_FIRSTCALL())
 	{
@@ -980,7 +1952,7 @@ pgstrom_ccache_info(PG_FUNCTION_ARGS)
 		fncxt = SRF_FIRSTCALL_INIT();
 		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
 
-		tupdesc = CreateTemplateTupleDesc(7, false);
+		tupdesc = CreateTemplateTupleDesc(9, false);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "database_id",
 						   OIDOID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "table_id",
@@ -995,6 +1967,10 @@ pgstrom_ccache_info(PG_FUNCTION_ARGS)
 						   TIMESTAMPTZOID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "atime",
 						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 8, "nrefs",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 9, "gpu_device",
+						   INT4OID, -1, 0);
 		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
 		/* collect current cache state */
 		SpinLockAcquire(&ccache_state->chunks_lock);
@@ -1041,6 +2017,11 @@ pgstrom_ccache_info(PG_FUNCTION_ARGS)
 	values[4] = Int64GetDatum(cc_chunk->length);
 	values[5] = TimestampTzGetDatum(cc_chunk->ctime);
 	values[6] = TimestampTzGetDatum(cc_chunk->atime);
+	values[7] = Int64GetDatum(cc_chunk->nrefs);
+	if (cc_chunk->dev_length > 0 && !cc_chunk->dev_in_progress)
+		values[8] = Int32GetDatum(devAttrs[cc_chunk->dev_dindex].DEV_ID);
+	else
+		isnull[8] = true;
 
 	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
 
@@ -1146,6 +2127,95 @@ pgstrom_ccache_builder_info(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_ccache_builder_info);
 
+/*
+ * pgstrom_ccache_prewarm_info
+ */
+Datum
+pgstrom_ccache_prewarm_info(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	ccachePrewarm *pw;
+	List	   *prewarms_list = NIL;
+	Datum		values[7];
+	bool		isnull[7];
+	HeapTuple	tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		int				i;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(7, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "database_id",
+						   OIDOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "table_id",
+						   REGCLASSOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "nchunks",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "nprocessed",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "nloaded",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "start_time",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "end_time",
+						   TIMESTAMPTZOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		/* collect current prewarm requests */
+		SpinLockAcquire(&ccache_state->lock);
+		PG_TRY();
+		{
+			for (i=0; i < CCACHE_MAX_NUM_PREWARMS; i++)
+			{
+				if (!OidIsValid(ccache_state->prewarms[i].database_oid))
+					continue;
+				pw = palloc(sizeof(ccachePrewarm));
+				memcpy(pw, &ccache_state->prewarms[i],
+					   sizeof(ccachePrewarm));
+				prewarms_list = lappend(prewarms_list, pw);
+			}
+		}
+		PG_CATCH();
+		{
+			SpinLockRelease(&ccache_state->lock);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		SpinLockRelease(&ccache_state->lock);
+
+		fncxt->user_fctx = prewarms_list;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	prewarms_list = fncxt->user_fctx;
+
+	if (prewarms_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	pw = linitial(prewarms_list);
+	fncxt->user_fctx = list_delete_ptr(prewarms_list, pw);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = ObjectIdGetDatum(pw->database_oid);
+	values[1] = ObjectIdGetDatum(pw->table_oid);
+	values[2] = Int32GetDatum(pw->nchunks);
+	values[3] = Int32GetDatum(pw->nprocessed);
+	values[4] = Int32GetDatum(pw->nloaded);
+	values[5] = TimestampTzGetDatum(pw->start_time);
+	if (pw->end_time != 0)
+		values[6] = TimestampTzGetDatum(pw->end_time);
+	else
+		isnull[6] = true;
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_ccache_prewarm_info);
+
 /*
  * ccache_builder_sigterm
  */
@@ -1832,99 +2902,250 @@ ccache_copy_buffer_to_kds(kern_data_store *kds,
 }
 
 /*
- * pgstrom_ccache_extract_row
+ * ccache_encode_kds_column
+ *
+ * It applies frame-of-reference and bit-packing encoding on the fixed-length
+ * integer columns of the KDS_FORMAT_COLUMN, then compacts the KDS in-place.
+ * It returns the new length of the KDS. Note that the encoded KDS is valid
+ * only on the ccache file.
  */
-void
-ccache_buffer_append_row(TupleDesc tupdesc,
-						 ccacheBuffer *cc_buf,
-						 HeapTuple tup,		/* only for system columns */
-						 bool *tup_isnull,
-						 Datum *tup_values,
-						 MemoryContext memcxt)
+static size_t
+ccache_encode_kds_column(kern_data_store *kds)
 {
-	MemoryContext oldcxt = MemoryContextSwitchTo(memcxt);
-	size_t		nitems;
+	size_t		nitems = kds->nitems;
+	size_t		offset;
+	char	   *pos;
+	char	   *temp = NULL;
 	int			j;
 
-	if (cc_buf->nitems >= cc_buf->nrooms)
-		elog(ERROR, "lack of ccache buffer rooms");
+	pos = (char *)kds + STROMALIGN(offsetof(kern_data_store,
+											colmeta[kds->ncols]));
+	for (j=0; j < kds->ncols; j++)
+	{
+		kern_colmeta *cmeta = &kds->colmeta[j];
+		ccacheEncodeHeader *ehead;
+		char	   *addr;
+		bits8	   *nullmap = NULL;
+		size_t		unitsz;
+		size_t		nbytes;
+		size_t		raw_nbytes;
+		size_t		i, bitpos;
+		cl_long		min_value = LONG_MAX;
+		cl_long		max_value = LONG_MIN;
+		cl_ulong	delta;
+		cl_ulong   *packed;
+		int			nbits;
+
+		if (cmeta->va_offset == 0)
+			continue;
+		addr = (char *)kds + cmeta->va_offset * MAXIMUM_ALIGNOF;
+		offset = pos - (char *)kds;
+		Assert(addr >= pos);
+		if (cmeta->attlen < 0)
+		{
+			/* varlena is already deduplicated by vl_dict */
+			nbytes = (MAXALIGN(sizeof(cl_uint) * nitems) +
+					  cmeta->extra_sz * MAXIMUM_ALIGNOF);
+			goto no_encode;
+		}
+		unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+		nbytes = (MAXALIGN(unitsz * nitems) +
+				  cmeta->extra_sz * MAXIMUM_ALIGNOF);
+		if (!ccache_compression || nitems == 0 || !cmeta->attbyval ||
+			(cmeta->attlen != sizeof(cl_short) &&
+			 cmeta->attlen != sizeof(cl_int) &&
+			 cmeta->attlen != sizeof(cl_long)))
+			goto no_encode;
+		if (cmeta->extra_sz > 0)
+			nullmap = (bits8 *)(addr + MAXALIGN(unitsz * nitems));
+
+		/* check range of the values */
+		for (i=0; i < nitems; i++)
+		{
+			cl_long		value;
+
+			if (nullmap && att_isnull(i, nullmap))
+				continue;
+			if (cmeta->attlen == sizeof(cl_short))
+				value = ((cl_short *)addr)[i];
+			else if (cmeta->attlen == sizeof(cl_int))
+				value = ((cl_int *)addr)[i];
+			else
+				value = ((cl_long *)addr)[i];
+			min_value = Min(min_value, value);
+			max_value = Max(max_value, value);
+		}
+		if (min_value > max_value)
+			min_value = max_value = 0;	/* all-null */
+		delta = (cl_ulong)max_value - (cl_ulong)min_value;
+		nbits = (delta == 0 ? 0 : 64 - __builtin_clzl(delta));
+		/* encoding makes sense only if it saves 1/4 of values at least */
+		if (4 * (size_t)nbits >= 3 * BITS_PER_BYTE * cmeta->attlen)
+			goto no_encode;
+
+		/* encode values on the temporary buffer */
+		raw_nbytes = nbytes;
+		nbytes = (MAXALIGN(sizeof(ccacheEncodeHeader)) +
+				  CCACHE_ENCODE_PACKED_LENGTH(nbits, nitems) +
+				  (nullmap ? MAXALIGN(BITMAPLEN(nitems)) : 0));
+		if (nbytes >= raw_nbytes)
+		{
+			nbytes = raw_nbytes;
+			goto no_encode;
+		}
+		if (!temp)
+			temp = palloc_huge(MAXALIGN(sizeof(ccacheEncodeHeader)) +
+							   MAXALIGN(sizeof(cl_long) * nitems) +
+							   MAXALIGN(BITMAPLEN(nitems)));
+		memset(temp, 0, nbytes);
+		ehead = (ccacheEncodeHeader *)temp;
+		ehead->base = min_value;
+		ehead->nbits = nbits;
+		ehead->hasnull = (nullmap != NULL);
+		packed = (cl_ulong *)(temp + MAXALIGN(sizeof(ccacheEncodeHeader)));
+		for (i=0, bitpos=0; nbits > 0 && i < nitems; i++, bitpos += nbits)
+		{
+			cl_ulong	value;
+			cl_uint		shift = bitpos % 64;
+
+			if (nullmap && att_isnull(i, nullmap))
+				continue;
+			if (cmeta->attlen == sizeof(cl_short))
+				value = (cl_long)((cl_short *)addr)[i];
+			else if (cmeta->attlen == sizeof(cl_int))
+				value = (cl_long)((cl_int *)addr)[i];
+			else
+				value = ((cl_long *)addr)[i];
+			value -= (cl_ulong)min_value;
+
+			packed[bitpos / 64] |= (value << shift);
+			if (shift + nbits > 64)
+				packed[bitpos / 64 + 1] |= (value >> (64 - shift));
+		}
+		if (nullmap)
+			memcpy((char *)packed + CCACHE_ENCODE_PACKED_LENGTH(nbits, nitems),
+				   nullmap, MAXALIGN(BITMAPLEN(nitems)));
+		memcpy(pos, temp, nbytes);
+		cmeta->attcacheoff = CCACHE_ENCODE__FOR_BITPACK;
+		cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
+		cmeta->extra_sz = nbytes / MAXIMUM_ALIGNOF;
+		pos += nbytes;
+		continue;
+
+	no_encode:
+		if (addr != pos)
+			memmove(pos, addr, nbytes);
+		cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
+		pos += nbytes;
+	}
+	if (temp)
+		pfree(temp);
+	kds->length = (pos - (char *)kds);
+
+	return kds->length;
+}
+
+/*
+ * __ccache_buffer_append_varlena
+ *
+ * It puts a variable-length datum on the dictionary of the column, then
+ * saves the reference to the dictionary entry. It allocates the memory on
+ * the CurrentMemoryContext, so it is not thread-safe.
+ */
+static void
+__ccache_buffer_append_varlena(ccacheBuffer *cc_buf,
+							   Form_pg_attribute attr, int j,
+							   size_t nitems, bool isnull, Datum datum)
+{
+	vl_dict_key *entry = NULL;
+
+	if (!isnull)
+	{
+		struct varlena *vl;
+		vl_dict_key key;
+		bool		found;
+		size_t		usage;
+
+		vl = vl_datum_compression(DatumGetPointer(datum),
+								  cc_buf->vl_compress[j]);
+		key.offset = 0;
+		key.vl_datum = vl;
+		entry = hash_search(cc_buf->vl_dict[j],
+							&key,
+							HASH_ENTER,
+							&found);
+		if (!found)
+		{
+			entry->offset = 0;
+			if (PointerGetDatum(vl) == datum)
+			{
+				size_t		len = VARSIZE_ANY(datum);
+
+				vl = (struct varlena *) palloc(len);
+				memcpy(vl, DatumGetPointer(datum), len);
+			}
+			entry->vl_datum = vl;
+			cc_buf->extra_sz[j] += MAXALIGN(VARSIZE_ANY(vl));
+			Assert(CurrentMemoryContext == GetMemoryChunkContext(vl));
+
+			usage = (MAXALIGN(sizeof(cl_uint) * nitems) +
+					 cc_buf->extra_sz[j]);
+			if (usage >= (size_t)UINT_MAX * MAXIMUM_ALIGNOF)
+				elog(ERROR, "attribute \"%s\" consumed too much",
+					 NameStr(attr->attname));
+		}
+	}
+	((vl_dict_key **)cc_buf->values[j])[nitems] = entry;
+}
+
+/*
+ * __ccache_buffer_append_fixed
+ *
+ * It puts the fixed-length and system columns of a row. It never allocates
+ * memory nor raises an error, so the worker threads of the chunk build can
+ * call it concurrently, as long as every thread works on the distinct range
+ * of rows aligned to the byte boundary of the NULL-bitmap.
+ */
+static void
+__ccache_buffer_append_fixed(TupleDesc tupdesc,
+							 ccacheBuffer *cc_buf,
+							 HeapTuple tup,		/* only for system columns */
+							 bool *tup_isnull,
+							 Datum *tup_values,
+							 bool *hasnull,
+							 size_t nitems)
+{
+	int			j;
 
-	nitems = cc_buf->nitems;
 	for (j=0; j < tupdesc->natts; j++)
 	{
 		Form_pg_attribute attr = tupdesc->attrs[j];
 		bool	isnull = tup_isnull[j];
 		Datum	datum = tup_values[j];
+		bits8  *nullmap = cc_buf->nullmap[j];
+		char   *base = cc_buf->values[j];
 
-		if (attr->attisdropped)
+		if (attr->attisdropped || attr->attlen < 0)
 			continue;
 
-		if (attr->attlen < 0)
+		if (isnull)
 		{
-			vl_dict_key *entry = NULL;
-
-			if (!isnull)
-			{
-				struct varlena *vl;
-				vl_dict_key key;
-				bool		found;
-				size_t		usage;
-
-				vl = vl_datum_compression(DatumGetPointer(datum),
-										  cc_buf->vl_compress[j]);
-				key.offset = 0;
-				key.vl_datum = vl;
-				entry = hash_search(cc_buf->vl_dict[j],
-									&key,
-									HASH_ENTER,
-									&found);
-				if (!found)
-				{
-					entry->offset = 0;
-					if (PointerGetDatum(vl) == datum)
-					{
-						size_t		len = VARSIZE_ANY(datum);
-
-						vl = (struct varlena *) palloc(len);
-						memcpy(vl, DatumGetPointer(datum), len);
-					}
-					entry->vl_datum = vl;
-					cc_buf->extra_sz[j] += MAXALIGN(VARSIZE_ANY(vl));
-					Assert(memcxt == GetMemoryChunkContext(vl));
-
-					usage = (MAXALIGN(sizeof(cl_uint) * nitems) +
-							 cc_buf->extra_sz[j]);
-					if (usage >= (size_t)UINT_MAX * MAXIMUM_ALIGNOF)
-						elog(ERROR, "attribute \"%s\" consumed too much",
-							 NameStr(attr->attname));
-				}
-			}
-			((vl_dict_key **)cc_buf->values[j])[nitems] = entry;
+			hasnull[j] = true;
+			nullmap[nitems >> 3] &= ~(1 << (nitems & 7));
+		}
+		else if (!attr->attbyval)
+		{
+			nullmap[nitems >> 3] |= (1 << (nitems & 7));
+			base += att_align_nominal(attr->attlen,
+									  attr->attalign) * nitems;
+			memcpy(base, DatumGetPointer(datum), attr->attlen);
 		}
 		else
 		{
-			bits8  *nullmap = cc_buf->nullmap[j];
-			char   *base = cc_buf->values[j];
-
-			if (isnull)
-			{
-				cc_buf->hasnull[j] = true;
-				nullmap[nitems >> 3] &= ~(1 << (nitems & 7));
-			}
-			else if (!attr->attbyval)
-			{
-				nullmap[nitems >> 3] |= (1 << (nitems & 7));
-				base += att_align_nominal(attr->attlen,
-										  attr->attalign) * nitems;
-				memcpy(base, DatumGetPointer(datum), attr->attlen);
-			}
-			else
-			{
-				nullmap[nitems >> 3] |= (1 << (nitems & 7));
-				base += att_align_nominal(attr->attlen,
-										  attr->attalign) * nitems;
-				memcpy(base, &datum, attr->attlen);
-			}
+			nullmap[nitems >> 3] |= (1 << (nitems & 7));
+			base += att_align_nominal(attr->attlen,
+									  attr->attalign) * nitems;
+			memcpy(base, &datum, attr->attlen);
 		}
 	}
 
@@ -1971,6 +3192,39 @@ ccache_buffer_append_row(TupleDesc tupdesc,
 			}
 		}
 	}
+}
+
+/*
+ * pgstrom_ccache_extract_row
+ */
+void
+ccache_buffer_append_row(TupleDesc tupdesc,
+						 ccacheBuffer *cc_buf,
+						 HeapTuple tup,		/* only for system columns */
+						 bool *tup_isnull,
+						 Datum *tup_values,
+						 MemoryContext memcxt)
+{
+	MemoryContext oldcxt = MemoryContextSwitchTo(memcxt);
+	size_t		nitems;
+	int			j;
+
+	if (cc_buf->nitems >= cc_buf->nrooms)
+		elog(ERROR, "lack of ccache buffer rooms");
+
+	nitems = cc_buf->nitems;
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+
+		if (attr->attisdropped || attr->attlen >= 0)
+			continue;
+		__ccache_buffer_append_varlena(cc_buf, attr, j, nitems,
+									   tup_isnull[j], tup_values[j]);
+	}
+	__ccache_buffer_append_fixed(tupdesc, cc_buf, tup,
+								 tup_isnull, tup_values,
+								 cc_buf->hasnull, nitems);
 	MemoryContextSwitchTo(oldcxt);
 }
 
@@ -1981,6 +3235,188 @@ static MemoryContext	PerChunkMemoryContext;
 static char			   *PerChunkLoadBuffer;
 static Buffer			VisibilityMapBuffer = InvalidBuffer;
 
+/*
+ * Parallel build of a ccache chunk
+ *
+ * Once all the blocks of the chunk are copied to PerChunkLoadBuffer, rows
+ * are split into pg_strom.ccache_builder_threads ranges, then the worker
+ * threads deform the tuples and fill up the fixed-length and system columns
+ * concurrently; these steps neither allocate memory nor raise errors.
+ * Variable-length datum is saved as a reference to PerChunkLoadBuffer, then
+ * put on the dictionary by the caller, because dynahash and pglz are not
+ * thread-safe.
+ */
+#define CCACHE_BUILDER_MAX_THREADS		64
+#define CCACHE_BUILDER_MIN_ROWS			8192	/* per thread */
+
+typedef struct
+{
+	TupleDesc	tupdesc;
+	ccacheBuffer *cc_buf;
+	Oid			table_oid;
+	BlockNumber	block_nr;
+	ItemPointerData *tup_ctids;	/* location of the rows */
+	Datum	  **vl_datums;		/* raw varlena datum, or 0 if NULL */
+	size_t		row_start;
+	size_t		row_end;
+	bool	   *hasnull;		/* per-thread array */
+	Datum	   *tup_values;		/* per-thread array */
+	bool	   *tup_isnull;		/* per-thread array */
+} ccacheBuilderThread;
+
+static void *
+ccache_builder_thread_main(void *__arg)
+{
+	ccacheBuilderThread *cbt = __arg;
+	TupleDesc	tupdesc = cbt->tupdesc;
+	size_t		row;
+	int			j;
+
+	for (row = cbt->row_start; row < cbt->row_end; row++)
+	{
+		ItemPointer	ctid = &cbt->tup_ctids[row];
+		BlockNumber	i = ItemPointerGetBlockNumber(ctid) - cbt->block_nr;
+		Page		page = (Page)(PerChunkLoadBuffer + BLCKSZ * i);
+		ItemId		lpp = PageGetItemId(page, ItemPointerGetOffsetNumber(ctid));
+		HeapTupleData tup;
+
+		tup.t_tableOid = cbt->table_oid;
+		tup.t_data = (HeapTupleHeader) PageGetItem(page, lpp);
+		tup.t_len = ItemIdGetLength(lpp);
+		tup.t_self = *ctid;
+
+		heap_deform_tuple(&tup, tupdesc, cbt->tup_values, cbt->tup_isnull);
+		for (j=0; j < tupdesc->natts; j++)
+		{
+			if (cbt->vl_datums[j])
+				cbt->vl_datums[j][row] = (cbt->tup_isnull[j]
+										  ? (Datum) 0
+										  : cbt->tup_values[j]);
+		}
+		__ccache_buffer_append_fixed(tupdesc, cbt->cc_buf, &tup,
+									 cbt->tup_isnull, cbt->tup_values,
+									 cbt->hasnull, row);
+	}
+	return NULL;
+}
+
+/*
+ * ccache_buffer_append_rows_parallel
+ */
+static void
+ccache_buffer_append_rows_parallel(Relation relation,
+								   BlockNumber block_nr,
+								   ccacheBuffer *cc_buf,
+								   ItemPointerData *tup_ctids,
+								   size_t nitems)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	ccacheBuilderThread *threads;
+	pthread_t  *thread_ids;
+	bool	   *thread_valid;
+	Datum	  **vl_datums;
+	size_t		unitsz;
+	int			nthreads;
+	int			i, j;
+
+	Assert(nitems <= cc_buf->nrooms);
+	nthreads = Min(ccache_builder_nthreads,
+				   (nitems + CCACHE_BUILDER_MIN_ROWS - 1) /
+				   CCACHE_BUILDER_MIN_ROWS);
+	nthreads = Max(nthreads, 1);
+	/* rows per thread shall be aligned to the byte of NULL-bitmap */
+	unitsz = TYPEALIGN(BITS_PER_BYTE, (nitems + nthreads - 1) / nthreads);
+
+	vl_datums = palloc0(sizeof(Datum *) * tupdesc->natts);
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+
+		if (!attr->attisdropped && attr->attlen < 0)
+			vl_datums[j] = palloc_huge(sizeof(Datum) * Max(nitems, 1));
+	}
+	threads = palloc0(sizeof(ccacheBuilderThread) * nthreads);
+	thread_ids = palloc0(sizeof(pthread_t) * nthreads);
+	thread_valid = palloc0(sizeof(bool) * nthreads);
+	for (i=0; i < nthreads; i++)
+	{
+		ccacheBuilderThread *cbt = &threads[i];
+
+		cbt->tupdesc = tupdesc;
+		cbt->cc_buf = cc_buf;
+		cbt->table_oid = RelationGetRelid(relation);
+		cbt->block_nr = block_nr;
+		cbt->tup_ctids = tup_ctids;
+		cbt->vl_datums = vl_datums;
+		cbt->row_start = Min(unitsz * i, nitems);
+		cbt->row_end = Min(unitsz * (i+1), nitems);
+		cbt->hasnull = palloc0(sizeof(bool) * cc_buf->nattrs);
+		cbt->tup_values = palloc(sizeof(Datum) * tupdesc->natts);
+		cbt->tup_isnull = palloc(sizeof(bool) * tupdesc->natts);
+	}
+
+	/*
+	 * The first range is processed by the builder itself. If we cannot
+	 * launch a worker thread, its range is also processed by the builder,
+	 * because we must not raise an error while other threads are running.
+	 */
+	for (i=1; i < nthreads; i++)
+	{
+		if (pthread_create(&thread_ids[i], NULL,
+						   ccache_builder_thread_main,
+						   &threads[i]) == 0)
+			thread_valid[i] = true;
+	}
+	ccache_builder_thread_main(&threads[0]);
+	for (i=1; i < nthreads; i++)
+	{
+		if (!thread_valid[i])
+			ccache_builder_thread_main(&threads[i]);
+	}
+	for (i=1; i < nthreads; i++)
+	{
+		if (thread_valid[i] && (errno = pthread_join(thread_ids[i], NULL)) != 0)
+			elog(FATAL, "failed on pthread_join: %m");
+	}
+	/* merge the NULL-flags */
+	for (i=0; i < nthreads; i++)
+	{
+		for (j=0; j < cc_buf->nattrs; j++)
+			cc_buf->hasnull[j] |= threads[i].hasnull[j];
+	}
+
+	/* variable-length columns are put on the dictionary serially */
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		size_t		row;
+
+		if (!vl_datums[j])
+			continue;
+		CHECK_FOR_INTERRUPTS();
+		for (row=0; row < nitems; row++)
+		{
+			Datum	datum = vl_datums[j][row];
+
+			__ccache_buffer_append_varlena(cc_buf, attr, j, row,
+										   datum == (Datum) 0, datum);
+		}
+		pfree(vl_datums[j]);
+	}
+	cc_buf->nitems = nitems;
+
+	for (i=0; i < nthreads; i++)
+	{
+		pfree(threads[i].hasnull);
+		pfree(threads[i].tup_values);
+		pfree(threads[i].tup_isnull);
+	}
+	pfree(thread_valid);
+	pfree(thread_ids);
+	pfree(threads);
+	pfree(vl_datums);
+}
+
 /*
  * ccache_preload_chunk - preload a chunk
  */
@@ -1991,14 +3427,23 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 {
 	TupleDesc	tupdesc = RelationGetDescr(relation);
 	size_t		nrooms = 0;
-	Datum	   *tup_values;
-	bool	   *tup_isnull;
+	size_t		nitems = 0;
+	ItemPointerData *tup_ctids;
 	ccacheBuffer cc_buf;
 	int			i, j, fdesc;
 	size_t		length;
+	size_t		encoded_length;
+	size_t		zmap_length;
 	char		fname[MAXPGPATH];
 	kern_data_store *kds;
+	ccacheZoneMap *zmap;
 	BufferAccessStrategy strategy;
+	cl_ulong	cols_mask;
+
+	/* columns to be cached; never updated during the build */
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	cols_mask = cc_chunk->cols_mask;
+	SpinLockRelease(&ccache_state->chunks_lock);
 
 	/* check visibility map first */
 	Assert((block_nr & (CCACHE_CHUNK_NBLOCKS-1)) == 0);
@@ -2049,8 +3494,7 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 	 */
 	ccache_setup_buffer(tupdesc, &cc_buf, true, nrooms,
 						CurrentMemoryContext);
-	tup_values = palloc(sizeof(Datum) * tupdesc->natts);
-	tup_isnull = palloc(sizeof(bool) * tupdesc->natts);
+	tup_ctids = palloc_huge(sizeof(ItemPointerData) * Max(nrooms, 1));
 	for (i=0; i < CCACHE_CHUNK_NBLOCKS; i++)
 	{
 		Page	page = (Page)(PerChunkLoadBuffer + BLCKSZ * i);
@@ -2062,26 +3506,16 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 			 lineoff <= lines;
 			 lineoff++, lpp++)
 		{
-			HeapTupleData	tup;
-
 			if (!ItemIdIsNormal(lpp))
 				continue;
-			tup.t_tableOid = RelationGetRelid(relation);
-			tup.t_data = (HeapTupleHeader) PageGetItem(page, lpp);
-			tup.t_len = ItemIdGetLength(lpp);
-			ItemPointerSet(&tup.t_self, block_nr+i, lineoff);
-
-			Assert(cc_buf.nitems < nrooms);
-			heap_deform_tuple(&tup, tupdesc, tup_values, tup_isnull);
-			ccache_buffer_append_row(tupdesc,
-									 &cc_buf,
-									 &tup,
-									 tup_isnull,
-									 tup_values,
-									 CurrentMemoryContext);
-			cc_buf.nitems++;
+			Assert(nitems < nrooms);
+			ItemPointerSet(&tup_ctids[nitems], block_nr+i, lineoff);
+			nitems++;
 		}
 	}
+	ccache_buffer_append_rows_parallel(relation, block_nr, &cc_buf,
+									   tup_ctids, nitems);
+	pfree(tup_ctids);
 
 	/* write out to the ccache file */
 	length = STROMALIGN(offsetof(kern_data_store,
@@ -2115,6 +3549,10 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 				length += MAXALIGN(BITMAPLEN(cc_buf.nitems));
 		}
 	}
+	/* zone-map follows the KDS */
+	zmap_length = MAXALIGN(offsetof(ccacheZoneMap, items[cc_buf.nattrs]));
+	length += zmap_length;
+
 	ccache_chunk_filename(fname,
 						  MyDatabaseId,
 						  RelationGetRelid(relation),
@@ -2137,9 +3575,32 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 		close(fdesc);
 		elog(ERROR, "failed on mmap: %m");
 	}
-	ccache_copy_buffer_to_kds(kds, tupdesc, &cc_buf, NULL, 0);
+	ccache_copy_buffer_to_kds(kds, tupdesc, &cc_buf, NULL, 0);
+	zmap = palloc(zmap_length);
+	ccache_build_zonemap(kds, zmap);
+	/* only columns referenced by the queries are written out */
+	for (j=0; j < kds->ncols; j++)
+	{
+		if ((cols_mask & CCACHE_COLS_MASK(j)) == 0)
+		{
+			kds->colmeta[j].va_offset = 0;
+			kds->colmeta[j].extra_sz = 0;
+		}
+	}
+	encoded_length = ccache_encode_kds_column(kds);
+	Assert(encoded_length == MAXALIGN(encoded_length));
+	memcpy((char *)kds + encoded_length, zmap, zmap_length);
+	encoded_length += zmap_length;
+	pfree(zmap);
 	if (munmap(kds, length) != 0)
 		elog(WARNING, "failed on munmap: %m");
+	if (encoded_length < length)
+	{
+		if (ftruncate(fdesc, encoded_length) != 0)
+			elog(WARNING, "failed on ftruncate: %m");
+		else
+			length = encoded_length;
+	}
 	if (close(fdesc) != 0)
 		elog(WARNING, "failed on munmap: %m");
 
@@ -2266,44 +3727,115 @@ ccache_preload_chunk(ccacheChunk *cc_chunk,
 	return retval;
 }
 
+/*
+ * ccache_choose_victim_nolock
+ *
+ * It picks up the chunk with the oldest previous access (LRU-2) among the
+ * tail of the active list, or NULL if no active chunks.
+ */
+static ccacheChunk *
+ccache_choose_victim_nolock(void)
+{
+	ccacheChunk	   *cc_victim = NULL;
+	ccacheChunk	   *cc_temp;
+	dlist_node	   *dnode;
+	int				count = 0;
+
+	if (dlist_is_empty(&ccache_state->lru_active_list))
+		return NULL;
+	for (dnode = dlist_tail_node(&ccache_state->lru_active_list);
+		 count < CCACHE_EVICTION_CANDIDATES;
+		 dnode = dlist_prev_node(&ccache_state->lru_active_list, dnode))
+	{
+		cc_temp = dlist_container(ccacheChunk, lru_chain, dnode);
+		Assert(cc_temp->ctime != CCACHE_CTIME_IN_PROGRESS);
+		if (!cc_victim ||
+			cc_temp->atime_prev < cc_victim->atime_prev ||
+			(cc_temp->atime_prev == cc_victim->atime_prev &&
+			 cc_temp->atime < cc_victim->atime))
+			cc_victim = cc_temp;
+		if (!dlist_has_prev(&ccache_state->lru_active_list, dnode))
+			break;
+		count++;
+	}
+	return cc_victim;
+}
+
+/*
+ * ccache_choose_misshit_nolock
+ *
+ * It picks up the misshit chunk to be loaded next. If ccache has no room,
+ * the one with the most recent previous access among the head of misshit
+ * list is chosen, because only chunks referenced twice can be admitted.
+ */
+static ccacheChunk *
+ccache_choose_misshit_nolock(bool is_full)
+{
+	ccacheChunk	   *cc_chunk = NULL;
+	ccacheChunk	   *cc_temp;
+	dlist_node	   *dnode;
+	int				count = 0;
+
+	if (dlist_is_empty(&ccache_state->lru_misshit_list))
+		return NULL;
+	dnode = dlist_head_node(&ccache_state->lru_misshit_list);
+	if (!is_full)
+		return dlist_container(ccacheChunk, lru_chain, dnode);
+	for (;;)
+	{
+		cc_temp = dlist_container(ccacheChunk, lru_chain, dnode);
+		if (cc_temp->atime_prev > 0 &&
+			(!cc_chunk || cc_temp->atime_prev > cc_chunk->atime_prev))
+			cc_chunk = cc_temp;
+		if (++count >= CCACHE_ADMISSION_CANDIDATES ||
+			!dlist_has_next(&ccache_state->lru_misshit_list, dnode))
+			break;
+		dnode = dlist_next_node(&ccache_state->lru_misshit_list, dnode);
+	}
+	return cc_chunk;
+}
+
 /*
  * ccache_tryload_misshit_chunk - called by tryload
  */
 static bool
 ccache_tryload_misshit_chunk(void)
 {
-	dlist_node	   *dnode;
 	ccacheChunk	   *cc_chunk;
 	ccacheChunk	   *cc_temp;
 	bool			retval;
 
 	/* pick up a target chunk to be loaded, which is recently referenced */
 	SpinLockAcquire(&ccache_state->chunks_lock);
-	if (dlist_is_empty(&ccache_state->lru_misshit_list))
+	cc_chunk = ccache_choose_misshit_nolock(ccache_state->ccache_usage +
+											CCACHE_CHUNK_SIZE >
+											ccache_total_size);
+	if (!cc_chunk)
 	{
 		SpinLockRelease(&ccache_state->chunks_lock);
 		return false;
 	}
-	dnode = dlist_head_node(&ccache_state->lru_misshit_list);
-	cc_chunk = dlist_container(ccacheChunk, lru_chain, dnode);
 	Assert(cc_chunk->hash_chain.prev != NULL &&
 		   cc_chunk->hash_chain.next != NULL &&
 		   cc_chunk->ctime == CCACHE_CTIME_NOT_BUILD);
 
-	/* release existing chunks if ccache usage is nearby the limitation */
+	/*
+	 * release existing chunks if ccache usage is nearby the limitation,
+	 * only if the misshit chunk is hotter than the victim.
+	 */
 	while (ccache_state->ccache_usage +
 		   CCACHE_CHUNK_SIZE > ccache_total_size)
 	{
-		if (dlist_is_empty(&ccache_state->lru_active_list))
+		cc_temp = ccache_choose_victim_nolock();
+		if (!cc_temp || cc_temp->atime_prev >= cc_chunk->atime_prev)
 		{
 			SpinLockRelease(&ccache_state->chunks_lock);
 			return false;
 		}
-		dnode = dlist_tail_node(&ccache_state->lru_active_list);
-		cc_temp = dlist_container(ccacheChunk, lru_chain, dnode);
-		Assert(cc_temp->ctime != CCACHE_CTIME_IN_PROGRESS);
 		dlist_delete(&cc_temp->hash_chain);
+		dlist_delete(&cc_temp->lru_chain);
 		memset(&cc_temp->hash_chain, 0, sizeof(dlist_node));
+		memset(&cc_temp->lru_chain, 0, sizeof(dlist_node));
 		ccache_put_chunk_nolock(cc_temp);
 	}
 	/* detach from the LRU list and mark it 'in-progress' */
@@ -2396,6 +3928,7 @@ ccache_tryload_one_chunk(Relation relation, BlockNumber block_nr)
 		dlist_delete(&cc_chunk->lru_chain);
 		memset(&cc_chunk->lru_chain, 0, sizeof(dlist_node));
 		cc_chunk->ctime = CCACHE_CTIME_IN_PROGRESS;
+		cc_chunk->cols_mask = CCACHE_COLS_MASK_ALL;
 		cc_chunk->refcnt++;
 	}
 	else if (!dlist_is_empty(&ccache_state->free_chunks_list))
@@ -2414,6 +3947,7 @@ ccache_tryload_one_chunk(Relation relation, BlockNumber block_nr)
 		cc_chunk->refcnt = 2;
 		cc_chunk->ctime = CCACHE_CTIME_IN_PROGRESS;
 		cc_chunk->atime = GetCurrentTimestamp();
+		cc_chunk->cols_mask = CCACHE_COLS_MASK_ALL;
 		dlist_push_head(&ccache_state->active_slots[k],
 						&cc_chunk->hash_chain);
 	}
@@ -2435,6 +3969,7 @@ ccache_tryload_one_chunk(Relation relation, BlockNumber block_nr)
 		cc_chunk->refcnt = 2;
 		cc_chunk->ctime = CCACHE_CTIME_IN_PROGRESS;
 		cc_chunk->atime = GetCurrentTimestamp();
+		cc_chunk->cols_mask = CCACHE_COLS_MASK_ALL;
 		dlist_push_head(&ccache_state->active_slots[k],
 						&cc_chunk->hash_chain);
 	}
@@ -2693,15 +4228,467 @@ ccache_tryload_chilly_chunks(int nchunks_atonce)
 	return nchunks_atonce;
 }
 
+/*
+ * ccache_release_device_images
+ *
+ * It frees the device images of the chunks already released.
+ */
+static void
+ccache_release_device_images(void)
+{
+	ccacheChunk	   *cc_chunk;
+	dlist_node	   *dnode;
+	CUipcMemHandle	m_handle;
+	cl_int			dindex;
+	CUresult		rc;
+
+	for (;;)
+	{
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		if (dlist_is_empty(&ccache_state->dev_release_list))
+		{
+			SpinLockRelease(&ccache_state->chunks_lock);
+			break;
+		}
+		dnode = dlist_pop_head_node(&ccache_state->dev_release_list);
+		cc_chunk = dlist_container(ccacheChunk, dev_chain, dnode);
+		Assert(cc_chunk->refcnt == 0 && cc_chunk->dev_length > 0);
+		dindex = cc_chunk->dev_dindex;
+		memcpy(&m_handle, &cc_chunk->dev_handle, sizeof(CUipcMemHandle));
+		Assert(ccache_state->dev_tier_usage[dindex] >= cc_chunk->dev_length);
+		ccache_state->dev_tier_usage[dindex] -= cc_chunk->dev_length;
+		/* back to the free list */
+		memset(cc_chunk, 0, sizeof(ccacheChunk));
+		dlist_push_head(&ccache_state->free_chunks_list,
+						&cc_chunk->hash_chain);
+		SpinLockRelease(&ccache_state->chunks_lock);
+
+		rc = gpuMemFreePreserved(dindex, m_handle);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on gpuMemFreePreserved: %s",
+				 errorText(rc));
+	}
+}
+
+/*
+ * ccache_demote_chunk_nolock - detach the device image from the chunk
+ */
+static void
+ccache_demote_chunk_nolock(ccacheChunk *cc_chunk, CUipcMemHandle *p_handle)
+{
+	cl_int		dindex = cc_chunk->dev_dindex;
+
+	Assert(cc_chunk->dev_length > 0 && !cc_chunk->dev_in_progress);
+	dlist_delete(&cc_chunk->dev_chain);
+	memset(&cc_chunk->dev_chain, 0, sizeof(dlist_node));
+	memcpy(p_handle, &cc_chunk->dev_handle, sizeof(CUipcMemHandle));
+	Assert(ccache_state->dev_tier_usage[dindex] >= cc_chunk->dev_length);
+	ccache_state->dev_tier_usage[dindex] -= cc_chunk->dev_length;
+	cc_chunk->dev_dindex = 0;
+	cc_chunk->dev_length = 0;
+	memset(&cc_chunk->dev_handle, 0, sizeof(CUipcMemHandle));
+}
+
+/*
+ * ccache_reserve_device_tier_nolock
+ *
+ * It reserves the device tier for the chunk on the GPU device with the least
+ * usage, or returns false if no room. If the device tier is full, the chunks
+ * on the device which are colder than @cc_chunk and not in use are demoted;
+ * the images to be freed by caller are returned on @victims.
+ */
+static bool
+ccache_reserve_device_tier_nolock(ccacheChunk *cc_chunk, size_t length,
+								  cl_int *p_dindex,
+								  CUipcMemHandle *victims, int *p_nvictims)
+{
+	size_t	   *usage = ccache_state->dev_tier_usage;
+	cl_int		dindex = 0;
+	int			i;
+
+	for (i=1; i < numDevAttrs; i++)
+	{
+		if (usage[i] < usage[dindex])
+			dindex = i;
+	}
+	*p_dindex = dindex;
+	if (length > ccache_device_tier_size)
+		return false;
+	while (usage[dindex] + length > ccache_device_tier_size)
+	{
+		ccacheChunk *cc_victim = NULL;
+		ccacheChunk *cc_temp;
+		dlist_iter	iter;
+
+		if (*p_nvictims >= CCACHE_EVICTION_CANDIDATES)
+			return false;
+		dlist_foreach(iter, &ccache_state->dev_active_list)
+		{
+			cc_temp = dlist_container(ccacheChunk, dev_chain, iter.cur);
+			/* only chunks tracked by ccache, and nobody uses */
+			if (cc_temp->dev_dindex != dindex ||
+				cc_temp->refcnt > 1 ||
+				cc_temp->hash_chain.next == NULL)
+				continue;
+			/* images of dirty chunks are no longer used */
+			if (!cc_victim ||
+				(cc_temp->ndirty > 0 && cc_victim->ndirty == 0) ||
+				((cc_temp->ndirty > 0) == (cc_victim->ndirty > 0) &&
+				 cc_temp->atime_prev < cc_victim->atime_prev))
+				cc_victim = cc_temp;
+		}
+		if (!cc_victim ||
+			(cc_victim->ndirty == 0 &&
+			 cc_victim->atime_prev >= cc_chunk->atime_prev))
+			return false;
+		ccache_demote_chunk_nolock(cc_victim, &victims[*p_nvictims]);
+		(*p_nvictims)++;
+	}
+	usage[dindex] += length;
+	cc_chunk->dev_dindex = dindex;
+	cc_chunk->dev_length = length;
+
+	return true;
+}
+
+/*
+ * ccache_tryload_device_tier
+ *
+ * It promotes the hottest chunk on the host tier, which is referenced twice
+ * at least and has no dirty blocks, to the device tier. It returns true, if
+ * a chunk is promoted.
+ */
+static bool
+ccache_tryload_device_tier(void)
+{
+	ccacheChunk	   *cc_chunk = NULL;
+	ccacheChunk	   *cc_temp;
+	dlist_iter		iter;
+	CUipcMemHandle	victims[CCACHE_EVICTION_CANDIDATES];
+	int				nvictims = 0;
+	int				count = 0;
+	Oid				table_oid;
+	BlockNumber		block_nr;
+	volatile int	fdesc = -1;
+	volatile bool	reserved = false;
+	volatile bool	has_handle = false;
+	cl_int			dindex;
+	CUresult		rc;
+
+	if (ccache_device_tier_size == 0 || numDevAttrs == 0)
+		return false;
+	/* pick up the hottest chunk on the host tier */
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->lru_active_list)
+	{
+		cc_temp = dlist_container(ccacheChunk, lru_chain, iter.cur);
+		if (cc_temp->database_oid == MyDatabaseId &&
+			cc_temp->dev_length == 0 &&
+			!cc_temp->dev_in_progress &&
+			cc_temp->ndirty == 0 &&
+			cc_temp->atime_prev > 0 &&
+			(!cc_chunk || cc_temp->atime_prev > cc_chunk->atime_prev))
+			cc_chunk = cc_temp;
+		if (++count >= CCACHE_ADMISSION_CANDIDATES)
+			break;
+	}
+	if (!cc_chunk)
+	{
+		SpinLockRelease(&ccache_state->chunks_lock);
+		return false;
+	}
+	cc_chunk->dev_in_progress = true;
+	cc_chunk->refcnt++;
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	PG_TRY();
+	{
+		Relation	relation;
+		TupleDesc	tupdesc;
+		char		fname[MAXPGPATH];
+		kern_data_store *kds_head;
+		kern_data_store *kds;
+		Relids		cached_cols = NULL;
+		size_t		length;
+		int			i;
+
+		relation = heap_open(cc_chunk->table_oid, AccessShareLock);
+		tupdesc = RelationGetDescr(relation);
+		ccache_chunk_filename(fname,
+							  cc_chunk->database_oid,
+							  cc_chunk->table_oid,
+							  cc_chunk->block_nr);
+		fdesc = openat(dirfd(ccache_base_dir), fname, O_RDONLY);
+		if (fdesc < 0)
+			elog(ERROR, "failed on open('%s'): %m", fname);
+		length = STROMALIGN(offsetof(kern_data_store,
+									 colmeta[cc_chunk->nattrs +
+											 NumOfSystemAttrs]));
+		kds_head = palloc(length);
+		if (pread(fdesc, kds_head, length, 0) != length)
+			elog(ERROR, "failed on pread(2): %m");
+		/* the image has all the columns cached on the file */
+		for (i=0; i < kds_head->ncols; i++)
+		{
+			if (kds_head->colmeta[i].va_offset != 0)
+				cached_cols = bms_add_member(cached_cols, i);
+		}
+		length = ccache_decoded_length(kds_head, cached_cols);
+
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		reserved = ccache_reserve_device_tier_nolock(cc_chunk, length,
+													 &dindex,
+													 victims, &nvictims);
+		SpinLockRelease(&ccache_state->chunks_lock);
+		for (i=0; i < nvictims; i++)
+		{
+			rc = gpuMemFreePreserved(dindex, victims[i]);
+			if (rc != CUDA_SUCCESS)
+				elog(WARNING, "failed on gpuMemFreePreserved: %s",
+					 errorText(rc));
+		}
+
+		if (reserved)
+		{
+			kds = palloc_huge(length);
+			init_kernel_data_store(kds, tupdesc, length,
+								   KDS_FORMAT_COLUMN, kds_head->nitems);
+			ccache_decode_columns(fdesc, kds_head, cached_cols, kds);
+
+			/* nobody refers dev_handle during the build */
+			rc = gpuMemAllocPreserved(dindex, &cc_chunk->dev_handle, length);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocPreserved: %s",
+					 errorText(rc));
+			has_handle = true;
+			gpuIpcMemCopyFromHost(dindex, cc_chunk->dev_handle, 0,
+								  kds, length);
+			pfree(kds);
+		}
+		close(fdesc);
+		fdesc = -1;
+		heap_close(relation, NoLock);
+	}
+	PG_CATCH();
+	{
+		CUipcMemHandle	m_handle;
+
+		if (fdesc >= 0)
+			close(fdesc);
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		dindex = cc_chunk->dev_dindex;
+		memcpy(&m_handle, &cc_chunk->dev_handle, sizeof(CUipcMemHandle));
+		if (reserved)
+		{
+			Assert(ccache_state->dev_tier_usage[dindex] >=
+				   cc_chunk->dev_length);
+			ccache_state->dev_tier_usage[dindex] -= cc_chunk->dev_length;
+			cc_chunk->dev_dindex = 0;
+			cc_chunk->dev_length = 0;
+			memset(&cc_chunk->dev_handle, 0, sizeof(CUipcMemHandle));
+		}
+		cc_chunk->dev_in_progress = false;
+		ccache_put_chunk_nolock(cc_chunk);
+		SpinLockRelease(&ccache_state->chunks_lock);
+		if (has_handle)
+			gpuMemFreePreserved(dindex, m_handle);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	table_oid = cc_chunk->table_oid;
+	block_nr = cc_chunk->block_nr;
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	cc_chunk->dev_in_progress = false;
+	if (reserved)
+		dlist_push_tail(&ccache_state->dev_active_list,
+						&cc_chunk->dev_chain);
+	ccache_put_chunk_nolock(cc_chunk);
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	if (reserved)
+		elog(BUILDER_LOG,
+			 "ccache-builder%d: table %u block_nr %u promoted to GPU%d",
+			 ccache_builder->builder_id, table_oid, block_nr, dindex);
+	return reserved;
+}
+
+/*
+ * ccache_tryload_prewarm_chunks
+ *
+ * It builds the chunks requested by the asynchronous prewarm on the current
+ * database, up to nchunks_atonce. Returns the number of remaining chunks
+ * to be loaded at once.
+ */
+static int
+ccache_tryload_prewarm_chunks(int nchunks_atonce)
+{
+	while (nchunks_atonce > 0)
+	{
+		ccachePrewarm  *pw = NULL;
+		Oid				table_oid = InvalidOid;
+		BlockNumber		block_nr = InvalidBlockNumber;
+		Relation		relation;
+		int				i, rc = -1;
+
+		/* pick up a chunk to be built */
+		SpinLockAcquire(&ccache_state->lock);
+		for (i=0; i < CCACHE_MAX_NUM_PREWARMS; i++)
+		{
+			ccachePrewarm  *pw_temp = &ccache_state->prewarms[i];
+
+			if (pw_temp->database_oid == MyDatabaseId &&
+				pw_temp->end_time == 0 &&
+				pw_temp->next_chunk < pw_temp->nchunks)
+			{
+				pw = pw_temp;
+				table_oid = pw->table_oid;
+				block_nr = (pw->next_chunk++) * CCACHE_CHUNK_NBLOCKS;
+				pw->ninflight++;
+				ccache_builder->table_oid = table_oid;
+				ccache_builder->block_nr = block_nr;
+				break;
+			}
+		}
+		SpinLockRelease(&ccache_state->lock);
+		if (!pw)
+			break;
+
+		PG_TRY();
+		{
+			relation = try_relation_open(table_oid, AccessShareLock);
+			if (relation)
+			{
+				if (hash_search(ccache_relations_htab, &table_oid,
+								HASH_FIND, NULL) != NULL)
+					rc = ccache_tryload_one_chunk(relation, block_nr);
+				relation_close(relation, NoLock);
+			}
+		}
+		PG_CATCH();
+		{
+			SpinLockAcquire(&ccache_state->lock);
+			pw->ninflight--;
+			pw->nprocessed++;
+			if (pw->ninflight == 0 && pw->next_chunk >= pw->nchunks)
+				pw->end_time = GetCurrentTimestamp();
+			ccache_builder->table_oid = InvalidOid;
+			ccache_builder->block_nr = InvalidBlockNumber;
+			SpinLockRelease(&ccache_state->lock);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		/* update the progress */
+		SpinLockAcquire(&ccache_state->lock);
+		pw->ninflight--;
+		pw->nprocessed++;
+		if (rc > 0)
+			pw->nloaded++;
+		else if (rc < 0)
+			pw->next_chunk = pw->nchunks;	/* cannot load any more */
+		if (pw->ninflight == 0 && pw->next_chunk >= pw->nchunks)
+			pw->end_time = GetCurrentTimestamp();
+		ccache_builder->table_oid = InvalidOid;
+		ccache_builder->block_nr = InvalidBlockNumber;
+		SpinLockRelease(&ccache_state->lock);
+
+		nchunks_atonce--;
+		CHECK_FOR_INTERRUPTS();
+	}
+	return nchunks_atonce;
+}
+
+/*
+ * ccache_prewarm_async - puts a request of the asynchronous prewarm
+ */
+static cl_uint
+ccache_prewarm_async(Relation relation)
+{
+	Oid				table_oid = RelationGetRelid(relation);
+	cl_uint			nchunks;
+	ccachePrewarm  *pw_slot = NULL;
+	TimestampTz		now = GetCurrentTimestamp();
+	bool			has_builder = false;
+	bool			in_progress = false;
+	int				i;
+
+	nchunks = RelationGetNumberOfBlocks(relation) / CCACHE_CHUNK_NBLOCKS;
+	SpinLockAcquire(&ccache_state->lock);
+	for (i=0; i < ccache_num_builders; i++)
+	{
+		if (ccache_state->builders[i].database_oid == MyDatabaseId)
+			has_builder = true;
+	}
+	for (i=0; has_builder && i < CCACHE_MAX_NUM_PREWARMS; i++)
+	{
+		ccachePrewarm  *pw = &ccache_state->prewarms[i];
+
+		if (!OidIsValid(pw->database_oid))
+		{
+			if (!pw_slot || OidIsValid(pw_slot->database_oid))
+				pw_slot = pw;
+		}
+		else if (pw->end_time == 0)
+		{
+			if (pw->database_oid == MyDatabaseId &&
+				pw->table_oid == table_oid)
+				in_progress = true;
+		}
+		else if (!pw_slot || (OidIsValid(pw_slot->database_oid) &&
+							  pw_slot->end_time > pw->end_time))
+			pw_slot = pw;	/* reuse the oldest one completed */
+	}
+
+	if (has_builder && !in_progress && pw_slot)
+	{
+		memset(pw_slot, 0, sizeof(ccachePrewarm));
+		pw_slot->database_oid = MyDatabaseId;
+		pw_slot->table_oid = table_oid;
+		pw_slot->nchunks = nchunks;
+		pw_slot->start_time = now;
+		if (nchunks == 0)
+			pw_slot->end_time = now;
+		/* kick ccache-builders on the database */
+		for (i=0; i < ccache_num_builders; i++)
+		{
+			ccacheBuilder  *builder = &ccache_state->builders[i];
+
+			if (builder->database_oid == MyDatabaseId && builder->latch)
+				SetLatch(builder->latch);
+		}
+	}
+	SpinLockRelease(&ccache_state->lock);
+
+	if (!has_builder)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("no ccache builder is working on the current database"),
+				 errhint("check pg_strom.ccache_databases")));
+	if (in_progress)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("ccache: prewarm of \"%s\" is already in progress",
+						RelationGetRelationName(relation))));
+	if (!pw_slot)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+				 errmsg("ccache: too many prewarm requests in progress")));
+	return nchunks;
+}
+
 /*
  * pgstrom_ccache_prewarm
  *
- * API for synchronous ccache build
+ * API for ccache build; it builds the chunks synchronously, or puts
+ * a request for ccache-builders if 'async' is true. Progress of the
+ * asynchronous prewarm is shown in pgstrom.ccache_prewarm_info.
  */
 Datum
 pgstrom_ccache_prewarm(PG_FUNCTION_ARGS)
 {
 	Oid			table_oid = PG_GETARG_OID(0);
+	bool		async = (PG_NARGS() > 1 ? PG_GETARG_BOOL(1) : false);
 	Relation	relation;
 	cl_uint		i, nchunks;
 	cl_uint		load_count = 0;
@@ -2712,6 +4699,13 @@ pgstrom_ccache_prewarm(PG_FUNCTION_ARGS)
 		elog(ERROR, "ccache: not configured on the table %u", table_oid);
 
 	relation = heap_open(table_oid, AccessShareLock);
+	if (async)
+	{
+		nchunks = ccache_prewarm_async(relation);
+		heap_close(relation, NoLock);
+
+		PG_RETURN_INT32(nchunks);
+	}
 	nchunks = RelationGetNumberOfBlocks(relation) / CCACHE_CHUNK_NBLOCKS;
 
 	Assert(!PerChunkLoadBuffer);
@@ -2834,8 +4828,19 @@ ccache_builder_main(Datum arg)
 				else
 					break;
 			}
+			if (nchunks_atonce > 0)
+				nchunks_atonce = ccache_tryload_prewarm_chunks(nchunks_atonce);
 			if (nchunks_atonce > 0)
 				nchunks_atonce = ccache_tryload_chilly_chunks(nchunks_atonce);
+			/* promotion of the hottest chunks to the device tier */
+			ccache_release_device_images();
+			while (nchunks_atonce > 0)
+			{
+				if (ccache_tryload_device_tier())
+					nchunks_atonce--;
+				else
+					break;
+			}
 			timeout = (nchunks_atonce == 0 ? 0 : 4000);
 
 			if (VisibilityMapBuffer != InvalidBuffer)
@@ -3034,7 +5039,8 @@ pgstrom_startup_ccache(void)
 	required = MAXALIGN(offsetof(ccacheState,
 								 builders[ccache_num_builders])) +
 		MAXALIGN(sizeof(dlist_head) * ccache_num_slots) +
-		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks);
+		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks) +
+		MAXALIGN(sizeof(size_t) * numDevAttrs);
 	ccache_state = ShmemInitStruct("Columnar Cache Shared Segment",
 								   required, &found);
 	if (found)
@@ -3060,6 +5066,13 @@ pgstrom_startup_ccache(void)
 						&cc_chunk->hash_chain);
 		cc_chunk++;
 	}
+	/* device tier */
+	dlist_init(&ccache_state->dev_active_list);
+	dlist_init(&ccache_state->dev_release_list);
+	ccache_state->dev_tier_usage = (size_t *)
+		((char *)ccache_state->active_slots +
+		 MAXALIGN(sizeof(dlist_head) * ccache_num_slots) +
+		 MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks));
 	/* fields for management of builder processes */
 	SpinLockInit(&ccache_state->lock);
 
@@ -3112,6 +5125,7 @@ void
 pgstrom_init_ccache(void)
 {
 	static int	ccache_total_size_kb;
+	static int	ccache_device_tier_size_kb;
 	int			ccache_total_size_default;
 	long		sc_pagesize = sysconf(_SC_PAGESIZE);
 	long		sc_phys_pages = sysconf(_SC_PHYS_PAGES);
@@ -3183,6 +5197,34 @@ pgstrom_init_ccache(void)
 							   guc_check_ccache_databases,
 							   guc_assign_ccache_databases,
 							   guc_show_ccache_databases);
+	DefineCustomBoolVariable("pg_strom.ccache_compression",
+							 "enables encoding of integer columns on ccache",
+							 NULL,
+							 &ccache_compression,
+							 true,
+							 PGC_SIGHUP,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.ccache_max_dirty_blocks",
+							"max number of dirty blocks per ccache chunk",
+							"Rows on the dirty blocks are read from the heap",
+							&ccache_max_dirty_blocks,
+							CCACHE_CHUNK_NBLOCKS / 16,
+							0,
+							CCACHE_CHUNK_NBLOCKS,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.ccache_builder_threads",
+							"number of threads to build a ccache chunk",
+							NULL,
+							&ccache_builder_nthreads,
+							4,
+							1,
+							CCACHE_BUILDER_MAX_THREADS,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 	DefineCustomBoolVariable("pg_strom.ccache_log_output",
 							 "turn on/off log output by ccache builder",
 							 NULL,
@@ -3210,6 +5252,18 @@ pgstrom_init_ccache(void)
 							NULL, NULL, NULL);
 
 	ccache_total_size = (size_t)ccache_total_size_kb << 10;
+
+	DefineCustomIntVariable("pg_strom.ccache_device_tier_size",
+							"size of the device tier of ccache per GPU",
+							"Hottest chunks are kept on the device memory",
+							&ccache_device_tier_size_kb,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	ccache_device_tier_size = (size_t)ccache_device_tier_size_kb << 10;
 	ccache_num_slots = Max(ccache_total_size / CCACHE_CHUNK_SIZE, 300);
 	ccache_num_chunks = 5 * ccache_num_slots;
 
@@ -3234,7 +5288,8 @@ pgstrom_init_ccache(void)
 								 builders[ccache_num_builders])) +
 		MAXALIGN(sizeof(slock_t) * ccache_num_slots) +
 		MAXALIGN(sizeof(dlist_head) * ccache_num_slots) +
-		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks);
+		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks) +
+		MAXALIGN(sizeof(size_t) * numDevAttrs);
 	RequestAddinShmemSpace(required);
 
 	shmem_startup_next = shmem_startup_hook;
@@ -3242,4 +5297,8 @@ pgstrom_init_ccache(void)
 
 	CacheRegisterSyscacheCallback(RELOID, ccache_callback_on_reloid, 0);
 	CacheRegisterSyscacheCallback(PROCOID, ccache_callback_on_procoid, 0);
+
+	/* pins of the device tier images */
+	dlist_init(&ccache_device_pins);
+	RegisterResourceReleaseCallback(ccache_device_pins_cleanup_callback, NULL);
 }
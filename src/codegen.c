@@ -16,7 +16,9 @@
  * GNU General Public License for more details.
  */
 #include "pg_strom.h"
+#include "cuda_matrix.h"
 #include "cuda_numeric.h"
+#include "cuda_textlib.h"
 
 static MemoryContext	devinfo_memcxt;
 static bool		devtype_info_is_built;
@@ -189,6 +191,10 @@ static struct {
 				 NULL, NULL, NULL,
 				 DEVKERNEL_NEEDS_TEXTLIB, 0,
 				 generic_devtype_hashfunc),
+	DEVTYPE_DECL("jsonb",   "JSONBOID",   "varlena *",
+				 NULL, NULL, NULL,
+				 DEVKERNEL_NEEDS_JSONLIB, 0,
+				 generic_devtype_hashfunc),
 	/*
 	 * range types
 	 */
@@ -554,6 +560,7 @@ pg_range_devtype_hashfunc(devtype_info *dtype,
  * 'y' : this function needs cuda_misc.h
  * 'r' : this function needs cuda_rangetype.h
  * 'E' : this function needs cuda_time_extract.h
+ * 'j' : this function needs cuda_jsonlib.h
  *
  * class character:
  * 'r' : right operator that takes an argument (deprecated)
@@ -903,6 +910,7 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "log", 1, {FLOAT8OID}, "m/f:log10" },
 	{ "dlog10", 1, {FLOAT8OID}, "m/f:log10" },
 	{ "pi", 0, {}, "m/f:dpi" },
+	{ "random", 0, {}, "m/f:random" },
 	{ "power", 2, {FLOAT8OID, FLOAT8OID}, "m/f:dpow" },
 	{ "pow", 2, {FLOAT8OID, FLOAT8OID}, "m/f:dpow" },
 	{ "dpow", 2, {FLOAT8OID, FLOAT8OID}, "m/f:dpow" },
@@ -1167,6 +1175,12 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "date_part", 2, {TEXTOID,TIMETZOID},      "stE/f:extract_timetz"},
 	{ "date_part", 2, {TEXTOID,TIMEOID},        "stE/f:extract_time"},
 
+	/* date_trunc() */
+	{ "date_trunc", 2, {TEXTOID,TIMESTAMPOID},
+	  "stE/f:date_trunc_timestamp" },
+	{ "date_trunc", 2, {TEXTOID,TIMESTAMPTZOID},
+	  "stE/f:date_trunc_timestamptz" },
+
 	/* other time and data functions */
 	{ "now", 0, {}, "t/f:now" },
 
@@ -1226,6 +1240,39 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "bpchariclike",  2, {TEXTOID, TEXTOID},   "sc/f:texticlike" },
 	{ "texticnlike",   2, {TEXTOID, TEXTOID},   "sc/f:texticnlike" },
 	{ "bpcharicnlike", 2, {BPCHAROID, TEXTOID}, "sc/f:texticnlike" },
+	/*
+	 * Regular expression operators; available only if pattern is constant
+	 * and supported by the DFA (see build_text_pattern_dfa)
+	 */
+	{ "textregexeq",     2, {TEXTOID, TEXTOID},   "s/f:textregexeq" },
+	{ "textregexne",     2, {TEXTOID, TEXTOID},   "s/f:textregexne" },
+	{ "bpcharregexeq",   2, {BPCHAROID, TEXTOID}, "s/f:textregexeq" },
+	{ "bpcharregexne",   2, {BPCHAROID, TEXTOID}, "s/f:textregexne" },
+	{ "texticregexeq",   2, {TEXTOID, TEXTOID},   "sc/f:texticregexeq" },
+	{ "texticregexne",   2, {TEXTOID, TEXTOID},   "sc/f:texticregexne" },
+	{ "bpcharicregexeq", 2, {BPCHAROID, TEXTOID}, "sc/f:texticregexeq" },
+	{ "bpcharicregexne", 2, {BPCHAROID, TEXTOID}, "sc/f:texticregexne" },
+
+	/*
+	 * jsonb operators
+	 * ---------------
+	 * '->' and '->>' construct a new varlena datum on the per-thread
+	 * buffer of kern_context.
+	 */
+	{ "jsonb_object_field",       2, {JSONBOID, TEXTOID},
+	  "j/f:jsonb_object_field" },
+	{ "jsonb_object_field_text",  2, {JSONBOID, TEXTOID},
+	  "j/f:jsonb_object_field_text" },
+	{ "jsonb_array_element",      2, {JSONBOID, INT4OID},
+	  "j/f:jsonb_array_element" },
+	{ "jsonb_array_element_text", 2, {JSONBOID, INT4OID},
+	  "j/f:jsonb_array_element_text" },
+	{ "jsonb_exists",             2, {JSONBOID, TEXTOID},
+	  "j/f:jsonb_exists" },
+	{ "jsonb_contains",           2, {JSONBOID, JSONBOID},
+	  "j/f:jsonb_contains" },
+	{ "jsonb_contained",          2, {JSONBOID, JSONBOID},
+	  "j/f:jsonb_contained" },
 };
 
 /*
@@ -1558,6 +1605,22 @@ static devfunc_extra_catalog_t devfunc_extra_catalog[] = {
 	{ FLOAT8, "as_float8("INT8")", "p/f:as_float8" },
 	{ FLOAT4, "as_float4("INT4")", "p/f:as_float4" },
 	{ FLOAT2, "as_float2("INT2")", "p/f:as_float2" },
+
+	/* fixed-point numeric for GpuPreAgg */
+	{ INT8,   "pgstrom.numeric_fixed_hi("NUMERIC","INT4")",
+	  "n/f:numeric_fixed_hi" },
+	{ INT8,   "pgstrom.numeric_fixed_lo("NUMERIC","INT4")",
+	  "n/f:numeric_fixed_lo" },
+	/* HyperLogLog registers for GpuPreAgg */
+	{ INT2,   "pgstrom.hll_register("INT8","INT4")",
+	  "y/f:hll_register" },
+	/* time_bucket() */
+	{ "timestamp without time zone",
+	  "pgstrom.time_bucket(interval,timestamp without time zone)",
+	  "t/f:time_bucket_timestamp" },
+	{ "timestamp with time zone",
+	  "pgstrom.time_bucket(interval,timestamp with time zone)",
+	  "t/f:time_bucket_timestamptz" },
 };
 
 #undef BOOL
@@ -1613,6 +1676,9 @@ __construct_devfunc_info(devfunc_info *entry,
 				case 'E':
 					flags |= DEVKERNEL_NEEDS_TIME_EXTRACT;
 					break;
+				case 'j':
+					flags |= DEVKERNEL_NEEDS_JSONLIB;
+					break;
 				default:
 					elog(NOTICE,
 						 "Bug? unkwnon devfunc property: %c",
@@ -2088,6 +2154,1239 @@ skip:
 static void codegen_function_expression(devfunc_info *dfunc, List *args,
 										codegen_context *context);
 
+/*
+ * codegen_scalar_array_hashset
+ *
+ * It builds a hash set of the constant array elements, if ScalarArrayOpExpr
+ * is 'scalar = ANY(constant array)' with a number of elements, and the data
+ * type has bitwise equality consistent with its hash function.
+ * Elsewhere, NULL is returned, then device code walks on the array linearly.
+ */
+#define SCALAR_ARRAY_HASHSET_THRESHOLD		32
+
+static Const *
+codegen_scalar_array_hashset(ScalarArrayOpExpr *opexpr, devfunc_info *dfunc)
+{
+	devtype_info   *dtype = linitial(dfunc->func_args);
+	Const		   *con = lsecond(opexpr->args);
+	ArrayType	   *array;
+	kern_array_hashset *hset;
+	char		   *base;
+	bits8		   *bitmap;
+	int				bitmask;
+	size_t			length;
+	cl_uint			offset;
+	cl_uint			nslots;
+	cl_uint			i, nitems;
+
+	if (!opexpr->useOr ||
+		!IsA(con, Const) || con->constisnull ||
+		lsecond(dfunc->func_args) != dtype ||
+		exprType(linitial(opexpr->args)) != dtype->type_oid ||
+		!dtype->hash_func ||
+		!op_hashjoinable(opexpr->opno, dtype->type_oid))
+		return NULL;
+
+	switch (dtype->type_oid)
+	{
+		/* equality of these types is consistent with the hash value */
+		case BOOLOID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case CASHOID:
+		case UUIDOID:
+		case MACADDROID:
+		case DATEOID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case BPCHAROID:
+		case VARCHAROID:
+		case TEXTOID:
+		case BYTEAOID:
+			break;
+		default:
+			return NULL;
+	}
+
+	array = DatumGetArrayTypeP(con->constvalue);
+	if (ARR_ELEMTYPE(array) != dtype->type_oid)
+		return NULL;
+	nitems = ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array));
+	if (nitems < SCALAR_ARRAY_HASHSET_THRESHOLD)
+		return NULL;
+
+	/* load factor of the hash set is less than 50% */
+	for (nslots = 64; nslots < 2 * nitems; nslots <<= 1);
+	length = offsetof(kern_array_hashset, slots[nslots]);
+	hset = palloc0(length);
+	SET_VARSIZE(hset, length);
+	hset->nslots = nslots;
+	memcpy(hset->crc32_table, pg_crc32_table, sizeof(hset->crc32_table));
+
+	base = ARR_DATA_PTR(array);
+	bitmap = ARR_NULLBITMAP(array);
+	bitmask = 1;
+	offset = 0;
+	for (i=0; i < nitems; i++)
+	{
+		if (bitmap && (*bitmap & bitmask) == 0)
+			hset->has_null = true;
+		else
+		{
+			Datum		datum = fetch_att(base + offset,
+										  dtype->type_byval,
+										  dtype->type_length);
+			pg_crc32	hash;
+			cl_uint		index;
+
+			INIT_LEGACY_CRC32(hash);
+			hash = dtype->hash_func(dtype, hash, datum, false);
+			FIN_LEGACY_CRC32(hash);
+
+			for (index = (hash & (nslots - 1));
+				 hset->slots[index].offset != 0;
+				 index = ((index + 1) & (nslots - 1)));
+			hset->slots[index].hash = hash;
+			hset->slots[index].offset = offset + 1;
+			hset->nitems++;
+
+			offset = att_addlength_pointer(offset, dtype->type_length,
+										   base + offset);
+			offset = att_align_nominal(offset, dtype->type_align);
+		}
+		/* advance the bitmap pointer if any */
+		if (bitmap)
+		{
+			bitmask <<= 1;
+			if (bitmask == 0x0100)
+			{
+				bitmap++;
+				bitmask = 1;
+			}
+		}
+	}
+	return makeConst(BYTEAOID, -1, InvalidOid, -1,
+					 PointerGetDatum(hset), false, false);
+}
+
+static void codegen_expression_walker(Node *node, codegen_context *context);
+
+/*
+ * Compiler of constant text patterns (LIKE, ILIKE and regular expression)
+ * into kern_text_dfa.
+ *
+ * Pattern is parsed into a tree of tpat_node, then translated to NFA by
+ * Thompson's construction, and DFA is built by the subset construction.
+ * We support a practical subset of the regular expression (ARE) below:
+ *  - literal characters, '.', and escaped non-alphanumeric characters
+ *  - \d, \s, \w, \D, \S, \W (only if LC_CTYPE is "C"), \n, \t, \r, \f, \v
+ *  - bracket expressions of single-byte characters and ranges, without
+ *    character classes like [:alpha:]
+ *  - quantifiers; *, +, ?, {m}, {m,}, {m,n} and their non-greedy variants
+ *  - grouping by (...) or (?:...), and alternation by '|'
+ *  - '^' and '$' anchors at the head and tail of the top-level branches
+ * Elsewhere, pattern is not compiled. Then, LIKE/ILIKE falls back to the
+ * device function that walks on the pattern for each row, and regular
+ * expression is not executable on the device.
+ */
+#define TEXT_DFA_MAX_NFA_STATES		4096
+#define TEXT_DFA_MAX_DFA_STATES		1024
+#define TEXT_DFA_MAX_TRANSITIONS	65536
+#define TEXT_DFA_MAX_REPEAT			255
+
+typedef enum
+{
+	TPAT_BYTES,		/* a byte in the bitmap */
+	TPAT_CONCAT,	/* sequence of the items */
+	TPAT_ALTER,		/* one of the items */
+	TPAT_REPEAT,	/* repeat of the sub-node */
+} tpat_kind;
+
+typedef struct tpat_node
+{
+	tpat_kind	kind;
+	bits8		bset[32];	/* TPAT_BYTES; bitmap of the bytes to match */
+	List	   *items;		/* TPAT_CONCAT, TPAT_ALTER */
+	struct tpat_node *sub;	/* TPAT_REPEAT */
+	int			min;		/* TPAT_REPEAT */
+	int			max;		/* TPAT_REPEAT; -1 means infinity */
+} tpat_node;
+
+#define TPAT_BSET_TEST(bset,c)	(((bset)[(cl_uchar)(c) >> 3] &	\
+								  (1 << ((cl_uchar)(c) & 7))) != 0)
+#define TPAT_BSET_SET(bset,c)	((bset)[(cl_uchar)(c) >> 3] |=	\
+								 (1 << ((cl_uchar)(c) & 7)))
+
+typedef struct
+{
+	const char *pos;		/* current position of the pattern */
+	const char *end;		/* end of the pattern */
+	bool		icase;		/* case insensitive match */
+	bool		ctype_is_c;	/* LC_CTYPE is "C" */
+	bool		is_utf8;	/* elsewhere, single-byte encoding */
+} tpat_parser;
+
+static tpat_node *
+tpat_make_node(tpat_kind kind)
+{
+	tpat_node  *node = palloc0(sizeof(tpat_node));
+
+	node->kind = kind;
+	return node;
+}
+
+static tpat_node *
+tpat_make_repeat(tpat_node *sub, int min, int max)
+{
+	tpat_node  *node = tpat_make_node(TPAT_REPEAT);
+
+	node->sub = sub;
+	node->min = min;
+	node->max = max;
+	return node;
+}
+
+static void
+tpat_add_byte(tpat_parser *tp, tpat_node *node, cl_uchar c)
+{
+	Assert(node->kind == TPAT_BYTES);
+	TPAT_BSET_SET(node->bset, c);
+	if (tp->icase)
+	{
+		if (c >= 'a' && c <= 'z')
+			TPAT_BSET_SET(node->bset, c - 'a' + 'A');
+		else if (c >= 'A' && c <= 'Z')
+			TPAT_BSET_SET(node->bset, c - 'A' + 'a');
+	}
+}
+
+static tpat_node *
+tpat_make_byte_range(int lower, int upper)
+{
+	tpat_node  *node = tpat_make_node(TPAT_BYTES);
+	int			c;
+
+	for (c = lower; c <= upper; c++)
+		TPAT_BSET_SET(node->bset, c);
+	return node;
+}
+
+/*
+ * tpat_make_anychar - a character except for the single-byte characters
+ * in the 'excl' bitmap, if any. It follows the logic of pg_utf_mblen()
+ * on UTF-8 encoding, to keep consistency with the LIKE operator on CPU.
+ */
+static tpat_node *
+tpat_make_anychar(tpat_parser *tp, bits8 *excl)
+{
+	tpat_node  *single = tpat_make_node(TPAT_BYTES);
+	tpat_node  *node;
+	int			c;
+
+	for (c=0; c < 256; c++)
+	{
+		if (tp->is_utf8 && c >= 0xc0 && c < 0xf8)
+			continue;		/* lead byte of multi-byte character */
+		if (!excl || !TPAT_BSET_TEST(excl, c))
+			TPAT_BSET_SET(single->bset, c);
+	}
+	if (!tp->is_utf8)
+		return single;
+
+	/* multi-byte characters; lead byte followed by 1-3 bytes */
+	node = tpat_make_node(TPAT_ALTER);
+	node->items = list_make1(single);
+	for (c=1; c <= 3; c++)
+	{
+		tpat_node  *mbchar = tpat_make_node(TPAT_CONCAT);
+		int			i;
+
+		mbchar->items = list_make1(c == 1 ? tpat_make_byte_range(0xc0, 0xdf) :
+								   c == 2 ? tpat_make_byte_range(0xe0, 0xef) :
+								   tpat_make_byte_range(0xf0, 0xf7));
+		for (i=0; i < c; i++)
+			mbchar->items = lappend(mbchar->items,
+									tpat_make_byte_range(0x00, 0xff));
+		node->items = lappend(node->items, mbchar);
+	}
+	return node;
+}
+
+/*
+ * tpat_parse_literal - a literal character at the current position
+ */
+static tpat_node *
+tpat_parse_literal(tpat_parser *tp)
+{
+	tpat_node  *node;
+	int			i, len;
+
+	len = (tp->is_utf8 ? pg_utf_mblen((const unsigned char *)tp->pos) : 1);
+	if (tp->pos + len > tp->end)
+		return NULL;	/* corrupted multi-byte character */
+	if (len == 1)
+	{
+		node = tpat_make_node(TPAT_BYTES);
+		tpat_add_byte(tp, node, *tp->pos++);
+		return node;
+	}
+	/* case folding is not applied on multi-byte characters */
+	node = tpat_make_node(TPAT_CONCAT);
+	for (i=0; i < len; i++)
+	{
+		tpat_node  *temp = tpat_make_node(TPAT_BYTES);
+
+		TPAT_BSET_SET(temp->bset, tp->pos[i]);
+		node->items = lappend(node->items, temp);
+	}
+	tp->pos += len;
+	return node;
+}
+
+/*
+ * tpat_parse_like - parser of LIKE/ILIKE pattern
+ */
+static tpat_node *
+tpat_parse_like(tpat_parser *tp)
+{
+	tpat_node  *node = tpat_make_node(TPAT_CONCAT);
+	tpat_node  *temp;
+
+	while (tp->pos < tp->end)
+	{
+		if (*tp->pos == '%')
+		{
+			temp = tpat_make_repeat(tpat_make_anychar(tp, NULL), 0, -1);
+			tp->pos++;
+		}
+		else if (*tp->pos == '_')
+		{
+			temp = tpat_make_anychar(tp, NULL);
+			tp->pos++;
+		}
+		else
+		{
+			if (*tp->pos == '\\')
+			{
+				/* LIKE pattern must not end with escape character */
+				if (++tp->pos >= tp->end)
+					return NULL;
+			}
+			temp = tpat_parse_literal(tp);
+			if (!temp)
+				return NULL;
+		}
+		node->items = lappend(node->items, temp);
+	}
+	return node;
+}
+
+/*
+ * tpat_parse_class_escape - class-shorthand escapes; \d, \s and \w
+ */
+static bool
+tpat_parse_class_escape(tpat_parser *tp, char c, tpat_node *node)
+{
+	const char *members;
+
+	switch (c)
+	{
+		case 'd':
+			members = "0123456789";
+			break;
+		case 's':
+			members = " \t\n\r\f\v";
+			break;
+		case 'w':
+			members = "0123456789_"
+				"abcdefghijklmnopqrstuvwxyz"
+				"ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+			break;
+		default:
+			return false;
+	}
+	/* non-ASCII characters are also members, if locale aware */
+	if (!tp->ctype_is_c)
+		return false;
+	while (*members)
+		tpat_add_byte(tp, node, *members++);
+	return true;
+}
+
+/*
+ * tpat_parse_char_escape - character-entry escapes, or escaped
+ * non-alphanumeric characters. It returns -1, if not supported.
+ */
+static int
+tpat_parse_char_escape(char c)
+{
+	switch (c)
+	{
+		case 'n':	return '\n';
+		case 't':	return '\t';
+		case 'r':	return '\r';
+		case 'f':	return '\f';
+		case 'v':	return '\v';
+		default:
+			if ((c >= '0' && c <= '9') ||
+				(c >= 'a' && c <= 'z') ||
+				(c >= 'A' && c <= 'Z') ||
+				(c & 0x80) != 0)
+				return -1;
+			break;
+	}
+	return c;
+}
+
+/*
+ * tpat_parse_bracket - bracket expression; the current position is next
+ * to the '['.
+ */
+static tpat_node *
+tpat_parse_bracket(tpat_parser *tp)
+{
+	tpat_node  *node = tpat_make_node(TPAT_BYTES);
+	bool		negative = false;
+	bool		is_first = true;
+	int			c, lower;
+
+	if (tp->pos < tp->end && *tp->pos == '^')
+	{
+		negative = true;
+		tp->pos++;
+	}
+	for (;;)
+	{
+		if (tp->pos >= tp->end)
+			return NULL;	/* unterminated bracket */
+		c = (cl_uchar) *tp->pos++;
+		if (c == ']' && !is_first)
+			break;
+		is_first = false;
+
+		if (c == '[' && tp->pos < tp->end &&
+			(*tp->pos == ':' || *tp->pos == '.' || *tp->pos == '='))
+			return NULL;	/* character class, collating element */
+		if (c == '\\')
+		{
+			if (tp->pos >= tp->end)
+				return NULL;
+			if (tpat_parse_class_escape(tp, *tp->pos, node))
+			{
+				tp->pos++;
+				continue;
+			}
+			c = tpat_parse_char_escape(*tp->pos++);
+			if (c < 0)
+				return NULL;
+		}
+		else if (tp->is_utf8 && (c & 0x80) != 0)
+			return NULL;	/* multi-byte character in bracket */
+
+		/* range expression? */
+		if (tp->pos + 1 < tp->end &&
+			tp->pos[0] == '-' && tp->pos[1] != ']')
+		{
+			lower = c;
+			c = (cl_uchar) tp->pos[1];
+			if (c == '\\' || c == '[' ||
+				(tp->is_utf8 && (c & 0x80) != 0) || lower > c)
+				return NULL;
+			tp->pos += 2;
+			for (; lower <= c; lower++)
+				tpat_add_byte(tp, node, lower);
+		}
+		else
+			tpat_add_byte(tp, node, c);
+	}
+	if (negative)
+		return tpat_make_anychar(tp, node->bset);
+	return node;
+}
+
+static tpat_node *tpat_parse_regex_alter(tpat_parser *tp, int depth);
+
+/*
+ * tpat_parse_regex_atom
+ */
+static tpat_node *
+tpat_parse_regex_atom(tpat_parser *tp, int depth)
+{
+	tpat_node  *node;
+	int			c;
+
+	switch (*tp->pos)
+	{
+		case '(':
+			tp->pos++;
+			if (tp->pos < tp->end && *tp->pos == '?')
+			{
+				/* only non-capturing group is supported */
+				if (tp->pos + 1 >= tp->end || tp->pos[1] != ':')
+					return NULL;
+				tp->pos += 2;
+			}
+			node = tpat_parse_regex_alter(tp, depth + 1);
+			if (!node || tp->pos >= tp->end || *tp->pos != ')')
+				return NULL;
+			tp->pos++;
+			return node;
+		case '.':
+			tp->pos++;
+			return tpat_make_anychar(tp, NULL);
+		case '[':
+			tp->pos++;
+			return tpat_parse_bracket(tp);
+		case '\\':
+			if (++tp->pos >= tp->end)
+				return NULL;
+			c = *tp->pos++;
+			if (c == 'D' || c == 'S' || c == 'W')
+			{
+				node = tpat_make_node(TPAT_BYTES);
+				if (!tpat_parse_class_escape(tp, c - 'A' + 'a', node))
+					return NULL;
+				return tpat_make_anychar(tp, node->bset);
+			}
+			node = tpat_make_node(TPAT_BYTES);
+			if (tpat_parse_class_escape(tp, c, node))
+				return node;
+			c = tpat_parse_char_escape(c);
+			if (c < 0)
+				return NULL;	/* back reference, constraint escape, ... */
+			tpat_add_byte(tp, node, c);
+			return node;
+		case '^':
+		case '$':
+		case ')':
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+			return NULL;	/* not supported, or syntax error */
+		default:
+			break;
+	}
+	return tpat_parse_literal(tp);
+}
+
+/*
+ * tpat_parse_regex_bound - bound of quantifier; {m}, {m,} or {m,n}
+ */
+static bool
+tpat_parse_regex_bound(tpat_parser *tp, int *p_min, int *p_max)
+{
+	int		min = 0;
+	int		max;
+	bool	has_digit = false;
+
+	while (tp->pos < tp->end && *tp->pos >= '0' && *tp->pos <= '9')
+	{
+		min = 10 * min + (*tp->pos++ - '0');
+		if (min > TEXT_DFA_MAX_REPEAT)
+			return false;
+		has_digit = true;
+	}
+	if (!has_digit || tp->pos >= tp->end)
+		return false;
+	if (*tp->pos == '}')
+		max = min;
+	else if (*tp->pos == ',')
+	{
+		tp->pos++;
+		if (tp->pos < tp->end && *tp->pos == '}')
+			max = -1;
+		else
+		{
+			has_digit = false;
+			max = 0;
+			while (tp->pos < tp->end && *tp->pos >= '0' && *tp->pos <= '9')
+			{
+				max = 10 * max + (*tp->pos++ - '0');
+				if (max > TEXT_DFA_MAX_REPEAT)
+					return false;
+				has_digit = true;
+			}
+			if (!has_digit || min > max ||
+				tp->pos >= tp->end || *tp->pos != '}')
+				return false;
+		}
+	}
+	else
+		return false;
+	tp->pos++;		/* '}' */
+	*p_min = min;
+	*p_max = max;
+	return true;
+}
+
+/*
+ * tpat_parse_regex_branch - sequence of atoms with quantifiers. '$' is
+ * allowed only at the tail of the top-level branch; *p_tail_anchored
+ * shall be set.
+ */
+static tpat_node *
+tpat_parse_regex_branch(tpat_parser *tp, int depth, bool *p_tail_anchored)
+{
+	tpat_node  *node = tpat_make_node(TPAT_CONCAT);
+	tpat_node  *atom;
+	int			min, max;
+
+	while (tp->pos < tp->end && *tp->pos != '|' && *tp->pos != ')')
+	{
+		if (*tp->pos == '$')
+		{
+			tp->pos++;
+			if (depth > 0 || !p_tail_anchored ||
+				(tp->pos < tp->end && *tp->pos != '|'))
+				return NULL;
+			*p_tail_anchored = true;
+			break;
+		}
+		atom = tpat_parse_regex_atom(tp, depth);
+		if (!atom)
+			return NULL;
+		if (tp->pos < tp->end)
+		{
+			switch (*tp->pos)
+			{
+				case '*':
+					tp->pos++;
+					atom = tpat_make_repeat(atom, 0, -1);
+					break;
+				case '+':
+					tp->pos++;
+					atom = tpat_make_repeat(atom, 1, -1);
+					break;
+				case '?':
+					tp->pos++;
+					atom = tpat_make_repeat(atom, 0, 1);
+					break;
+				case '{':
+					tp->pos++;
+					if (!tpat_parse_regex_bound(tp, &min, &max))
+						return NULL;
+					atom = tpat_make_repeat(atom, min, max);
+					break;
+				default:
+					goto next;
+			}
+			/* non-greedy quantifier makes no difference on match/unmatch */
+			if (tp->pos < tp->end && *tp->pos == '?')
+				tp->pos++;
+			/* multiple quantifiers are syntax error */
+			if (tp->pos < tp->end &&
+				(*tp->pos == '*' || *tp->pos == '+' ||
+				 *tp->pos == '?' || *tp->pos == '{'))
+				return NULL;
+		}
+	next:
+		node->items = lappend(node->items, atom);
+	}
+	return node;
+}
+
+/*
+ * tpat_parse_regex_alter - alternation of branches inside of the group
+ */
+static tpat_node *
+tpat_parse_regex_alter(tpat_parser *tp, int depth)
+{
+	tpat_node  *node = tpat_make_node(TPAT_ALTER);
+	tpat_node  *branch;
+
+	for (;;)
+	{
+		branch = tpat_parse_regex_branch(tp, depth, NULL);
+		if (!branch)
+			return NULL;
+		node->items = lappend(node->items, branch);
+		if (tp->pos >= tp->end || *tp->pos != '|')
+			break;
+		tp->pos++;
+	}
+	return node;
+}
+
+/*
+ * tpat_parse_regex - parser of regular expression. Unless top-level
+ * branch is anchored, it is wrapped by the sequence of any characters,
+ * because regular expression matches any part of the text.
+ */
+static tpat_node *
+tpat_parse_regex(tpat_parser *tp)
+{
+	tpat_node  *node = tpat_make_node(TPAT_ALTER);
+	tpat_node  *branch;
+	tpat_node  *temp;
+	bool		head_anchored;
+	bool		tail_anchored;
+
+	/* director like '***=' is not supported */
+	if (tp->end - tp->pos >= 3 && strncmp(tp->pos, "***", 3) == 0)
+		return NULL;
+
+	for (;;)
+	{
+		head_anchored = false;
+		tail_anchored = false;
+		if (tp->pos < tp->end && *tp->pos == '^')
+		{
+			head_anchored = true;
+			tp->pos++;
+		}
+		branch = tpat_parse_regex_branch(tp, 0, &tail_anchored);
+		if (!branch)
+			return NULL;
+		if (!head_anchored)
+		{
+			temp = tpat_make_repeat(tpat_make_anychar(tp, NULL), 0, -1);
+			branch->items = lcons(temp, branch->items);
+		}
+		if (!tail_anchored)
+		{
+			temp = tpat_make_repeat(tpat_make_byte_range(0x00, 0xff), 0, -1);
+			branch->items = lappend(branch->items, temp);
+		}
+		node->items = lappend(node->items, branch);
+
+		if (tp->pos >= tp->end)
+			break;
+		if (*tp->pos != '|')
+			return NULL;	/* unmatched parentheses */
+		tp->pos++;
+	}
+	return node;
+}
+
+/*
+ * NFA by Thompson's construction. State 0 is the accept state.
+ */
+typedef struct
+{
+	int			next1;		/* next state, or -1 */
+	int			next2;		/* next state (epsilon only), or -1 */
+	bits8	   *bset;		/* bytes to move next1, or NULL if epsilon */
+} tpat_nfa_state;
+
+typedef struct
+{
+	int			nstates;
+	int			nrooms;
+	tpat_nfa_state *states;
+} tpat_nfa;
+
+static int
+tpat_nfa_add_state(tpat_nfa *nfa, bits8 *bset, int next1, int next2)
+{
+	tpat_nfa_state *state;
+
+	if (nfa->nstates >= TEXT_DFA_MAX_NFA_STATES)
+		return -1;
+	if (nfa->nstates >= nfa->nrooms)
+	{
+		nfa->nrooms = 2 * nfa->nrooms;
+		nfa->states = repalloc(nfa->states,
+							   sizeof(tpat_nfa_state) * nfa->nrooms);
+	}
+	state = &nfa->states[nfa->nstates];
+	state->bset = bset;
+	state->next1 = next1;
+	state->next2 = next2;
+	return nfa->nstates++;
+}
+
+/*
+ * tpat_nfa_compile - it builds NFA states that match the node, then move
+ * to the 'next' state. It returns the entry state, or -1 on overflow.
+ */
+static int
+tpat_nfa_compile(tpat_nfa *nfa, tpat_node *node, int next)
+{
+	ListCell   *lc;
+	int			i, state;
+
+	if (next < 0)
+		return -1;
+	switch (node->kind)
+	{
+		case TPAT_BYTES:
+			return tpat_nfa_add_state(nfa, node->bset, next, -1);
+
+		case TPAT_CONCAT:
+			for (i = list_length(node->items) - 1; i >= 0; i--)
+			{
+				next = tpat_nfa_compile(nfa, list_nth(node->items, i), next);
+				if (next < 0)
+					return -1;
+			}
+			return next;
+
+		case TPAT_ALTER:
+			state = -1;
+			foreach (lc, node->items)
+			{
+				int		entry = tpat_nfa_compile(nfa, lfirst(lc), next);
+
+				if (entry < 0)
+					return -1;
+				state = (state < 0 ? entry
+						 : tpat_nfa_add_state(nfa, NULL, entry, state));
+				if (state < 0)
+					return -1;
+			}
+			return (state < 0 ? next : state);
+
+		case TPAT_REPEAT:
+			if (node->max < 0)
+			{
+				/* loop on the epsilon state */
+				state = tpat_nfa_add_state(nfa, NULL, -1, next);
+				if (state < 0)
+					return -1;
+				i = tpat_nfa_compile(nfa, node->sub, state);
+				if (i < 0)
+					return -1;
+				nfa->states[state].next1 = i;
+				next = state;
+			}
+			else
+			{
+				for (i = node->min; i < node->max; i++)
+				{
+					state = tpat_nfa_compile(nfa, node->sub, next);
+					next = tpat_nfa_add_state(nfa, NULL, state, next);
+					if (state < 0 || next < 0)
+						return -1;
+				}
+			}
+			for (i=0; i < node->min; i++)
+			{
+				next = tpat_nfa_compile(nfa, node->sub, next);
+				if (next < 0)
+					return -1;
+			}
+			return next;
+
+		default:
+			elog(ERROR, "Bug? unexpected text pattern node: %d",
+				 (int)node->kind);
+	}
+	return -1;
+}
+
+/* epsilon closure of the NFA states */
+static void
+tpat_nfa_closure(tpat_nfa *nfa, uint64 *nset, int *stack)
+{
+	int		depth = 0;
+	int		i, j, next;
+
+	for (i=0; i < nfa->nstates; i++)
+	{
+		if ((nset[i / 64] & (1UL << (i % 64))) != 0)
+			stack[depth++] = i;
+	}
+	while (depth > 0)
+	{
+		tpat_nfa_state *state = &nfa->states[stack[--depth]];
+
+		if (state->bset)
+			continue;
+		for (j=0; j < 2; j++)
+		{
+			next = (j == 0 ? state->next1 : state->next2);
+			if (next >= 0 && (nset[next / 64] & (1UL << (next % 64))) == 0)
+			{
+				nset[next / 64] |= (1UL << (next % 64));
+				stack[depth++] = next;
+			}
+		}
+	}
+}
+
+/*
+ * build_text_pattern_dfa
+ *
+ * It compiles the pattern into kern_text_dfa, and returns a bytea Const.
+ * If pattern is not supported, it returns NULL.
+ */
+static Const *
+build_text_pattern_dfa(text *pattern, bool is_regex, bool icase, Oid collid)
+{
+	MemoryContext	memcxt;
+	MemoryContext	oldcxt;
+	tpat_parser		tp;
+	tpat_node	   *node;
+	tpat_nfa		nfa;
+	HASHCTL			hctl;
+	HTAB		   *htab;
+	cl_uchar		classes[256];
+	cl_uchar		repr[256];
+	int				remap[512];
+	int				nclasses = 1;
+	int				nwords;
+	int				nstates;
+	int				nrooms;
+	uint64		  **dfa_nsets;
+	cl_ushort	   *trans;
+	int			   *stack;
+	uint64		   *nset;
+	uint64		   *entry;		/* set of NFA states, then DFA state */
+	kern_text_dfa  *dfa = NULL;
+	cl_uchar	   *flags;
+	int				entry_state;
+	int				i, j, c;
+	bool			found;
+
+	if (GetDatabaseEncoding() != PG_UTF8 &&
+		pg_database_encoding_max_length() != 1)
+		return NULL;
+
+	memcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "text pattern DFA",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(memcxt);
+
+	/* parse the pattern */
+	memset(&tp, 0, sizeof(tpat_parser));
+	tp.pos = VARDATA_ANY(pattern);
+	tp.end = tp.pos + VARSIZE_ANY_EXHDR(pattern);
+	tp.icase = icase;
+	tp.ctype_is_c = (OidIsValid(collid) && lc_ctype_is_c(collid));
+	tp.is_utf8 = (GetDatabaseEncoding() == PG_UTF8);
+	node = (is_regex ? tpat_parse_regex(&tp) : tpat_parse_like(&tp));
+	if (!node)
+		goto out;
+
+	/* NFA construction */
+	nfa.nrooms = 256;
+	nfa.nstates = 0;
+	nfa.states = palloc(sizeof(tpat_nfa_state) * nfa.nrooms);
+	tpat_nfa_add_state(&nfa, NULL, -1, -1);		/* accept state */
+	entry_state = tpat_nfa_compile(&nfa, node, 0);
+	if (entry_state < 0)
+		goto out;
+
+	/* equivalence classes of the input bytes */
+	memset(classes, 0, sizeof(classes));
+	for (i=0; i < nfa.nstates; i++)
+	{
+		bits8  *bset = nfa.states[i].bset;
+
+		if (!bset)
+			continue;
+		memset(remap, -1, sizeof(remap));
+		for (c=0, nclasses=0; c < 256; c++)
+		{
+			j = 2 * classes[c] + (TPAT_BSET_TEST(bset, c) ? 1 : 0);
+			if (remap[j] < 0)
+				remap[j] = nclasses++;
+			classes[c] = remap[j];
+		}
+	}
+	for (c=255; c >= 0; c--)
+		repr[classes[c]] = c;
+
+	/* DFA construction by subset construction */
+	nwords = (nfa.nstates + 63) / 64;
+	memset(&hctl, 0, sizeof(HASHCTL));
+	hctl.keysize = sizeof(uint64) * nwords;
+	hctl.entrysize = sizeof(uint64) * nwords + sizeof(int);
+	hctl.hcxt = memcxt;
+	htab = hash_create("text pattern DFA", 256, &hctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	nrooms = 64;
+	dfa_nsets = palloc(sizeof(uint64 *) * nrooms);
+	trans = palloc(sizeof(cl_ushort) * nrooms * nclasses);
+	stack = palloc(sizeof(int) * nfa.nstates);
+	nset = palloc0(sizeof(uint64) * nwords);
+
+	/* state 0 is the dead state */
+	entry = hash_search(htab, nset, HASH_ENTER, &found);
+	*((int *)(entry + nwords)) = 0;
+	dfa_nsets[0] = entry;
+	/* state 1 is the initial state */
+	nset[entry_state / 64] |= (1UL << (entry_state % 64));
+	tpat_nfa_closure(&nfa, nset, stack);
+	entry = hash_search(htab, nset, HASH_ENTER, &found);
+	*((int *)(entry + nwords)) = 1;
+	dfa_nsets[1] = entry;
+	nstates = 2;
+
+	for (i=0; i < nstates; i++)
+	{
+		for (c=0; c < nclasses; c++)
+		{
+			memset(nset, 0, sizeof(uint64) * nwords);
+			for (j=0; j < nfa.nstates; j++)
+			{
+				tpat_nfa_state *state = &nfa.states[j];
+
+				if ((dfa_nsets[i][j / 64] & (1UL << (j % 64))) != 0 &&
+					state->bset && TPAT_BSET_TEST(state->bset, repr[c]))
+					nset[state->next1 / 64] |= (1UL << (state->next1 % 64));
+			}
+			tpat_nfa_closure(&nfa, nset, stack);
+
+			entry = hash_search(htab, nset, HASH_ENTER, &found);
+			if (!found)
+			{
+				if (nstates >= TEXT_DFA_MAX_DFA_STATES ||
+					(nstates + 1) * nclasses > TEXT_DFA_MAX_TRANSITIONS)
+					goto out;
+				if (nstates >= nrooms)
+				{
+					nrooms *= 2;
+					dfa_nsets = repalloc(dfa_nsets,
+										 sizeof(uint64 *) * nrooms);
+					trans = repalloc(trans, (sizeof(cl_ushort) *
+											 nrooms * nclasses));
+				}
+				*((int *)(entry + nwords)) = nstates;
+				dfa_nsets[nstates++] = entry;
+			}
+			trans[i * nclasses + c] = *((int *)(entry + nwords));
+		}
+	}
+
+	/* OK, build a kern_text_dfa */
+	MemoryContextSwitchTo(oldcxt);
+	dfa = palloc0(KERN_TEXT_DFA_LENGTH(nstates, nclasses));
+	SET_VARSIZE(dfa, KERN_TEXT_DFA_LENGTH(nstates, nclasses));
+	dfa->nstates = nstates;
+	dfa->nclasses = nclasses;
+	dfa->start = 1;
+	memcpy(dfa->classes, classes, sizeof(classes));
+	memcpy(dfa->trans, trans, sizeof(cl_ushort) * nstates * nclasses);
+	flags = KERN_TEXT_DFA_FLAGS(dfa);
+	for (i=0; i < nstates; i++)
+	{
+		/* NFA state 0 is the accept state */
+		if ((dfa_nsets[i][0] & 1UL) == 0)
+			continue;
+		flags[i] |= KERN_TEXT_DFA_STATE_ACCEPT;
+		for (c=0; c < nclasses; c++)
+		{
+			if (trans[i * nclasses + c] != i)
+				break;
+		}
+		if (c == nclasses)
+			flags[i] |= KERN_TEXT_DFA_STATE_STICKY;
+	}
+out:
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(memcxt);
+	if (!dfa)
+		return NULL;
+	return makeConst(BYTEAOID, -1, InvalidOid, -1,
+					 PointerGetDatum(dfa), false, false);
+}
+
+/*
+ * text pattern matching functions that can run on the DFA
+ */
+static struct {
+	const char *func_devname;
+	bool		is_regex;
+	bool		icase;
+	bool		negate;
+} text_pattern_catalog[] = {
+	{ "textlike",      false, false, false },
+	{ "textnlike",     false, false, true },
+	{ "texticlike",    false, true,  false },
+	{ "texticnlike",   false, true,  true },
+	{ "textregexeq",   true,  false, false },
+	{ "textregexne",   true,  false, true },
+	{ "texticregexeq", true,  true,  false },
+	{ "texticregexne", true,  true,  true },
+};
+
+static int
+text_pattern_catalog_lookup(devfunc_info *dfunc)
+{
+	int		i;
+
+	for (i=0; i < lengthof(text_pattern_catalog); i++)
+	{
+		if (strcmp(dfunc->func_devname,
+				   text_pattern_catalog[i].func_devname) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * codegen_text_pattern_dfa
+ *
+ * It returns a bytea Const of kern_text_dfa, if the function is text
+ * pattern matching with a constant pattern being supported by the DFA.
+ * Elsewhere, NULL is returned.
+ */
+static Const *
+codegen_text_pattern_dfa(devfunc_info *dfunc, List *args, Oid collid)
+{
+	Const	   *con;
+	int			index;
+
+	index = text_pattern_catalog_lookup(dfunc);
+	if (index < 0 || list_length(args) != 2)
+		return NULL;
+	con = lsecond(args);
+	if (!IsA(con, Const) || con->constisnull ||
+		con->consttype != TEXTOID)
+		return NULL;
+	return build_text_pattern_dfa(DatumGetTextPP(con->constvalue),
+								  text_pattern_catalog[index].is_regex,
+								  text_pattern_catalog[index].icase,
+								  collid);
+}
+
+/*
+ * text_pattern_device_executable
+ *
+ * Regular expression is executable on the device only if its pattern can
+ * be compiled into the DFA.
+ */
+static bool
+text_pattern_device_executable(devfunc_info *dfunc, List *args, Oid collid)
+{
+	int			index = text_pattern_catalog_lookup(dfunc);
+	Const	   *dfa;
+
+	if (index < 0 || !text_pattern_catalog[index].is_regex)
+		return true;
+	dfa = codegen_text_pattern_dfa(dfunc, args, collid);
+	if (!dfa)
+		return false;
+	pfree(DatumGetPointer(dfa->constvalue));
+	pfree(dfa);
+	return true;
+}
+
+/*
+ * codegen_text_pattern_expression
+ *
+ * It generates a DFA based pattern matching, if available. It returns
+ * false if caller has to generate the usual function invocation.
+ */
+static bool
+codegen_text_pattern_expression(devfunc_info *dfunc, List *args, Oid collid,
+								codegen_context *context)
+{
+	devtype_info *dtype;
+	Node	   *expr;
+	Const	   *dfa;
+	int			index;
+
+	index = text_pattern_catalog_lookup(dfunc);
+	if (index < 0)
+		return false;
+	dfa = codegen_text_pattern_dfa(dfunc, args, collid);
+	if (!dfa)
+	{
+		if (text_pattern_catalog[index].is_regex)
+			elog(ERROR, "codegen: regular expression is not supported: %s",
+				 nodeToString(lsecond(args)));
+		return false;
+	}
+	appendStringInfo(&context->str, "pgfn_text_dfa_%s(kcxt, ",
+					 text_pattern_catalog[index].negate ? "nmatch" : "match");
+	dtype = linitial(dfunc->func_args);
+	expr = linitial(args);
+	if (dtype->type_oid == exprType(expr))
+		codegen_expression_walker(expr, context);
+	else
+	{
+		appendStringInfo(&context->str,
+						 "to_%s(", dtype->type_name);
+		codegen_expression_walker(expr, context);
+		appendStringInfo(&context->str, ")");
+	}
+	appendStringInfo(&context->str, ", ");
+	codegen_expression_walker((Node *) dfa, context);
+	appendStringInfo(&context->str, ")");
+
+	return true;
+}
+
+/*
+ * codegen_date_trunc_expression
+ *
+ * date_trunc() with a constant unit is folded to the device function that
+ * takes DTK_* value, instead of the unit decoding per row. The decoded value
+ * is delivered as an int4 kernel parameter, not a literal label, so queries
+ * which differ only in the unit share the same program cache entry.
+ * It returns false if caller has to generate the usual function invocation.
+ */
+static int date_trunc_units_catalog[] = {
+	DTK_MILLENNIUM,
+	DTK_CENTURY,
+	DTK_DECADE,
+	DTK_YEAR,
+	DTK_QUARTER,
+	DTK_MONTH,
+	DTK_WEEK,
+	DTK_DAY,
+	DTK_HOUR,
+	DTK_MINUTE,
+	DTK_SECOND,
+	DTK_MILLISEC,
+	DTK_MICROSEC,
+};
+
+static bool
+codegen_date_trunc_expression(devfunc_info *dfunc, List *args,
+							  codegen_context *context)
+{
+	const char *func_name;
+	Const	   *con;
+	text	   *units;
+	char	   *lowunits;
+	int			type, val;
+	int			i;
+
+	if (strcmp(dfunc->func_devname, "date_trunc_timestamp") == 0)
+		func_name = "timestamp_trunc_unit";
+	else if (strcmp(dfunc->func_devname, "date_trunc_timestamptz") == 0)
+		func_name = "timestamptz_trunc_unit";
+	else
+		return false;
+
+	Assert(list_length(args) == 2);
+	con = linitial(args);
+	if (!IsA(con, Const) || con->constisnull ||
+		con->consttype != TEXTOID)
+		return false;
+	units = DatumGetTextPP(con->constvalue);
+	lowunits = downcase_truncate_identifier(VARDATA_ANY(units),
+											VARSIZE_ANY_EXHDR(units),
+											false);
+	type = DecodeUnits(0, lowunits, &val);
+	pfree(lowunits);
+	if (type != UNITS)
+		return false;	/* let the device code raise CpuReCheck */
+	for (i=0; i < lengthof(date_trunc_units_catalog); i++)
+	{
+		if (date_trunc_units_catalog[i] == val)
+		{
+			Const  *unit = makeConst(INT4OID, -1, InvalidOid, sizeof(int32),
+									 Int32GetDatum(val), false, true);
+
+			appendStringInfo(&context->str, "pgfn_%s(kcxt, ", func_name);
+			codegen_expression_walker(lsecond(args), context);
+			appendStringInfo(&context->str, ", ");
+			codegen_expression_walker((Node *) unit, context);
+			appendStringInfo(&context->str, ".value)");
+			return true;
+		}
+	}
+	return false;
+}
+
 static void
 codegen_expression_walker(Node *node, codegen_context *context)
 {
@@ -2098,6 +3397,22 @@ codegen_expression_walker(Node *node, codegen_context *context)
 	if (node == NULL)
 		return;
 
+	/* reference to the common sub-expression already evaluated, if any */
+	if (context->cse_exprs != NIL)
+	{
+		int		index = 0;
+
+		foreach (cell, context->cse_exprs)
+		{
+			if (equal(node, lfirst(cell)))
+			{
+				appendStringInfo(&context->str, "CSE_%u", index);
+				return;
+			}
+			index++;
+		}
+	}
+
 	if (IsA(node, Const))
 	{
 		Const  *con = (Const *) node;
@@ -2209,7 +3524,10 @@ codegen_expression_walker(Node *node, codegen_context *context)
 			elog(ERROR, "codegen: failed to lookup device function: %s",
 				 format_procedure(func->funcid));
 		pgstrom_devfunc_track(context, dfunc);
-		codegen_function_expression(dfunc, func->args, context);
+		if (!codegen_text_pattern_expression(dfunc, func->args,
+											 func->inputcollid, context) &&
+			!codegen_date_trunc_expression(dfunc, func->args, context))
+			codegen_function_expression(dfunc, func->args, context);
 	}
 	else if (IsA(node, OpExpr) ||
 			 IsA(node, DistinctExpr))
@@ -2224,7 +3542,9 @@ codegen_expression_walker(Node *node, codegen_context *context)
 			elog(ERROR, "codegen: failed to lookup device function: %s",
 				 format_procedure(dfunc->func_oid));
 		pgstrom_devfunc_track(context, dfunc);
-		codegen_function_expression(dfunc, op->args, context);
+		if (!codegen_text_pattern_expression(dfunc, op->args,
+											 op->inputcollid, context))
+			codegen_function_expression(dfunc, op->args, context);
 	}
 	else if (IsA(node, NullTest))
 	{
@@ -2477,6 +3797,7 @@ codegen_expression_walker(Node *node, codegen_context *context)
 	{
 		ScalarArrayOpExpr *opexpr = (ScalarArrayOpExpr *) node;
 		Oid		func_oid = get_opcode(opexpr->opno);
+		Const  *hashset;
 		Node   *expr;
 
 		dfunc = pgstrom_devfunc_lookup(func_oid,
@@ -2490,6 +3811,25 @@ codegen_expression_walker(Node *node, codegen_context *context)
 		Assert(dfunc->func_rettype->type_oid == BOOLOID &&
 			   list_length(dfunc->func_args) == 2);
 
+		hashset = codegen_scalar_array_hashset(opexpr, dfunc);
+		if (hashset)
+		{
+			dtype = linitial(dfunc->func_args);
+			appendStringInfo(&context->str,
+							 "PG_SCALAR_ARRAY_HASH_OP(kcxt, pgfn_%s, "
+							 "pg_%s_comp_crc32, ",
+							 dfunc->func_devname,
+							 dtype->type_name);
+			codegen_expression_walker(linitial(opexpr->args), context);
+			appendStringInfo(&context->str, ", ");
+			codegen_expression_walker(lsecond(opexpr->args), context);
+			appendStringInfo(&context->str, ", ");
+			codegen_expression_walker((Node *) hashset, context);
+			appendStringInfo(&context->str, ")");
+			context->extra_flags |= DEVKERNEL_NEEDS_MATRIX;
+			return;
+		}
+
 		appendStringInfo(&context->str, "PG_SCALAR_ARRAY_OP(kcxt, pgfn_%s, ",
 						 dfunc->func_devname);
 		expr = linitial(opexpr->args);
@@ -2556,6 +3896,7 @@ pgstrom_codegen_expression(Node *expr, codegen_context *context)
 	walker_context.kds_index_label = context->kds_index_label;
 	walker_context.extra_flags = context->extra_flags;
 	walker_context.pseudo_tlist = context->pseudo_tlist;
+	walker_context.cse_exprs = context->cse_exprs;
 
 	if (IsA(expr, List))
 	{
@@ -2588,6 +3929,138 @@ pgstrom_codegen_expression(Node *expr, codegen_context *context)
 	return walker_context.str.data;
 }
 
+/*
+ * pgstrom_codegen_common_subexprs
+ *
+ * It picks up the sub-expressions which appear more than once in the
+ * supplied expressions list, and are evaluated unconditionally at least
+ * once; not only under CASE or the second or later arguments of AND/OR. Declarations of the kernel local variables (CSE_n) are written on
+ * the 'decl', and code to evaluate them on the 'body'. Once registered to
+ * the context, the walker references the variable instead of the evaluation
+ * of sub-expression, until caller resets context->cse_exprs at the end of
+ * the kernel function.
+ */
+typedef struct
+{
+	Node	   *expr;
+	int			refcnt;			/* number of the occurrences */
+	bool		unconditional;	/* evaluated regardless of the conditions */
+} codegen_cse_candidate;
+
+typedef struct
+{
+	List	   *candidates;		/* list of codegen_cse_candidate */
+	bool		conditional;	/* under CASE, or AND/OR short-circuit */
+} codegen_cse_context;
+
+static bool
+codegen_cse_walker(Node *node, codegen_cse_context *cse_cxt)
+{
+	codegen_cse_candidate *cand;
+	ListCell   *lc;
+
+	if (!node)
+		return false;
+	if (IsA(node, CaseExpr))
+	{
+		/* CASE ... WHEN is evaluated by ternary operators */
+		bool	saved_conditional = cse_cxt->conditional;
+
+		cse_cxt->conditional = true;
+		expression_tree_walker(node, codegen_cse_walker, cse_cxt);
+		cse_cxt->conditional = saved_conditional;
+		return false;
+	}
+	if (IsA(node, BoolExpr) &&
+		((BoolExpr *) node)->boolop != NOT_EXPR)
+	{
+		/* only the first argument is evaluated always, if short-circuited */
+		BoolExpr   *b = (BoolExpr *) node;
+		bool		saved_conditional = cse_cxt->conditional;
+
+		foreach (lc, b->args)
+		{
+			codegen_cse_walker((Node *) lfirst(lc), cse_cxt);
+			cse_cxt->conditional = true;
+		}
+		cse_cxt->conditional = saved_conditional;
+		return false;
+	}
+	/* sub-expressions shall be listed prior to the parent */
+	expression_tree_walker(node, codegen_cse_walker, cse_cxt);
+
+	if (!IsA(node, FuncExpr) && !IsA(node, OpExpr))
+		return false;
+	foreach (lc, cse_cxt->candidates)
+	{
+		cand = lfirst(lc);
+		if (equal(node, cand->expr))
+		{
+			cand->refcnt++;
+			if (!cse_cxt->conditional)
+				cand->unconditional = true;
+			return false;
+		}
+	}
+	cand = palloc0(sizeof(codegen_cse_candidate));
+	cand->expr = node;
+	cand->refcnt = 1;
+	cand->unconditional = !cse_cxt->conditional;
+	cse_cxt->candidates = lappend(cse_cxt->candidates, cand);
+
+	return false;
+}
+
+void
+pgstrom_codegen_common_subexprs(StringInfo decl, StringInfo body,
+								List *exprs_list,
+								codegen_context *context)
+{
+	codegen_cse_context cse_cxt;
+	ListCell   *lc;
+
+	memset(&cse_cxt, 0, sizeof(codegen_cse_context));
+	foreach (lc, exprs_list)
+	{
+		Node   *expr = lfirst(lc);
+
+		/* implicit AND, as pgstrom_codegen_expression doing */
+		if (IsA(expr, List))
+		{
+			if (list_length((List *)expr) == 1)
+				expr = (Node *)linitial((List *)expr);
+			else
+				expr = (Node *)make_andclause((List *)expr);
+		}
+		codegen_cse_walker(expr, &cse_cxt);
+	}
+
+	foreach (lc, cse_cxt.candidates)
+	{
+		codegen_cse_candidate *cand = lfirst(lc);
+		devtype_info   *dtype;
+		char		   *expr_code;
+
+		if (cand->refcnt < 2 || !cand->unconditional)
+			continue;
+		if (contain_volatile_functions(cand->expr))
+			continue;
+		dtype = pgstrom_devtype_lookup_and_track(exprType(cand->expr),
+												 context);
+		if (!dtype)
+			continue;
+		/* it may reference the common sub-expressions already registered */
+		expr_code = pgstrom_codegen_expression(cand->expr, context);
+		appendStringInfo(decl, "  pg_%s_t CSE_%u;\n",
+						 dtype->type_name,
+						 list_length(context->cse_exprs));
+		appendStringInfo(body, "  CSE_%u = %s;\n",
+						 list_length(context->cse_exprs),
+						 expr_code);
+		context->cse_exprs = lappend(context->cse_exprs, cand->expr);
+	}
+}
+
 /*
  * pgstrom_codegen_param_declarations
  */
@@ -2636,6 +4109,63 @@ pgstrom_codegen_param_declarations(StringInfo buf, codegen_context *context)
 	lnext:
 		index++;
 	}
+	/*
+	 * varlena datum constructed on the previous row is no longer valid.
+	 * It is no-op if kern_context has no varlena buffer, and we cannot know
+	 * at this point whether the program will have, so always emit it.
+	 */
+	appendStringInfoString(buf, "  kern_context_reset_varlena(kcxt);\n");
+}
+
+/*
+ * pgstrom_codegen_column_vectors
+ *
+ * It generates declaration of the column-vector references (kern_colvec)
+ * on the shared memory, and <prefix>_colvec_setup() routine that has to be
+ * called once per thread-block (followed by __syncthreads()) prior to the
+ * column-format evaluation. 'colidx_list' is an integer list of the
+ * zero-origin column index; its N-th item is referenced by
+ * kern_colvec_datum(&<prefix>_cvec[N],row_index) in the generated code.
+ */
+void
+pgstrom_codegen_column_vectors(StringInfo kern,
+							   const char *prefix,
+							   List *colidx_list)
+{
+	ListCell   *lc;
+	int			index = 0;
+
+	if (colidx_list != NIL)
+		appendStringInfo(
+			kern,
+			"static __shared__ kern_colvec %s_cvec[%d];\n\n",
+			prefix, list_length(colidx_list));
+	appendStringInfo(
+		kern,
+		"STATIC_FUNCTION(void)\n"
+		"%s_colvec_setup(kern_data_store *kds)\n"
+		"{\n",
+		prefix);
+	if (colidx_list != NIL)
+	{
+		appendStringInfoString(
+			kern,
+			"  if (get_local_id() == 0)\n"
+			"  {\n");
+		foreach (lc, colidx_list)
+		{
+			appendStringInfo(
+				kern,
+				"    kern_colvec_init(&%s_cvec[%d], kds, %d);\n",
+				prefix, index++, lfirst_int(lc));
+		}
+		appendStringInfoString(
+			kern,
+			"  }\n");
+	}
+	appendStringInfoString(
+		kern,
+		"}\n\n");
 }
 
 /*
@@ -2707,11 +4237,16 @@ __pgstrom_device_expression(Expr *expr, const char *filename, int lineno)
 	else if (IsA(expr, FuncExpr))
 	{
 		FuncExpr   *func = (FuncExpr *) expr;
+		devfunc_info *dfunc;
 
-		if (!pgstrom_devfunc_lookup(func->funcid,
-									func->funcresulttype,
-									func->args,
-									func->inputcollid))
+		dfunc = pgstrom_devfunc_lookup(func->funcid,
+									   func->funcresulttype,
+									   func->args,
+									   func->inputcollid);
+		if (!dfunc)
+			goto unable_node;
+		if (!text_pattern_device_executable(dfunc, func->args,
+											func->inputcollid))
 			goto unable_node;
 		return __pgstrom_device_expression((Expr *) func->args,
 										   filename, lineno);
@@ -2719,11 +4254,16 @@ __pgstrom_device_expression(Expr *expr, const char *filename, int lineno)
 	else if (IsA(expr, OpExpr) || IsA(expr, DistinctExpr))
 	{
 		OpExpr	   *op = (OpExpr *) expr;
+		devfunc_info *dfunc;
 
-		if (!pgstrom_devfunc_lookup(get_opcode(op->opno),
-									op->opresulttype,
-									op->args,
-									op->inputcollid))
+		dfunc = pgstrom_devfunc_lookup(get_opcode(op->opno),
+									   op->opresulttype,
+									   op->args,
+									   op->inputcollid);
+		if (!dfunc)
+			goto unable_node;
+		if (!text_pattern_device_executable(dfunc, op->args,
+											op->inputcollid))
 			goto unable_node;
 		return __pgstrom_device_expression((Expr *) op->args,
 										   filename, lineno);
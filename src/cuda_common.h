@@ -265,11 +265,18 @@ typedef uintptr_t		hostptr_t;
 #define StromKernel_gpuscan_exec_quals_column		0x0103
 #define StromKernel_gpujoin_main					0x0201
 #define StromKernel_gpujoin_right_outer				0x0202
+#define StromKernel_gpujoin_main_persistent			0x0203
 #define StromKernel_gpupreagg_setup_row				0x0301
 #define StromKernel_gpupreagg_setup_block			0x0302
 #define StromKernel_gpupreagg_setup_column			0x0303
 #define StromKernel_gpupreagg_nogroup_reduction		0x0304
 #define StromKernel_gpupreagg_groupby_reduction		0x0305
+#define StromKernel_gpusort_setup_row				0x0401
+#define StromKernel_gpusort_bitonic_local			0x0402
+#define StromKernel_gpusort_bitonic_step			0x0403
+#define StromKernel_gpusort_bitonic_merge			0x0404
+#define StromKernel_gpuwinagg_setup_row				0x0601
+#define StromKernel_gpuwinagg_setup_flags			0x0602
 #define StromKernel_plcuda_prep_kernel				0x0501
 #define StromKernel_plcuda_main_kernel				0x0502
 #define StromKernel_plcuda_post_kernel				0x0503
@@ -285,15 +292,37 @@ typedef struct
 
 /*
  * kern_context - a set of run-time information
+ *
+ * If KERN_CONTEXT_VARLENA_BUFSZ is defined prior to the cuda_common.h,
+ * kern_context also has a small per-thread buffer to construct varlena
+ * datum on the fly (e.g, text extracted from jsonb, or inline-compressed
+ * datum decompressed on reference). It is valid only during evaluation
+ * of a row, because generated code resets the buffer at the head of each
+ * expression function.
  */
 struct kern_parambuf;
 
+#ifndef KERN_CONTEXT_VARLENA_BUFSZ
+#define KERN_CONTEXT_VARLENA_BUFSZ		0
+#endif
+
 typedef struct
 {
 	kern_errorbuf	e;
 	struct kern_parambuf *kparams;
+	cl_ulong		rand_state;	/* state of the device random(), if used */
+#if KERN_CONTEXT_VARLENA_BUFSZ > 0
+	cl_uint			vlpos;
+	cl_ulong		vlbuf[KERN_CONTEXT_VARLENA_BUFSZ / sizeof(cl_ulong)];
+#endif
 } kern_context;
 
+#if KERN_CONTEXT_VARLENA_BUFSZ > 0
+#define INIT_KERNEL_CONTEXT_VARLENA(kcxt)	((kcxt)->vlpos = 0)
+#else
+#define INIT_KERNEL_CONTEXT_VARLENA(kcxt)	((void)0)
+#endif
+
 #define INIT_KERNEL_CONTEXT(kcxt,kfunction,__kparams)		\
 	do {													\
 		(kcxt)->e.errcode = StromError_Success;				\
@@ -301,9 +330,55 @@ typedef struct
 		(kcxt)->e.lineno = 0;								\
 		(kcxt)->e.filename[0] = '\0';						\
 		(kcxt)->kparams = (__kparams);						\
+		(kcxt)->rand_state = 0;								\
+		INIT_KERNEL_CONTEXT_VARLENA(kcxt);					\
 		assert((cl_ulong)(__kparams) == MAXALIGN(__kparams));	\
 	} while(0)
 
+#ifdef __CUDACC__
+/*
+ * kern_context_alloc - allocation of the per-thread varlena buffer.
+ * It returns NULL if no buffer or no room; caller shall set CpuReCheck.
+ */
+STATIC_INLINE(void *)
+kern_context_alloc(kern_context *kcxt, cl_uint len)
+{
+#if KERN_CONTEXT_VARLENA_BUFSZ > 0
+	char	   *pos = (char *)kcxt->vlbuf + kcxt->vlpos;
+
+	len = MAXALIGN(len);
+	if (kcxt->vlpos + len <= KERN_CONTEXT_VARLENA_BUFSZ)
+	{
+		kcxt->vlpos += len;
+		return pos;
+	}
+#endif
+	return NULL;
+}
+
+STATIC_INLINE(void)
+kern_context_reset_varlena(kern_context *kcxt)
+{
+	INIT_KERNEL_CONTEXT_VARLENA(kcxt);
+}
+
+/*
+ * kern_context_check_varlena - varlena datum on the per-thread buffer
+ * shall not be written out as a pointer, because the buffer is reused
+ * by the next row. Caller falls back to CPU in this case.
+ */
+STATIC_INLINE(void)
+kern_context_check_varlena(kern_context *kcxt, cl_bool isnull, void *ptr)
+{
+#if KERN_CONTEXT_VARLENA_BUFSZ > 0
+	if (!isnull &&
+		(char *)ptr >= (char *)kcxt->vlbuf &&
+		(char *)ptr <  (char *)kcxt->vlbuf + KERN_CONTEXT_VARLENA_BUFSZ)
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+#endif
+}
+#endif	/* __CUDACC__ */
+
 /*
  * It sets an error code unless no significant error code is already set.
  * Also, CpuReCheck has higher priority than RowFiltered because CpuReCheck
@@ -529,6 +604,19 @@ typedef struct {
 #define HEAP_COMBOCID			0x0020	/* t_cid is a combo cid */
 #define HEAP_XMAX_EXCL_LOCK		0x0040	/* xmax is exclusive locker */
 #define HEAP_XMAX_LOCK_ONLY		0x0080	/* xmax, if valid, is only a locker */
+#define HEAP_XMAX_SHR_LOCK		(HEAP_XMAX_EXCL_LOCK | HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_LOCK_MASK			(HEAP_XMAX_SHR_LOCK | HEAP_XMAX_EXCL_LOCK | \
+								 HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_XMIN_COMMITTED		0x0100	/* t_xmin committed */
+#define HEAP_XMIN_INVALID		0x0200	/* t_xmin invalid/aborted */
+#define HEAP_XMIN_FROZEN		(HEAP_XMIN_COMMITTED|HEAP_XMIN_INVALID)
+#define HEAP_XMAX_COMMITTED		0x0400	/* t_xmax committed */
+#define HEAP_XMAX_INVALID		0x0800	/* t_xmax invalid/aborted */
+#define HEAP_XMAX_IS_MULTI		0x1000	/* t_xmax is a MultiXactId */
+
+#define HEAP_XMAX_IS_LOCKED_ONLY(infomask)						\
+	(((infomask) & HEAP_XMAX_LOCK_ONLY) != 0 ||					\
+	 ((infomask) & (HEAP_XMAX_IS_MULTI | HEAP_LOCK_MASK)) == HEAP_XMAX_EXCL_LOCK)
 
 /*
  * information stored in t_infomask2:
@@ -648,7 +736,7 @@ typedef struct
 	cl_uint				hash;	/* 32-bit hash value */
 	cl_uint				next;	/* offset of the next */
 	cl_uint				rowid;	/* unique identifier of this hash entry */
-	cl_uint				__padding__; /* for alignment */
+	cl_uint				hindex;	/* index on the packed buckets, if any */
 	kern_tupitem		t;		/* HeapTuple of this entry */
 } kern_hashitem;
 
@@ -671,6 +759,7 @@ typedef struct {
 	cl_char			format;		/* one of KDS_FORMAT_* above */
 	cl_char			has_notbyval; /* true, if any of column is !attbyval */
 	cl_char			tdhasoid;	/* copy of TupleDesc.tdhasoid */
+	cl_char			hash_packed; /* true, if packed buckets (only HASH) */
 	cl_uint			tdtypeid;	/* copy of TupleDesc.tdtypeid */
 	cl_int			tdtypmod;	/* copy of TupleDesc.tdtypmod */
 	cl_uint			table_oid;	/* OID of the table (only if GpuScan) */
@@ -679,6 +768,8 @@ typedef struct {
 	cl_uint			hash_max;	/* maximum hash-value (only HASH format) */
 	cl_uint			nrows_per_block; /* average number of rows per
 									  * PostgreSQL block (only BLOCK format) */
+	cl_uint			index_offset; /* offset to the hash-index, if any (only
+								   * COLUMN format); with 3bits-shift */
 	kern_colmeta	colmeta[FLEXIBLE_ARRAY_MEMBER]; /* metadata of columns */
 } kern_data_store;
 
@@ -710,6 +801,24 @@ typedef struct {
 #define KDS_CALCULATE_HASH_LENGTH(ncols,nitems,data_len)	\
 	(KDS_CALCULATE_FRONTEND_LENGTH((ncols),__KDS_NSLOTS(nitems),(nitems)) +	\
 	 MAXALIGN(data_len))
+/*
+ * Packed buckets of KDS_FORMAT_HASH
+ *
+ * If the inner hash table has enough room, items of the same hash slot are
+ * also listed contiguously on the hash_tags[] (32-bit hash value of the
+ * items) and hash_refs[] (offset of the items) next to the hash_slot[],
+ * then hash_slot[] has the index of the first item of the slot, instead of
+ * the offset; hash_slot[nslots] is a sentinel. So, a probe compares the
+ * hash values packed in a few cache lines, then touches the tuples with
+ * the same hash value only, instead of the walk on the chain by the
+ * dependent loads. Items are also chained in the same order, for the code
+ * which walks on the whole chain of a slot.
+ */
+#define KDS_CALCULATE_PACKED_FRONTEND_LENGTH(ncols,nslots,nitems)	\
+	(KDS_CALCULATE_HEAD_LENGTH(ncols) +				\
+	 STROMALIGN(sizeof(cl_uint) * (nitems)) +		\
+	 STROMALIGN(sizeof(cl_uint) * ((nslots) + 1)) +	\
+	 2 * STROMALIGN(sizeof(cl_uint) * (nitems)))
 #define KDS_CALCULATE_SLOT_LENGTH(ncols,nitems)	\
 	(KDS_CALCULATE_HEAD_LENGTH(ncols) +			\
 	 LONGALIGN((sizeof(Datum) +					\
@@ -766,16 +875,36 @@ KDS_ROW_REF_HTUP(kern_data_store *kds,
 	 ((char *)KERN_DATA_STORE_TUPITEM(kds,kds_index) -	\
 	  offsetof(kern_hashitem, t)))
 
+/* access macro for packed buckets of hash-format */
+#define KERN_DATA_STORE_HASHTAGS(kds)				\
+	((cl_uint *)((char *)KERN_DATA_STORE_HASHSLOT(kds) +	\
+				 STROMALIGN(sizeof(cl_uint) * ((kds)->nslots + 1))))
+#define KERN_DATA_STORE_HASHREFS(kds)				\
+	((cl_uint *)((char *)KERN_DATA_STORE_HASHTAGS(kds) +	\
+				 STROMALIGN(sizeof(cl_uint) * (kds)->nitems)))
+
 STATIC_INLINE(kern_hashitem *)
-KERN_HASH_FIRST_ITEM(kern_data_store *kds, cl_uint hash)
+KERN_HASH_SLOT_FIRST_ITEM(kern_data_store *kds, cl_uint index)
 {
 	cl_uint	   *slot = KERN_DATA_STORE_HASHSLOT(kds);
-	cl_uint		index = hash % kds->nslots;
+	cl_uint		offset;
 
-	if (slot[index] == 0)
+	if (!kds->hash_packed)
+		offset = slot[index];
+	else if (slot[index] == slot[index+1])
+		offset = 0;
+	else
+		offset = KERN_DATA_STORE_HASHREFS(kds)[slot[index]];
+	if (offset == 0)
 		return NULL;
-	Assert(slot[index] < kds->length);
-	return (kern_hashitem *)((char *)kds + slot[index]);
+	Assert(offset < kds->length);
+	return (kern_hashitem *)((char *)kds + offset);
+}
+
+STATIC_INLINE(kern_hashitem *)
+KERN_HASH_FIRST_ITEM(kern_data_store *kds, cl_uint hash)
+{
+	return KERN_HASH_SLOT_FIRST_ITEM(kds, hash % kds->nslots);
 }
 
 STATIC_INLINE(kern_hashitem *)
@@ -787,9 +916,87 @@ KERN_HASH_NEXT_ITEM(kern_data_store *kds, kern_hashitem *khitem)
 	return (kern_hashitem *)((char *)kds + khitem->next);
 }
 
+/*
+ * KERN_HASH_FIRST_MATCH / KERN_HASH_NEXT_MATCH
+ *
+ * They return the items with the same hash value only. On the packed
+ * buckets, the hash values are compared without touching the items.
+ */
+STATIC_INLINE(kern_hashitem *)
+__KERN_HASH_PACKED_MATCH(kern_data_store *kds, cl_uint hash, cl_uint k)
+{
+	cl_uint	   *tags = KERN_DATA_STORE_HASHTAGS(kds);
+	cl_uint		end = KERN_DATA_STORE_HASHSLOT(kds)[hash % kds->nslots + 1];
+
+	for (; k < end; k++)
+	{
+		if (__ldg(&tags[k]) == hash)
+			return (kern_hashitem *)
+				((char *)kds + __ldg(&KERN_DATA_STORE_HASHREFS(kds)[k]));
+	}
+	return NULL;
+}
+
+STATIC_INLINE(kern_hashitem *)
+KERN_HASH_FIRST_MATCH(kern_data_store *kds, cl_uint hash)
+{
+	kern_hashitem  *khitem;
+
+	if (kds->hash_packed)
+		return __KERN_HASH_PACKED_MATCH(kds, hash,
+				KERN_DATA_STORE_HASHSLOT(kds)[hash % kds->nslots]);
+	for (khitem = KERN_HASH_FIRST_ITEM(kds, hash);
+		 khitem && khitem->hash != hash;
+		 khitem = KERN_HASH_NEXT_ITEM(kds, khitem));
+	return khitem;
+}
+
+STATIC_INLINE(kern_hashitem *)
+KERN_HASH_NEXT_MATCH(kern_data_store *kds, kern_hashitem *khitem)
+{
+	cl_uint		hash;
+
+	if (!khitem)
+		return NULL;
+	hash = khitem->hash;
+	if (kds->hash_packed)
+		return __KERN_HASH_PACKED_MATCH(kds, hash, khitem->hindex + 1);
+	do {
+		khitem = KERN_HASH_NEXT_ITEM(kds, khitem);
+	} while (khitem && khitem->hash != hash);
+	return khitem;
+}
+
 #define KDS_HASH_REF_HTUP(kds,tup_offset,p_self,p_len)	\
 	KDS_HASH_REF_HTUP((kds),(tup_offset),(p_self),(p_len))
 
+/*
+ * kern_colindex - hash-index on a column of KDS_FORMAT_COLUMN
+ *
+ * gstore_fdw may have a hash-index on a column at the tail of the device
+ * image. It has the packed buckets like KDS_FORMAT_HASH; hash_slot[] has
+ * the position of the first entry of the slot, then hash_tags[] (32-bit
+ * hash value) and hash_rows[] (row index in the KDS) of the entries follow.
+ * The hash value is calculated by the same logic of GpuHashJoin, and rows
+ * with NULL key are not indexed.
+ */
+typedef struct
+{
+	cl_uint			attnum;		/* attribute number of the key column */
+	cl_uint			nslots;		/* width of the hash-slot */
+	cl_uint			hash_slot[FLEXIBLE_ARRAY_MEMBER];
+} kern_colindex;
+
+#define KDS_CALCULATE_COLINDEX_LENGTH(nslots,nitems)			\
+	MAXALIGN(offsetof(kern_colindex, hash_slot[(nslots) + 1 + 2 * (nitems)]))
+#define KERN_DATA_STORE_COLINDEX(kds)							\
+	((kds)->index_offset == 0 ? NULL : (kern_colindex *)		\
+	 ((char *)(kds) + ((size_t)(kds)->index_offset << MAXIMUM_ALIGNOF_SHIFT)))
+#define KERN_COLINDEX_NITEMS(kci)		((kci)->hash_slot[(kci)->nslots])
+#define KERN_COLINDEX_HASHTAGS(kci)		((kci)->hash_slot + (kci)->nslots + 1)
+#define KERN_COLINDEX_HASHROWS(kci)								\
+	(KERN_COLINDEX_HASHTAGS(kci) + KERN_COLINDEX_NITEMS(kci))
+
 /* access macro for tuple-slot format */
 #define KERN_DATA_STORE_SLOT_LENGTH(kds,nitems)				\
 	KDS_CALCULATE_SLOT_LENGTH((kds)->ncols,(nitems))
@@ -821,6 +1028,8 @@ KERN_HASH_NEXT_ITEM(kern_data_store *kds, kern_hashitem *khitem)
  * scan, so it may make sense if it is obvious length of kern_parambuf is
  * less than constant memory (NOTE: not implemented yet).
  */
+#define KPARAMS_NUM_COMMITTED_XIDS		14
+
 typedef struct kern_parambuf
 {
 	hostptr_t	hostptr;	/* address of the parambuf on host-side */
@@ -829,6 +1038,16 @@ typedef struct kern_parambuf
 	 * Fields of system information on execution
 	 */
 	cl_long		xactStartTimestamp;	/* timestamp when transaction start */
+	cl_uint		xactSnapshotXmin;	/* xmin of the scan snapshot, or zero if
+									 * GPU cannot check MVCC visibility */
+	cl_uint		nCommittedXids;		/* # of valid items in committedXids */
+	cl_uint		committedXids[KPARAMS_NUM_COMMITTED_XIDS];
+									/* xids known to be committed prior to
+									 * the xactSnapshotXmin */
+	cl_ulong	random_seed;		/* seed of the device random() */
+	cl_ulong	tablesample_cutoff;	/* TABLESAMPLE BERNOULLI picks up tuples
+									 * with hash less than this value */
+	cl_uint		tablesample_seed;	/* seed of TABLESAMPLE BERNOULLI */
 
 	/* variable length parameters / constants */
 	cl_uint		length;		/* total length of parambuf */
@@ -1516,6 +1735,23 @@ toast_decompress_datum(char *buffer, cl_uint buflen,
 	return true;
 }
 
+/*
+ * kern_context_decompress - decompress an inline-compressed varlena datum
+ * onto the per-thread varlena buffer. It returns NULL if datum is too large
+ * to stage, or corrupted; caller shall set CpuReCheck then.
+ */
+STATIC_INLINE(varlena *)
+kern_context_decompress(kern_context *kcxt, const struct varlena *datum)
+{
+	cl_uint		vl_len = TOAST_COMPRESS_RAWSIZE(datum) + VARHDRSZ;
+	char	   *vl_buf;
+
+	vl_buf = (char *)kern_context_alloc(kcxt, vl_len);
+	if (!vl_buf || !toast_decompress_datum(vl_buf, vl_len, datum))
+		return NULL;
+	return (varlena *)vl_buf;
+}
+
 /*
  * template to reference variable length variables
  */
@@ -1531,16 +1767,21 @@ toast_decompress_datum(char *buffer, cl_uint buflen,
 																\
 		if (!datum)												\
 			result.isnull = true;								\
-		else if (!VARATT_IS_4B_U(datum) &&						\
-				 !VARATT_IS_1B(datum))							\
+		else if (VARATT_IS_4B_U(datum) || VARATT_IS_1B(datum))	\
 		{														\
-			result.isnull = true;								\
-			STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);	\
+			result.isnull = false;								\
+			result.value = (varlena *)datum;					\
 		}														\
-		else													\
+		else if (VARATT_IS_COMPRESSED(datum) &&					\
+				 (result.value = kern_context_decompress(kcxt,	\
+									(varlena *)datum)) != NULL)	\
 		{														\
 			result.isnull = false;								\
-			result.value = (varlena *)datum;					\
+		}														\
+		else													\
+		{														\
+			result.isnull = true;								\
+			STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);	\
 		}														\
 		return result;											\
 	}															\
@@ -1849,6 +2090,91 @@ kern_get_datum_column(kern_data_store *kds,
 	return (void *)values;
 }
 
+/*
+ * kern_colvec - column-vector reference on KDS_FORMAT_COLUMN
+ *
+ * It caches the location of values and nullmap of a particular column
+ * once per thread-block, instead of walking on the kern_colmeta for each
+ * row. Threads in a warp reference consecutive rows, so loads of the
+ * fixed-length values are coalesced, and a 32bit word of the nullmap
+ * covers a warp's worth of rows.
+ */
+typedef struct
+{
+	char	   *values;		/* NULL, if column is not loaded */
+	cl_uint	   *nullmap;	/* NULL, if column has no NULLs */
+	cl_int		unitsz;		/* -1 for varlena, 0 for tableoid */
+} kern_colvec;
+
+STATIC_FUNCTION(void)
+kern_colvec_init(kern_colvec *cvec, kern_data_store *kds, cl_uint colidx)
+{
+	kern_colmeta *cmeta;
+	size_t		offset;
+	cl_uint		extra_sz;
+
+	Assert(colidx < kds->ncols);
+	cmeta = &kds->colmeta[colidx];
+	cvec->nullmap = NULL;
+	if (cmeta->attnum == TableOidAttributeNumber)
+	{
+		cvec->values = (char *)&kds->table_oid;
+		cvec->unitsz = 0;
+		return;
+	}
+	offset = __ldg(&cmeta->va_offset) << MAXIMUM_ALIGNOF_SHIFT;
+	if (offset == 0)
+	{
+		cvec->values = NULL;
+		cvec->unitsz = 0;
+		return;
+	}
+	cvec->values = (char *)kds + offset;
+	if (__ldg(&cmeta->attlen) < 0)
+	{
+		Assert(!__ldg(&cmeta->attbyval));
+		cvec->unitsz = -1;
+		return;
+	}
+	cvec->unitsz = TYPEALIGN(__ldg(&cmeta->attalign),
+							 __ldg(&cmeta->attlen));
+	extra_sz = __ldg(&cmeta->extra_sz) << MAXIMUM_ALIGNOF_SHIFT;
+	if (extra_sz > 0)
+	{
+		Assert(MAXALIGN(BITMAPLEN(__ldg(&kds->nitems))) == extra_sz);
+		cvec->nullmap = (cl_uint *)(cvec->values +
+									MAXALIGN(cvec->unitsz *
+											 __ldg(&kds->nitems)));
+	}
+}
+
+STATIC_INLINE(void *)
+kern_colvec_datum(kern_colvec *cvec, cl_uint rowidx)
+{
+	char	   *values = cvec->values;
+	cl_int		unitsz = cvec->unitsz;
+
+	if (!values)
+		return NULL;
+	if (unitsz < 0)
+	{
+		cl_uint		offset = __ldg((cl_uint *)values + rowidx);
+
+		if (offset == 0)
+			return NULL;
+		return values + ((size_t)offset << MAXIMUM_ALIGNOF_SHIFT);
+	}
+	if (cvec->nullmap)
+	{
+		/* nullmap is MAXALIGN'ed, and bits are in little endian */
+		cl_uint		bitmap = __ldg(cvec->nullmap + (rowidx >> 5));
+
+		if ((bitmap & (1U << (rowidx & 31))) == 0)
+			return NULL;
+	}
+	return values + unitsz * rowidx;
+}
+
 STATIC_INLINE(void *)
 kern_get_datum(kern_data_store *kds,
 			   cl_uint colidx, cl_uint rowidx)
@@ -28,19 +28,58 @@ typedef struct
 	cl_uint			pg_crc32_table[256];	/* used to hashjoin */
 	cl_ulong		kmrels_length;	/* length of kern_multirels */
 	cl_ulong		ojmaps_length;	/* length of outer-join map, if any */
+	cl_ulong		bloom_offset;	/* offset to the outer bloom filter */
+	cl_uint			bloom_nbits;	/* # of bits in bloom filter, or 0 */
 	cl_uint			cuda_dindex;	/* device index of PG-Strom */
 	cl_uint			nrels;			/* number of inner relations */
 	struct
 	{
 		cl_ulong	chunk_offset;	/* offset to KDS or Hash */
 		cl_ulong	ojmap_offset;	/* offset to outer-join map, if any */
+		cl_ulong	skew_offset;	/* offset to heavy hitters, if any */
+		cl_ulong	range_offset;	/* offset to range index, if any */
 		cl_bool		is_nestloop;	/* true, if NestLoop. */
 		cl_bool		left_outer;		/* true, if JOIN_LEFT or JOIN_FULL */
 		cl_bool		right_outer;	/* true, if JOIN_RIGHT or JOIN_FULL */
-		cl_char		__padding__[5];
+		cl_bool		semi_join;		/* true, if JOIN_SEMI */
+		cl_bool		anti_join;		/* true, if JOIN_ANTI */
+		cl_char		__padding__[3];
 	} chunks[FLEXIBLE_ARRAY_MEMBER];
 } kern_multirels;
 
+/*
+ * kern_hash_skew - heavy hitters of the inner hash table
+ *
+ * If join keys are heavily skewed, a particular hash slot has very long
+ * chain, and a thread which probes the slot walks on the chain for a long
+ * time, while other threads in the same block have nothing to do. So, the
+ * items of the heavy hitter slots are also listed in the array, then the
+ * threads without their own item to probe split the items of the heavy
+ * hitter slots on run-time.
+ * It is built only for INNER or RIGHT hash-join of non-partitioned inner
+ * hash table less than 2GB, because @l_state of the thread which probes
+ * the heavy hitter slot is encoded using the highest bit.
+ */
+#define GPUJOIN_SKEW_MAX_SLOTS		8
+
+typedef struct
+{
+	cl_uint			nslots;			/* # of heavy hitter slots */
+	struct {
+		cl_uint		hash_slot;		/* index of the hash slot */
+		cl_uint		nitems;			/* # of items in the chain */
+		cl_uint		items_index;	/* index of the first item on items[] */
+	} slots[GPUJOIN_SKEW_MAX_SLOTS];
+	cl_uint			items[FLEXIBLE_ARRAY_MEMBER]; /* offset of htup */
+} kern_hash_skew;
+
+#define GPUJOIN_SKEW_STATE(h,consumed)					\
+	(0x80000000U | ((cl_uint)(h) << 28) | (cl_uint)(consumed))
+#define GPUJOIN_SKEW_STATE_P(l_state)					\
+	(((l_state) & 0x80000000U) != 0 && (l_state) != UINT_MAX)
+#define GPUJOIN_SKEW_STATE_SLOT(l_state)		(((l_state) >> 28) & 0x07U)
+#define GPUJOIN_SKEW_STATE_CONSUMED(l_state)	((l_state) & 0x0fffffffU)
+
 #define KERN_MULTIRELS_INNER_KDS(kmrels, depth)	\
 	((kern_data_store *)						\
 	 ((char *)(kmrels) + (kmrels)->chunks[(depth)-1].chunk_offset))
@@ -60,6 +99,104 @@ typedef struct
 #define KERN_MULTIRELS_RIGHT_OUTER_JOIN(kmrels, depth)	\
 	__ldg(&((kmrels)->chunks[(depth)-1].right_outer))
 
+#define KERN_MULTIRELS_SEMI_JOIN(kmrels, depth)			\
+	__ldg(&((kmrels)->chunks[(depth)-1].semi_join))
+
+#define KERN_MULTIRELS_ANTI_JOIN(kmrels, depth)			\
+	__ldg(&((kmrels)->chunks[(depth)-1].anti_join))
+
+#define KERN_MULTIRELS_HASH_SKEW(kmrels, depth)						\
+	((kmrels)->chunks[(depth)-1].skew_offset == 0					\
+	 ? NULL															\
+	 : (kern_hash_skew *)((char *)(kmrels) +						\
+						  (kmrels)->chunks[(depth)-1].skew_offset))
+
+#define KERN_MULTIRELS_RANGE_INDEX(kmrels, depth)					\
+	((kmrels)->chunks[(depth)-1].range_offset == 0					\
+	 ? NULL															\
+	 : (kern_range_index *)((char *)(kmrels) +						\
+							(kmrels)->chunks[(depth)-1].range_offset))
+
+#define KERN_MULTIRELS_BLOOM_FILTER(kmrels)					\
+	((kmrels)->bloom_nbits == 0								\
+	 ? NULL													\
+	 : (cl_uint *)((char *)(kmrels) + (kmrels)->bloom_offset))
+
+/*
+ * kern_range_index - interval index of the inner relation
+ *
+ * If nested-loop has a join clause that requires the inner range to overlap
+ * with (or to contain) the outer range or element, like temporal joins,
+ * the inner rows are sorted by the lower bound of the range key, and the
+ * maximum upper bound of the items in front of the position is kept with
+ * them. An outer row can match only the inner rows between the first item
+ * whose max upper bound reaches the outer one, and the last item whose lower
+ * bound is not beyond the outer one, so nested-loop probes the window
+ * identified by binary search, instead of all the inner rows.
+ * Bounds are converted to cl_long, and treated as inclusive; it is a super
+ * set of the actual candidates, then join_quals checks the rest.
+ */
+#define GPUJOIN_RANGE_OP__OVERLAP	1	/* inner && outer */
+#define GPUJOIN_RANGE_OP__CONTAINS	2	/* inner @> outer */
+
+#define GPUJOIN_RANGE_KEY__NONE		0	/* never match */
+#define GPUJOIN_RANGE_KEY__BOUND	1	/* probe the window */
+#define GPUJOIN_RANGE_KEY__FULL		2	/* probe all the inner rows */
+
+typedef struct
+{
+	cl_long			lower;			/* lower bound, in ascending order */
+	cl_long			upper_max;		/* max upper bound of items[0...i] */
+} kern_range_item;
+
+typedef struct
+{
+	cl_uint			nitems;			/* same as the inner KDS */
+	cl_uint			range_op;		/* one of GPUJOIN_RANGE_OP__* */
+	kern_range_item	items[FLEXIBLE_ARRAY_MEMBER];
+} kern_range_index;
+
+/*
+ * Bloom filter of the outer relation
+ *
+ * If the first depth is INNER, SEMI or RIGHT hash-join, outer rows whose
+ * hash value of the join keys is not in the inner hash table never produce
+ * any joined rows. The bloom filter is built on the hash values of the
+ * inner rows by the host code once, then used to discard outer rows prior
+ * to the pseudo-stack on the device, or prior to DMA on the host.
+ * @nbits is always power of 2; bits are derived from the hash value using
+ * double hashing.
+ */
+#define GPUJOIN_BLOOM_NHASHES		3
+
+STATIC_INLINE(void)
+gpujoin_bloom_filter_insert(cl_uint *bitmap, cl_uint nbits, cl_uint hash)
+{
+	cl_uint		h2 = ((hash >> 16) | (hash << 16)) | 1U;
+	cl_uint		i, k;
+
+	for (i=0; i < GPUJOIN_BLOOM_NHASHES; i++)
+	{
+		k = (hash + i * h2) & (nbits - 1);
+		bitmap[k >> 5] |= (1U << (k & 0x1f));
+	}
+}
+
+STATIC_INLINE(cl_bool)
+gpujoin_bloom_filter_probe(cl_uint *bitmap, cl_uint nbits, cl_uint hash)
+{
+	cl_uint		h2 = ((hash >> 16) | (hash << 16)) | 1U;
+	cl_uint		i, k;
+
+	for (i=0; i < GPUJOIN_BLOOM_NHASHES; i++)
+	{
+		k = (hash + i * h2) & (nbits - 1);
+		if ((bitmap[k >> 5] & (1U << (k & 0x1f))) == 0)
+			return false;
+	}
+	return true;
+}
+
 /*
  * kern_gpujoin - control object of GpuJoin
  *
@@ -113,6 +250,20 @@ struct kern_gpujoin
 };
 typedef struct kern_gpujoin		kern_gpujoin;
 
+/*
+ * kern_gpujoin_queue - a set of GpuJoin tasks for gpujoin_main_persistent
+ */
+typedef struct
+{
+	cl_uint			nitems;				/* number of jobs */
+	cl_uint			__padding__;
+	struct {
+		kern_gpujoin	*kgjoin;
+		kern_data_store	*kds_src;
+		kern_data_store	*kds_dst;
+	} jobs[FLEXIBLE_ARRAY_MEMBER];
+} kern_gpujoin_queue;
+
 #define KERN_GPUJOIN_PARAMBUF(kgjoin)					\
 	((kern_parambuf *)((char *)(kgjoin) + (kgjoin)->kparams_offset))
 #define KERN_GPUJOIN_PARAMBUF_LENGTH(kgjoin)			\
@@ -175,6 +326,21 @@ gpujoin_hash_value(kern_context *kcxt,
 				   cl_uint *x_buffer,
 				   cl_bool *p_is_null_keys);
 
+/*
+ * gpujoin_range_key
+ *
+ * Evaluation of the outer range key if this depth uses range index. It
+ * returns one of GPUJOIN_RANGE_KEY__*, and bounds on BOUND.
+ */
+STATIC_FUNCTION(cl_int)
+gpujoin_range_key(kern_context *kcxt,
+				  kern_data_store *kds,
+				  kern_multirels *kmrels,
+				  cl_int depth,
+				  cl_uint *x_buffer,
+				  cl_long *p_lower,
+				  cl_long *p_upper);
+
 /*
  * gpujoin_projection
  *
@@ -338,10 +504,12 @@ gpujoin_rewind_stack(cl_int depth, cl_uint *l_state, cl_bool *matched)
 STATIC_FUNCTION(cl_int)
 gpujoin_load_source(kern_context *kcxt,
 					kern_gpujoin *kgjoin,
+					kern_multirels *kmrels,
 					kern_data_store *kds_src,
 					cl_uint *wr_stack,
 					cl_uint *l_state)
 {
+	cl_uint	   *bloom = KERN_MULTIRELS_BLOOM_FILTER(kmrels);
 	cl_uint		t_offset = UINT_MAX;
 	cl_bool		visible = false;
 	cl_uint		count;
@@ -411,11 +579,11 @@ gpujoin_load_source(kern_context *kcxt,
 					t_self.ip_posid = line_no;
 
 					htup = PageGetItem(pg_page, lpp);
-
-					visible = gpuscan_quals_eval(kcxt,
-												 kds_src,
-												 &t_self,
-												 htup);
+					if (HeapTupleSatisfiesHints(kcxt, pg_page, htup))
+						visible = gpuscan_quals_eval(kcxt,
+													 kds_src,
+													 &t_self,
+													 htup);
 				}
 			}
 		}
@@ -425,10 +593,11 @@ gpujoin_load_source(kern_context *kcxt,
 		assert(__ldg(&kds_src->format) == KDS_FORMAT_COLUMN);
 		cl_uint			row_index;
 
-		/* fetch next window */
+		/* fetch next window, and setup column-vector references */
 		if (get_local_id() == 0)
 			src_read_pos = atomicAdd(&kgjoin->src_read_pos,
 									 get_local_size());
+		gpuscan_quals_colvec_setup(kds_src);
 		__syncthreads();
 		row_index = src_read_pos + get_local_id();
 
@@ -441,6 +610,29 @@ gpujoin_load_source(kern_context *kcxt,
 		}
 		assert(wip_count[0] == 0);
 	}
+
+	/*
+	 * Discard the source tuple by the bloom filter, if its join keys
+	 * never match to the inner hash table of the first depth.
+	 */
+	if (bloom && visible)
+	{
+		cl_bool		is_null_keys;
+		cl_uint		hash_value;
+
+		hash_value = gpujoin_hash_value(kcxt,
+										pg_crc32_table,
+										kds_src,
+										kmrels,
+										1,
+										&t_offset,
+										&is_null_keys);
+		/* MEMO: NULL-keys will never match to inner-join */
+		if (is_null_keys ||
+			!gpujoin_bloom_filter_probe(bloom, __ldg(&kmrels->bloom_nbits),
+										hash_value))
+			visible = false;
+	}
 	/* error checks */
 	if (__syncthreads_count(kcxt->e.errcode) > 0)
 		return -1;
@@ -746,6 +938,184 @@ gpupreagg_projection_slot(kern_context *kcxt_gpreagg,
 						  Datum *dst_values,
 						  cl_char *dst_isnull);
 
+#ifdef GPUPREAGG_COMBINED_NOGROUP
+/* to be defined by gpupreagg.c */
+STATIC_FUNCTION(void)
+gpupreagg_nogroup_calc(cl_int attnum,
+					   cl_bool *p_accum_isnull,
+					   Datum   *p_accum_datum,
+					   cl_bool  newval_isnull,
+					   Datum    newval_datum);
+
+/*
+ * gpujoin_projection_nogroup
+ *
+ * Fused projection for GpuPreAgg without grouping keys. The result rows of
+ * the final depth are projected onto the staging area on the shared memory,
+ * then reduced to a single row by the block, so only one row per step is
+ * materialized on the kds_dst (KDS_FORMAT_SLOT).
+ * Host code has to allocate the dynamic shared memory for the staging area;
+ * (sizeof(Datum) + sizeof(cl_bool)) * ncols per thread, in addition to the
+ * workmem of pgstromStairlikeSum() and MAXIMUM_ALIGNOF per block.
+ */
+STATIC_FUNCTION(cl_int)
+gpujoin_projection_nogroup(kern_context *kcxt,
+						   kern_context *kcxt_gpreagg,
+						   kern_gpujoin *kgjoin,
+						   kern_multirels *kmrels,
+						   kern_data_store *kds_src,
+						   kern_data_store *kds_dst,
+						   cl_uint *rd_stack,
+						   cl_uint *l_state,
+						   cl_bool *matched)
+{
+	kern_parambuf *kparams_gpreagg = kcxt_gpreagg->kparams;
+	varlena	   *kparam_0 = (varlena *)kparam_get_value(kparams_gpreagg, 0);
+	cl_char	   *attr_is_preagg = (cl_char *)VARDATA(kparam_0);
+	cl_uint		nrels = kgjoin->num_rels;
+	cl_uint		ncols = kds_dst->ncols;
+	cl_uint		read_index;
+	cl_uint		nvalids;
+	cl_int		i, dist, buddy;
+	Datum	   *l_values;
+	cl_bool	   *l_isnull;
+#if GPUJOIN_DEVICE_PROJECTION_NFIELDS > 0
+	Datum		tup_values[GPUJOIN_DEVICE_PROJECTION_NFIELDS];
+	cl_bool		tup_isnull[GPUJOIN_DEVICE_PROJECTION_NFIELDS];
+	cl_bool		use_extra_buf[GPUJOIN_DEVICE_PROJECTION_NFIELDS];
+#else
+	Datum	   *tup_values = NULL;
+	cl_bool	   *tup_isnull = NULL;
+	cl_bool	   *use_extra_buf = NULL;
+#endif
+#if GPUJOIN_DEVICE_PROJECTION_EXTRA_SIZE > 0
+	cl_char		extra_buf[GPUJOIN_DEVICE_PROJECTION_EXTRA_SIZE]
+				__attribute__ ((aligned(MAXIMUM_ALIGNOF)));
+#else
+	cl_char	   *extra_buf = NULL;
+#endif
+	cl_uint		extra_len = 0;
+
+	/* sanity checks */
+	assert(rd_stack != NULL);
+
+	/* Any more result rows to be written? */
+	if (read_pos[nrels] >= write_pos[nrels])
+		return gpujoin_rewind_stack(nrels, l_state, matched);
+
+	/* pick up combinations from the pseudo-stack */
+	nvalids = Min(write_pos[nrels] - read_pos[nrels],
+				  get_local_size());
+	read_index = read_pos[nrels] + get_local_id();
+	__syncthreads();
+
+	/* staging area next to the workmem of pgstromStairlikeSum */
+	l_values = (Datum *)(SHARED_WORKMEM(char) +
+						 MAXALIGN(sizeof(cl_uint) * get_local_size()));
+	l_isnull = (cl_bool *)(l_values + ncols * get_local_size());
+
+	/*
+	 * step.1 - projection by GpuJoin and GpuPreAgg onto the staging area.
+	 * Varlena datum in the extra_buf is referenced only by the initial
+	 * projection of GpuPreAgg by the same thread, because GpuPreAgg does
+	 * not support variable length internal state of the aggregates.
+	 */
+	if (read_index < write_pos[nrels])
+	{
+		rd_stack += read_index * (nrels + 1);
+
+		gpujoin_projection(kcxt,
+						   kds_src,
+						   kmrels,
+						   rd_stack,
+						   kds_dst,
+						   tup_values,
+						   tup_isnull,
+						   use_extra_buf,
+						   extra_buf,
+						   &extra_len);
+		assert(extra_len <= GPUJOIN_DEVICE_PROJECTION_EXTRA_SIZE);
+
+		gpupreagg_projection_slot(kcxt_gpreagg,
+								  tup_values,
+								  tup_isnull,
+								  l_values + ncols * get_local_id(),
+								  l_isnull + ncols * get_local_id());
+	}
+	if (__syncthreads_count(kcxt->e.errcode) > 0)
+		return -1;	/* bailout */
+
+	/* step.2 - reduction of the staged rows into the first one */
+	for (dist=2, buddy=1; dist < 2 * nvalids; buddy=dist, dist *= 2)
+	{
+		if ((get_local_id() & (dist-1)) == 0 &&
+			(get_local_id() + buddy) < nvalids)
+		{
+			cl_uint		x_index = ncols * get_local_id();
+			cl_uint		y_index = ncols * (get_local_id() + buddy);
+
+			for (i=0; i < ncols; i++)
+			{
+				if (!attr_is_preagg[i])
+					continue;
+				gpupreagg_nogroup_calc(i,
+									   l_isnull + x_index + i,
+									   l_values + x_index + i,
+									   l_isnull[y_index + i],
+									   l_values[y_index + i]);
+			}
+		}
+		__syncthreads();
+	}
+
+	/* step.3 - increments nitems of the kds_dst for the reduced row */
+	if (get_local_id() == 0)
+	{
+		cl_uint		oldval;
+		cl_uint		curval = kds_dst->nitems;
+
+		do {
+			oldval = curval;
+			if (KERN_DATA_STORE_SLOT_LENGTH(kds_dst, oldval + 1) +
+				kds_dst->usage > kds_dst->length)
+			{
+				STROM_SET_ERROR(&kcxt->e, StromError_Suspend);
+				break;
+			}
+		} while ((curval = atomicCAS(&kds_dst->nitems,
+									 oldval,
+									 oldval + 1)) != oldval);
+		dst_base_index = oldval;
+	}
+	if (__syncthreads_count(kcxt->e.errcode) > 0)
+	{
+		/* No space left on the kds_dst, suspend the GPU kernel and bailout */
+		gpujoin_suspend_context(kgjoin, nrels+1, l_state, matched);
+		return -2;	/* <-- not to update statistics */
+	}
+
+	/* step.4 - write out the reduced row */
+	if (get_local_id() == 0)
+	{
+		Datum	   *dst_values = KERN_DATA_STORE_VALUES(kds_dst,
+														dst_base_index);
+		cl_bool	   *dst_isnull = KERN_DATA_STORE_ISNULL(kds_dst,
+														dst_base_index);
+		for (i=0; i < ncols; i++)
+		{
+			/* only partial aggregates are valid without grouping keys */
+			dst_isnull[i] = (attr_is_preagg[i] ? l_isnull[i] : true);
+			dst_values[i] = (attr_is_preagg[i] ? l_values[i] : 0);
+		}
+	}
+
+	/* step.5 - make advance the read position */
+	if (get_local_id() == 0)
+		read_pos[nrels] += nvalids;
+	return nrels + 1;
+}
+#endif /* GPUPREAGG_COMBINED_NOGROUP */
+
 /*
  * gpujoin_projection_slot
  */
@@ -910,6 +1280,72 @@ gpujoin_projection_slot(kern_context *kcxt,
 }
 #endif /* GPUPREAGG_COMBINED_JOIN */
 
+/*
+ * gpujoin_range_index_window
+ *
+ * It identifies the window of inner rows [*p_start, *p_end) which can match
+ * the outer row, using the range index.
+ */
+STATIC_FUNCTION(void)
+gpujoin_range_index_window(kern_context *kcxt,
+						   kern_data_store *kds_src,
+						   kern_multirels *kmrels,
+						   kern_range_index *krindex,
+						   cl_int depth,
+						   cl_uint *o_buffer,
+						   cl_uint *p_start,
+						   cl_uint *p_end)
+{
+	cl_uint		nitems = __ldg(&krindex->nitems);
+	cl_bool		is_overlap = (__ldg(&krindex->range_op) ==
+							  GPUJOIN_RANGE_OP__OVERLAP);
+	cl_long		lower;
+	cl_long		upper;
+	cl_long		key;
+	cl_uint		head, tail, curr;
+
+	switch (gpujoin_range_key(kcxt, kds_src, kmrels, depth, o_buffer,
+							  &lower, &upper))
+	{
+		case GPUJOIN_RANGE_KEY__BOUND:
+			break;
+		case GPUJOIN_RANGE_KEY__FULL:
+			*p_start = 0;
+			*p_end = nitems;
+			return;
+		default:
+			*p_start = 0;
+			*p_end = 0;
+			return;
+	}
+	/* the first item whose lower bound is beyond the outer one */
+	key = (is_overlap ? upper : lower);
+	head = 0;
+	tail = nitems;
+	while (head < tail)
+	{
+		curr = head + (tail - head) / 2;
+		if (__ldg(&krindex->items[curr].lower) <= key)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	*p_end = head;
+	/* the first item whose max upper bound reaches the outer one */
+	key = (is_overlap ? lower : upper);
+	head = 0;
+	tail = *p_end;
+	while (head < tail)
+	{
+		curr = head + (tail - head) / 2;
+		if (__ldg(&krindex->items[curr].upper_max) < key)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	*p_start = head;
+}
+
 /*
  * gpujoin_exec_nestloop
  */
@@ -926,17 +1362,27 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 {
 	kern_data_store *kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
 	cl_bool		   *oj_map = KERN_MULTIRELS_OUTER_JOIN_MAP(kmrels, depth);
+	kern_range_index *krindex = KERN_MULTIRELS_RANGE_INDEX(kmrels, depth);
 	kern_tupitem   *tupitem = NULL;
 	cl_uint			x_unitsz;
 	cl_uint			y_unitsz;
 	cl_uint			x_index;	/* outer index */
 	cl_uint			y_index;	/* inner index */
+	cl_uint			x_local;
+	cl_uint			y_head;		/* head of the inner window */
+	cl_uint			y_tail;		/* tail of the inner window */
 	cl_uint			wr_index;
 	cl_uint			count;
 	cl_bool			result = false;
 	__shared__ cl_bool matched_sync[MAXTHREADS_PER_BLOCK];
-
-	assert(kds_in->format == KDS_FORMAT_ROW);
+	__shared__ cl_uint range_start[MAXTHREADS_PER_BLOCK];
+	__shared__ cl_uint range_end[MAXTHREADS_PER_BLOCK];
+	__shared__ cl_uint range_head;
+	__shared__ cl_uint range_tail;
+
+	/* KDS_FORMAT_HASH, if hash-join runs as nested-loop at run-time */
+	assert(kds_in->format == KDS_FORMAT_ROW ||
+		   kds_in->format == KDS_FORMAT_HASH);
 	assert(depth >= 1 && depth <= GPUJOIN_MAX_DEPTH);
 	if (read_pos[depth-1] >= write_pos[depth-1])
 	{
@@ -964,8 +1410,125 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 
 	x_index = get_local_id() % x_unitsz;
 	y_index = get_local_id() / x_unitsz;
+	x_local = x_index;
+
+	/*
+	 * If range index is available, only the inner rows in the window of
+	 * each outer row can match. Threads probe the union of them, and skip
+	 * join_quals out of the window of its own outer row.
+	 * The windows are identified on every call, because the outer rows
+	 * in the same window are processed in the same way unless suspended.
+	 */
+	if (!krindex)
+	{
+		y_head = 0;
+		y_tail = kds_in->nitems;
+	}
+	else
+	{
+		if (get_local_id() == 0)
+		{
+			range_head = UINT_MAX;
+			range_tail = 0;
+		}
+		__syncthreads();
+		if (get_local_id() < x_unitsz)
+		{
+			cl_uint		start, end;
+
+			gpujoin_range_index_window(kcxt, kds_src, kmrels, krindex, depth,
+									   rd_stack + depth *
+									   (read_pos[depth-1] + get_local_id()),
+									   &start, &end);
+			range_start[get_local_id()] = start;
+			range_end[get_local_id()] = end;
+			if (start < end)
+			{
+				atomicMin(&range_head, start);
+				atomicMax(&range_tail, end);
+			}
+		}
+		__syncthreads();
+		y_head = (range_head < range_tail ? range_head : 0);
+		y_tail = (range_head < range_tail ? range_tail : 0);
+	}
+#define RANGE_WINDOW_CONTAINS(x_local,y_index)			\
+	(!krindex || (y_index >= range_start[(x_local)] &&	\
+				  y_index <  range_end[(x_local)]))
 
-	if (y_unitsz * l_state[depth] >= kds_in->nitems)
+	/*
+	 * In case of SEMI/ANTI JOIN, outer row is emitted at most once, after
+	 * the scan of inner rows. Probing stops if the outer row gets matched.
+	 */
+	if (KERN_MULTIRELS_SEMI_JOIN(kmrels, depth) ||
+		KERN_MULTIRELS_ANTI_JOIN(kmrels, depth))
+	{
+		cl_uint		l_end = (y_tail - y_head + y_unitsz - 1) / y_unitsz;
+		cl_bool		y_first = (y_index == 0);
+
+		if (l_state[depth] > l_end)
+		{
+			/* already emitted, move to the next outer window */
+			l_state[depth] = 0;
+			matched[depth] = false;
+			if (get_local_id() == 0)
+			{
+				wip_count[depth] = 0;
+				read_pos[depth-1] += x_unitsz;
+			}
+			return depth;
+		}
+		if (get_local_id() < x_unitsz)
+			matched_sync[get_local_id()] = false;
+		__syncthreads();
+		if (matched[depth] && y_index < y_unitsz)
+			matched_sync[x_index] = true;
+		count = __syncthreads_count(get_local_id() < x_unitsz &&
+									!matched_sync[get_local_id()]);
+		x_index += read_pos[depth-1];
+		assert(x_index < write_pos[depth-1]);
+		rd_stack += (x_index * depth);
+
+		if (l_state[depth] < l_end && count > 0)
+		{
+			/* probe the inner rows, unless outer row is already matched */
+			if (y_index < y_unitsz && !matched_sync[x_local])
+			{
+				y_index += y_head + y_unitsz * l_state[depth];
+				if (y_index < y_tail &&
+					RANGE_WINDOW_CONTAINS(x_local, y_index))
+				{
+					tupitem = KERN_DATA_STORE_TUPITEM(kds_in, y_index);
+					if (gpujoin_join_quals(kcxt,
+										   kds_src,
+										   kmrels,
+										   depth,
+										   rd_stack,
+										   &tupitem->htup,
+										   NULL))
+						matched[depth] = true;
+				}
+			}
+			l_state[depth]++;
+			if (get_local_id() == 0)
+				wip_count[depth] = get_local_size();
+			__syncthreads();
+			return depth;
+		}
+		/* emit the outer row, if matched (SEMI) or not matched (ANTI) */
+		if (y_first)
+		{
+			if (KERN_MULTIRELS_SEMI_JOIN(kmrels, depth))
+				result = matched_sync[x_local];
+			else
+				result = !matched_sync[x_local];
+		}
+		tupitem = NULL;
+		l_state[depth] = l_end + 1;
+		goto left_outer;
+	}
+
+	if (y_head + y_unitsz * l_state[depth] >= y_tail)
 	{
 		/*
 		 * In case of LEFT OUTER JOIN, we need to check whether the outer
@@ -1008,8 +1571,9 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 	rd_stack += (x_index * depth);
 	if (y_index < y_unitsz)
 	{
-		y_index += y_unitsz * l_state[depth];
-		if (y_index < kds_in->nitems)
+		y_index += y_head + y_unitsz * l_state[depth];
+		if (y_index < y_tail &&
+			RANGE_WINDOW_CONTAINS(x_local, y_index))
 		{
 			tupitem = KERN_DATA_STORE_TUPITEM(kds_in, y_index);
 
@@ -1054,6 +1618,7 @@ left_outer:
 	if (write_pos[depth] + get_local_size() <= kgjoin->pstack_nrooms)
 		return depth;
 	return depth + 1;
+#undef RANGE_WINDOW_CONTAINS
 }
 
 /*
@@ -1078,6 +1643,16 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 	cl_uint				wr_index;
 	cl_uint				count;
 	cl_bool				result;
+	cl_bool				semi_anti = (KERN_MULTIRELS_SEMI_JOIN(kmrels, depth) ||
+									 KERN_MULTIRELS_ANTI_JOIN(kmrels, depth));
+	cl_bool				stop_probe = false;
+	kern_hash_skew	   *kskew = KERN_MULTIRELS_HASH_SKEW(kmrels, depth);
+	kern_hashitem	   *r_item;
+	cl_uint			   *rd_base = rd_stack;
+	cl_uint			   *x_stack;
+	__shared__ cl_uint	skew_prefix[MAXTHREADS_PER_BLOCK];
+	__shared__ cl_uint	skew_index[MAXTHREADS_PER_BLOCK];
+	__shared__ cl_uint	skew_owner[MAXTHREADS_PER_BLOCK];
 
 	assert(kds_hash->format == KDS_FORMAT_HASH);
 	assert(depth >= 1 && depth <= GPUJOIN_MAX_DEPTH);
@@ -1136,7 +1711,23 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 			{
 				/* MEMO: NULL-keys will never match to inner-join */
 				if (!is_null_keys)
-					khitem = KERN_HASH_FIRST_ITEM(kds_hash, hash_value);
+					khitem = KERN_HASH_FIRST_MATCH(kds_hash, hash_value);
+				/* heavy hitter slot shall be probed by multiple threads */
+				if (kskew && khitem)
+				{
+					cl_uint		hash_slot = hash_value % kds_hash->nslots;
+					cl_uint		h, nslots = __ldg(&kskew->nslots);
+
+					for (h=0; h < nslots; h++)
+					{
+						if (__ldg(&kskew->slots[h].hash_slot) == hash_slot)
+						{
+							l_state[depth] = GPUJOIN_SKEW_STATE(h, 0);
+							khitem = NULL;
+							break;
+						}
+					}
+				}
 			}
 		}
 		else
@@ -1148,6 +1739,11 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 			l_state[depth] = UINT_MAX;
 		}
 	}
+	else if (GPUJOIN_SKEW_STATE_P(l_state[depth]))
+	{
+		/* heavy hitter slot; items are probed by the free threads below */
+		assert(kskew != NULL);
+	}
 	else if (l_state[depth] != UINT_MAX)
 	{
 		/* walks on the hash-slot chain */
@@ -1156,13 +1752,10 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 								   - offsetof(kern_hashitem, t.htup));
 		hash_value = khitem->hash;
 
-		/* pick up next one if any */
-		khitem = KERN_HASH_NEXT_ITEM(kds_hash, khitem);
+		/* pick up next one with the same hash value, if any */
+		khitem = KERN_HASH_NEXT_MATCH(kds_hash, khitem);
 	}
 
-	while (khitem && khitem->hash != hash_value)
-		khitem = KERN_HASH_NEXT_ITEM(kds_hash, khitem);
-
 	if (khitem)
 	{
 		cl_bool		joinquals_matched;
@@ -1186,20 +1779,125 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 			if (oj_map && !oj_map[khitem->rowid])
 				oj_map[khitem->rowid] = true;
 		}
+		/* SEMI/ANTI JOIN stops probing on the first match */
+		if (semi_anti && joinquals_matched)
+		{
+			if (KERN_MULTIRELS_ANTI_JOIN(kmrels, depth))
+				result = false;
+			stop_probe = true;
+		}
 	}
-	else if (KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth) &&
+	else if ((KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth) ||
+			  KERN_MULTIRELS_ANTI_JOIN(kmrels, depth)) &&
 			 l_state[depth] != UINT_MAX &&
 			 !matched[depth])
 	{
-		/* No matched outer rows, but LEFT/FULL OUTER */
+		/* No matched outer rows, but LEFT/FULL OUTER or ANTI */
 		result = true;
 	}
 	else
 		result = false;
 
 	/* save the current hash item */
-	l_state[depth] = (!khitem ? UINT_MAX : (cl_uint)((char *)&khitem->t.htup -
-													 (char *)kds_hash));
+	if (!GPUJOIN_SKEW_STATE_P(l_state[depth]))
+		l_state[depth] = (!khitem || stop_probe
+						  ? UINT_MAX
+						  : (cl_uint)((char *)&khitem->t.htup -
+									  (char *)kds_hash));
+	r_item = khitem;
+	x_stack = rd_stack;
+
+	/*
+	 * Threads without their own item to probe split the items of the heavy
+	 * hitter slots probed by other threads. Each heavy hitter slot is
+	 * assigned to the free threads by the number of remaining items, then
+	 * its owner thread counts up the consumed items.
+	 */
+	if (kskew)
+	{
+		cl_uint		state = l_state[depth];
+		cl_bool		is_owner = GPUJOIN_SKEW_STATE_P(state);
+		cl_bool		is_free = (!khitem && !result);
+		cl_uint		h = 0;
+		cl_uint		consumed = 0;
+		cl_uint		remain = 0;
+		cl_uint		owner_id;
+		cl_uint		nowners;
+
+		if (is_owner)
+		{
+			h = GPUJOIN_SKEW_STATE_SLOT(state);
+			consumed = GPUJOIN_SKEW_STATE_CONSUMED(state);
+			remain = __ldg(&kskew->slots[h].nitems) - consumed;
+		}
+		owner_id = pgstromStairlikeBinaryCount(is_owner, &nowners);
+		if (nowners > 0)
+		{
+			cl_uint		prefix;
+			cl_uint		nremains;
+			cl_uint		free_id;
+			cl_uint		nfree;
+
+			prefix = pgstromStairlikeSum(remain, &nremains);
+			if (is_owner)
+			{
+				skew_prefix[owner_id] = prefix;
+				skew_index[owner_id] = (__ldg(&kskew->slots[h].items_index) +
+										consumed);
+				skew_owner[owner_id] = get_local_id();
+			}
+			free_id = pgstromStairlikeBinaryCount(is_free, &nfree);
+			__syncthreads();
+
+			if (is_free && free_id < nremains)
+			{
+				cl_uint		k_min = 0;
+				cl_uint		k_max = nowners;
+				cl_uint		k;
+				cl_uint		offset;
+				cl_bool		joinquals_matched;
+
+				/* binary search of the owner of the free_id'th item */
+				while (k_max - k_min > 1)
+				{
+					k = (k_min + k_max) / 2;
+					if (skew_prefix[k] <= free_id)
+						k_min = k;
+					else
+						k_max = k;
+				}
+				offset = __ldg(&kskew->items[skew_index[k_min] +
+											 free_id - skew_prefix[k_min]]);
+				r_item = (kern_hashitem *)((char *)kds_hash + offset
+										   - offsetof(kern_hashitem, t.htup));
+				x_stack = rd_base + ((read_pos[depth-1] +
+									  skew_owner[k_min]) * depth);
+				result = gpujoin_join_quals(kcxt,
+											kds_src,
+											kmrels,
+											depth,
+											x_stack,
+											&r_item->t.htup,
+											&joinquals_matched);
+				/* No RIGHT/FULL JOIN are needed */
+				if (joinquals_matched && oj_map && !oj_map[r_item->rowid])
+					oj_map[r_item->rowid] = true;
+			}
+			/* count up the items consumed by the free threads */
+			if (is_owner)
+			{
+				cl_uint		done = (nfree > prefix
+									? Min(nfree - prefix, remain) : 0);
+
+				consumed += done;
+				l_state[depth] = (remain == done
+								  ? UINT_MAX
+								  : GPUJOIN_SKEW_STATE(h, consumed));
+			}
+			__syncthreads();
+		}
+	}
+
 	wr_index = write_pos[depth];
 	wr_index += pgstromStairlikeBinaryCount(result, &count);
 	if (get_local_id() == 0)
@@ -1210,12 +1908,13 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 	wr_stack += wr_index * (depth + 1);
 	if (result)
 	{
-		memcpy(wr_stack, rd_stack, sizeof(cl_uint) * depth);
-		wr_stack[depth] = (!khitem ? 0U : (cl_uint)((char *)&khitem->t.htup -
+		memcpy(wr_stack, x_stack, sizeof(cl_uint) * depth);
+		wr_stack[depth] = (!r_item ? 0U : (cl_uint)((char *)&r_item->t.htup -
 													(char *)kds_hash));
 	}
 	/* count number of threads still in-progress */
-	count = __syncthreads_count(khitem != NULL);
+	count = __syncthreads_count((khitem != NULL && !stop_probe) ||
+								GPUJOIN_SKEW_STATE_P(l_state[depth]));
 	if (get_local_id() == 0)
 		wip_count[depth] = count;
 	/* enough room exists on this depth? */
@@ -1229,18 +1928,21 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 	 ? (pstack_base + pstack_nrooms * ((d) * ((d) + 1)) / 2) : NULL)
 
 /*
- * gpujoin_main
+ * __gpujoin_main
+ *
+ * It joins the rows in kds_src with the inner relations, and writes out
+ * the results to kds_dst, using the pseudo-stack and the suspend context
+ * of the given kern_gpujoin. Caller has to set up pg_crc32_table and the
+ * kernel context for the kparams of kgjoin.
  */
-KERNEL_FUNCTION(void)
-gpujoin_main(kern_gpujoin *kgjoin,
-			 kern_multirels *kmrels,
-			 kern_data_store *kds_src,
-			 kern_data_store *kds_dst,
-			 kern_parambuf *kparams_gpreagg) /* only if combined GpuJoin */
+STATIC_FUNCTION(void)
+__gpujoin_main(kern_context *kcxt,
+			   kern_context *kcxt_gpreagg,
+			   kern_gpujoin *kgjoin,
+			   kern_multirels *kmrels,
+			   kern_data_store *kds_src,
+			   kern_data_store *kds_dst)
 {
-	kern_parambuf  *kparams = KERN_GPUJOIN_PARAMBUF(kgjoin);
-	kern_context	kcxt;
-	kern_context	kcxt_gpreagg __attribute__((unused));
 	cl_int			depth;
 	cl_int			index;
 	cl_uint			pstack_nrooms;
@@ -1249,31 +1951,11 @@ gpujoin_main(kern_gpujoin *kgjoin,
 	cl_bool			matched[GPUJOIN_MAX_DEPTH+1];
 	__shared__ cl_int depth_thread0 __attribute__((unused));
 
-	INIT_KERNEL_CONTEXT(&kcxt, gpujoin_main, kparams);
-	assert(__ldg(&kds_src->format) == KDS_FORMAT_ROW ||
-		   __ldg(&kds_src->format) == KDS_FORMAT_BLOCK ||
-		   __ldg(&kds_src->format) == KDS_FORMAT_COLUMN);
-#ifndef GPUPREAGG_COMBINED_JOIN
-	assert(__ldg(&kds_dst->format) == KDS_FORMAT_ROW);
-	assert(kparams_gpreagg == NULL);
-#else
-	assert(__ldg(&kds_dst->format) == KDS_FORMAT_SLOT);
-	assert(kparams_gpreagg != NULL);
-	INIT_KERNEL_CONTEXT(&kcxt_gpreagg, gpujoin_main, kparams_gpreagg);
-#endif
-
 	/* setup private variables */
 	pstack_nrooms = kgjoin->pstack_nrooms;
 	pstack_base = (cl_uint *)((char *)kgjoin + kgjoin->pstack_offset)
 		+ get_global_index() * pstack_nrooms * ((GPUJOIN_MAX_DEPTH+1) *
 												(GPUJOIN_MAX_DEPTH+2)) / 2;
-	/* setup crc32 table */
-	for (index = get_local_id();
-		 index < lengthof(pg_crc32_table);
-		 index += get_local_size())
-		pg_crc32_table[index] = kmrels->pg_crc32_table[index];
-	__syncthreads();
-
 	/* setup per-depth context */
 	memset(l_state, 0, sizeof(l_state));
 	memset(matched, 0, sizeof(matched));
@@ -1300,8 +1982,9 @@ gpujoin_main(kern_gpujoin *kgjoin,
 		if (depth == 0)
 		{
 			/* LOAD FROM KDS_SRC (ROW/BLOCK/COLUMN) */
-			depth = gpujoin_load_source(&kcxt,
+			depth = gpujoin_load_source(kcxt,
 										kgjoin,
+										kmrels,
 										kds_src,
 										PSTACK_DEPTH(depth),
 										l_state);
@@ -1311,7 +1994,7 @@ gpujoin_main(kern_gpujoin *kgjoin,
 			assert(depth == kmrels->nrels + 1);
 #ifndef GPUPREAGG_COMBINED_JOIN
 			/* PROJECTION (ROW) */
-			depth = gpujoin_projection_row(&kcxt,
+			depth = gpujoin_projection_row(kcxt,
 										   kgjoin,
 										   kmrels,
 										   kds_src,
@@ -1319,10 +2002,21 @@ gpujoin_main(kern_gpujoin *kgjoin,
 										   PSTACK_DEPTH(kgjoin->num_rels),
 										   l_state,
 										   matched);
+#elif defined(GPUPREAGG_COMBINED_NOGROUP)
+			/* PROJECTION (SLOT) with reduction */
+			depth = gpujoin_projection_nogroup(kcxt,
+											   kcxt_gpreagg,
+											   kgjoin,
+											   kmrels,
+											   kds_src,
+											   kds_dst,
+											   PSTACK_DEPTH(kgjoin->num_rels),
+											   l_state,
+											   matched);
 #else
 			/* PROJECTION (SLOT) */
-			depth = gpujoin_projection_slot(&kcxt,
-											&kcxt_gpreagg,
+			depth = gpujoin_projection_slot(kcxt,
+											kcxt_gpreagg,
 											kgjoin,
 											kmrels,
 											kds_src,
@@ -1335,7 +2029,7 @@ gpujoin_main(kern_gpujoin *kgjoin,
 		else if (kmrels->chunks[depth-1].is_nestloop)
 		{
 			/* NEST-LOOP */
-			depth = gpujoin_exec_nestloop(&kcxt,
+			depth = gpujoin_exec_nestloop(kcxt,
 										  kgjoin,
 										  kmrels,
 										  kds_src,
@@ -1348,7 +2042,7 @@ gpujoin_main(kern_gpujoin *kgjoin,
 		else
 		{
 			/* HASH-JOIN */
-			depth = gpujoin_exec_hashjoin(&kcxt,
+			depth = gpujoin_exec_hashjoin(kcxt,
 										  kgjoin,
 										  kmrels,
 										  kds_src,
@@ -1377,9 +2071,92 @@ gpujoin_main(kern_gpujoin *kgjoin,
 					  stat_nitems[index+1]);
 	}
 	__syncthreads();
+}
+
+/*
+ * gpujoin_main
+ */
+KERNEL_FUNCTION(void)
+gpujoin_main(kern_gpujoin *kgjoin,
+			 kern_multirels *kmrels,
+			 kern_data_store *kds_src,
+			 kern_data_store *kds_dst,
+			 kern_parambuf *kparams_gpreagg) /* only if combined GpuJoin */
+{
+	kern_parambuf  *kparams = KERN_GPUJOIN_PARAMBUF(kgjoin);
+	kern_context	kcxt;
+	kern_context	kcxt_gpreagg __attribute__((unused));
+	cl_int			index;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpujoin_main, kparams);
+	assert(__ldg(&kds_src->format) == KDS_FORMAT_ROW ||
+		   __ldg(&kds_src->format) == KDS_FORMAT_BLOCK ||
+		   __ldg(&kds_src->format) == KDS_FORMAT_COLUMN);
+#ifndef GPUPREAGG_COMBINED_JOIN
+	assert(__ldg(&kds_dst->format) == KDS_FORMAT_ROW);
+	assert(kparams_gpreagg == NULL);
+#else
+	assert(__ldg(&kds_dst->format) == KDS_FORMAT_SLOT);
+	assert(kparams_gpreagg != NULL);
+	INIT_KERNEL_CONTEXT(&kcxt_gpreagg, gpujoin_main, kparams_gpreagg);
+#endif
+
+	/* setup crc32 table */
+	for (index = get_local_id();
+		 index < lengthof(pg_crc32_table);
+		 index += get_local_size())
+		pg_crc32_table[index] = kmrels->pg_crc32_table[index];
+	__syncthreads();
+
+	__gpujoin_main(&kcxt, &kcxt_gpreagg, kgjoin, kmrels, kds_src, kds_dst);
 	kern_writeback_error_status(&kgjoin->kerror, &kcxt.e);
 }
 
+#ifndef GPUPREAGG_COMBINED_JOIN
+/*
+ * gpujoin_main_persistent
+ *
+ * It is launched once for a set of GpuJoin tasks which share the same
+ * kern_multirels, with a grid sized to the number of SMs. Every thread
+ * block walks on the jobs in order, so the kernel stays resident while
+ * kern_multirels is hot in L2 cache. If a thread block gets suspended on
+ * a job due to lack of the destination buffer, it moves to the next job;
+ * host code resumes the suspended job by the next launch with a new
+ * destination buffer.
+ */
+KERNEL_FUNCTION(void)
+gpujoin_main_persistent(kern_gpujoin_queue *kqueue,
+						kern_multirels *kmrels)
+{
+	kern_context	kcxt;
+	cl_uint			nitems = kqueue->nitems;
+	cl_uint			index;
+
+	/* setup crc32 table; shared by all the jobs */
+	for (index = get_local_id();
+		 index < lengthof(pg_crc32_table);
+		 index += get_local_size())
+		pg_crc32_table[index] = kmrels->pg_crc32_table[index];
+	__syncthreads();
+
+	for (index=0; index < nitems; index++)
+	{
+		kern_gpujoin	   *kgjoin = kqueue->jobs[index].kgjoin;
+		kern_data_store	   *kds_src = kqueue->jobs[index].kds_src;
+		kern_data_store	   *kds_dst = kqueue->jobs[index].kds_dst;
+
+		INIT_KERNEL_CONTEXT(&kcxt, gpujoin_main_persistent,
+							KERN_GPUJOIN_PARAMBUF(kgjoin));
+		assert(__ldg(&kds_src->format) == KDS_FORMAT_ROW ||
+			   __ldg(&kds_src->format) == KDS_FORMAT_COLUMN);
+		assert(__ldg(&kds_dst->format) == KDS_FORMAT_ROW);
+
+		__gpujoin_main(&kcxt, NULL, kgjoin, kmrels, kds_src, kds_dst);
+		kern_writeback_error_status(&kgjoin->kerror, &kcxt.e);
+	}
+}
+#endif	/* !GPUPREAGG_COMBINED_JOIN */
+
 /*
  * gpujoin_collocate_outer_join_map
  *
@@ -1494,6 +2271,17 @@ gpujoin_right_outer(kern_gpujoin *kgjoin,
 										   PSTACK_DEPTH(kgjoin->num_rels),
 										   l_state,
 										   matched);
+#elif defined(GPUPREAGG_COMBINED_NOGROUP)
+			/* PROJECTION (SLOT) with reduction */
+			depth = gpujoin_projection_nogroup(&kcxt,
+											   &kcxt_gpreagg,
+											   kgjoin,
+											   kmrels,
+											   NULL,
+											   kds_dst,
+											   PSTACK_DEPTH(kgjoin->num_rels),
+											   l_state,
+											   matched);
 #else
 			/* PROJECTION (SLOT) */
 			depth = gpujoin_projection_slot(&kcxt,
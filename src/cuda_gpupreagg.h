@@ -112,6 +112,39 @@ typedef struct
 	pagg_hashslot hash_slot[FLEXIBLE_ARRAY_MEMBER];
 } kern_global_hashslot;
 
+/*
+ * kern_gpupreagg_dict
+ *
+ * Per-chunk dictionary of the variable-length grouping keys (text, varchar
+ * and bytea). The setup kernel registers the key values to the string pool
+ * once per distinct value, then replaces the pointer on the kds_slot by the
+ * entry of the string pool. So, identical keys on the kds_slot share the
+ * same pointer and the hash value calculated on the registration; the
+ * reduction stage can compare and hash them as fixed-width identifiers,
+ * and the key is materialized on the kds_final only once per group.
+ */
+typedef struct
+{
+	cl_uint		hash;			/* hash value of the key */
+	cl_uint		dict_id;		/* sequential identifier of the key */
+	cl_char		value[FLEXIBLE_ARRAY_MEMBER];	/* varlena datum */
+} kern_gpupreagg_dict_entry;
+
+typedef struct
+{
+	cl_uint		nslots;			/* width of the hash-slot */
+	cl_uint		nitems;			/* number of the registered keys */
+	cl_uint		pool_size;		/* size of the string pool */
+	cl_uint		pool_usage;		/* usage of the string pool */
+	pagg_hashslot hash_slot[FLEXIBLE_ARRAY_MEMBER];
+} kern_gpupreagg_dict;
+
+#define KERN_GPUPREAGG_DICT_POOL(kdict)						\
+	((char *)&(kdict)->hash_slot[(kdict)->nslots])
+#define KERN_GPUPREAGG_DICT_LENGTH(nslots, pool_size)		\
+	(STROMALIGN(offsetof(kern_gpupreagg_dict, hash_slot[(nslots)])) + \
+	 STROMALIGN(pool_size))
+
 /*
  * definition for special system parameter
  *
@@ -194,6 +227,148 @@ gpupreagg_projection_column(kern_context *kcxt,
 							Datum *dst_values,			/* out */
 							cl_char *dst_isnull);		/* out */
 
+STATIC_FUNCTION(void)
+gpupreagg_projection_colvec_setup(kern_data_store *kds_src);
+
+#ifdef GPUPREAGG_DICTIONARY_ENCODE
+/*
+ * replaces the variable-length grouping keys by the entry of dictionary
+ * (auto generated function)
+ */
+STATIC_FUNCTION(void)
+gpupreagg_dictionary_encode(kern_context *kcxt,
+							kern_gpupreagg_dict *kdict,
+							const cl_uint *crc32_table,
+							cl_char *slot_isnull,		/* in */
+							Datum *slot_values);		/* in/out */
+
+/*
+ * gpupreagg_dictionary_lookup
+ *
+ * It looks up the dictionary entry of the supplied key, or registers a new
+ * entry if not found. Thread that acquired the lock of a new hash-slot
+ * copies the key onto the string pool and releases the lock within the
+ * same iteration, so concurrent threads on the same warp never wait for
+ * the lock holder that is not scheduled.
+ */
+STATIC_FUNCTION(Datum)
+gpupreagg_dictionary_lookup(kern_context *kcxt,
+							kern_gpupreagg_dict *kdict,
+							const cl_uint *crc32_table,
+							Datum datum)
+{
+	varlena	   *vl = (varlena *)DatumGetPointer(datum);
+	char	   *pool = KERN_GPUPREAGG_DICT_POOL(kdict);
+	kern_gpupreagg_dict_entry *entry;
+	pagg_hashslot old_slot;
+	pagg_hashslot new_slot;
+	pagg_hashslot cur_slot;
+	cl_uint		hash;
+	cl_uint		index;
+	cl_uint		len;
+	cl_uint		sz;
+	cl_uint		usage;
+
+	/*
+	 * inline-compressed datum is decompressed and copied to the pool;
+	 * external datum must be processed by CPU
+	 */
+	if (VARATT_IS_COMPRESSED(vl))
+		vl = kern_context_decompress(kcxt, vl);
+	else if (VARATT_IS_EXTERNAL(vl))
+		vl = NULL;
+	if (!vl)
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		return datum;
+	}
+	INIT_LEGACY_CRC32(hash);
+	hash = pg_common_comp_crc32(crc32_table, hash,
+								VARDATA_ANY(vl),
+								VARSIZE_ANY_EXHDR(vl));
+	FIN_LEGACY_CRC32(hash);
+
+	new_slot.s.hash  = hash;
+	new_slot.s.index = (cl_uint)(0xfffffffeU);	/* LOCK */
+	old_slot.s.hash  = 0;
+	old_slot.s.index = (cl_uint)(0xffffffffU);	/* EMPTY */
+	index = hash % kdict->nslots;
+	for (;;)
+	{
+		cur_slot.value = atomicCAS(&kdict->hash_slot[index].value,
+								   old_slot.value, new_slot.value);
+		if (cur_slot.value == old_slot.value)
+		{
+			/* this thread registers a new key */
+			len = VARSIZE_ANY(vl);
+			sz = MAXALIGN(offsetof(kern_gpupreagg_dict_entry, value) + len);
+			usage = atomicAdd(&kdict->pool_usage, sz);
+			if (usage + sz > kdict->pool_size)
+			{
+				/* no space to register; release the slot and bailout */
+				STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+				__threadfence();
+				atomicExch(&kdict->hash_slot[index].value, old_slot.value);
+				return datum;
+			}
+			entry = (kern_gpupreagg_dict_entry *)(pool + usage);
+			entry->hash = hash;
+			entry->dict_id = atomicAdd(&kdict->nitems, 1);
+			memcpy(entry->value, vl, len);
+			__threadfence();
+			/* UNLOCK */
+			new_slot.s.index = usage;
+			atomicExch(&kdict->hash_slot[index].value, new_slot.value);
+			return PointerGetDatum(entry->value);
+		}
+		else if (cur_slot.s.hash != hash)
+		{
+			/* hash-value conflicts by other key */
+			index = (index + 1) % kdict->nslots;
+		}
+		else if (cur_slot.s.index == (cl_uint)(0xfffffffeU))
+		{
+			/* locked by concurrent thread; retry the same slot */
+		}
+		else
+		{
+			varlena	   *dvl;
+
+			entry = (kern_gpupreagg_dict_entry *)(pool + cur_slot.s.index);
+			dvl = (varlena *)entry->value;
+			if (VARSIZE_ANY_EXHDR(dvl) == VARSIZE_ANY_EXHDR(vl) &&
+				memcmp(VARDATA_ANY(dvl), VARDATA_ANY(vl),
+					   VARSIZE_ANY_EXHDR(vl)) == 0)
+				return PointerGetDatum(entry->value);
+			index = (index + 1) % kdict->nslots;
+		}
+	}
+}
+
+/*
+ * gpupreagg_dictionary_comp_crc32
+ *
+ * It computes hash value of the dictionary encoded key, using the hash
+ * value of the string pool entry instead of the entire key.
+ */
+STATIC_INLINE(cl_uint)
+gpupreagg_dictionary_comp_crc32(const cl_uint *crc32_table,
+								cl_uint hash,
+								cl_bool isnull,
+								varlena *value)
+{
+	kern_gpupreagg_dict_entry *entry;
+
+	if (isnull)
+		return hash;
+	entry = (kern_gpupreagg_dict_entry *)
+		((char *)value - offsetof(kern_gpupreagg_dict_entry, value));
+	return pg_common_comp_crc32(crc32_table, hash,
+								(char *)&entry->hash,
+								sizeof(cl_uint));
+}
+#endif	/* GPUPREAGG_DICTIONARY_ENCODE */
+
 /*
  * gpupreagg_final_data_move
  *
@@ -302,7 +477,8 @@ gpupreagg_final_data_move(kern_context *kcxt,
 KERNEL_FUNCTION(void)
 gpupreagg_setup_row(kern_gpupreagg *kgpreagg,
 					kern_data_store *kds_src,	/* in: KDS_FORMAT_ROW */
-					kern_data_store *kds_slot)	/* out: KDS_FORMAT_SLOT */
+					kern_data_store *kds_slot,	/* out: KDS_FORMAT_SLOT */
+					kern_gpupreagg_dict *kdict)	/* out: dictionary */
 {
 	kern_parambuf  *kparams = KERN_GPUPREAGG_PARAMBUF(kgpreagg);
 	kern_context	kcxt;
@@ -384,6 +560,13 @@ gpupreagg_setup_row(kern_gpupreagg *kgpreagg,
 										 &tupitem->htup,
 										 slot_values,
 										 slot_isnull);
+#ifdef GPUPREAGG_DICTIONARY_ENCODE
+				gpupreagg_dictionary_encode(&kcxt,
+											kdict,
+											kgpreagg->pg_crc32_table,
+											slot_isnull,
+											slot_values);
+#endif
 			}
 		}
 		/* bailout if any error */
@@ -409,7 +592,8 @@ gpupreagg_setup_row(kern_gpupreagg *kgpreagg,
 KERNEL_FUNCTION(void)
 gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 					  kern_data_store *kds_src,
-					  kern_data_store *kds_slot)
+					  kern_data_store *kds_slot,
+					  kern_gpupreagg_dict *kdict)
 {
 	kern_parambuf  *kparams = KERN_GPUPREAGG_PARAMBUF(kgpreagg);
 	kern_context	kcxt;
@@ -471,7 +655,11 @@ gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 				{
 					ItemIdData *lpp = PageGetItemId(pg_page, line_no + 1);
 					if (ItemIdIsNormal(lpp))
+					{
 						htup = PageGetItem(pg_page, lpp);
+						if (!HeapTupleSatisfiesHints(&kcxt, pg_page, htup))
+							htup = NULL;
+					}
 				}
 			}
 			else
@@ -484,12 +672,12 @@ gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 #ifdef GPUPREAGG_HAS_OUTER_QUALS
 			if (htup)
 				rc = gpuscan_quals_eval(&kcxt, kds_src, &t_self, htup);
-			/* bailout if any errors */
-			if (__syncthreads_count(kcxt.e.errcode) > 0)
-				goto out;
 #else
 			rc = true;
 #endif
+			/* bailout if any errors */
+			if (__syncthreads_count(kcxt.e.errcode) > 0)
+				goto out;
 			/* allocation of the kds_slot buffer */
 			offset = pgstromStairlikeBinaryCount(htup && rc, &nvalids);
 			if (nvalids > 0)
@@ -515,6 +703,13 @@ gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 											 htup,
 											 slot_values,
 											 slot_isnull);
+#ifdef GPUPREAGG_DICTIONARY_ENCODE
+					gpupreagg_dictionary_encode(&kcxt,
+												kdict,
+												kgpreagg->pg_crc32_table,
+												slot_isnull,
+												slot_values);
+#endif
 				}
 				/* bailout if any errors */
 				if (__syncthreads_count(kcxt.e.errcode) > 0)
@@ -552,7 +747,8 @@ out:
 KERNEL_FUNCTION(void)
 gpupreagg_setup_column(kern_gpupreagg *kgpreagg,
 					   kern_data_store *kds_src,	/* in: KDS_FORMAT_COLUMN */
-					   kern_data_store *kds_slot)	/* out: KDS_FORMAT_SLOT */
+					   kern_data_store *kds_slot,	/* out: KDS_FORMAT_SLOT */
+					   kern_gpupreagg_dict *kdict)	/* out: dictionary */
 {
 	kern_parambuf  *kparams = KERN_GPUPREAGG_PARAMBUF(kgpreagg);
 	kern_context	kcxt;
@@ -572,6 +768,11 @@ gpupreagg_setup_column(kern_gpupreagg *kgpreagg,
 	INIT_KERNEL_CONTEXT(&kcxt, gpupreagg_setup_column, kparams);
 	if (get_local_id() == 0)
 		status = StromError_Success;
+	/* setup column-vector references */
+#ifdef GPUPREAGG_PULLUP_OUTER_SCAN
+	gpuscan_quals_colvec_setup(kds_src);
+#endif
+	gpupreagg_projection_colvec_setup(kds_src);
 	__syncthreads();
 
 	do {
@@ -628,6 +829,13 @@ gpupreagg_setup_column(kern_gpupreagg *kgpreagg,
 											src_index,
 											slot_values,
 											slot_isnull);
+#ifdef GPUPREAGG_DICTIONARY_ENCODE
+				gpupreagg_dictionary_encode(&kcxt,
+											kdict,
+											kgpreagg->pg_crc32_table,
+											slot_isnull,
+											slot_values);
+#endif
 			}
 		}
 		/* bailout if any error */
@@ -1172,6 +1380,16 @@ retry_fnext:
 /* keep shared memory consumption less than 32KB */
 #define GPUPREAGG_LOCAL_HASHSIZE	1720
 
+/*
+ * Owner threads of the local hash-slot keep the accumulated values of
+ * their groups across the iterations, and merge them into the final
+ * hash-slot only when they exceed the threshold (or at the last round).
+ * Low-cardinality grouping keys thus touch the global hash-slot with
+ * atomic operations only once per group and thread block. Non-owner
+ * threads still fetch at least half of the block size rows per round.
+ */
+#define GPUPREAGG_LOCAL_FLUSH_THRESHOLD(nthreads)	((nthreads) / 2)
+
 KERNEL_FUNCTION_MAXTHREADS(void)
 gpupreagg_groupby_reduction(kern_gpupreagg *kgpreagg,		/* in/out */
 							kern_errorbuf *kgjoin_errorbuf,	/* in */
@@ -1366,7 +1584,8 @@ clean_restart:
 		 * final reduction steps if needed
 		 */
 		count = __syncthreads_count(is_owner);
-		if (is_last_reduction || count > get_local_size() / 8)
+		if (is_last_reduction ||
+			count > GPUPREAGG_LOCAL_FLUSH_THRESHOLD(get_local_size()))
 		{
 			cl_bool		lock_wait;
 
@@ -29,12 +29,21 @@
  * | |     :         |  v
  * +-+---------------+ ---
  */
+#define GPUSCAN_RECHECK_NROOMS		512
+
 struct kern_gpuscan {
 	kern_errorbuf	kerror;
 	cl_uint			read_src_pos;
 	cl_uint			nitems_in;
 	cl_uint			nitems_out;
 	cl_uint			extra_size;
+	/*
+	 * rows to be rechecked by CPU; offset of the tuple (ROW format) or
+	 * the line pointer (BLOCK format) from the head of kds_src. Once it
+	 * overflows, the whole chunk shall be rechecked by CPU.
+	 */
+	cl_uint			nitems_recheck;
+	cl_uint			recheck_rows[GPUSCAN_RECHECK_NROOMS];
 	/* performance profile */
 	struct {
 		cl_float	tv_kern_exec_quals;
@@ -151,6 +160,84 @@ PageGetMaxOffsetNumber(PageHeaderData *page)
 	return (pd_lower <= SizeOfPageHeaderData ? 0 :
 			(pd_lower - SizeOfPageHeaderData) / sizeof(ItemIdData));
 }
+
+/* definitions at access/transam.h */
+#define FirstNormalTransactionId	((TransactionId) 3)
+#define TransactionIdIsNormal(xid)	((xid) >= FirstNormalTransactionId)
+
+STATIC_INLINE(cl_bool)
+TransactionIdPrecedes(TransactionId id1, TransactionId id2)
+{
+	if (!TransactionIdIsNormal(id1) || !TransactionIdIsNormal(id2))
+		return (id1 < id2);
+	return ((cl_int)(id1 - id2) < 0);
+}
+
+STATIC_INLINE(cl_bool)
+TransactionIdIsKnownCommitted(kern_parambuf *kparams, TransactionId xid)
+{
+	cl_uint		i, nitems = __ldg(&kparams->nCommittedXids);
+
+	for (i=0; i < nitems; i++)
+	{
+		if (__ldg(&kparams->committedXids[i]) == xid)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * HeapTupleSatisfiesHints
+ *
+ * It checks visibility of the tuple on the blocks which were loaded by
+ * SSD-to-GPU P2P DMA without visibility checks by CPU. All the tuples on
+ * the all-visible page are visible. Elsewhere, a tuple is visible if its
+ * xmin is frozen or committed prior to the snapshot's xmin, and its xmax
+ * is invalid or locker-only. If hint-bits cannot determine visibility of
+ * the tuple, it requests CPU fallback to check it exactly.
+ */
+STATIC_INLINE(cl_bool)
+HeapTupleSatisfiesHints(kern_context *kcxt,
+						PageHeaderData *pg_page,
+						HeapTupleHeaderData *htup)
+{
+	kern_parambuf  *kparams = kcxt->kparams;
+	TransactionId	snap_xmin;
+	TransactionId	xmin;
+	TransactionId	xmax;
+	cl_ushort		infomask;
+
+	if ((__ldg(&pg_page->pd_flags) & PD_ALL_VISIBLE) != 0)
+		return true;
+	snap_xmin = __ldg(&kparams->xactSnapshotXmin);
+	if (snap_xmin == 0)
+		goto recheck;
+
+	infomask = htup->t_infomask;
+	xmin = htup->t_choice.t_heap.t_xmin;
+	xmax = htup->t_choice.t_heap.t_xmax;
+	/* check xmin */
+	if ((infomask & HEAP_XMIN_FROZEN) == HEAP_XMIN_INVALID)
+		return false;	/* inserted by aborted transaction */
+	if ((infomask & HEAP_XMIN_FROZEN) != HEAP_XMIN_FROZEN)
+	{
+		if ((infomask & HEAP_XMIN_COMMITTED) != 0
+			? !TransactionIdPrecedes(xmin, snap_xmin)
+			: !TransactionIdIsKnownCommitted(kparams, xmin))
+			goto recheck;
+	}
+	/* check xmax */
+	if ((infomask & HEAP_XMAX_INVALID) != 0 ||
+		HEAP_XMAX_IS_LOCKED_ONLY(infomask))
+		return true;
+	if ((infomask & (HEAP_XMAX_COMMITTED |
+					 HEAP_XMAX_IS_MULTI)) == HEAP_XMAX_COMMITTED &&
+		TransactionIdPrecedes(xmax, snap_xmin))
+		return false;	/* deleted prior to the snapshot */
+recheck:
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	return false;
+}
 #endif	/* __CUDACC__ */
 
 /*
@@ -187,7 +274,7 @@ KDS_BLOCK_REF_HTUP(kern_data_store *kds,
 	{
 		p_self->ip_blkid.bi_hi	= block_nr >> 16;
 		p_self->ip_blkid.bi_lo	= block_nr & 0xffff;
-		p_self->ip_posid		= lpp - pg_page->pd_linp;
+		p_self->ip_posid		= lpp - pg_page->pd_linp + 1;
 	}
 	if (p_len)
 		*p_len = ItemIdGetLength(lpp);
@@ -209,6 +296,50 @@ gpuscan_quals_eval_column(kern_context *kcxt,
 						  kern_data_store *kds,
 						  cl_uint src_index);
 
+STATIC_FUNCTION(void)
+gpuscan_quals_colvec_setup(kern_data_store *kds);
+
+/*
+ * gpuscan_tablesample_bernoulli
+ *
+ * It picks up the tuple in the same manner as the built-in BERNOULLI
+ * tablesample method; the tuple is sampled if hash_any() of the (block
+ * number, item offset, seed) is less than the cutoff. So, the result is
+ * identical to the one by CPU, including REPEATABLE clause.
+ */
+#define __HASH_ROT(x,k)		(((x) << (k)) | ((x) >> (32 - (k))))
+STATIC_INLINE(cl_bool)
+gpuscan_tablesample_bernoulli(kern_context *kcxt, ItemPointerData *t_self)
+{
+	kern_parambuf  *kparams = kcxt->kparams;
+	cl_uint			a, b, c;
+
+	/* equivalent to hash_any() for 12 bytes aligned key */
+	a = b = c = 0x9e3779b9 + 12 + 3923095;
+	a += (((cl_uint)t_self->ip_blkid.bi_hi << 16) |
+		  ((cl_uint)t_self->ip_blkid.bi_lo));
+	b += (cl_uint)t_self->ip_posid;
+	c += kparams->tablesample_seed;
+	/* mix(a,b,c) */
+	a -= c;  a ^= __HASH_ROT(c, 4);  c += b;
+	b -= a;  b ^= __HASH_ROT(a, 6);  a += c;
+	c -= b;  c ^= __HASH_ROT(b, 8);  b += a;
+	a -= c;  a ^= __HASH_ROT(c,16);  c += b;
+	b -= a;  b ^= __HASH_ROT(a,19);  a += c;
+	c -= b;  c ^= __HASH_ROT(b, 4);  b += a;
+	/* final(a,b,c) */
+	c ^= b; c -= __HASH_ROT(b,14);
+	a ^= c; a -= __HASH_ROT(c,11);
+	b ^= a; b -= __HASH_ROT(a,25);
+	c ^= b; c -= __HASH_ROT(b,16);
+	a ^= c; a -= __HASH_ROT(c, 4);
+	b ^= a; b -= __HASH_ROT(a,14);
+	c ^= b; c -= __HASH_ROT(b,24);
+
+	return ((cl_ulong)c < kparams->tablesample_cutoff);
+}
+#undef __HASH_ROT
+
 STATIC_FUNCTION(void)
 gpuscan_projection_tuple(kern_context *kcxt,
 						 kern_data_store *kds_src,
@@ -226,6 +357,34 @@ gpuscan_projection_column(kern_context *kcxt,
 						  cl_bool *tup_isnull,
 						  char *extra_buf);
 
+STATIC_FUNCTION(void)
+gpuscan_projection_colvec_setup(kern_data_store *kds);
+
+#ifdef __CUDACC__
+/*
+ * gpuscan_recheck_row
+ *
+ * It records the row which raised CpuReCheck on the recheck buffer, then
+ * clears the error status, to continue the kernel for the rest of rows.
+ * If the recheck buffer has no room, CpuReCheck error is kept.
+ */
+STATIC_INLINE(cl_bool)
+gpuscan_recheck_row(kern_context *kcxt, kern_gpuscan *kgpuscan,
+					cl_uint kds_offset)
+{
+	cl_uint		index;
+
+	if (kcxt->e.errcode != StromError_CpuReCheck)
+		return false;
+	index = atomicAdd(&kgpuscan->nitems_recheck, 1);
+	if (index >= GPUSCAN_RECHECK_NROOMS)
+		return false;
+	kgpuscan->recheck_rows[index] = kds_offset;
+	kcxt->e.errcode = StromError_Success;
+	return true;
+}
+#endif	/* __CUDACC__ */
+
 #ifdef GPUSCAN_KERNEL_REQUIRED
 /*
  * gpuscan_exec_quals_row - GpuScan logic for KDS_FORMAT_ROW
@@ -303,23 +462,14 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 			tupitem = NULL;
 			rc = false;
 		}
-#ifdef GPUSCAN_HAS_WHERE_QUALS
-		/* bailout if any error */
-		if (__syncthreads_count(kcxt.e.errcode) > 0)
-			break;
+#ifdef GPUSCAN_HAS_TABLESAMPLE
+		if (tupitem && rc)
+			rc = gpuscan_tablesample_bernoulli(&kcxt, &tupitem->t_self);
 #endif
-		/* how many rows servived WHERE-clause evaluation? */
-		nitems_offset = pgstromStairlikeBinaryCount(tupitem && rc, &nvalids);
-		if (nvalids == 0)
-			goto skip;
-
+		required = 0;
 #ifdef GPUSCAN_HAS_DEVICE_PROJECTION
-		if (get_local_id() == 0)
-			nitems_base = atomicAdd(&kds_dst->nitems, nvalids);
-		__syncthreads();
-
 		/* extract the source tuple to the private slot, if any */
-		if (tupitem && rc)
+		if (kds_dst && tupitem && rc)
 		{
 			gpuscan_projection_tuple(&kcxt,
 									 kds_src,
@@ -334,8 +484,37 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 													   tup_values,
 													   tup_isnull));
 		}
-		else
+#endif
+		/* only this row is rechecked by CPU, if CpuReCheck */
+		if (tupitem &&
+			gpuscan_recheck_row(&kcxt, kgpuscan, (cl_uint)
+								((char *)&tupitem->htup - (char *)kds_src)))
+		{
+			rc = false;
 			required = 0;
+		}
+#ifdef GPUSCAN_HAS_WHERE_QUALS
+		/* bailout if any error */
+		if (__syncthreads_count(kcxt.e.errcode) > 0)
+			break;
+#endif
+		/* how many rows servived WHERE-clause evaluation? */
+		nitems_offset = pgstromStairlikeBinaryCount(tupitem && rc, &nvalids);
+		if (nvalids == 0)
+			goto skip;
+
+#ifdef GPUSCAN_HAS_DEVICE_PROJECTION
+		/*
+		 * NOTE: kds_dst == NULL means late materialization mode; the kernel
+		 * writes back only a selection vector, then host-side fetches and
+		 * projects the tuples which survived the WHERE-clause.
+		 */
+		if (!kds_dst)
+			goto selection_vector;
+
+		if (get_local_id() == 0)
+			nitems_base = atomicAdd(&kds_dst->nitems, nvalids);
+		__syncthreads();
 
 		usage_offset = pgstromStairlikeSum(required, &extra_sz);
 		if (get_local_id() == 0)
@@ -381,12 +560,14 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 		__syncthreads();
 		if (status != StromError_Success)
 			break;
-#else
+		goto skip;
+	selection_vector:
+#endif
 		if (get_local_id() == 0)
 			nitems_base = atomicAdd(&kresults->nitems, nvalids);
 		__syncthreads();
 
-		if (nitems_base + nvalids >= kresults->nrooms)
+		if (nitems_base + nvalids > kresults->nrooms)
 		{
 			STROM_SET_ERROR(&kcxt.e, StromError_DataStoreNoSpace);
 			break;
@@ -398,7 +579,6 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 			kresults->results[nitems_base + nitems_offset] = (cl_uint)
 				((char *)(&tupitem->htup) - (char *)(kds_src));
 		}
-#endif
 	skip:
 		/* update statistics */
 		if (get_local_id() == 0)
@@ -430,6 +610,7 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 						 kern_data_store *kds_dst)
 {
 	kern_parambuf  *kparams = KERN_GPUSCAN_PARAMBUF(kgpuscan);
+	kern_resultbuf *kresults = KERN_GPUSCAN_RESULTBUF(kgpuscan);
 	kern_context	kcxt;
 	cl_uint			src_nitems = kds_src->nitems;
 	cl_uint			part_sz;
@@ -462,7 +643,7 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 	__shared__ cl_int	status __attribute__((unused));
 
 	assert(kds_src->format == KDS_FORMAT_BLOCK);
-	assert(kds_dst->format == KDS_FORMAT_ROW);
+	assert(!kds_dst || kds_dst->format == KDS_FORMAT_ROW);
 	INIT_KERNEL_CONTEXT(&kcxt, gpuscan_exec_quals_block, kparams);
 	if (get_local_id() == 0)
 		status = StromError_Success;
@@ -497,6 +678,7 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 			PageHeaderData *pg_page;
 			BlockNumber	block_nr;
 			cl_ushort	t_len	__attribute__((unused));
+			cl_uint		lp_offset = 0;
 			cl_uint		required;
 			cl_uint		extra_sz = 0;
 			cl_bool		rc;
@@ -515,8 +697,13 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 				{
 					ItemIdData *lpp = PageGetItemId(pg_page, line_no+1);
 					if (ItemIdIsNormal(lpp))
+					{
 						htup = PageGetItem(pg_page, lpp);
+						if (!HeapTupleSatisfiesHints(&kcxt, pg_page, htup))
+							htup = NULL;
+					}
 					t_len = ItemIdGetLength(lpp);
+					lp_offset = (cl_uint)((char *)lpp - (char *)kds_src);
 				}
 			}
 
@@ -528,24 +715,18 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 										htup);
 			else
 				rc = false;
-			/* bailout if any error */
-			if (__syncthreads_count(kcxt.e.errcode) > 0)
-			{
-				try_next_window = false;
-				break;
-			}
 #else
 			rc = true;
 #endif
-			/* how many rows servived WHERE-clause evaluations? */
-			nitems_offset = pgstromStairlikeBinaryCount(htup && rc, &nvalids);
-			if (nvalids == 0)
-				goto skip;
-
-			/* store the result heap-tuple to destination buffer */
+#ifdef GPUSCAN_HAS_TABLESAMPLE
 			if (htup && rc)
-			{
+				rc = gpuscan_tablesample_bernoulli(&kcxt, &t_self);
+#endif
+			required = 0;
 #ifdef GPUSCAN_HAS_DEVICE_PROJECTION
+			/* extract the source tuple to the private slot, if any */
+			if (kds_dst && htup && rc)
+			{
 				gpuscan_projection_tuple(&kcxt,
 										 kds_src,
 										 htup,
@@ -558,14 +739,56 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 														   kds_dst,
 														   tup_values,
 														   tup_isnull));
+			}
 #else
-				/* no projection; just write the source tuple as is */
+			/* no projection; just write the source tuple as is */
+			if (kds_dst && htup && rc)
 				required = MAXALIGN(offsetof(kern_tupitem, htup) + t_len);
 #endif
-			}
-			else
+			/*
+			 * only this row is rechecked by CPU, if CpuReCheck. Note that
+			 * htup is already NULL if visibility check raised CpuReCheck,
+			 * then the whole chunk falls back.
+			 */
+			if (htup && gpuscan_recheck_row(&kcxt, kgpuscan, lp_offset))
+			{
+				rc = false;
 				required = 0;
+			}
+			/* bailout if any error */
+			if (__syncthreads_count(kcxt.e.errcode) > 0)
+			{
+				try_next_window = false;
+				break;
+			}
+			/* how many rows servived WHERE-clause evaluations? */
+			nitems_offset = pgstromStairlikeBinaryCount(htup && rc, &nvalids);
+			if (nvalids == 0)
+				goto skip;
 
+			/*
+			 * Late materialization mode; write back only the offset of
+			 * line pointers, then host-side fetches the tuples from the
+			 * source blocks which are still kept on the host memory.
+			 */
+			if (!kds_dst)
+			{
+				if (get_local_id() == 0)
+					nitems_base = atomicAdd(&kresults->nitems, nvalids);
+				__syncthreads();
+
+				if (nitems_base + nvalids > kresults->nrooms)
+				{
+					STROM_SET_ERROR(&kcxt.e, StromError_DataStoreNoSpace);
+					try_next_window = false;
+					break;
+				}
+				if (htup && rc)
+					kresults->results[nitems_base + nitems_offset] = lp_offset;
+				goto skip;
+			}
+
+			/* store the result heap-tuple to destination buffer */
 			usage_offset = pgstromStairlikeSum(required, &extra_sz);
 			if (get_local_id() == 0)
 			{
@@ -708,6 +931,9 @@ gpuscan_exec_quals_column(kern_gpuscan *kgpuscan,
 	INIT_KERNEL_CONTEXT(&kcxt, gpuscan_exec_quals_column, kparams);
 	if (get_local_id() == 0)
 		status = StromError_Success;
+	/* setup column-vector references */
+	gpuscan_quals_colvec_setup(kds_src);
+	gpuscan_projection_colvec_setup(kds_src);
 	__syncthreads();
 
 	do {
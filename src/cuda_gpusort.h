@@ -0,0 +1,294 @@
+/*
+ * cuda_gpusort.h
+ *
+ * GPU implementation of bitonic sorting per chunk
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_GPUSORT_H
+#define CUDA_GPUSORT_H
+
+/*
+ * kern_gpusort
+ *
+ * +-----------------------+
+ * | kern_gpusort          |
+ * |    :                  |
+ * +-----------------------+ <- kparams_offset
+ * | kern_parambuf         |
+ * |    :                  |
+ * +-----------------------+ <- results_offset
+ * | cl_uint               |
+ * |   results[nitems]     |
+ * +-----------------------+
+ *
+ * results[] is index of the rows in kds_src, sorted by the keys. The sort
+ * keys are loaded on the kds_slot (KDS_FORMAT_SLOT) prior to the sorting.
+ */
+typedef struct
+{
+	kern_errorbuf	kerror;				/* kernel error information */
+	cl_uint			nitems;				/* # of rows in kds_src */
+	cl_uint			kparams_offset;
+	cl_uint			results_offset;
+} kern_gpusort;
+
+#define KERN_GPUSORT_PARAMBUF(kgpusort)								\
+	((kern_parambuf *)((char *)(kgpusort) + (kgpusort)->kparams_offset))
+#define KERN_GPUSORT_RESULTS(kgpusort)								\
+	((cl_uint *)((char *)(kgpusort) + (kgpusort)->results_offset))
+#define KERN_GPUSORT_LENGTH(kgpusort)								\
+	((kgpusort)->results_offset +									\
+	 STROMALIGN(sizeof(cl_uint) * (kgpusort)->nitems))
+
+#ifdef __CUDACC__
+/*
+ * gpusort_projection_row - to be generated by PG-Strom on the fly
+ *
+ * It extracts a row of the source chunk, and put the sort keys on the slot.
+ */
+STATIC_FUNCTION(void)
+gpusort_projection_row(kern_context *kcxt,
+					   kern_data_store *kds_src,
+					   HeapTupleHeaderData *htup,
+					   Datum *dst_values,
+					   cl_bool *dst_isnull);
+
+/*
+ * gpusort_keycomp - to be generated by PG-Strom on the fly
+ *
+ * It compares the sort keys of the two rows on the slot, and returns
+ * negative, zero or positive value according to the sort order.
+ */
+STATIC_FUNCTION(cl_int)
+gpusort_keycomp(kern_context *kcxt,
+				kern_data_store *kds_slot,
+				size_t x_index,
+				size_t y_index);
+
+/*
+ * gpusort_setup_row
+ *
+ * It loads the sort keys of the source rows on the kds_slot, and
+ * initializes the results[] by the identical order.
+ */
+KERNEL_FUNCTION(void)
+gpusort_setup_row(kern_gpusort *kgpusort,
+				  kern_data_store *kds_src,		/* in: KDS_FORMAT_ROW */
+				  kern_data_store *kds_slot)	/* out: KDS_FORMAT_SLOT */
+{
+	kern_parambuf  *kparams = KERN_GPUSORT_PARAMBUF(kgpusort);
+	cl_uint		   *results = KERN_GPUSORT_RESULTS(kgpusort);
+	kern_context	kcxt;
+	kern_tupitem   *tupitem;
+	cl_uint			index;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpusort_setup_row, kparams);
+
+	for (index = get_global_id();
+		 index < kgpusort->nitems;
+		 index += get_global_size())
+	{
+		tupitem = KERN_DATA_STORE_TUPITEM(kds_src, index);
+		gpusort_projection_row(&kcxt,
+							   kds_src,
+							   &tupitem->htup,
+							   KERN_DATA_STORE_VALUES(kds_slot, index),
+							   KERN_DATA_STORE_ISNULL(kds_slot, index));
+		results[index] = index;
+	}
+	/* write back error status if any */
+	kern_writeback_error_status(&kgpusort->kerror, &kcxt.e);
+}
+
+/*
+ * gpusort_bitonic_local
+ *
+ * It applies each steps of bitonic-sorting until its unit size reaches
+ * the 2 * block size (that is expected to power of 2).
+ */
+KERNEL_FUNCTION_MAXTHREADS(void)
+gpusort_bitonic_local(kern_gpusort *kgpusort,
+					  kern_data_store *kds_slot)
+{
+	kern_parambuf  *kparams = KERN_GPUSORT_PARAMBUF(kgpusort);
+	cl_uint		   *results = KERN_GPUSORT_RESULTS(kgpusort);
+	cl_uint		   *localIdx = SHARED_WORKMEM(cl_uint);
+	kern_context	kcxt;
+	cl_uint			nitems = kgpusort->nitems;
+	cl_uint			part_size = 2 * get_local_size();
+	cl_uint			part_base = get_global_index() * part_size;
+	cl_uint			localLimit;
+	cl_uint			blockSize;
+	cl_uint			unitSize;
+	cl_uint			i;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpusort_bitonic_local, kparams);
+
+	/* Load index to localIdx[] */
+	localLimit = (part_base + part_size <= nitems
+				  ? part_size
+				  : nitems - part_base);
+	for (i = get_local_id(); i < localLimit; i += get_local_size())
+		localIdx[i] = results[part_base + i];
+	__syncthreads();
+
+	for (blockSize = 2; blockSize <= part_size; blockSize *= 2)
+	{
+		for (unitSize = blockSize; unitSize >= 2; unitSize /= 2)
+		{
+			cl_uint		unitMask		= (unitSize - 1);
+			cl_uint		halfUnitSize	= (unitSize >> 1);
+			cl_uint		halfUnitMask	= (halfUnitSize - 1);
+			cl_bool		reversing		= (unitSize == blockSize);
+			cl_uint		idx0, idx1;
+
+			idx0 = (((get_local_id() & ~halfUnitMask) << 1) +
+					(get_local_id() & halfUnitMask));
+			idx1 = (reversing
+					? ((idx0 & ~unitMask) | (~idx0 & unitMask))
+					: (halfUnitSize + idx0));
+			if (idx1 < localLimit)
+			{
+				cl_uint		pos0 = localIdx[idx0];
+				cl_uint		pos1 = localIdx[idx1];
+
+				if (gpusort_keycomp(&kcxt, kds_slot, pos0, pos1) > 0)
+				{
+					/* swap them */
+					localIdx[idx0] = pos1;
+					localIdx[idx1] = pos0;
+				}
+			}
+			__syncthreads();
+		}
+	}
+	/* write back local sorted result */
+	for (i = get_local_id(); i < localLimit; i += get_local_size())
+		results[part_base + i] = localIdx[i];
+	__syncthreads();
+
+	/* write back error status if any */
+	kern_writeback_error_status(&kgpusort->kerror, &kcxt.e);
+}
+
+/*
+ * gpusort_bitonic_step
+ *
+ * It applies an individual step of bitonic-sorting over the blocks. Host
+ * code controls synchronization of the steps not to overrun.
+ */
+KERNEL_FUNCTION_MAXTHREADS(void)
+gpusort_bitonic_step(kern_gpusort *kgpusort,
+					 kern_data_store *kds_slot,
+					 cl_uint unitsz,
+					 cl_bool reversing)
+{
+	kern_parambuf  *kparams = KERN_GPUSORT_PARAMBUF(kgpusort);
+	cl_uint		   *results = KERN_GPUSORT_RESULTS(kgpusort);
+	kern_context	kcxt;
+	cl_uint			nitems = kgpusort->nitems;
+	cl_uint			halfUnitSize = unitsz >> 1;
+	cl_uint			halfUnitMask = halfUnitSize - 1;
+	cl_uint			unitMask = unitsz - 1;
+	cl_uint			idx0, idx1;
+	cl_uint			pos0, pos1;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpusort_bitonic_step, kparams);
+
+	idx0 = (((get_global_id() & ~halfUnitMask) << 1)
+			+ (get_global_id() & halfUnitMask));
+	idx1 = (reversing
+			? ((idx0 & ~unitMask) | (~idx0 & unitMask))
+			: (idx0 + halfUnitSize));
+	if (idx1 < nitems)
+	{
+		pos0 = results[idx0];
+		pos1 = results[idx1];
+		if (gpusort_keycomp(&kcxt, kds_slot, pos0, pos1) > 0)
+		{
+			/* swap them */
+			results[idx0] = pos1;
+			results[idx1] = pos0;
+		}
+	}
+	/* write back error status if any */
+	kern_writeback_error_status(&kgpusort->kerror, &kcxt.e);
+}
+
+/*
+ * gpusort_bitonic_merge
+ *
+ * It handles the merging step of bitonic-sorting if unit size becomes less
+ * than or equal to the 2 * block size.
+ */
+KERNEL_FUNCTION_MAXTHREADS(void)
+gpusort_bitonic_merge(kern_gpusort *kgpusort,
+					  kern_data_store *kds_slot)
+{
+	kern_parambuf  *kparams = KERN_GPUSORT_PARAMBUF(kgpusort);
+	cl_uint		   *results = KERN_GPUSORT_RESULTS(kgpusort);
+	cl_uint		   *localIdx = SHARED_WORKMEM(cl_uint);
+	kern_context	kcxt;
+	cl_uint			nitems = kgpusort->nitems;
+	cl_uint			part_size = 2 * get_local_size();
+	cl_uint			part_base = get_global_index() * part_size;
+	cl_uint			localLimit;
+	cl_uint			unitSize;
+	cl_uint			i;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpusort_bitonic_merge, kparams);
+
+	/* Load index to localIdx[] */
+	localLimit = (part_base + part_size <= nitems
+				  ? part_size
+				  : nitems - part_base);
+	for (i = get_local_id(); i < localLimit; i += get_local_size())
+		localIdx[i] = results[part_base + i];
+	__syncthreads();
+
+	/* merge two sorted blocks */
+	for (unitSize = part_size; unitSize >= 2; unitSize >>= 1)
+	{
+		cl_uint		halfUnitSize = (unitSize >> 1);
+		cl_uint		halfUnitMask = (halfUnitSize - 1);
+		cl_uint		idx0, idx1;
+
+		idx0 = (((get_local_id() & ~halfUnitMask) << 1)
+				+ (get_local_id() & halfUnitMask));
+		idx1 = halfUnitSize + idx0;
+
+		if (idx1 < localLimit)
+		{
+			cl_uint		pos0 = localIdx[idx0];
+			cl_uint		pos1 = localIdx[idx1];
+
+			if (gpusort_keycomp(&kcxt, kds_slot, pos0, pos1) > 0)
+			{
+				/* swap them */
+				localIdx[idx0] = pos1;
+				localIdx[idx1] = pos0;
+			}
+		}
+		__syncthreads();
+	}
+	/* write back the merged result */
+	for (i = get_local_id(); i < localLimit; i += get_local_size())
+		results[part_base + i] = localIdx[i];
+	__syncthreads();
+
+	/* write back error status if any */
+	kern_writeback_error_status(&kgpusort->kerror, &kcxt.e);
+}
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_GPUSORT_H */
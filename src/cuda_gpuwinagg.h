@@ -0,0 +1,703 @@
+/*
+ * cuda_gpuwinagg.h
+ *
+ * Device side implementation of window functions which run over the
+ * partition from its head to the current row (or its last peer); like
+ * ROW_NUMBER, RANK, DENSE_RANK or running SUM/COUNT/AVG.
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_GPUWINAGG_H
+#define CUDA_GPUWINAGG_H
+
+/*
+ * Kind of window functions on the device side. AVG() is processed as
+ * a running SUM() on the device, then host divides it by the count.
+ */
+#define GPUWINAGG_FUNC__ROW_NUMBER		1
+#define GPUWINAGG_FUNC__RANK			2
+#define GPUWINAGG_FUNC__DENSE_RANK		3
+#define GPUWINAGG_FUNC__COUNT			4	/* also, count(*) */
+#define GPUWINAGG_FUNC__SUM_INT			5	/* sum on int8 */
+#define GPUWINAGG_FUNC__SUM_FP			6	/* sum on float8 */
+
+#define GPUWINAGG_FUNC_IS_AGGREGATE(kind)		\
+	((kind) >= GPUWINAGG_FUNC__COUNT)
+
+#define GPUWINAGG_MAX_NUM_FUNCS			64
+
+/* flags of the rows */
+#define GPUWINAGG_ROW__PART_HEAD		0x01	/* head of a partition */
+#define GPUWINAGG_ROW__PEER_HEAD		0x02	/* head of a peer group */
+
+/* minimum number of rows to be scanned by a thread sequentially */
+#define GPUWINAGG_MIN_SPAN_SIZE			32
+
+typedef union
+{
+	cl_long		ival;
+	cl_double	fval;
+} gpuwinagg_value;
+
+/*
+ * kern_gpuwinagg
+ *
+ * +-----------------------+
+ * | kern_gpuwinagg        |
+ * |    :                  |
+ * +-----------------------+ <- kparams_offset
+ * | kern_parambuf         |
+ * |    :                  |
+ * +-----------------------+ <- values_offset
+ * | gpuwinagg_value       |
+ * |   values[nfuncs       |
+ * |         * nitems]     |
+ * +-----------------------+ <- counts_offset
+ * | cl_long               |
+ * |   counts[nfuncs       |
+ * |         * nitems]     |
+ * +-----------------------+
+ *
+ * values[] and counts[] are the results of window functions for each row
+ * of the source chunk; count is number of non-NULL values accumulated.
+ * Values of the first partition are relative to the head of chunk, so host
+ * code adds the carry from the previous chunk if partition continues.
+ *
+ * The working area (device only) is a separate buffer. @work_* fields are
+ * offset of the arrays from the head of the working area.
+ */
+typedef struct
+{
+	kern_errorbuf	kerror;				/* kernel error information */
+	cl_uint			nitems;				/* # of rows in kds_src */
+	cl_uint			nfuncs;				/* # of window functions */
+	cl_uint			nspans;				/* # of spans on the segmented scan */
+	cl_uint			span_sz;			/* # of rows per span */
+	cl_bool			has_order_keys;		/* true, if ORDER BY clause */
+	cl_bool			peer_frame;			/* true, if RANGE mode; frame ends at
+										 * the last peer of the current row */
+	/* -- results -- */
+	cl_uint			num_parts;			/* out: # of partitions in chunk */
+	cl_uint			num_peers;			/* out: # of peer groups in chunk */
+	cl_uint			first_part_nitems;	/* out: # of rows in the 1st partition */
+	cl_uint			first_peer_nitems;	/* out: # of rows in the 1st peer */
+	cl_uint			last_part_nitems;	/* out: # of rows in the last partition */
+	cl_uint			last_peer_nitems;	/* out: # of rows in the last peer */
+	cl_uint			last_part_npeers;	/* out: # of peers in the last partition */
+	/* -- layout of buffers -- */
+	cl_uint			kparams_offset;
+	cl_ulong		values_offset;
+	cl_ulong		counts_offset;
+	cl_ulong		work_row_flags;		/* cl_uchar[nitems] */
+	cl_ulong		work_part_hash;		/* cl_uint[nitems] */
+	cl_ulong		work_part_seq;		/* cl_uint[nitems] */
+	cl_ulong		work_peer_seq;		/* cl_uint[nitems] */
+	cl_ulong		work_part_pos;		/* cl_uint[nitems + 2] */
+	cl_ulong		work_peer_pos;		/* cl_uint[nitems + 2] */
+	cl_ulong		work_span_part;		/* cl_uint[nspans] */
+	cl_ulong		work_span_peer;		/* cl_uint[nspans] */
+	cl_ulong		work_span_values;	/* gpuwinagg_value[nfuncs * nspans] */
+	cl_ulong		work_span_counts;	/* cl_long[nfuncs * nspans] */
+	cl_ulong		work_length;		/* length of the working area */
+	cl_char			func_kinds[GPUWINAGG_MAX_NUM_FUNCS];
+	cl_uint			pg_crc32_table[256];	/* master CRC32 table */
+} kern_gpuwinagg;
+
+#define KERN_GPUWINAGG_PARAMBUF(kgwagg)							\
+	((kern_parambuf *)((char *)(kgwagg) + (kgwagg)->kparams_offset))
+#define KERN_GPUWINAGG_VALUES(kgwagg,fn_index)					\
+	((gpuwinagg_value *)((char *)(kgwagg) + (kgwagg)->values_offset) + \
+	 (size_t)(fn_index) * (size_t)(kgwagg)->nitems)
+#define KERN_GPUWINAGG_COUNTS(kgwagg,fn_index)					\
+	((cl_long *)((char *)(kgwagg) + (kgwagg)->counts_offset) +	\
+	 (size_t)(fn_index) * (size_t)(kgwagg)->nitems)
+#define KERN_GPUWINAGG_LENGTH(kgwagg)							\
+	((kgwagg)->counts_offset +									\
+	 STROMALIGN(sizeof(cl_long) * (size_t)(kgwagg)->nfuncs *	\
+				(size_t)(kgwagg)->nitems))
+#define KERN_GPUWINAGG_WORK(kgwagg,kwork,field,type)			\
+	((type *)((char *)(kwork) + (kgwagg)->work_##field))
+
+#ifdef __CUDACC__
+/*
+ * gpuwinagg_projection_row - to be generated by PG-Strom on the fly
+ *
+ * It extracts a row of the source chunk, and put the partition keys,
+ * the sort keys and arguments of window functions on the slot.
+ */
+STATIC_FUNCTION(void)
+gpuwinagg_projection_row(kern_context *kcxt,
+						 kern_data_store *kds_src,
+						 HeapTupleHeaderData *htup,
+						 Datum *dst_values,
+						 cl_bool *dst_isnull);
+
+/*
+ * gpuwinagg_part_hashvalue - to be generated by PG-Strom on the fly
+ *
+ * It computes a hash value of the partition keys.
+ */
+STATIC_FUNCTION(cl_uint)
+gpuwinagg_part_hashvalue(kern_context *kcxt,
+						 cl_uint *crc32_table,
+						 cl_uint hash_value,
+						 cl_bool *slot_isnull,
+						 Datum *slot_values);
+
+/*
+ * gpuwinagg_part_keymatch / gpuwinagg_peer_keymatch
+ *  - to be generated by PG-Strom on the fly
+ *
+ * It returns true, if the partition keys (or the sort keys) of the two
+ * rows are equivalent.
+ */
+STATIC_FUNCTION(cl_bool)
+gpuwinagg_part_keymatch(kern_context *kcxt,
+						kern_data_store *x_kds, size_t x_index,
+						kern_data_store *y_kds, size_t y_index);
+STATIC_FUNCTION(cl_bool)
+gpuwinagg_peer_keymatch(kern_context *kcxt,
+						kern_data_store *x_kds, size_t x_index,
+						kern_data_store *y_kds, size_t y_index);
+
+/*
+ * gpuwinagg_init_value - to be generated by PG-Strom on the fly
+ *
+ * It sets up the initial value and count of the @fn_index'th window
+ * function for a row on the slot.
+ */
+STATIC_FUNCTION(void)
+gpuwinagg_init_value(kern_context *kcxt,
+					 cl_int fn_index,
+					 cl_bool *slot_isnull,
+					 Datum *slot_values,
+					 gpuwinagg_value *p_value,
+					 cl_long *p_count);
+
+STATIC_INLINE(void)
+gpuwinagg_value_add(cl_char kind, gpuwinagg_value *p_value,
+					gpuwinagg_value newval)
+{
+	if (kind == GPUWINAGG_FUNC__SUM_FP)
+		p_value->fval += newval.fval;
+	else
+		p_value->ival += newval.ival;
+}
+
+/*
+ * gpuwinagg_block_segmented_scan
+ *
+ * Exclusive segmented scan of (@p_value, @p_count) pairs over the threads
+ * in a block. @is_head resets the accumulation at the thread, then every
+ * thread receives sum of the values since the last head thread prior to
+ * itself. Supplied shared memory must have (sizeof(gpuwinagg_value) +
+ * sizeof(cl_long) + sizeof(cl_uint)) * get_local_size() bytes.
+ */
+STATIC_FUNCTION(void)
+gpuwinagg_block_segmented_scan(cl_char kind,
+							   cl_bool is_head,
+							   gpuwinagg_value *p_value,
+							   cl_long *p_count)
+{
+	gpuwinagg_value *s_value = SHARED_WORKMEM(gpuwinagg_value);
+	cl_long	   *s_count = (cl_long *)(s_value + get_local_size());
+	cl_uint	   *s_head = (cl_uint *)(s_count + get_local_size());
+	cl_uint		local_id = get_local_id();
+	gpuwinagg_value	l_value;
+	cl_long		l_count;
+	cl_uint		l_head;
+	cl_uint		unitsz;
+
+	s_value[local_id] = *p_value;
+	s_count[local_id] = *p_count;
+	s_head[local_id] = is_head;
+	__syncthreads();
+
+	for (unitsz = 1; unitsz < get_local_size(); unitsz <<= 1)
+	{
+		if (local_id >= unitsz)
+		{
+			l_value = s_value[local_id - unitsz];
+			l_count = s_count[local_id - unitsz];
+			l_head  = s_head[local_id - unitsz];
+		}
+		__syncthreads();
+		if (local_id >= unitsz)
+		{
+			if (!s_head[local_id])
+			{
+				gpuwinagg_value_add(kind, &s_value[local_id], l_value);
+				s_count[local_id] += l_count;
+			}
+			s_head[local_id] |= l_head;
+		}
+		__syncthreads();
+	}
+	if (local_id == 0)
+	{
+		p_value->ival = 0;
+		*p_count = 0;
+	}
+	else
+	{
+		*p_value = s_value[local_id - 1];
+		*p_count = s_count[local_id - 1];
+	}
+	__syncthreads();
+}
+
+/*
+ * gpuwinagg_setup_row
+ *
+ * It loads the source rows on the kds_slot, and computes hash value of
+ * the partition keys.
+ */
+KERNEL_FUNCTION(void)
+gpuwinagg_setup_row(kern_gpuwinagg *kgwagg,
+					kern_data_store *kds_src,	/* in: KDS_FORMAT_ROW */
+					kern_data_store *kds_slot,	/* out: KDS_FORMAT_SLOT */
+					char *kwork)				/* working area */
+{
+	kern_parambuf  *kparams = KERN_GPUWINAGG_PARAMBUF(kgwagg);
+	cl_uint		   *part_hash = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													part_hash,cl_uint);
+	kern_context	kcxt;
+	kern_tupitem   *tupitem;
+	Datum		   *slot_values;
+	cl_bool		   *slot_isnull;
+	cl_uint			hash_value;
+	cl_uint			index;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpuwinagg_setup_row, kparams);
+
+	for (index = get_global_id();
+		 index < kgwagg->nitems;
+		 index += get_global_size())
+	{
+		tupitem = KERN_DATA_STORE_TUPITEM(kds_src, index);
+		slot_values = KERN_DATA_STORE_VALUES(kds_slot, index);
+		slot_isnull = KERN_DATA_STORE_ISNULL(kds_slot, index);
+
+		gpuwinagg_projection_row(&kcxt,
+								 kds_src,
+								 &tupitem->htup,
+								 slot_values,
+								 slot_isnull);
+		INIT_LEGACY_CRC32(hash_value);
+		hash_value = gpuwinagg_part_hashvalue(&kcxt,
+											  kgwagg->pg_crc32_table,
+											  hash_value,
+											  slot_isnull,
+											  slot_values);
+		FIN_LEGACY_CRC32(hash_value);
+		part_hash[index] = hash_value;
+	}
+	/* write back error status if any */
+	kern_writeback_error_status(&kgwagg->kerror, &kcxt.e);
+}
+
+/*
+ * gpuwinagg_setup_flags
+ *
+ * It marks the head of partitions and peer groups by comparison to the
+ * previous row, and sets up the initial value of window functions.
+ */
+KERNEL_FUNCTION(void)
+gpuwinagg_setup_flags(kern_gpuwinagg *kgwagg,
+					  kern_data_store *kds_slot,
+					  char *kwork)
+{
+	kern_parambuf  *kparams = KERN_GPUWINAGG_PARAMBUF(kgwagg);
+	cl_uchar	   *row_flags = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													row_flags,cl_uchar);
+	cl_uint		   *part_hash = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													part_hash,cl_uint);
+	kern_context	kcxt;
+	cl_uchar		flags;
+	cl_uint			index;
+	cl_uint			fn_index;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpuwinagg_setup_flags, kparams);
+
+	for (index = get_global_id();
+		 index < kgwagg->nitems;
+		 index += get_global_size())
+	{
+		if (index == 0 ||
+			part_hash[index] != part_hash[index - 1] ||
+			!gpuwinagg_part_keymatch(&kcxt,
+									 kds_slot, index - 1,
+									 kds_slot, index))
+			flags = (GPUWINAGG_ROW__PART_HEAD | GPUWINAGG_ROW__PEER_HEAD);
+		else if (kgwagg->has_order_keys &&
+				 !gpuwinagg_peer_keymatch(&kcxt,
+										  kds_slot, index - 1,
+										  kds_slot, index))
+			flags = GPUWINAGG_ROW__PEER_HEAD;
+		else
+			flags = 0;
+		row_flags[index] = flags;
+
+		for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+		{
+			gpuwinagg_init_value(&kcxt, fn_index,
+								 KERN_DATA_STORE_ISNULL(kds_slot, index),
+								 KERN_DATA_STORE_VALUES(kds_slot, index),
+								 KERN_GPUWINAGG_VALUES(kgwagg,fn_index) + index,
+								 KERN_GPUWINAGG_COUNTS(kgwagg,fn_index) + index);
+		}
+	}
+	/* write back error status if any */
+	kern_writeback_error_status(&kgwagg->kerror, &kcxt.e);
+}
+
+/*
+ * gpuwinagg_scan_local
+ *
+ * Each thread scans a span of rows sequentially, then writes out the
+ * summary of the span; number of heads and the tail value.
+ */
+KERNEL_FUNCTION(void)
+gpuwinagg_scan_local(kern_gpuwinagg *kgwagg, char *kwork)
+{
+	cl_uchar	   *row_flags = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													row_flags,cl_uchar);
+	cl_uint		   *part_seq = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   part_seq,cl_uint);
+	cl_uint		   *peer_seq = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   peer_seq,cl_uint);
+	cl_uint		   *span_part = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													span_part,cl_uint);
+	cl_uint		   *span_peer = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													span_peer,cl_uint);
+	gpuwinagg_value *span_values = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												span_values,gpuwinagg_value);
+	cl_long		   *span_counts = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													  span_counts,cl_long);
+	cl_uint			span;
+	cl_uint			head;
+	cl_uint			tail;
+	cl_uint			index;
+	cl_uint			fn_index;
+
+	for (span = get_global_id();
+		 span < kgwagg->nspans;
+		 span += get_global_size())
+	{
+		cl_uint		part_count = 0;
+		cl_uint		peer_count = 0;
+
+		head = span * kgwagg->span_sz;
+		tail = Min(head + kgwagg->span_sz, kgwagg->nitems);
+		for (index = head; index < tail; index++)
+		{
+			if ((row_flags[index] & GPUWINAGG_ROW__PART_HEAD) != 0)
+				part_count++;
+			if ((row_flags[index] & GPUWINAGG_ROW__PEER_HEAD) != 0)
+				peer_count++;
+			part_seq[index] = part_count;
+			peer_seq[index] = peer_count;
+		}
+		span_part[span] = part_count;
+		span_peer[span] = peer_count;
+
+		for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+		{
+			cl_char		kind = kgwagg->func_kinds[fn_index];
+			gpuwinagg_value *values = KERN_GPUWINAGG_VALUES(kgwagg,fn_index);
+			cl_long	   *counts = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index);
+			gpuwinagg_value accum;
+			cl_long		count = 0;
+
+			if (!GPUWINAGG_FUNC_IS_AGGREGATE(kind))
+				continue;
+			accum.ival = 0;
+			for (index = head; index < tail; index++)
+			{
+				if ((row_flags[index] & GPUWINAGG_ROW__PART_HEAD) != 0)
+				{
+					accum.ival = 0;
+					count = 0;
+				}
+				gpuwinagg_value_add(kind, &accum, values[index]);
+				count += counts[index];
+				values[index] = accum;
+				counts[index] = count;
+			}
+			span_values[fn_index * kgwagg->nspans + span] = accum;
+			span_counts[fn_index * kgwagg->nspans + span] = count;
+		}
+	}
+}
+
+/*
+ * gpuwinagg_scan_spans
+ *
+ * It runs on a single block, and replaces the summary of spans by the carry
+ * into the span; base of the sequence numbers and the value since the last
+ * partition head in the earlier spans.
+ */
+KERNEL_FUNCTION(void)
+gpuwinagg_scan_spans(kern_gpuwinagg *kgwagg, char *kwork)
+{
+	cl_uint		   *span_part = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													span_part,cl_uint);
+	cl_uint		   *span_peer = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													span_peer,cl_uint);
+	gpuwinagg_value *span_values = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												span_values,gpuwinagg_value);
+	cl_long		   *span_counts = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													  span_counts,cl_long);
+	cl_uint			nspans = kgwagg->nspans;
+	cl_uint			unitsz = (nspans + get_local_size() - 1) / get_local_size();
+	cl_uint			head = Min(get_local_id() * unitsz, nspans);
+	cl_uint			tail = Min(head + unitsz, nspans);
+	cl_uint			span;
+	cl_uint			fn_index;
+	cl_uint			part_base;
+	cl_uint			peer_base;
+	cl_uint			part_total;
+	cl_uint			peer_total;
+
+	/*
+	 * Running values of aggregate functions; it has to be processed prior
+	 * to the sequence numbers, because number of partition heads tells us
+	 * whether the span resets the accumulation.
+	 */
+	for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+	{
+		cl_char		kind = kgwagg->func_kinds[fn_index];
+		gpuwinagg_value *values = span_values + fn_index * nspans;
+		cl_long	   *counts = span_counts + fn_index * nspans;
+		gpuwinagg_value	accum;
+		gpuwinagg_value	temp;
+		cl_long		count = 0;
+		cl_long		ctemp;
+		cl_bool		has_head = false;
+
+		if (!GPUWINAGG_FUNC_IS_AGGREGATE(kind))
+			continue;
+		accum.ival = 0;
+		for (span = head; span < tail; span++)
+		{
+			if (span_part[span] > 0)
+			{
+				accum = values[span];
+				count = counts[span];
+				has_head = true;
+			}
+			else
+			{
+				gpuwinagg_value_add(kind, &accum, values[span]);
+				count += counts[span];
+			}
+		}
+		gpuwinagg_block_segmented_scan(kind, has_head, &accum, &count);
+		for (span = head; span < tail; span++)
+		{
+			temp = values[span];
+			ctemp = counts[span];
+			values[span] = accum;
+			counts[span] = count;
+			if (span_part[span] > 0)
+			{
+				accum = temp;
+				count = ctemp;
+			}
+			else
+			{
+				gpuwinagg_value_add(kind, &accum, temp);
+				count += ctemp;
+			}
+		}
+	}
+
+	/* base of the sequence numbers */
+	part_base = 0;
+	peer_base = 0;
+	for (span = head; span < tail; span++)
+	{
+		part_base += span_part[span];
+		peer_base += span_peer[span];
+	}
+	part_base = pgstromStairlikeSum(part_base, &part_total);
+	peer_base = pgstromStairlikeSum(peer_base, &peer_total);
+	for (span = head; span < tail; span++)
+	{
+		cl_uint		part_temp = span_part[span];
+		cl_uint		peer_temp = span_peer[span];
+
+		span_part[span] = part_base;
+		span_peer[span] = peer_base;
+		part_base += part_temp;
+		peer_base += peer_temp;
+	}
+	if (get_local_id() == 0)
+	{
+		kgwagg->num_parts = part_total;
+		kgwagg->num_peers = peer_total;
+	}
+}
+
+/*
+ * gpuwinagg_scan_final
+ *
+ * It adds the carry into the span on the rows, and builds the position
+ * of the partition / peer heads indexed by the sequence number.
+ */
+KERNEL_FUNCTION(void)
+gpuwinagg_scan_final(kern_gpuwinagg *kgwagg, char *kwork)
+{
+	cl_uchar	   *row_flags = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													row_flags,cl_uchar);
+	cl_uint		   *part_seq = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   part_seq,cl_uint);
+	cl_uint		   *peer_seq = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   peer_seq,cl_uint);
+	cl_uint		   *part_pos = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   part_pos,cl_uint);
+	cl_uint		   *peer_pos = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   peer_pos,cl_uint);
+	cl_uint		   *span_part = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													span_part,cl_uint);
+	cl_uint		   *span_peer = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													span_peer,cl_uint);
+	gpuwinagg_value *span_values = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												span_values,gpuwinagg_value);
+	cl_long		   *span_counts = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+													  span_counts,cl_long);
+	cl_uint			span;
+	cl_uint			head;
+	cl_uint			tail;
+	cl_uint			index;
+	cl_uint			fn_index;
+
+	for (span = get_global_id();
+		 span < kgwagg->nspans;
+		 span += get_global_size())
+	{
+		head = span * kgwagg->span_sz;
+		tail = Min(head + kgwagg->span_sz, kgwagg->nitems);
+		for (index = head; index < tail; index++)
+		{
+			part_seq[index] += span_part[span];
+			peer_seq[index] += span_peer[span];
+			if ((row_flags[index] & GPUWINAGG_ROW__PART_HEAD) != 0)
+				part_pos[part_seq[index]] = index;
+			if ((row_flags[index] & GPUWINAGG_ROW__PEER_HEAD) != 0)
+				peer_pos[peer_seq[index]] = index;
+		}
+
+		for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+		{
+			cl_char		kind = kgwagg->func_kinds[fn_index];
+			gpuwinagg_value *values = KERN_GPUWINAGG_VALUES(kgwagg,fn_index);
+			cl_long	   *counts = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index);
+			gpuwinagg_value carry;
+			cl_long		count;
+
+			if (!GPUWINAGG_FUNC_IS_AGGREGATE(kind))
+				continue;
+			carry = span_values[fn_index * kgwagg->nspans + span];
+			count = span_counts[fn_index * kgwagg->nspans + span];
+			for (index = head; index < tail; index++)
+			{
+				if ((row_flags[index] & GPUWINAGG_ROW__PART_HEAD) != 0)
+					break;
+				gpuwinagg_value_add(kind, &values[index], carry);
+				counts[index] += count;
+			}
+		}
+	}
+}
+
+/*
+ * gpuwinagg_finalize
+ *
+ * It computes the ranking functions from the position of the heads, and
+ * broadcasts the value of the last peer if frame ends at the last peer
+ * of the current row.
+ */
+KERNEL_FUNCTION(void)
+gpuwinagg_finalize(kern_gpuwinagg *kgwagg, char *kwork)
+{
+	cl_uint		   *part_seq = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   part_seq,cl_uint);
+	cl_uint		   *peer_seq = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   peer_seq,cl_uint);
+	cl_uint		   *part_pos = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   part_pos,cl_uint);
+	cl_uint		   *peer_pos = KERN_GPUWINAGG_WORK(kgwagg,kwork,
+												   peer_pos,cl_uint);
+	cl_uint			nitems = kgwagg->nitems;
+	cl_uint			num_parts = kgwagg->num_parts;
+	cl_uint			num_peers = kgwagg->num_peers;
+	cl_uint			index;
+	cl_uint			fn_index;
+
+	if (get_global_id() == 0)
+	{
+		kgwagg->first_part_nitems = (num_parts > 1 ? part_pos[2] : nitems);
+		kgwagg->first_peer_nitems = (num_peers > 1 ? peer_pos[2] : nitems);
+	}
+
+	for (index = get_global_id();
+		 index < nitems;
+		 index += get_global_size())
+	{
+		cl_uint		part_head = part_pos[part_seq[index]];
+		cl_uint		peer_head = peer_pos[peer_seq[index]];
+		cl_uint		peer_tail = (peer_seq[index] < num_peers
+								 ? peer_pos[peer_seq[index] + 1]
+								 : nitems) - 1;
+
+		if (index == nitems - 1)
+		{
+			kgwagg->last_part_nitems = index - part_head + 1;
+			kgwagg->last_peer_nitems = index - peer_head + 1;
+			kgwagg->last_part_npeers = (peer_seq[index] -
+										peer_seq[part_head] + 1);
+		}
+
+		for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+		{
+			cl_char		kind = kgwagg->func_kinds[fn_index];
+			gpuwinagg_value *values = KERN_GPUWINAGG_VALUES(kgwagg,fn_index);
+			cl_long	   *counts = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index);
+
+			switch (kind)
+			{
+				case GPUWINAGG_FUNC__ROW_NUMBER:
+					values[index].ival = index - part_head + 1;
+					break;
+				case GPUWINAGG_FUNC__RANK:
+					values[index].ival = peer_head - part_head + 1;
+					break;
+				case GPUWINAGG_FUNC__DENSE_RANK:
+					values[index].ival = (peer_seq[index] -
+										  peer_seq[part_head] + 1);
+					break;
+				default:
+					/* nobody updates the last peer by itself */
+					if (kgwagg->peer_frame && peer_tail != index)
+					{
+						values[index] = values[peer_tail];
+						counts[index] = counts[peer_tail];
+					}
+					break;
+			}
+		}
+	}
+}
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_GPUWINAGG_H */
@@ -0,0 +1,746 @@
+/*
+ * cuda_jsonlib.h
+ *
+ * Collection of jsonb functions for CUDA GPU devices
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_JSONLIB_H
+#define CUDA_JSONLIB_H
+#ifdef __CUDACC__
+
+/*
+ * On-disk format of jsonb (see utils/jsonb.h)
+ *
+ * A jsonb datum is a varlena that contains a JsonbContainer; a header
+ * word and array of JEntry. Object has 2 x N JEntry (keys first, then
+ * values in the same order), and keys are sorted by length then bytes.
+ * Offset of the child is computed by the sum of lengths of the previous
+ * entries, or HAS_OFF entry for each JB_OFFSET_STRIDE.
+ * Raw scalar value is stored as an array with one element.
+ */
+#define JB_CMASK			0x0FFFFFFFU	/* mask for count field */
+#define JB_FSCALAR			0x10000000U	/* flag bits */
+#define JB_FOBJECT			0x20000000U
+#define JB_FARRAY			0x40000000U
+
+#define JENTRY_OFFLENMASK	0x0FFFFFFFU
+#define JENTRY_TYPEMASK		0x70000000U
+#define JENTRY_HAS_OFF		0x80000000U
+
+#define JENTRY_ISSTRING		0x00000000U
+#define JENTRY_ISNUMERIC	0x10000000U
+#define JENTRY_ISBOOL_FALSE	0x20000000U
+#define JENTRY_ISBOOL_TRUE	0x30000000U
+#define JENTRY_ISNULL		0x40000000U
+#define JENTRY_ISCONTAINER	0x50000000U
+
+#define JBE_OFFLENFLD(je_)	((je_) & JENTRY_OFFLENMASK)
+#define JBE_HAS_OFF(je_)	(((je_) & JENTRY_HAS_OFF) != 0)
+#define JBE_TYPE(je_)		((je_) & JENTRY_TYPEMASK)
+
+#define JB_OFFSET_STRIDE	32
+
+/* max depth of nested containers device code walks on */
+#define JSONB_DEVICE_MAX_DEPTH	16
+
+#ifndef PG_JSONB_TYPE_DEFINED
+#define PG_JSONB_TYPE_DEFINED
+STROMCL_VARLENA_TYPE_TEMPLATE(jsonb)
+#endif
+
+/*
+ * kern_jsonb_value - reference to a child of JsonbContainer
+ */
+typedef struct
+{
+	cl_uint		type;		/* one of JENTRY_IS* */
+	cl_uint		len;		/* length of the data */
+	const char *data;		/* string, numeric varlena or container */
+} kern_jsonb_value;
+
+STATIC_INLINE(cl_uint)
+jsonb_container_header(const char *jc)
+{
+	return *((const cl_uint *)jc);
+}
+
+STATIC_INLINE(const cl_uint *)
+jsonb_container_children(const char *jc)
+{
+	return (const cl_uint *)(jc + sizeof(cl_uint));
+}
+
+STATIC_INLINE(cl_uint)
+jsonb_container_nentries(const char *jc)
+{
+	cl_uint		header = jsonb_container_header(jc);
+	cl_uint		count = (header & JB_CMASK);
+
+	return ((header & JB_FOBJECT) != 0 ? 2 * count : count);
+}
+
+STATIC_INLINE(const char *)
+jsonb_container_base(const char *jc)
+{
+	return (const char *)(jsonb_container_children(jc) +
+						  jsonb_container_nentries(jc));
+}
+
+/* see getJsonbOffset() */
+STATIC_FUNCTION(cl_uint)
+jsonb_child_offset(const char *jc, cl_uint index)
+{
+	const cl_uint  *children = jsonb_container_children(jc);
+	cl_uint			offset = 0;
+	cl_int			i;
+
+	for (i = index - 1; i >= 0; i--)
+	{
+		offset += JBE_OFFLENFLD(__ldg(&children[i]));
+		if (JBE_HAS_OFF(__ldg(&children[i])))
+			break;
+	}
+	return offset;
+}
+
+/* see getJsonbLength() */
+STATIC_INLINE(cl_uint)
+jsonb_child_length(const char *jc, cl_uint index, cl_uint offset)
+{
+	cl_uint		entry = __ldg(&jsonb_container_children(jc)[index]);
+
+	if (JBE_HAS_OFF(entry))
+		return JBE_OFFLENFLD(entry) - offset;
+	return JBE_OFFLENFLD(entry);
+}
+
+/* see fillJsonbValue() */
+STATIC_FUNCTION(void)
+jsonb_fill_value(const char *jc, cl_uint index, kern_jsonb_value *jval)
+{
+	cl_uint		entry = __ldg(&jsonb_container_children(jc)[index]);
+	cl_uint		offset = jsonb_child_offset(jc, index);
+	cl_uint		len = jsonb_child_length(jc, index, offset);
+	const char *base = jsonb_container_base(jc);
+
+	jval->type = JBE_TYPE(entry);
+	if (jval->type == JENTRY_ISNUMERIC ||
+		jval->type == JENTRY_ISCONTAINER)
+	{
+		/* numeric and container are aligned to int */
+		jval->data = base + INTALIGN(offset);
+		jval->len  = len - (INTALIGN(offset) - offset);
+	}
+	else
+	{
+		jval->data = base + offset;
+		jval->len  = len;
+	}
+}
+
+/*
+ * jsonb_find_key - binary search on the sorted keys of the object
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_find_key(const char *jc, const char *key, cl_uint keylen,
+			   kern_jsonb_value *jval)
+{
+	cl_uint		count = (jsonb_container_header(jc) & JB_CMASK);
+	cl_uint		low = 0;
+	cl_uint		high = count;
+	const char *base = jsonb_container_base(jc);
+
+	while (low < high)
+	{
+		cl_uint		middle = low + (high - low) / 2;
+		cl_uint		offset = jsonb_child_offset(jc, middle);
+		cl_uint		len = jsonb_child_length(jc, middle, offset);
+		cl_int		diff;
+
+		if (len != keylen)
+			diff = (len > keylen ? 1 : -1);
+		else
+			diff = memcmp(base + offset, key, keylen);
+
+		if (diff == 0)
+		{
+			jsonb_fill_value(jc, middle + count, jval);
+			return true;
+		}
+		else if (diff < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return false;
+}
+
+/*
+ * Reference to the digits of numeric varlena (see utils/numeric.c)
+ */
+#define JSONB_NUMERIC_SIGN_MASK		0xC000
+#define JSONB_NUMERIC_NEG			0x4000
+#define JSONB_NUMERIC_SHORT			0x8000
+#define JSONB_NUMERIC_NAN			0xC000
+
+typedef struct
+{
+	cl_bool		is_nan;
+	cl_bool		is_neg;
+	cl_int		weight;
+	cl_int		dscale;
+	cl_int		ndigits;
+	const cl_ushort *digits;	/* base-10000 digits */
+} kern_jsonb_numeric;
+
+STATIC_FUNCTION(void)
+jsonb_numeric_decode(const char *data, kern_jsonb_numeric *num)
+{
+	const char *pos = VARDATA_ANY(data);
+	cl_int		len = VARSIZE_ANY_EXHDR(data);
+	cl_ushort	n_header;
+
+	memcpy(&n_header, pos, sizeof(cl_ushort));
+	memset(num, 0, sizeof(kern_jsonb_numeric));
+	if ((n_header & JSONB_NUMERIC_SIGN_MASK) == JSONB_NUMERIC_NAN)
+		num->is_nan = true;
+	else if ((n_header & JSONB_NUMERIC_SIGN_MASK) == JSONB_NUMERIC_SHORT)
+	{
+		/* NumericShort format */
+		num->is_neg = ((n_header & 0x2000) != 0);
+		num->dscale = ((n_header & 0x1F80) >> 7);
+		num->weight = ((n_header & 0x0040) != 0 ? ~0x003F : 0)
+			| (n_header & 0x003F);
+		num->ndigits = (len - sizeof(cl_ushort)) / sizeof(cl_ushort);
+		num->digits = (const cl_ushort *)(pos + sizeof(cl_ushort));
+	}
+	else
+	{
+		/* NumericLong format */
+		cl_short	n_weight;
+
+		memcpy(&n_weight, pos + sizeof(cl_ushort), sizeof(cl_short));
+		num->is_neg = ((n_header & JSONB_NUMERIC_SIGN_MASK) ==
+					   JSONB_NUMERIC_NEG);
+		num->dscale = (n_header & 0x3FFF);
+		num->weight = n_weight;
+		num->ndigits = (len - 2 * sizeof(cl_ushort)) / sizeof(cl_ushort);
+		num->digits = (const cl_ushort *)(pos + 2 * sizeof(cl_ushort));
+	}
+}
+
+/*
+ * jsonb_numeric_equal - numeric values are stripped, so digits and weight
+ * are identical if same value, regardless of the display scale.
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_numeric_equal(const char *data1, const char *data2)
+{
+	kern_jsonb_numeric	x;
+	kern_jsonb_numeric	y;
+	cl_int				i;
+
+	jsonb_numeric_decode(data1, &x);
+	jsonb_numeric_decode(data2, &y);
+	if (x.is_nan || y.is_nan)
+		return (x.is_nan && y.is_nan);
+	if (x.ndigits == 0 || y.ndigits == 0)
+		return (x.ndigits == y.ndigits);
+	if (x.is_neg != y.is_neg ||
+		x.weight != y.weight ||
+		x.ndigits != y.ndigits)
+		return false;
+	for (i=0; i < x.ndigits; i++)
+	{
+		cl_ushort	xd, yd;
+
+		memcpy(&xd, x.digits + i, sizeof(cl_ushort));
+		memcpy(&yd, y.digits + i, sizeof(cl_ushort));
+		if (xd != yd)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * jsonb_numeric_to_cstring - same output as numeric_out().
+ * It returns length of the output, or -1 if buffer is too small.
+ */
+STATIC_FUNCTION(cl_int)
+jsonb_numeric_to_cstring(const char *data, char *buf, cl_int bufsz)
+{
+	kern_jsonb_numeric	num;
+	char	   *pos = buf;
+	char	   *end = buf + bufsz;
+	cl_int		d, i;
+
+	jsonb_numeric_decode(data, &num);
+	if (num.is_nan)
+	{
+		if (bufsz < 3)
+			return -1;
+		memcpy(buf, "NaN", 3);
+		return 3;
+	}
+	/* sign, integer and fraction part; rough estimation of the length */
+	if (1 + 4 * (Max(num.weight, 0) + 1) + 1 + num.dscale + 4 > bufsz)
+		return -1;
+	if (num.is_neg && num.ndigits > 0)
+		*pos++ = '-';
+	if (num.weight < 0)
+		*pos++ = '0';
+	else
+	{
+		for (d = 0; d <= num.weight; d++)
+		{
+			cl_ushort	dig = 0;
+			cl_bool		putit = (d > 0);
+
+			if (d < num.ndigits)
+				memcpy(&dig, num.digits + d, sizeof(cl_ushort));
+			for (i = 1000; i > 0; i /= 10)
+			{
+				cl_int	c = (dig / i) % 10;
+
+				putit |= (c > 0 || i == 1);
+				if (putit)
+					*pos++ = '0' + c;
+			}
+		}
+	}
+	if (num.dscale > 0)
+	{
+		char   *frac;
+
+		*pos++ = '.';
+		frac = pos;
+		for (d = num.weight + 1; pos - frac < num.dscale; d++)
+		{
+			cl_ushort	dig = 0;
+
+			if (d >= 0 && d < num.ndigits)
+				memcpy(&dig, num.digits + d, sizeof(cl_ushort));
+			for (i = 1000; i > 0; i /= 10)
+				*pos++ = '0' + (dig / i) % 10;
+		}
+		pos = frac + num.dscale;
+	}
+	assert(pos <= end);
+	return (cl_int)(pos - buf);
+}
+
+/*
+ * jsonb_scalar_equal - see equalsJsonbScalarValue()
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_scalar_equal(const kern_jsonb_value *x, const kern_jsonb_value *y)
+{
+	if (x->type != y->type)
+		return false;
+	switch (x->type)
+	{
+		case JENTRY_ISSTRING:
+			return (x->len == y->len &&
+					memcmp(x->data, y->data, x->len) == 0);
+		case JENTRY_ISNUMERIC:
+			return jsonb_numeric_equal(x->data, y->data);
+		case JENTRY_ISBOOL_FALSE:
+		case JENTRY_ISBOOL_TRUE:
+		case JENTRY_ISNULL:
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+/*
+ * jsonb_find_scalar - lookup an equivalent scalar element in the array
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_find_scalar(const char *jc, const kern_jsonb_value *key)
+{
+	cl_uint		count = (jsonb_container_header(jc) & JB_CMASK);
+	cl_uint		i;
+
+	for (i=0; i < count; i++)
+	{
+		kern_jsonb_value	jval;
+
+		jsonb_fill_value(jc, i, &jval);
+		if (jsonb_scalar_equal(&jval, key))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * jsonb_deep_contains - see JsonbDeepContains()
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_deep_contains(kern_context *kcxt,
+					const char *val, const char *cont, cl_int depth)
+{
+	cl_uint		vheader = jsonb_container_header(val);
+	cl_uint		cheader = jsonb_container_header(cont);
+	cl_uint		vcount = (vheader & JB_CMASK);
+	cl_uint		ccount = (cheader & JB_CMASK);
+	cl_uint		i, j;
+
+	if (depth > JSONB_DEVICE_MAX_DEPTH)
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		return false;
+	}
+	/* object and array never contain each other */
+	if (((vheader & JB_FOBJECT) != 0) != ((cheader & JB_FOBJECT) != 0))
+		return false;
+
+	if ((vheader & JB_FOBJECT) != 0)
+	{
+		if (vcount < ccount)
+			return false;
+		for (i=0; i < ccount; i++)
+		{
+			kern_jsonb_value	ckey;
+			kern_jsonb_value	cval;
+			kern_jsonb_value	vval;
+
+			jsonb_fill_value(cont, i, &ckey);
+			jsonb_fill_value(cont, i + ccount, &cval);
+			if (!jsonb_find_key(val, ckey.data, ckey.len, &vval))
+				return false;
+			if (vval.type != cval.type &&
+				(vval.type == JENTRY_ISCONTAINER ||
+				 cval.type == JENTRY_ISCONTAINER))
+				return false;
+			if (cval.type != JENTRY_ISCONTAINER)
+			{
+				if (!jsonb_scalar_equal(&vval, &cval))
+					return false;
+			}
+			else if (!jsonb_deep_contains(kcxt, vval.data, cval.data,
+										  depth + 1))
+				return false;
+		}
+	}
+	else
+	{
+		/* raw scalar never contains an array */
+		if ((vheader & JB_FSCALAR) != 0 && (cheader & JB_FSCALAR) == 0)
+			return false;
+		for (i=0; i < ccount; i++)
+		{
+			kern_jsonb_value	cval;
+
+			jsonb_fill_value(cont, i, &cval);
+			if (cval.type != JENTRY_ISCONTAINER)
+			{
+				if (!jsonb_find_scalar(val, &cval))
+					return false;
+			}
+			else
+			{
+				/* any of container elements has to contain it */
+				for (j=0; j < vcount; j++)
+				{
+					kern_jsonb_value	vval;
+
+					jsonb_fill_value(val, j, &vval);
+					if (vval.type == JENTRY_ISCONTAINER &&
+						jsonb_deep_contains(kcxt, vval.data, cval.data,
+											depth + 1))
+						break;
+				}
+				if (j == vcount)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * jsonb_datum_from_value - constructs a new jsonb datum on the per-thread
+ * varlena buffer; scalar value is wrapped by a raw-scalar array.
+ */
+STATIC_FUNCTION(pg_jsonb_t)
+jsonb_datum_from_value(kern_context *kcxt, const kern_jsonb_value *jval)
+{
+	pg_jsonb_t	result;
+	char	   *vl;
+
+	if (jval->type == JENTRY_ISCONTAINER)
+	{
+		vl = (char *)kern_context_alloc(kcxt, VARHDRSZ + jval->len);
+		if (!vl)
+			goto recheck;
+		memcpy(vl + VARHDRSZ, jval->data, jval->len);
+		SET_VARSIZE(vl, VARHDRSZ + jval->len);
+	}
+	else
+	{
+		cl_uint		header = (1 | JB_FARRAY | JB_FSCALAR);
+		cl_uint		entry = (jval->type | JENTRY_HAS_OFF | jval->len);
+		cl_uint		sz = VARHDRSZ + 2 * sizeof(cl_uint) + jval->len;
+
+		vl = (char *)kern_context_alloc(kcxt, sz);
+		if (!vl)
+			goto recheck;
+		memcpy(vl + VARHDRSZ, &header, sizeof(cl_uint));
+		memcpy(vl + VARHDRSZ + sizeof(cl_uint), &entry, sizeof(cl_uint));
+		memcpy(vl + VARHDRSZ + 2 * sizeof(cl_uint), jval->data, jval->len);
+		SET_VARSIZE(vl, sz);
+	}
+	result.isnull = false;
+	result.value = (varlena *)vl;
+	return result;
+
+recheck:
+	result.isnull = true;
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	return result;
+}
+
+/*
+ * jsonb_text_from_value - constructs a new text datum for '->>' operator
+ */
+STATIC_FUNCTION(pg_text_t)
+jsonb_text_from_value(kern_context *kcxt, const kern_jsonb_value *jval)
+{
+	pg_text_t	result;
+	char	   *vl = NULL;
+	cl_int		len;
+
+	switch (jval->type)
+	{
+		case JENTRY_ISNULL:
+			result.isnull = true;
+			return result;
+		case JENTRY_ISSTRING:
+			vl = (char *)kern_context_alloc(kcxt, VARHDRSZ + jval->len);
+			if (!vl)
+				goto recheck;
+			memcpy(vl + VARHDRSZ, jval->data, jval->len);
+			len = jval->len;
+			break;
+		case JENTRY_ISNUMERIC:
+			len = VARHDRSZ + 4 * VARSIZE_ANY_EXHDR(jval->data) + 32;
+			vl = (char *)kern_context_alloc(kcxt, len);
+			if (!vl)
+				goto recheck;
+			len = jsonb_numeric_to_cstring(jval->data, vl + VARHDRSZ,
+										   len - VARHDRSZ);
+			if (len < 0)
+				goto recheck;
+			break;
+		case JENTRY_ISBOOL_TRUE:
+		case JENTRY_ISBOOL_FALSE:
+			len = (jval->type == JENTRY_ISBOOL_TRUE ? 4 : 5);
+			vl = (char *)kern_context_alloc(kcxt, VARHDRSZ + len);
+			if (!vl)
+				goto recheck;
+			memcpy(vl + VARHDRSZ, jval->type == JENTRY_ISBOOL_TRUE
+				   ? "true" : "false", len);
+			break;
+		default:
+			/* text form of the container is built by CPU */
+			goto recheck;
+	}
+	SET_VARSIZE(vl, VARHDRSZ + len);
+	result.isnull = false;
+	result.value = (varlena *)vl;
+	return result;
+
+recheck:
+	result.isnull = true;
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	return result;
+}
+
+/*
+ * jsonb_lookup_field / jsonb_lookup_element - common portion of the
+ * '->' and '->>' operators
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_lookup_field(kern_context *kcxt, pg_jsonb_t arg1, pg_text_t arg2,
+				   kern_jsonb_value *jval)
+{
+	const char *jc;
+
+	if (arg1.isnull || arg2.isnull)
+		return false;
+	jc = VARDATA_ANY(arg1.value);
+	if ((jsonb_container_header(jc) & JB_FOBJECT) == 0)
+		return false;
+	return jsonb_find_key(jc, VARDATA_ANY(arg2.value),
+						  VARSIZE_ANY_EXHDR(arg2.value), jval);
+}
+
+STATIC_FUNCTION(cl_bool)
+jsonb_lookup_element(kern_context *kcxt, pg_jsonb_t arg1, pg_int4_t arg2,
+					 kern_jsonb_value *jval)
+{
+	const char *jc;
+	cl_uint		header;
+	cl_int		count;
+	cl_int		index;
+
+	if (arg1.isnull || arg2.isnull)
+		return false;
+	jc = VARDATA_ANY(arg1.value);
+	header = jsonb_container_header(jc);
+	if ((header & JB_FARRAY) == 0)
+		return false;
+	count = (header & JB_CMASK);
+	index = arg2.value;
+	/* negative subscript counts from the tail */
+	if (index < 0)
+		index += count;
+	if (index < 0 || index >= count)
+		return false;
+	jsonb_fill_value(jc, index, jval);
+	return true;
+}
+
+/*
+ * jsonb -> text
+ */
+STATIC_FUNCTION(pg_jsonb_t)
+pgfn_jsonb_object_field(kern_context *kcxt, pg_jsonb_t arg1, pg_text_t arg2)
+{
+	kern_jsonb_value	jval;
+	pg_jsonb_t			result;
+
+	if (!jsonb_lookup_field(kcxt, arg1, arg2, &jval))
+	{
+		result.isnull = true;
+		return result;
+	}
+	return jsonb_datum_from_value(kcxt, &jval);
+}
+
+/*
+ * jsonb ->> text
+ */
+STATIC_FUNCTION(pg_text_t)
+pgfn_jsonb_object_field_text(kern_context *kcxt,
+							 pg_jsonb_t arg1, pg_text_t arg2)
+{
+	kern_jsonb_value	jval;
+	pg_text_t			result;
+
+	if (!jsonb_lookup_field(kcxt, arg1, arg2, &jval))
+	{
+		result.isnull = true;
+		return result;
+	}
+	return jsonb_text_from_value(kcxt, &jval);
+}
+
+/*
+ * jsonb -> int4
+ */
+STATIC_FUNCTION(pg_jsonb_t)
+pgfn_jsonb_array_element(kern_context *kcxt, pg_jsonb_t arg1, pg_int4_t arg2)
+{
+	kern_jsonb_value	jval;
+	pg_jsonb_t			result;
+
+	if (!jsonb_lookup_element(kcxt, arg1, arg2, &jval))
+	{
+		result.isnull = true;
+		return result;
+	}
+	return jsonb_datum_from_value(kcxt, &jval);
+}
+
+/*
+ * jsonb ->> int4
+ */
+STATIC_FUNCTION(pg_text_t)
+pgfn_jsonb_array_element_text(kern_context *kcxt,
+							  pg_jsonb_t arg1, pg_int4_t arg2)
+{
+	kern_jsonb_value	jval;
+	pg_text_t			result;
+
+	if (!jsonb_lookup_element(kcxt, arg1, arg2, &jval))
+	{
+		result.isnull = true;
+		return result;
+	}
+	return jsonb_text_from_value(kcxt, &jval);
+}
+
+/*
+ * jsonb ? text
+ */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_exists(kern_context *kcxt, pg_jsonb_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+	const char *jc;
+
+	result.isnull = (arg1.isnull || arg2.isnull);
+	if (result.isnull)
+		return result;
+	jc = VARDATA_ANY(arg1.value);
+	if ((jsonb_container_header(jc) & JB_FOBJECT) != 0)
+	{
+		kern_jsonb_value	jval;
+
+		result.value = jsonb_find_key(jc, VARDATA_ANY(arg2.value),
+									  VARSIZE_ANY_EXHDR(arg2.value), &jval);
+	}
+	else
+	{
+		kern_jsonb_value	key;
+
+		/* array contains the string element */
+		key.type = JENTRY_ISSTRING;
+		key.len  = VARSIZE_ANY_EXHDR(arg2.value);
+		key.data = VARDATA_ANY(arg2.value);
+		result.value = jsonb_find_scalar(jc, &key);
+	}
+	return result;
+}
+
+/*
+ * jsonb @> jsonb
+ */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_contains(kern_context *kcxt, pg_jsonb_t arg1, pg_jsonb_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = (arg1.isnull || arg2.isnull);
+	if (!result.isnull)
+		result.value = jsonb_deep_contains(kcxt,
+										   VARDATA_ANY(arg1.value),
+										   VARDATA_ANY(arg2.value), 0);
+	return result;
+}
+
+/*
+ * jsonb <@ jsonb
+ */
+STATIC_INLINE(pg_bool_t)
+pgfn_jsonb_contained(kern_context *kcxt, pg_jsonb_t arg1, pg_jsonb_t arg2)
+{
+	return pgfn_jsonb_contains(kcxt, arg2, arg1);
+}
+
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_JSONLIB_H */
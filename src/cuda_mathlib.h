@@ -1123,6 +1123,39 @@ pgfn_dpi(kern_context *kcxt)
 	return result;
 }
 
+/*
+ * random() - uniform random number in [0.0, 1.0)
+ *
+ * Each thread has its own SplitMix64 sequence on the kern_context, seeded
+ * by kparams->random_seed, thread-id and clock counter on the first call.
+ * It is much lighter than curand_init() of XORWOW for the per-row usage.
+ */
+STATIC_INLINE(cl_ulong)
+pg_random_next(kern_context *kcxt)
+{
+	cl_ulong	z;
+
+	if (kcxt->rand_state == 0)
+		kcxt->rand_state = (kcxt->kparams->random_seed ^
+							((cl_ulong)get_global_id() << 32) ^
+							(cl_ulong)clock64()) | 1UL;
+	z = (kcxt->rand_state += 0x9e3779b97f4a7c15UL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+	return z ^ (z >> 31);
+}
+
+STATIC_FUNCTION(pg_float8_t)
+pgfn_random(kern_context *kcxt)
+{
+	pg_float8_t	result;
+
+	result.isnull = false;
+	result.value = (cl_double)(pg_random_next(kcxt) >> 11) *
+		(1.0 / 9007199254740992.0);		/* 2^-53 */
+	return result;
+}
+
 STATIC_INLINE(pg_float8_t)
 pgfn_round(kern_context *kcxt, pg_float8_t arg1)
 {
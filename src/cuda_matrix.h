@@ -17,6 +17,35 @@
  */
 #ifndef CUDA_MATRIX_H
 #define CUDA_MATRIX_H
+
+/*
+ * kern_array_hashset
+ *
+ * Hash set of the elements of constant array, built on the host side and
+ * delivered as a bytea parameter. It allows to probe ScalarArrayOpExpr
+ * like 'scalar = ANY(constant array)' in O(1), instead of a linear walk
+ * on the large constant array.
+ */
+typedef struct
+{
+	cl_uint		vl_len_;	/* varlena header (only 4B header) */
+	cl_uint		nslots;		/* number of hash slots; power of 2 */
+	cl_uint		nitems;		/* number of non-NULL elements */
+	cl_bool		has_null;	/* array contains NULL elements */
+	cl_uint		crc32_table[256];
+	struct {
+		cl_uint	hash;		/* hash value of the element */
+		cl_uint	offset;		/* offset from ARR_DATA_PTR + 1, or 0 if empty */
+	} slots[FLEXIBLE_ARRAY_MEMBER];
+} kern_array_hashset;
+
+/*
+ * threads block configuration of the GPU operators for array-matrix
+ */
+#define MATRIX_GPU_TILE_SZ		32
+#define MATRIX_GPU_TILE_ROWS	8
+#define MATRIX_GPU_GEMM_SZ		16
+
 #ifdef __CUDACC__
 
 /* ------------------------------------------------------------------
@@ -206,6 +235,76 @@ PG_SCALAR_ARRAY_OP(kern_context *kcxt,
 	return result;
 }
 
+/*
+ * Support routine for ScalarArrayOpExpr with hash set
+ */
+template <typename ScalarType, typename ElementType>
+STATIC_FUNCTION(pg_bool_t)
+PG_SCALAR_ARRAY_HASH_OP(kern_context *kcxt,
+						pg_bool_t (*compare_fn)(kern_context *kcxt,
+												ScalarType scalar,
+												ElementType element),
+						cl_uint (*hash_fn)(const cl_uint *crc32_table,
+										   cl_uint hash,
+										   ScalarType scalar),
+						ScalarType scalar,
+						pg_array_t array,
+						pg_bytea_t hashset)
+{
+	kern_array_hashset *hset;
+	ElementType	element;
+	pg_bool_t	result;
+	pg_bool_t	rv;
+	char	   *base;
+	cl_uint		hash;
+	cl_uint		index;
+	cl_uint		mask;
+
+	/* NULL results towards NULL array */
+	if (array.isnull || hashset.isnull)
+	{
+		result.isnull = true;
+		result.value = false;
+		return result;
+	}
+	hset = (kern_array_hashset *) hashset.value;
+	result.isnull = false;
+	result.value = false;
+	/* empty array */
+	if (hset->nitems == 0 && !hset->has_null)
+		return result;
+	/* NULL scalar never matches */
+	if (scalar.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+
+	INIT_LEGACY_CRC32(hash);
+	hash = hash_fn(hset->crc32_table, hash, scalar);
+	FIN_LEGACY_CRC32(hash);
+
+	base = ARR_DATA_PTR(array.value);
+	mask = hset->nslots - 1;
+	for (index = (hash & mask);
+		 hset->slots[index].offset != 0;
+		 index = ((index + 1) & mask))
+	{
+		if (hset->slots[index].hash != hash)
+			continue;
+		pg_datum_ref(kcxt, element, base + hset->slots[index].offset - 1);
+		rv = compare_fn(kcxt, scalar, element);
+		if (!rv.isnull && rv.value)
+		{
+			result.value = true;
+			return result;
+		}
+	}
+	/* not found; NULL if array contains NULL elements */
+	result.isnull = hset->has_null;
+	return result;
+}
+
 /* ----------------------------------------------------------------
  *
  * MATRIX data type support
@@ -261,6 +360,9 @@ VALIDATE_ARRAY_MATRIX(MatrixType *matrix)
 		 matrix->elemtype == PG_INT2OID ||
 		 matrix->elemtype == PG_INT4OID ||
 		 matrix->elemtype == PG_INT8OID ||
+#ifdef PG_FLOAT2OID
+		 matrix->elemtype == PG_FLOAT2OID ||
+#endif
 		 matrix->elemtype == PG_FLOAT4OID ||
 		 matrix->elemtype == PG_FLOAT8OID)
 #else	/* __CUDACC__ */
@@ -269,7 +371,8 @@ VALIDATE_ARRAY_MATRIX(MatrixType *matrix)
 		 matrix->elemtype == INT4OID ||
 		 matrix->elemtype == INT8OID ||
 		 matrix->elemtype == FLOAT4OID ||
-		 matrix->elemtype == FLOAT8OID)
+		 matrix->elemtype == FLOAT8OID ||
+		 matrix->elemtype == FLOAT2OID)
 #endif	/* __CUDACC__ */
 		)
 	{
@@ -1046,6 +1149,123 @@ PGSTROM_MATRIX_GROUPBY_TEMPLATE(Add,FP32,cl_float,atomicAdd,0.0)
 //PGSTROM_MATRIX_GROUPBY_TEMPLATE(Max,FP32,cl_float,atomicMax,-FLT_MAX)
 //PGSTROM_MATRIX_GROUPBY_TEMPLATE(Min,FP32,cl_float,atomicMin, FLT_MAX)
 
+#ifdef MATRIX_GPU_OPERATORS
+/* ------------------------------------------------------------------
+ *
+ * GPU operators for array-matrix on behalf of the host side functions
+ * (transpose and matrix multiplication)
+ *
+ * All the matrices are plain column-major arrays of the elements, without
+ * array header; the host code copies the data portion only.
+ *
+ * ------------------------------------------------------------------ */
+
+/*
+ * matrixGpuTranspose - dst(width x height) = transpose(src(height x width))
+ *
+ * It runs with (MATRIX_GPU_TILE_SZ, MATRIX_GPU_TILE_ROWS) threads block,
+ * and uses a tile of the shared memory to make both of the load and store
+ * coalesced.
+ */
+#define PGSTROM_MATRIX_GPU_TRANSPOSE_TEMPLATE(SUFFIX,BASETYPE)			\
+	KERNEL_FUNCTION_NUMTHREADS(void, MATRIX_GPU_TILE_SZ *				\
+										MATRIX_GPU_TILE_ROWS)			\
+	matrixGpuTranspose##SUFFIX(BASETYPE *dst,							\
+							   const BASETYPE *src,						\
+							   cl_uint height,							\
+							   cl_uint width)							\
+	{																	\
+		__shared__ BASETYPE tile[MATRIX_GPU_TILE_SZ]					\
+								[MATRIX_GPU_TILE_SZ + 1];				\
+		cl_uint		ntiles = (width + MATRIX_GPU_TILE_SZ - 1)			\
+								/ MATRIX_GPU_TILE_SZ;					\
+		cl_uint		r0 = blockIdx.x * MATRIX_GPU_TILE_SZ;				\
+		cl_uint		c0;													\
+		cl_uint		r, c, j, index;										\
+																		\
+		for (index = blockIdx.y; index < ntiles; index += gridDim.y)	\
+		{																\
+			c0 = index * MATRIX_GPU_TILE_SZ;							\
+			/* load a tile; coalesced along the rows of src */			\
+			r = r0 + threadIdx.x;										\
+			for (j=0; j < MATRIX_GPU_TILE_SZ; j += MATRIX_GPU_TILE_ROWS)	\
+			{															\
+				c = c0 + threadIdx.y + j;								\
+				if (r < height && c < width)							\
+					tile[threadIdx.y + j][threadIdx.x]					\
+						= src[(size_t)c * (size_t)height + r];			\
+			}															\
+			__syncthreads();											\
+			/* store a tile; coalesced along the rows of dst */			\
+			c = c0 + threadIdx.x;										\
+			for (j=0; j < MATRIX_GPU_TILE_SZ; j += MATRIX_GPU_TILE_ROWS)	\
+			{															\
+				r = r0 + threadIdx.y + j;								\
+				if (r < height && c < width)							\
+					dst[(size_t)r * (size_t)width + c]					\
+						= tile[threadIdx.x][threadIdx.y + j];			\
+			}															\
+			__syncthreads();											\
+		}																\
+	}
+
+/*
+ * matrixGpuGemm - C(m x n) = A(m x k) * B(k x n)
+ *
+ * Naive tiled implementation with (MATRIX_GPU_GEMM_SZ, MATRIX_GPU_GEMM_SZ)
+ * threads block; each thread computes an element of C.
+ */
+#define PGSTROM_MATRIX_GPU_GEMM_TEMPLATE(SUFFIX,BASETYPE)				\
+	KERNEL_FUNCTION_NUMTHREADS(void, MATRIX_GPU_GEMM_SZ *				\
+										MATRIX_GPU_GEMM_SZ)				\
+	matrixGpuGemm##SUFFIX(BASETYPE *C,									\
+						  const BASETYPE *A,							\
+						  const BASETYPE *B,							\
+						  cl_uint m,									\
+						  cl_uint n,									\
+						  cl_uint k)									\
+	{																	\
+		__shared__ BASETYPE As[MATRIX_GPU_GEMM_SZ]						\
+							  [MATRIX_GPU_GEMM_SZ + 1];					\
+		__shared__ BASETYPE Bs[MATRIX_GPU_GEMM_SZ]						\
+							  [MATRIX_GPU_GEMM_SZ + 1];					\
+		cl_uint		r = blockIdx.x * MATRIX_GPU_GEMM_SZ + threadIdx.x;	\
+		cl_uint		c = blockIdx.y * MATRIX_GPU_GEMM_SZ + threadIdx.y;	\
+		cl_uint		t, j;												\
+		BASETYPE	sum = 0;											\
+																		\
+		for (t=0; t < k; t += MATRIX_GPU_GEMM_SZ)						\
+		{																\
+			/* As[kk][rr] = A(r, t + ty); coalesced along rows */		\
+			if (r < m && t + threadIdx.y < k)							\
+				As[threadIdx.y][threadIdx.x] =							\
+					A[(size_t)(t + threadIdx.y) * (size_t)m + r];		\
+			else														\
+				As[threadIdx.y][threadIdx.x] = 0;						\
+			/* Bs[cc][kk] = B(t + tx, c); coalesced along rows */		\
+			if (c < n && t + threadIdx.x < k)							\
+				Bs[threadIdx.y][threadIdx.x] =							\
+					B[(size_t)c * (size_t)k + (t + threadIdx.x)];		\
+			else														\
+				Bs[threadIdx.y][threadIdx.x] = 0;						\
+			__syncthreads();											\
+																		\
+			for (j=0; j < MATRIX_GPU_GEMM_SZ; j++)						\
+				sum += As[j][threadIdx.x] * Bs[threadIdx.y][j];			\
+			__syncthreads();											\
+		}																\
+		if (r < m && c < n)												\
+			C[(size_t)c * (size_t)m + r] = sum;							\
+	}
+
+PGSTROM_MATRIX_GPU_TRANSPOSE_TEMPLATE(1,cl_uchar)
+PGSTROM_MATRIX_GPU_TRANSPOSE_TEMPLATE(2,cl_ushort)
+PGSTROM_MATRIX_GPU_TRANSPOSE_TEMPLATE(4,cl_uint)
+PGSTROM_MATRIX_GPU_TRANSPOSE_TEMPLATE(8,cl_ulong)
+PGSTROM_MATRIX_GPU_GEMM_TEMPLATE(FP32,cl_float)
+PGSTROM_MATRIX_GPU_GEMM_TEMPLATE(FP64,cl_double)
+
+#endif	/* MATRIX_GPU_OPERATORS */
 
 #endif	/* __CUDACC__ */
 #endif	/* CUDA_MATRIX_H */
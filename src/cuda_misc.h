@@ -17,6 +17,53 @@
  */
 #ifndef CUDA_MISC_H
 #define CUDA_MISC_H
+
+/*
+ * HyperLogLog sketch for the approximate distinct count
+ *
+ * The value is hashed to 64bit; its upper HLL_REGISTER_BITS selects one of
+ * the registers, and the position of the first 1-bit in the rest is kept
+ * in the register by max(). GpuPreAgg reduces each register with PMAX(),
+ * so the host side partial function receives an array of the registers.
+ * The hash has to be identical on the host and device code.
+ */
+#define HLL_REGISTER_BITS		6
+#define HLL_NUM_REGISTERS		(1U << HLL_REGISTER_BITS)
+
+STATIC_INLINE(cl_ulong)
+hll_hash_int8(cl_long value)
+{
+	cl_ulong	x = (cl_ulong) value;
+
+	/* finalizer of splitmix64 */
+	x ^= (x >> 30);
+	x *= 0xbf58476d1ce4e5b9UL;
+	x ^= (x >> 27);
+	x *= 0x94d049bb133111ebUL;
+	x ^= (x >> 31);
+	return x;
+}
+
+STATIC_INLINE(cl_uint)
+hll_register_index(cl_ulong hash)
+{
+	return (cl_uint)(hash >> (64 - HLL_REGISTER_BITS));
+}
+
+STATIC_INLINE(cl_int)
+hll_register_rho(cl_ulong hash)
+{
+	cl_ulong	w = (hash << HLL_REGISTER_BITS);
+
+	if (w == 0)
+		return 64 - HLL_REGISTER_BITS + 1;
+#ifdef __CUDACC__
+	return __clzll(w) + 1;
+#else
+	return __builtin_clzll(w) + 1;
+#endif
+}
+
 #ifdef __CUDACC__
 
 /* pg_money_t */
@@ -1613,6 +1660,27 @@ pgfn_inet_same_family(kern_context *kcxt, pg_inet_t arg1, pg_inet_t arg2)
 	return result;
 }
 
+/*
+ * pgfn_hll_register - value of the regidx'th HLL register, if X is
+ * distributed to the register, or 0. NULL is not counted.
+ */
+STATIC_FUNCTION(pg_int2_t)
+pgfn_hll_register(kern_context *kcxt, pg_int8_t arg, pg_int4_t regidx)
+{
+	pg_int2_t	result;
+	cl_ulong	hash;
+
+	result.isnull = false;
+	result.value = 0;
+	if (!arg.isnull && !regidx.isnull)
+	{
+		hash = hll_hash_int8(arg.value);
+		if (hll_register_index(hash) == regidx.value)
+			result.value = hll_register_rho(hash);
+	}
+	return result;
+}
+
 #else	/* __CUDACC__ */
 #include "utils/pg_locale.h"
 
@@ -325,6 +325,14 @@ pg_numeric_from_varlena(kern_context *kcxt, struct varlena *vl_val)
 	return result;
 }
 
+/*
+ * Fixed-point representation of numeric(p,s) where p <= 18; the scaled
+ * integer is split into the upper bits and the lower NUMERIC_FIXED_SHIFT
+ * bits. It is shared by the device code and host-side fallback.
+ */
+#define NUMERIC_FIXED_SHIFT		30
+#define NUMERIC_FIXED_MASK		((1L << NUMERIC_FIXED_SHIFT) - 1)
+
 #ifdef __CUDACC__
 
 /*
@@ -703,6 +711,79 @@ pgfn_numeric_float8(kern_context *kcxt, pg_numeric_t arg)
 	return numeric_to_float(kcxt, arg);
 }
 
+/*
+ * numeric_to_fixed - scaled 64bit integer (X * 10^scale) for the fixed-
+ * point SUM/AVG of GpuPreAgg. Caller splits the result to upper/lower
+ * bits by NUMERIC_FIXED_SHIFT, so each partial sum has enough margin.
+ */
+STATIC_FUNCTION(pg_int8_t)
+numeric_to_fixed(kern_context *kcxt, pg_numeric_t arg, pg_int4_t scale)
+{
+	pg_int8_t	v;
+	int			expo, sign;
+	cl_ulong	mant;
+
+	if (arg.isnull || scale.isnull)
+	{
+		v.isnull = true;
+		v.value  = 0;
+		return v;
+	}
+	expo = PG_NUMERIC_EXPONENT(arg.value) + scale.value;
+	sign = PG_NUMERIC_SIGN(arg.value);
+	mant = PG_NUMERIC_MANTISSA(arg.value);
+
+	if (mant != 0)
+	{
+		/* trailing zeros below the scale are legal, others are not */
+		while (expo < 0)
+		{
+			if (mant % 10 != 0)
+				goto recheck;
+			mant /= 10;
+			expo++;
+		}
+		while (expo > 0)
+		{
+			if (mant > (cl_ulong)LONG_MAX / 10)
+				goto recheck;
+			mant *= 10;
+			expo--;
+		}
+		if (mant > (cl_ulong)LONG_MAX)
+			goto recheck;
+	}
+	v.isnull = false;
+	v.value  = (sign == 0 ? (cl_long)mant : -((cl_long)mant));
+	return v;
+
+recheck:
+	v.isnull = true;
+	v.value  = 0;
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	return v;
+}
+
+STATIC_FUNCTION(pg_int8_t)
+pgfn_numeric_fixed_hi(kern_context *kcxt, pg_numeric_t arg, pg_int4_t scale)
+{
+	pg_int8_t	v = numeric_to_fixed(kcxt, arg, scale);
+
+	if (!v.isnull)
+		v.value >>= NUMERIC_FIXED_SHIFT;	/* arithmetic shift */
+	return v;
+}
+
+STATIC_FUNCTION(pg_int8_t)
+pgfn_numeric_fixed_lo(kern_context *kcxt, pg_numeric_t arg, pg_int4_t scale)
+{
+	pg_int8_t	v = numeric_to_fixed(kcxt, arg, scale);
+
+	if (!v.isnull)
+		v.value &= NUMERIC_FIXED_MASK;
+	return v;
+}
+
 STATIC_FUNCTION(pg_numeric_t)
 integer_to_numeric(kern_context *kcxt, pg_int8_t arg, cl_int size)
 {
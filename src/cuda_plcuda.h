@@ -71,6 +71,11 @@ typedef struct
 	cl_ulong		working_usage;
 	cl_ulong		results_bufsz;
 	cl_ulong		results_usage;
+	cl_ulong		dma_args;	/* bitmap of arguments loaded by direct DMA */
+	/* properties for set-returning function */
+	cl_uint			retset_round;	/* number of the rounds completed */
+	cl_uint			retset_nitems;	/* number of rows in the results buffer */
+	cl_bool			retset_more;	/* kernel has more rows to return */
 	cl_int			nargs;
 	kern_colmeta	retmeta;	/* result data type */
 	kern_colmeta	argmeta[FLEXIBLE_ARRAY_MEMBER];	/* argument's data types */
@@ -95,6 +100,59 @@ typedef struct
 		return;									\
 	} while(0)
 
+/*
+ * set-returning function support
+ *
+ * PL/CUDA function declared with SETOF returns rows in the results buffer,
+ * then host side returns them one by one. If the results buffer has no room
+ * for the rows to be returned, kernel sets retset_more, then the kernels
+ * (except for the prep-kernel) are launched again once the rows are picked
+ * up, and retset_round tells the number of rounds already completed.
+ * Working buffer is kept across the rounds.
+ */
+typedef struct
+{
+	cl_uint			length;		/* length of the datum; 0 means NULL */
+	cl_uint			__padding__;
+	char			data[FLEXIBLE_ARRAY_MEMBER];
+} kern_plcuda_retrow;
+
+#ifdef __CUDACC__
+/*
+ * plcuda_retset_alloc
+ *
+ * It allocates a row on the results buffer, then returns the address to
+ * write out the datum of 'length' bytes. NULL is returned if no room.
+ * A NULL row can be returned with length = 0.
+ */
+STATIC_INLINE(void *)
+plcuda_retset_alloc(kern_plcuda *kplcuda, void *results, cl_uint length)
+{
+	kern_plcuda_retrow *row;
+	cl_ulong	required = MAXALIGN(offsetof(kern_plcuda_retrow,
+											 data[length]));
+	cl_ulong	oldval;
+	cl_ulong	curval;
+
+	if (!results)
+		return NULL;
+	curval = kplcuda->results_usage;
+	do {
+		oldval = curval;
+		if (oldval + required > kplcuda->results_bufsz)
+			return NULL;
+	} while ((curval = atomicCAS((unsigned long long *)&kplcuda->results_usage,
+								 oldval,
+								 oldval + required)) != oldval);
+	atomicAdd(&kplcuda->retset_nitems, 1);
+
+	row = (kern_plcuda_retrow *)((char *)results + oldval);
+	row->length = length;
+	row->__padding__ = 0;
+	return row->data;
+}
+#endif
+
 /*
  * composite data type support in kernel space
  */
@@ -158,7 +216,63 @@ pg_reggstore_param(kern_context *kcxt, cl_uint param_id)
 
 	return retval;
 }
+#endif
 
+/*
+ * largeobject argument declared by #plcuda_largeobject; its contents are
+ * loaded onto the device memory prior to the kernel launch.
+ */
+typedef struct {
+	devptr_t		ptr;		/* device memory of the contents */
+	cl_ulong		length;		/* length of the largeobject */
+} kern_largeobject_t;
+
+#ifdef __CUDACC__
+STATIC_INLINE(kern_largeobject_t)
+pg_largeobject_param(kern_context *kcxt, cl_uint param_id)
+{
+	kern_parambuf	   *kparams = kcxt->kparams;
+	kern_largeobject_t	retval;
+
+	if (param_id < kparams->nparams &&
+		kparams->poffset[param_id] > 0)
+	{
+		retval = *((kern_largeobject_t *)((char *)kparams +
+										  kparams->poffset[param_id]));
+	}
+	else
+	{
+		retval.ptr = 0L;
+		retval.length = 0;
+	}
+	return retval;
+}
+#endif
+
+#ifdef __CUDACC__
+/*
+ * plcuda_varlena_param
+ *
+ * It returns the address of varlena argument. Large argument is loaded onto
+ * the dedicated device memory by direct DMA, so parameter buffer keeps its
+ * device pointer instead of the datum itself.
+ */
+STATIC_INLINE(void *)
+plcuda_varlena_param(kern_plcuda *kplcuda, kern_context *kcxt,
+					 cl_uint param_id)
+{
+	kern_parambuf  *kparams = kcxt->kparams;
+	void		   *addr;
+
+	if (param_id >= kparams->nparams ||
+		kparams->poffset[param_id] == 0)
+		return NULL;
+	addr = (char *)kparams + kparams->poffset[param_id];
+	if (param_id < sizeof(cl_ulong) * BITS_PER_BYTE &&
+		(kplcuda->dma_args & (1UL << param_id)) != 0)
+		addr = (void *)(*((devptr_t *)addr));
+	return addr;
+}
 #endif
 
 #endif	/* CUDA_PLCUDA.H */
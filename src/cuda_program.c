@@ -20,6 +20,17 @@
 #include "cuda_timelib.h"
 #include "cuda_textlib.h"
 
+/*
+ * Kernel variants for the auto-tuning; each variant caps the number of
+ * registers per thread on JIT compile of the PTX image. It allows higher
+ * SM occupancy (and larger block size by gpuOptimalBlockSize) at the cost
+ * of register spills, so the best one is chosen by the elapsed time of
+ * the live chunks. Zero means no limitation, that is the default build.
+ */
+static const int pgcache_variant_maxrregcount[] = { 0, 64, 40, 32 };
+#define PGCACHE_NUM_VARIANTS		lengthof(pgcache_variant_maxrregcount)
+#define PGCACHE_TUNING_NTRIALS		8
+
 typedef struct
 {
 	cl_int			magic;
@@ -45,6 +56,12 @@ typedef struct
 	size_t			ptx_length;
 	char		   *error_msg;
 	int				error_code;
+	/* fields below are for the auto-tuning of kernel variants */
+	int				num_variants;	/* 1, if no auto-tuning */
+	int				best_variant;	/* -1, if auto-tuning is in-progress */
+	cl_uint			num_launched;
+	cl_uint			num_trials[PGCACHE_NUM_VARIANTS];
+	cl_ulong		total_usec[PGCACHE_NUM_VARIANTS];
 	char			data[FLEXIBLE_ARRAY_MEMBER];
 } program_cache_entry;
 
@@ -87,6 +104,9 @@ typedef struct
 static int		program_cache_size_kb;
 static int		num_program_builders;
 static bool		pgstrom_debug_jit_compile_options;
+static bool		pgstrom_kernel_auto_tuning;
+static char	   *program_cache_dir;
+static char	   *program_library_dir;
 
 /* ---- static variables ---- */
 static shmem_startup_hook_type shmem_startup_next;
@@ -98,6 +118,7 @@ static program_builder_state *pgbuilder_state = NULL;
 #undef PGSTROM_CUDA
 static void	   *curand_wrapper_lib = NULL;
 static size_t	curand_wrapper_libsz;
+static cl_long	program_cache_lib_stamp = 0;
 
 static bool		cuda_program_builder_got_signal = false;
 
@@ -364,6 +385,14 @@ construct_flat_cuda_source(uint32 extra_flags,
 	if ((extra_flags & DEVKERNEL_BUILD_DEBUG_INFO) != 0)
 		ofs += snprintf(source + ofs, len - ofs,
 						"#define PGSTROM_KERNEL_DEBUG 1\n");
+	/*
+	 * Per-thread varlena buffer, if functions construct varlena datum or
+	 * reference (potentially compressed) variable length text
+	 */
+	if ((extra_flags & DEVKERNEL_NEEDS_TEXTLIB) != 0)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#define KERN_CONTEXT_VARLENA_BUFSZ %u\n",
+						KERN_CONTEXT_VARLENA_BUFSZ_DEFAULT);
 	/* Common PG-Strom device routine */
 	ofs += snprintf(source + ofs, len - ofs,
 					"#include \"cuda_common.h\"\n");
@@ -390,6 +419,10 @@ construct_flat_cuda_source(uint32 extra_flags,
 	if ((extra_flags & DEVKERNEL_NEEDS_TEXTLIB) == DEVKERNEL_NEEDS_TEXTLIB)
 		ofs += snprintf(source + ofs, len - ofs,
 						"#include \"cuda_textlib.h\"\n");
+	/* cuda jsonlib.h */
+	if ((extra_flags & DEVKERNEL_NEEDS_JSONLIB) == DEVKERNEL_NEEDS_JSONLIB)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_jsonlib.h\"\n");
 	/* cuda timelib.h */
 	if ((extra_flags & DEVKERNEL_NEEDS_TIMELIB) == DEVKERNEL_NEEDS_TIMELIB)
 		ofs += snprintf(source + ofs, len - ofs,
@@ -451,6 +484,9 @@ construct_flat_cuda_source(uint32 extra_flags,
 		"    pg_text_t        text_v;\n"
 		"    pg_varchar_t     varchar_v;\n"
 		"#endif\n"
+		"#ifdef CUDA_JSONLIB_H\n"
+		"    pg_jsonb_t       jsonb_v;\n"
+		"#endif\n"
 		"#ifdef CUDA_RANGETYPE_H\n"
 		"    pg_int4range_t   int4range_v;\n"
 		"    pg_int8range_t   int8range_v;\n"
@@ -481,6 +517,14 @@ construct_flat_cuda_source(uint32 extra_flags,
 	if (extra_flags & DEVKERNEL_NEEDS_GPUPREAGG)
 		ofs += snprintf(source + ofs, len - ofs,
 						"#include \"cuda_gpupreagg.h\"\n");
+	/* GpuSort */
+	if (extra_flags & DEVKERNEL_NEEDS_GPUSORT)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_gpusort.h\"\n");
+	/* GpuWindowAgg */
+	if (extra_flags & DEVKERNEL_NEEDS_GPUWINAGG)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_gpuwinagg.h\"\n");
 	/* PL/CUDA functions */
 	if (extra_flags & DEVKERNEL_NEEDS_PLCUDA)
 		ofs += snprintf(source + ofs, len - ofs,
@@ -498,7 +542,7 @@ construct_flat_cuda_source(uint32 extra_flags,
  */
 static void
 link_cuda_libraries(char *ptx_image, size_t ptx_length,
-					cl_uint extra_flags,
+					cl_uint extra_flags, int maxrregcount,
 					void **p_bin_image, size_t *p_bin_length)
 {
 	CUlinkState		lstate;
@@ -545,6 +589,14 @@ link_cuda_libraries(char *ptx_image, size_t ptx_length,
 		jit_option_values[jit_index] = (void *)1UL;
 		jit_index++;
 	}
+
+	/* Register limitation of the kernel variant, if any */
+	if (maxrregcount > 0)
+	{
+		jit_options[jit_index] = CU_JIT_MAX_REGISTERS;
+		jit_option_values[jit_index] = (void *)((uintptr_t)maxrregcount);
+		jit_index++;
+	}
 	/* makes a linkage object */
 	rc = cuLinkCreate(jit_index, jit_options, jit_option_values, &lstate);
 	if (rc != CUDA_SUCCESS)
@@ -739,6 +791,224 @@ pgstrom_cuda_binary_file(ProgramId program_id)
 	return pstrdup(tempfilepath);
 }
 
+/*
+ * On-disk program cache
+ *
+ * PTX images built by NVRTC are also written out to the program cache
+ * directory, keyed by the source hash, target device capability and the
+ * toolchain version, then reused on the next build of the equivalent
+ * program even after restart of the database server.
+ *
+ * In addition, a read-only kernel library directory may be installed with
+ * the extension; it contains pre-built PTX images in the same file format,
+ * for the common kernel shapes. Because constant values are delivered via
+ * the kern_parambuf, the same kernel source shall be generated regardless
+ * of the literals, so pre-built images are picked up by the exact matching
+ * of the kernel source, without any JIT compilation.
+ */
+#define PGCACHE_FILE_MAGIC			0x50545843	/* 'PTXC' */
+
+typedef struct
+{
+	cl_uint		magic;
+	cl_int		cuda_version;
+	cl_int		nvrtc_version;
+	pg_crc32	crc;
+	cl_int		target_cc;
+	cl_int		extra_flags;
+	cl_long		lib_stamp;		/* mtime of the cuda_xxx.h files */
+	size_t		kern_deflen;
+	size_t		kern_srclen;
+	size_t		ptx_length;
+} program_cache_file_header;
+
+/*
+ * program_cache_file_name - build pathname of the on-disk cache file
+ */
+static bool
+program_cache_file_name(char *fname, const char *dirname,
+						program_cache_entry *entry)
+{
+	if (!dirname || dirname[0] == '\0')
+		return false;
+	snprintf(fname, MAXPGPATH, "%s/%08x.cc%d.%08x.cu%d.ptx",
+			 dirname,
+			 (cl_uint)entry->crc,
+			 entry->target_cc,
+			 (cl_uint)(entry->extra_flags & ~DEVKERNEL_BUILD_AUTO_TUNE),
+			 CUDA_VERSION);
+	return true;
+}
+
+/*
+ * setup_program_cache_file_header
+ */
+static void
+setup_program_cache_file_header(program_cache_file_header *hdr,
+								program_cache_entry *entry,
+								size_t ptx_length)
+{
+	static int	nvrtc_version = -1;
+
+	if (nvrtc_version < 0)
+	{
+		int		major;
+		int		minor;
+
+		if (nvrtcVersion(&major, &minor) == NVRTC_SUCCESS)
+			nvrtc_version = 1000 * major + 10 * minor;
+		else
+			nvrtc_version = 0;
+	}
+	memset(hdr, 0, sizeof(program_cache_file_header));
+	hdr->magic			= PGCACHE_FILE_MAGIC;
+	hdr->cuda_version	= CUDA_VERSION;
+	hdr->nvrtc_version	= nvrtc_version;
+	hdr->crc			= entry->crc;
+	hdr->target_cc		= entry->target_cc;
+	/* kernel variants are made on module loading, not in the PTX image */
+	hdr->extra_flags	= entry->extra_flags & ~DEVKERNEL_BUILD_AUTO_TUNE;
+	hdr->lib_stamp		= program_cache_lib_stamp;
+	hdr->kern_deflen	= entry->kern_deflen;
+	hdr->kern_srclen	= entry->kern_srclen;
+	hdr->ptx_length		= ptx_length;
+}
+
+/*
+ * __lookup_program_cache_file
+ *
+ * It tries to read a PTX image which is equivalent to the supplied entry
+ * from the directory. NULL is returned if not found. Elsewhere, it returns
+ * PTX image allocated by malloc(3), so caller must release it.
+ */
+static char *
+__lookup_program_cache_file(const char *dirname, bool is_library,
+							program_cache_entry *entry, size_t *p_ptx_length)
+{
+	program_cache_file_header hdr;
+	program_cache_file_header ref;
+	char		fname[MAXPGPATH];
+	char	   *buffer = NULL;
+	char	   *ptx_image = NULL;
+	size_t		length;
+	int			fdesc;
+
+	if (!program_cache_file_name(fname, dirname, entry))
+		return NULL;
+	fdesc = open(fname, O_RDONLY);
+	if (fdesc < 0)
+		return NULL;
+	if (read(fdesc, &hdr, sizeof(hdr)) != sizeof(hdr))
+		goto out;
+	setup_program_cache_file_header(&ref, entry, hdr.ptx_length);
+	/* kernel library is shipped with the cuda_xxx.h files of its own */
+	if (is_library)
+		ref.lib_stamp = hdr.lib_stamp;
+	if (memcmp(&hdr, &ref, sizeof(program_cache_file_header)) != 0 ||
+		hdr.ptx_length == 0)
+		goto out;
+	/* check kern_define and kern_source to avoid hash collision */
+	length = hdr.kern_deflen + hdr.kern_srclen + hdr.ptx_length;
+	buffer = malloc(length);
+	if (!buffer)
+		goto out;
+	if (read(fdesc, buffer, length) != length)
+		goto out;
+	if (memcmp(buffer, entry->kern_define, hdr.kern_deflen) != 0 ||
+		memcmp(buffer + hdr.kern_deflen,
+			   entry->kern_source, hdr.kern_srclen) != 0)
+		goto out;
+	ptx_image = malloc(hdr.ptx_length + 1);
+	if (!ptx_image)
+		goto out;
+	memcpy(ptx_image, buffer + hdr.kern_deflen + hdr.kern_srclen,
+		   hdr.ptx_length);
+	ptx_image[hdr.ptx_length] = '\0';
+	*p_ptx_length = hdr.ptx_length;
+out:
+	if (buffer)
+		free(buffer);
+	close(fdesc);
+	return ptx_image;
+}
+
+/*
+ * lookup_program_cache_file
+ *
+ * It looks up the pre-built kernel library first, then the on-disk program
+ * cache next.
+ */
+static char *
+lookup_program_cache_file(program_cache_entry *entry, size_t *p_ptx_length)
+{
+	char	   *ptx_image;
+
+	ptx_image = __lookup_program_cache_file(program_library_dir, true,
+											entry, p_ptx_length);
+	if (!ptx_image)
+		ptx_image = __lookup_program_cache_file(program_cache_dir, false,
+												entry, p_ptx_length);
+	return ptx_image;
+}
+
+/*
+ * writeout_program_cache_file
+ *
+ * It writes out the PTX image to the on-disk program cache. Any errors are
+ * not critical, because it is just a cache.
+ */
+static void
+writeout_program_cache_file(program_cache_entry *entry,
+							const char *ptx_image, size_t ptx_length)
+{
+	static pg_atomic_uint64 cacheFileCounter = {0};
+	program_cache_file_header hdr;
+	char		fname[MAXPGPATH];
+	char		tname[MAXPGPATH];
+	int			fdesc;
+
+	if (!program_cache_file_name(fname, program_cache_dir, entry))
+		return;
+	snprintf(tname, MAXPGPATH, "%s.%d.%lu.tmp",
+			 fname, MyProcPid,
+			 pg_atomic_fetch_add_u64(&cacheFileCounter, 1));
+	fdesc = open(tname, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	if (fdesc < 0 && errno == ENOENT)
+	{
+		if (mkdir(program_cache_dir, S_IRWXU) != 0 && errno != EEXIST)
+		{
+			wlog("failed on mkdir('%s'): %m", program_cache_dir);
+			return;
+		}
+		fdesc = open(tname, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	}
+	if (fdesc < 0)
+	{
+		wlog("failed on open('%s'): %m", tname);
+		return;
+	}
+	setup_program_cache_file_header(&hdr, entry, ptx_length);
+	if (write(fdesc, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+		write(fdesc, entry->kern_define,
+			  entry->kern_deflen) != entry->kern_deflen ||
+		write(fdesc, entry->kern_source,
+			  entry->kern_srclen) != entry->kern_srclen ||
+		write(fdesc, ptx_image, ptx_length) != ptx_length)
+	{
+		wlog("failed on write('%s'): %m", tname);
+		close(fdesc);
+		unlink(tname);
+		return;
+	}
+	close(fdesc);
+	/* atomic replacement, concurrent writer may exist */
+	if (rename(tname, fname) != 0)
+	{
+		wlog("failed on rename('%s' -> '%s'): %m", tname, fname);
+		unlink(tname);
+	}
+}
+
 /*
  * build_cuda_program - an interface to run synchronous build process
  */
@@ -774,95 +1044,114 @@ build_cuda_program(program_cache_entry *src_entry)
 	{
 		char	gpu_arch_option[256];
 
-		rc = nvrtcCreateProgram(&program,
-								source,
-								"pg-strom",
-								0,
-								NULL,
-								NULL);
-		if (rc != NVRTC_SUCCESS)
-			werror("failed on nvrtcCreateProgram: %s",
-				   nvrtcGetErrorString(rc));
 		/*
-		 * Put command line options
-		 *
-		 * MEMO: (23-Oct-2017) It looks to me "--device-debug" leads
-		 * CUDA_ERROR_ILLEGAL_INSTRUCTION error on execution.
-		 * So, as a workaround, we removed this option here.
+		 * Try to load the PTX image from the on-disk program cache, prior
+		 * to kick the runtime compiler.
 		 */
-		options[opt_index++] = "-I " CUDA_INCLUDE_PATH;
-		options[opt_index++] = "-I " PGSHAREDIR "/extension";
-		snprintf(gpu_arch_option, sizeof(gpu_arch_option),
-				 "--gpu-architecture=compute_%u", src_entry->target_cc);
-		options[opt_index++] = gpu_arch_option;
-		if ((src_entry->extra_flags & DEVKERNEL_BUILD_DEBUG_INFO) != 0)
-		{
-			options[opt_index++] = "--device-debug";
-			options[opt_index++] = "--generate-line-info";
-		}
-		options[opt_index++] = "--use_fast_math";
-		/* library linkage needs relocatable PTX */
-		if (src_entry->extra_flags & DEVKERNEL_NEEDS_LINKAGE)
-			options[opt_index++] = "--relocatable-device-code=true";
-		/* enables c++11 template features */
-		options[opt_index++] = "--std=c++11";
-
-		/*
-		 * Kick runtime compiler
-		 */
-		rc = nvrtcCompileProgram(program, opt_index, options);
-		if (rc == NVRTC_ERROR_COMPILATION)
-		{
-			writeout_temporary_file(tempfile, "gpu",
-									source, strlen(source));
-		}
-		else if (rc != NVRTC_SUCCESS)
+		ptx_image = lookup_program_cache_file(src_entry, &ptx_length);
+		if (ptx_image)
 		{
-			werror("failed on nvrtcCompileProgram: %s",
-				   nvrtcGetErrorString(rc));
+			build_log = strdup("loaded from the pre-built program cache");
+			if (!build_log)
+				werror("out of memory");
+			log_length = strlen(build_log);
 		}
 		else
 		{
+			rc = nvrtcCreateProgram(&program,
+									source,
+									"pg-strom",
+									0,
+									NULL,
+									NULL);
+			if (rc != NVRTC_SUCCESS)
+				werror("failed on nvrtcCreateProgram: %s",
+					   nvrtcGetErrorString(rc));
 			/*
-			 * Read PTX Binary
+			 * Put command line options
+			 *
+			 * MEMO: (23-Oct-2017) It looks to me "--device-debug" leads
+			 * CUDA_ERROR_ILLEGAL_INSTRUCTION error on execution.
+			 * So, as a workaround, we removed this option here.
 			 */
-			rc = nvrtcGetPTXSize(program, &ptx_length);
+			options[opt_index++] = "-I " CUDA_INCLUDE_PATH;
+			options[opt_index++] = "-I " PGSHAREDIR "/extension";
+			snprintf(gpu_arch_option, sizeof(gpu_arch_option),
+					 "--gpu-architecture=compute_%u", src_entry->target_cc);
+			options[opt_index++] = gpu_arch_option;
+			if ((src_entry->extra_flags & DEVKERNEL_BUILD_DEBUG_INFO) != 0)
+			{
+				options[opt_index++] = "--device-debug";
+				options[opt_index++] = "--generate-line-info";
+			}
+			options[opt_index++] = "--use_fast_math";
+			/* library linkage needs relocatable PTX */
+			if (src_entry->extra_flags & DEVKERNEL_NEEDS_LINKAGE)
+				options[opt_index++] = "--relocatable-device-code=true";
+			/* enables c++11 template features */
+			options[opt_index++] = "--std=c++11";
+
+			/*
+			 * Kick runtime compiler
+			 */
+			rc = nvrtcCompileProgram(program, opt_index, options);
+			if (rc == NVRTC_ERROR_COMPILATION)
+			{
+				writeout_temporary_file(tempfile, "gpu",
+										source, strlen(source));
+			}
+			else if (rc != NVRTC_SUCCESS)
+			{
+				werror("failed on nvrtcCompileProgram: %s",
+					   nvrtcGetErrorString(rc));
+			}
+			else
+			{
+				/*
+				 * Read PTX Binary
+				 */
+				rc = nvrtcGetPTXSize(program, &ptx_length);
+				if (rc != NVRTC_SUCCESS)
+					werror("failed on nvrtcGetPTXSize: %s",
+						   nvrtcGetErrorString(rc));
+				ptx_image = malloc(ptx_length + 1);
+				if (!ptx_image)
+					werror("out of memory");
+
+				rc = nvrtcGetPTX(program, ptx_image);
+				if (rc != NVRTC_SUCCESS)
+					werror("failed on nvrtcGetPTX: %s",
+						   nvrtcGetErrorString(rc));
+				ptx_image[ptx_length++] = '\0';
+			}
+
+			/*
+			 * Read Log Output
+			 */
+			rc = nvrtcGetProgramLogSize(program, &log_length);
 			if (rc != NVRTC_SUCCESS)
-				werror("failed on nvrtcGetPTXSize: %s",
+				werror("failed on nvrtcGetProgramLogSize: %s",
 					   nvrtcGetErrorString(rc));
-			ptx_image = malloc(ptx_length + 1);
-			if (!ptx_image)
+			build_log = malloc(log_length + 1);
+			if (!build_log)
 				werror("out of memory");
 
-			rc = nvrtcGetPTX(program, ptx_image);
+			rc = nvrtcGetProgramLog(program, build_log);
 			if (rc != NVRTC_SUCCESS)
-				werror("failed on nvrtcGetPTX: %s",
+				werror("failed on nvrtcGetProgramLog: %s",
 					   nvrtcGetErrorString(rc));
-			ptx_image[ptx_length++] = '\0';
-		}
+			build_log[log_length] = '\0';	/* may not be necessary? */
 
-		/*
-		 * Read Log Output
-		 */
-		rc = nvrtcGetProgramLogSize(program, &log_length);
-		if (rc != NVRTC_SUCCESS)
-			werror("failed on nvrtcGetProgramLogSize: %s",
-				   nvrtcGetErrorString(rc));
-		build_log = malloc(log_length + 1);
-		if (!build_log)
-			werror("out of memory");
-
-		rc = nvrtcGetProgramLog(program, build_log);
-		if (rc != NVRTC_SUCCESS)
-			werror("failed on nvrtcGetProgramLog: %s",
-				   nvrtcGetErrorString(rc));
-		build_log[log_length] = '\0';	/* may not be necessary? */
+			/* release nvrtcProgram object */
+			rc = nvrtcDestroyProgram(&program);
+			if (rc != NVRTC_SUCCESS)
+				werror("failed on nvrtcDestroyProgram: %s",
+					   nvrtcGetErrorString(rc));
 
-		/* release nvrtcProgram object */
-		rc = nvrtcDestroyProgram(&program);
-		if (rc != NVRTC_SUCCESS)
-			werror("failed on nvrtcDestroyProgram: %s",
-				   nvrtcGetErrorString(rc));
+			/* save the PTX image for the next time */
+			if (ptx_image)
+				writeout_program_cache_file(src_entry, ptx_image, ptx_length);
+		}
 
 		/*
 		 * Allocation of a new entry, to keep ptx_image/build_log
@@ -923,6 +1212,21 @@ build_cuda_program(program_cache_entry *src_entry)
 			snprintf(bin_entry->error_msg, length - offset,
 					 "build success:\n%s\n",
 					 build_log);
+		/* state of the auto-tuning, if any */
+		if (ptx_image &&
+			(bin_entry->extra_flags & DEVKERNEL_BUILD_AUTO_TUNE) != 0)
+		{
+			bin_entry->num_variants	= PGCACHE_NUM_VARIANTS;
+			bin_entry->best_variant	= -1;
+		}
+		else
+		{
+			bin_entry->num_variants	= 1;
+			bin_entry->best_variant	= 0;
+		}
+		bin_entry->num_launched		= 0;
+		memset(bin_entry->num_trials, 0, sizeof(bin_entry->num_trials));
+		memset(bin_entry->total_usec, 0, sizeof(bin_entry->total_usec));
 		/* OK, bin_entry was built */
 		pindex = bin_entry->program_id % PGCACHE_HASH_SIZE;
 		hindex = bin_entry->crc % PGCACHE_HASH_SIZE;
@@ -1002,6 +1306,10 @@ __pgstrom_create_cuda_program(GpuContext *gcontext,
 	/* build with debug option? */
 	if (pgstrom_debug_jit_compile_options)
 		extra_flags |= DEVKERNEL_BUILD_DEBUG_INFO;
+	/* auto-tuning of kernel variants? (PL/CUDA uses the default only) */
+	if (pgstrom_kernel_auto_tuning &&
+		(extra_flags & DEVKERNEL_NEEDS_PLCUDA) == 0)
+		extra_flags |= DEVKERNEL_BUILD_AUTO_TUNE;
 	/* target binary to build */
 	Assert(dindex >= 0 && dindex < numDevAttrs);
 	target_cc = (devAttrs[dindex].COMPUTE_CAPABILITY_MAJOR * 10 +
@@ -1127,6 +1435,8 @@ __pgstrom_create_cuda_program(GpuContext *gcontext,
 	/* no cuda binary at this moment */
 	entry->ptx_image = NULL;
 	entry->ptx_length = 0;
+	entry->num_variants = 1;
+	entry->best_variant = 0;
 	/* remaining are for error message */
 	entry->error_msg = (char *)(entry->data + usage);
 
@@ -1264,16 +1574,45 @@ pgstrom_build_session_info(StringInfo buf,
 		assign_gpupreagg_session_info(buf, gts);
 }
 
+/*
+ * pgstrom_cuda_program_is_ready
+ *
+ * It checks whether the CUDA program is already built, without waiting for
+ * the build. Build failure is also 'ready'; the error shall be raised on
+ * pgstrom_load_cuda_program().
+ */
+bool
+pgstrom_cuda_program_is_ready(ProgramId program_id)
+{
+	program_cache_entry *entry;
+	bool		retval;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	entry = lookup_cuda_program_entry_nolock(program_id);
+	retval = (!entry || entry->ptx_image != NULL);
+	SpinLockRelease(&pgcache_head->lock);
+
+	return retval;
+}
+
 /*
  * pgstrom_load_cuda_program
+ *
+ * It loads the CUDA program as a module; 'variant' is an index of the kernel
+ * variant chosen by pgstrom_select_cuda_program_variant, or 0 for the
+ * default build.
  */
 CUmodule
-pgstrom_load_cuda_program(ProgramId program_id)
+pgstrom_load_cuda_program(ProgramId program_id, int variant)
 {
 	program_cache_entry *entry = NULL;
 	CUmodule	cuda_module;
 	CUresult	rc;
 	int			extra_flags;
+	int			maxrregcount = 0;
+	CUjit_option jit_options[1];
+	void	   *jit_option_values[1];
+	int			jit_index = 0;
 	char	   *ptx_image;
 	size_t		ptx_length;
 	pg_crc32	ptx_crc		__attribute__((unused));
@@ -1301,6 +1640,8 @@ retry_checks:
 		ptx_image = entry->ptx_image;
 		ptx_length = entry->ptx_length;
 		ptx_crc = entry->ptx_crc;
+		if (variant > 0 && variant < entry->num_variants)
+			maxrregcount = pgcache_variant_maxrregcount[variant];
 		SpinLockRelease(&pgcache_head->lock);
 	}
 	else if (entry->build_chain.prev || entry->build_chain.next)
@@ -1351,14 +1692,22 @@ retry_checks:
 	{
 		bin_image = ptx_image;
 		bin_length = ptx_length;
+		/* register limitation of the kernel variant, if any */
+		if (maxrregcount > 0)
+		{
+			jit_options[jit_index] = CU_JIT_MAX_REGISTERS;
+			jit_option_values[jit_index] = (void *)((uintptr_t)maxrregcount);
+			jit_index++;
+		}
 	}
 	else
 	{
 		link_cuda_libraries(ptx_image, ptx_length,
-							extra_flags,
+							extra_flags, maxrregcount,
 							&bin_image, &bin_length);
 	}
-	rc = cuModuleLoadData(&cuda_module, bin_image);
+	rc = cuModuleLoadDataEx(&cuda_module, bin_image,
+							jit_index, jit_options, jit_option_values);
 	if (ptx_image != bin_image)
 		free(bin_image);
 #ifdef USE_ASSERT_CHECKING
@@ -1373,10 +1722,99 @@ retry_checks:
 #endif /* USE_ASSERT_CHECKING */
 	put_cuda_program_entry(entry);
 	if (rc != CUDA_SUCCESS)
-		werror("failed on cuModuleLoadData: %s", errorText(rc));
+		werror("failed on cuModuleLoadDataEx: %s", errorText(rc));
 	return cuda_module;
 }
 
+/*
+ * pgstrom_select_cuda_program_variant
+ *
+ * It returns an index of the kernel variant to run the next GpuTask.
+ * Until the auto-tuning gets completed, variants are picked up by round-
+ * robin, and *p_tuning requires the caller to report the elapsed time
+ * using pgstrom_tune_cuda_program_variant().
+ */
+int
+pgstrom_select_cuda_program_variant(ProgramId program_id, bool *p_tuning)
+{
+	program_cache_entry *entry;
+	int			variant = 0;
+
+	*p_tuning = false;
+	SpinLockAcquire(&pgcache_head->lock);
+	entry = lookup_cuda_program_entry_nolock(program_id);
+	if (entry &&
+		entry->ptx_image != NULL &&
+		entry->ptx_image != CUDA_PROGRAM_BUILD_FAILURE)
+	{
+		if (entry->best_variant >= 0)
+			variant = entry->best_variant;
+		else
+		{
+			variant = entry->num_launched++ % entry->num_variants;
+			*p_tuning = true;
+		}
+	}
+	SpinLockRelease(&pgcache_head->lock);
+
+	return variant;
+}
+
+/*
+ * pgstrom_tune_cuda_program_variant
+ *
+ * It accumulates the elapsed time of a GpuTask processed by the variant.
+ * Once every variant is measured PGCACHE_TUNING_NTRIALS times, the one with
+ * the least average time is kept as the best variant of the program.
+ */
+void
+pgstrom_tune_cuda_program_variant(ProgramId program_id,
+								  int variant,
+								  cl_ulong elapsed_usec)
+{
+	program_cache_entry *entry;
+	int			best_variant = -1;
+	double		best_usec = 0.0;
+	int			i;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	entry = lookup_cuda_program_entry_nolock(program_id);
+	if (entry &&
+		entry->best_variant < 0 &&
+		variant >= 0 && variant < entry->num_variants)
+	{
+		entry->num_trials[variant]++;
+		entry->total_usec[variant] += elapsed_usec;
+
+		for (i=0; i < entry->num_variants; i++)
+		{
+			double	avg_usec;
+
+			if (entry->num_trials[i] < PGCACHE_TUNING_NTRIALS)
+			{
+				best_variant = -1;
+				break;
+			}
+			avg_usec = ((double)entry->total_usec[i] /
+						(double)entry->num_trials[i]);
+			if (best_variant < 0 || avg_usec < best_usec)
+			{
+				best_variant = i;
+				best_usec = avg_usec;
+			}
+		}
+		if (best_variant >= 0)
+			entry->best_variant = best_variant;
+	}
+	SpinLockRelease(&pgcache_head->lock);
+
+	if (best_variant >= 0)
+		wdebug("CUDA Program ID=%lu tuned: variant=%d maxrregcount=%d (%.2fms)",
+			   (long)program_id, best_variant,
+			   pgcache_variant_maxrregcount[best_variant],
+			   best_usec / 1000.0);
+}
+
 /*
  * cudaProgramBuilderSigTerm
  */
@@ -1672,6 +2110,7 @@ void
 pgstrom_init_cuda_program(void)
 {
 	int			i;
+	struct stat	stbuf;
 
 	/*
 	 * allocation of shared memory segment size
@@ -1713,10 +2152,57 @@ pgstrom_init_cuda_program(void)
 							 GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
 							 NULL, NULL, NULL);
 
+	/*
+	 * Enables auto-tuning of the kernel variants
+	 */
+	DefineCustomBoolVariable("pg_strom.kernel_auto_tuning",
+							 "Enables auto-tuning of register usage of GPU kernels",
+							 NULL,
+							 &pgstrom_kernel_auto_tuning,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/*
+	 * Directory of the on-disk program cache
+	 */
+	DefineCustomStringVariable("pg_strom.program_cache_dir",
+							   "directory of on-disk CUDA program cache",
+							   "Empty string disables on-disk program cache",
+							   &program_cache_dir,
+							   "pg_strom_cache",
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+							   NULL, NULL, NULL);
+
+	/*
+	 * Directory of the pre-built kernel library
+	 */
+	DefineCustomStringVariable("pg_strom.program_library_dir",
+							   "directory of pre-built CUDA kernel library",
+							   "Empty string disables pre-built kernel library",
+							   &program_library_dir,
+							   PGSHAREDIR "/extension/pg_strom_kernels",
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+							   NULL, NULL, NULL);
+
 	/* setup cuda_xxxx.h file pathname */
 #define PGSTROM_CUDA(x) \
 	pgstrom_cuda_##x##_pathname = PGSHAREDIR "/extension/cuda_" #x ".h";
 #include "cuda_filelist"
+#undef PGSTROM_CUDA
+
+	/*
+	 * Timestamp of the cuda_xxxx.h files; on-disk program cache is
+	 * invalidated once PG-Strom device code libraries are updated.
+	 */
+#define PGSTROM_CUDA(x)											\
+	if (stat(pgstrom_cuda_##x##_pathname, &stbuf) == 0 &&		\
+		program_cache_lib_stamp < (cl_long)stbuf.st_mtime)		\
+		program_cache_lib_stamp = (cl_long)stbuf.st_mtime;
+#include "cuda_filelist"
 #undef PGSTROM_CUDA
 
 	/* allocation of static shared memory */
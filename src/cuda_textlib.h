@@ -17,6 +17,35 @@
  */
 #ifndef CUDA_TEXTLIB_H
 #define CUDA_TEXTLIB_H
+
+/*
+ * kern_text_dfa
+ *
+ * DFA (deterministic finite automaton) compiled from the constant pattern
+ * of LIKE, ILIKE or regular expression on the host side, and delivered as
+ * a bytea parameter. Input bytes are mapped to the equivalence classes
+ * first, then the transition table is indexed by (state, class).
+ * State 0 is the dead state; once DFA falls into, it never matches.
+ */
+typedef struct
+{
+	cl_uint		vl_len_;	/* varlena header (only 4B header) */
+	cl_ushort	nstates;	/* number of DFA states */
+	cl_ushort	nclasses;	/* number of equivalence classes of bytes */
+	cl_ushort	start;		/* initial state */
+	cl_ushort	__padding__;
+	cl_uchar	classes[256];	/* byte -> equivalence class */
+	cl_ushort	trans[FLEXIBLE_ARRAY_MEMBER];	/* nstates x nclasses */
+	/* cl_uchar	flags[nstates] follows the transition table */
+} kern_text_dfa;
+
+#define KERN_TEXT_DFA_STATE_ACCEPT		0x01	/* text matches, if end */
+#define KERN_TEXT_DFA_STATE_STICKY		0x02	/* text matches, any suffix */
+#define KERN_TEXT_DFA_FLAGS(dfa)									\
+	((cl_uchar *)((dfa)->trans + (cl_uint)(dfa)->nstates * (dfa)->nclasses))
+#define KERN_TEXT_DFA_LENGTH(nstates,nclasses)						\
+	(offsetof(kern_text_dfa, trans[(nstates) * (nclasses)]) + (nstates))
+
 #ifdef __CUDACC__
 
 /* ----------------------------------------------------------------
@@ -668,6 +697,59 @@ pgfn_texticnlike(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
 #undef LIKE_FALSE
 #undef LIKE_ABORT
 
+/*
+ * Pattern matching by the DFA pre-compiled on the host side
+ */
+STATIC_FUNCTION(cl_bool)
+text_dfa_exec(kern_text_dfa *dfa, const cl_uchar *s, cl_uint slen)
+{
+	const cl_ushort *trans = dfa->trans;
+	const cl_uchar *flags = KERN_TEXT_DFA_FLAGS(dfa);
+	cl_uint		nclasses = __ldg(&dfa->nclasses);
+	cl_uint		state = __ldg(&dfa->start);
+	cl_uint		i;
+
+	for (i=0; i < slen; i++)
+	{
+		if ((__ldg(&flags[state]) & KERN_TEXT_DFA_STATE_STICKY) != 0)
+			return true;
+		state = __ldg(&trans[state * nclasses +
+							 __ldg(&dfa->classes[s[i]])]);
+		if (state == 0)
+			return false;	/* dead state */
+	}
+	return (__ldg(&flags[state]) & KERN_TEXT_DFA_STATE_ACCEPT) != 0;
+}
+
+#define PG_TEXT_DFA_MATCH_TEMPLATE(NAME)								\
+	STATIC_FUNCTION(pg_bool_t)											\
+	pgfn_text_dfa_match(kern_context *kcxt,								\
+						pg_##NAME##_t arg1, pg_bytea_t arg2)			\
+	{																	\
+		pg_bool_t	result;												\
+																		\
+		result.isnull = arg1.isnull | arg2.isnull;						\
+		if (!result.isnull)												\
+			result.value = text_dfa_exec((kern_text_dfa *)arg2.value,	\
+										 (cl_uchar *)VARDATA_ANY(arg1.value), \
+										 VARSIZE_ANY_EXHDR(arg1.value)); \
+		return result;													\
+	}																	\
+																		\
+	STATIC_FUNCTION(pg_bool_t)											\
+	pgfn_text_dfa_nmatch(kern_context *kcxt,							\
+						 pg_##NAME##_t arg1, pg_bytea_t arg2)			\
+	{																	\
+		pg_bool_t	result = pgfn_text_dfa_match(kcxt, arg1, arg2);		\
+																		\
+		result.value = !result.value;									\
+		return result;													\
+	}
+
+PG_TEXT_DFA_MATCH_TEMPLATE(text)
+PG_TEXT_DFA_MATCH_TEMPLATE(bpchar)
+#undef PG_TEXT_DFA_MATCH_TEMPLATE
+
 
 
 #else	/* __CUDACC__ */
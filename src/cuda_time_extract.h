@@ -929,5 +929,236 @@ pgfn_extract_time(kern_context *kcxt, pg_text_t arg1, pg_time_t arg2)
 	return result;
 }
 
+/*
+ * date_trunc() SQL functions
+ *
+ * pgfn_timestamp_trunc_unit() and pgfn_timestamptz_trunc_unit() take the
+ * unit as DTK_* value; code generator folds a constant unit of date_trunc()
+ * to the invocation of them with the value given as a kernel parameter,
+ * so fixed-length units are computed by integer arithmetic only, without
+ * unit decoding and calendar logic per row.
+ */
+STATIC_INLINE(cl_bool)
+__timestamp_trunc_units_fixed(cl_int val, cl_long *p_step, cl_long *p_origin)
+{
+	switch (val)
+	{
+		case DTK_WEEK:
+			/* 2000-01-03 is Monday; start of ISO week */
+			*p_step = 7 * USECS_PER_DAY;
+			*p_origin = 2 * USECS_PER_DAY;
+			return true;
+		case DTK_DAY:
+			*p_step = USECS_PER_DAY;
+			break;
+		case DTK_HOUR:
+			*p_step = USECS_PER_HOUR;
+			break;
+		case DTK_MINUTE:
+			*p_step = USECS_PER_MINUTE;
+			break;
+		case DTK_SECOND:
+			*p_step = USECS_PER_SEC;
+			break;
+		case DTK_MILLISEC:
+			*p_step = 1000;
+			break;
+		case DTK_MICROSEC:
+			*p_step = 1;
+			break;
+		default:
+			return false;
+	}
+	*p_origin = 0;
+	return true;
+}
+
+/*
+ * __timestamp_trunc_tm - truncation on the broken-down time, as like
+ * timestamp_trunc() doing. It returns true if unit needs to redo timezone.
+ */
+STATIC_INLINE(cl_bool)
+__timestamp_trunc_tm(cl_int val, struct pg_tm *tm, fsec_t *fsec,
+					 cl_bool *p_redotz)
+{
+	cl_int		jd;
+
+	*p_redotz = false;
+	switch (val)
+	{
+		case DTK_WEEK:
+			jd = date2j(tm->tm_year, tm->tm_mon, tm->tm_mday);
+			jd -= (j2day(jd) + 6) % 7;
+			j2date(jd, &tm->tm_year, &tm->tm_mon, &tm->tm_mday);
+			tm->tm_hour = 0;
+			tm->tm_min = 0;
+			tm->tm_sec = 0;
+			*fsec = 0;
+			*p_redotz = true;
+			return true;
+		case DTK_MILLENNIUM:
+			/* see comments in timestamptz_trunc */
+			if (tm->tm_year > 0)
+				tm->tm_year = ((tm->tm_year + 999) / 1000) * 1000 - 999;
+			else
+				tm->tm_year = -((999 - (tm->tm_year - 1)) / 1000) * 1000 + 1;
+		case DTK_CENTURY:
+			/* see comments in timestamptz_trunc */
+			if (tm->tm_year > 0)
+				tm->tm_year = ((tm->tm_year + 99) / 100) * 100 - 99;
+			else
+				tm->tm_year = -((99 - (tm->tm_year - 1)) / 100) * 100 + 1;
+		case DTK_DECADE:
+			/* see comments in timestamptz_trunc */
+			if (val != DTK_MILLENNIUM && val != DTK_CENTURY)
+			{
+				if (tm->tm_year > 0)
+					tm->tm_year = (tm->tm_year / 10) * 10;
+				else
+					tm->tm_year = -((8 - (tm->tm_year - 1)) / 10) * 10;
+			}
+		case DTK_YEAR:
+			tm->tm_mon = 1;
+		case DTK_QUARTER:
+			tm->tm_mon = (3 * ((tm->tm_mon - 1) / 3)) + 1;
+		case DTK_MONTH:
+			tm->tm_mday = 1;
+		case DTK_DAY:
+			tm->tm_hour = 0;
+			*p_redotz = true;	/* for all cases >= DAY */
+		case DTK_HOUR:
+			tm->tm_min = 0;
+		case DTK_MINUTE:
+			tm->tm_sec = 0;
+		case DTK_SECOND:
+			*fsec = 0;
+			break;
+		case DTK_MILLISEC:
+			*fsec = (*fsec / 1000) * 1000;
+			break;
+		case DTK_MICROSEC:
+			break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+STATIC_INLINE(pg_timestamp_t)
+pgfn_timestamp_trunc_unit(kern_context *kcxt, pg_timestamp_t arg, cl_int val)
+{
+	pg_timestamp_t	result;
+	struct pg_tm	tm;
+	fsec_t			fsec;
+	cl_long			step;
+	cl_long			origin;
+	cl_bool			redotz;
+
+	if (arg.isnull || TIMESTAMP_NOT_FINITE(arg.value))
+		return arg;
+	/* timestamp has no timezone, so fixed-length units are simple */
+	if (__timestamp_trunc_units_fixed(val, &step, &origin))
+		return pgfn_timestamp_bucket(kcxt, arg, step, origin);
+
+	result.isnull = false;
+	if (!timestamp2tm(arg.value, NULL, &tm, &fsec, NULL) ||
+		!__timestamp_trunc_tm(val, &tm, &fsec, &redotz) ||
+		!tm2timestamp(&tm, fsec, NULL, &result.value))
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	return result;
+}
+
+STATIC_INLINE(pg_timestamptz_t)
+pgfn_timestamptz_trunc_unit(kern_context *kcxt, pg_timestamptz_t arg,
+							cl_int val)
+{
+	pg_timestamptz_t result;
+	struct pg_tm	tm;
+	fsec_t			fsec;
+	int				tz;
+	cl_long			step;
+	cl_long			origin;
+	cl_bool			redotz;
+
+	if (arg.isnull || TIMESTAMP_NOT_FINITE(arg.value))
+		return arg;
+	/* UTC offset is always multiple of seconds */
+	if (val == DTK_SECOND || val == DTK_MILLISEC || val == DTK_MICROSEC)
+	{
+		__timestamp_trunc_units_fixed(val, &step, &origin);
+		return pgfn_timestamptz_bucket(kcxt, arg, step, origin);
+	}
+#ifdef SESSION_TIMEZONE_FIXED_GMTOFF
+	/* shift the origin to the local midnight of the fixed offset */
+	if (__timestamp_trunc_units_fixed(val, &step, &origin))
+		return pgfn_timestamptz_bucket(kcxt, arg, step,
+									   origin - SESSION_TIMEZONE_FIXED_GMTOFF *
+									   USECS_PER_SEC);
+#endif
+	result.isnull = false;
+	if (!timestamp2tm(arg.value, &tz, &tm, &fsec, NULL) ||
+		!__timestamp_trunc_tm(val, &tm, &fsec, &redotz))
+		goto recheck;
+	if (redotz)
+		tz = DetermineTimeZoneOffset(&tm, &session_timezone_state);
+	if (!tm2timestamp(&tm, fsec, &tz, &result.value))
+		goto recheck;
+	return result;
+
+recheck:
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	result.isnull = true;
+	return result;
+}
+
+/*
+ * date_trunc(text,timestamp) - timestamp_trunc
+ */
+STATIC_FUNCTION(pg_timestamp_t)
+pgfn_date_trunc_timestamp(kern_context *kcxt,
+						  pg_text_t arg1, pg_timestamp_t arg2)
+{
+	pg_timestamp_t	result;
+	cl_int			type, val;
+
+	if (arg1.isnull || arg2.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	if (extract_decode_unit(arg1.value, &type, &val) && type == UNITS)
+		return pgfn_timestamp_trunc_unit(kcxt, arg2, val);
+	/* ERRCODE_FEATURE_NOT_SUPPORTED or ERRCODE_INVALID_PARAMETER_VALUE */
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	result.isnull = true;
+	return result;
+}
+
+/*
+ * date_trunc(text,timestamp with time zone) - timestamptz_trunc
+ */
+STATIC_FUNCTION(pg_timestamptz_t)
+pgfn_date_trunc_timestamptz(kern_context *kcxt,
+							pg_text_t arg1, pg_timestamptz_t arg2)
+{
+	pg_timestamptz_t result;
+	cl_int			type, val;
+
+	if (arg1.isnull || arg2.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	if (extract_decode_unit(arg1.value, &type, &val) && type == UNITS)
+		return pgfn_timestamptz_trunc_unit(kcxt, arg2, val);
+	/* ERRCODE_FEATURE_NOT_SUPPORTED or ERRCODE_INVALID_PARAMETER_VALUE */
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	result.isnull = true;
+	return result;
+}
+
 #endif /* __CUDACC__ */
 #endif /* CUDA_TIME_EXTRACT_H */
@@ -3240,6 +3240,127 @@ pgfn_now(kern_context *kcxt)
 	return result;
 }
 
+/*
+ * Bucketing of timestamp values by fixed-length intervals
+ *
+ * It rounds down the timestamp to the multiple of 'step' microseconds
+ * starting from the 'origin', using integer arithmetic only. Both of
+ * date_trunc() with a constant unit and time_bucket() are built on it.
+ */
+STATIC_INLINE(cl_bool)
+__timestamp_bucket(Timestamp ts, cl_long step, cl_long origin,
+				   Timestamp *p_result)
+{
+	cl_long		delta;
+	cl_long		rem;
+
+	if (step <= 0)
+		return false;
+	/* check overflow of the distance from the origin */
+	if ((origin > 0 && ts < LONG_MIN + origin) ||
+		(origin < 0 && ts > LONG_MAX + origin))
+		return false;
+	delta = ts - origin;
+	rem = delta % step;
+	if (rem < 0)
+		rem += step;
+	/* origin + (delta - rem) never overflows as it is between ts and origin */
+	*p_result = origin + (delta - rem);
+	return true;
+}
+
+STATIC_INLINE(pg_timestamp_t)
+pgfn_timestamp_bucket(kern_context *kcxt, pg_timestamp_t arg,
+					  cl_long step, cl_long origin)
+{
+	pg_timestamp_t	result;
+
+	if (arg.isnull || TIMESTAMP_NOT_FINITE(arg.value))
+		return arg;
+	result.isnull = false;
+	if (!__timestamp_bucket(arg.value, step, origin, &result.value))
+	{
+		/* ERRCODE_DATETIME_VALUE_OUT_OF_RANGE */
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	return result;
+}
+
+STATIC_INLINE(pg_timestamptz_t)
+pgfn_timestamptz_bucket(kern_context *kcxt, pg_timestamptz_t arg,
+						cl_long step, cl_long origin)
+{
+	pg_timestamptz_t result;
+
+	if (arg.isnull || TIMESTAMP_NOT_FINITE(arg.value))
+		return arg;
+	result.isnull = false;
+	if (!__timestamp_bucket(arg.value, step, origin, &result.value))
+	{
+		/* ERRCODE_DATETIME_VALUE_OUT_OF_RANGE */
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	return result;
+}
+
+/*
+ * time_bucket(interval, timestamp[tz])
+ *
+ * Buckets are aligned to 2000-01-03 00:00:00 (Monday) in UTC, and the width
+ * must not contain month field as like pgstrom_time_bucket() on the host.
+ */
+#define TIME_BUCKET_ORIGIN		(2 * USECS_PER_DAY)
+
+STATIC_FUNCTION(pg_timestamp_t)
+pgfn_time_bucket_timestamp(kern_context *kcxt,
+						   pg_interval_t arg1, pg_timestamp_t arg2)
+{
+	pg_timestamp_t	result;
+
+	if (arg1.isnull || arg2.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	if (arg1.value.month != 0)
+	{
+		/* ERRCODE_FEATURE_NOT_SUPPORTED */
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+		return result;
+	}
+	return pgfn_timestamp_bucket(kcxt, arg2,
+								 arg1.value.day * USECS_PER_DAY +
+								 arg1.value.time,
+								 TIME_BUCKET_ORIGIN);
+}
+
+STATIC_FUNCTION(pg_timestamptz_t)
+pgfn_time_bucket_timestamptz(kern_context *kcxt,
+							 pg_interval_t arg1, pg_timestamptz_t arg2)
+{
+	pg_timestamptz_t result;
+
+	if (arg1.isnull || arg2.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	if (arg1.value.month != 0)
+	{
+		/* ERRCODE_FEATURE_NOT_SUPPORTED */
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+		return result;
+	}
+	return pgfn_timestamptz_bucket(kcxt, arg2,
+								   arg1.value.day * USECS_PER_DAY +
+								   arg1.value.time,
+								   TIME_BUCKET_ORIGIN);
+}
+
 /*
  * overlaps() SQL functions
  *
@@ -3624,6 +3745,20 @@ assign_timelib_session_info(StringInfo buf)
 		"#define SetEpochTimestamp() (%ldLL)\n",
 		SetEpochTimestamp());
 
+	/*
+	 * Session timezone without daylight-saving nor historical changes
+	 * allows date_trunc() on timestamptz to run by integer arithmetic.
+	 */
+	{
+		long	gmtoff;
+
+		if (pg_get_timezone_offset(session_timezone, &gmtoff))
+			appendStringInfo(
+				buf,
+				"#define SESSION_TIMEZONE_FIXED_GMTOFF (%ldL)\n",
+				gmtoff);
+	}
+
 	appendStringInfo(
 		buf,
 		"\n"
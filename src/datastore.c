@@ -83,6 +83,67 @@ KDS_fetch_tuple_row(TupleTableSlot *slot,
 	return false;
 }
 
+/*
+ * PDS_fetch_tuple_restore
+ *
+ * It restores tts_values/tts_isnull of the slot which references the rows
+ * on the PDS directly. Caller must restore the slot prior to the release
+ * of the PDS; elsewhere, a later store onto the slot overwrites the buffer
+ * already released, or ExecResetTupleTable() tries to pfree() the array
+ * which is not palloc'd.
+ */
+void
+PDS_fetch_tuple_restore(GpuTaskState *gts)
+{
+	TupleTableSlot *slot = gts->zcopy_slot;
+
+	if (slot)
+	{
+		ExecClearTuple(slot);
+		slot->tts_values = gts->zcopy_values;
+		slot->tts_isnull = gts->zcopy_isnull;
+		gts->zcopy_slot = NULL;
+		gts->zcopy_values = NULL;
+		gts->zcopy_isnull = NULL;
+	}
+	/* batch buffer might be decoded from the PDS to be released */
+	gts->cbatch_kds = NULL;
+	gts->cbatch_base = 0;
+	gts->cbatch_nitems = 0;
+}
+
+/*
+ * KDS_fetch_tuple_zcopy - makes the slot reference the supplied arrays
+ */
+static inline void
+KDS_fetch_tuple_zcopy(TupleTableSlot *slot, GpuTaskState *gts,
+					  Datum *tts_values, bool *tts_isnull)
+{
+	if (gts->zcopy_slot != slot)
+	{
+		if (gts->zcopy_slot)
+		{
+			TupleTableSlot *prev = gts->zcopy_slot;
+
+			ExecClearTuple(prev);
+			prev->tts_values = gts->zcopy_values;
+			prev->tts_isnull = gts->zcopy_isnull;
+		}
+		gts->zcopy_slot = slot;
+		gts->zcopy_values = slot->tts_values;
+		gts->zcopy_isnull = slot->tts_isnull;
+	}
+	slot->tts_values = tts_values;
+	slot->tts_isnull = tts_isnull;
+	ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * KDS_fetch_tuple_slot
+ *
+ * KDS_FORMAT_SLOT has the identical layout of tts_values/tts_isnull per row,
+ * so the slot references the row on the KDS as is, instead of the copy.
+ */
 static inline bool
 KDS_fetch_tuple_slot(TupleTableSlot *slot,
 					 kern_data_store *kds,
@@ -91,28 +152,83 @@ KDS_fetch_tuple_slot(TupleTableSlot *slot,
 	if (gts->curr_index < kds->nitems)
 	{
 		size_t	row_index = gts->curr_index++;
-		Datum  *tts_values = KERN_DATA_STORE_VALUES(kds, row_index);
-		bool   *tts_isnull = KERN_DATA_STORE_ISNULL(kds, row_index);
-		int		natts = slot->tts_tupleDescriptor->natts;
 
-		memcpy(slot->tts_values, tts_values, sizeof(Datum) * natts);
-		memcpy(slot->tts_isnull, tts_isnull, sizeof(bool) * natts);
-#ifdef NOT_USED
-		/*
-		 * XXX - pointer reference is better than memcpy from performance
-		 * perspectives, however, we need to ensure tts_values/tts_isnull
-		 * shall be restored when pgstrom-data-store is released.
-		 * It will be cause of complicated / invisible bugs.
-		 */
-		slot->tts_values = tts_values;
-		slot->tts_isnull = tts_isnull;
-#endif
-		ExecStoreVirtualTuple(slot);
+		Assert(slot->tts_tupleDescriptor->natts <= kds->ncols);
+		KDS_fetch_tuple_zcopy(slot, gts,
+							  KERN_DATA_STORE_VALUES(kds, row_index),
+							  (bool *)KERN_DATA_STORE_ISNULL(kds, row_index));
 		return true;
 	}
+	/* caller shall release the PDS, or switch to the next one */
+	PDS_fetch_tuple_restore(gts);
 	return false;
 }
 
+/*
+ * KDS_fixup_block_visibility
+ *
+ * A block loaded by SSD-to-GPU P2P DMA may not be all-visible, if GPU
+ * kernel checks visibility of the tuples using hint-bits. Once CPU fallback
+ * is required, we have to check visibility of the tuples on the block
+ * exactly, then invalidate invisible ones prior to the fetch.
+ * Xids of the inserter known to be committed are also remembered on the
+ * parameter buffer, for the GPU kernel of the following tasks.
+ */
+void
+KDS_fixup_block_visibility(GpuTaskState *gts, Relation relation,
+						   BlockNumber block_nr, PageHeader hpage)
+{
+	Snapshot		snapshot = gts->css.ss.ps.state->es_snapshot;
+	kern_parambuf  *kparams = gts->kern_params;
+	Buffer			buffer;
+	int				lines = PageGetMaxOffsetNumber((Page) hpage);
+	OffsetNumber	lineoff;
+	ItemId			lpp;
+
+	buffer = ReadBufferExtended(relation, MAIN_FORKNUM, block_nr,
+								RBM_NORMAL, NULL);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	for (lineoff = FirstOffsetNumber, lpp = PageGetItemId((Page) hpage, lineoff);
+		 lineoff <= lines;
+		 lineoff++, lpp++)
+	{
+		HeapTupleData	tup;
+		TransactionId	xmin;
+		cl_uint			i;
+
+		if (!ItemIdIsNormal(lpp))
+			continue;
+
+		tup.t_tableOid = RelationGetRelid(relation);
+		tup.t_data = (HeapTupleHeader) PageGetItem((Page) hpage, lpp);
+		tup.t_len = ItemIdGetLength(lpp);
+		ItemPointerSet(&tup.t_self, block_nr, lineoff);
+
+		if (!HeapTupleSatisfiesVisibility(&tup, snapshot, buffer))
+		{
+			ItemIdSetUnused(lpp);
+			continue;
+		}
+		/* remember the committed xmin for GPU kernel */
+		xmin = HeapTupleHeaderGetRawXmin(tup.t_data);
+		if (HeapTupleHeaderXminFrozen(tup.t_data) ||
+			!TransactionIdIsNormal(xmin) ||
+			!TransactionIdPrecedes(xmin, kparams->xactSnapshotXmin))
+			continue;
+		for (i=0; i < kparams->nCommittedXids; i++)
+		{
+			if (kparams->committedXids[i] == xmin)
+				break;
+		}
+		if (i == kparams->nCommittedXids &&
+			i < KPARAMS_NUM_COMMITTED_XIDS)
+			kparams->committedXids[kparams->nCommittedXids++] = xmin;
+	}
+	UnlockReleaseBuffer(buffer);
+	/* hpage became all-visible also */
+	PageSetAllVisible((Page) hpage);
+}
+
 static inline bool
 KDS_fetch_tuple_block(TupleTableSlot *slot,
 					  kern_data_store *kds,
@@ -129,7 +245,11 @@ KDS_fetch_tuple_block(TupleTableSlot *slot,
 	{
 		block_nr = KERN_DATA_STORE_BLOCK_BLCKNR(kds, gts->curr_index);
 		hpage = KERN_DATA_STORE_BLOCK_PGPAGE(kds, gts->curr_index);
-		Assert(PageIsAllVisible(hpage));
+		if (gts->curr_lp_index == 0 && !PageIsAllVisible(hpage))
+		{
+			Assert(rel != NULL && gts->nvme_sstate->gpu_visibility);
+			KDS_fixup_block_visibility(gts, rel, block_nr, hpage);
+		}
 		max_lp_index = PageGetMaxOffsetNumber(hpage);
 		while (gts->curr_lp_index < max_lp_index)
 		{
@@ -166,9 +286,9 @@ KDS_fetch_tuple_column(TupleTableSlot *slot,
 	/*
 	 * XXX - Is a mode to fetch system columns (if any) valuable?
 	 * Right now, KDS_fetch_tuple_column() is only used by gstore_fdw.c
-	 * to fetch rows from KDS(column), however, its transaction control
-	 * properties are separately saved, thus, nobody tries to pick up
-	 * system columns via this API.
+	 * and arrow_fdw.c to fetch rows from KDS(column), however, its
+	 * transaction control properties are separately saved (or not exist),
+	 * thus, nobody tries to pick up system columns via this API.
 	 */
 	Assert(kds->format == KDS_FORMAT_COLUMN);
 	Assert(kds->ncols == tupdesc->natts + NumOfSystemAttrs);
@@ -207,11 +327,151 @@ KDS_fetch_tuple_column(TupleTableSlot *slot,
 	return true;
 }
 
+/*
+ * KDS_fetch_tuple_column_batch
+ *
+ * It decodes KDS_FORMAT_COLUMN by KDS_FETCH_BATCH_NROWS rows at once, column
+ * by column, onto the row-major batch buffer, then the slot references the
+ * row on the batch buffer. Values of !attbyval columns still point to the
+ * KDS, like KDS_fetch_tuple_column().
+ */
+#define KDS_FETCH_BATCH_NROWS		256
+
+static bool
+KDS_fetch_tuple_column_batch(TupleTableSlot *slot,
+							 kern_data_store *kds,
+							 GpuTaskState *gts)
+{
+	int			natts = slot->tts_tupleDescriptor->natts;
+	size_t		row_index = gts->curr_index;
+	size_t		k;
+
+	Assert(kds->format == KDS_FORMAT_COLUMN);
+	Assert(kds->ncols == natts + NumOfSystemAttrs);
+	if (row_index >= kds->nitems)
+	{
+		PDS_fetch_tuple_restore(gts);
+		return false;
+	}
+
+	if (gts->cbatch_kds != kds ||
+		row_index <  gts->cbatch_base ||
+		row_index >= gts->cbatch_base + gts->cbatch_nitems)
+	{
+		size_t		nrows = Min(kds->nitems - row_index,
+								KDS_FETCH_BATCH_NROWS);
+		int			j;
+
+		if (gts->cbatch_natts < natts)
+		{
+			MemoryContext	memcxt = gts->css.ss.ps.state->es_query_cxt;
+
+			/* slot may still reference the old buffer */
+			PDS_fetch_tuple_restore(gts);
+			if (gts->cbatch_values)
+				pfree(gts->cbatch_values);
+			if (gts->cbatch_isnull)
+				pfree(gts->cbatch_isnull);
+			gts->cbatch_values = MemoryContextAlloc(memcxt, sizeof(Datum) *
+											natts * KDS_FETCH_BATCH_NROWS);
+			gts->cbatch_isnull = MemoryContextAlloc(memcxt, sizeof(bool) *
+											natts * KDS_FETCH_BATCH_NROWS);
+			gts->cbatch_natts = natts;
+		}
+
+		for (j=0; j < natts; j++)
+		{
+			kern_colmeta *cmeta = &kds->colmeta[j];
+			Datum	   *values = gts->cbatch_values + j;
+			bool	   *isnull = gts->cbatch_isnull + j;
+			char	   *base;
+			bits8	   *nullmap = NULL;
+			int			unitsz;
+
+			if (cmeta->va_offset == 0)
+			{
+				/* column is not loaded, or dropped */
+				for (k=0; k < nrows; k++)
+					isnull[natts * k] = true;
+				continue;
+			}
+			base = ((char *)kds +
+					((size_t)cmeta->va_offset << MAXIMUM_ALIGNOF_SHIFT));
+			if (cmeta->attlen < 0)
+			{
+				cl_uint	   *vl_offsets = (cl_uint *)base;
+
+				for (k=0; k < nrows; k++)
+				{
+					cl_uint		offset = vl_offsets[row_index + k];
+
+					if (offset == 0)
+						isnull[natts * k] = true;
+					else
+					{
+						isnull[natts * k] = false;
+						values[natts * k] = PointerGetDatum(base +
+									((size_t)offset << MAXIMUM_ALIGNOF_SHIFT));
+					}
+				}
+				continue;
+			}
+
+			unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+			if (cmeta->extra_sz > 0)
+				nullmap = (bits8 *)(base + MAXALIGN(unitsz * kds->nitems));
+			base += unitsz * row_index;
+			for (k=0; k < nrows; k++, base += unitsz)
+			{
+				size_t		i = row_index + k;
+
+				if (nullmap && att_isnull(i, nullmap))
+				{
+					isnull[natts * k] = true;
+					continue;
+				}
+				isnull[natts * k] = false;
+				if (!cmeta->attbyval)
+					values[natts * k] = PointerGetDatum(base);
+				else if (cmeta->attlen == sizeof(cl_char))
+					values[natts * k] = CharGetDatum(*((cl_char *)base));
+				else if (cmeta->attlen == sizeof(cl_short))
+					values[natts * k] = Int16GetDatum(*((cl_short *)base));
+				else if (cmeta->attlen == sizeof(cl_int))
+					values[natts * k] = Int32GetDatum(*((cl_int *)base));
+				else if (cmeta->attlen == sizeof(cl_long))
+					values[natts * k] = Int64GetDatum(*((cl_long *)base));
+				else
+					elog(ERROR, "unexpected attlen: %d", cmeta->attlen);
+			}
+		}
+		gts->cbatch_kds = kds;
+		gts->cbatch_base = row_index;
+		gts->cbatch_nitems = nrows;
+	}
+	k = row_index - gts->cbatch_base;
+	KDS_fetch_tuple_zcopy(slot, gts,
+						  gts->cbatch_values + natts * k,
+						  gts->cbatch_isnull + natts * k);
+	gts->curr_index++;
+
+	return true;
+}
+
 bool
 PDS_fetch_tuple(TupleTableSlot *slot,
 				pgstrom_data_store *pds,
 				GpuTaskState *gts)
 {
+	/*
+	 * Other formats store the values onto the arrays of the slot, so
+	 * it should not reference the PDS any more.
+	 */
+	if (gts->zcopy_slot == slot &&
+		pds->kds.format != KDS_FORMAT_SLOT &&
+		pds->kds.format != KDS_FORMAT_COLUMN)
+		PDS_fetch_tuple_restore(gts);
+
 	switch (pds->kds.format)
 	{
 		case KDS_FORMAT_ROW:
@@ -222,7 +482,7 @@ PDS_fetch_tuple(TupleTableSlot *slot,
 		case KDS_FORMAT_BLOCK:
 			return KDS_fetch_tuple_block(slot, &pds->kds, gts);
 		case KDS_FORMAT_COLUMN:
-			return KDS_fetch_tuple_column(slot, &pds->kds, gts->curr_index++);
+			return KDS_fetch_tuple_column_batch(slot, &pds->kds, gts);
 		default:
 			elog(ERROR, "Bug? unsupported data store format: %d",
 				pds->kds.format);
@@ -231,9 +491,13 @@ PDS_fetch_tuple(TupleTableSlot *slot,
 
 /*
  * PDS_clone - makes an empty data store with same definition
+ *
+ * The new data store can have a different length from the original one;
+ * it is only valid for KDS_FORMAT_ROW (or other formats with no slots) that
+ * allocates the row-index and tuples from the both ends of the buffer.
  */
 pgstrom_data_store *
-__PDS_clone(pgstrom_data_store *pds_old,
+__PDS_clone(pgstrom_data_store *pds_old, Size length,
 			const char *filename, int lineno)
 {
 	pgstrom_data_store *pds_new;
@@ -243,7 +507,7 @@ __PDS_clone(pgstrom_data_store *pds_old,
 	rc = __gpuMemAllocManaged(pds_old->gcontext,
 							  &m_deviceptr,
 							  offsetof(pgstrom_data_store,
-									   kds) + pds_old->kds.length,
+									   kds) + length,
 							  CU_MEM_ATTACH_GLOBAL,
 							  filename, lineno);
 	if (rc != CUDA_SUCCESS)
@@ -260,6 +524,7 @@ __PDS_clone(pgstrom_data_store *pds_old,
 		   &pds_old->kds,
 		   KERN_DATA_STORE_HEAD_LENGTH(&pds_old->kds));
 	/* make the data store empty */
+	pds_new->kds.length = length;
 	pds_new->kds.usage = 0;
 	pds_new->kds.nitems = 0;
 
@@ -714,6 +979,15 @@ PDS_init_heapscan_state(GpuTaskState *gts,
 	cl_uint			nchunks;
 	cl_uint			nblocks_per_chunk;
 
+	/*
+	 * Pending pages of the host loader are always flushed before the end
+	 * of gpuscanExecScanChunk(), so what remains here was left by an error
+	 * in the previous scan. Its buffer pins are already released by the
+	 * resource owner, so we just forget them.
+	 */
+	heapscan_loader_npages = 0;
+	heapscan_loader_kds = NULL;
+
 	/* check storage capability and relation's size */
 	if (!RelationWillUseNvmeStrom(relation, &nr_blocks))
 		return;
@@ -750,6 +1024,7 @@ PDS_init_heapscan_state(GpuTaskState *gts,
 	nvme_sstate->nblocks_per_chunk = nblocks_per_chunk;
 	nvme_sstate->curr_segno = InvalidBlockNumber;
 	nvme_sstate->curr_vmbuffer = InvalidBuffer;
+	nvme_sstate->gpu_visibility = (gts->kern_params->xactSnapshotXmin != 0);
 	nvme_sstate->nr_segs = nr_segs;
 	nvme_sstate_open_files(gcontext, nvme_sstate, relation);
 
@@ -816,12 +1091,14 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 
 	/*
 	 * NVMe-Strom can be applied only when filesystem supports the feature,
-	 * and the current source block is all-visible.
+	 * and the current source block is all-visible, or GPU kernel can check
+	 * visibility of the tuples using hint-bits.
 	 * Elsewhere, we will go fallback with synchronized buffer scan.
 	 */
 	if (RelationCanUseNvmeStrom(relation) &&
-		VM_ALL_VISIBLE(relation, blknum,
-					   &nvme_sstate->curr_vmbuffer))
+		(nvme_sstate->gpu_visibility ||
+		 VM_ALL_VISIBLE(relation, blknum,
+						&nvme_sstate->curr_vmbuffer)))
 	{
 		BufferTag	newTag;
 		uint32		newHash;
@@ -929,11 +1206,162 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 	return true;
 }
 
+/*
+ * Host loader threads
+ *
+ * PDS_exec_heapscan_row() has to check visibility of the tuples under the
+ * buffer lock, and it is not thread-safe because of the buffer manager.
+ * On the other hands, the memcpy() of the visible tuples to the KDS can be
+ * deferred as long as we keep the buffer pinned, because nobody can prune
+ * or defragment the page without the cleanup lock.
+ * So, if pg_strom.heapscan_loader_threads > 1, PDS_exec_heapscan_row()
+ * only reserves the space of the tuples, then PDS_flush_heapscan() copies
+ * them using multiple threads and releases the buffer pins.
+ */
+typedef struct
+{
+	Buffer		buffer;
+	Page		page;
+	cl_uint		index;		/* first row-index of the tuples on the page */
+	cl_uint		ntup;		/* number of the tuples on the page */
+} heapscanLoaderPage;
+
+#define HEAPSCAN_LOADER_MAX_PAGES	1024
+
+static heapscanLoaderPage *heapscan_loader_pages = NULL;
+static cl_uint			heapscan_loader_npages = 0;
+static kern_data_store *heapscan_loader_kds = NULL;
+static pg_atomic_uint32	heapscan_loader_next_page;
+static pthread_mutex_t	heapscan_loader_mutex;
+static pthread_cond_t	heapscan_loader_cond;
+static cl_uint			heapscan_loader_generation = 0;
+static int				heapscan_loader_nthreads = 0;
+static int				heapscan_loader_ndone = 0;
+
+/*
+ * heapscan_loader_copy_pages - copy the pending tuples to the KDS
+ */
+static void
+heapscan_loader_copy_pages(void)
+{
+	kern_data_store *kds = heapscan_loader_kds;
+	cl_uint		   *tup_index = KERN_DATA_STORE_ROWINDEX(kds);
+	cl_uint			i, j;
+
+	while ((i = pg_atomic_fetch_add_u32(&heapscan_loader_next_page,
+										1)) < heapscan_loader_npages)
+	{
+		heapscanLoaderPage *lpage = &heapscan_loader_pages[i];
+
+		for (j=0; j < lpage->ntup; j++)
+		{
+			kern_tupitem   *tup_item = (kern_tupitem *)
+				((char *)kds + tup_index[lpage->index + j]);
+			ItemId			lpp = PageGetItemId(lpage->page,
+								ItemPointerGetOffsetNumber(&tup_item->t_self));
+
+			memcpy(&tup_item->htup,
+				   PageGetItem(lpage->page, lpp),
+				   tup_item->t_len);
+		}
+	}
+}
+
+/*
+ * heapscan_loader_main - main loop of the host loader threads
+ */
+static void *
+heapscan_loader_main(void *arg)
+{
+	cl_uint		generation = (cl_uint)(uintptr_t) arg;
+
+	for (;;)
+	{
+		pthreadMutexLock(&heapscan_loader_mutex);
+		while (heapscan_loader_generation == generation)
+			pthreadCondWait(&heapscan_loader_cond, &heapscan_loader_mutex);
+		generation = heapscan_loader_generation;
+		pthreadMutexUnlock(&heapscan_loader_mutex);
+
+		heapscan_loader_copy_pages();
+
+		pthreadMutexLock(&heapscan_loader_mutex);
+		if (++heapscan_loader_ndone == heapscan_loader_nthreads)
+			pthreadCondBroadcast(&heapscan_loader_cond);
+		pthreadMutexUnlock(&heapscan_loader_mutex);
+	}
+	return NULL;
+}
+
+/*
+ * PDS_flush_heapscan - copies the tuples deferred by PDS_exec_heapscan_row,
+ * then releases the buffers pinned.
+ */
+void
+PDS_flush_heapscan(pgstrom_data_store *pds)
+{
+	cl_uint		i;
+
+	if (heapscan_loader_npages == 0)
+		return;
+	Assert(heapscan_loader_kds == &pds->kds);
+
+	/*
+	 * Launch the loader threads on demand. They are never terminated until
+	 * exit of the backend, and just wait for the next generation. If we
+	 * cannot launch a thread, its share is processed by the existing ones.
+	 */
+	if (heapscan_loader_nthreads == 0)
+	{
+		pthreadMutexInit(&heapscan_loader_mutex, 0);
+		pthreadCondInit(&heapscan_loader_cond);
+	}
+	while (heapscan_loader_nthreads < pgstrom_heapscan_loader_threads - 1)
+	{
+		pthread_t	thread;
+
+		if ((errno = pthread_create(&thread, NULL,
+									heapscan_loader_main,
+									(void *)(uintptr_t)
+									heapscan_loader_generation)) != 0)
+		{
+			elog(LOG, "failed on pthread_create: %m");
+			break;
+		}
+		pthread_detach(thread);
+		pthreadMutexLock(&heapscan_loader_mutex);
+		heapscan_loader_nthreads++;
+		pthreadMutexUnlock(&heapscan_loader_mutex);
+	}
+
+	/* kick the loader threads, and the backend also copies the tuples */
+	pg_atomic_write_u32(&heapscan_loader_next_page, 0);
+	pthreadMutexLock(&heapscan_loader_mutex);
+	heapscan_loader_ndone = 0;
+	heapscan_loader_generation++;
+	pthreadCondBroadcast(&heapscan_loader_cond);
+	pthreadMutexUnlock(&heapscan_loader_mutex);
+
+	heapscan_loader_copy_pages();
+
+	pthreadMutexLock(&heapscan_loader_mutex);
+	while (heapscan_loader_ndone < heapscan_loader_nthreads)
+		pthreadCondWait(&heapscan_loader_cond, &heapscan_loader_mutex);
+	pthreadMutexUnlock(&heapscan_loader_mutex);
+
+	/* OK, no threads touch the pages any more */
+	for (i=0; i < heapscan_loader_npages; i++)
+		ReleaseBuffer(heapscan_loader_pages[i].buffer);
+	heapscan_loader_npages = 0;
+	heapscan_loader_kds = NULL;
+}
+
 /*
  * PDS_exec_heapscan_row - PDS scan for KDS_FORMAT_ROW format
  */
 static bool
-PDS_exec_heapscan_row(pgstrom_data_store *pds,
+PDS_exec_heapscan_row(GpuTaskState *gts,
+					  pgstrom_data_store *pds,
 					  Relation relation,
 					  HeapScanDesc hscan)
 {
@@ -950,8 +1378,28 @@ PDS_exec_heapscan_row(pgstrom_data_store *pds,
 	uint		   *tup_index;
 	kern_tupitem   *tup_item;
 	bool			all_visible;
+	bool			deferred;
 	Size			max_consume;
 
+	/*
+	 * Copy of the tuples shall be deferred to PDS_flush_heapscan(), if host
+	 * loader threads are enabled. Number of the pending pages is limited
+	 * not to pin too much shared buffers at once.
+	 */
+	deferred = (pgstrom_heapscan_loader_threads > 1 ||
+				heapscan_loader_npages > 0);
+	if (deferred)
+	{
+		if (!heapscan_loader_pages)
+			heapscan_loader_pages = MemoryContextAlloc(TopMemoryContext,
+											sizeof(heapscanLoaderPage) *
+											HEAPSCAN_LOADER_MAX_PAGES);
+		if (heapscan_loader_npages >= Min(HEAPSCAN_LOADER_MAX_PAGES,
+										  Max(NBuffers / 64, 16)))
+			PDS_flush_heapscan(pds);
+		heapscan_loader_kds = kds;
+	}
+
 	/* Load the target buffer */
 	buffer = ReadBufferExtended(relation, MAIN_FORKNUM, blknum,
 								RBM_NORMAL, strategy);
@@ -1022,17 +1470,38 @@ PDS_exec_heapscan_row(pgstrom_data_store *pds,
 		if (!valid)
 			continue;
 
+		/* discard the tuple which never match to the GpuJoin inner */
+		if (gts->outer_bloom &&
+			!GpuJoinOuterBloomFilterTest(gts, RelationGetDescr(relation),
+										 &tup))
+			continue;
+
 		/* put tuple */
 		kds->usage += LONGALIGN(offsetof(kern_tupitem, htup) + tup.t_len);
 		tup_item = (kern_tupitem *)((char *)kds + kds->length - kds->usage);
 		tup_index[ntup] = (uintptr_t)tup_item - (uintptr_t)kds;
 		tup_item->t_len = tup.t_len;
 		tup_item->t_self = tup.t_self;
-		memcpy(&tup_item->htup, tup.t_data, tup.t_len);
+		if (!deferred)
+			memcpy(&tup_item->htup, tup.t_data, tup.t_len);
 
 		ntup++;
 	}
-	UnlockReleaseBuffer(buffer);
+
+	if (!deferred || ntup == 0)
+		UnlockReleaseBuffer(buffer);
+	else
+	{
+		heapscanLoaderPage *lpage
+			= &heapscan_loader_pages[heapscan_loader_npages++];
+
+		/* keep the buffer pinned until PDS_flush_heapscan() */
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		lpage->buffer = buffer;
+		lpage->page = page;
+		lpage->index = kds->nitems;
+		lpage->ntup = ntup;
+	}
 	Assert(ntup <= MaxHeapTuplesPerPage);
 	Assert(kds->nitems + ntup <= kds->nrooms);
 	kds->nitems += ntup;
@@ -1053,7 +1522,7 @@ PDS_exec_heapscan(GpuTaskState *gts, pgstrom_data_store *pds)
 	CHECK_FOR_INTERRUPTS();
 
 	if (pds->kds.format == KDS_FORMAT_ROW)
-		retval = PDS_exec_heapscan_row(pds, relation, hscan);
+		retval = PDS_exec_heapscan_row(gts, pds, relation, hscan);
 	else if (pds->kds.format == KDS_FORMAT_BLOCK)
 	{
 		Assert(gts->nvme_sstate);
@@ -1111,6 +1580,56 @@ KDS_insert_tuple(kern_data_store *kds, TupleTableSlot *slot)
 	return true;
 }
 
+/*
+ * KDS_append_rows
+ *
+ * It appends all the rows in @kds_src to @kds_dst; both of them must be
+ * KDS_FORMAT_ROW with same row-type. It returns false without any changes
+ * if @kds_dst has no room for all the rows.
+ */
+bool
+KDS_append_rows(kern_data_store *kds_dst, kern_data_store *kds_src)
+{
+	cl_uint		   *tup_index = KERN_DATA_STORE_ROWINDEX(kds_dst);
+	kern_tupitem   *tup_src;
+	kern_tupitem   *tup_dst;
+	size_t			required = 0;
+	cl_uint			i;
+
+	if (kds_dst->format != KDS_FORMAT_ROW ||
+		kds_src->format != KDS_FORMAT_ROW)
+		elog(ERROR, "Bug? unexpected data-store format: %d/%d",
+			 kds_dst->format, kds_src->format);
+	Assert(kds_dst->ncols == kds_src->ncols);
+
+	/* check whether we have room for all the rows */
+	if (kds_dst->nitems + kds_src->nitems > kds_dst->nrooms)
+		return false;
+	for (i=0; i < kds_src->nitems; i++)
+	{
+		tup_src = KERN_DATA_STORE_TUPITEM(kds_src, i);
+		required += LONGALIGN(offsetof(kern_tupitem, htup) + tup_src->t_len);
+	}
+	if (KDS_CALCULATE_ROW_LENGTH(kds_dst->ncols,
+								 kds_dst->nitems + kds_src->nitems,
+								 required + kds_dst->usage) > kds_dst->length)
+		return false;
+
+	/* OK, put the records */
+	for (i=0; i < kds_src->nitems; i++)
+	{
+		tup_src = KERN_DATA_STORE_TUPITEM(kds_src, i);
+		kds_dst->usage += LONGALIGN(offsetof(kern_tupitem, htup) +
+									tup_src->t_len);
+		tup_dst = (kern_tupitem *)((char *)kds_dst + kds_dst->length
+								   - kds_dst->usage);
+		memcpy(tup_dst, tup_src, offsetof(kern_tupitem, htup) +
+			   tup_src->t_len);
+		tup_index[kds_dst->nitems++] = (uintptr_t)tup_dst - (uintptr_t)kds_dst;
+	}
+	return true;
+}
+
 
 /*
  * PDS_insert_hashitem
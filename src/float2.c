@@ -190,6 +190,24 @@ print_fp64(const char *prefix, cl_ulong value)
 #endif
 }
 
+/*
+ * get_float2_type_oid
+ *
+ * float2 is not a built-in data type, so its OID is not a constant.
+ */
+Oid
+get_float2_type_oid(bool missing_ok)
+{
+	Oid		type_oid;
+
+	type_oid = GetSysCacheOid2(TYPENAMENSP,
+							   CStringGetDatum("float2"),
+							   ObjectIdGetDatum(PG_CATALOG_NAMESPACE));
+	if (!OidIsValid(type_oid) && !missing_ok)
+		elog(ERROR, "type \"float2\" is not defined");
+	return type_oid;
+}
+
 /*
  * check to see if a float4/8 val has underflowed or overflowed
  */
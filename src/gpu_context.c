@@ -17,11 +17,13 @@
  */
 #include "postgres.h"
 #include "access/twophase.h"
+#include "libpq/auth.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/pg_crc.h"
 #include "utils/resowner.h"
+#include "utils/timestamp.h"
 #include "pg_strom.h"
 
 /* IPC stuff of GpuContext */
@@ -31,6 +33,7 @@ typedef struct
 	pthread_mutex_t		mutex;
 	pthread_cond_t		cond;
 	pg_atomic_uint32	command;
+	GpuContextStat		stat;
 } GpuContextIPCEntry;
 
 typedef struct
@@ -41,15 +44,56 @@ typedef struct
 	GpuContextIPCEntry ipc_entries[FLEXIBLE_ARRAY_MEMBER];
 } GpuContextIPCHead;
 
+/*
+ * GpuSchedulerState - per-device state of the admission control
+ */
+typedef struct GpuSchedulerState
+{
+	pg_atomic_uint32	total_weight;	/* sum of weight of GpuContexts */
+	pg_atomic_uint32	num_waiters;	/* # of GpuContexts being refused */
+} GpuSchedulerState;
+
 /* variables */
 static shmem_startup_hook_type shmem_startup_next = NULL;
 static pg_atomic_uint32 *global_num_running_tasks;	/* shared */
+static GpuSchedulerState *gpu_scheduler_state;		/* shared */
+static int			gpu_task_weight;			/* GUC */
 static GpuContextIPCHead *gcontext_ipc_head;	/* shared */
 int					global_max_async_tasks;		/* GUC */
 int					local_max_async_tasks;		/* GUC */
 int					max_num_gpucontext;			/* GUC */
 static slock_t		activeGpuContextLock;
 static dlist_head	activeGpuContextList;
+static ClientAuthentication_hook_type client_auth_next = NULL;
+
+/*
+ * Prefetch of CUDA context
+ *
+ * cuCtxCreate() and cuCtxDestroy() take hundreds of milliseconds, and they
+ * dominate the response time of short queries. If pg_strom.cuda_context_prefetch
+ * is enabled, a helper thread of the backend creates a spare CUDA context on
+ * the session start-up and just after the release of GpuContext, then
+ * create_cuda_context() adopts the spare if it is on the required device.
+ * CUDA contexts released are also destroyed by the helper thread, out of the
+ * critical path of the query. The helper thread never touches PostgreSQL's
+ * infrastructure, so it reports nothing but logs by the caller.
+ */
+#define CUDA_PREFETCH_MAX_DESTROY		32
+
+static bool			cuda_context_prefetch;		/* GUC */
+static bool			cuda_prefetch_thread_running = false;
+static pthread_mutex_t cuda_prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cuda_prefetch_cond = PTHREAD_COND_INITIALIZER;
+static int			cuda_prefetch_request = -1;	/* device to be prefetched */
+static int			cuda_prefetch_inprogress = -1;	/* device in-progress */
+static int			cuda_prefetch_spare_dindex = -1;
+static CUcontext	cuda_prefetch_spare = NULL;
+static bool			cuda_prefetch_terminate = false;
+static int			cuda_prefetch_ndestroy = 0;
+static CUcontext	cuda_prefetch_destroy[CUDA_PREFETCH_MAX_DESTROY];
+
+Datum pgstrom_gpu_context_info(PG_FUNCTION_ARGS);
+Datum pgstrom_gpu_context_meminfo(PG_FUNCTION_ARGS);
 
 /*
  * Resource tracker of GpuContext
@@ -440,11 +484,13 @@ typedef struct
 {
 	dlist_node	chain;
 	ProgramId	program_id;
+	int			variant;
 	CUmodule	cuda_module;
 } GpuContextModuleEntry;
 
 static CUmodule
-GpuContextLookupModule(GpuContext *gcontext, ProgramId program_id)
+GpuContextLookupModule(GpuContext *gcontext, ProgramId program_id,
+					   int variant)
 {
 	GpuContextModuleEntry *entry;
 	dlist_iter	iter;
@@ -462,7 +508,8 @@ GpuContextLookupModule(GpuContext *gcontext, ProgramId program_id)
 		dlist_foreach(iter, &gcontext->cuda_modules_slot[index])
 		{
 			entry = dlist_container(GpuContextModuleEntry, chain, iter.cur);
-			if (entry->program_id == program_id)
+			if (entry->program_id == program_id &&
+				entry->variant == variant)
 			{
 				cuda_module = entry->cuda_module;
 				goto found;
@@ -471,10 +518,11 @@ GpuContextLookupModule(GpuContext *gcontext, ProgramId program_id)
 		entry = calloc(1, sizeof(GpuContextModuleEntry));
 		if (!entry)
 			werror("out of memory");
-		cuda_module = pgstrom_load_cuda_program(program_id);
+		cuda_module = pgstrom_load_cuda_program(program_id, variant);
 
 		entry->cuda_module = cuda_module;
 		entry->program_id = program_id;
+		entry->variant = variant;
 		dlist_push_head(&gcontext->cuda_modules_slot[index],
 						&entry->chain);
 	found:
@@ -499,20 +547,23 @@ ReleaseLocalResources(GpuContext *gcontext, bool normal_exit)
 {
 	ResourceTracker *tracker;
 	dlist_node *dnode;
-	CUresult	rc;
 	int			i;
 
 	Assert(!gcontext->worker_is_running);
 
+	/* detach from the admission control */
+	if (gcontext->sched_waiting)
+		pg_atomic_fetch_sub_u32(&gcontext->gsched->num_waiters, 1);
+	pg_atomic_fetch_sub_u32(&gcontext->gsched->total_weight,
+							gcontext->sched_weight);
+
 	if (gcontext->cuda_context_multi)
 	{
 		for (i=0; i < numDevAttrs; i++)
 		{
 			if (!gcontext->cuda_context_multi[i])
 				continue;
-			rc = cuCtxDestroy(gcontext->cuda_context_multi[i]);
-			if (rc != CUDA_SUCCESS)
-				elog(WARNING, "Failed on cuCtxDestroy: %s", errorText(rc));
+			cuda_destroy_context(gcontext->cuda_context_multi[i]);
 		}
 		free(gcontext->cuda_context_multi);
 		gcontext->cuda_context_multi = NULL;
@@ -520,10 +571,11 @@ ReleaseLocalResources(GpuContext *gcontext, bool normal_exit)
 
 	if (gcontext->cuda_context)
 	{
-		rc = cuCtxDestroy(gcontext->cuda_context);
-		if (rc != CUDA_SUCCESS)
-			elog(WARNING, "Failed on cuCtxDestroy: %s", errorText(rc));
+		cuda_destroy_context(gcontext->cuda_context);
 		gcontext->cuda_context = NULL;
+		/* prefetch a spare context for the next query */
+		if (!gcontext->never_use_mps)
+			cuda_prefetch_kick(gcontext->cuda_dindex);
 	}
 
 	/* OK, release other resources */
@@ -545,8 +597,10 @@ ReleaseLocalResources(GpuContext *gcontext, bool normal_exit)
 					/*
 					 * NOTE: All the GPU related memory is already wipied
 					 * out by cuCtxDestroy(), so we don't need to release
-					 * individual memory chunks by ourselves.
+					 * individual memory chunks by ourselves, except for
+					 * the items borrowed from the device memory pool.
 					 */
+					gpuMemPoolReturnExtra(tracker->u.devmem.extra);
 					break;
 				case RESTRACK_CLASS__GPUMEMORY_IPC:
 					if (normal_exit)
@@ -657,6 +711,275 @@ GpuContextWorkerReportError(int elevel,
 		siglongjmp(*GpuWorkerExceptionStack, 1);
 }
 
+/*
+ * pgstromEnqueueGpuTask - push a GpuTask onto the worker queue
+ *
+ * Caller must hold gcontext->mutex. GpuTask shall be queued to the home
+ * worker of its affinity hint (or round-robin if no hint), then idle
+ * workers steal it from the tail if the home worker is busy.
+ */
+void
+pgstromEnqueueGpuTask(GpuContext *gcontext, GpuTask *gtask)
+{
+	GpuContextWorkerQueue *wqueue;
+	cl_uint		index;
+
+	if (gtask->affinity >= 0)
+		index = gtask->affinity % gcontext->num_workers;
+	else
+		index = (pg_atomic_fetch_add_u32(&gcontext->next_queue, 1) %
+				 gcontext->num_workers);
+	wqueue = &gcontext->worker_queues[index];
+
+	if (gtask->gts->tm_stat)
+		INSTR_TIME_SET_CURRENT(gtask->tv_enqueue);
+	pthreadMutexLock(&wqueue->lock);
+	dlist_push_tail(&wqueue->pending_tasks, &gtask->chain);
+	pg_atomic_fetch_add_u32(&gcontext->gc_stat->num_pending_tasks, 1);
+	pg_atomic_fetch_add_u32(&gcontext->num_pending_tasks, 1);
+	pthreadMutexUnlock(&wqueue->lock);
+
+	pthreadCondSignal(gcontext->cond);
+}
+
+/*
+ * pgstromGpuTaskAdmissionDone - leave the waiting state of admission
+ */
+void
+pgstromGpuTaskAdmissionDone(GpuTaskState *gts)
+{
+	GpuContext *gcontext = gts->gcontext;
+	instr_time	tv_now;
+	cl_ulong	wait_us;
+
+	if (!gcontext->sched_waiting)
+		return;
+	INSTR_TIME_SET_CURRENT(tv_now);
+	INSTR_TIME_SUBTRACT(tv_now, gts->queue_wait_start);
+	wait_us = INSTR_TIME_GET_MICROSEC(tv_now);
+	gts->queue_wait_time += (double)wait_us / 1000.0;
+	pg_atomic_fetch_sub_u32(&gcontext->gsched->num_waiters, 1);
+	gcontext->sched_waiting = false;
+}
+
+/*
+ * pgstromGpuTaskAdmission - admission control for a new GpuTask submission
+ *
+ * A GpuTaskState can always run GpuTasks up to its fair share of
+ * pg_strom.global_max_async_tasks, according to pg_strom.gpu_task_weight
+ * of the GpuContexts on the same device. Beyond the share, it can run more
+ * tasks only if the device is not busy and nobody else is waiting for
+ * admission. Time being refused is accumulated to @queue_wait_time.
+ * Caller must hold gcontext->mutex.
+ */
+bool
+pgstromGpuTaskAdmission(GpuTaskState *gts, cl_int local_num_running_tasks)
+{
+	GpuContext *gcontext = gts->gcontext;
+	GpuSchedulerState *gsched = gcontext->gsched;
+	uint32		total_weight = pg_atomic_read_u32(&gsched->total_weight);
+	uint32		global_num_running_tasks
+		= pg_atomic_read_u32(gcontext->global_num_running_tasks);
+	uint32		num_other_waiters;
+	cl_long		fair_share;
+
+	fair_share = ((cl_long)global_max_async_tasks *
+				  (cl_long)gcontext->sched_weight) / Max(total_weight, 1);
+	num_other_waiters = pg_atomic_read_u32(&gsched->num_waiters);
+	if (gcontext->sched_waiting)
+		num_other_waiters--;
+
+	if (local_num_running_tasks < Max(fair_share, 1) ||
+		(global_num_running_tasks < global_max_async_tasks &&
+		 num_other_waiters == 0))
+	{
+		pgstromGpuTaskAdmissionDone(gts);
+		return true;
+	}
+
+	if (!gcontext->sched_waiting)
+	{
+		pg_atomic_fetch_add_u32(&gsched->num_waiters, 1);
+		gcontext->sched_waiting = true;
+		INSTR_TIME_SET_CURRENT(gts->queue_wait_start);
+	}
+	return false;
+}
+
+/*
+ * GpuContextWorkerDequeue - pick up a GpuTask from the own queue first,
+ * or steal from the other worker's queue. NULL, if no pending tasks.
+ */
+static GpuTask *
+GpuContextWorkerDequeue(GpuContext *gcontext)
+{
+	GpuContextWorkerQueue *wqueue;
+	dlist_node *dnode;
+	int			i, nworkers = gcontext->num_workers;
+
+	for (i=0; i < nworkers; i++)
+	{
+		wqueue = &gcontext->worker_queues[(GpuWorkerIndex + i) % nworkers];
+
+		pthreadMutexLock(&wqueue->lock);
+		if (!dlist_is_empty(&wqueue->pending_tasks))
+		{
+			if (i == 0)
+				dnode = dlist_pop_head_node(&wqueue->pending_tasks);
+			else
+			{
+				dnode = dlist_tail_node(&wqueue->pending_tasks);
+				dlist_delete(dnode);
+			}
+			pg_atomic_fetch_sub_u32(&gcontext->num_pending_tasks, 1);
+			pg_atomic_fetch_sub_u32(&gcontext->gc_stat->num_pending_tasks, 1);
+			pthreadMutexUnlock(&wqueue->lock);
+
+			return dlist_container(GpuTask, chain, dnode);
+		}
+		pthreadMutexUnlock(&wqueue->lock);
+	}
+	return NULL;
+}
+
+/*
+ * pgstromDequeueSiblingGpuTask - pick up a pending GpuTask of the same
+ * GpuTaskState and program as @gtask, if @is_sibling accepts it. It allows
+ * a worker to run multiple GpuTasks by a single kernel launch. NULL, if no
+ * siblings are pending.
+ */
+GpuTask *
+pgstromDequeueSiblingGpuTask(GpuTask *gtask,
+							 bool (*is_sibling)(GpuTask *gtask,
+												GpuTask *sibling))
+{
+	GpuContext *gcontext = GpuWorkerCurrentContext;
+	GpuContextWorkerQueue *wqueue;
+	dlist_mutable_iter iter;
+	int			i, nworkers = gcontext->num_workers;
+
+	for (i=0; i < nworkers; i++)
+	{
+		wqueue = &gcontext->worker_queues[(GpuWorkerIndex + i) % nworkers];
+
+		pthreadMutexLock(&wqueue->lock);
+		dlist_foreach_modify(iter, &wqueue->pending_tasks)
+		{
+			GpuTask	   *curr = dlist_container(GpuTask, chain, iter.cur);
+
+			if (curr->gts != gtask->gts ||
+				curr->program_id != gtask->program_id ||
+				(is_sibling && !is_sibling(gtask, curr)))
+				continue;
+			dlist_delete(&curr->chain);
+			pg_atomic_fetch_sub_u32(&gcontext->num_pending_tasks, 1);
+			pg_atomic_fetch_sub_u32(&gcontext->gc_stat->num_pending_tasks, 1);
+			pthreadMutexUnlock(&wqueue->lock);
+
+			if (curr->gts->tm_stat)
+				pgstromTimeStatAddElapsed(curr->gts, GpuTaskPhase_QueueWait,
+										  &curr->tv_enqueue);
+			return curr;
+		}
+		pthreadMutexUnlock(&wqueue->lock);
+	}
+	return NULL;
+}
+
+/*
+ * pgstromCompleteGpuTask - back the GpuTask processed by the worker to
+ * the backend, or release it immediately, according to @retval of the
+ * cb_process_task handler. It raises an error if the GPU kernel completed
+ * with error status.
+ */
+void
+pgstromCompleteGpuTask(GpuTask *gtask, cl_int retval)
+{
+	GpuTaskState *gts = gtask->gts;
+
+	Assert(retval <= 0);
+	if (gtask->kerror.errcode != StromError_Success)
+	{
+		/* GPU kernel completed with error status */
+		werror("GPU kernel error - %s",
+			   errorTextKernel(&gtask->kerror));
+	}
+	else if (retval == 0)
+	{
+		/*
+		 * Back GpuTask to GTS; it may be owned by the other
+		 * GpuContext, if multi-GPU scan.
+		 */
+		pthreadMutexLock(gts->gcontext->mutex);
+		dlist_push_tail(&gts->ready_tasks,
+						&gtask->chain);
+		gts->num_running_tasks--;
+		gts->num_ready_tasks++;
+		pthreadMutexUnlock(gts->gcontext->mutex);
+
+		SetLatch(MyLatch);
+	}
+	else
+	{
+		/*
+		 * Release GpuTask immediately, expect for the last
+		 * GpuTask when retval==-2.
+		 */
+		pthreadMutexLock(gts->gcontext->mutex);
+		if (--gts->num_running_tasks == 0 &&
+			retval == -2 &&
+			gts->scan_done)
+		{
+			wnotice("last one task");
+			dlist_push_tail(&gts->ready_tasks,
+							&gtask->chain);
+			gts->num_ready_tasks++;
+			pthreadMutexUnlock(gts->gcontext->mutex);
+		}
+		else
+		{
+			pthreadMutexUnlock(gts->gcontext->mutex);
+
+			gts->cb_release_task(gtask);
+		}
+		SetLatch(MyLatch);
+	}
+	pg_atomic_fetch_add_u64(&GpuWorkerCurrentContext->gc_stat->num_done_tasks, 1);
+}
+
+/*
+ * init_gpu_context_stat
+ */
+static void
+init_gpu_context_stat(GpuContextStat *gc_stat,
+					  cl_int cuda_dindex, cl_int num_workers)
+{
+	GpuContextMemStat *gm_stat[4];
+	int			i;
+
+	memset(gc_stat, 0, sizeof(GpuContextStat));
+	gc_stat->owner_pid = MyProcPid;
+	gc_stat->cuda_dindex = cuda_dindex;
+	gc_stat->num_workers = num_workers;
+	gc_stat->ctime = GetCurrentTimestamp();
+	pg_atomic_init_u32(&gc_stat->num_pending_tasks, 0);
+	pg_atomic_init_u32(&gc_stat->num_running_tasks, 0);
+	pg_atomic_init_u64(&gc_stat->num_done_tasks, 0);
+	pg_atomic_init_u64(&gc_stat->busy_time, 0);
+	pg_atomic_init_u32(&gc_stat->sm_occupancy, 0);
+	gm_stat[0] = &gc_stat->gm_normal;
+	gm_stat[1] = &gc_stat->gm_iomap;
+	gm_stat[2] = &gc_stat->gm_managed;
+	gm_stat[3] = &gc_stat->gm_hostmem;
+	for (i=0; i < lengthof(gm_stat); i++)
+	{
+		pg_atomic_init_u32(&gm_stat[i]->num_segments, 0);
+		pg_atomic_init_u64(&gm_stat[i]->total_size, 0);
+		pg_atomic_init_u64(&gm_stat[i]->free_size, 0);
+		pg_atomic_init_u64(&gm_stat[i]->largest_free, 0);
+	}
+}
+
 /*
  * GpuContextWorkerMain
  */
@@ -664,11 +987,15 @@ static void *
 GpuContextWorkerMain(void *arg)
 {
 	GpuContext	   *gcontext = arg;
-	dlist_node	   *dnode;
+	GpuContextStat *gc_stat = gcontext->gc_stat;
 	GpuTask		   *gtask;
 	CUresult		rc;
 	uint32			command;
 	bool			is_wakeup;
+	instr_time		tv_start;
+	instr_time		tv_end;
+	instr_time		tv_diff;
+	instr_time		tv_publish;
 
 	/* setup worker index */
 	GpuWorkerIndex = pg_atomic_fetch_add_u32(&gcontext->worker_index, 1);
@@ -683,6 +1010,7 @@ GpuContextWorkerMain(void *arg)
 		return NULL;
 	}
 	GpuWorkerCurrentContext = gcontext;
+	INSTR_TIME_SET_CURRENT(tv_publish);
 
 	STROM_TRY();
 	{
@@ -690,11 +1018,25 @@ GpuContextWorkerMain(void *arg)
 		{
 			GpuTaskState *gts;
 			CUmodule	cuda_module;
+			ProgramId	program_id;
+			int			variant;
+			bool		under_tuning;
 			cl_int		retval;
 
-			pthreadMutexLock(gcontext->mutex);
-			if (dlist_is_empty(&gcontext->pending_tasks))
+			gtask = GpuContextWorkerDequeue(gcontext);
+			if (!gtask)
 			{
+				/*
+				 * NOTE: pgstromEnqueueGpuTask() is called under the
+				 * gcontext->mutex, so no wakeup is lost between the check
+				 * of num_pending_tasks and pthreadCondWaitTimeout().
+				 */
+				pthreadMutexLock(gcontext->mutex);
+				if (pg_atomic_read_u32(&gcontext->num_pending_tasks) > 0)
+				{
+					pthreadMutexUnlock(gcontext->mutex);
+					continue;
+				}
 				is_wakeup = pthreadCondWaitTimeout(gcontext->cond,
 												   gcontext->mutex,
 												   4000);
@@ -712,17 +1054,24 @@ GpuContextWorkerMain(void *arg)
 					 */
 					pthreadCondSignal(gcontext->cond);
 					gpuMemReclaimSegment(gcontext);
+					gpuMemPublishStatistics(gcontext);
 				}
 			}
 			else
 			{
-				dnode = dlist_pop_head_node(&gcontext->pending_tasks);
-				gtask = dlist_container(GpuTask, chain, dnode);
-				pthreadMutexUnlock(gcontext->mutex);
-
 				gts = gtask->gts;
+				if (gts->tm_stat)
+					pgstromTimeStatAddElapsed(gts, GpuTaskPhase_QueueWait,
+											  &gtask->tv_enqueue);
+				/* gtask may be released prior to the tuning feedback */
+				program_id = gtask->program_id;
+				variant = pgstrom_select_cuda_program_variant(program_id,
+															  &under_tuning);
 				cuda_module = GpuContextLookupModule(gcontext,
-													 gtask->program_id);
+													 program_id,
+													 variant);
+				pg_atomic_fetch_add_u32(&gc_stat->num_running_tasks, 1);
+				INSTR_TIME_SET_CURRENT(tv_start);
 				do {
 					/*
 					 * pgstromProcessGpuTask() returns the following status:
@@ -737,58 +1086,40 @@ GpuContextWorkerMain(void *arg)
 					retval = gts->cb_process_task(gtask, cuda_module);
 					if (retval > 0)
 					{
-						/* wait for 40ms */
+						/* wait for 40ms; not a fair sample for tuning */
+						under_tuning = false;
 						pg_usleep(40000L);
 					}
-					else if (gtask->kerror.errcode != StromError_Success)
-					{
-						/* GPU kernel completed with error status */
-						werror("GPU kernel error - %s",
-							   errorTextKernel(&gtask->kerror));
-					}
-					else if (retval == 0)
-					{
-						/* Back GpuTask to GTS */
-						pthreadMutexLock(gcontext->mutex);
-						dlist_push_tail(&gts->ready_tasks,
-										&gtask->chain);
-						gts->num_running_tasks--;
-						gts->num_ready_tasks++;
-						pthreadMutexUnlock(gcontext->mutex);
-
-						SetLatch(MyLatch);
-					}
 					else
-					{
-						/*
-						 * Release GpuTask immediately, expect for the last
-						 * GpuTask when retval==-2.
-						 */
-						pthreadMutexLock(gcontext->mutex);
-						if (--gts->num_running_tasks == 0 &&
-							retval == -2 &&
-							gts->scan_done)
-						{
-							wnotice("last one task");
-							dlist_push_tail(&gts->ready_tasks,
-											&gtask->chain);
-							gts->num_ready_tasks++;
-							pthreadMutexUnlock(gcontext->mutex);
-						}
-						else
-						{
-							pthreadMutexUnlock(gcontext->mutex);
-
-							gts->cb_release_task(gtask);
-						}
-						SetLatch(MyLatch);
-					}
+						pgstromCompleteGpuTask(gtask, retval);
 				} while (retval > 0);
+
+				/* update run-time statistics */
+				INSTR_TIME_SET_CURRENT(tv_end);
+				pg_atomic_fetch_sub_u32(&gc_stat->num_running_tasks, 1);
+				tv_diff = tv_end;
+				INSTR_TIME_SUBTRACT(tv_diff, tv_start);
+				pg_atomic_fetch_add_u64(&gc_stat->busy_time,
+										INSTR_TIME_GET_MICROSEC(tv_diff));
+				if (under_tuning)
+					pgstrom_tune_cuda_program_variant(program_id,
+													  variant,
+									INSTR_TIME_GET_MICROSEC(tv_diff));
+				/* usage of device memory, at most once per second */
+				tv_diff = tv_end;
+				INSTR_TIME_SUBTRACT(tv_diff, tv_publish);
+				if (INSTR_TIME_GET_MILLISEC(tv_diff) >= 1000.0)
+				{
+					gpuMemPublishStatistics(gcontext);
+					tv_publish = tv_end;
+				}
 			}
 		}
 	}
 	STROM_CATCH();
 	{
+		/* P2P DMA in-progress must not write out released buffer */
+		gpuMemCopyFromSSDAbort();
 		/* Wake up and terminate other workers also */
 		pg_atomic_write_u32(&gcontext->terminate_workers, 1);
 		pthreadCondBroadcast(gcontext->cond);
@@ -857,20 +1188,22 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 	 * Not found, so allocate a new one
 	 */
 	gcontext = calloc(1, offsetof(GpuContext, worker_threads[num_workers]) +
-					  2 * sizeof(CUevent) * num_workers);
+					  3 * sizeof(CUevent) * num_workers +
+					  sizeof(GpuContextWorkerQueue) * num_workers);
 	if (!gcontext)
 		elog(ERROR, "out of memory");
 	gcontext->cuda_events0 = (CUevent *)
 		((char *)gcontext + offsetof(GpuContext, worker_threads[num_workers]));
 	gcontext->cuda_events1 = gcontext->cuda_events0 + num_workers;
+	gcontext->cuda_events2 = gcontext->cuda_events1 + num_workers;
+	gcontext->worker_queues = (GpuContextWorkerQueue *)
+		(gcontext->cuda_events2 + num_workers);
 
 	/* choose a device to use, if no preference */
+	if (cuda_dindex < 0 && !never_use_mps)
+		cuda_dindex = cuda_prefetch_device();
 	if (cuda_dindex < 0)
-	{
-		cuda_dindex = (IsParallelWorker()
-					   ? ParallelWorkerNumber
-					   : MyProc->pgprocno) % numDevAttrs;
-	}
+		cuda_dindex = pgstrom_choose_gpu_device(-1);
 
 	/* Pick up IPC stuff */
 	SpinLockAcquire(&gcontext_ipc_head->lock);
@@ -885,6 +1218,7 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 	pthreadMutexInit(&ipc_entry->mutex, 1);
 	pthreadCondInit(&ipc_entry->cond);
 	pg_atomic_init_u32(&ipc_entry->command, 0);
+	init_gpu_context_stat(&ipc_entry->stat, cuda_dindex, num_workers);
 
 	/* setup fields */
 	pg_atomic_init_u32(&gcontext->refcnt, 1);
@@ -909,11 +1243,23 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 	gcontext->worker_is_running = false;
 	gcontext->global_num_running_tasks
 		= &global_num_running_tasks[cuda_dindex];
+	gcontext->gsched = &gpu_scheduler_state[cuda_dindex];
+	gcontext->sched_weight = gpu_task_weight;
+	gcontext->sched_waiting = false;
+	pg_atomic_fetch_add_u32(&gcontext->gsched->total_weight,
+							gcontext->sched_weight);
 	gcontext->mutex		= &ipc_entry->mutex;
 	gcontext->cond		= &ipc_entry->cond;
 	gcontext->command	= &ipc_entry->command;
+	gcontext->gc_stat	= &ipc_entry->stat;
 	pg_atomic_init_u32(&gcontext->terminate_workers, 0);
-	dlist_init(&gcontext->pending_tasks);
+	pg_atomic_init_u32(&gcontext->num_pending_tasks, 0);
+	pg_atomic_init_u32(&gcontext->next_queue, 0);
+	for (i=0; i < num_workers; i++)
+	{
+		pthreadMutexInit(&gcontext->worker_queues[i].lock, 0);
+		dlist_init(&gcontext->worker_queues[i].pending_tasks);
+	}
 	gcontext->num_workers = num_workers;
 	pg_atomic_init_u32(&gcontext->worker_index, 0);
 	for (i=0; i < num_workers; i++)
@@ -931,6 +1277,205 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 	return gcontext;
 }
 
+/*
+ * cuda_prefetch_thread_main - main loop of the helper thread
+ */
+static void *
+cuda_prefetch_thread_main(void *__arg)
+{
+	sigset_t	sigmask;
+
+	/* signals shall be handled by the main thread */
+	sigfillset(&sigmask);
+	pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+	pthread_mutex_lock(&cuda_prefetch_lock);
+	for (;;)
+	{
+		if (cuda_prefetch_ndestroy > 0)
+		{
+			CUcontext	cuda_context
+				= cuda_prefetch_destroy[--cuda_prefetch_ndestroy];
+
+			pthread_mutex_unlock(&cuda_prefetch_lock);
+			cuCtxDestroy(cuda_context);
+			pthread_mutex_lock(&cuda_prefetch_lock);
+		}
+		else if (cuda_prefetch_request >= 0 && !cuda_prefetch_spare &&
+				 !cuda_prefetch_terminate)
+		{
+			int			cuda_dindex = cuda_prefetch_request;
+			CUdevice	cuda_device;
+			CUcontext	cuda_context = NULL;
+			CUresult	rc;
+
+			cuda_prefetch_request = -1;
+			cuda_prefetch_inprogress = cuda_dindex;
+			pthread_mutex_unlock(&cuda_prefetch_lock);
+
+			rc = cuInit(0);
+			if (rc == CUDA_SUCCESS)
+				rc = cuDeviceGet(&cuda_device, devAttrs[cuda_dindex].DEV_ID);
+			if (rc == CUDA_SUCCESS)
+				rc = cuCtxCreate(&cuda_context,
+								 CU_CTX_SCHED_AUTO,
+								 cuda_device);
+			/* must not be current on the helper thread */
+			if (rc == CUDA_SUCCESS &&
+				(rc = cuCtxPopCurrent(NULL)) != CUDA_SUCCESS)
+				cuCtxDestroy(cuda_context);
+
+			pthread_mutex_lock(&cuda_prefetch_lock);
+			if (rc == CUDA_SUCCESS)
+			{
+				cuda_prefetch_spare = cuda_context;
+				cuda_prefetch_spare_dindex = cuda_dindex;
+			}
+			cuda_prefetch_inprogress = -1;
+			pthread_cond_broadcast(&cuda_prefetch_cond);
+		}
+		else
+		{
+			pthread_cond_broadcast(&cuda_prefetch_cond);
+			pthread_cond_wait(&cuda_prefetch_cond, &cuda_prefetch_lock);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * cuda_prefetch_kick - requires the helper thread to prefetch a spare CUDA
+ * context on the supplied device; to be called by only backend
+ */
+static void
+cuda_prefetch_kick(int cuda_dindex)
+{
+	if (!cuda_context_prefetch || cuda_dindex < 0)
+		return;
+	if (!cuda_prefetch_thread_running)
+	{
+		pthread_t	thread;
+
+		if ((errno = pthread_create(&thread, NULL,
+									cuda_prefetch_thread_main,
+									NULL)) != 0)
+		{
+			elog(LOG, "failed on pthread_create: %m");
+			return;
+		}
+		pthread_detach(thread);
+		cuda_prefetch_thread_running = true;
+	}
+	pthreadMutexLock(&cuda_prefetch_lock);
+	if (cuda_prefetch_spare_dindex != cuda_dindex &&
+		cuda_prefetch_inprogress != cuda_dindex)
+	{
+		/* spare context on the different device is no longer needed */
+		if (cuda_prefetch_spare &&
+			cuda_prefetch_ndestroy < CUDA_PREFETCH_MAX_DESTROY)
+		{
+			cuda_prefetch_destroy[cuda_prefetch_ndestroy++]
+				= cuda_prefetch_spare;
+			cuda_prefetch_spare = NULL;
+			cuda_prefetch_spare_dindex = -1;
+		}
+		cuda_prefetch_request = cuda_dindex;
+		pthreadCondBroadcast(&cuda_prefetch_cond);
+	}
+	pthreadMutexUnlock(&cuda_prefetch_lock);
+}
+
+/*
+ * cuda_prefetch_adopt - adopts the spare CUDA context on the device, if any.
+ * It waits for completion of the prefetch in-progress on the same device,
+ * because it is always faster than creation of another one.
+ */
+static CUcontext
+cuda_prefetch_adopt(int cuda_dindex)
+{
+	CUcontext	cuda_context = NULL;
+
+	if (!cuda_prefetch_thread_running)
+		return NULL;
+	pthreadMutexLock(&cuda_prefetch_lock);
+	while (cuda_prefetch_inprogress == cuda_dindex ||
+		   (cuda_prefetch_request == cuda_dindex && !cuda_prefetch_spare))
+		pthreadCondWait(&cuda_prefetch_cond, &cuda_prefetch_lock);
+	if (cuda_prefetch_spare && cuda_prefetch_spare_dindex == cuda_dindex)
+	{
+		cuda_context = cuda_prefetch_spare;
+		cuda_prefetch_spare = NULL;
+		cuda_prefetch_spare_dindex = -1;
+	}
+	pthreadMutexUnlock(&cuda_prefetch_lock);
+
+	return cuda_context;
+}
+
+/*
+ * cuda_prefetch_device - returns the device where the spare CUDA context is
+ * available (or in-progress), or -1
+ */
+static int
+cuda_prefetch_device(void)
+{
+	int			cuda_dindex = -1;
+
+	if (!cuda_prefetch_thread_running)
+		return -1;
+	pthreadMutexLock(&cuda_prefetch_lock);
+	if (cuda_prefetch_spare)
+		cuda_dindex = cuda_prefetch_spare_dindex;
+	else if (cuda_prefetch_inprogress >= 0)
+		cuda_dindex = cuda_prefetch_inprogress;
+	else if (cuda_prefetch_request >= 0)
+		cuda_dindex = cuda_prefetch_request;
+	pthreadMutexUnlock(&cuda_prefetch_lock);
+
+	return cuda_dindex;
+}
+
+/*
+ * cuda_destroy_context - destroys the CUDA context by the helper thread,
+ * or synchronously if not available.
+ */
+static void
+cuda_destroy_context(CUcontext cuda_context)
+{
+	CUresult	rc;
+
+	if (cuda_prefetch_thread_running)
+	{
+		bool	queued = false;
+
+		pthreadMutexLock(&cuda_prefetch_lock);
+		if (cuda_prefetch_ndestroy < CUDA_PREFETCH_MAX_DESTROY)
+		{
+			cuda_prefetch_destroy[cuda_prefetch_ndestroy++] = cuda_context;
+			pthreadCondBroadcast(&cuda_prefetch_cond);
+			queued = true;
+		}
+		pthreadMutexUnlock(&cuda_prefetch_lock);
+		if (queued)
+			return;
+	}
+	rc = cuCtxDestroy(cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "Failed on cuCtxDestroy: %s", errorText(rc));
+}
+
+/*
+ * pgstrom_client_auth_prefetch - prefetch a CUDA context on session start-up
+ */
+static void
+pgstrom_client_auth_prefetch(Port *port, int status)
+{
+	if (client_auth_next)
+		(*client_auth_next)(port, status);
+	if (status == STATUS_OK && numDevAttrs > 0)
+		cuda_prefetch_kick(pgstrom_choose_gpu_device(-1));
+}
+
 /*
  * create_cuda_context - create a CUDA context on a proper device
  */
@@ -952,6 +1497,8 @@ create_cuda_context(GpuContext *gcontext,
 
 	if (gcontext->never_use_mps)
 		rc = CUDA_ERROR_OUT_OF_MEMORY;
+	else if ((cuda_context = cuda_prefetch_adopt(cuda_dindex)) != NULL)
+		rc = CUDA_SUCCESS;
 	else
 		rc = cuCtxCreate(&cuda_context,
 						 CU_CTX_SCHED_AUTO,
@@ -1006,6 +1553,11 @@ ActivateGpuContext(GpuContext *gcontext)
 							   CU_EVENT_BLOCKING_SYNC);
 			if (rc != CUDA_SUCCESS)
 				elog(ERROR, "failed on cuEventCreate: %s", errorText(rc));
+
+			rc = cuEventCreate(&gcontext->cuda_events2[i],
+							   CU_EVENT_BLOCKING_SYNC);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuEventCreate: %s", errorText(rc));
 		}
 
 		/* creation of worker threads */
@@ -1238,6 +1790,20 @@ gpucontext_cleanup_callback(ResourceReleasePhase phase,
 static void
 gpucontext_shmem_exit_cleanup(int code, Datum arg)
 {
+	/*
+	 * The helper thread must not run any CUDA API during process exit,
+	 * so we wait for completion of the prefetch and destroy in-progress.
+	 */
+	if (cuda_prefetch_thread_running)
+	{
+		pthread_mutex_lock(&cuda_prefetch_lock);
+		cuda_prefetch_terminate = true;
+		pthread_cond_broadcast(&cuda_prefetch_cond);
+		while (cuda_prefetch_inprogress >= 0 || cuda_prefetch_ndestroy > 0)
+			pthread_cond_wait(&cuda_prefetch_cond, &cuda_prefetch_lock);
+		pthread_mutex_unlock(&cuda_prefetch_lock);
+	}
+
 	while (!dlist_is_empty(&activeGpuContextList))
 	{
 		dlist_node *dnode = dlist_pop_head_node(&activeGpuContextList);
@@ -1266,6 +1832,199 @@ gpucontext_shmem_exit_cleanup(int code, Datum arg)
 	}
 }
 
+/*
+ * collect_gpu_context_stat - copy the statistics of the active GpuContexts
+ */
+static List *
+collect_gpu_context_stat(void)
+{
+	List	   *results = NIL;
+	dlist_iter	iter;
+	int			i;
+
+	PG_TRY();
+	{
+		SpinLockAcquire(&gcontext_ipc_head->lock);
+		for (i=0; i < numDevAttrs; i++)
+		{
+			dlist_foreach(iter, &gcontext_ipc_head->active_list[i])
+			{
+				GpuContextIPCEntry *ipc_entry = (GpuContextIPCEntry *)
+					dlist_container(GpuContextIPCEntry, chain, iter.cur);
+				GpuContextStat *lcopy = palloc(sizeof(GpuContextStat));
+
+				memcpy(lcopy, &ipc_entry->stat, sizeof(GpuContextStat));
+				results = lappend(results, lcopy);
+			}
+		}
+	}
+	PG_CATCH();
+	{
+		SpinLockRelease(&gcontext_ipc_head->lock);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	SpinLockRelease(&gcontext_ipc_head->lock);
+
+	return results;
+}
+
+/*
+ * pgstrom_gpu_context_info - SQL function to dump active GpuContexts
+ */
+Datum
+pgstrom_gpu_context_info(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	GpuContextStat *gc_stat;
+	List	   *stat_list;
+	Datum		values[10];
+	bool		isnull[10];
+	HeapTuple	tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(10, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  1, "pid",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  2, "device_nr",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  3, "num_workers",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  4, "ctime",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  5, "pending_tasks",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  6, "running_tasks",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  7, "done_tasks",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  8, "busy_time",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  9, "sm_occupancy",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "device_memory",
+						   INT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		fncxt->user_fctx = collect_gpu_context_stat();
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	stat_list = (List *)fncxt->user_fctx;
+
+	if (stat_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	gc_stat = linitial(stat_list);
+	fncxt->user_fctx = list_delete_first(stat_list);
+
+	memset(isnull, 0, sizeof(isnull));
+	Assert(gc_stat->cuda_dindex >= 0 &&
+		   gc_stat->cuda_dindex < numDevAttrs);
+	values[0] = Int32GetDatum(gc_stat->owner_pid);
+	values[1] = Int32GetDatum(devAttrs[gc_stat->cuda_dindex].DEV_ID);
+	values[2] = Int32GetDatum(gc_stat->num_workers);
+	values[3] = TimestampTzGetDatum(gc_stat->ctime);
+	values[4] = Int32GetDatum(pg_atomic_read_u32(&gc_stat->num_pending_tasks));
+	values[5] = Int32GetDatum(pg_atomic_read_u32(&gc_stat->num_running_tasks));
+	values[6] = Int64GetDatum(pg_atomic_read_u64(&gc_stat->num_done_tasks));
+	values[7] = Float8GetDatum((double)
+							   pg_atomic_read_u64(&gc_stat->busy_time) / 1000.0);
+	values[8] = Float8GetDatum((double)
+							   pg_atomic_read_u32(&gc_stat->sm_occupancy) / 1000.0);
+	values[9] = Int64GetDatum(pg_atomic_read_u64(&gc_stat->gm_normal.total_size) +
+							  pg_atomic_read_u64(&gc_stat->gm_iomap.total_size));
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_context_info);
+
+/*
+ * pgstrom_gpu_context_meminfo - SQL function to dump memory segments usage
+ * of the active GpuContexts
+ */
+Datum
+pgstrom_gpu_context_meminfo(PG_FUNCTION_ARGS)
+{
+	static const char *gm_kind_names[] = {
+		"normal", "iomap", "managed", "hostmem"
+	};
+	FuncCallContext *fncxt;
+	GpuContextStat *gc_stat;
+	GpuContextMemStat *gm_stat;
+	List	   *stat_list;
+	int			gm_kind;
+	Datum		values[7];
+	bool		isnull[7];
+	HeapTuple	tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(7, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "pid",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "device_nr",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "kind",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "segments",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "total_size",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "free_size",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "largest_free",
+						   INT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		fncxt->user_fctx = collect_gpu_context_stat();
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	stat_list = (List *)fncxt->user_fctx;
+
+	/* 4 rows for each GpuContext */
+	gm_kind = fncxt->call_cntr % lengthof(gm_kind_names);
+	if (stat_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	gc_stat = linitial(stat_list);
+	if (gm_kind == lengthof(gm_kind_names) - 1)
+		fncxt->user_fctx = list_delete_first(stat_list);
+	switch (gm_kind)
+	{
+		case 0:  gm_stat = &gc_stat->gm_normal;  break;
+		case 1:  gm_stat = &gc_stat->gm_iomap;   break;
+		case 2:  gm_stat = &gc_stat->gm_managed; break;
+		default: gm_stat = &gc_stat->gm_hostmem; break;
+	}
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int32GetDatum(gc_stat->owner_pid);
+	values[1] = Int32GetDatum(devAttrs[gc_stat->cuda_dindex].DEV_ID);
+	values[2] = CStringGetTextDatum(gm_kind_names[gm_kind]);
+	values[3] = Int32GetDatum(pg_atomic_read_u32(&gm_stat->num_segments));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&gm_stat->total_size));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&gm_stat->free_size));
+	values[6] = Int64GetDatum(pg_atomic_read_u64(&gm_stat->largest_free));
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_context_meminfo);
+
 /*
  * pgstrom_startup_gpu_context
  */
@@ -1287,6 +2046,18 @@ pgstrom_startup_gpu_context(void)
 	for (i=0; i < numDevAttrs; i++)
 		pg_atomic_init_u32(&global_num_running_tasks[i], 0);
 
+	gpu_scheduler_state =
+		ShmemInitStruct("GPU task scheduler state",
+						sizeof(GpuSchedulerState) * numDevAttrs,
+						&found);
+	if (found)
+		elog(ERROR, "Bug? GPU task scheduler state exists");
+	for (i=0; i < numDevAttrs; i++)
+	{
+		pg_atomic_init_u32(&gpu_scheduler_state[i].total_weight, 0);
+		pg_atomic_init_u32(&gpu_scheduler_state[i].num_waiters, 0);
+	}
+
 	gcontext_ipc_head =
 		ShmemInitStruct("IPC stuff for GpuContex",
 						MAXALIGN(offsetof(GpuContextIPCHead,
@@ -1342,6 +2113,17 @@ pgstrom_init_gpu_context(void)
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
 
+	DefineCustomIntVariable("pg_strom.gpu_task_weight",
+			"Weight of the session for the fair share of GPU tasks",
+							NULL,
+							&gpu_task_weight,
+							100,
+							1,
+							10000,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
 	max_nprocs = MaxConnections + max_worker_processes;
 	DefineCustomIntVariable("pg_strom.max_number_of_gpucontext",
 							"Max number of GpuContext available at same time",
@@ -1354,12 +2136,22 @@ pgstrom_init_gpu_context(void)
 							GUC_NOT_IN_SAMPLE | GUC_NO_SHOW_ALL,
 							NULL, NULL, NULL);
 
+	DefineCustomBoolVariable("pg_strom.cuda_context_prefetch",
+							 "Enables to prefetch CUDA context in background",
+							 NULL,
+							 &cuda_context_prefetch,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/* initialization of GpuContext List */
 	SpinLockInit(&activeGpuContextLock);
 	dlist_init(&activeGpuContextList);
 
 	/* shared memory */
 	RequestAddinShmemSpace(MAXALIGN(sizeof(pg_atomic_uint32) * numDevAttrs) +
+						   MAXALIGN(sizeof(GpuSchedulerState) * numDevAttrs) +
 						   MAXALIGN(offsetof(GpuContextIPCHead,
 											ipc_entries[max_num_gpucontext])) +
 						   MAXALIGN(sizeof(dlist_head) * numDevAttrs));
@@ -1368,5 +2160,8 @@ pgstrom_init_gpu_context(void)
 
 	/* register the callback to clean up resources */
 	RegisterResourceReleaseCallback(gpucontext_cleanup_callback, NULL);
+	/* prefetch of CUDA context on session start-up */
+	client_auth_next = ClientAuthentication_hook;
+	ClientAuthentication_hook = pgstrom_client_auth_prefetch;
 	before_shmem_exit(gpucontext_shmem_exit_cleanup, 0);
 }
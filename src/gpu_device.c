@@ -22,6 +22,9 @@ DevAttributes	   *devAttrs = NULL;
 cl_int				numDevAttrs = 0;
 cl_ulong			devComputeCapability = UINT_MAX;
 cl_uint				devBaselineMaxThreadsPerBlock = UINT_MAX;
+static bool			gpu_cost_calibration;	/* GUC */
+static cl_int	   *cpu_numa_node_map = NULL;	/* CPU-id -> NUMA node */
+static cl_int		num_cpu_numa_node_map = 0;
 
 /* catalog of device attributes */
 typedef enum {
@@ -63,6 +66,135 @@ Datum pgstrom_gpu_cc_major(PG_FUNCTION_ARGS);
 Datum pgstrom_gpu_cc_minor(PG_FUNCTION_ARGS);
 Datum pgstrom_gpu_pci_id(PG_FUNCTION_ARGS);
 
+/*
+ * pgstrom_collect_numa_topology
+ *
+ * It builds a map from CPU-id to NUMA node-id according to the sysfs,
+ * to determine the NUMA node where the current backend is running on.
+ */
+static void
+pgstrom_collect_numa_topology(void)
+{
+	char		pathname[MAXPGPATH];
+	char		linebuf[2048];
+	FILE	   *filp;
+	int			ncpus = sysconf(_SC_NPROCESSORS_CONF);
+	int			node;
+
+	if (ncpus <= 0)
+		return;
+	cpu_numa_node_map = MemoryContextAlloc(TopMemoryContext,
+										   sizeof(cl_int) * ncpus);
+	memset(cpu_numa_node_map, -1, sizeof(cl_int) * ncpus);
+	num_cpu_numa_node_map = ncpus;
+
+	for (node=0; ; node++)
+	{
+		char   *tok, *saveptr;
+
+		snprintf(pathname, sizeof(pathname),
+				 "/sys/devices/system/node/node%d/cpulist", node);
+		filp = AllocateFile(pathname, "r");
+		if (!filp)
+			break;		/* no more NUMA nodes */
+		if (fgets(linebuf, sizeof(linebuf), filp) != NULL)
+		{
+			/* cpulist is a comma separated list of ranges; like 0-7,16-23 */
+			for (tok = strtok_r(linebuf, ",\n", &saveptr);
+				 tok != NULL;
+				 tok = strtok_r(NULL, ",\n", &saveptr))
+			{
+				int		lo, hi, k;
+
+				if (sscanf(tok, "%d-%d", &lo, &hi) != 2)
+				{
+					lo = hi = atoi(tok);
+				}
+				for (k=Max(lo,0); k <= hi && k < ncpus; k++)
+					cpu_numa_node_map[k] = node;
+			}
+		}
+		FreeFile(filp);
+	}
+}
+
+/*
+ * pgstrom_device_numa_node
+ *
+ * It returns NUMA node-id where the PCIe device is installed, or -1 if
+ * unknown (e.g, UMA system).
+ */
+static int
+pgstrom_device_numa_node(DevAttributes *dattrs)
+{
+	char		pathname[MAXPGPATH];
+	char		linebuf[80];
+	FILE	   *filp;
+	int			numa_node_id = -1;
+
+	snprintf(pathname, sizeof(pathname),
+			 "/sys/bus/pci/devices/%04x:%02x:%02x.0/numa_node",
+			 dattrs->PCI_DOMAIN_ID,
+			 dattrs->PCI_BUS_ID,
+			 dattrs->PCI_DEVICE_ID);
+	filp = AllocateFile(pathname, "r");
+	if (filp)
+	{
+		if (fgets(linebuf, sizeof(linebuf), filp) != NULL)
+			numa_node_id = atoi(linebuf);
+		FreeFile(filp);
+	}
+	return (numa_node_id >= 0 ? numa_node_id : -1);
+}
+
+/*
+ * pgstrom_choose_gpu_device
+ *
+ * It chooses a GPU device installed on the supplied NUMA node, or the node
+ * where the current process is running on if -1 is given. Parallel workers
+ * and concurrent backends are distributed over the GPUs on the same node
+ * in round-robin; if no GPUs are local, any GPU devices are candidates.
+ */
+int
+pgstrom_choose_gpu_device(int numa_node_id)
+{
+	int		hint = (IsParallelWorker()
+					? ParallelWorkerNumber
+					: MyProc->pgprocno);
+	int		count = 0;
+	int		i;
+
+	Assert(numDevAttrs > 0);
+	if (numa_node_id < 0 && cpu_numa_node_map)
+	{
+		int		cpu_id = sched_getcpu();
+
+		if (cpu_id >= 0 && cpu_id < num_cpu_numa_node_map)
+			numa_node_id = cpu_numa_node_map[cpu_id];
+	}
+
+	if (numa_node_id >= 0)
+	{
+		for (i=0; i < numDevAttrs; i++)
+		{
+			if (devAttrs[i].NUMA_NODE_ID == numa_node_id)
+				count++;
+		}
+		if (count > 0)
+		{
+			hint %= count;
+			for (i=0; i < numDevAttrs; i++)
+			{
+				if (devAttrs[i].NUMA_NODE_ID != numa_node_id)
+					continue;
+				if (hint-- == 0)
+					return i;
+			}
+		}
+	}
+	return hint % numDevAttrs;
+}
+
 /*
  * pgstrom_collect_gpu_device
  */
@@ -83,7 +215,8 @@ pgstrom_collect_gpu_device(void)
 
 	initStringInfo(&str);
 
-	cmdline = psprintf("%s -md", CMD_GPUINFO_PATH);
+	cmdline = psprintf("%s -md%s", CMD_GPUINFO_PATH,
+					   gpu_cost_calibration ? "c" : "");
 	filp = OpenPipeStream(cmdline, PG_BINARY_R);
 
 	while (fgets(linebuf, sizeof(linebuf), filp) != NULL)
@@ -157,6 +290,10 @@ pgstrom_collect_gpu_device(void)
 			}
 			else if (strcmp(tok_attr, "GLOBAL_MEMORY_SIZE") == 0)
 				devAttrs[dindex].DEV_TOTAL_MEMSZ = atol(tok_val);
+			else if (strcmp(tok_attr, "CALIB_DMA_BANDWIDTH") == 0)
+				devAttrs[dindex].DEV_DMA_BANDWIDTH = atoi(tok_val);
+			else if (strcmp(tok_attr, "CALIB_LAUNCH_LATENCY") == 0)
+				devAttrs[dindex].DEV_LAUNCH_LATENCY = atoi(tok_val);
 #include "device_attrs.h"
 			else
 				elog(ERROR, "incorrect gpuinfo -md format");
@@ -167,6 +304,8 @@ pgstrom_collect_gpu_device(void)
 	}
 	ClosePipeStream(filp);
 
+	pgstrom_collect_numa_topology();
+
 	for (i=0, j=0; i < num_devices; i++)
 	{
 		DevAttributes  *dattrs = &devAttrs[i];
@@ -191,6 +330,9 @@ pgstrom_collect_gpu_device(void)
 		devBaselineMaxThreadsPerBlock = Min(devBaselineMaxThreadsPerBlock,
 											dattrs->MAX_THREADS_PER_BLOCK);
 
+		/* NUMA node where the device is installed */
+		dattrs->NUMA_NODE_ID = pgstrom_device_numa_node(dattrs);
+
 		/* Determine CORES_PER_MPU by CC */
 		if (dattrs->COMPUTE_CAPABILITY_MAJOR == 1)
 			dattrs->CORES_PER_MPU = 8;
@@ -252,6 +394,12 @@ pgstrom_collect_gpu_device(void)
 		appendStringInfo(&str, ", CC %d.%d",
 						 dattrs->COMPUTE_CAPABILITY_MAJOR,
 						 dattrs->COMPUTE_CAPABILITY_MINOR);
+		if (dattrs->DEV_DMA_BANDWIDTH > 0)
+			appendStringInfo(&str, ", DMA %.2fGB/s, launch %.1fus",
+							 (double)dattrs->DEV_DMA_BANDWIDTH / 1000.0,
+							 (double)dattrs->DEV_LAUNCH_LATENCY / 1000.0);
+		if (dattrs->NUMA_NODE_ID >= 0)
+			appendStringInfo(&str, ", NUMA node %d", dattrs->NUMA_NODE_ID);
 		elog(LOG, "PG-Strom: %s", str.data);
 
 		if (i != j)
@@ -290,10 +438,75 @@ pgstrom_init_gpu_device(void)
 		if (setenv("CUDA_VISIBLE_DEVICES", cuda_visible_devices, 1) != 0)
 			elog(ERROR, "failed to set CUDA_VISIBLE_DEVICES");
 	}
+	DefineCustomBoolVariable("pg_strom.gpu_cost_calibration",
+							 "Calibrates GPU cost factors on startup",
+							 NULL,
+							 &gpu_cost_calibration,
+							 true,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* collect device properties by gpuinfo command */
 	pgstrom_collect_gpu_device();
 }
 
+/*
+ * pgstrom_calibrate_gpu_cost
+ *
+ * It adjusts the default GPU cost factors, given by the caller, according
+ * to the hardware actually installed. gpu_operator_cost is scaled by the
+ * computing throughput estimated from the device properties, and
+ * gpu_dma_cost is scaled by the time to send a chunk and launch a kernel,
+ * measured by gpuinfo -c. If multiple GPUs are installed, we use their
+ * average because planner does not know which GPU runs the query.
+ */
+void
+pgstrom_calibrate_gpu_cost(Size chunk_size,
+						   double *p_gpu_dma_cost,
+						   double *p_gpu_operator_cost)
+{
+	double		throughput = 0.0;
+	double		dma_time = 0.0;
+	double		ref_time;
+	int			dma_count = 0;
+	int			i;
+
+	if (numDevAttrs == 0)
+		return;
+	for (i=0; i < numDevAttrs; i++)
+	{
+		DevAttributes *dattrs = &devAttrs[i];
+		int		cores_per_mpu = (dattrs->CORES_PER_MPU > 0
+								 ? dattrs->CORES_PER_MPU : 64);
+
+		throughput += ((double)(cores_per_mpu *
+								dattrs->MULTIPROCESSOR_COUNT) *
+					   (double)dattrs->CLOCK_RATE);
+		if (dattrs->DEV_DMA_BANDWIDTH > 0 &&
+			dattrs->DEV_LAUNCH_LATENCY > 0)
+		{
+			dma_time += ((double)chunk_size /
+						 (double)dattrs->DEV_DMA_BANDWIDTH +
+						 (double)dattrs->DEV_LAUNCH_LATENCY / 1000.0);
+			dma_count++;
+		}
+	}
+	throughput /= (double)numDevAttrs;
+	if (throughput > 0.0)
+		*p_gpu_operator_cost *= GPU_COST_REFERENCE_THROUGHPUT / throughput;
+
+	if (dma_count > 0)
+	{
+		/* both in microseconds */
+		dma_time /= (double)dma_count;
+		ref_time = ((double)chunk_size / GPU_COST_REFERENCE_DMA_BANDWIDTH +
+					GPU_COST_REFERENCE_LAUNCH_LATENCY / 1000.0);
+		*p_gpu_dma_cost *= dma_time / ref_time;
+	}
+	elog(LOG, "PG-Strom: calibrated GPU cost (gpu_dma_cost=%.2f, gpu_operator_cost=%.6f)",
+		 *p_gpu_dma_cost, *p_gpu_operator_cost);
+}
+
 /*
  * optimal_workgroup_size - calculates the optimal block size
  * according to the function and device attributes
@@ -388,6 +601,30 @@ largest_workgroup_size(size_t *p_grid_size,
 	*p_grid_size = (nitems + maxBlockSize - 1) / maxBlockSize;
 }
 
+/*
+ * Per worker-thread cache of the occupancy calculation
+ *
+ * GPU tasks of the same kind launch same kernel functions with same shared
+ * memory configuration for each chunk, so we don't need to ask the driver
+ * for the occupancy every time. Worker threads live only during the owner
+ * GpuContext, and CUmodule is never unloaded during the period, thus the
+ * cached CUfunction never gets invalid.
+ */
+#define OPTIMAL_BLOCKSIZE_CACHE_NSLOTS		32
+
+typedef struct
+{
+	CUfunction	kern_function;
+	size_t		dynamic_shmem_per_block;
+	size_t		dynamic_shmem_per_thread;
+	int			min_grid_sz;
+	int			opt_grid_sz;	/* -1, if not computed yet */
+	int			block_sz;
+} OptimalBlockSizeCache;
+
+static __thread OptimalBlockSizeCache
+	optimal_blocksize_cache[OPTIMAL_BLOCKSIZE_CACHE_NSLOTS];
+
 /*
  * gpuOptimalBlockSize - a simple wrapper of cuOccupancyMaxPotentialBlockSize
  */
@@ -399,12 +636,28 @@ gpuOptimalBlockSize(size_t *p_grid_sz,
 					size_t dynamic_shmem_per_block,
 					size_t dynamic_shmem_per_thread)
 {
+	OptimalBlockSizeCache *entry = NULL;
 	int		min_grid_sz;
 	int		opt_grid_sz;
 	int		max_grid_sz;
 	int		block_sz;
 	CUresult rc;
 
+	/* only worker threads can use the cache */
+	if (GpuWorkerCurrentContext)
+	{
+		entry = &optimal_blocksize_cache[((uintptr_t)kern_function >> 4) %
+										 OPTIMAL_BLOCKSIZE_CACHE_NSLOTS];
+		if (entry->kern_function == kern_function &&
+			entry->dynamic_shmem_per_block == dynamic_shmem_per_block &&
+			entry->dynamic_shmem_per_thread == dynamic_shmem_per_thread)
+		{
+			min_grid_sz = entry->min_grid_sz;
+			block_sz = entry->block_sz;
+			goto found;
+		}
+	}
+
 	__dynamic_shmem_per_block = dynamic_shmem_per_block;
 	__dynamic_shmem_per_thread = dynamic_shmem_per_thread;
 	rc = cuOccupancyMaxPotentialBlockSize(&min_grid_sz,
@@ -415,19 +668,48 @@ gpuOptimalBlockSize(size_t *p_grid_sz,
 										  0);
 	if (rc != CUDA_SUCCESS)
 		return rc;
+	if (entry)
+	{
+		entry->kern_function = kern_function;
+		entry->dynamic_shmem_per_block = dynamic_shmem_per_block;
+		entry->dynamic_shmem_per_thread = dynamic_shmem_per_thread;
+		entry->min_grid_sz = min_grid_sz;
+		entry->opt_grid_sz = -1;
+		entry->block_sz = block_sz;
+	}
+found:
 	if (p_grid_sz)
 	{
-		size_t		dyn_shmem_sz = (dynamic_shmem_per_block +
+		if (entry && entry->opt_grid_sz >= 0)
+			opt_grid_sz = entry->opt_grid_sz;
+		else
+		{
+			size_t	dyn_shmem_sz = (dynamic_shmem_per_block +
 									dynamic_shmem_per_thread * block_sz);
-		rc = cuOccupancyMaxActiveBlocksPerMultiprocessor(&opt_grid_sz,
-														 kern_function,
-														 block_sz,
-														 dyn_shmem_sz);
-		if (rc != CUDA_SUCCESS)
-			return rc;
-
+			rc = cuOccupancyMaxActiveBlocksPerMultiprocessor(&opt_grid_sz,
+															 kern_function,
+															 block_sz,
+															 dyn_shmem_sz);
+			if (rc != CUDA_SUCCESS)
+				return rc;
+			if (entry)
+				entry->opt_grid_sz = opt_grid_sz;
+		}
 		max_grid_sz = (max_num_threads + block_sz - 1) / block_sz;
 		*p_grid_sz = Max(min_grid_sz, Min(max_grid_sz, opt_grid_sz));
+
+		/* theoretical SM occupancy of the kernel to be launched */
+		if (GpuWorkerCurrentContext)
+		{
+			DevAttributes *dattrs = &devAttrs[CU_DINDEX_PER_THREAD];
+			size_t	nthreads = Min(*p_grid_sz, (size_t)opt_grid_sz *
+								   dattrs->MULTIPROCESSOR_COUNT) * block_sz;
+			size_t	max_nthreads = ((size_t)dattrs->MULTIPROCESSOR_COUNT *
+									dattrs->MAX_THREADS_PER_MULTIPROCESSOR);
+
+			pg_atomic_write_u32(&GpuWorkerCurrentContext->gc_stat->sm_occupancy,
+								Min(1000 * nthreads / max_nthreads, 1000));
+		}
 	}
 	*p_block_sz = block_sz;
 
@@ -475,8 +757,8 @@ pgstrom_device_info(PG_FUNCTION_ARGS)
 	}
 	fncxt = SRF_PERCALL_SETUP();
 
-	dindex = fncxt->call_cntr / (lengthof(DevAttrCatalog) + 2);
-	aindex = fncxt->call_cntr % (lengthof(DevAttrCatalog) + 2);
+	dindex = fncxt->call_cntr / (lengthof(DevAttrCatalog) + 5);
+	aindex = fncxt->call_cntr % (lengthof(DevAttrCatalog) + 5);
 
 	if (dindex >= numDevAttrs)
 		SRF_RETURN_DONE(fncxt);
@@ -492,9 +774,32 @@ pgstrom_device_info(PG_FUNCTION_ARGS)
 		att_name = "GPU Total RAM Size";
 		att_value = format_bytesz(dattrs->DEV_TOTAL_MEMSZ);
 	}
+	else if (aindex == 2)
+	{
+		att_name = "Calibrated DMA bandwidth";
+		att_value = (dattrs->DEV_DMA_BANDWIDTH > 0
+					 ? psprintf("%.2f GB/s",
+								(double)dattrs->DEV_DMA_BANDWIDTH / 1000.0)
+					 : "unknown");
+	}
+	else if (aindex == 3)
+	{
+		att_name = "Calibrated kernel launch latency";
+		att_value = (dattrs->DEV_LAUNCH_LATENCY > 0
+					 ? psprintf("%.1f us",
+								(double)dattrs->DEV_LAUNCH_LATENCY / 1000.0)
+					 : "unknown");
+	}
+	else if (aindex == 4)
+	{
+		att_name = "NUMA node of the device";
+		att_value = (dattrs->NUMA_NODE_ID >= 0
+					 ? psprintf("%d", dattrs->NUMA_NODE_ID)
+					 : "unknown");
+	}
 	else
 	{
-		int		i = aindex - 2;
+		int		i = aindex - 5;
 		int		value = *((int *)((char *)dattrs +
 								  DevAttrCatalog[i].attr_offset));
 
@@ -50,11 +50,51 @@ typedef struct
 	 (chunk)->mclass <= GPUMEM_CHUNKSZ_MAX_BIT &&	 \
 	 (chunk)->refcnt > 0)
 
+/*
+ * GpuMemPoolItem - device memory region being kept by the GPU memory keeper,
+ * then lent to the GpuContexts of backend processes. It allows to skip
+ * cuMemAlloc() on every new GpuContext (usually, per query).
+ */
+#define GPUMEM_POOL_MCLASS_MAX		36		/* 64GB */
+
+typedef struct
+{
+	dlist_node		chain;
+	cl_int			cuda_dindex;
+	cl_int			mclass;		/* get_next_log2(bytesize) */
+	size_t			bytesize;
+	CUdeviceptr		m_devptr;	/* valid only keeper */
+	CUipcMemHandle	m_handle;
+	pid_t			borrower;	/* PID of the borrower, or 0 if free */
+} GpuMemPoolItem;
+
+/*
+ * GpuMemPoolDevice - per-device free lists for each size class
+ */
+typedef struct
+{
+	size_t			pool_usage;	/* total bytes kept by the keeper */
+	/* max size of the requests failed to borrow, per size class */
+	size_t			demand_sz[GPUMEM_POOL_MCLASS_MAX + 1];
+	dlist_head		free_list[GPUMEM_POOL_MCLASS_MAX + 1];
+} GpuMemPoolDevice;
+
+typedef struct
+{
+	slock_t			lock;
+	cl_int			nitems;
+	GpuMemPoolItem *items;		/* array of GpuMemPoolItem[nitems] */
+	dlist_head		unused_list;
+	GpuMemPoolDevice pool_devs[FLEXIBLE_ARRAY_MEMBER];
+} GpuMemPoolHead;
+
 typedef struct
 {
 	dlist_node		chain;
 	GpuMemKind		gm_kind;	/* one of GpuMemKind__* */
 	CUdeviceptr		m_segment;	/* device pointer of the segment */
+	GpuMemPoolItem *gm_pool;	/* valid, if borrowed from the pool */
+	bool			in_arena;	/* true, if host memory of the arena */
 	unsigned long	iomap_handle; /* only if GpuMemKind__IOMapMemory */
 	slock_t			lock;		/* protection of chunks */
 	pg_atomic_uint32 num_active_chunks; /* # of active chunks */
@@ -130,11 +170,27 @@ static size_t		gm_segment_sz;	/* bytesize */
 
 static bool			nvme_strom_enabled;			/* GUC */
 static int			nvme_strom_threshold_kb;	/* GUC */
+bool				nvme_strom_gpu_visibility;	/* GUC */
 
 static int			num_preserved_gpu_memory_regions;	/* GUC */
 static bool			gpummgr_bgworker_got_signal = false;
 static GpuMemPreservedHead *gmemp_head = NULL;
 
+static int			gpu_memory_pool_size_kb;	/* GUC */
+static GpuMemPoolHead *gmpool_head = NULL;
+
+/*
+ * Per-process arena of pinned host memory segments. These segments are
+ * allocated under the primary context of the device, thus, they survive
+ * across cuCtxDestroy() of the GpuContexts and get recycled by the later
+ * queries without page-locking churn.
+ */
+static int			host_memory_arena_size_kb;	/* GUC */
+static slock_t		hostmem_arena_lock;
+static CUcontext	hostmem_arena_context = NULL;
+static size_t		hostmem_arena_usage = 0;
+static dlist_head	hostmem_arena_free_list;
+
 Datum pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS);
 
 #define GPUMEM_DEVICE_RAW_EXTRA		((void *)(~0L))
@@ -157,6 +213,200 @@ nvme_strom_ioctl(int cmd, void *arg)
 	return ioctl(fdesc_nvme_strom, cmd, arg);
 }
 
+/*
+ * GPUMEM_POOL_ITEM_EXTRA - checks whether the extra pointer of the tracked
+ * device memory is an item borrowed from the device memory pool.
+ */
+#define GPUMEM_POOL_ITEM_EXTRA(extra)								\
+	(gmpool_head != NULL &&											\
+	 (GpuMemPoolItem *)(extra) >= gmpool_head->items &&				\
+	 (GpuMemPoolItem *)(extra) <  gmpool_head->items + gmpool_head->nitems)
+
+/*
+ * gpuMemPoolReturn - gives back a borrowed item to the device memory pool
+ *
+ * If m_deviceptr == 0, it assumes the IPC mapping is already closed because
+ * of cuCtxDestroy().
+ */
+static CUresult
+gpuMemPoolReturn(GpuMemPoolItem *gm_pool, CUdeviceptr m_deviceptr)
+{
+	GpuMemPoolDevice *pool_dev;
+	CUresult	rc = CUDA_SUCCESS;
+
+	if (m_deviceptr != 0UL)
+		rc = cuIpcCloseMemHandle(m_deviceptr);
+
+	pool_dev = &gmpool_head->pool_devs[gm_pool->cuda_dindex];
+	SpinLockAcquire(&gmpool_head->lock);
+	Assert(gm_pool->borrower == MyProcPid);
+	gm_pool->borrower = 0;
+	dlist_push_head(&pool_dev->free_list[gm_pool->mclass],
+					&gm_pool->chain);
+	SpinLockRelease(&gmpool_head->lock);
+
+	return rc;
+}
+
+/*
+ * gpuMemPoolBorrow - borrows a device memory region from the pool
+ *
+ * It returns NULL if no free items are available in the size class. In this
+ * case, it records the demand for the GPU memory keeper, to prepare an item
+ * for the next request. Caller must push the CUDA context of the GpuContext.
+ */
+static GpuMemPoolItem *
+gpuMemPoolBorrow(GpuContext *gcontext, size_t bytesize,
+				 CUdeviceptr *p_deviceptr)
+{
+	GpuMemPoolDevice *pool_dev;
+	GpuMemPoolItem *gm_pool = NULL;
+	CUdeviceptr	m_deviceptr;
+	Latch	   *keeper = NULL;
+	dlist_iter	iter;
+	cl_int		mclass;
+	CUresult	rc;
+
+	if (!gmpool_head || gmpool_head->nitems == 0)
+		return NULL;
+	/* small allocation is not a job of the pool */
+	if (bytesize < pgstrom_chunk_size())
+		return NULL;
+	mclass = get_next_log2(bytesize);
+	if (mclass > GPUMEM_POOL_MCLASS_MAX)
+		return NULL;
+	pool_dev = &gmpool_head->pool_devs[gcontext->cuda_dindex];
+
+	SpinLockAcquire(&gmpool_head->lock);
+	dlist_foreach(iter, &pool_dev->free_list[mclass])
+	{
+		GpuMemPoolItem *temp = dlist_container(GpuMemPoolItem,
+											   chain, iter.cur);
+		if (temp->bytesize >= bytesize)
+		{
+			dlist_delete(&temp->chain);
+			temp->borrower = MyProcPid;
+			gm_pool = temp;
+			break;
+		}
+	}
+	if (!gm_pool)
+	{
+		pool_dev->demand_sz[mclass] = Max(pool_dev->demand_sz[mclass],
+										  bytesize);
+		keeper = gmemp_head->gmemp_keeper;
+	}
+	SpinLockRelease(&gmpool_head->lock);
+
+	if (!gm_pool)
+	{
+		if (keeper)
+			SetLatch(keeper);
+		return NULL;
+	}
+
+	rc = cuIpcOpenMemHandle(&m_deviceptr, gm_pool->m_handle,
+							CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+	{
+		wnotice("failed on cuIpcOpenMemHandle: %s", errorText(rc));
+		gpuMemPoolReturn(gm_pool, 0UL);
+		return NULL;
+	}
+	*p_deviceptr = m_deviceptr;
+
+	return gm_pool;
+}
+
+/*
+ * gpuMemPoolReturnExtra - gives back the pool item tracked as a leaked
+ * device memory, on the GpuContext cleanup after cuCtxDestroy().
+ */
+void
+gpuMemPoolReturnExtra(void *extra)
+{
+	if (GPUMEM_POOL_ITEM_EXTRA(extra))
+		gpuMemPoolReturn((GpuMemPoolItem *)extra, 0UL);
+}
+
+/*
+ * gpuMemHostArenaAlloc - allocation of a host memory segment from the arena
+ *
+ * Free segments in the arena use its head as dlist_node for the free list.
+ * Caller must push the CUDA context of the GpuContext.
+ */
+static CUresult
+gpuMemHostArenaAlloc(GpuContext *gcontext, void **p_hostptr)
+{
+	size_t		arena_limit = (size_t)host_memory_arena_size_kb << 10;
+	CUdevice	cuda_device;
+	void	   *hostptr;
+	CUresult	rc;
+
+	if (gm_segment_sz > arena_limit)
+		return CUDA_ERROR_OUT_OF_MEMORY;
+
+	SpinLockAcquire(&hostmem_arena_lock);
+	if (!dlist_is_empty(&hostmem_arena_free_list))
+	{
+		hostptr = dlist_pop_head_node(&hostmem_arena_free_list);
+		SpinLockRelease(&hostmem_arena_lock);
+		*p_hostptr = hostptr;
+		return CUDA_SUCCESS;
+	}
+	if (hostmem_arena_usage + gm_segment_sz > arena_limit)
+	{
+		SpinLockRelease(&hostmem_arena_lock);
+		return CUDA_ERROR_OUT_OF_MEMORY;
+	}
+	/* primary context shall be retained until process exit */
+	if (!hostmem_arena_context)
+	{
+		rc = cuDeviceGet(&cuda_device,
+						 devAttrs[gcontext->cuda_dindex].DEV_ID);
+		if (rc == CUDA_SUCCESS)
+			rc = cuDevicePrimaryCtxRetain(&hostmem_arena_context,
+										  cuda_device);
+		if (rc != CUDA_SUCCESS)
+		{
+			SpinLockRelease(&hostmem_arena_lock);
+			wnotice("failed on cuDevicePrimaryCtxRetain: %s", errorText(rc));
+			return rc;
+		}
+	}
+	hostmem_arena_usage += gm_segment_sz;
+	SpinLockRelease(&hostmem_arena_lock);
+
+	rc = cuCtxPushCurrent(hostmem_arena_context);
+	if (rc == CUDA_SUCCESS)
+	{
+		rc = cuMemHostAlloc(&hostptr, gm_segment_sz,
+							CU_MEMHOSTALLOC_PORTABLE);
+		cuCtxPopCurrent(NULL);
+	}
+	if (rc != CUDA_SUCCESS)
+	{
+		SpinLockAcquire(&hostmem_arena_lock);
+		hostmem_arena_usage -= gm_segment_sz;
+		SpinLockRelease(&hostmem_arena_lock);
+		return rc;
+	}
+	*p_hostptr = hostptr;
+
+	return CUDA_SUCCESS;
+}
+
+/*
+ * gpuMemHostArenaFree - gives back a host memory segment to the arena
+ */
+static void
+gpuMemHostArenaFree(void *hostptr)
+{
+	SpinLockAcquire(&hostmem_arena_lock);
+	dlist_push_head(&hostmem_arena_free_list, (dlist_node *)hostptr);
+	SpinLockRelease(&hostmem_arena_lock);
+}
+
 /*
  * gpuMemFreeChunk
  */
@@ -255,6 +505,8 @@ gpuMemFreeExtra(GpuContext *gcontext,
 		return cuMemFree(m_deviceptr);
 	else if (extra == GPUMEM_HOST_RAW_EXTRA)
 		return cuMemFreeHost((void *)m_deviceptr);
+	else if (GPUMEM_POOL_ITEM_EXTRA(extra))
+		return gpuMemPoolReturn((GpuMemPoolItem *)extra, m_deviceptr);
 	return gpuMemFreeChunk(gcontext, m_deviceptr, (GpuMemSegment *)extra);
 }
 
@@ -291,6 +543,7 @@ __gpuMemAllocRaw(GpuContext *gcontext,
 				 size_t bytesize,
 				 const char *filename, int lineno)
 {
+	GpuMemPoolItem *gm_pool;
 	CUdeviceptr	m_deviceptr;
 	CUresult	rc;
 
@@ -301,18 +554,26 @@ __gpuMemAllocRaw(GpuContext *gcontext,
 		return rc;
 	}
 
-	rc = cuMemAlloc(&m_deviceptr, bytesize);
-	if (rc != CUDA_SUCCESS)
+	gm_pool = gpuMemPoolBorrow(gcontext, bytesize, &m_deviceptr);
+	if (!gm_pool)
 	{
-		wnotice("failed on cuMemAlloc(%zu): %s", bytesize, errorText(rc));
-		cuCtxPopCurrent(NULL);
-		return rc;
+		rc = cuMemAlloc(&m_deviceptr, bytesize);
+		if (rc != CUDA_SUCCESS)
+		{
+			wnotice("failed on cuMemAlloc(%zu): %s",
+					bytesize, errorText(rc));
+			cuCtxPopCurrent(NULL);
+			return rc;
+		}
 	}
 	if (!trackGpuMem(gcontext, m_deviceptr,
-					 GPUMEM_DEVICE_RAW_EXTRA,
+					 gm_pool ? (void *)gm_pool : GPUMEM_DEVICE_RAW_EXTRA,
 					 filename, lineno))
 	{
-		cuMemFree(m_deviceptr);
+		if (gm_pool)
+			gpuMemPoolReturn(gm_pool, m_deviceptr);
+		else
+			cuMemFree(m_deviceptr);
 		cuCtxPopCurrent(NULL);
 		return CUDA_ERROR_OUT_OF_MEMORY;
 	}
@@ -498,6 +759,7 @@ gpuMemAllocChunk(GpuMemKind gm_kind,
 				 const char *filename, int lineno)
 {
 	GpuMemStatistics *gm_stat;
+	GpuContextMemStat *gc_mstat;
 	GpuMemSegment  *gm_seg;
 	GpuMemChunk	   *gm_chunk;
 	CUdeviceptr		m_deviceptr;
@@ -610,7 +872,12 @@ retry:
 	switch (gm_kind)
 	{
 		case GpuMemKind__NormalMemory:
-			rc = cuMemAlloc(&m_segment, gm_segment_sz);
+			gm_seg->gm_pool = gpuMemPoolBorrow(gcontext, gm_segment_sz,
+											   &m_segment);
+			if (gm_seg->gm_pool)
+				rc = CUDA_SUCCESS;
+			else
+				rc = cuMemAlloc(&m_segment, gm_segment_sz);
 			//wnotice("normal m_segment = %p - %p by %s:%d", (void *)m_segment, (void *)(m_segment - gm_segment_sz), filename, lineno);
 			break;
 
@@ -642,8 +909,12 @@ retry:
 			break;
 
 		case GpuMemKind__HostMemory:
-			rc = cuMemHostAlloc((void **)&m_segment, gm_segment_sz,
-								CU_MEMHOSTALLOC_PORTABLE);
+			rc = gpuMemHostArenaAlloc(gcontext, (void **)&m_segment);
+			if (rc == CUDA_SUCCESS)
+				gm_seg->in_arena = true;
+			else
+				rc = cuMemHostAlloc((void **)&m_segment, gm_segment_sz,
+									CU_MEMHOSTALLOC_PORTABLE);
 			//wnotice("hostmem m_segment = %p - %p", (void *)m_segment, (void *)(m_segment - gm_segment_sz));
 			break;
 
@@ -708,16 +979,23 @@ retry:
 	{
 		case GpuMemKind__NormalMemory:
 			pg_atomic_add_fetch_u64(&gm_stat->normal_usage, gm_segment_sz);
+			gc_mstat = &gcontext->gc_stat->gm_normal;
 			break;
 		case GpuMemKind__ManagedMemory:
 			pg_atomic_add_fetch_u64(&gm_stat->managed_usage, gm_segment_sz);
+			gc_mstat = &gcontext->gc_stat->gm_managed;
 			break;
 		case GpuMemKind__IOMapMemory:
 			pg_atomic_add_fetch_u64(&gm_stat->iomap_usage, gm_segment_sz);
+			gc_mstat = &gcontext->gc_stat->gm_iomap;
 			break;
 		default:
+			gc_mstat = &gcontext->gc_stat->gm_hostmem;
 			break;
 	}
+	pg_atomic_fetch_add_u32(&gc_mstat->num_segments, 1);
+	pg_atomic_fetch_add_u64(&gc_mstat->total_size, gm_segment_sz);
+	pg_atomic_fetch_add_u64(&gc_mstat->free_size, gm_segment_sz);
 	goto retry;
 }
 
@@ -966,11 +1244,26 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 			Assert(gm_seg->gm_kind == GpuMemKind__NormalMemory);
 			if (pg_atomic_read_u32(&gm_seg->num_active_chunks) == 0)
 			{
-				rc = cuMemFree(gm_seg->m_segment);
-				if (rc != CUDA_SUCCESS)
+				if (gm_seg->gm_pool)
 				{
-					pthreadRWLockUnlock(&gcontext->gm_rwlock);
-					werror("failed on cuMemFree: %s", errorText(rc));
+					/* back to the pool, instead of cuMemFree */
+					rc = gpuMemPoolReturn(gm_seg->gm_pool,
+										  gm_seg->m_segment);
+					if (rc != CUDA_SUCCESS)
+					{
+						pthreadRWLockUnlock(&gcontext->gm_rwlock);
+						werror("failed on cuIpcCloseMemHandle: %s",
+							   errorText(rc));
+					}
+				}
+				else
+				{
+					rc = cuMemFree(gm_seg->m_segment);
+					if (rc != CUDA_SUCCESS)
+					{
+						pthreadRWLockUnlock(&gcontext->gm_rwlock);
+						werror("failed on cuMemFree: %s", errorText(rc));
+					}
 				}
 				dlist_delete(&gm_seg->chain);
 				free(gm_seg);
@@ -1019,11 +1312,16 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 			Assert(gm_seg->gm_kind == GpuMemKind__HostMemory);
 			if (pg_atomic_read_u32(&gm_seg->num_active_chunks) == 0)
 			{
-				rc = cuMemFreeHost((void *)gm_seg->m_segment);
-				if (rc != CUDA_SUCCESS)
+				if (gm_seg->in_arena)
+					gpuMemHostArenaFree((void *)gm_seg->m_segment);
+				else
 				{
-					pthreadRWLockUnlock(&gcontext->gm_rwlock);
-					werror("failed on cuMemFreeHost: %s", errorText(rc));
+					rc = cuMemFreeHost((void *)gm_seg->m_segment);
+					if (rc != CUDA_SUCCESS)
+					{
+						pthreadRWLockUnlock(&gcontext->gm_rwlock);
+						werror("failed on cuMemFreeHost: %s", errorText(rc));
+					}
 				}
 				dlist_delete(&gm_seg->chain);
 				free(gm_seg);
@@ -1033,6 +1331,85 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 	pthreadRWLockUnlock(&gcontext->gm_rwlock);
 }
 
+/*
+ * __gpuMemPublishStatistics
+ */
+static void
+__gpuMemPublishStatistics(GpuContextMemStat *gm_stat,
+						  dlist_head *gm_segment_list)
+{
+	GpuMemSegment  *gm_seg;
+	dlist_iter		iter;
+	dlist_iter		__iter;
+	cl_uint			num_segments = 0;
+	size_t			free_size = 0;
+	size_t			largest_free = 0;
+	size_t			unit_sz;
+	cl_int			nchunks;
+	cl_int			mclass;
+
+	dlist_foreach(iter, gm_segment_list)
+	{
+		gm_seg = dlist_container(GpuMemSegment, chain, iter.cur);
+		num_segments++;
+		if (gm_seg->gm_kind == GpuMemKind__ManagedMemory)
+		{
+			/* chunks are split/merged by buddy allocation */
+			SpinLockAcquire(&gm_seg->lock);
+			for (mclass = GPUMEM_CHUNKSZ_MIN_BIT;
+				 mclass <= GPUMEM_CHUNKSZ_MAX_BIT;
+				 mclass++)
+			{
+				dlist_foreach(__iter, &gm_seg->free_chunks[mclass])
+				{
+					free_size += (1UL << mclass);
+					largest_free = Max(largest_free, 1UL << mclass);
+				}
+			}
+			SpinLockRelease(&gm_seg->lock);
+		}
+		else
+		{
+			/* all the chunks have fixed length */
+			unit_sz = pgstrom_chunk_size();
+			nchunks = gm_segment_sz / unit_sz;
+			nchunks -= pg_atomic_read_u32(&gm_seg->num_active_chunks);
+			if (nchunks > 0)
+			{
+				free_size += nchunks * unit_sz;
+				largest_free = Max(largest_free, unit_sz);
+			}
+		}
+	}
+	pg_atomic_write_u32(&gm_stat->num_segments, num_segments);
+	pg_atomic_write_u64(&gm_stat->total_size, num_segments * gm_segment_sz);
+	pg_atomic_write_u64(&gm_stat->free_size, free_size);
+	pg_atomic_write_u64(&gm_stat->largest_free, largest_free);
+}
+
+/*
+ * gpuMemPublishStatistics
+ *
+ * It writes out the usage of memory segments of the GpuContext to the
+ * shared memory, for pgstrom.gpu_context_meminfo.
+ */
+void
+gpuMemPublishStatistics(GpuContext *gcontext)
+{
+	GpuContextStat *gc_stat = gcontext->gc_stat;
+
+	pthreadRWLockReadLock(&gcontext->gm_rwlock);
+	__gpuMemPublishStatistics(&gc_stat->gm_normal,
+							  &gcontext->gm_normal_list);
+	__gpuMemPublishStatistics(&gc_stat->gm_iomap,
+							  &gcontext->gm_iomap_list);
+	__gpuMemPublishStatistics(&gc_stat->gm_managed,
+							  &gcontext->gm_managed_list);
+	__gpuMemPublishStatistics(&gc_stat->gm_hostmem,
+							  &gcontext->gm_hostmem_list);
+	pthreadRWLockUnlock(&gcontext->gm_rwlock);
+}
+
 /*
  * gpuIpcMemCopyToHost / gpuIpcMemCopyFromHost
  */
@@ -1144,6 +1521,297 @@ gpuIpcMemCopyToHost(void *hbuffer,
 						  hbuffer, length, false);
 }
 
+/*
+ * gpuIpcMemCopyFromHostStream / gpuIpcMemCopyToHostStream
+ *
+ * They transfer the image between the preserved device memory and host side
+ * sequentially, using a pair of page-locked staging buffers. DMA of the one
+ * buffer runs asynchronously, while the callback is producing (or consuming)
+ * the other one. So, we don't need to keep the whole image on the host memory,
+ * and DMA is overlapped with the I/O by the callback.
+ */
+struct GpuIpcMemStream
+{
+	CUcontext		cuda_context;
+	CUdeviceptr		m_deviceptr;
+	CUstream		cuda_stream;
+	size_t			offset;		/* current position on the device memory */
+	size_t			unitsz;		/* size of the staging buffers */
+	size_t			usage;		/* usage of the current staging buffer */
+	int				curr;		/* index of the current staging buffer */
+	bool			busy[2];	/* true, if DMA is in-progress */
+	CUevent			events[2];
+	char		   *hbuffer[2];
+};
+
+static void
+gpuIpcMemStreamOpen(GpuIpcMemStream *gstream,
+					cl_int cuda_dindex,
+					CUipcMemHandle ipc_mhandle)
+{
+	CUdevice	cuda_device;
+	CUresult	rc;
+	int			i;
+
+	rc = gpuInit(0);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuInit: %s", errorText(rc));
+
+	Assert(cuda_dindex >= 0 && cuda_dindex < numDevAttrs);
+	rc = cuDeviceGet(&cuda_device, devAttrs[cuda_dindex].DEV_ID);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuDeviceGet: %s", errorText(rc));
+
+	rc = cuCtxCreate(&gstream->cuda_context, 0, cuda_device);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxCreate: %s", errorText(rc));
+
+	rc = cuIpcOpenMemHandle(&gstream->m_deviceptr,
+							ipc_mhandle,
+							CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuIpcOpenMemHandle: %s", errorText(rc));
+
+	rc = cuStreamCreate(&gstream->cuda_stream, CU_STREAM_NON_BLOCKING);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuStreamCreate: %s", errorText(rc));
+
+	for (i=0; i < 2; i++)
+	{
+		rc = cuEventCreate(&gstream->events[i], CU_EVENT_DISABLE_TIMING);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventCreate: %s", errorText(rc));
+		rc = cuMemAllocHost((void **)&gstream->hbuffer[i],
+							gstream->unitsz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemAllocHost: %s", errorText(rc));
+	}
+}
+
+/*
+ * gpuIpcMemStreamClose - releases the resources; events and stream are
+ * released with the context. It never raise an error, because it is also
+ * called on the error path.
+ */
+static void
+gpuIpcMemStreamClose(GpuIpcMemStream *gstream)
+{
+	CUresult	rc;
+	int			i;
+
+	if (gstream->cuda_stream)
+		cuStreamSynchronize(gstream->cuda_stream);
+	for (i=0; i < 2; i++)
+	{
+		if (gstream->hbuffer[i])
+		{
+			rc = cuMemFreeHost(gstream->hbuffer[i]);
+			if (rc != CUDA_SUCCESS)
+				elog(WARNING, "failed on cuMemFreeHost: %s", errorText(rc));
+		}
+	}
+	if (gstream->m_deviceptr != 0UL)
+	{
+		rc = cuIpcCloseMemHandle(gstream->m_deviceptr);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuIpcCloseMemHandle: %s",
+				 errorText(rc));
+	}
+	if (gstream->cuda_context)
+	{
+		rc = cuCtxDestroy(gstream->cuda_context);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuCtxDestroy: %s", errorText(rc));
+	}
+	memset(gstream, 0, sizeof(GpuIpcMemStream));
+}
+
+static void
+gpuIpcMemStreamFlush(GpuIpcMemStream *gstream)
+{
+	int			curr = gstream->curr;
+	CUresult	rc;
+
+	if (gstream->usage > 0)
+	{
+		rc = cuMemcpyHtoDAsync(gstream->m_deviceptr + gstream->offset,
+							   gstream->hbuffer[curr],
+							   gstream->usage,
+							   gstream->cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+		rc = cuEventRecord(gstream->events[curr], gstream->cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventRecord: %s", errorText(rc));
+		gstream->busy[curr] = true;
+		gstream->offset += gstream->usage;
+		gstream->usage = 0;
+		gstream->curr = curr = (curr + 1) % 2;
+	}
+	/* wait for completion of the previous DMA from the next buffer */
+	if (gstream->busy[curr])
+	{
+		rc = cuEventSynchronize(gstream->events[curr]);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventSynchronize: %s", errorText(rc));
+		gstream->busy[curr] = false;
+	}
+}
+
+/*
+ * gpuIpcMemStreamWrite - appends @length bytes of @data to the stream.
+ * If @data is NULL, it writes zero bytes (usually, for paddings).
+ */
+void
+gpuIpcMemStreamWrite(GpuIpcMemStream *gstream,
+					 const void *data, size_t length)
+{
+	while (length > 0)
+	{
+		size_t	nbytes = Min(length, gstream->unitsz - gstream->usage);
+		char   *dest = gstream->hbuffer[gstream->curr] + gstream->usage;
+
+		if (data)
+		{
+			memcpy(dest, data, nbytes);
+			data = (const char *)data + nbytes;
+		}
+		else
+			memset(dest, 0, nbytes);
+		gstream->usage += nbytes;
+		length -= nbytes;
+
+		if (gstream->usage == gstream->unitsz)
+			gpuIpcMemStreamFlush(gstream);
+	}
+}
+
+/*
+ * gpuIpcMemCopyFromHostStream
+ *
+ * It writes out the image generated by @stream_cb onto the preserved device
+ * memory from the @offset, then returns the length written.
+ */
+size_t
+gpuIpcMemCopyFromHostStream(cl_int cuda_dindex,
+							CUipcMemHandle ipc_mhandle,
+							size_t offset,
+							void (*stream_cb)(GpuIpcMemStream *gstream,
+											  void *cb_private),
+							void *cb_private)
+{
+	GpuIpcMemStream	gstream;
+	size_t		length;
+	CUresult	rc;
+
+	memset(&gstream, 0, sizeof(GpuIpcMemStream));
+	gstream.unitsz = pgstrom_chunk_size();
+	PG_TRY();
+	{
+		gpuIpcMemStreamOpen(&gstream, cuda_dindex, ipc_mhandle);
+		gstream.offset = offset;
+
+		/* generate the image, and DMA */
+		stream_cb(&gstream, cb_private);
+		gpuIpcMemStreamFlush(&gstream);
+
+		rc = cuStreamSynchronize(gstream.cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuStreamSynchronize: %s", errorText(rc));
+	}
+	PG_CATCH();
+	{
+		gpuIpcMemStreamClose(&gstream);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	length = gstream.offset - offset;
+	gpuIpcMemStreamClose(&gstream);
+
+	return length;
+}
+
+/*
+ * gpuIpcMemStreamFetch - kicks device-to-host DMA of the next portion onto
+ * the staging buffer @index, then returns its length.
+ */
+static size_t
+gpuIpcMemStreamFetch(GpuIpcMemStream *gstream, int index, size_t tail)
+{
+	size_t		nbytes = Min(gstream->unitsz, tail - gstream->offset);
+	CUresult	rc;
+
+	if (nbytes > 0)
+	{
+		rc = cuMemcpyDtoHAsync(gstream->hbuffer[index],
+							   gstream->m_deviceptr + gstream->offset,
+							   nbytes,
+							   gstream->cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoHAsync: %s", errorText(rc));
+		rc = cuEventRecord(gstream->events[index], gstream->cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventRecord: %s", errorText(rc));
+		gstream->offset += nbytes;
+	}
+	return nbytes;
+}
+
+/*
+ * gpuIpcMemCopyToHostStream
+ *
+ * It reads out @length bytes of the preserved device memory from the @offset,
+ * and hands over them to @stream_cb for each portion on the staging buffer.
+ * DMA of the next portion runs while @stream_cb is consuming the current one.
+ */
+void
+gpuIpcMemCopyToHostStream(cl_int cuda_dindex,
+						  CUipcMemHandle ipc_mhandle,
+						  size_t offset,
+						  size_t length,
+						  void (*stream_cb)(const void *data,
+											size_t length,
+											void *cb_private),
+						  void *cb_private)
+{
+	GpuIpcMemStream	gstream;
+	size_t		nbytes[2];
+	int			curr;
+	CUresult	rc;
+
+	memset(&gstream, 0, sizeof(GpuIpcMemStream));
+	gstream.unitsz = pgstrom_chunk_size();
+	PG_TRY();
+	{
+		gpuIpcMemStreamOpen(&gstream, cuda_dindex, ipc_mhandle);
+		gstream.offset = offset;
+
+		curr = 0;
+		nbytes[curr] = gpuIpcMemStreamFetch(&gstream, curr, offset + length);
+		while (nbytes[curr] > 0)
+		{
+			int		next = (curr + 1) % 2;
+
+			/* kick DMA of the next portion prior to the callback */
+			nbytes[next] = gpuIpcMemStreamFetch(&gstream, next,
+												offset + length);
+			rc = cuEventSynchronize(gstream.events[curr]);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuEventSynchronize: %s",
+					 errorText(rc));
+			stream_cb(gstream.hbuffer[curr], nbytes[curr], cb_private);
+			curr = next;
+		}
+	}
+	PG_CATCH();
+	{
+		gpuIpcMemStreamClose(&gstream);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	gpuIpcMemStreamClose(&gstream);
+}
+
 /*
  * pgstrom_gpu_mmgr_init_gpucontext - Per GpuContext initialization
  */
@@ -1178,6 +1846,8 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 		dnode = dlist_pop_head_node(&gcontext->gm_normal_list);
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
 		pg_atomic_sub_fetch_u64(&gm_stat->normal_usage, gm_segment_sz);
+		if (gm_seg->gm_pool)
+			gpuMemPoolReturn(gm_seg->gm_pool, 0UL);
 		free(gm_seg);
 	}
 
@@ -1201,6 +1871,9 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 	{
 		dnode = dlist_pop_head_node(&gcontext->gm_hostmem_list);
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
+		/* segments of the arena are still valid */
+		if (gm_seg->in_arena)
+			gpuMemHostArenaFree((void *)gm_seg->m_segment);
 		free(gm_seg);
 	}
 }
@@ -1222,6 +1895,192 @@ gpummgrBgWorkerSigTerm(SIGNAL_ARGS)
 	errno = saved_errno;
 }
 
+/*
+ * gpummgrBgWorkerAllocPoolItem - allocation of a new item of the device
+ * memory pool. If 'allow_evict', it releases free items in the other size
+ * classes on the tail (least recently returned) to make a room.
+ */
+static bool
+gpummgrBgWorkerAllocPoolItem(CUcontext *cuda_context, cl_int cuda_dindex,
+							 size_t bytesize, bool allow_evict)
+{
+	GpuMemPoolDevice *pool_dev = &gmpool_head->pool_devs[cuda_dindex];
+	size_t			pool_limit = (size_t)gpu_memory_pool_size_kb << 10;
+	GpuMemPoolItem *gm_pool;
+	GpuMemPoolItem *victim;
+	CUdeviceptr		m_devptr;
+	CUipcMemHandle	m_handle;
+	dlist_node	   *dnode;
+	cl_int			k;
+	CUresult		rc;
+
+	rc = cuCtxPushCurrent(cuda_context[cuda_dindex]);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		return false;
+	}
+
+	SpinLockAcquire(&gmpool_head->lock);
+	while (pool_dev->pool_usage + bytesize > pool_limit)
+	{
+		victim = NULL;
+		if (allow_evict)
+		{
+			for (k=GPUMEM_POOL_MCLASS_MAX; k >= 0; k--)
+			{
+				if (!dlist_is_empty(&pool_dev->free_list[k]))
+				{
+					dnode = dlist_tail_node(&pool_dev->free_list[k]);
+					victim = dlist_container(GpuMemPoolItem, chain, dnode);
+					break;
+				}
+			}
+		}
+		if (!victim)
+		{
+			SpinLockRelease(&gmpool_head->lock);
+			cuCtxPopCurrent(NULL);
+			return false;
+		}
+		dlist_delete(&victim->chain);
+		pool_dev->pool_usage -= victim->bytesize;
+		rc = cuMemFree(victim->m_devptr);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuMemFree: %s", errorText(rc));
+		memset(victim, 0, sizeof(GpuMemPoolItem));
+		dlist_push_head(&gmpool_head->unused_list, &victim->chain);
+	}
+	if (dlist_is_empty(&gmpool_head->unused_list))
+	{
+		SpinLockRelease(&gmpool_head->lock);
+		cuCtxPopCurrent(NULL);
+		return false;
+	}
+	dnode = dlist_pop_head_node(&gmpool_head->unused_list);
+	gm_pool = dlist_container(GpuMemPoolItem, chain, dnode);
+	pool_dev->pool_usage += bytesize;
+	SpinLockRelease(&gmpool_head->lock);
+
+	rc = cuMemAlloc(&m_devptr, bytesize);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "failed on cuMemAlloc: %s", errorText(rc));
+		goto error;
+	}
+	rc = cuIpcGetMemHandle(&m_handle, m_devptr);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "failed on cuIpcGetMemHandle: %s", errorText(rc));
+		cuMemFree(m_devptr);
+		goto error;
+	}
+	cuCtxPopCurrent(NULL);
+
+	SpinLockAcquire(&gmpool_head->lock);
+	memset(gm_pool, 0, sizeof(GpuMemPoolItem));
+	gm_pool->cuda_dindex = cuda_dindex;
+	gm_pool->mclass = get_next_log2(bytesize);
+	gm_pool->bytesize = bytesize;
+	gm_pool->m_devptr = m_devptr;
+	memcpy(&gm_pool->m_handle, &m_handle, sizeof(CUipcMemHandle));
+	dlist_push_head(&pool_dev->free_list[gm_pool->mclass],
+					&gm_pool->chain);
+	SpinLockRelease(&gmpool_head->lock);
+
+	return true;
+
+error:
+	cuCtxPopCurrent(NULL);
+	SpinLockAcquire(&gmpool_head->lock);
+	pool_dev->pool_usage -= bytesize;
+	dlist_push_head(&gmpool_head->unused_list, &gm_pool->chain);
+	SpinLockRelease(&gmpool_head->lock);
+	return false;
+}
+
+/*
+ * gpummgrBgWorkerReleasePoolItems - release free items of the device memory
+ * pool on the @cuda_dindex, from the tail (least recently returned) of the
+ * larger size classes, until @required bytes get reclaimed.
+ * Preserved device memory takes priority over the pool items, because the
+ * pool is just a cache of cuMemAlloc() for GpuContexts and will be refilled
+ * on demand later. Caller must push the CUDA context of the device.
+ */
+static size_t
+gpummgrBgWorkerReleasePoolItems(cl_int cuda_dindex, size_t required)
+{
+	GpuMemPoolDevice *pool_dev;
+	GpuMemPoolItem *victim;
+	dlist_node	   *dnode;
+	size_t			reclaimed = 0;
+	cl_int			k;
+	CUresult		rc;
+
+	if (gmpool_head->nitems == 0)
+		return 0;
+	pool_dev = &gmpool_head->pool_devs[cuda_dindex];
+
+	SpinLockAcquire(&gmpool_head->lock);
+	while (reclaimed < required)
+	{
+		victim = NULL;
+		for (k=GPUMEM_POOL_MCLASS_MAX; k >= 0; k--)
+		{
+			if (!dlist_is_empty(&pool_dev->free_list[k]))
+			{
+				dnode = dlist_tail_node(&pool_dev->free_list[k]);
+				victim = dlist_container(GpuMemPoolItem, chain, dnode);
+				break;
+			}
+		}
+		if (!victim)
+			break;
+		dlist_delete(&victim->chain);
+		pool_dev->pool_usage -= victim->bytesize;
+		rc = cuMemFree(victim->m_devptr);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuMemFree: %s", errorText(rc));
+		else
+			reclaimed += victim->bytesize;
+		memset(victim, 0, sizeof(GpuMemPoolItem));
+		dlist_push_head(&gmpool_head->unused_list, &victim->chain);
+	}
+	SpinLockRelease(&gmpool_head->lock);
+
+	if (reclaimed > 0)
+		elog(LOG, "GPU%d: %zu bytes of memory pool released for preserved memory",
+			 devAttrs[cuda_dindex].DEV_ID, reclaimed);
+	return reclaimed;
+}
+
+/*
+ * gpummgrBgWorkerFillPool - allocation of the pool items on demand
+ */
+static void
+gpummgrBgWorkerFillPool(CUcontext *cuda_context)
+{
+	GpuMemPoolDevice *pool_dev;
+	size_t		bytesize;
+	cl_int		i, k;
+
+	for (i=0; i < numDevAttrs; i++)
+	{
+		pool_dev = &gmpool_head->pool_devs[i];
+		for (k=0; k <= GPUMEM_POOL_MCLASS_MAX; k++)
+		{
+			SpinLockAcquire(&gmpool_head->lock);
+			bytesize = pool_dev->demand_sz[k];
+			pool_dev->demand_sz[k] = 0;
+			SpinLockRelease(&gmpool_head->lock);
+
+			if (bytesize > 0)
+				gpummgrBgWorkerAllocPoolItem(cuda_context, i,
+											 bytesize, true);
+		}
+	}
+}
+
 /*
  * gpummgrBgWorkerMain - main loop for device memory keeper
  */
@@ -1262,6 +2121,16 @@ gpummgrBgWorkerMain(Datum arg)
 			elog(ERROR, "failed on cuCtxCreate: %s", errorText(rc));
 	}
 
+	/* pre-allocation of the device memory pool by segment size */
+	if (gmpool_head->nitems > 0)
+	{
+		for (i=0; i < numDevAttrs; i++)
+		{
+			while (gpummgrBgWorkerAllocPoolItem(cuda_context, i,
+												gm_segment_sz, false));
+		}
+	}
+
 	gmemp_head->gmemp_keeper = MyLatch;
 	pg_memory_barrier();
 
@@ -1280,6 +2149,9 @@ gpummgrBgWorkerMain(Datum arg)
 
 			SpinLockRelease(&gmemp_head->lock);
 
+			if (gmpool_head->nitems > 0)
+				gpummgrBgWorkerFillPool(cuda_context);
+
 			ev = WaitLatch(MyLatch,
 						   WL_LATCH_SET |
 						   WL_TIMEOUT |
@@ -1324,6 +2196,14 @@ gpummgrBgWorkerMain(Datum arg)
 				}
 
 				rc = cuMemAlloc(&m_devptr, gmemp_req->bytesize);
+				/*
+				 * Idle pool items on the device may occupy the room; they
+				 * are reproducible, so give them back and retry once.
+				 */
+				if (rc == CUDA_ERROR_OUT_OF_MEMORY &&
+					gpummgrBgWorkerReleasePoolItems(gmemp_req->cuda_dindex,
+													gmemp_req->bytesize) > 0)
+					rc = cuMemAlloc(&m_devptr, gmemp_req->bytesize);
 				if (rc != CUDA_SUCCESS)
 				{
 					elog(WARNING, "failed on cuMemAlloc: %s",
@@ -1528,6 +2408,20 @@ pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_device_preserved_meminfo);
 
+/*
+ * gpu_memory_pool_nitems - max number of the pool items
+ *
+ * Pool never keeps smaller regions than pg_strom.chunk_size, so it is
+ * sufficient to cover pg_strom.gpu_memory_pool_size for all the devices.
+ */
+static int
+gpu_memory_pool_nitems(void)
+{
+	size_t		pool_limit = (size_t)gpu_memory_pool_size_kb << 10;
+
+	return (pool_limit / pgstrom_chunk_size()) * numDevAttrs;
+}
+
 /*
  * pgstrom_startup_gpu_mmgr
  */
@@ -1536,7 +2430,7 @@ pgstrom_startup_gpu_mmgr(void)
 {
 	size_t		required;
 	bool		found;
-	int			i;
+	int			i, k, nitems;
 
 	if (shmem_startup_next)
 		(*shmem_startup_next)();
@@ -1579,6 +2473,37 @@ pgstrom_startup_gpu_mmgr(void)
 		dlist_push_tail(&gmemp_head->gmemp_free_list,
 						&gmemp_head->gmemp_array[i].chain);
 	}
+
+	/*
+	 * GpuMemPoolHead
+	 */
+	nitems = gpu_memory_pool_nitems();
+	required = STROMALIGN(offsetof(GpuMemPoolHead,
+								   pool_devs[numDevAttrs])) +
+		STROMALIGN(sizeof(GpuMemPoolItem) * nitems);
+	gmpool_head = ShmemInitStruct("GPU Device Memory Pool",
+								  required, &found);
+	if (found)
+		elog(ERROR, "Bug? GPU Device Memory Pool exists");
+	memset(gmpool_head, 0, required);
+	SpinLockInit(&gmpool_head->lock);
+	gmpool_head->nitems = nitems;
+	gmpool_head->items = (GpuMemPoolItem *)
+		((char *)gmpool_head + STROMALIGN(offsetof(GpuMemPoolHead,
+												   pool_devs[numDevAttrs])));
+	dlist_init(&gmpool_head->unused_list);
+	for (i=0; i < numDevAttrs; i++)
+	{
+		GpuMemPoolDevice *pool_dev = &gmpool_head->pool_devs[i];
+
+		for (k=0; k <= GPUMEM_POOL_MCLASS_MAX; k++)
+			dlist_init(&pool_dev->free_list[k]);
+	}
+	for (i=0; i < nitems; i++)
+	{
+		dlist_push_tail(&gmpool_head->unused_list,
+						&gmpool_head->items[i].chain);
+	}
 }
 
 /*
@@ -1667,6 +2592,14 @@ pgstrom_init_gpu_mmgr(void)
 							PGC_SUSET,
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
+	DefineCustomBoolVariable("pg_strom.nvme_strom_gpu_visibility",
+							 "Enables visibility checks on GPU for the blocks loaded by SSD-to-GPU P2P DMA",
+							 NULL,
+							 &nvme_strom_gpu_visibility,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 
 	/* pg_strom.max_nchunks_for_multi_processes */
 	DefineCustomIntVariable("pg_strom.max_num_preserved_gpu_memory",
@@ -1679,6 +2612,31 @@ pgstrom_init_gpu_mmgr(void)
 							PGC_POSTMASTER,
 							GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
+	/* pg_strom.host_memory_arena_size */
+	DefineCustomIntVariable("pg_strom.host_memory_arena_size",
+							"size of pinned host memory kept per process for recycling",
+							NULL,
+							&host_memory_arena_size_kb,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	SpinLockInit(&hostmem_arena_lock);
+	dlist_init(&hostmem_arena_free_list);
+
+	/* pg_strom.gpu_memory_pool_size */
+	DefineCustomIntVariable("pg_strom.gpu_memory_pool_size",
+							"size of GPU device memory pool per device, kept by the GPU memory keeper",
+							NULL,
+							&gpu_memory_pool_size_kb,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	/*
 	 * Background workers per device, to keep device memory for multi-process
 	 */
@@ -1698,7 +2656,9 @@ pgstrom_init_gpu_mmgr(void)
 	 */
 	required = STROMALIGN(sizeof(GpuMemStatistics) * numDevAttrs) +
 		STROMALIGN(offsetof(GpuMemPreservedHead,
-							gmemp_array[num_preserved_gpu_memory_regions]));
+							gmemp_array[num_preserved_gpu_memory_regions])) +
+		STROMALIGN(offsetof(GpuMemPoolHead, pool_devs[numDevAttrs])) +
+		STROMALIGN(sizeof(GpuMemPoolItem) * gpu_memory_pool_nitems());
 	RequestAddinShmemSpace(required);
 	shmem_startup_next = shmem_startup_hook;
 	shmem_startup_hook = pgstrom_startup_gpu_mmgr;
@@ -1710,6 +2670,12 @@ pgstrom_init_gpu_mmgr(void)
  *
  * ---------------------------------------------------------------- */
 
+/*
+ * Identifier of the SSD-to-GPU P2P DMA kicked by this worker thread, but
+ * not waited for its completion yet. (0 means no pending DMA)
+ */
+static __thread unsigned long	ssd2gpu_pending_task_id = 0UL;
+
 /*
  * gpuMemCopyFromSSDWaitRaw
  */
@@ -1732,10 +2698,48 @@ retry:
 }
 
 /*
- * gpuMemCopyFromSSD - kick SSD-to-GPU Direct DMA, then wait for completion
+ * gpuMemCopyFromSSDWait - wait for completion of the SSD-to-GPU P2P DMA
+ * kicked by gpuMemCopyFromSSDAsync, if any.
  */
 void
-gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
+gpuMemCopyFromSSDWait(void)
+{
+	unsigned long	dma_task_id = ssd2gpu_pending_task_id;
+
+	if (dma_task_id != 0UL)
+	{
+		ssd2gpu_pending_task_id = 0UL;
+		gpuMemCopyFromSSDWaitRaw(GpuWorkerCurrentContext, dma_task_id);
+	}
+}
+
+/*
+ * gpuMemCopyFromSSDAbort - wait for completion of the pending SSD-to-GPU
+ * P2P DMA on the error path, prior to release of the destination buffer.
+ * Unlike gpuMemCopyFromSSDWait, it never raises an error.
+ */
+void
+gpuMemCopyFromSSDAbort(void)
+{
+	StromCmd__MemCopyWait cmd;
+
+	if (ssd2gpu_pending_task_id == 0UL)
+		return;
+	memset(&cmd, 0, sizeof(StromCmd__MemCopyWait));
+	cmd.dma_task_id = ssd2gpu_pending_task_id;
+	while (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_WAIT, &cmd) != 0 &&
+		   errno == EINTR);
+	ssd2gpu_pending_task_id = 0UL;
+}
+
+/*
+ * gpuMemCopyFromSSDAsync - kick SSD-to-GPU Direct DMA, but does not wait
+ * for its completion. Caller must call gpuMemCopyFromSSDWait prior to the
+ * kernel launch which references the @m_kds, so RAM2GPU DMA and setup of
+ * the other buffers can run concurrently with the P2P DMA.
+ */
+void
+gpuMemCopyFromSSDAsync(CUdeviceptr m_kds, pgstrom_data_store *pds)
 {
 	GpuContext	   *gcontext = GpuWorkerCurrentContext;
 	StromCmd__MemCopySsdToGpu cmd;
@@ -1747,6 +2751,9 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 	cl_uint			nr_loaded;
 	CUresult		rc;
 
+	/* only one P2P DMA can be pending per worker thread */
+	gpuMemCopyFromSSDWait();
+
 	/* ensure the @m_kds is exactly i/o mapped buffer */
 	Assert(gcontext != NULL);
 	gm_seg = lookupGpuMem(gcontext, m_kds);
@@ -1794,6 +2801,7 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 	/* (1) kick SSD2GPU P2P DMA */
 	if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU, &cmd) != 0)
 		werror("failed on STROM_IOCTL__MEMCPY_SSD2GPU: %m");
+	ssd2gpu_pending_task_id = cmd.dma_task_id;
 
 	/* (2) kick RAM2GPU DMA (earlier half) */
 	rc = cuMemcpyHtoDAsync(m_kds,
@@ -1802,7 +2810,7 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 						   CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 	{
-		gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+		gpuMemCopyFromSSDWait();
 		werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
 	}
 
@@ -1819,12 +2827,20 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 							   CU_STREAM_PER_THREAD);
 		if (rc != CUDA_SUCCESS)
 		{
-			gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+			gpuMemCopyFromSSDWait();
 			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
 		}
 	}
-	/* (4) wait for completion of SSD2GPU P2P DMA */
-	gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+}
+
+/*
+ * gpuMemCopyFromSSD - kick SSD-to-GPU Direct DMA, then wait for completion
+ */
+void
+gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
+{
+	gpuMemCopyFromSSDAsync(m_kds, pds);
+	gpuMemCopyFromSSDWait();
 }
 
 /*
@@ -1834,11 +2850,13 @@ typedef struct
 {
 	Oid		tablespace_oid;
 	bool	nvme_strom_supported;
+	int		numa_node_id;		/* NUMA node of the SSD, or -1 */
 } vfs_nvme_status;
 
 static HTAB	   *vfs_nvme_htable = NULL;
 static Oid		nvme_last_tablespace_oid = InvalidOid;
 static bool		nvme_last_tablespace_supported;
+static int		nvme_last_tablespace_numa_node_id;
 
 static void
 vfs_nvme_cache_callback(Datum arg, int cacheid, uint32 hashvalue)
@@ -1853,13 +2871,15 @@ vfs_nvme_cache_callback(Datum arg, int cacheid, uint32 hashvalue)
 }
 
 static bool
-TablespaceCanUseNvmeStrom(Oid tablespace_oid)
+TablespaceCanUseNvmeStrom(Oid tablespace_oid, int *p_numa_node_id)
 {
 	vfs_nvme_status *entry;
 	const char *pathname;
 	int			fdesc;
 	bool		found;
 
+	if (p_numa_node_id)
+		*p_numa_node_id = -1;
 	if (!nvme_strom_enabled)
 		return false;	/* NVMe-Strom is not configured or enabled */
 
@@ -1869,7 +2889,11 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 	/* quick lookup but sufficient for more than 99.99% cases */
 	if (OidIsValid(nvme_last_tablespace_oid) &&
 		nvme_last_tablespace_oid == tablespace_oid)
+	{
+		if (p_numa_node_id)
+			*p_numa_node_id = nvme_last_tablespace_numa_node_id;
 		return nvme_last_tablespace_supported;
+	}
 
 	if (!vfs_nvme_htable)
 	{
@@ -1891,12 +2915,16 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 	{
 		nvme_last_tablespace_oid = tablespace_oid;
 		nvme_last_tablespace_supported = entry->nvme_strom_supported;
+		nvme_last_tablespace_numa_node_id = entry->numa_node_id;
+		if (p_numa_node_id)
+			*p_numa_node_id = entry->numa_node_id;
 		return entry->nvme_strom_supported;
 	}
 
 	/* check whether the tablespace is supported */
 	entry->tablespace_oid = tablespace_oid;
 	entry->nvme_strom_supported = false;
+	entry->numa_node_id = -1;
 
 	pathname = GetDatabasePath(MyDatabaseId, tablespace_oid);
 	fdesc = open(pathname, O_RDONLY | O_DIRECTORY);
@@ -1909,9 +2937,13 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 	{
 		StromCmd__CheckFile cmd;
 
+		memset(&cmd, 0, sizeof(StromCmd__CheckFile));
 		cmd.fdesc = fdesc;
 		if (nvme_strom_ioctl(STROM_IOCTL__CHECK_FILE, &cmd) == 0)
+		{
 			entry->nvme_strom_supported = true;
+			entry->numa_node_id = cmd.numa_node_id;
+		}
 		else
 		{
 			ereport(DEBUG1,
@@ -1922,6 +2954,9 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 	}
 	nvme_last_tablespace_oid = tablespace_oid;
 	nvme_last_tablespace_supported = entry->nvme_strom_supported;
+	nvme_last_tablespace_numa_node_id = entry->numa_node_id;
+	if (p_numa_node_id)
+		*p_numa_node_id = entry->numa_node_id;
 	return entry->nvme_strom_supported;
 }
 
@@ -1932,7 +2967,60 @@ RelationCanUseNvmeStrom(Relation relation)
 	/* SSD2GPU on temp relation is not supported */
 	if (RelationUsesLocalBuffers(relation))
 		return false;
-	return TablespaceCanUseNvmeStrom(tablespace_oid);
+	/* foreign tables have no heap blocks to read */
+	if (RelationGetForm(relation)->relkind == RELKIND_FOREIGN_TABLE)
+		return false;
+	return TablespaceCanUseNvmeStrom(tablespace_oid, NULL);
+}
+
+/*
+ * PartitionTreeNumberOfBlocks
+ *
+ * It returns total number of blocks (estimated by pg_class.relpages) of
+ * the partitioned table which contains the supplied partition leaf, so
+ * we can evaluate pg_strom.nvme_strom_threshold over the whole scan on
+ * the partitioned table, not individual (may be small) partitions.
+ */
+static BlockNumber
+PartitionTreeNumberOfBlocks(Relation relation)
+{
+	BlockNumber	total_blocks = 0;
+#if PG_VERSION_NUM >= 100000
+	Oid			parent_oid = RelationGetRelid(relation);
+	List	   *relids;
+	ListCell   *lc;
+	HeapTuple	tuple;
+	bool		relispartition;
+
+	if (!relation->rd_rel->relispartition)
+		return 0;
+	/* walk up to the root of the partition tree */
+	do {
+		parent_oid = get_partition_parent(parent_oid);
+		tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(parent_oid));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for relation %u", parent_oid);
+		relispartition = ((Form_pg_class) GETSTRUCT(tuple))->relispartition;
+		ReleaseSysCache(tuple);
+	} while (relispartition);
+
+	relids = find_all_inheritors(parent_oid, NoLock, NULL);
+	foreach (lc, relids)
+	{
+		Form_pg_class	relform;
+
+		tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(lfirst_oid(lc)));
+		if (!HeapTupleIsValid(tuple))
+			continue;	/* concurrently dropped? */
+		relform = (Form_pg_class) GETSTRUCT(tuple);
+		if (relform->relkind == RELKIND_RELATION &&
+			relform->relpages > 0)
+			total_blocks += relform->relpages;
+		ReleaseSysCache(tuple);
+	}
+	list_free(relids);
+#endif
+	return total_blocks;
 }
 
 /*
@@ -1942,6 +3030,7 @@ bool
 RelationWillUseNvmeStrom(Relation relation, BlockNumber *p_nr_blocks)
 {
 	BlockNumber		nr_blocks;
+	BlockNumber		threshold;
 
 	/* at least, storage must support NVMe-Strom */
 	if (!RelationCanUseNvmeStrom(relation))
@@ -1955,7 +3044,11 @@ RelationWillUseNvmeStrom(Relation relation, BlockNumber *p_nr_blocks)
 	 * ReadBuffer().
 	 */
 	nr_blocks = RelationGetNumberOfBlocks(relation);
-	if (nr_blocks < ((size_t)nvme_strom_threshold_kb << 10) / BLCKSZ)
+	threshold = ((size_t)nvme_strom_threshold_kb << 10) / BLCKSZ;
+	if (nr_blocks == 0)
+		return false;
+	if (nr_blocks < threshold &&
+		PartitionTreeNumberOfBlocks(relation) < threshold)
 		return false;
 
 	/*
@@ -1967,6 +3060,28 @@ RelationWillUseNvmeStrom(Relation relation, BlockNumber *p_nr_blocks)
 	return true;
 }
 
+/*
+ * RelationOptimalGpuForNvmeStrom
+ *
+ * It returns index of the GPU device which is the closest to the NVMe-SSD
+ * where the relation stores, if the relation shall be scanned using
+ * SSD-to-GPU Direct mode. Elsewhere, it returns -1; caller can choose any
+ * GPU device.
+ */
+int
+RelationOptimalGpuForNvmeStrom(Relation relation)
+{
+	Oid		tablespace_oid = RelationGetForm(relation)->reltablespace;
+	int		numa_node_id;
+
+	if (!RelationWillUseNvmeStrom(relation, NULL))
+		return -1;
+	if (!TablespaceCanUseNvmeStrom(tablespace_oid, &numa_node_id) ||
+		numa_node_id < 0)
+		return -1;		/* SSDs may be striped over multiple nodes */
+	return pgstrom_choose_gpu_device(numa_node_id);
+}
+
 /*
  * ScanPathWillUseNvmeStrom - Optimizer Hint
  */
@@ -1976,8 +3091,9 @@ ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
 	RangeTblEntry *rte;
 	HeapTuple	tuple;
 	bool		relpersistence;
+	BlockNumber	nr_pages;
 
-	if (!TablespaceCanUseNvmeStrom(baserel->reltablespace))
+	if (!TablespaceCanUseNvmeStrom(baserel->reltablespace, NULL))
 		return false;
 
 	/* unable to apply NVMe-Strom on temporay tables */
@@ -1992,8 +3108,51 @@ ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
 		relpersistence != RELPERSISTENCE_UNLOGGED)
 		return false;
 
-	/* Is number of blocks sufficient to NVMe-Strom? */
-	if (baserel->pages < ((size_t)nvme_strom_threshold_kb << 10))
+	/*
+	 * Is number of blocks sufficient to NVMe-Strom?
+	 *
+	 * If @baserel is a partition leaf, we evaluate the total size of the
+	 * sibling partitions not pruned, because Append node scans them as
+	 * a unit.
+	 */
+	nr_pages = baserel->pages;
+#if PG_VERSION_NUM >= 100000
+	if (baserel->reloptkind == RELOPT_OTHER_MEMBER_REL)
+	{
+		Index		parent_relid = 0;
+		ListCell   *lc;
+
+		foreach (lc, root->append_rel_list)
+		{
+			AppendRelInfo  *apinfo = lfirst(lc);
+
+			if (apinfo->child_relid == baserel->relid)
+			{
+				parent_relid = apinfo->parent_relid;
+				break;
+			}
+		}
+
+		if (parent_relid > 0 &&
+			root->simple_rte_array[parent_relid]->relkind
+			== RELKIND_PARTITIONED_TABLE)
+		{
+			nr_pages = 0;
+			foreach (lc, root->append_rel_list)
+			{
+				AppendRelInfo  *apinfo = lfirst(lc);
+				RelOptInfo	   *child_rel;
+
+				if (apinfo->parent_relid != parent_relid)
+					continue;
+				child_rel = root->simple_rel_array[apinfo->child_relid];
+				if (child_rel && !IS_DUMMY_REL(child_rel))
+					nr_pages += child_rel->pages;
+			}
+		}
+	}
+#endif
+	if (nr_pages < ((size_t)nvme_strom_threshold_kb << 10) / BLCKSZ)
 		return false;
 
 	/* ok, this table scan can use nvme-strom */
@@ -17,6 +17,43 @@
  */
 #include "pg_strom.h"
 
+static int		max_prefetch_tasks;		/* GUC */
+static int		max_gpus_per_scan;		/* GUC */
+static bool		enable_cardinality_feedback;	/* GUC */
+static bool		enable_chunk_coalesce;	/* GUC */
+static bool		enable_bulkinsert;		/* GUC */
+static ExecutorRun_hook_type executor_run_next = NULL;
+
+/*
+ * Cardinality feedback
+ *
+ * GpuPreAgg and GpuJoin record the actual number of groups or join ratios
+ * per plan fingerprint at end of the execution, then the next planning or
+ * execution of the same query shape uses them instead of the estimation.
+ * Entries are kept on a small open-addressing table on the shared memory,
+ * and the least recently used one is replaced on conflicts.
+ */
+#define CARDINALITY_FEEDBACK_NSLOTS		2048
+#define CARDINALITY_FEEDBACK_NPROBES	8
+
+typedef struct
+{
+	cl_uint		fingerprint;	/* 0 means unused slot */
+	cl_int		nvalues;
+	cl_ulong	last_used;
+	double		values[CARDINALITY_FEEDBACK_MAX_VALUES];
+} cardinalityFeedbackEntry;
+
+typedef struct
+{
+	slock_t		lock;
+	cl_ulong	clock;
+	cardinalityFeedbackEntry entries[CARDINALITY_FEEDBACK_NSLOTS];
+} cardinalityFeedbackHead;
+
+static shmem_startup_hook_type shmem_startup_next = NULL;
+static cardinalityFeedbackHead *cfeedback_head = NULL;
+
 /*
  * construct_kern_parambuf
  *
@@ -28,6 +65,7 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext,
 {
 	StringInfoData	str;
 	kern_parambuf  *kparams;
+	Snapshot	snapshot;
 	char		padding[STROMALIGN_LEN];
 	ListCell   *cell;
 	Size		offset;
@@ -176,6 +214,20 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext,
 	kparams = (kern_parambuf *)str.data;
 	kparams->hostptr = (hostptr_t) &kparams->hostptr;
 	kparams->xactStartTimestamp = GetCurrentTransactionStartTimestamp();
+	/* random() of the device follows setseed() of the session */
+	kparams->random_seed = ((cl_ulong)random() << 32) ^ (cl_ulong)random();
+	/*
+	 * GPU kernel can check MVCC visibility of tuples on the blocks loaded
+	 * by SSD-to-GPU P2P DMA using hint-bits, if snapshot is a regular MVCC
+	 * one. Elsewhere, only all-visible blocks are loaded directly.
+	 */
+	snapshot = econtext->ecxt_estate->es_snapshot;
+	if (nvme_strom_gpu_visibility &&
+		IsMVCCSnapshot(snapshot) &&
+		!snapshot->takenDuringRecovery &&
+		!IsolationIsSerializable() &&
+		TransactionIdIsNormal(snapshot->xmin))
+		kparams->xactSnapshotXmin = snapshot->xmin;
 	kparams->length = str.len;
 	kparams->nparams = nparams;
 
@@ -200,11 +252,33 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 	ListCell	   *lc;
 
 	Assert(gts->gcontext == gcontext);
+	gts->gcontext_multi = NULL;		/* set up by GpuScan, if any */
+	gts->num_gcontext_multi = 0;
+	gts->next_gcontext = 0;
 	gts->task_kind = task_kind;
 	gts->program_id = INVALID_PROGRAM_ID;	/* to be set later */
 	gts->kern_params = construct_kern_parambuf(used_params, econtext,
 											   cscan->custom_scan_tlist);
-	if (relation && RelationCanUseColumnarCache(relation))
+	if (relation && RelationIsArrowFdw(relation))
+	{
+		Bitmapset  *referenced = NULL;
+
+		/* arrow_fdw loads only the referenced columns of record batches */
+		foreach (lc, ccache_refs_list)
+		{
+			int		i, anum = lfirst_int(lc);
+
+			if (anum == InvalidAttrNumber)
+			{
+				for (i=0; i < RelationGetNumberOfAttributes(relation); i++)
+					referenced = bms_add_member(referenced, i);
+			}
+			else if (anum > 0)
+				referenced = bms_add_member(referenced, anum-1);
+		}
+		gts->af_state = ExecInitArrowFdw(relation, referenced);
+	}
+	else if (relation && RelationCanUseColumnarCache(relation))
 	{
 		TupleDesc	tupdesc = RelationGetDescr(relation);
 
@@ -265,13 +339,26 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 	}
 #endif
 	gts->ccache_refs = ccache_refs;
+	gts->ccache_zmap_keys = NIL;	/* set up by pgstrom_ccache_init_zonemap */
+	gts->ccache_delta_blocks = NULL;
+	gts->ccache_delta_nblocks = 0;
+	gts->ccache_delta_index = 0;
 	gts->ccache_count = 0;
+	gts->ccache_device_tier = false;	/* caller shall set, if supported */
+	gts->ccache_m_kds = 0UL;
+	gts->cb_jit_fallback = NULL;		/* caller shall set, if supported */
+	gts->program_is_ready = false;
 	gts->scan_done = false;
 
 	InstrInit(&gts->outer_instrument, estate->es_instrument);
 	gts->scan_overflow = NULL;
 	gts->outer_pds_suspend = NULL;
 	gts->nvme_sstate = NULL;
+	gts->outer_brin_index = NULL;	/* set up by GpuScan, if any */
+	gts->outer_brin_keys = NIL;
+	gts->outer_brin_map = NULL;
+	gts->outer_brin_nblocks = 0;
+	gts->outer_brin_skipped = 0;
 
 	/*
 	 * NOTE: initialization of HeapScanDesc was moved to the first try of
@@ -282,11 +369,202 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 	/* callbacks shall be set by the caller */
 	dlist_init(&gts->ready_tasks);
 	gts->num_ready_tasks = 0;
+	dlist_init(&gts->prefetch_tasks);
+	gts->num_prefetch_tasks = 0;
+	gts->num_loader_stalls = 0;
+	gts->num_gpu_stalls = 0;
+	gts->bulk_pending = NULL;
+	gts->num_coalesced_chunks = 0;
+	INSTR_TIME_SET_ZERO(gts->queue_wait_start);
+	gts->queue_wait_time = 0.0;
+	/* timing statistics only when EXPLAIN ANALYZE */
+	memset(&gts->tm_stat_local, 0, sizeof(GpuTaskTimeStat));
+	if ((estate->es_instrument & INSTRUMENT_TIMER) != 0)
+		gts->tm_stat = &gts->tm_stat_local;
+	else
+		gts->tm_stat = NULL;
+	gts->tm_stat_slots = NULL;
+	gts->tm_stat_nslots = 0;
 
 	/* co-operation with CPU parallel (setup by DSM init handler) */
 	gts->pcxt = NULL;
 }
 
+/*
+ * pgstromSetupMultiGpuTaskState
+ *
+ * It attaches GpuContexts on the other devices to the GpuTaskState, to
+ * distribute the chunks of a large scan over multiple GPUs even if only
+ * one process runs the scan. Devices are chosen by PCIe distance from the
+ * primary one (same PCI domain, same NUMA node, then the nearest bus ID),
+ * and SSD2GPU Direct is kept within the same PCI domain. Only the devices
+ * with same compute capability can run the binary built for the primary
+ * device.
+ */
+void
+pgstromSetupMultiGpuTaskState(GpuTaskState *gts, BlockNumber nblocks)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	DevAttributes *primary = &devAttrs[gts->gcontext->cuda_dindex];
+	double		nchunks;
+	int			max_gpus;
+	int		   *dindex;
+	cl_long	   *distance;
+	int			ndevs = 0;
+	int			i, j;
+
+	max_gpus = (max_gpus_per_scan > 0
+				? Min(max_gpus_per_scan, numDevAttrs)
+				: numDevAttrs);
+	/* each GPU should process two chunks at least */
+	nchunks = ((double)nblocks * (double)BLCKSZ /
+			   (double)pgstrom_chunk_size());
+	max_gpus = Min(max_gpus, (int)(nchunks / 2.0));
+	if (max_gpus <= 1)
+		return;
+
+	dindex = palloc(sizeof(int) * numDevAttrs);
+	distance = palloc(sizeof(cl_long) * numDevAttrs);
+	for (i=0; i < numDevAttrs; i++)
+	{
+		DevAttributes *dattrs = &devAttrs[i];
+		cl_long		dist;
+
+		if (dattrs == primary ||
+			dattrs->COMPUTE_CAPABILITY_MAJOR !=
+			primary->COMPUTE_CAPABILITY_MAJOR ||
+			dattrs->COMPUTE_CAPABILITY_MINOR !=
+			primary->COMPUTE_CAPABILITY_MINOR)
+			continue;
+		if (dattrs->PCI_DOMAIN_ID != primary->PCI_DOMAIN_ID)
+		{
+			if (relation && RelationCanUseNvmeStrom(relation))
+				continue;
+			dist = (1L << 32);
+		}
+		else
+			dist = 0;
+		/* crossing the NUMA nodes is more expensive than PCIe switches */
+		if (dattrs->NUMA_NODE_ID != primary->NUMA_NODE_ID)
+			dist += (1L << 16);
+		dist += Abs(dattrs->PCI_BUS_ID - primary->PCI_BUS_ID);
+
+		/* insertion sort by the distance */
+		for (j=ndevs; j > 0 && distance[j-1] > dist; j--)
+		{
+			dindex[j] = dindex[j-1];
+			distance[j] = distance[j-1];
+		}
+		dindex[j] = i;
+		distance[j] = dist;
+		ndevs++;
+	}
+	ndevs = Min(ndevs, max_gpus - 1);
+
+	if (ndevs > 0)
+	{
+		gts->gcontext_multi = palloc0(sizeof(GpuContext *) * ndevs);
+		for (i=0; i < ndevs; i++)
+		{
+			GpuContext *gcontext = AllocGpuContext(dindex[i], false);
+
+			gts->gcontext_multi[gts->num_gcontext_multi++] = gcontext;
+			ActivateGpuContext(gcontext);
+		}
+	}
+	pfree(dindex);
+	pfree(distance);
+}
+
+/*
+ * CHECK_FOR_GPUTASKSTATE - CHECK_FOR_GPUCONTEXT for all the GpuContexts
+ */
+static inline void
+CHECK_FOR_GPUTASKSTATE(GpuTaskState *gts)
+{
+	int		i;
+
+	for (i=0; i < gts->num_gcontext_multi; i++)
+		CHECK_FOR_GPUCONTEXT(gts->gcontext_multi[i]);
+	CHECK_FOR_GPUCONTEXT(gts->gcontext);
+}
+
+/*
+ * dispatch_next_gputask - enqueue a GpuTask to the GpuContext in round-robin
+ *
+ * Caller must hold gts->gcontext->mutex. Worker threads of the other
+ * GpuContexts never acquire their own mutex while holding the one of GTS,
+ * so nested lock here is safe.
+ */
+static void
+dispatch_next_gputask(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuContext *gcontext = gts->gcontext;
+	cl_uint		index;
+
+	if (gts->num_gcontext_multi > 0)
+	{
+		index = gts->next_gcontext++ % (gts->num_gcontext_multi + 1);
+		if (index > 0)
+			gcontext = gts->gcontext_multi[index - 1];
+	}
+	if (gcontext == gts->gcontext)
+		pgstromEnqueueGpuTask(gcontext, gtask);
+	else
+	{
+		pthreadMutexLock(gcontext->mutex);
+		pgstromEnqueueGpuTask(gcontext, gtask);
+		pthreadMutexUnlock(gcontext->mutex);
+	}
+	gts->num_running_tasks++;
+	pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
+}
+
+/*
+ * jit_fallback_gputask
+ *
+ * If the CUDA program is still being built, the task is processed by CPU
+ * fallback on the backend instead of waiting for the build, so the first
+ * execution of ad-hoc queries is never slower than CPU. Once the program
+ * gets ready, the subsequent tasks are sent to GPU.
+ */
+static bool
+jit_fallback_gputask(GpuTaskState *gts, GpuTask *gtask)
+{
+	if (!pgstrom_jit_cpu_fallback ||
+		!gts->cb_jit_fallback ||
+		gts->program_is_ready)
+		return false;
+	if (pgstrom_cuda_program_is_ready(gts->program_id))
+	{
+		gts->program_is_ready = true;
+		return false;
+	}
+	if (!gts->cb_jit_fallback(gts, gtask))
+		return false;
+	gtask->cpu_fallback = true;
+	return true;
+}
+
+/*
+ * load_next_gputask - cb_next_task with timing statistics
+ */
+static GpuTask *
+load_next_gputask(GpuTaskState *gts)
+{
+	GpuTask	   *gtask;
+	instr_time	tv_start;
+
+	if (!gts->tm_stat)
+		return gts->cb_next_task(gts);
+
+	INSTR_TIME_SET_CURRENT(tv_start);
+	gtask = gts->cb_next_task(gts);
+	pgstromTimeStatAddElapsed(gts, GpuTaskPhase_HostLoad, &tv_start);
+
+	return gtask;
+}
+
 /*
  * fetch_next_gputask
  */
@@ -297,10 +575,9 @@ fetch_next_gputask(GpuTaskState *gts)
 	GpuTask		   *gtask;
 	dlist_node	   *dnode;
 	cl_int			local_num_running_tasks;
-	cl_int			global_num_running_tasks;
 	cl_int			ev;
 
-	CHECK_FOR_GPUCONTEXT(gcontext);
+	CHECK_FOR_GPUTASKSTATE(gts);
 
 	pthreadMutexLock(gcontext->mutex);
 	while (!gts->scan_done)
@@ -308,25 +585,40 @@ fetch_next_gputask(GpuTaskState *gts)
 		ResetLatch(MyLatch);
 		local_num_running_tasks = (gts->num_ready_tasks +
 								   gts->num_running_tasks);
-		global_num_running_tasks =
-			pg_atomic_read_u32(gcontext->global_num_running_tasks);
-		if ((local_num_running_tasks < local_max_async_tasks &&
-			 global_num_running_tasks < global_max_async_tasks) ||
+		if ((local_num_running_tasks < (local_max_async_tasks *
+										(gts->num_gcontext_multi + 1)) &&
+			 pgstromGpuTaskAdmission(gts, local_num_running_tasks)) ||
 			(dlist_is_empty(&gts->ready_tasks) &&
 			 gts->num_running_tasks == 0))
 		{
-			pthreadMutexUnlock(gcontext->mutex);
-			gtask = gts->cb_next_task(gts);
-			pthreadMutexLock(gcontext->mutex);
-			if (!gtask)
+			if (!dlist_is_empty(&gts->prefetch_tasks))
 			{
-				gts->scan_done = true;
-				break;
+				/* kick a GpuTask already loaded ahead */
+				dnode = dlist_pop_head_node(&gts->prefetch_tasks);
+				gtask = dlist_container(GpuTask, chain, dnode);
+				gts->num_prefetch_tasks--;
 			}
-			dlist_push_tail(&gcontext->pending_tasks, &gtask->chain);
-			gts->num_running_tasks++;
-			pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
-			pthreadCondSignal(gcontext->cond);
+			else
+			{
+				/* GPU has nothing to do until the loader completes */
+				if (gts->num_running_tasks == 0)
+					gts->num_loader_stalls++;
+				pthreadMutexUnlock(gcontext->mutex);
+				gtask = load_next_gputask(gts);
+				pthreadMutexLock(gcontext->mutex);
+				if (!gtask)
+				{
+					gts->scan_done = true;
+					break;
+				}
+			}
+			/* CPU works on the task by itself, if kernel is not ready */
+			if (jit_fallback_gputask(gts, gtask))
+			{
+				pthreadMutexUnlock(gcontext->mutex);
+				return gtask;
+			}
+			dispatch_next_gputask(gts, gtask);
 		}
 		else if (!dlist_is_empty(&gts->ready_tasks))
 		{
@@ -338,12 +630,31 @@ fetch_next_gputask(GpuTaskState *gts)
 			pthreadMutexUnlock(gcontext->mutex);
 			goto pickup_gputask;
 		}
+		else if (gts->num_prefetch_tasks < max_prefetch_tasks)
+		{
+			/*
+			 * GPU is busy with the running tasks, so load the next chunks
+			 * ahead. They shall be kicked as soon as running tasks get
+			 * completed, without waiting for the loader.
+			 */
+			pthreadMutexUnlock(gcontext->mutex);
+			gtask = load_next_gputask(gts);
+			pthreadMutexLock(gcontext->mutex);
+			if (!gtask)
+			{
+				gts->scan_done = true;
+				break;
+			}
+			dlist_push_tail(&gts->prefetch_tasks, &gtask->chain);
+			gts->num_prefetch_tasks++;
+		}
 		else if (gts->num_running_tasks > 0)
 		{
 			/*
 			 * Even though a few GpuTasks are running, but nobody gets
 			 * completed yet. Try to wait for completion to 
 			 */
+			gts->num_gpu_stalls++;
 			pthreadMutexUnlock(gcontext->mutex);
 
 			ev = WaitLatch(MyLatch,
@@ -359,7 +670,7 @@ fetch_next_gputask(GpuTaskState *gts)
 				ereport(FATAL,
 						(errcode(ERRCODE_ADMIN_SHUTDOWN),
 						 errmsg("Unexpected Postmaster dead")));
-			CHECK_FOR_GPUCONTEXT(gcontext);
+			CHECK_FOR_GPUTASKSTATE(gts);
 
 			pthreadMutexLock(gcontext->mutex);
 		}
@@ -371,7 +682,7 @@ fetch_next_gputask(GpuTaskState *gts)
 			 */
 			pg_usleep(20000L);	/* wait for 20msec */
 
-			CHECK_FOR_GPUCONTEXT(gcontext);
+			CHECK_FOR_GPUTASKSTATE(gts);
 			pthreadMutexLock(gcontext->mutex);
 		}
 	}
@@ -383,6 +694,16 @@ fetch_next_gputask(GpuTaskState *gts)
 	 */
 	Assert(gts->scan_done);
 	pthreadMutexLock(gcontext->mutex);
+	/* no more admission is needed */
+	pgstromGpuTaskAdmissionDone(gts);
+	/* kick the remaining GpuTasks loaded ahead, if any */
+	while (!dlist_is_empty(&gts->prefetch_tasks))
+	{
+		dnode = dlist_pop_head_node(&gts->prefetch_tasks);
+		gtask = dlist_container(GpuTask, chain, dnode);
+		gts->num_prefetch_tasks--;
+		dispatch_next_gputask(gts, gtask);
+	}
 retry:
 	ResetLatch(MyLatch);
 	while (dlist_is_empty(&gts->ready_tasks))
@@ -392,7 +713,7 @@ retry:
 		{
 			pthreadMutexUnlock(gcontext->mutex);
 
-			CHECK_FOR_GPUCONTEXT(gcontext);
+			CHECK_FOR_GPUTASKSTATE(gts);
 
 			if (gts->cb_terminator_task)
 			{
@@ -410,11 +731,7 @@ retry:
 					}
 					else
 					{
-						dlist_push_tail(&gcontext->pending_tasks,
-										&gtask->chain);
-						gts->num_running_tasks++;
-						pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
-						pthreadCondSignal(gcontext->cond);
+						dispatch_next_gputask(gts, gtask);
 					}
 					goto retry;
 				}
@@ -424,7 +741,7 @@ retry:
 		}
 		pthreadMutexUnlock(gcontext->mutex);
 
-		CHECK_FOR_GPUCONTEXT(gcontext);
+		CHECK_FOR_GPUTASKSTATE(gts);
 
 		ev = WaitLatch(MyLatch,
 					   WL_LATCH_SET |
@@ -454,6 +771,25 @@ pickup_gputask:
 	return gtask;
 }
 
+/*
+ * exec_next_tuple - cb_next_tuple with timing statistics of CPU fallback
+ */
+static inline TupleTableSlot *
+exec_next_tuple(GpuTaskState *gts)
+{
+	TupleTableSlot *slot;
+	instr_time		tv_start;
+
+	if (!gts->tm_stat || !gts->curr_task->cpu_fallback)
+		return gts->cb_next_tuple(gts);
+
+	INSTR_TIME_SET_CURRENT(tv_start);
+	slot = gts->cb_next_tuple(gts);
+	pgstromTimeStatAddElapsed(gts, GpuTaskPhase_CpuFallback, &tv_start);
+
+	return slot;
+}
+
 /*
  * pgstromExecGpuTaskState
  */
@@ -462,13 +798,14 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 {
 	TupleTableSlot *slot = gts->css.ss.ss_ScanTupleSlot;
 
-	while (!gts->curr_task || !(slot = gts->cb_next_tuple(gts)))
+	while (!gts->curr_task || !(slot = exec_next_tuple(gts)))
 	{
 		GpuTask	   *gtask = gts->curr_task;
 
 		/* release the current GpuTask object that was already scanned */
 		if (gtask)
 		{
+			PDS_fetch_tuple_restore(gts);
 			gts->cb_release_task(gtask);
 			gts->curr_task = NULL;
 			gts->curr_index = 0;
@@ -490,6 +827,669 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 	return slot;
 }
 
+/*
+ * pgstromBulkExecEnabled
+ *
+ * It checks whether @gts can pull the result data stores of the outer
+ * GPU node as-is, using pgstromBulkExecGpuTaskState().
+ */
+bool
+pgstromBulkExecEnabled(GpuTaskState *gts, PlanState *outer_ps)
+{
+	GpuTaskState   *outer_gts = (GpuTaskState *) outer_ps;
+
+	if (!pgstrom_bulkexec_enabled || !outer_ps)
+		return false;
+	/* only GpuJoin provides the results in a data store right now */
+	if (!pgstrom_planstate_is_gpujoin(outer_ps) ||
+		!outer_gts->cb_bulk_exec)
+		return false;
+	/* data store must be accessible on the same GpuContext */
+	if (outer_gts->gcontext != gts->gcontext)
+		return false;
+	/* no host-side qualifiers and projection on the outer node */
+	if (outer_ps->qual != NULL || outer_ps->ps_ProjInfo != NULL)
+		return false;
+	return true;
+}
+
+/*
+ * pgstromBulkExecGpuTaskState
+ *
+ * It returns the next result data store of the GpuTaskState, instead of
+ * row-by-row ExecProcNode(). An upper GPU node on the same GpuContext can
+ * use it as a source data store, so the results of GPU kernel stay on the
+ * managed memory and never re-packed by CPU. Rows by CPU fallback are packed
+ * into a new data store. NULL means no more rows.
+ */
+static pgstrom_data_store *
+__pgstromBulkExecGpuTaskState(GpuTaskState *gts)
+{
+	TupleDesc		tupdesc = GTS_GET_SCAN_TUPDESC(gts);
+	TupleTableSlot *slot;
+	pgstrom_data_store *pds = NULL;
+	GpuTask		   *gtask;
+
+	/* a data store not coalesced at the last call, if any */
+	if (gts->bulk_pending)
+	{
+		pds = gts->bulk_pending;
+		gts->bulk_pending = NULL;
+		return pds;
+	}
+
+	for (;;)
+	{
+		gtask = gts->curr_task;
+		if (gtask)
+		{
+			if (!gtask->cpu_fallback)
+			{
+				pds = gts->cb_bulk_exec(gts, gtask);
+				if (pds)
+					return pds;
+			}
+			else
+			{
+				/* a row not inserted at the last call, if any */
+				if (gts->bulk_overflow)
+				{
+					pds = PDS_create_row(gts->gcontext,
+										 tupdesc,
+										 pgstrom_chunk_size());
+					if (!PDS_insert_tuple(pds, gts->bulk_overflow))
+						elog(ERROR, "too large tuple for pg_strom.chunk_size");
+					gts->bulk_overflow = NULL;
+				}
+				while ((slot = exec_next_tuple(gts)) != NULL)
+				{
+					if (!pds)
+						pds = PDS_create_row(gts->gcontext,
+											 tupdesc,
+											 pgstrom_chunk_size());
+					if (!PDS_insert_tuple(pds, slot))
+					{
+						gts->bulk_overflow = slot;
+						return pds;
+					}
+				}
+			}
+			/* release the current GpuTask object that was already scanned */
+			PDS_fetch_tuple_restore(gts);
+			gts->cb_release_task(gtask);
+			gts->curr_task = NULL;
+			gts->curr_index = 0;
+			gts->curr_lp_index = 0;
+			if (pds)
+				return pds;
+		}
+		/* reload next chunk to be scanned */
+		gtask = fetch_next_gputask(gts);
+		if (!gtask)
+			return NULL;
+		if (gtask->cpu_fallback)
+			gts->num_cpu_fallbacks++;
+		gts->curr_task = gtask;
+		gts->curr_index = 0;
+		gts->curr_lp_index = 0;
+		/* notify a new task is assigned */
+		if (gts->cb_switch_task)
+			gts->cb_switch_task(gts, gtask);
+	}
+}
+
+/*
+ * bulkexec_coalesce_threshold
+ *
+ * It returns the length of data store that takes as long as the fixed
+ * per-task overhead (kernel launches, events and DMA setup) to transfer,
+ * scaled by the acceptable overhead ratio, based on the calibrated DMA
+ * bandwidth and launch latency of the device.
+ */
+#define BULKEXEC_COALESCE_NLAUNCHES		4		/* typical launches per task */
+#define BULKEXEC_COALESCE_OVERHEAD		0.10	/* acceptable overhead ratio */
+
+static Size
+bulkexec_coalesce_threshold(GpuTaskState *gts)
+{
+	DevAttributes *dattrs = &devAttrs[gts->gcontext->cuda_dindex];
+	double		bandwidth;		/* MB/s */
+	double		latency;		/* ns */
+	double		threshold;
+
+	bandwidth = (dattrs->DEV_DMA_BANDWIDTH > 0
+				 ? (double)dattrs->DEV_DMA_BANDWIDTH
+				 : GPU_COST_REFERENCE_DMA_BANDWIDTH);
+	latency = (dattrs->DEV_LAUNCH_LATENCY > 0
+			   ? (double)dattrs->DEV_LAUNCH_LATENCY
+			   : GPU_COST_REFERENCE_LAUNCH_LATENCY);
+	threshold = (bandwidth * 1.0e6) *
+		(latency * BULKEXEC_COALESCE_NLAUNCHES * 1.0e-9) /
+		BULKEXEC_COALESCE_OVERHEAD;
+	return (Size) Min(threshold, (double)(pgstrom_chunk_size() / 2));
+}
+
+#define PDS_ROW_LENGTH(pds)							\
+	KDS_CALCULATE_ROW_LENGTH((pds)->kds.ncols,		\
+							 (pds)->kds.nitems,		\
+							 (pds)->kds.usage)
+
+/*
+ * bulkexec_coalesce_chunks
+ *
+ * Highly selective outer GPU node produces many small result data stores,
+ * then per-task overhead of the upper node dominates. So, it packs the
+ * following small ones into a chunk-sized data store until its length
+ * reaches the threshold. A data store not to be packed is kept in
+ * @bulk_pending, and returned on the next call.
+ */
+static pgstrom_data_store *
+bulkexec_coalesce_chunks(GpuTaskState *gts, pgstrom_data_store *pds)
+{
+	pgstrom_data_store *pds_next;
+	bool		pds_is_own = false;
+	Size		threshold;
+
+	if (pds->kds.format != KDS_FORMAT_ROW)
+		return pds;
+	threshold = bulkexec_coalesce_threshold(gts);
+	while (PDS_ROW_LENGTH(pds) < threshold)
+	{
+		pds_next = __pgstromBulkExecGpuTaskState(gts);
+		if (!pds_next)
+			break;
+		if (pds_next->kds.format != KDS_FORMAT_ROW ||
+			PDS_ROW_LENGTH(pds_next) >= threshold)
+		{
+			gts->bulk_pending = pds_next;
+			break;
+		}
+
+		if (!pds_is_own)
+		{
+			pgstrom_data_store *pds_new
+				= PDS_create_row(gts->gcontext,
+								 GTS_GET_SCAN_TUPDESC(gts),
+								 pgstrom_chunk_size());
+			pds_new->kds.table_oid = pds->kds.table_oid;
+			if (!KDS_append_rows(&pds_new->kds, &pds->kds))
+				elog(ERROR, "Bug? small data store could not be coalesced");
+			PDS_release(pds);
+			pds = pds_new;
+			pds_is_own = true;
+		}
+		if (!KDS_append_rows(&pds->kds, &pds_next->kds))
+		{
+			gts->bulk_pending = pds_next;
+			break;
+		}
+		PDS_release(pds_next);
+		gts->num_coalesced_chunks++;
+	}
+	return pds;
+}
+
+pgstrom_data_store *
+pgstromBulkExecGpuTaskState(GpuTaskState *gts)
+{
+	Instrumentation *instrument = gts->css.ss.ps.instrument;
+	pgstrom_data_store *pds;
+
+	Assert(gts->cb_bulk_exec != NULL);
+	/* ExecProcNode() is bypassed, so instrumentation is our job */
+	if (instrument)
+		InstrStartNode(instrument);
+	pds = __pgstromBulkExecGpuTaskState(gts);
+	if (pds && enable_chunk_coalesce)
+		pds = bulkexec_coalesce_chunks(gts, pds);
+	if (instrument)
+		InstrStopNode(instrument, !pds ? 0.0 : (double)pds->kds.nitems);
+	return pds;
+}
+
+/*
+ * Bulk-insert of the GPU results
+ *
+ * When results of a GPU node are written to a heap table as-is, by
+ * INSERT ... SELECT, CREATE TABLE AS or REFRESH MATERIALIZED VIEW, we pull
+ * the result data stores using pgstromBulkExecGpuTaskState(), then put
+ * the heap tuples formed by GPU kernel onto the heap pages by
+ * heap_multi_insert(), instead of the per-tuple slot conversion and
+ * heap_insert(). GPU nodes without bulk-exec support still use the
+ * row-by-row ExecProcNode(), but their tuples are inserted by batch.
+ *
+ * MEMO: CREATE TABLE AS and REFRESH MATERIALIZED VIEW keep the target
+ * relation on the private state of their DestReceiver (DR_intorel in
+ * createas.c and DR_transientrel in matview.c). We mirror their layouts
+ * below; these are identical on PG9.6 and PG10.
+ */
+typedef struct
+{
+	DestReceiver	pub;
+	IntoClause	   *into;
+	Relation		rel;
+	CommandId		output_cid;
+	int				hi_options;
+	BulkInsertState	bistate;
+} bulkinsertIntoRelReceiver;
+
+typedef struct
+{
+	DestReceiver	pub;
+	Oid				transientoid;
+	Relation		transientrel;
+	CommandId		output_cid;
+	int				hi_options;
+	BulkInsertState	bistate;
+} bulkinsertTransientRelReceiver;
+
+#define BULKINSERT_MAX_TUPLES		1000
+#define BULKINSERT_MAX_LENGTH		(256 * 1024)
+
+typedef struct
+{
+	Relation		relation;
+	CommandId		cid;
+	int				options;
+	BulkInsertState	bistate;
+	MemoryContext	memcxt;		/* per-batch memory context */
+	int				ntuples;
+	Size			length;
+	HeapTuple		tuples[BULKINSERT_MAX_TUPLES];
+} bulkinsertState;
+
+/*
+ * bulkinsert_source_planstate
+ *
+ * It returns the GPU node whose results can be written to the target
+ * relation as-is, or NULL.
+ */
+static PlanState *
+bulkinsert_source_planstate(PlanState *ps)
+{
+	if (!pgstrom_planstate_is_gpuscan(ps) &&
+		!pgstrom_planstate_is_gpujoin(ps) &&
+		!pgstrom_planstate_is_gpupreagg(ps))
+		return NULL;
+	/* no host-side qualifiers and projection on the GPU node */
+	if (ps->qual != NULL || ps->ps_ProjInfo != NULL)
+		return NULL;
+	return ps;
+}
+
+/*
+ * bulkinsert_relation_is_supported
+ *
+ * It checks whether tuples of @tupdesc can be inserted to @relation
+ * without per-tuple jobs of the executor, except for NOT NULL checks.
+ */
+static bool
+bulkinsert_relation_is_supported(Relation relation, TupleDesc tupdesc)
+{
+	TupleDesc	rel_tupdesc = RelationGetDescr(relation);
+	TupleConstr *constr = rel_tupdesc->constr;
+	int			j;
+
+	if (relation->rd_rel->relkind != RELKIND_RELATION ||
+		relation->rd_rel->relhasoids ||
+		IsCatalogRelation(relation) ||
+		relation->trigdesc != NULL)
+		return false;
+#if PG_VERSION_NUM >= 100000
+	if (relation->rd_rel->relispartition)
+		return false;
+#endif
+	if (constr && constr->num_check > 0)
+		return false;
+	/* tuples formed on the source must have identical layout */
+	if (tupdesc->natts != rel_tupdesc->natts)
+		return false;
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute	attr = tupdesc->attrs[j];
+		Form_pg_attribute	rel_attr = rel_tupdesc->attrs[j];
+
+		if (attr->attisdropped ||
+			rel_attr->attisdropped ||
+			attr->atttypid != rel_attr->atttypid)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * bulkinsert_flush_tuples
+ */
+static void
+bulkinsert_flush_tuples(bulkinsertState *bistate)
+{
+	Relation	relation = bistate->relation;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	MemoryContext oldcxt;
+	int			i, j;
+
+	if (bistate->ntuples == 0)
+		return;
+	/* NOT NULL constraint is only what we have to check */
+	if (tupdesc->constr && tupdesc->constr->has_not_null)
+	{
+		for (j=0; j < tupdesc->natts; j++)
+		{
+			if (!tupdesc->attrs[j]->attnotnull)
+				continue;
+			for (i=0; i < bistate->ntuples; i++)
+			{
+				if (heap_attisnull(bistate->tuples[i], j+1))
+					ereport(ERROR,
+							(errcode(ERRCODE_NOT_NULL_VIOLATION),
+							 errmsg("null value in column \"%s\" violates not-null constraint",
+									NameStr(tupdesc->attrs[j]->attname)),
+							 errtablecol(relation, j+1)));
+			}
+		}
+	}
+	/* toasted copies of the tuples, if any, are also released on reset */
+	oldcxt = MemoryContextSwitchTo(bistate->memcxt);
+	heap_multi_insert(relation,
+					  bistate->tuples,
+					  bistate->ntuples,
+					  bistate->cid,
+					  bistate->options,
+					  bistate->bistate);
+	MemoryContextSwitchTo(oldcxt);
+	bistate->ntuples = 0;
+	bistate->length = 0;
+	MemoryContextReset(bistate->memcxt);
+}
+
+/*
+ * bulkinsert_exec_pds - inserts all the rows in the result data store
+ */
+static uint64
+bulkinsert_exec_pds(bulkinsertState *bistate, pgstrom_data_store *pds)
+{
+	kern_data_store *kds = &pds->kds;
+	TupleDesc	tupdesc = RelationGetDescr(bistate->relation);
+	Oid			table_oid = RelationGetRelid(bistate->relation);
+	cl_uint		i;
+
+	for (i=0; i < kds->nitems; i++)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(bistate->memcxt);
+		HeapTuple	tuple;
+
+		if (kds->format == KDS_FORMAT_ROW)
+		{
+			kern_tupitem   *tup_item = KERN_DATA_STORE_TUPITEM(kds, i);
+
+			/* heap tuple formed by GPU kernel is inserted as is */
+			tuple = palloc(sizeof(HeapTupleData));
+			tuple->t_len = tup_item->t_len;
+			ItemPointerSetInvalid(&tuple->t_self);
+			tuple->t_tableOid = table_oid;
+			tuple->t_data = &tup_item->htup;
+		}
+		else if (kds->format == KDS_FORMAT_SLOT)
+		{
+			tuple = heap_form_tuple(tupdesc,
+									KERN_DATA_STORE_VALUES(kds, i),
+									(bool *)KERN_DATA_STORE_ISNULL(kds, i));
+			tuple->t_tableOid = table_oid;
+		}
+		else
+			elog(ERROR, "Bug? unexpected data store format: %d",
+				 kds->format);
+		MemoryContextSwitchTo(oldcxt);
+
+		bistate->tuples[bistate->ntuples++] = tuple;
+		bistate->length += tuple->t_len;
+		if (bistate->ntuples >= BULKINSERT_MAX_TUPLES ||
+			bistate->length >= BULKINSERT_MAX_LENGTH)
+			bulkinsert_flush_tuples(bistate);
+	}
+	/* tuples must not reference the data store to be released */
+	bulkinsert_flush_tuples(bistate);
+
+	return kds->nitems;
+}
+
+/*
+ * bulkinsert_exec_plan
+ */
+static uint64
+bulkinsert_exec_plan(PlanState *ps, Relation relation, CommandId cid,
+					 int options, BulkInsertState heap_bistate)
+{
+	bulkinsertState *bistate;
+	GpuTaskState   *gts = (GpuTaskState *) ps;
+	uint64			nprocessed = 0;
+
+	bistate = palloc0(sizeof(bulkinsertState));
+	bistate->relation = relation;
+	bistate->cid = cid;
+	bistate->options = options;
+	bistate->bistate = heap_bistate;
+	bistate->memcxt = AllocSetContextCreate(CurrentMemoryContext,
+											"bulk-insert tuples",
+											ALLOCSET_DEFAULT_SIZES);
+	if (gts->cb_bulk_exec)
+	{
+		pgstrom_data_store *pds;
+
+		while ((pds = pgstromBulkExecGpuTaskState(gts)) != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+			nprocessed += bulkinsert_exec_pds(bistate, pds);
+			PDS_release(pds);
+		}
+	}
+	else
+	{
+		TupleTableSlot *slot;
+
+		for (;;)
+		{
+			MemoryContext	oldcxt;
+			HeapTuple		tuple;
+
+			slot = ExecProcNode(ps);
+			if (TupIsNull(slot))
+				break;
+			oldcxt = MemoryContextSwitchTo(bistate->memcxt);
+			tuple = ExecCopySlotTuple(slot);
+			tuple->t_tableOid = RelationGetRelid(relation);
+			MemoryContextSwitchTo(oldcxt);
+
+			bistate->tuples[bistate->ntuples++] = tuple;
+			bistate->length += tuple->t_len;
+			if (bistate->ntuples >= BULKINSERT_MAX_TUPLES ||
+				bistate->length >= BULKINSERT_MAX_LENGTH)
+				bulkinsert_flush_tuples(bistate);
+			nprocessed++;
+		}
+		bulkinsert_flush_tuples(bistate);
+	}
+	MemoryContextDelete(bistate->memcxt);
+	pfree(bistate);
+
+	return nprocessed;
+}
+
+/*
+ * bulkinsert_check_modify_table - INSERT ... SELECT
+ */
+static PlanState *
+bulkinsert_check_modify_table(QueryDesc *queryDesc)
+{
+	ModifyTableState *mtstate = (ModifyTableState *) queryDesc->planstate;
+	ResultRelInfo  *rrinfo;
+	PlanState	   *ps;
+
+	if (queryDesc->operation != CMD_INSERT ||
+		!IsA(mtstate, ModifyTableState) ||
+		mtstate->operation != CMD_INSERT ||
+		mtstate->mt_nplans != 1 ||
+		mtstate->mt_onconflict != ONCONFLICT_NONE ||
+		queryDesc->plannedstmt->hasReturning)
+		return NULL;
+#if PG_VERSION_NUM >= 100000
+	if (mtstate->mt_partition_dispatch_info != NULL)
+		return NULL;
+#endif
+	rrinfo = mtstate->resultRelInfo;
+	if (rrinfo->ri_NumIndices > 0 ||
+		rrinfo->ri_TrigDesc != NULL ||
+		rrinfo->ri_FdwRoutine != NULL ||
+		rrinfo->ri_WithCheckOptions != NIL ||
+		rrinfo->ri_projectReturning != NULL)
+		return NULL;
+	ps = bulkinsert_source_planstate(mtstate->mt_plans[0]);
+	if (!ps ||
+		!bulkinsert_relation_is_supported(rrinfo->ri_RelationDesc,
+										  ExecGetResultType(ps)))
+		return NULL;
+	return ps;
+}
+
+/*
+ * pgstrom_bulkinsert_executor_run
+ */
+static void
+pgstrom_bulkinsert_executor_run(QueryDesc *queryDesc,
+								ScanDirection direction,
+#if PG_VERSION_NUM < 100000
+								uint64 count
+#else
+								uint64 count,
+								bool execute_once
+#endif
+	)
+{
+	EState		   *estate = queryDesc->estate;
+	DestReceiver   *dest = queryDesc->dest;
+	MemoryContext	oldcxt;
+	PlanState	   *ps = NULL;
+	Relation		relation = NULL;
+	CommandId		cid = InvalidCommandId;
+	int				options = 0;
+	BulkInsertState	heap_bistate = NULL;
+	bool			own_bistate = false;
+
+	if (enable_bulkinsert &&
+		ScanDirectionIsForward(direction) &&
+		count == 0 &&
+		!queryDesc->plannedstmt->parallelModeNeeded &&
+		!queryDesc->plannedstmt->hasModifyingCTE &&
+		(estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
+	{
+		if (queryDesc->operation == CMD_INSERT)
+			ps = bulkinsert_check_modify_table(queryDesc);
+		else if (queryDesc->operation == CMD_SELECT &&
+				 (dest->mydest == DestIntoRel ||
+				  dest->mydest == DestTransientRel))
+			ps = bulkinsert_source_planstate(queryDesc->planstate);
+	}
+
+	if (!ps)
+	{
+		if (executor_run_next)
+			executor_run_next(queryDesc, direction,
+#if PG_VERSION_NUM < 100000
+							  count
+#else
+							  count, execute_once
+#endif
+				);
+		else
+			standard_ExecutorRun(queryDesc, direction,
+#if PG_VERSION_NUM < 100000
+								 count
+#else
+								 count, execute_once
+#endif
+				);
+		return;
+	}
+
+	/* almost same as standard_ExecutorRun() and ExecutePlan() */
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	if (queryDesc->totaltime)
+		InstrStartNode(queryDesc->totaltime);
+	estate->es_processed = 0;
+	estate->es_lastoid = InvalidOid;
+	estate->es_direction = direction;
+#if PG_VERSION_NUM >= 100000
+	if (execute_once && queryDesc->already_executed)
+		elog(ERROR, "can't re-execute query flagged for single execution");
+	queryDesc->already_executed = true;
+#endif
+
+	if (queryDesc->operation == CMD_INSERT)
+	{
+		ModifyTableState *mtstate = (ModifyTableState *) queryDesc->planstate;
+
+		relation = mtstate->resultRelInfo->ri_RelationDesc;
+		cid = estate->es_output_cid;
+		heap_bistate = GetBulkInsertState();
+		own_bistate = true;
+	}
+	else
+	{
+		/* the receiver opens (or creates) the target relation */
+		(*dest->rStartup) (dest, queryDesc->operation, queryDesc->tupDesc);
+		if (dest->mydest == DestIntoRel)
+		{
+			bulkinsertIntoRelReceiver *myState
+				= (bulkinsertIntoRelReceiver *) dest;
+
+			relation = myState->rel;
+			cid = myState->output_cid;
+			options = myState->hi_options;
+			heap_bistate = myState->bistate;
+		}
+		else
+		{
+			bulkinsertTransientRelReceiver *myState
+				= (bulkinsertTransientRelReceiver *) dest;
+
+			relation = myState->transientrel;
+			cid = myState->output_cid;
+			options = myState->hi_options;
+			heap_bistate = myState->bistate;
+		}
+	}
+
+	if (bulkinsert_relation_is_supported(relation, ExecGetResultType(ps)))
+		estate->es_processed = bulkinsert_exec_plan(ps, relation, cid,
+													options, heap_bistate);
+	else
+	{
+		TupleTableSlot *slot;
+
+		/* the receiver inserts the tuples one by one */
+		Assert(queryDesc->operation == CMD_SELECT);
+		for (;;)
+		{
+			CHECK_FOR_INTERRUPTS();
+			slot = ExecProcNode(ps);
+			if (TupIsNull(slot))
+				break;
+			if (!(*dest->receiveSlot) (slot, dest))
+				break;
+			estate->es_processed++;
+		}
+	}
+	(void) ExecShutdownNode(queryDesc->planstate);
+
+	if (own_bistate)
+		FreeBulkInsertState(heap_bistate);
+	else
+		(*dest->rShutdown) (dest);
+	if (queryDesc->totaltime)
+		InstrStopNode(queryDesc->totaltime, estate->es_processed);
+	MemoryContextSwitchTo(oldcxt);
+}
+
 /*
  * pgstromRescanGpuTaskState
  */
@@ -498,6 +1498,9 @@ pgstromRescanGpuTaskState(GpuTaskState *gts)
 {
 	HeapScanDesc	scan = gts->css.ss.ss_currentScanDesc;
 
+	/* slot should not reference the PDS to be released */
+	PDS_fetch_tuple_restore(gts);
+
 	/*
 	 * release all the unprocessed tasks
 	 */
@@ -509,14 +1512,35 @@ pgstromRescanGpuTaskState(GpuTaskState *gts)
 		Assert(gts->num_ready_tasks >= 0);
 		gts->cb_release_task(gtask);
 	}
+	while (!dlist_is_empty(&gts->prefetch_tasks))
+	{
+		dlist_node *dnode = dlist_pop_head_node(&gts->prefetch_tasks);
+		GpuTask	   *gtask = dlist_container(GpuTask, chain, dnode);
+		gts->num_prefetch_tasks--;
+		gts->cb_release_task(gtask);
+	}
+	gts->bulk_overflow = NULL;
+	if (gts->bulk_pending)
+	{
+		PDS_release(gts->bulk_pending);
+		gts->bulk_pending = NULL;
+	}
 
 	/*
 	 * rewind the scan position if GTS scans a table
 	 */
+	if (gts->af_state)
+	{
+		InstrEndLoop(&gts->outer_instrument);
+		ExecReScanArrowFdw(gts->af_state);
+	}
 	if (scan)
 	{
 		InstrEndLoop(&gts->outer_instrument);
 		heap_rescan(scan, NULL);
+		/* discard delta blocks of the columnar cache */
+		gts->ccache_delta_nblocks = 0;
+		gts->ccache_delta_index = 0;
 #if PG_VERSION_NUM < 100000
 		/*
 		 * In PG9.6, re-initialization of DSM segment is a role of ReScan
@@ -543,6 +1567,11 @@ pgstromRescanGpuTaskState(GpuTaskState *gts)
 void
 pgstromReleaseGpuTaskState(GpuTaskState *gts)
 {
+	int		i;
+
+	/* slot should not reference the PDS to be released */
+	PDS_fetch_tuple_restore(gts);
+
 	/*
 	 * release any unprocessed tasks
 	 */
@@ -554,19 +1583,100 @@ pgstromReleaseGpuTaskState(GpuTaskState *gts)
 		Assert(gts->num_ready_tasks >= 0);
 		gts->cb_release_task(gtask);
 	}
+	while (!dlist_is_empty(&gts->prefetch_tasks))
+	{
+		dlist_node *dnode = dlist_pop_head_node(&gts->prefetch_tasks);
+		GpuTask	   *gtask = dlist_container(GpuTask, chain, dnode);
+		gts->num_prefetch_tasks--;
+		gts->cb_release_task(gtask);
+	}
+	if (gts->bulk_pending)
+		PDS_release(gts->bulk_pending);
 	/* cleanup per-query PDS-scan state, if any */
 	PDS_end_heapscan_state(gts);
 	InstrEndLoop(&gts->outer_instrument);
 	/* release scan-desc if any */
 	if (gts->css.ss.ss_currentScanDesc)
 		heap_endscan(gts->css.ss.ss_currentScanDesc);
+	if (gts->af_state)
+		ExecEndArrowFdw(gts->af_state);
 	/* unreference CUDA program */
 	if (gts->program_id != INVALID_PROGRAM_ID)
 		pgstrom_put_cuda_program(gts->gcontext, gts->program_id);
 	/* unreference GpuContext */
+	for (i=0; i < gts->num_gcontext_multi; i++)
+		PutGpuContext(gts->gcontext_multi[i]);
 	PutGpuContext(gts->gcontext);
 }
 
+/*
+ * pgstromExplainTimeStat - EXPLAIN output of a GpuTaskTimeStat
+ */
+static void
+pgstromExplainTimeStat(GpuTaskTimeStat *tm_stat, int nslots,
+					   const char *label, ExplainState *es)
+{
+	static const char *phase_names[] = {
+		"load",
+		"queue",
+		"dma-send",
+		"kernel",
+		"dma-recv",
+		"fallback",
+	};
+	static const char *phase_labels[] = {
+		"Host Load Time",
+		"Queue Wait Time",
+		"DMA Send Time",
+		"Kernel Time",
+		"DMA Recv Time",
+		"CPU Fallback Time",
+	};
+	uint64		count[GpuTaskPhase__NumPhases];
+	uint64		usec[GpuTaskPhase__NumPhases];
+	StringInfoData str;
+	int			i, j;
+
+	StaticAssertStmt(lengthof(phase_names) == GpuTaskPhase__NumPhases &&
+					 lengthof(phase_labels) == GpuTaskPhase__NumPhases,
+					 "phase names mismatch to GpuTaskPhase");
+	memset(count, 0, sizeof(count));
+	memset(usec, 0, sizeof(usec));
+	for (i=0; i < nslots; i++)
+	{
+		for (j=0; j < GpuTaskPhase__NumPhases; j++)
+		{
+			count[j] += pg_atomic_read_u64(&tm_stat[i].count[j]);
+			usec[j]  += pg_atomic_read_u64(&tm_stat[i].usec[j]);
+		}
+	}
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		initStringInfo(&str);
+		for (j=0; j < GpuTaskPhase__NumPhases; j++)
+		{
+			if (count[j] == 0)
+				continue;
+			appendStringInfo(&str, "%s%s: %.3fms",
+							 str.len > 0 ? ", " : "",
+							 phase_names[j],
+							 (double)usec[j] / 1000.0);
+		}
+		if (str.len > 0)
+			ExplainPropertyText(label, str.data, es);
+		pfree(str.data);
+	}
+	else
+	{
+		ExplainOpenGroup(label, label, true, es);
+		for (j=0; j < GpuTaskPhase__NumPhases; j++)
+			ExplainPropertyFloat(phase_labels[j],
+								 (double)usec[j] / 1000.0, 3, es);
+		ExplainCloseGroup(label, label, true, es);
+	}
+}
+
 /*
  * pgstromExplainGpuTaskState
  */
@@ -598,10 +1708,73 @@ pgstromExplainGpuTaskState(GpuTaskState *gts, ExplainState *es)
 	else if (es->format != EXPLAIN_FORMAT_TEXT)
 		ExplainPropertyText("NVMe-Strom", "disabled", es);
 
+	/* source files of arrow_fdw */
+	if (gts->css.ss.ss_currentRelation &&
+		RelationIsArrowFdw(gts->css.ss.ss_currentRelation))
+		ExplainArrowFdw(gts->css.ss.ss_currentRelation, es);
+
+	/* GPU devices to distribute GpuTasks, if multiple */
+	if (gts->num_gcontext_multi > 0)
+	{
+		StringInfoData buf;
+		int		i;
+
+		initStringInfo(&buf);
+		appendStringInfo(&buf, "GPU%d",
+						 devAttrs[gts->gcontext->cuda_dindex].DEV_ID);
+		for (i=0; i < gts->num_gcontext_multi; i++)
+			appendStringInfo(&buf, ",GPU%d",
+							 devAttrs[gts->gcontext_multi[i]->cuda_dindex].DEV_ID);
+		ExplainPropertyText("Multi-GPU", buf.data, es);
+		pfree(buf.data);
+	}
+
 	/* Number of CPU fallbacks, if any */
 	if (es->analyze && gts->num_cpu_fallbacks > 0)
 		ExplainPropertyLong("CPU fallbacks", gts->num_cpu_fallbacks, es);
 
+	/* Number of small data stores coalesced for the upper node, if any */
+	if (es->analyze && gts->num_coalesced_chunks > 0)
+		ExplainPropertyLong("Coalesced Chunks", gts->num_coalesced_chunks, es);
+
+	/* Which side was the bottleneck; CPU loader or GPU */
+	if (es->analyze &&
+		(gts->num_loader_stalls > 0 || gts->num_gpu_stalls > 0 ||
+		 es->format != EXPLAIN_FORMAT_TEXT))
+	{
+		ExplainPropertyLong("Loader Stalls", gts->num_loader_stalls, es);
+		ExplainPropertyLong("GPU Stalls", gts->num_gpu_stalls, es);
+	}
+
+	/* Time waiting for the admission of GPU tasks */
+	if (es->analyze &&
+		(gts->queue_wait_time > 0.0 || es->format != EXPLAIN_FORMAT_TEXT))
+		ExplainPropertyFloat("GPU Queue Wait", gts->queue_wait_time, 3, es);
+
+	/* Timing statistics for each phase of GpuTasks */
+	if (es->analyze && es->verbose && gts->tm_stat)
+	{
+		if (gts->tm_stat_nslots > 1)
+		{
+			char		label[80];
+			int			i;
+
+			pgstromExplainTimeStat(gts->tm_stat_slots,
+								   gts->tm_stat_nslots,
+								   "GPU Time", es);
+			for (i=0; i < gts->tm_stat_nslots; i++)
+			{
+				if (i == 0)
+					snprintf(label, sizeof(label), "GPU Time (leader)");
+				else
+					snprintf(label, sizeof(label), "GPU Time (worker %d)", i-1);
+				pgstromExplainTimeStat(&gts->tm_stat_slots[i], 1, label, es);
+			}
+		}
+		else
+			pgstromExplainTimeStat(gts->tm_stat, 1, "GPU Time", es);
+	}
+
 	/* Source path of the GPU kernel */
 	if (es->verbose &&
 		gts->program_id != INVALID_PROGRAM_ID &&
@@ -623,14 +1796,41 @@ pgstromExplainGpuTaskState(GpuTaskState *gts, ExplainState *es)
 Size
 pgstromEstimateDSMGpuTaskState(GpuTaskState *gts, ParallelContext *pcxt)
 {
+	Size		len = 0;
+
 	if (gts->css.ss.ss_currentRelation)
 	{
 		EState	   *estate = gts->css.ss.ps.state;
 
-		return MAXALIGN(offsetof(GpuTaskSharedState, phscan) +
-						heap_parallelscan_estimate(estate->es_snapshot));
+		len = MAXALIGN(offsetof(GpuTaskSharedState, phscan) +
+					   heap_parallelscan_estimate(estate->es_snapshot));
 	}
-	return 0;
+	/* timing statistics for each process, if EXPLAIN ANALYZE */
+	if (gts->tm_stat)
+	{
+		if (len == 0)
+			len = MAXALIGN(offsetof(GpuTaskSharedState, phscan));
+		len += MAXALIGN(sizeof(GpuTaskTimeStat) * (pcxt->nworkers + 1));
+	}
+	return len;
+}
+
+/*
+ * setup_timestat_slot - pick up own slot of the timing statistics on DSM;
+ * index 0 is the coordinator, then parallel workers follow.
+ */
+static void
+setup_timestat_slot(GpuTaskState *gts, GpuTaskSharedState *gtss)
+{
+	int		index = (IsParallelWorker() ? ParallelWorkerNumber + 1 : 0);
+
+	if (!gts->tm_stat || gtss->tm_stat_nslots == 0)
+		return;
+	gts->tm_stat_slots = (GpuTaskTimeStat *)
+		((char *)gtss + gtss->tm_stat_offset);
+	gts->tm_stat_nslots = gtss->tm_stat_nslots;
+	if (index < gts->tm_stat_nslots)
+		gts->tm_stat = &gts->tm_stat_slots[index];
 }
 
 /*
@@ -646,6 +1846,25 @@ pgstromInitDSMGpuTaskState(GpuTaskState *gts,
 	Snapshot	snapshot = estate->es_snapshot;
 	GpuTaskSharedState *gtss = coordinate;
 
+	if (gts->tm_stat)
+	{
+		if (relation)
+			gtss->tm_stat_offset =
+				MAXALIGN(offsetof(GpuTaskSharedState, phscan) +
+						 heap_parallelscan_estimate(snapshot));
+		else
+			gtss->tm_stat_offset =
+				MAXALIGN(offsetof(GpuTaskSharedState, phscan));
+		gtss->tm_stat_nslots = pcxt->nworkers + 1;
+		memset((char *)gtss + gtss->tm_stat_offset, 0,
+			   sizeof(GpuTaskTimeStat) * gtss->tm_stat_nslots);
+	}
+	else
+	{
+		gtss->tm_stat_offset = 0;
+		gtss->tm_stat_nslots = 0;
+	}
+
 	if (relation)
 	{
 		gtss->nr_allocated = 0;
@@ -653,6 +1872,8 @@ pgstromInitDSMGpuTaskState(GpuTaskState *gts,
 		/* per workers initialization inclusing the coordinator */
 		pgstromInitWorkerGpuTaskState(gts, coordinate);
 	}
+	else
+		setup_timestat_slot(gts, gtss);
 	gts->gtss = gtss;
 	gts->pcxt = pcxt;
 }
@@ -666,6 +1887,7 @@ pgstromInitWorkerGpuTaskState(GpuTaskState *gts, void *coordinate)
 	Relation	relation = gts->css.ss.ss_currentRelation;
 	GpuTaskSharedState *gtss = coordinate;
 
+	setup_timestat_slot(gts, gtss);
 	if (relation)
 	{
 		/* begin parallel scan */
@@ -685,7 +1907,7 @@ pgstromReInitializeDSMGpuTaskState(GpuTaskState *gts)
 {
 	GpuTaskSharedState *gtss = gts->gtss;
 
-	if (gtss)
+	if (gtss && gts->css.ss.ss_currentRelation)
 	{
 		/* see heap_parallelscan_reinitialize */
 		SpinLockAcquire(&gtss->phscan.phs_mutex);
@@ -694,6 +1916,88 @@ pgstromReInitializeDSMGpuTaskState(GpuTaskState *gts)
 	}
 }
 
+/*
+ * pgstromShutdownDSMGpuTaskState
+ *
+ * DSM shall be released prior to Explain callback, so the coordinator has
+ * to save the timing statistics of the workers on the shutdown timing.
+ */
+void
+pgstromShutdownDSMGpuTaskState(GpuTaskState *gts)
+{
+	GpuTaskTimeStat *tm_stat_old = gts->tm_stat_slots;
+	Size		length;
+
+	if (!tm_stat_old || IsParallelWorker())
+		return;
+	length = sizeof(GpuTaskTimeStat) * gts->tm_stat_nslots;
+	gts->tm_stat_slots = MemoryContextAlloc(CurTransactionContext, length);
+	memcpy(gts->tm_stat_slots, tm_stat_old, length);
+	gts->tm_stat = &gts->tm_stat_slots[0];
+}
+
+/*
+ * pgstromTimeStatEventRecord
+ *
+ * It records the event on the stream of the worker thread, if timing
+ * statistics are collected.
+ */
+void
+pgstromTimeStatEventRecord(GpuTaskState *gts, CUevent cuda_event)
+{
+	CUresult	rc;
+
+	if (!gts->tm_stat)
+		return;
+	rc = cuEventRecord(cuda_event, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+}
+
+/*
+ * pgstromTimeStatAddEvents
+ *
+ * It accumulates the elapsed time between the two events already completed.
+ */
+void
+pgstromTimeStatAddEvents(GpuTaskState *gts, GpuTaskPhase phase,
+						 CUevent ev_start, CUevent ev_stop)
+{
+	GpuTaskTimeStat *tm_stat = gts->tm_stat;
+	float		elapsed;
+	CUresult	rc;
+
+	if (!tm_stat)
+		return;
+	rc = cuEventElapsedTime(&elapsed, ev_start, ev_stop);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventElapsedTime: %s", errorText(rc));
+	pg_atomic_fetch_add_u64(&tm_stat->count[phase], 1);
+	pg_atomic_fetch_add_u64(&tm_stat->usec[phase],
+							(uint64)(elapsed * 1000.0));
+}
+
+/*
+ * pgstromTimeStatAddElapsed
+ *
+ * It accumulates the wall-clock time since @tv_start.
+ */
+void
+pgstromTimeStatAddElapsed(GpuTaskState *gts, GpuTaskPhase phase,
+						  instr_time *tv_start)
+{
+	GpuTaskTimeStat *tm_stat = gts->tm_stat;
+	instr_time	tv_now;
+
+	if (!tm_stat)
+		return;
+	INSTR_TIME_SET_CURRENT(tv_now);
+	INSTR_TIME_SUBTRACT(tv_now, *tv_start);
+	pg_atomic_fetch_add_u64(&tm_stat->count[phase], 1);
+	pg_atomic_fetch_add_u64(&tm_stat->usec[phase],
+							INSTR_TIME_GET_MICROSEC(tv_now));
+}
+
 /*
  * pgstromInitGpuTask
  */
@@ -704,6 +2008,7 @@ pgstromInitGpuTask(GpuTaskState *gts, GpuTask *gtask)
 	gtask->program_id   = gts->program_id;
 	gtask->gts          = gts;
 	gtask->cpu_fallback = false;
+	gtask->affinity     = -1;
 }
 
 
@@ -865,11 +2170,198 @@ pgstromExplainOuterScan(GpuTaskState *gts,
 	}
 }
 
+/*
+ * pgstromPlanFingerprint
+ *
+ * It makes a hash value that identifies the query shape of the plan node;
+ * underlying relations, WHERE/JOIN clauses of the query and expressions
+ * which characterize the node.
+ */
+cl_uint
+pgstromPlanFingerprint(PlannerInfo *root, Relids relids, List *exprs)
+{
+	StringInfoData buf;
+	cl_uint		hash;
+	int			k;
+
+	initStringInfo(&buf);
+	k = -1;
+	while ((k = bms_next_member(relids, k)) >= 0)
+	{
+		RangeTblEntry  *rte = (k < root->simple_rel_array_size
+							   ? root->simple_rte_array[k]
+							   : NULL);
+
+		appendStringInfo(&buf, "%d:%u ", k,
+						 rte && rte->rtekind == RTE_RELATION
+						 ? rte->relid : InvalidOid);
+	}
+	appendStringInfoString(&buf, nodeToString(root->parse->jointree));
+	appendStringInfoString(&buf, nodeToString(exprs));
+	hash = DatumGetUInt32(hash_any((unsigned char *)buf.data, buf.len));
+	pfree(buf.data);
+
+	/* 0 is reserved for unused slot */
+	return (hash != 0 ? hash : 1);
+}
+
+/*
+ * pgstromLookupCardinalityFeedback
+ *
+ * It fetches the values recorded by the last execution of the same query
+ * shape, if any.
+ */
+bool
+pgstromLookupCardinalityFeedback(cl_uint fingerprint,
+								 double *values, int nvalues)
+{
+	cardinalityFeedbackEntry *entry;
+	bool		found = false;
+	int			i;
+
+	if (!enable_cardinality_feedback || !cfeedback_head ||
+		fingerprint == 0 || nvalues > CARDINALITY_FEEDBACK_MAX_VALUES)
+		return false;
+
+	SpinLockAcquire(&cfeedback_head->lock);
+	for (i=0; i < CARDINALITY_FEEDBACK_NPROBES; i++)
+	{
+		entry = &cfeedback_head->entries[(fingerprint + i) %
+										 CARDINALITY_FEEDBACK_NSLOTS];
+		if (entry->fingerprint == fingerprint &&
+			entry->nvalues == nvalues)
+		{
+			memcpy(values, entry->values, sizeof(double) * nvalues);
+			entry->last_used = ++cfeedback_head->clock;
+			found = true;
+			break;
+		}
+	}
+	SpinLockRelease(&cfeedback_head->lock);
+
+	return found;
+}
+
+/*
+ * pgstromUpdateCardinalityFeedback
+ *
+ * It records the actual values of the execution for the query shape.
+ */
+void
+pgstromUpdateCardinalityFeedback(cl_uint fingerprint,
+								 const double *values, int nvalues)
+{
+	cardinalityFeedbackEntry *entry;
+	cardinalityFeedbackEntry *victim = NULL;
+	int			i;
+
+	if (!enable_cardinality_feedback || !cfeedback_head ||
+		fingerprint == 0 || nvalues > CARDINALITY_FEEDBACK_MAX_VALUES)
+		return;
+
+	SpinLockAcquire(&cfeedback_head->lock);
+	for (i=0; i < CARDINALITY_FEEDBACK_NPROBES; i++)
+	{
+		entry = &cfeedback_head->entries[(fingerprint + i) %
+										 CARDINALITY_FEEDBACK_NSLOTS];
+		if (entry->fingerprint == fingerprint)
+		{
+			victim = entry;
+			break;
+		}
+		if (!victim || entry->last_used < victim->last_used)
+			victim = entry;
+	}
+	victim->fingerprint = fingerprint;
+	victim->nvalues = nvalues;
+	victim->last_used = ++cfeedback_head->clock;
+	memcpy(victim->values, values, sizeof(double) * nvalues);
+	SpinLockRelease(&cfeedback_head->lock);
+}
+
+/*
+ * pgstrom_startup_gputasks
+ */
+static void
+pgstrom_startup_gputasks(void)
+{
+	bool	found;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	cfeedback_head = ShmemInitStruct("PG-Strom Cardinality Feedback",
+									 sizeof(cardinalityFeedbackHead),
+									 &found);
+	if (found)
+		elog(ERROR, "Bug? PG-Strom Cardinality Feedback exists");
+	memset(cfeedback_head, 0, sizeof(cardinalityFeedbackHead));
+	SpinLockInit(&cfeedback_head->lock);
+}
+
 /*
  * pgstrom_init_gputasks
  */
 void
 pgstrom_init_gputasks(void)
 {
-	/* nothing to do */
+	/* pg_strom.max_prefetch_tasks */
+	DefineCustomIntVariable("pg_strom.max_prefetch_tasks",
+							"Max number of GpuTasks loaded ahead while GPU is busy",
+							NULL,
+							&max_prefetch_tasks,
+							1,
+							0,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.max_gpus_per_scan */
+	DefineCustomIntVariable("pg_strom.max_gpus_per_scan",
+							"Max number of GPUs to distribute chunks of a scan in a single process (0 = all)",
+							NULL,
+							&max_gpus_per_scan,
+							1,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.enable_cardinality_feedback */
+	DefineCustomBoolVariable("pg_strom.enable_cardinality_feedback",
+							 "Enables to use the actual number of rows of the last execution for the same query shape",
+							 NULL,
+							 &enable_cardinality_feedback,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.enable_chunk_coalesce */
+	DefineCustomBoolVariable("pg_strom.enable_chunk_coalesce",
+							 "Enables to pack small result chunks of the outer GPU node into a larger one",
+							 NULL,
+							 &enable_chunk_coalesce,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.enable_bulkinsert */
+	DefineCustomBoolVariable("pg_strom.enable_bulkinsert",
+							 "Enables to insert the results of GPU node to the heap table by batch",
+							 NULL,
+							 &enable_bulkinsert,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* shared memory for the cardinality feedback */
+	RequestAddinShmemSpace(MAXALIGN(sizeof(cardinalityFeedbackHead)));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_gputasks;
+	/* hook for bulk-insert of the GPU results */
+	executor_run_next = ExecutorRun_hook;
+	ExecutorRun_hook = pgstrom_bulkinsert_executor_run;
 }
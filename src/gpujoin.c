@@ -30,13 +30,16 @@ typedef struct
 	Index			outer_relid;	/* valid, if outer scan pull-up */
 	Expr		   *outer_quals;	/* qualifier of outer scan */
 	cl_uint			outer_nrows_per_block;
+	cl_uint			fingerprint;	/* key of the cardinality feedback */
 	struct {
 		JoinType	join_type;		/* one of JOIN_* */
 		double		join_nrows;		/* intermediate nrows in this depth */
 		Path	   *scan_path;		/* outer scan path */
 		List	   *hash_quals;		/* valid quals, if hash-join */
+		List	   *range_quals;	/* a range clause, if range index is used */
 		List	   *join_quals;		/* all the device quals, incl hash_quals */
 		Size		ichunk_size;	/* expected inner chunk size */
+		int			nparts;			/* # of inner hash partitions */
 	} inners[FLEXIBLE_ARRAY_MEMBER];
 } GpuJoinPath;
 
@@ -61,15 +64,20 @@ typedef struct
 	List	   *plan_nrows_in;	/* list of floatVal for planned nrows_in */
 	List	   *plan_nrows_out;	/* list of floatVal for planned nrows_out */
 	List	   *ichunk_size;
+	List	   *inner_nparts;	/* list of intVal for # of partitions */
 	List	   *join_types;
 	List	   *join_quals;
 	List	   *other_quals;
 	List	   *hash_inner_keys;	/* if hash-join */
 	List	   *hash_outer_keys;	/* if hash-join */
+	List	   *range_ops;			/* GPUJOIN_RANGE_OP__*, or 0 */
+	List	   *range_inner_keys;	/* if nest-loop with range index */
+	List	   *range_outer_keys;	/* if nest-loop with range index */
 	/* supplemental information of ps_tlist */
 	List	   *ps_src_depth;	/* source depth of the ps_tlist entry */
 	List	   *ps_src_resno;	/* source resno of the ps_tlist entry */
 	cl_uint		extra_maxlen;	/* max length of extra area per rows */
+	cl_uint		fingerprint;	/* key of the cardinality feedback */
 } GpuJoinInfo;
 
 static inline void
@@ -94,15 +102,20 @@ form_gpujoin_info(CustomScan *cscan, GpuJoinInfo *gj_info)
 	privs = lappend(privs, gj_info->plan_nrows_in);
 	privs = lappend(privs, gj_info->plan_nrows_out);
 	privs = lappend(privs, gj_info->ichunk_size);
+	privs = lappend(privs, gj_info->inner_nparts);
 	privs = lappend(privs, gj_info->join_types);
 	exprs = lappend(exprs, gj_info->join_quals);
 	exprs = lappend(exprs, gj_info->other_quals);
 	exprs = lappend(exprs, gj_info->hash_inner_keys);
 	exprs = lappend(exprs, gj_info->hash_outer_keys);
+	privs = lappend(privs, gj_info->range_ops);
+	exprs = lappend(exprs, gj_info->range_inner_keys);
+	exprs = lappend(exprs, gj_info->range_outer_keys);
 
 	privs = lappend(privs, gj_info->ps_src_depth);
 	privs = lappend(privs, gj_info->ps_src_resno);
 	privs = lappend(privs, makeInteger(gj_info->extra_maxlen));
+	privs = lappend(privs, makeInteger(gj_info->fingerprint));
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -133,15 +146,20 @@ deform_gpujoin_info(CustomScan *cscan)
 	gj_info->plan_nrows_in = list_nth(privs, pindex++);
 	gj_info->plan_nrows_out = list_nth(privs, pindex++);
 	gj_info->ichunk_size = list_nth(privs, pindex++);
+	gj_info->inner_nparts = list_nth(privs, pindex++);
 	gj_info->join_types = list_nth(privs, pindex++);
     gj_info->join_quals = list_nth(exprs, eindex++);
 	gj_info->other_quals = list_nth(exprs, eindex++);
 	gj_info->hash_inner_keys = list_nth(exprs, eindex++);
     gj_info->hash_outer_keys = list_nth(exprs, eindex++);
+	gj_info->range_ops = list_nth(privs, pindex++);
+	gj_info->range_inner_keys = list_nth(exprs, eindex++);
+	gj_info->range_outer_keys = list_nth(exprs, eindex++);
 
 	gj_info->ps_src_depth = list_nth(privs, pindex++);
 	gj_info->ps_src_resno = list_nth(privs, pindex++);
 	gj_info->extra_maxlen = intVal(list_nth(privs, pindex++));
+	gj_info->fingerprint = intVal(list_nth(privs, pindex++));
 	Assert(pindex == list_length(privs));
 	Assert(eindex == list_length(exprs));
 
@@ -166,6 +184,9 @@ typedef struct
 	JoinType			join_type;
 	double				nrows_ratio;
 	cl_uint				ichunk_size;
+	cl_int				nparts;		/* # of inner hash partitions */
+	cl_bool				runtime_nestloop; /* hash-join runs as nest-loop */
+	cl_int				skew_nslots;	/* # of heavy hitter slots */
 #if PG_VERSION_NUM < 100000	
 	List			   *join_quals;		/* single element list of ExprState */
 	List			   *other_quals;	/* single element list of ExprState */
@@ -183,6 +204,13 @@ typedef struct
 	List			   *hash_keybyval;
 	List			   *hash_keytype;
 
+	/*
+	 * Join properties; only nest-loop with range index
+	 */
+	ExprState		   *range_inner_key;
+	Oid					range_inner_type;	/* range or element type */
+	cl_int				range_op;			/* GPUJOIN_RANGE_OP__* */
+
 	/* CPU Fallback related */
 	AttrNumber		   *inner_dst_resno;
 	AttrNumber			inner_src_anum_min;
@@ -203,7 +231,34 @@ typedef struct
 	CUdeviceptr		m_kmrels;
 	CUdeviceptr	   *m_kmrels_array;	/* only master process */
 	dsm_segment	   *seg_kmrels;
+	dsm_segment	  **seg_preloads;	/* inner chunks loaded by myself */
 	cl_int			curr_outer_depth;
+	cl_bool			ojmap_detached;	/* already left from pg_nworkers */
+	cl_bool			ojmap_runner;	/* runs RIGHT OUTER JOIN, if true */
+	/*
+	 * Partitioned inner hash table; if inner hash table is too large to
+	 * load onto a particular device, it is partitioned by the hash value
+	 * and distributed to individual devices. @m_kmrels_parts[] is device
+	 * address of the partitions; accessible from the current device using
+	 * peer-to-peer access.
+	 */
+	cl_int			part_depth;		/* depth of the partitioned inner */
+	cl_int			part_nums;		/* # of partitions (1, if none) */
+	CUdeviceptr	   *m_kmrels_parts;	/* valid only if part_nums > 1 */
+	/*
+	 * If partitions are more than the number of devices, device buffer
+	 * keeps only one partition at a time (batch). The outer chunks are
+	 * retained during the first batch, then processed again for each
+	 * later batch, after the partition of the next batch is loaded.
+	 */
+	cl_bool			part_batched;	/* true, if partitions are batched */
+	cl_int			curr_part;		/* partition of the current batch */
+	cl_int			fallback_part;	/* batch of the task on CPU fallback */
+	size_t			part_common;	/* length of the common portion */
+	size_t		   *part_offsets;	/* offset of partitions on h_kmrels */
+	size_t		   *part_lengths;	/* length of partitions on h_kmrels */
+	List		   *batch_chunks;	/* outer chunks retained for batches */
+	ListCell	   *batch_curr;		/* next outer chunk of the batch */
 
 	/*
 	 * Expressions to be used in the CPU fallback path
@@ -222,6 +277,8 @@ typedef struct
 	int				result_width;
 	/* expected extra length per result tuple  */
 	cl_uint			extra_maxlen;
+	/* key of the cardinality feedback */
+	cl_uint			fingerprint;
 
 	/*
 	 * CPU Fallback
@@ -233,6 +290,11 @@ typedef struct
 	AttrNumber		outer_src_anum_max;
 	cl_long			fallback_outer_index;
 
+	/*
+	 * Bloom filter on the outer relation scan by CPU, if any
+	 */
+	struct GpuJoinBloomFilter *outer_bloom;
+
 	/*
 	 * Properties of underlying inner relations
 	 */
@@ -253,6 +315,10 @@ struct GpuJoinSharedState
 	pg_atomic_uint32 needs_colocation; /* non-zero, if colocation is needed */
 	pg_atomic_uint32 preload_done;	/* non-zero, if preload is done */
 	pg_atomic_uint32 pg_nworkers;	/* # of active PG workers */
+	bool			parallel_preload; /* inner is loaded by all the workers */
+	pg_atomic_uint32 preload_next;	/* next depth to be loaded (0-origin) */
+	pg_atomic_uint32 preload_nloaded; /* # of depths already loaded */
+	size_t			offset_preload_handles; /* offset to the DSM handles */
 	struct {
 		pg_atomic_uint32 pg_nworkers; /* # of PG workers per GPU device */
 		CUipcMemHandle	m_handle;	/* IPC handle for PG workers */
@@ -267,6 +333,7 @@ struct GpuJoinRuntimeStat
 {
 	pg_atomic_uint64	ccache_count;
 	pg_atomic_uint64	source_nitems;
+	pg_atomic_uint64	bloom_nitems;	/* rows discarded by bloom filter */
 	struct {
 		pg_atomic_uint64 inner_nitems;
 		pg_atomic_uint64 right_nitems;
@@ -277,6 +344,39 @@ typedef struct GpuJoinRuntimeStat	GpuJoinRuntimeStat;
 #define GPUJOIN_RUNTIME_STAT(gj_sstate)							\
 	((GpuJoinRuntimeStat *)((char *)(gj_sstate) +				\
 							(gj_sstate)->offset_runtime_stat))
+/* DSM handles of the inner chunks, loaded by individual processes */
+#define GPUJOIN_PRELOAD_HANDLES(gj_sstate)						\
+	((dsm_handle *)((char *)(gj_sstate) +						\
+					(gj_sstate)->offset_preload_handles))
+
+/*
+ * GpuJoinBloomFilter - bloom filter on the outer relation scan by CPU
+ *
+ * It references the bloom filter on the inner buffer (kern_multirels), and
+ * tells the hash value of the join keys of the first depth on the outer
+ * relation. It is valid only if all the join keys are simple column
+ * references of the outer relation with fixed-length data types.
+ */
+struct GpuJoinBloomFilter
+{
+	cl_uint		   *bitmap;		/* reference to the kern_multirels */
+	cl_uint			nbits;		/* # of bits; power of 2 */
+	cl_ulong		nskipped;	/* # of rows discarded, not flushed */
+	int				nkeys;
+	struct {
+		AttrNumber		anum;	/* attribute number of the outer relation */
+		devtype_info   *dtype;
+	} keys[FLEXIBLE_ARRAY_MEMBER];
+};
+typedef struct GpuJoinBloomFilter	GpuJoinBloomFilter;
+
+/*
+ * The bloom filter is built only if the first depth is expected to be
+ * selective enough, and inner hash table is not too large, because
+ * false-positive rate gets worse for more items.
+ */
+#define GPUJOIN_BLOOM_FILTER_MAX_RATIO		0.5
+#define GPUJOIN_BLOOM_FILTER_MAX_NITEMS		(1U << 26)
 
 /*
  * GpuJoinTask - task object of GpuJoin
@@ -287,10 +387,12 @@ typedef struct
 	cl_bool			with_nvme_strom;	/* true, if NVMe-Strom */
 	cl_bool			is_dummy_task;//OBSOLETE
 	cl_int			outer_depth;		/* base depth, if RIGHT OUTER */
+	cl_int			part_index;			/* batch of the partitioned inner */
 	/* DMA buffers */
 	pgstrom_data_store *pds_src;	/* data store of outer relation */
 	pgstrom_data_store *pds_dst;	/* data store of result buffer */
 	dlist_head		pds_dst_inactives; /* list of inactive result buffers */
+	size_t			kern_length;	/* length of kern_gpujoin */
 	kern_gpujoin	kern;		/* kern_gpujoin of this request */
 } GpuJoinTask;
 
@@ -301,6 +403,18 @@ static CustomScanMethods	gpujoin_plan_methods;
 static CustomExecMethods	gpujoin_exec_methods;
 static bool					enable_gpunestloop;
 static bool					enable_gpuhashjoin;
+static bool					enable_gpurangejoin;
+static bool					enable_partitioned_gpuhashjoin;
+static bool					enable_gpujoin_bloom_filter;
+static bool					enable_gpujoin_parallel_preload;
+static int					gpujoin_prefetch_limit_kb;
+static int					gpujoin_nestloop_threshold;
+static int					gpujoin_skew_threshold;
+static bool					gpujoin_persistent_kernel;
+static bool					gpujoin_packed_hash;
+
+/* upper limit of the destination buffer length per allocation */
+#define GPUJOIN_DEST_MAXLEN		(8 * pgstrom_chunk_size())
 
 /* static functions */
 static void gpujoin_switch_task(GpuTaskState *gts, GpuTask *gtask);
@@ -308,6 +422,8 @@ static GpuTask *gpujoin_next_task(GpuTaskState *gts);
 static GpuTask *gpujoin_terminator_task(GpuTaskState *gts,
 										cl_bool *task_is_ready);
 static TupleTableSlot *gpujoin_next_tuple(GpuTaskState *gts);
+static pgstrom_data_store *gpujoin_bulk_exec(GpuTaskState *gts,
+											 GpuTask *gtask);
 static pg_crc32 get_tuple_hashvalue(innerState *istate,
 									bool is_inner_hashkeys,
 									TupleTableSlot *slot,
@@ -322,6 +438,7 @@ static char *gpujoin_codegen(PlannerInfo *root,
 static GpuJoinSharedState *createGpuJoinSharedState(GpuJoinState *gjs,
 													ParallelContext *pcxt,
 													void *coordinate);
+static void gpujoin_update_cardinality_feedback(GpuJoinState *gjs);
 
 /*
  * misc declarations
@@ -331,6 +448,54 @@ static GpuJoinSharedState *createGpuJoinSharedState(GpuJoinState *gjs,
 #define PATH_PARAM_BY_REL(path, rel)  \
 	((path)->param_info && bms_overlap(PATH_REQ_OUTER(path), (rel)->relids))
 
+/*
+ * gpujoin_inner_hash_partition
+ *
+ * It returns the partition of inner hash table that covers the supplied
+ * hash value. The partitions of a particular depth are put on the host
+ * buffer contiguously, in order of the hash value.
+ * In case of non-partitioned inner, hash_min/hash_max of the KDS covers
+ * the whole range of hash values, so first KDS is always returned.
+ */
+static inline kern_data_store *
+gpujoin_inner_hash_partition(kern_multirels *kmrels, int depth, cl_uint hash)
+{
+	kern_data_store *kds = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+
+	while (hash > kds->hash_max)
+		kds = (kern_data_store *)((char *)kds + STROMALIGN(kds->length));
+	Assert(hash >= kds->hash_min);
+	return kds;
+}
+
+/*
+ * gpujoin_inner_chunk_stat
+ *
+ * It returns total number of items and length of the inner chunk at the
+ * supplied depth, including all the partitions if any.
+ */
+static void
+gpujoin_inner_chunk_stat(kern_multirels *kmrels, int depth,
+						 size_t *p_nitems, size_t *p_length)
+{
+	kern_data_store *kds = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+	size_t		nitems = 0;
+	size_t		length = 0;
+
+	for (;;)
+	{
+		nitems += kds->nitems;
+		length += kds->length;
+		if (kds->hash_max == UINT_MAX)
+			break;
+		kds = (kern_data_store *)((char *)kds + STROMALIGN(kds->length));
+	}
+	if (p_nitems)
+		*p_nitems = nitems;
+	if (p_length)
+		*p_length = length;
+}
+
 /*
  * returns true, if pathnode is GpuJoin
  */
@@ -493,6 +658,9 @@ estimate_inner_buffersize(PlannerInfo *root,
 			chunk_size = KDS_CALCULATE_ROW_LENGTH(ncols,
 												  inner_ntuples,
 												  inner_ntuples * entry_size);
+		if (gpath->inners[i].range_quals != NIL)
+			chunk_size += STROMALIGN(offsetof(kern_range_index,
+											  items[inner_ntuples]));
 		gpath->inners[i].ichunk_size = chunk_size;
 		inner_total_sz += chunk_size;
 
@@ -544,8 +712,17 @@ cost_gpujoin(PlannerInfo *root,
 	double		outer_ntuples;
 	double		kern_nloops = 1.0;
 	int			i, num_rels = gpath->num_rels;
+	int			part_depth = 0;
+	bool		has_right_outer = false;
 	bool		retval = false;
 
+	for (i=0; i < num_rels; i++)
+	{
+		if (gpath->inners[i].join_type == JOIN_RIGHT ||
+			gpath->inners[i].join_type == JOIN_FULL)
+			has_right_outer = true;
+	}
+
 	/*
 	 * Cost comes from the outer-path
 	 */
@@ -556,6 +733,7 @@ cost_gpujoin(PlannerInfo *root,
 		cost_gpuscan_common(root,
 							outer_path->parent,
 							gpath->outer_quals,
+							NULL, NIL,
 							parallel_nworkers,
 							&parallel_divisor,
 							&dummy,
@@ -590,9 +768,11 @@ cost_gpujoin(PlannerInfo *root,
 	{
 		Path	   *scan_path = gpath->inners[i].scan_path;
 		List	   *hash_quals = gpath->inners[i].hash_quals;
+		List	   *range_quals = gpath->inners[i].range_quals;
 		List	   *join_quals = gpath->inners[i].join_quals;
 		double		join_nrows = gpath->inners[i].join_nrows;
 		Size		ichunk_size = gpath->inners[i].ichunk_size;
+		int			nparts = 1;
 		QualCost	join_quals_cost;
 
 		/*
@@ -604,8 +784,33 @@ cost_gpujoin(PlannerInfo *root,
 		 * In the future version, up to 32GB chunk will be supported using
 		 * least 3bit because row-/hash-item shall be always put on 64bit
 		 * aligned location.
+		 *
+		 * If multiple GPU devices are installed, inner hash table of INNER
+		 * JOIN can be partitioned by the hash value, then individual
+		 * partitions are distributed to each device. Only one depth can be
+		 * partitioned, and RIGHT/FULL OUTER JOIN is not supported because
+		 * outer join map has to be consolidated over the partitions.
+		 * If partitions are more than the number of GPU devices, they are
+		 * loaded onto the device one by one (batches), and the outer chunks
+		 * are processed for each batch. It is not supported by parallel
+		 * query because the batch must be switched by all the workers
+		 * simultaneously.
 		 */
-		if (ichunk_size >= 0x60000000UL)
+		if (ichunk_size >= 0x60000000UL &&
+			enable_partitioned_gpuhashjoin &&
+			hash_quals != NIL &&
+			gpath->inners[i].join_type == JOIN_INNER &&
+			!has_right_outer &&
+			part_depth == 0)
+		{
+			nparts = ichunk_size / 0x60000000UL + 1;
+			if (numDevAttrs > 1 && nparts <= numDevAttrs)
+				nparts = numDevAttrs;
+			else if (parallel_nworkers > 0)
+				return false;
+			part_depth = i + 1;
+		}
+		else if (ichunk_size >= 0x60000000UL)
 		{
 			if (client_min_messages <= DEBUG1)
 			{
@@ -649,7 +854,15 @@ cost_gpujoin(PlannerInfo *root,
 			/* cost to comput hash value by GPU */
 			run_cost += (pgstrom_gpu_operator_cost *
 						 num_hashkeys *
-						 outer_ntuples);
+						 outer_ntuples * (double)nparts);
+			/*
+			 * cost to probe the partitions on the remote devices using
+			 * peer-to-peer access, or to send outer chunks again for each
+			 * batch, if partitioned
+			 */
+			if (nparts > 1)
+				run_cost += ((double)num_chunks *
+							 pgstrom_gpu_dma_cost * (double)(nparts - 1));
 			/* cost to evaluate join qualifiers */
 			run_cost += (join_quals_cost.per_tuple *
 						 Max(hash_nsteps, 1.0) *
@@ -667,13 +880,38 @@ cost_gpujoin(PlannerInfo *root,
 			/* cost to preload inner heap tuples by CPU */
 			startup_cost += cpu_tuple_cost * inner_ntuples;
 
-			/* cost to evaluate join qualifiers */
-			run_cost_per_chunk += (join_quals_cost.per_tuple *
-								   outer_ntuples *
-								   inner_ntuples);
+			if (range_quals != NIL)
+			{
+				/*
+				 * GpuNestLoop with range index - inner rows are sorted by
+				 * the range key by CPU, then each outer row probes only
+				 * the window of the candidates, found by binary search.
+				 */
+				double	nsteps = log2(Max((double)inner_ntuples, 2.0));
+				double	window = 2.0 * join_nrows /
+					Max(outer_ntuples * parallel_divisor, 1.0);
+
+				window = Min(Max(window, 1.0), inner_ntuples);
+				/* cost to sort the inner rows by CPU */
+				startup_cost += (cpu_operator_cost *
+								 inner_ntuples * nsteps);
+				/* cost to evaluate join qualifiers in the window */
+				run_cost_per_chunk += (pgstrom_gpu_operator_cost *
+									   2.0 * nsteps * outer_ntuples +
+									   join_quals_cost.per_tuple *
+									   outer_ntuples * window);
+			}
+			else
+			{
+				/* cost to evaluate join qualifiers */
+				run_cost_per_chunk += (join_quals_cost.per_tuple *
+									   outer_ntuples *
+									   inner_ntuples);
+			}
 		}
 		/* number of outer items on the next depth */
 		outer_ntuples = join_nrows / parallel_divisor;
+		gpath->inners[i].nparts = nparts;
 	}
 	/* outer DMA send cost */
 	run_cost += (double)num_chunks * pgstrom_gpu_dma_cost;
@@ -729,7 +967,9 @@ cost_gpujoin(PlannerInfo *root,
 			appendStringInfo(&buf, " %s%s ",
 							 join_type == JOIN_FULL ? "F" :
 							 join_type == JOIN_LEFT ? "L" :
-							 join_type == JOIN_RIGHT ? "R" : "I",
+							 join_type == JOIN_RIGHT ? "R" :
+							 join_type == JOIN_SEMI ? "S" :
+							 join_type == JOIN_ANTI ? "A" : "I",
 							 is_nestloop ? "NL" : "HJ");
 
 			__dump_gpujoin_path(&buf, root, inner_path);
@@ -750,9 +990,55 @@ typedef struct
 	Path	   *inner_path;
 	List	   *join_quals;
 	List	   *hash_quals;
+	List	   *range_quals;
 	double		join_nrows;
 } inner_path_item;
 
+/*
+ * gpujoin_apply_cardinality_feedback
+ *
+ * It identifies the GpuJoinPath by the relations at the outer and each
+ * depth, then replaces the join_nrows by the join ratios actually
+ * observed at the last execution of the same query shape, if any.
+ */
+static void
+gpujoin_apply_cardinality_feedback(PlannerInfo *root,
+								   GpuJoinPath *gjpath,
+								   Path *outer_path)
+{
+	List	   *depth_relids = NIL;
+	double		ratios[CARDINALITY_FEEDBACK_MAX_VALUES];
+	double		nrows;
+	int			i, k;
+
+	if (gjpath->num_rels > CARDINALITY_FEEDBACK_MAX_VALUES)
+		return;
+	for (i=0; i <= gjpath->num_rels; i++)
+	{
+		Path   *path = (i == 0 ? outer_path : gjpath->inners[i-1].scan_path);
+
+		k = -1;
+		while ((k = bms_next_member(path->parent->relids, k)) >= 0)
+			depth_relids = lappend(depth_relids, makeInteger(k));
+		depth_relids = lappend(depth_relids, makeInteger(-1));
+	}
+	gjpath->fingerprint =
+		pgstromPlanFingerprint(root,
+							   gjpath->cpath.path.parent->relids,
+							   depth_relids);
+	if (!pgstromLookupCardinalityFeedback(gjpath->fingerprint,
+										  ratios, gjpath->num_rels))
+		return;
+
+	nrows = outer_path->rows;
+	for (i=0; i < gjpath->num_rels; i++)
+	{
+		nrows = clamp_row_est(nrows * ratios[i]);
+		gjpath->inners[i].join_nrows = nrows;
+	}
+	gjpath->cpath.path.rows = nrows;
+}
+
 static GpuJoinPath *
 create_gpujoin_path(PlannerInfo *root,
 					RelOptInfo *joinrel,
@@ -804,11 +1090,33 @@ create_gpujoin_path(PlannerInfo *root,
 		inner_path_item *ip_item = lfirst(lc);
 		List	   *hash_quals;
 
+		/*
+		 * ANTI JOIN emits outer rows without matched inner rows, so it
+		 * cannot have pushed-down qualifiers to be applied on the result.
+		 */
+		if (ip_item->join_type == JOIN_ANTI)
+		{
+			ListCell   *cell;
+
+			foreach (cell, ip_item->join_quals)
+			{
+				RestrictInfo   *rinfo = lfirst(cell);
+
+				if (rinfo->is_pushed_down)
+				{
+					pfree(gjpath);
+					return NULL;
+				}
+			}
+		}
+
 		if (enable_gpuhashjoin && ip_item->hash_quals != NIL)
 			hash_quals = ip_item->hash_quals;
 		else if (enable_gpunestloop &&
 				 (ip_item->join_type == JOIN_INNER ||
-				  ip_item->join_type == JOIN_LEFT))
+				  ip_item->join_type == JOIN_LEFT ||
+				  ip_item->join_type == JOIN_SEMI ||
+				  ip_item->join_type == JOIN_ANTI))
 			hash_quals = NIL;
 		else
 		{
@@ -821,12 +1129,20 @@ create_gpujoin_path(PlannerInfo *root,
 		gjpath->inners[i].join_nrows = ip_item->join_nrows;
 		gjpath->inners[i].scan_path = ip_item->inner_path;
 		gjpath->inners[i].hash_quals = hash_quals;
+		gjpath->inners[i].range_quals = (hash_quals == NIL &&
+										 enable_gpurangejoin
+										 ? ip_item->range_quals
+										 : NIL);
 		gjpath->inners[i].join_quals = ip_item->join_quals;
 		gjpath->inners[i].ichunk_size = 0;		/* to be set later */
+		gjpath->inners[i].nparts = 1;			/* to be set later */
 		i++;
 	}
 	Assert(i == num_rels);
 
+	/* join ratios at the last execution, if any */
+	gpujoin_apply_cardinality_feedback(root, gjpath, outer_path);
+
 	/* Try to pull up outer scan if enough simple */
 	pgstrom_pullup_outer_scan(outer_path,
 							  &gjpath->outer_relid,
@@ -950,6 +1266,122 @@ extract_gpuhashjoin_quals(PlannerInfo *root,
 	return hash_quals;
 }
 
+/*
+ * gpujoin_range_clause_analyze
+ *
+ * It checks whether the clause is usable for the range index of nest-loop;
+ * a range operator between inner and outer relations that requires them
+ * to overlap, or the inner range to contain the outer range or element.
+ * If OK, it returns GPUJOIN_RANGE_OP__* and the inner/outer keys.
+ */
+static int
+gpujoin_range_clause_analyze(Expr *clause,
+							 Relids outer_relids,
+							 Relids inner_relids,
+							 Expr **p_inner_key,
+							 Expr **p_outer_key)
+{
+	OpExpr	   *op = (OpExpr *) clause;
+	Expr	   *arg1;
+	Expr	   *arg2;
+	Relids		relids1;
+	Relids		relids2;
+	bool		inner_is_arg1;
+	Oid			range_type;
+	int			range_op;
+
+	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+		return 0;
+	arg1 = linitial(op->args);
+	arg2 = lsecond(op->args);
+	relids1 = pull_varnos((Node *)arg1);
+	relids2 = pull_varnos((Node *)arg2);
+	if (!bms_is_empty(relids1) && bms_is_subset(relids1, inner_relids) &&
+		!bms_is_empty(relids2) && bms_is_subset(relids2, outer_relids))
+		inner_is_arg1 = true;
+	else if (!bms_is_empty(relids2) && bms_is_subset(relids2, inner_relids) &&
+			 !bms_is_empty(relids1) && bms_is_subset(relids1, outer_relids))
+		inner_is_arg1 = false;
+	else
+		return 0;
+
+	switch (get_opcode(op->opno))
+	{
+		case F_RANGE_OVERLAPS:		/* range && range */
+			range_op = GPUJOIN_RANGE_OP__OVERLAP;
+			range_type = exprType((Node *)arg1);
+			break;
+		case F_RANGE_CONTAINS:		/* range @> range */
+			if (!inner_is_arg1)
+				return 0;
+			range_op = GPUJOIN_RANGE_OP__CONTAINS;
+			range_type = exprType((Node *)arg1);
+			break;
+		case F_RANGE_CONTAINED_BY:	/* range <@ range */
+			if (inner_is_arg1)
+				return 0;
+			range_op = GPUJOIN_RANGE_OP__CONTAINS;
+			range_type = exprType((Node *)arg2);
+			break;
+		case F_RANGE_CONTAINS_ELEM:	/* range @> elem */
+			/* inner element within the outer range works like overlap */
+			range_op = (inner_is_arg1
+						? GPUJOIN_RANGE_OP__CONTAINS
+						: GPUJOIN_RANGE_OP__OVERLAP);
+			range_type = exprType((Node *)arg1);
+			break;
+		case F_ELEM_CONTAINED_BY_RANGE:	/* elem <@ range */
+			range_op = (inner_is_arg1
+						? GPUJOIN_RANGE_OP__OVERLAP
+						: GPUJOIN_RANGE_OP__CONTAINS);
+			range_type = exprType((Node *)arg2);
+			break;
+		default:
+			return 0;
+	}
+	/* only range types whose bounds are comparable as integer */
+	if (range_type != INT4RANGEOID &&
+		range_type != INT8RANGEOID &&
+		range_type != TSRANGEOID &&
+		range_type != TSTZRANGEOID &&
+		range_type != DATERANGEOID)
+		return 0;
+
+	if (p_inner_key)
+		*p_inner_key = (inner_is_arg1 ? arg1 : arg2);
+	if (p_outer_key)
+		*p_outer_key = (inner_is_arg1 ? arg2 : arg1);
+	return range_op;
+}
+
+/*
+ * extract_gpurangejoin_quals - pick up a qualifier usable for range index
+ */
+static List *
+extract_gpurangejoin_quals(PlannerInfo *root,
+						   RelOptInfo *outer_rel,
+						   RelOptInfo *inner_rel,
+						   JoinType jointype,
+						   List *restrict_clauses)
+{
+	ListCell   *lc;
+
+	foreach (lc, restrict_clauses)
+	{
+		RestrictInfo   *rinfo = (RestrictInfo *) lfirst(lc);
+
+		/* only its own join clauses, if outer join */
+		if (IS_OUTER_JOIN(jointype) && rinfo->is_pushed_down)
+			continue;
+		if (gpujoin_range_clause_analyze(rinfo->clause,
+										 outer_rel->relids,
+										 inner_rel->relids,
+										 NULL, NULL) != 0)
+			return list_make1(rinfo);
+	}
+	return NIL;
+}
+
 /*
  * try_add_gpujoin_paths
  */
@@ -973,7 +1405,9 @@ try_add_gpujoin_paths(PlannerInfo *root,
 	if (join_type != JOIN_INNER &&
 		join_type != JOIN_FULL &&
 		join_type != JOIN_RIGHT &&
-		join_type != JOIN_LEFT)
+		join_type != JOIN_LEFT &&
+		join_type != JOIN_SEMI &&
+		join_type != JOIN_ANTI)
 		return;
 
 	/*
@@ -1036,6 +1470,11 @@ try_add_gpujoin_paths(PlannerInfo *root,
 													inner_path->parent,
 													join_type,
 													restrict_clauses);
+	ip_item->range_quals = extract_gpurangejoin_quals(root,
+													  outer_path->parent,
+													  inner_path->parent,
+													  join_type,
+													  restrict_clauses);
 	ip_item->join_nrows = joinrel->rows;
 	ip_items_list = list_make1(ip_item);
 
@@ -1073,6 +1512,7 @@ try_add_gpujoin_paths(PlannerInfo *root,
 				ip_temp->inner_path = gjpath->inners[i].scan_path;
 				ip_temp->join_quals = gjpath->inners[i].join_quals;
 				ip_temp->hash_quals = gjpath->inners[i].hash_quals;
+				ip_temp->range_quals = gjpath->inners[i].range_quals;
 				ip_temp->join_nrows = gjpath->inners[i].join_nrows;
 
 				ip_items_list = lcons(ip_temp, ip_items_list);
@@ -1109,6 +1549,12 @@ try_add_gpujoin_paths(PlannerInfo *root,
 										join_path->innerjoinpath->parent,
 										join_path->jointype,
 										join_path->joinrestrictinfo);
+			ip_item->range_quals = extract_gpurangejoin_quals(
+										root,
+										join_path->outerjoinpath->parent,
+										join_path->innerjoinpath->parent,
+										join_path->jointype,
+										join_path->joinrestrictinfo);
 			ip_item->join_nrows = join_path->path.parent->rows;
 			ip_items_list = lcons(ip_item, ip_items_list);
 			outer_path = join_path->outerjoinpath;
@@ -1453,6 +1899,8 @@ build_device_targetlist(GpuJoinPath *gpath,
 	build_device_tlist_walker((Node *)gj_info->other_quals, &context);
 	build_device_tlist_walker((Node *)gj_info->hash_inner_keys, &context);
 	build_device_tlist_walker((Node *)gj_info->hash_outer_keys, &context);
+	build_device_tlist_walker((Node *)gj_info->range_inner_keys, &context);
+	build_device_tlist_walker((Node *)gj_info->range_outer_keys, &context);
 	build_device_tlist_walker((Node *)targetlist, &context);
 
 	Assert(list_length(context.ps_tlist) == list_length(context.ps_depth) &&
@@ -1579,6 +2027,7 @@ PlanGpuJoinPath(PlannerInfo *root,
 	gj_info.outer_startup_cost = outer_plan->startup_cost;
 	gj_info.outer_total_cost = outer_plan->total_cost;
 	gj_info.num_rels = gjpath->num_rels;
+	gj_info.fingerprint = gjpath->fingerprint;
 
 	if (outer_relid)
 		pull_varattnos((Node *)tlist, outer_relid, &varattnos);
@@ -1588,6 +2037,9 @@ PlanGpuJoinPath(PlannerInfo *root,
 	{
 		List	   *hash_inner_keys = NIL;
 		List	   *hash_outer_keys = NIL;
+		Expr	   *range_inner_key = NULL;
+		Expr	   *range_outer_key = NULL;
+		int			range_op = 0;
 		List	   *join_quals = NIL;
 		List	   *other_quals = NIL;
 
@@ -1622,6 +2074,24 @@ PlanGpuJoinPath(PlannerInfo *root,
 				elog(ERROR, "Bug? hash-clause reference bogus varnos");
 		}
 
+		if (gjpath->inners[i].range_quals != NIL)
+		{
+			Path		   *scan_path = gjpath->inners[i].scan_path;
+			RestrictInfo   *rinfo = linitial(gjpath->inners[i].range_quals);
+			Relids			outer_relids;
+
+			outer_relids = bms_difference(gjpath->cpath.path.parent->relids,
+										  scan_path->parent->relids);
+			range_op = gpujoin_range_clause_analyze(rinfo->clause,
+													outer_relids,
+													scan_path->parent->relids,
+													&range_inner_key,
+													&range_outer_key);
+			if (range_op == 0)
+				elog(ERROR, "Bug? range-clause is not supported: %s",
+					 nodeToString(rinfo->clause));
+		}
+
 		/*
 		 * Add properties of GpuJoinInfo
 		 */
@@ -1631,6 +2101,8 @@ PlanGpuJoinPath(PlannerInfo *root,
 									pmakeFloat(gjpath->inners[i].join_nrows));
 		gj_info.ichunk_size = lappend_int(gj_info.ichunk_size,
 										  gjpath->inners[i].ichunk_size);
+		gj_info.inner_nparts = lappend_int(gj_info.inner_nparts,
+										   gjpath->inners[i].nparts);
 		gj_info.join_types = lappend_int(gj_info.join_types,
 										 gjpath->inners[i].join_type);
 
@@ -1657,11 +2129,17 @@ PlanGpuJoinPath(PlannerInfo *root,
 										  hash_inner_keys);
 		gj_info.hash_outer_keys = lappend(gj_info.hash_outer_keys,
 										  hash_outer_keys);
+		gj_info.range_ops = lappend_int(gj_info.range_ops, range_op);
+		gj_info.range_inner_keys = lappend(gj_info.range_inner_keys,
+										   range_inner_key);
+		gj_info.range_outer_keys = lappend(gj_info.range_outer_keys,
+										   range_outer_key);
 		outer_nrows = gjpath->inners[i].join_nrows;
 
 		if (outer_relid)
 		{
 			pull_varattnos((Node *)hash_outer_keys, outer_relid, &varattnos);
+			pull_varattnos((Node *)range_outer_key, outer_relid, &varattnos);
 			pull_varattnos((Node *)join_quals, outer_relid, &varattnos);
 			pull_varattnos((Node *)other_quals, outer_relid, &varattnos);
 		}
@@ -1812,6 +2290,61 @@ gpujoin_create_scan_state(CustomScan *node)
 	return (Node *) gjs;
 }
 
+/*
+ * gpujoin_init_bloom_filter
+ *
+ * It checks whether the outer relation scan by CPU can apply the bloom
+ * filter built on the inner hash table of the first depth. Its join keys
+ * have to be simple column references of the outer relation, to calculate
+ * the hash value on the heap tuple prior to the projection.
+ * The hash value of varlena keys is not calculated here, because it may
+ * need de-toasting under the buffer lock.
+ */
+static void
+gpujoin_init_bloom_filter(GpuJoinState *gjs, GpuJoinInfo *gj_info)
+{
+	innerState *istate = &gjs->inners[0];
+	GpuJoinBloomFilter *bloom;
+	ListCell   *lc;
+	int			nkeys = list_length(istate->hash_outer_keys);
+	int			i = 0;
+
+	if (!gjs->gts.css.ss.ss_currentRelation || nkeys == 0)
+		return;
+	if (istate->join_type != JOIN_INNER &&
+		istate->join_type != JOIN_SEMI &&
+		istate->join_type != JOIN_RIGHT)
+		return;
+
+	bloom = palloc0(offsetof(GpuJoinBloomFilter, keys[nkeys]));
+	foreach (lc, istate->hash_outer_keys)
+	{
+		ExprState  *key_state = lfirst(lc);
+		Var		   *var = (Var *) key_state->expr;
+		devtype_info *dtype;
+
+		if (!IsA(var, Var) ||
+			var->varno != INDEX_VAR ||
+			list_nth_int(gj_info->ps_src_depth, var->varattno - 1) != 0)
+		{
+			pfree(bloom);
+			return;
+		}
+		dtype = pgstrom_devtype_lookup(var->vartype);
+		if (!dtype || dtype->type_length < 0)
+		{
+			pfree(bloom);
+			return;
+		}
+		bloom->keys[i].anum = list_nth_int(gj_info->ps_src_resno,
+										   var->varattno - 1);
+		bloom->keys[i].dtype = dtype;
+		i++;
+	}
+	bloom->nkeys = nkeys;
+	gjs->outer_bloom = bloom;
+}
+
 static void
 ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 {
@@ -1831,9 +2364,12 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	cl_int			i, j, nattrs;
 	StringInfoData	kern_define;
 	ProgramId		program_id;
+	int				cuda_dindex = -1;
 
 	/* activate a GpuContext for CUDA kernel execution */
-	gjs->gts.gcontext = AllocGpuContext(-1, false);
+	if (ss->ss_currentRelation && !explain_only)
+		cuda_dindex = RelationOptimalGpuForNvmeStrom(ss->ss_currentRelation);
+	gjs->gts.gcontext = AllocGpuContext(cuda_dindex, false);
 	if (!explain_only)
 		ActivateGpuContext(gjs->gts.gcontext);
 	/*
@@ -1865,6 +2401,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	gjs->gts.cb_switch_task		= gpujoin_switch_task;
 	gjs->gts.cb_process_task	= gpujoin_process_task;
 	gjs->gts.cb_release_task	= gpujoin_release_task;
+	gjs->gts.cb_bulk_exec		= gpujoin_bulk_exec;
 	gjs->gts.outer_nrows_per_block = gj_info->outer_nrows_per_block;
 
 	/* DSM & GPU memory of inner buffer */
@@ -1872,6 +2409,16 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	gjs->m_kmrels_array = NULL;
 	gjs->seg_kmrels = NULL;
 	gjs->curr_outer_depth = -1;
+	gjs->ojmap_detached = false;
+	gjs->ojmap_runner = false;
+	gjs->part_depth = 0;
+	gjs->part_nums = 1;
+	gjs->m_kmrels_parts = NULL;
+	gjs->part_batched = false;
+	gjs->curr_part = 0;
+	gjs->fallback_part = -1;
+	gjs->batch_chunks = NIL;
+	gjs->batch_curr = NULL;
 
 	/*
 	 * NOTE: outer_quals, hash_outer_keys and join_quals are intended
@@ -1887,6 +2434,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	 */
 	gjs->num_rels = gj_info->num_rels;
 	gjs->join_types = gj_info->join_types;
+	gjs->fingerprint = gj_info->fingerprint;
 	if (gj_info->outer_quals)
 	{
 		ExprState  *expr_state = ExecInitExpr(gj_info->outer_quals, &ss->ps);
@@ -1895,6 +2443,8 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 #else
 		gjs->outer_quals = expr_state;
 #endif
+		pgstrom_ccache_init_zonemap(&gjs->gts,
+									make_ands_implicit(gj_info->outer_quals));
 	}
 	gjs->outer_ratio = gj_info->outer_ratio;
 	gjs->outer_nrows = gj_info->outer_nrows;
@@ -1914,6 +2464,8 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		outerPlanState(gjs) = ExecInitNode(outerPlan(cscan), estate, eflags);
 		outer_slot = outerPlanState(gjs)->ps_ResultTupleSlot;
 		nattrs = outer_slot->tts_tupleDescriptor->natts;
+		gjs->gts.outer_bulkexec = pgstromBulkExecEnabled(&gjs->gts,
+														 outerPlanState(gjs));
 	}
 
 	/*
@@ -2027,6 +2579,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		Expr	   *other_quals;
 		List	   *hash_inner_keys;
 		List	   *hash_outer_keys;
+		Expr	   *range_inner_key;
 		TupleTableSlot *inner_slot;
 		double		plan_nrows_in;
 		double		plan_nrows_out;
@@ -2038,7 +2591,15 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		plan_nrows_out = floatVal(list_nth(gj_info->plan_nrows_out, i));
 		istate->nrows_ratio = plan_nrows_out / Max(plan_nrows_in, 1.0);
 		istate->ichunk_size = list_nth_int(gj_info->ichunk_size, i);
+		istate->nparts = list_nth_int(gj_info->inner_nparts, i);
 		istate->join_type = (JoinType)list_nth_int(gj_info->join_types, i);
+		if (istate->nparts > 1)
+		{
+			Assert(gjs->part_depth == 0);
+			gjs->part_depth = istate->depth;
+			gjs->part_nums = istate->nparts;
+			gjs->part_batched = (istate->nparts > numDevAttrs);
+		}
 
 		/*
 		 * NOTE: We need to deal with Var-node references carefully,
@@ -2110,6 +2671,23 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 			}
 		}
 
+		/*
+		 * range_inner_key is also called to construct the range index
+		 * prior to GPU execution, on the result of child plan.
+		 */
+		range_inner_key = list_nth(gj_info->range_inner_keys, i);
+		if (range_inner_key)
+		{
+			List   *temp = fixup_varnode_to_origin(i+1,
+												   gj_info->ps_src_depth,
+												   gj_info->ps_src_resno,
+												   list_make1(range_inner_key));
+			range_inner_key = linitial(temp);
+			istate->range_inner_key = ExecInitExpr(range_inner_key, &ss->ps);
+			istate->range_inner_type = exprType((Node *)range_inner_key);
+			istate->range_op = list_nth_int(gj_info->range_ops, i);
+		}
+
 		/*
 		 * CPU fallback setup for INNER reference
 		 */
@@ -2143,6 +2721,8 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		gjs->gts.css.custom_ps = lappend(gjs->gts.css.custom_ps,
 										 istate->state);
 	}
+	/* bloom filter on the outer relation scan, if any */
+	gpujoin_init_bloom_filter(gjs, gj_info);
 
 	/*
 	 * Construct CUDA program, and kick asynchronous compile process.
@@ -2211,6 +2791,10 @@ ExecEndGpuJoin(CustomScanState *node)
 	/* wait for completion of any asynchronous GpuTask */
 	SynchronizeGpuContext(gjs->gts.gcontext);
 
+	/* record the actual join ratios for the next time */
+	if (!IsParallelWorker() && gjs->gts.scan_done && gjs->gj_rtstat)
+		gpujoin_update_cardinality_feedback(gjs);
+
 	/* shutdown inner/outer subtree */
 	ExecEndNode(outerPlanState(node));
 	for (i=0; i < gjs->num_rels; i++)
@@ -2220,6 +2804,62 @@ ExecEndGpuJoin(CustomScanState *node)
 	pgstromReleaseGpuTaskState(&gjs->gts);
 }
 
+/*
+ * gpujoin_update_cardinality_feedback
+ *
+ * It records the join ratio of each depth, using the run-time statistics.
+ */
+static void
+gpujoin_update_cardinality_feedback(GpuJoinState *gjs)
+{
+	GpuJoinRuntimeStat *gj_rtstat = gjs->gj_rtstat;
+	double		ratios[CARDINALITY_FEEDBACK_MAX_VALUES];
+	double		nrows_in;
+	double		nrows_out;
+	int			depth;
+
+	if (gjs->num_rels > CARDINALITY_FEEDBACK_MAX_VALUES)
+		return;
+	nrows_in = (double)(pg_atomic_read_u64(&gj_rtstat->jstat[0].inner_nitems) +
+						pg_atomic_read_u64(&gj_rtstat->jstat[0].right_nitems));
+	if (nrows_in <= 0.0)
+		return;		/* no outer rows, so nothing to learn */
+	for (depth=1; depth <= gjs->num_rels; depth++)
+	{
+		nrows_out = (double)
+			(pg_atomic_read_u64(&gj_rtstat->jstat[depth].inner_nitems) +
+			 pg_atomic_read_u64(&gj_rtstat->jstat[depth].right_nitems));
+		ratios[depth-1] = (nrows_in > 0.0 ? nrows_out / nrows_in : 0.0);
+		nrows_in = nrows_out;
+	}
+	pgstromUpdateCardinalityFeedback(gjs->fingerprint,
+									 ratios, gjs->num_rels);
+}
+
+/*
+ * gpujoin_inner_is_reusable
+ *
+ * It checks whether the inner buffer already loaded can be reused on
+ * rescan as is. Outer join maps are updated during execution, and the
+ * partitioned inner buffer has to be reloaded for each batch, so these
+ * cases are not reusable. In case of parallel query, the shared state
+ * is re-initialized on rescan, so the inner buffer is never kept.
+ */
+static bool
+gpujoin_inner_is_reusable(GpuJoinState *gjs)
+{
+	kern_multirels *h_kmrels;
+
+	if (!gjs->gj_sstate || !gjs->seg_kmrels)
+		return false;	/* not loaded yet */
+	if (gjs->gts.pcxt != NULL || gjs->part_batched || gjs->part_nums > 1)
+		return false;
+	if (gjs->seg_kmrels == (void *)(~0UL))
+		return true;	/* empty inner, no need to run GpuJoin again */
+	h_kmrels = dsm_segment_address(gjs->seg_kmrels);
+	return (h_kmrels->ojmaps_length == 0);
+}
+
 static void
 ExecReScanGpuJoin(CustomScanState *node)
 {
@@ -2228,6 +2868,9 @@ ExecReScanGpuJoin(CustomScanState *node)
 
 	/* wait for completion of any asynchronous GpuTask */
 	SynchronizeGpuContext(gjs->gts.gcontext);
+	/* outer chunks retained for the batches are no longer valid */
+	if (gjs->part_batched)
+		gpujoin_release_batch_chunks(gjs);
 	/* rescan the outer sub-plan */
 	if (outerPlanState(gjs))
 		ExecReScan(outerPlanState(gjs));
@@ -2239,16 +2882,36 @@ ExecReScanGpuJoin(CustomScanState *node)
 	 */
 	if (gjs->gts.css.ss.ps.chgParam != NULL)
 	{
+		bool	inner_changed = false;
+
 		for (i=0; i < gjs->num_rels; i++)
 		{
 			innerState *istate = &gjs->inners[i];
 
-			UpdateChangedParamSet(gjs->inners[i].state,
+			UpdateChangedParamSet(istate->state,
 								  gjs->gts.css.ss.ps.chgParam);
 			if (istate->state->chgParam != NULL)
-				ExecReScan(istate->state);
+				inner_changed = true;
 		}
-		/* rewind the inner hash/heap buffer */
+
+		/*
+		 * If none of the changed parameters are referenced by the inner
+		 * side, the inner buffer already loaded is still valid, so we can
+		 * skip the expensive reconstruction of the hash/heap table.
+		 */
+		if (inner_changed || !gpujoin_inner_is_reusable(gjs))
+		{
+			/* all the inner relations shall be reloaded */
+			for (i=0; i < gjs->num_rels; i++)
+				ExecReScan(gjs->inners[i].state);
+			/* rewind the inner hash/heap buffer */
+			GpuJoinInnerUnload(&gjs->gts, true);
+		}
+	}
+	else if (gjs->part_batched && gjs->curr_part > 0)
+	{
+		/* partition of the first batch has to be reloaded */
+		ExecReScan(gjs->inners[gjs->part_depth - 1].state);
 		GpuJoinInnerUnload(&gjs->gts, true);
 	}
 	/* common rescan handling */
@@ -2319,6 +2982,14 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
                             gj_info->outer_total_cost,
                             gj_info->outer_nrows,
                             gj_info->outer_width);
+	if (gj_rtstat && es->analyze)
+	{
+		uint64		bloom_nitems = pg_atomic_read_u64(&gj_rtstat->bloom_nitems);
+
+		if (bloom_nitems > 0)
+			ExplainPropertyLong("Rows Removed by Bloom Filter",
+								bloom_nitems, es);
+	}
 	/* join-qualifiers */
 	depth = 1;
 	forfour (lc1, gj_info->join_types,
@@ -2330,8 +3001,9 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 		Expr	   *join_quals = lfirst(lc2);
 		Expr	   *other_quals = lfirst(lc3);
 		Expr	   *hash_outer_key = lfirst(lc4);
+		Expr	   *range_outer_key;
 		innerState *istate = &gjs->inners[depth-1];
-		kern_data_store *kds_in = NULL;
+		Size		kds_in_length = 0;
 		int			indent_width;
 		double		plan_nrows_in;
 		double		plan_nrows_out;
@@ -2342,7 +3014,7 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 		if (gjs->seg_kmrels)
 		{
 			kern_multirels *kmrels = dsm_segment_address(gjs->seg_kmrels);
-			kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+			gpujoin_inner_chunk_stat(kmrels, depth, NULL, &kds_in_length);
 		}
 
 		/* fetch number of rows */
@@ -2365,14 +3037,18 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			appendStringInfo(&str, "GpuHash%sJoin",
 							 join_type == JOIN_FULL ? "Full" :
 							 join_type == JOIN_LEFT ? "Left" :
-							 join_type == JOIN_RIGHT ? "Right" : "");
+							 join_type == JOIN_RIGHT ? "Right" :
+							 join_type == JOIN_SEMI ? "Semi" :
+							 join_type == JOIN_ANTI ? "Anti" : "");
 		}
 		else
 		{
 			appendStringInfo(&str, "GpuNestLoop%s",
 							 join_type == JOIN_FULL ? "Full" :
 							 join_type == JOIN_LEFT ? "Left" :
-							 join_type == JOIN_RIGHT ? "Right" : "");
+							 join_type == JOIN_RIGHT ? "Right" :
+							 join_type == JOIN_SEMI ? "Semi" :
+							 join_type == JOIN_ANTI ? "Anti" : "");
 		}
 		snprintf(qlabel, sizeof(qlabel), "Depth% 2d", depth);
 		indent_width = es->indent * 2 + strlen(qlabel) + 2;
@@ -2448,6 +3124,30 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			}
 		}
 
+		/*
+		 * RangeKeys, if range index is used
+		 */
+		range_outer_key = list_nth(gj_info->range_outer_keys, depth-1);
+		if (range_outer_key)
+		{
+			temp = deparse_expression((Node *)range_outer_key,
+									  dcontext, true, false);
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				appendStringInfoSpaces(es->str, indent_width);
+				appendStringInfo(es->str, "RangeKeys: %s (%s)
+", temp,
+								 istate->range_op == GPUJOIN_RANGE_OP__OVERLAP
+								 ? "overlap" : "contained");
+			}
+			else
+			{
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth% 2d RangeKeys", depth);
+				ExplainPropertyText(qlabel, temp, es);
+			}
+		}
+
 		/*
 		 * JoinQuals, if any
 		 */
@@ -2495,18 +3195,27 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			appendStringInfoSpaces(es->str, indent_width);
 			if (!es->analyze)
 			{
-				appendStringInfo(es->str, "KDS-%s (size: %s)",
+				appendStringInfo(es->str, "KDS-%s (size: %s",
 								 hash_outer_key ? "Hash" : "Heap",
 								 format_bytesz(istate->ichunk_size));
 			}
 			else
 			{
-				appendStringInfo(es->str, "KDS-%s (size plan: %s, exec: %s)",
+				appendStringInfo(es->str, "KDS-%s (size plan: %s, exec: %s",
 								 hash_outer_key ? "Hash" : "Heap",
 								 format_bytesz(istate->ichunk_size),
-								 format_bytesz(kds_in->length));
+								 format_bytesz(kds_in_length));
+				if (istate->runtime_nestloop)
+					appendStringInfo(es->str, ", run as nest-loop");
+				if (istate->skew_nslots > 0)
+					appendStringInfo(es->str, ", heavy hitters: %d",
+									 istate->skew_nslots);
 			}
-			appendStringInfoChar(es->str, '\n');
+			if (istate->nparts > 1)
+				appendStringInfo(es->str, ", %s: %d",
+								 gjs->part_batched ? "batches" : "partitions",
+								 istate->nparts);
+			appendStringInfo(es->str, ")\n");
 		}
 		else
 		{
@@ -2523,7 +3232,26 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			{
 				snprintf(qlabel, sizeof(qlabel),
 						 "Depth % 2d KDS Exec Size", depth);
-				ExplainPropertyText(qlabel, format_bytesz(kds_in->length), es);
+				ExplainPropertyText(qlabel, format_bytesz(kds_in_length), es);
+
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth % 2d Exec Join", depth);
+				ExplainPropertyText(qlabel,
+									(!hash_outer_key ||
+									 istate->runtime_nestloop
+									 ? "NestLoop" : "HashJoin"), es);
+
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth % 2d Heavy Hitters", depth);
+				ExplainPropertyInteger(qlabel, istate->skew_nslots, es);
+			}
+			if (istate->nparts > 1)
+			{
+				snprintf(qlabel, sizeof(qlabel),
+						 gjs->part_batched
+						 ? "Depth % 2d KDS Batches"
+						 : "Depth % 2d KDS Partitions", depth);
+				ExplainPropertyInteger(qlabel, istate->nparts, es);
 			}
 		}
 		depth++;
@@ -2545,6 +3273,7 @@ ExecGpuJoinEstimateDSM(CustomScanState *node,
 							 pergpu[numDevAttrs]))
 		+ MAXALIGN(offsetof(GpuJoinRuntimeStat,
 							jstat[gjs->num_rels + 1]))
+		+ MAXALIGN(sizeof(dsm_handle) * gjs->num_rels)
 		+ pgstromEstimateDSMGpuTaskState((GpuTaskState *)node, pcxt);
 }
 
@@ -2558,6 +3287,9 @@ ExecGpuJoinInitDSM(CustomScanState *node,
 {
 	GpuJoinState   *gjs = (GpuJoinState *) node;
 
+	/* partitions per batch must be switched by all the workers together */
+	if (gjs->part_batched)
+		elog(ERROR, "GpuJoin: batched partitions of inner hash table are not supported in parallel query");
 	/* save the ParallelContext */
 	gjs->gts.pcxt = pcxt;
 	/* ensure to stop workers prior to detach DSM */
@@ -2618,6 +3350,8 @@ ExecShutdownGpuJoin(CustomScanState *node)
 	GpuJoinRuntimeStat *gj_rtstat_old = gjs->gj_rtstat;
 	size_t				length;
 
+	/* move the timing statistics from DSM also */
+	pgstromShutdownDSMGpuTaskState(&gjs->gts);
 	if (!gj_rtstat_old)
 	{
 		/*
@@ -3070,50 +3804,154 @@ gpujoin_codegen_hash_value(StringInfo source,
 }
 
 /*
- * gpujoin_codegen_projection
- *
- * It makes a device function for device projection.
+ * codegen for:
+ * STATIC_FUNCTION(cl_int)
+ * gpujoin_range_key_depth%u(kern_context *kcxt,
+ *                           kern_data_store *kds,
+ *                           kern_multirels *kmrels,
+ *                           cl_uint *o_buffer,
+ *                           cl_long *p_lower,
+ *                           cl_long *p_upper)
  */
 static void
-gpujoin_codegen_projection(StringInfo source,
-						   CustomScan *cscan,
-						   GpuJoinInfo *gj_info,
-						   codegen_context *context,
-						   cl_uint *p_extra_maxlen)
+gpujoin_codegen_range_key(StringInfo source,
+						  GpuJoinInfo *gj_info,
+						  int cur_depth,
+						  codegen_context *context)
 {
-	List		   *tlist_dev = cscan->custom_scan_tlist;
-	List		   *ps_src_depth = gj_info->ps_src_depth;
-	List		   *ps_src_resno = gj_info->ps_src_resno;
-	ListCell	   *lc1;
-	ListCell	   *lc2;
-	ListCell	   *lc3;
-	AttrNumber	   *varattmaps;
-	Bitmapset	   *refs_by_vars = NULL;
-	Bitmapset	   *refs_by_expr = NULL;
 	StringInfoData	body;
-	StringInfoData	temp;
-	StringInfoData	row;
-	StringInfoData	column;
-	cl_int			depth;
-	cl_uint			extra_maxlen = 0;
-	cl_bool			is_first;
-
-	varattmaps = palloc(sizeof(AttrNumber) * list_length(tlist_dev));
-	initStringInfo(&body);
-	initStringInfo(&temp);
-	initStringInfo(&row);
-	initStringInfo(&column);
+	Node		   *key_expr;
+	Oid				key_type;
+	int				range_op;
+	devtype_info   *dtype;
 
-	/*
-	 * Pick up all the var-node referenced directly or indirectly by
-	 * device expressions; which are resjunk==false.
-	 */
-	forthree (lc1, tlist_dev,
-			  lc2, ps_src_depth,
-			  lc3, ps_src_resno)
-	{
-		TargetEntry	*tle = lfirst(lc1);
-		cl_int		src_depth = lfirst_int(lc2);
+	Assert(cur_depth > 0 && cur_depth <= gj_info->num_rels);
+	key_expr = list_nth(gj_info->range_outer_keys, cur_depth - 1);
+	range_op = list_nth_int(gj_info->range_ops, cur_depth - 1);
+	Assert(key_expr != NULL);
+	key_type = exprType(key_expr);
+	dtype = pgstrom_devtype_lookup(key_type);
+	if (!dtype)
+		elog(ERROR, "Bug? device type \"%s\" not found",
+			 format_type_be(key_type));
+
+	appendStringInfo(
+		source,
+		"STATIC_FUNCTION(cl_int)\n"
+		"gpujoin_range_key_depth%u(kern_context *kcxt,\n"
+		"                          kern_data_store *kds,\n"
+		"                          kern_multirels *kmrels,\n"
+		"                          cl_uint *o_buffer,\n"
+		"                          cl_long *p_lower,\n"
+		"                          cl_long *p_upper)\n"
+		"{\n"
+		"  pg_anytype_t temp    __attribute__((unused));\n",
+		cur_depth);
+
+	context->used_vars = NIL;
+	context->param_refs = NULL;
+
+	initStringInfo(&body);
+	appendStringInfo(
+		&body,
+		"  /* Range-key evaluation */\n"
+		"  temp.%s_v = %s;\n"
+		"  if (temp.%s_v.isnull)\n"
+		"    return GPUJOIN_RANGE_KEY__NONE;\n",
+		dtype->type_name,
+		pgstrom_codegen_expression(key_expr, context),
+		dtype->type_name);
+	if (type_is_range(key_type))
+	{
+		/* empty range overlaps nothing, but contained by everything */
+		appendStringInfo(
+			&body,
+			"  if (temp.%s_v.value.empty)\n"
+			"    return %s;\n"
+			"  *p_lower = (temp.%s_v.value.l.infinite\n"
+			"              ? LONG_MIN\n"
+			"              : (cl_long)temp.%s_v.value.l.val);\n"
+			"  *p_upper = (temp.%s_v.value.u.infinite\n"
+			"              ? LONG_MAX\n"
+			"              : (cl_long)temp.%s_v.value.u.val);\n",
+			dtype->type_name,
+			range_op == GPUJOIN_RANGE_OP__OVERLAP
+			? "GPUJOIN_RANGE_KEY__NONE"
+			: "GPUJOIN_RANGE_KEY__FULL",
+			dtype->type_name,
+			dtype->type_name,
+			dtype->type_name,
+			dtype->type_name);
+	}
+	else
+	{
+		appendStringInfo(
+			&body,
+			"  *p_lower = *p_upper = (cl_long)temp.%s_v.value;\n",
+			dtype->type_name);
+	}
+
+	/*
+	 * variable/params declaration & initialization
+	 */
+	gpujoin_codegen_var_param_decl(source, gj_info,
+								   cur_depth, context);
+	appendStringInfo(
+		source,
+		"%s"
+		"\n"
+		"  return GPUJOIN_RANGE_KEY__BOUND;\n"
+		"}\n"
+		"\n",
+		body.data);
+	pfree(body.data);
+}
+
+/*
+ * gpujoin_codegen_projection
+ *
+ * It makes a device function for device projection.
+ */
+static void
+gpujoin_codegen_projection(StringInfo source,
+						   CustomScan *cscan,
+						   GpuJoinInfo *gj_info,
+						   codegen_context *context,
+						   cl_uint *p_extra_maxlen)
+{
+	List		   *tlist_dev = cscan->custom_scan_tlist;
+	List		   *ps_src_depth = gj_info->ps_src_depth;
+	List		   *ps_src_resno = gj_info->ps_src_resno;
+	ListCell	   *lc1;
+	ListCell	   *lc2;
+	ListCell	   *lc3;
+	AttrNumber	   *varattmaps;
+	Bitmapset	   *refs_by_vars = NULL;
+	Bitmapset	   *refs_by_expr = NULL;
+	StringInfoData	body;
+	StringInfoData	temp;
+	StringInfoData	row;
+	StringInfoData	column;
+	cl_int			depth;
+	cl_uint			extra_maxlen = 0;
+	cl_bool			is_first;
+
+	varattmaps = palloc(sizeof(AttrNumber) * list_length(tlist_dev));
+	initStringInfo(&body);
+	initStringInfo(&temp);
+	initStringInfo(&row);
+	initStringInfo(&column);
+
+	/*
+	 * Pick up all the var-node referenced directly or indirectly by
+	 * device expressions; which are resjunk==false.
+	 */
+	forthree (lc1, tlist_dev,
+			  lc2, ps_src_depth,
+			  lc3, ps_src_resno)
+	{
+		TargetEntry	*tle = lfirst(lc1);
+		cl_int		src_depth = lfirst_int(lc2);
 
 		if (tle->resjunk)
 			continue;
@@ -3619,18 +4457,25 @@ gpujoin_codegen_projection(StringInfo source,
 			 *
 			 * Unless it is not obvious by the node type, we have to walk on
 			 * the possible buffer range to find out right one. :-(
+			 *
+			 * Varlena datum built or decompressed on the per-thread buffer
+			 * of kern_context is not on the above buffers, so it is handed
+			 * to CPU.
 			 */
 			appendStringInfo(
 				&body,
 				"  temp.%s_v = %s;\n"
 				"  tup_isnull[%d] = temp.%s_v.isnull;\n"
 				"  tup_values[%d] = PointerGetDatum(temp.%s_v.value);\n"
-				"  use_extra_buf[%d] = false;\n",
+				"  use_extra_buf[%d] = false;\n"
+				"  kern_context_check_varlena(kcxt, temp.%s_v.isnull,\n"
+				"                             temp.%s_v.value);\n",
 				dtype->type_name,
 				pgstrom_codegen_expression((Node *)tle->expr, context),
 				tle->resno - 1, dtype->type_name,
 				tle->resno - 1, dtype->type_name,
-				tle->resno - 1);
+				tle->resno - 1,
+				dtype->type_name, dtype->type_name);
 		}
 	}
 	/* how much extra field required? */
@@ -3759,6 +4604,54 @@ gpujoin_codegen(PlannerInfo *root,
 		"}\n"
 		"\n");
 
+	depth = 1;
+	foreach (cell, gj_info->range_outer_keys)
+	{
+		if (lfirst(cell) != NULL)
+			gpujoin_codegen_range_key(&source, gj_info, depth, context);
+		depth++;
+	}
+
+	/*
+	 * gpujoin_range_key
+	 */
+	appendStringInfo(
+		&source,
+		"STATIC_FUNCTION(cl_int)\n"
+		"gpujoin_range_key(kern_context *kcxt,\n"
+		"                  kern_data_store *kds,\n"
+		"                  kern_multirels *kmrels,\n"
+		"                  cl_int depth,\n"
+		"                  cl_uint *o_buffer,\n"
+		"                  cl_long *p_lower,\n"
+		"                  cl_long *p_upper)\n"
+		"{\n"
+		"  switch (depth)\n"
+		"  {\n");
+	depth = 1;
+	foreach (cell, gj_info->range_outer_keys)
+	{
+		if (lfirst(cell) != NULL)
+		{
+			appendStringInfo(
+				&source,
+				"  case %u:\n"
+				"    return gpujoin_range_key_depth%u(kcxt,kds,kmrels,o_buffer,\n"
+				"                                     p_lower,p_upper);\n",
+				depth, depth);
+		}
+		depth++;
+	}
+	appendStringInfo(
+		&source,
+		"  default:\n"
+		"    STROM_SET_ERROR(&kcxt->e, StromError_WrongCodeGeneration);\n"
+		"    break;\n"
+		"  }\n"
+		"  return GPUJOIN_RANGE_KEY__FULL;\n"
+		"}\n"
+		"\n");
+
 	/*
 	 * gpujoin_projection
 	 */
@@ -3828,6 +4721,68 @@ GpuJoinSetupTask(struct kern_gpujoin *kgjoin, GpuTaskState *gts,
 			mp_count * suspend_sz);
 }
 
+/*
+ * gpujoin_estimate_dest_length
+ *
+ * It estimates the length of the destination buffer for the supplied chunk,
+ * based on the join selectivity observed by the preceding tasks. Exploding
+ * joins would cause a series of suspend/resume of GPU kernel if we always
+ * assign a buffer of pgstrom_chunk_size().
+ */
+static Size
+gpujoin_estimate_dest_length(GpuJoinState *gjs, pgstrom_data_store *pds_src)
+{
+	GpuJoinRuntimeStat *gj_rtstat = gjs->gj_rtstat;
+	TupleTableSlot *scan_slot = gjs->gts.css.ss.ss_ScanTupleSlot;
+	TupleDesc		scan_tupdesc = scan_slot->tts_tupleDescriptor;
+	Size			chunk_sz = pgstrom_chunk_size();
+	Size			tuple_sz;
+	Size			length;
+	cl_ulong		source_nitems;
+	cl_ulong		result_nitems;
+	double			nrows;
+
+	if (!pds_src)
+		return chunk_sz;
+	source_nitems = pg_atomic_read_u64(&gj_rtstat->source_nitems);
+	result_nitems =
+		pg_atomic_read_u64(&gj_rtstat->jstat[gjs->num_rels].inner_nitems);
+	if (source_nitems == 0)
+		return chunk_sz;
+
+	if (pds_src->kds.format == KDS_FORMAT_BLOCK)
+		nrows = ((double)pds_src->kds.nitems *
+				 (double)gjs->gts.outer_nrows_per_block);
+	else
+		nrows = (double)pds_src->kds.nitems;
+	/* 25% margin for fluctuation of the selectivity */
+	nrows *= 1.25 * (double)result_nitems / (double)source_nitems;
+
+	tuple_sz = (sizeof(cl_uint) +
+				MAXALIGN(offsetof(kern_tupitem, htup) + gjs->result_width));
+	if (nrows * (double)tuple_sz >= (double)GPUJOIN_DEST_MAXLEN)
+		return GPUJOIN_DEST_MAXLEN;
+	length = KDS_CALCULATE_HEAD_LENGTH(scan_tupdesc->natts) +
+		(Size)(nrows * (double)tuple_sz);
+
+	return STROMALIGN(Min(Max(length, chunk_sz), GPUJOIN_DEST_MAXLEN));
+}
+
+/*
+ * gpujoin_next_dest_length
+ *
+ * It determines the length of the next destination buffer once GPU kernel
+ * got suspended. It grows geometrically, so the number of suspend/resume
+ * cycles per chunk is bounded to logarithmic order of the result size.
+ */
+static inline Size
+gpujoin_next_dest_length(pgstrom_data_store *pds_dst)
+{
+	Size	length = 2 * (Size)pds_dst->kds.length;
+
+	return STROMALIGN_DOWN(Min(length, GPUJOIN_DEST_MAXLEN));
+}
+
 /*
  * gpujoin_create_task
  */
@@ -3861,10 +4816,16 @@ gpujoin_create_task(GpuJoinState *gjs,
 	pgjoin->pds_src = pds_src;
 	pgjoin->pds_dst = PDS_create_row(gcontext,
 									 scan_tupdesc,
-									 pgstrom_chunk_size());
+									 gpujoin_estimate_dest_length(gjs,
+																  pds_src));
 	dlist_init(&pgjoin->pds_dst_inactives);
+	pgjoin->kern_length = required;
 	pgjoin->outer_depth = outer_depth;
+	pgjoin->part_index = gjs->curr_part;
 	pgjoin->is_dummy_task = (pds_src == NULL);
+	/* tasks which share the same kern_multirels prefer the same worker */
+	pgjoin->task.affinity = (cl_int)(((uintptr_t)gjs->seg_kmrels +
+									  gjs->curr_part) & INT_MAX);
 
 	/* Is NVMe-Strom available to run this GpuJoin? */
 	if (pds_src && pds_src->kds.format == KDS_FORMAT_BLOCK)
@@ -3889,9 +4850,27 @@ GpuJoinExecOuterScanChunk(GpuTaskState *gts)
 
 	if (gjs->gts.css.ss.ss_currentRelation)
 	{
+		GpuJoinBloomFilter *bloom = gjs->gts.outer_bloom;
+
 		pds = gpuscanExecScanChunk(gts);
-		if (pds && pds->kds.format == KDS_FORMAT_COLUMN)
+		if (pds && pds->kds.format == KDS_FORMAT_COLUMN &&
+			!gts->af_state)
 			pg_atomic_add_fetch_u64(&gj_rtstat->ccache_count, 1);
+		/* flush the rows discarded by the bloom filter */
+		if (bloom && bloom->nskipped > 0)
+		{
+			pg_atomic_add_fetch_u64(&gj_rtstat->source_nitems,
+									bloom->nskipped);
+			pg_atomic_add_fetch_u64(&gj_rtstat->bloom_nitems,
+									bloom->nskipped);
+			bloom->nskipped = 0;
+		}
+	}
+	else if (gjs->gts.outer_bulkexec)
+	{
+		/* results of the outer GPU node are already on the managed memory */
+		pds = pgstromBulkExecGpuTaskState((GpuTaskState *)
+										  outerPlanState(gjs));
 	}
 	else
 	{
@@ -3938,12 +4917,147 @@ GpuJoinExecOuterScanChunk(GpuTaskState *gts)
 	return pds;
 }
 
+/*
+ * GpuJoinOuterBloomFilterTest
+ *
+ * It checks whether the supplied outer tuple may match to the inner hash
+ * table of the first depth, using the bloom filter. False means the tuple
+ * never produce any joined rows, so it can be discarded prior to DMA.
+ */
+bool
+GpuJoinOuterBloomFilterTest(GpuTaskState *gts,
+							TupleDesc tupdesc,
+							HeapTuple tuple)
+{
+	GpuJoinBloomFilter *bloom = gts->outer_bloom;
+	pg_crc32	hash;
+	bool		is_null_keys = true;
+	int			i;
+
+	Assert(bloom != NULL && bloom->bitmap != NULL);
+	INIT_LEGACY_CRC32(hash);
+	for (i=0; i < bloom->nkeys; i++)
+	{
+		devtype_info *dtype = bloom->keys[i].dtype;
+		Datum		datum;
+		bool		isnull;
+
+		datum = heap_getattr(tuple, bloom->keys[i].anum, tupdesc, &isnull);
+		if (isnull)
+			continue;
+		is_null_keys = false;	/* key contains at least a valid value */
+		hash = dtype->hash_func(dtype, hash, datum, isnull);
+	}
+	FIN_LEGACY_CRC32(hash);
+
+	/* NULL-keys will never match to inner-join */
+	if (is_null_keys ||
+		!gpujoin_bloom_filter_probe(bloom->bitmap, bloom->nbits, hash))
+	{
+		bloom->nskipped++;
+		return false;
+	}
+	return true;
+}
+
 /*
  * gpujoin_switch_task
  */
 static void
 gpujoin_switch_task(GpuTaskState *gts, GpuTask *gtask)
 {
+	GpuJoinState   *gjs = (GpuJoinState *) gts;
+	GpuJoinTask	   *pgjoin = (GpuJoinTask *) gtask;
+
+	/*
+	 * CPU fallback has to restrict the partitioned inner to the batch
+	 * when the task was processed, because the current batch may be
+	 * already switched to the next one.
+	 */
+	if (gjs->part_batched)
+		gjs->fallback_part = pgjoin->part_index;
+}
+
+/*
+ * gpujoin_release_batch_chunks
+ */
+static void
+gpujoin_release_batch_chunks(GpuJoinState *gjs)
+{
+	ListCell   *lc;
+
+	foreach (lc, gjs->batch_chunks)
+		PDS_release((pgstrom_data_store *) lfirst(lc));
+	list_free(gjs->batch_chunks);
+	gjs->batch_chunks = NIL;
+	gjs->batch_curr = NULL;
+}
+
+/*
+ * gpujoin_switch_batch
+ *
+ * It loads the partition of the next batch onto the device buffer, once
+ * all the running tasks of the current batch get completed.
+ */
+static void
+gpujoin_switch_batch(GpuJoinState *gjs)
+{
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	kern_multirels *h_kmrels = dsm_segment_address(gjs->seg_kmrels);
+	int				part = gjs->curr_part + 1;
+	cl_ulong		kmrels_length;
+	CUresult		rc;
+
+	Assert(gjs->part_batched && part < gjs->part_nums);
+	/* wait for completion of the tasks running on the current batch */
+	ResetLatch(MyLatch);
+	pthreadMutexLock(gcontext->mutex);
+	while (gjs->gts.num_running_tasks > 0)
+	{
+		int		ev;
+
+		pthreadMutexUnlock(gcontext->mutex);
+		CHECK_FOR_GPUCONTEXT(gcontext);
+		ev = WaitLatch(MyLatch,
+					   WL_LATCH_SET |
+					   WL_TIMEOUT |
+					   WL_POSTMASTER_DEATH,
+					   500L
+#if PG_VERSION_NUM >= 100000
+					   ,PG_WAIT_EXTENSION
+#endif
+			);
+		if (ev & WL_POSTMASTER_DEATH)
+			elog(FATAL, "Unexpected Postmaster Dead");
+		ResetLatch(MyLatch);
+		pthreadMutexLock(gcontext->mutex);
+	}
+	pthreadMutexUnlock(gcontext->mutex);
+
+	/* load the partition of the next batch */
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+
+	kmrels_length = gjs->part_common + gjs->part_lengths[part];
+	rc = cuMemcpyHtoD(gjs->m_kmrels + offsetof(kern_multirels,
+											   kmrels_length),
+					  &kmrels_length,
+					  sizeof(cl_ulong));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	rc = cuMemcpyHtoD(gjs->m_kmrels + gjs->part_common,
+					  (char *)h_kmrels + gjs->part_offsets[part],
+					  gjs->part_lengths[part]);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+
+	gjs->curr_part = part;
+	gjs->batch_curr = list_head(gjs->batch_chunks);
 }
 
 /*
@@ -3956,6 +5070,40 @@ gpujoin_next_task(GpuTaskState *gts)
 	GpuTask		   *gtask = NULL;
 	pgstrom_data_store *pds;
 
+	if (gjs->part_batched)
+	{
+		for (;;)
+		{
+			if (gjs->curr_part == 0)
+			{
+				pds = GpuJoinExecOuterScanChunk(gts);
+				if (pds)
+				{
+					MemoryContext	oldcxt = MemoryContextSwitchTo(
+						gjs->gts.css.ss.ps.state->es_query_cxt);
+
+					/* retain the outer chunk for the later batches */
+					gjs->batch_chunks = lappend(gjs->batch_chunks,
+												PDS_retain(pds));
+					MemoryContextSwitchTo(oldcxt);
+					return gpujoin_create_task(gjs, pds, -1);
+				}
+			}
+			else if (gjs->batch_curr)
+			{
+				pds = lfirst(gjs->batch_curr);
+				gjs->batch_curr = lnext(gjs->batch_curr);
+				return gpujoin_create_task(gjs, PDS_retain(pds), -1);
+			}
+			/* end of the current batch */
+			if (gjs->curr_part + 1 >= gjs->part_nums ||
+				gjs->batch_chunks == NIL)
+				break;
+			gpujoin_switch_batch(gjs);
+		}
+		gpujoin_release_batch_chunks(gjs);
+		return NULL;
+	}
 	pds = GpuJoinExecOuterScanChunk(gts);
 	if (pds)
 		gtask = gpujoin_create_task(gjs, pds, -1);
@@ -3987,75 +5135,62 @@ gpujoinNextRightOuterJoin(GpuTaskState *gts)
 
 /*
  * gpujoinSyncRightOuterJoin
+ *
+ * It detaches the current process from the GpuJoin once all of its own
+ * tasks are completed, and returns true if it is responsible to run the
+ * RIGHT/FULL OUTER JOIN tasks.
+ * The last process per GPU device writes back the OUTER JOIN map on the
+ * device memory to DSM, then the last process of all, regardless of the
+ * master or PG workers, merges the maps and runs RIGHT/FULL OUTER JOIN.
+ * Others exit immediately without waiting for the slower ones.
  */
-void
+bool
 gpujoinSyncRightOuterJoin(GpuTaskState *gts)
 {
 	GpuJoinState   *gjs = (GpuJoinState *) gts;
 	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
 	GpuContext	   *gcontext = gjs->gts.gcontext;
+	kern_multirels *h_kmrels;
+	cl_int			dindex = gcontext->cuda_dindex;
+	uint32			pg_nworkers_pergpu;
 
-	/*
-	 * wait for completion of PG workers, if any
-	 */
-	if (!IsParallelWorker())
-	{
-		ResetLatch(MyLatch);
-		while (pg_atomic_read_u32(&gj_sstate->pg_nworkers) > 1)
-		{
-			int		ev;
-
-			CHECK_FOR_GPUCONTEXT(gcontext);
+	if (gjs->ojmap_detached)
+		return gjs->ojmap_runner;
 
-			ev = WaitLatch(MyLatch,
-						   WL_LATCH_SET |
-						   WL_TIMEOUT |
-						   WL_POSTMASTER_DEATH,
-						   1000L
-#if PG_VERSION_NUM >= 100000
-						   ,PG_WAIT_EXTENSION
-#endif
-				);
-			if (ev & WL_POSTMASTER_DEATH)
-				elog(FATAL, "Unexpected Postmaster Dead");
-			ResetLatch(MyLatch);
-		}
-		/* OK, no PG workers run GpuJoin at this point */
-	}
-	else
+	pg_nworkers_pergpu =
+		pg_atomic_sub_fetch_u32(&gj_sstate->pergpu[dindex].pg_nworkers, 1);
+	if (pg_nworkers_pergpu == 0 && numDevAttrs > 1)
 	{
-		/*
-		 * In case of PG workers, the last process per GPU needs to write back
-		 * OUTER JOIN map to the DSM area. (only happen on multi-GPU mode)
-		 */
-		kern_multirels *h_kmrels = dsm_segment_address(gjs->seg_kmrels);
-		cl_int			dindex = gcontext->cuda_dindex;
-		uint32			pg_nworkers_pergpu =
-			pg_atomic_sub_fetch_u32(&gj_sstate->pergpu[dindex].pg_nworkers, 1);
+		CUresult	rc;
+		size_t		offset;
 
-		if (pg_nworkers_pergpu == 0)
-		{
-			CUresult	rc;
-			size_t		offset = (h_kmrels->kmrels_length +
-								  h_kmrels->ojmaps_length * dindex);
+		/* only happen on multi-GPU mode */
+		h_kmrels = dsm_segment_address(gjs->seg_kmrels);
+		offset = (h_kmrels->kmrels_length +
+				  h_kmrels->ojmaps_length * dindex);
 
-			rc = cuCtxPushCurrent(gcontext->cuda_context);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		rc = cuCtxPushCurrent(gcontext->cuda_context);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
 
-			rc = cuMemcpyDtoH((char *)h_kmrels + offset,
-							  gjs->m_kmrels + offset,
-							  h_kmrels->ojmaps_length);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+		rc = cuMemcpyDtoH((char *)h_kmrels + offset,
+						  gjs->m_kmrels + offset,
+						  h_kmrels->ojmaps_length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
 
-			rc = cuCtxPopCurrent(NULL);
-			if (rc != CUDA_SUCCESS)
-				elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
-		}
-		pg_atomic_fetch_sub_u32(&gj_sstate->pg_nworkers, 1);
-		SetLatch(gj_sstate->masterLatch);
+		rc = cuCtxPopCurrent(NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
 	}
+	/*
+	 * The OUTER JOIN map of this device shall be visible to the runner
+	 * prior to the decrement below, because atomic operations are barriers.
+	 */
+	gjs->ojmap_detached = true;
+	gjs->ojmap_runner =
+		(pg_atomic_sub_fetch_u32(&gj_sstate->pg_nworkers, 1) == 0);
+	return gjs->ojmap_runner;
 }
 
 /*
@@ -4071,14 +5206,47 @@ gpujoin_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
 	/* Has RIGHT/FULL OUTER JOIN? */
 	if (gpujoinHasRightOuterJoin(&gjs->gts))
 	{
-		gpujoinSyncRightOuterJoin(&gjs->gts);
-		if (!IsParallelWorker() &&
+		if (gpujoinSyncRightOuterJoin(&gjs->gts) &&
 			(outer_depth = gpujoinNextRightOuterJoin(&gjs->gts)) > 0)
 			gtask = gpujoin_create_task(gjs, NULL, outer_depth);
 	}
 	return gtask;
 }
 
+/*
+ * gpujoin_bulk_exec
+ *
+ * It detaches the destination data stores of the task one by one, to be
+ * pulled by the upper GPU node as its source data store.
+ */
+static pgstrom_data_store *
+gpujoin_bulk_exec(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuJoinTask	   *pgjoin = (GpuJoinTask *) gtask;
+	pgstrom_data_store *pds;
+	dlist_node	   *dnode;
+
+	for (;;)
+	{
+		if (!dlist_is_empty(&pgjoin->pds_dst_inactives))
+		{
+			dnode = dlist_pop_head_node(&pgjoin->pds_dst_inactives);
+			pds = dlist_container(pgstrom_data_store, chain, dnode);
+		}
+		else if (pgjoin->pds_dst)
+		{
+			pds = pgjoin->pds_dst;
+			pgjoin->pds_dst = NULL;
+		}
+		else
+			return NULL;
+
+		if (pds->kds.nitems > 0)
+			return pds;
+		PDS_release(pds);
+	}
+}
+
 static TupleTableSlot *
 gpujoin_next_tuple(GpuTaskState *gts)
 {
@@ -4334,6 +5502,12 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 	cl_uint			hash;
 	bool			retval;
 
+	/* SEMI/ANTI JOIN stops probing on the first match */
+	if (istate->fallback_inner_matched &&
+		(istate->join_type == JOIN_SEMI ||
+		 istate->join_type == JOIN_ANTI))
+		return depth-1;
+
 	do {
 		if (istate->fallback_inner_index == 0)
 		{
@@ -4347,20 +5521,24 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 			if (is_nullkeys)
 				goto end;
 			istate->fallback_inner_hash = hash;
-			for (khitem = KERN_HASH_FIRST_ITEM(kds_in, hash);
-				 khitem && khitem->hash != hash;
-				 khitem = KERN_HASH_NEXT_ITEM(kds_in, khitem));
+			kds_in = gpujoin_inner_hash_partition(h_kmrels, depth, hash);
+			/* only the partition of the batch, if batched */
+			if (depth == gjs->part_depth &&
+				gjs->fallback_part >= 0 &&
+				((char *)kds_in - (char *)h_kmrels) !=
+				gjs->part_offsets[gjs->fallback_part])
+				goto end;
+			khitem = KERN_HASH_FIRST_MATCH(kds_in, hash);
 			if (!khitem)
 				goto end;
 		}
 		else
 		{
 			hash = istate->fallback_inner_hash;
+			kds_in = gpujoin_inner_hash_partition(h_kmrels, depth, hash);
 			khitem = (kern_hashitem *)
 				((char *)kds_in + istate->fallback_inner_index);
-			for (khitem = KERN_HASH_NEXT_ITEM(kds_in, khitem);
-				 khitem && khitem->hash != hash;
-				 khitem = KERN_HASH_NEXT_ITEM(kds_in, khitem));
+			khitem = KERN_HASH_NEXT_MATCH(kds_in, khitem);
 			if (!khitem)
 				goto end;
 		}
@@ -4385,6 +5563,10 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 	/* update outer join map */
 	if (ojmaps)
 		ojmaps[khitem->rowid] = 1;
+	istate->fallback_inner_matched = true;
+	/* ANTI JOIN never emits the matched outer row */
+	if (istate->join_type == JOIN_ANTI)
+		return depth-1;
 	/* rewind the next depth */
 	if (depth < gjs->num_rels)
 	{
@@ -4397,7 +5579,8 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 end:
 	if (!istate->fallback_inner_matched &&
 		(istate->join_type == JOIN_LEFT ||
-		 istate->join_type == JOIN_FULL))
+		 istate->join_type == JOIN_FULL ||
+		 istate->join_type == JOIN_ANTI))
 	{
 		istate->fallback_inner_matched = true;
 		gpujoin_fallback_tuple_extract(gjs->slot_fallback,
@@ -4435,6 +5618,12 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 	cl_bool		   *ojmaps = KERN_MULTIRELS_OUTER_JOIN_MAP(h_kmrels, depth);
 	cl_uint			index;
 
+	/* SEMI/ANTI JOIN stops probing on the first match */
+	if (istate->fallback_inner_matched &&
+		(istate->join_type == JOIN_SEMI ||
+		 istate->join_type == JOIN_ANTI))
+		return depth-1;
+
 	for (index = istate->fallback_inner_index;
 		 index < kds_in->nitems;
 		 index++)
@@ -4461,6 +5650,10 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 			/* update outer join map */
 			if (ojmaps)
 				ojmaps[index] = 1;
+			istate->fallback_inner_matched = true;
+			/* ANTI JOIN never emits the matched outer row */
+			if (istate->join_type == JOIN_ANTI)
+				return depth-1;
 			/* rewind the next depth */
 			if (depth < gjs->num_rels)
 			{
@@ -4474,7 +5667,8 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 
 	if (!istate->fallback_inner_matched &&
 		(istate->join_type == JOIN_LEFT ||
-		 istate->join_type == JOIN_FULL))
+		 istate->join_type == JOIN_FULL ||
+		 istate->join_type == JOIN_ANTI))
 	{
 		istate->fallback_inner_index = kds_in->nitems;
 		istate->fallback_inner_matched = true;
@@ -4591,6 +5785,10 @@ gpujoinFallbackLoadSource(int depth, GpuJoinState *gjs,
 				return -1;
 			pg_page = KERN_DATA_STORE_BLOCK_PGPAGE(kds_src, index);
 			block_nr = KERN_DATA_STORE_BLOCK_BLCKNR(kds_src, index);
+			if (line_nr == 0 && !PageIsAllVisible(pg_page))
+				KDS_fixup_block_visibility(&gjs->gts,
+										   gjs->gts.css.ss.ss_currentRelation,
+										   block_nr, pg_page);
 			if (line_nr >= PageGetMaxOffsetNumber(pg_page))
 			{
 				gjs->fallback_outer_index = (cl_ulong)(index + 1) << 16;
@@ -4624,6 +5822,7 @@ gpujoinFallbackLoadSource(int depth, GpuJoinState *gjs,
 
 	/* rewind the next depth */
 	gjs->inners[0].fallback_inner_index = 0;
+	gjs->inners[0].fallback_inner_matched = false;
 	return 1;
 }
 
@@ -4925,6 +6124,76 @@ gpujoinColocateOuterJoinMaps(GpuTaskState *gts, CUmodule cuda_module)
 	pg_atomic_write_u32(&gj_sstate->needs_colocation, 0);
 }
 
+/*
+ * gpujoin_prefetch_task_buffers
+ *
+ * kern_gpujoin and the result buffer are allocated on the managed memory,
+ * however, on-demand page migration is expensive for small tasks, like
+ * the ones of parameterized rescan. So, we migrate the working area of
+ * kern_gpujoin (pseudo-stack and suspend context) to the device at once
+ * if it is not larger than pg_strom.gpujoin_prefetch_limit. Elsewhere,
+ * we leave it on the page-fault handling to avoid over-subscription.
+ */
+static void
+gpujoin_prefetch_task_buffers(GpuJoinTask *pgjoin)
+{
+	pgstrom_data_store *pds_dst = pgjoin->pds_dst;
+	size_t		length;
+	CUresult	rc;
+
+	if (pgjoin->kern_length <= ((size_t)gpujoin_prefetch_limit_kb << 10))
+		length = pgjoin->kern_length;
+	else
+		length = KERN_GPUJOIN_HEAD_LENGTH(&pgjoin->kern);
+	rc = cuMemPrefetchAsync((CUdeviceptr)&pgjoin->kern,
+							length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	length = KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds);
+	rc = cuMemPrefetchAsync((CUdeviceptr)&pds_dst->kds,
+							length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+}
+
+/*
+ * gpujoin_prefetch_dest_store
+ *
+ * It kicks DtoH prefetch of the portion of the result buffer actually
+ * written by the GPU kernel; row-index at the head and tuples at the tail.
+ */
+static void
+gpujoin_prefetch_dest_store(pgstrom_data_store *pds_dst)
+{
+	kern_data_store *kds = &pds_dst->kds;
+	size_t		length;
+	CUresult	rc;
+
+	if (kds->nitems == 0)
+		return;
+	Assert(kds->usage <= kds->length);
+	rc = cuMemPrefetchAsync((CUdeviceptr)kds + kds->length - kds->usage,
+							kds->usage,
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	length = (KERN_DATA_STORE_HEAD_LENGTH(kds) +
+			  STROMALIGN(sizeof(cl_uint) * kds->nitems));
+	rc = cuMemPrefetchAsync((CUdeviceptr)kds,
+							length,
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+}
+
 static cl_int
 gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 {
@@ -4936,11 +6205,14 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	CUdeviceptr			m_kgjoin = (CUdeviceptr)&pgjoin->kern;
 	CUdeviceptr			m_kds_src = 0UL;
 	CUdeviceptr			m_kds_dst = (CUdeviceptr)&pds_dst->kds;
+	CUdeviceptr			m_kmrels;
 	CUdeviceptr			m_nullptr = 0UL;
 	CUresult			rc;
 	size_t				grid_sz;
 	size_t				block_sz;
+	cl_int				part_index = 0;
 	cl_int				retval = 10001;
+	bool				dma_send_timed = false;
 	void			   *kern_args[10];
 
 	/* sanity checks */
@@ -4993,7 +6265,8 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	/*
 	 * OK, kick a series of GpuJoin invocations
 	 */
-
+	pgstromTimeStatEventRecord(&gjs->gts, CU_EVENT1_PER_THREAD);
+	gpujoin_prefetch_task_buffers(pgjoin);
 	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 	{
 		rc = cuMemPrefetchAsync(m_kds_src,
@@ -5014,8 +6287,7 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	}
 	else
 	{
-		gpuMemCopyFromSSD(m_kds_src,
-						  pds_src);
+		gpuMemCopyFromSSDAsync(m_kds_src, pds_src);
 	}
 
 	/* Launch:
@@ -5036,12 +6308,26 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
 
 resume_gpujoin:
+	/*
+	 * NOTE: In case of partitioned inner hash table, GpuJoin kernel is
+	 * invoked for each partition. Outer rows which have hash value out of
+	 * the range of the current partition shall be skipped.
+	 * If partitions are loaded for each batch, device buffer has only
+	 * the partition of the current batch.
+	 */
+	if (gjs->m_kmrels_parts)
+		m_kmrels = gjs->m_kmrels_parts[part_index];
+	else
+		m_kmrels = gjs->m_kmrels;
 	kern_args[0] = &m_kgjoin;
-	kern_args[1] = &gjs->m_kmrels;
+	kern_args[1] = &m_kmrels;
 	kern_args[2] = &m_kds_src;
 	kern_args[3] = &m_kds_dst;
 	kern_args[4] = &m_nullptr;
 
+	/* kds_src has to be loaded prior to the kernel launch */
+	gpuMemCopyFromSSDWait();
+	pgstromTimeStatEventRecord(&gjs->gts, CU_EVENT2_PER_THREAD);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -5060,6 +6346,14 @@ resume_gpujoin:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	if (!dma_send_timed)
+	{
+		pgstromTimeStatAddEvents(&gjs->gts, GpuTaskPhase_DmaSend,
+								 CU_EVENT1_PER_THREAD, CU_EVENT2_PER_THREAD);
+		dma_send_timed = true;
+	}
+	pgstromTimeStatAddEvents(&gjs->gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
 
 	if (pgstrom_cpu_fallback_enabled &&
 		pgjoin->kern.kerror.errcode == StromError_CpuReCheck)
@@ -5079,15 +6373,60 @@ resume_gpujoin:
 		memset(&pgjoin->kern.kerror, 0, sizeof(kern_errorbuf));
 		pgjoin->kern.resume_context = true;
 		/* resume GpuJoin kernel after the buffer allocation */
+		gpujoin_prefetch_dest_store(pds_dst);
 		dlist_push_tail(&pgjoin->pds_dst_inactives, &pds_dst->chain);
-		pgjoin->pds_dst = pds_dst = PDS_clone(pds_dst);
+		pgjoin->pds_dst = pds_dst =
+			PDS_clone_length(pds_dst, gpujoin_next_dest_length(pds_dst));
 		m_kds_dst = (CUdeviceptr)&pds_dst->kds;
+		rc = cuMemPrefetchAsync(m_kds_dst,
+								KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		goto resume_gpujoin;
+	}
+	else if (pgjoin->kern.kerror.errcode == StromError_Success &&
+			 gjs->m_kmrels_parts != NULL &&
+			 ++part_index < gjs->part_nums)
+	{
+		/* kick GpuJoin kernel for the next partition */
+		pgjoin->kern.resume_context = false;
+		pgjoin->kern.src_read_pos = 0;
 		goto resume_gpujoin;
 	}
 	else if (pgjoin->task.kerror.errcode == StromError_Success)
 	{
 		pgjoin->task.kerror = pgjoin->kern.kerror;
+		if (gjs->part_batched && pgjoin->part_index > 0)
+		{
+			cl_int		i;
+
+			/*
+			 * rows read from the source and joined at the shallower depth
+			 * than the partitioned inner are already counted by the first
+			 * batch.
+			 */
+			pgjoin->kern.source_nitems = 0;
+			pgjoin->kern.outer_nitems = 0;
+			for (i=0; i < gjs->part_depth - 1; i++)
+				pgjoin->kern.stat_nitems[i] = 0;
+		}
+		else if (gjs->m_kmrels_parts != NULL)
+		{
+			cl_int		i;
+
+			/*
+			 * rows read from the source and joined at the shallower depth
+			 * than the partitioned inner are counted for each partition.
+			 */
+			pgjoin->kern.source_nitems /= gjs->part_nums;
+			pgjoin->kern.outer_nitems /= gjs->part_nums;
+			for (i=0; i < gjs->part_depth - 1; i++)
+				pgjoin->kern.stat_nitems[i] /= gjs->part_nums;
+		}
 		gpujoinUpdateRunTimeStat(&gjs->gts, &pgjoin->kern);
+		gpujoin_prefetch_dest_store(pds_dst);
 
 		if (pds_dst->kds.nitems == 0 &&
 			dlist_is_empty(&pgjoin->pds_dst_inactives))
@@ -5107,6 +6446,236 @@ out_of_resource:
 	return retval;
 }
 
+/*
+ * gpujoin_persistent_sibling
+ *
+ * A pending task can join the persistent kernel launch if it scans a chunk
+ * on the managed memory, and uses the same kern_multirels.
+ */
+#define GPUJOIN_PERSISTENT_MAX_JOBS		32
+
+static bool
+gpujoin_persistent_sibling(GpuTask *gtask, GpuTask *sibling)
+{
+	GpuJoinTask	   *pgjoin = (GpuJoinTask *) gtask;
+	GpuJoinTask	   *curr = (GpuJoinTask *) sibling;
+
+	return (curr->pds_src != NULL &&
+			curr->pds_src->kds.format != KDS_FORMAT_BLOCK &&
+			curr->part_index == pgjoin->part_index);
+}
+
+/*
+ * gpujoin_process_persistent
+ *
+ * It picks up the pending sibling tasks, then runs all of them by a single
+ * launch of gpujoin_main_persistent with a grid sized to the number of SMs,
+ * instead of the kernel launch per chunk. Tasks suspended due to lack of
+ * the destination buffer are resumed together by the next launch. It falls
+ * back to gpujoin_process_inner_join() if no siblings are pending.
+ */
+static cl_int
+gpujoin_process_persistent(GpuJoinTask *pgjoin, CUmodule cuda_module)
+{
+	GpuContext		   *gcontext = GpuWorkerCurrentContext;
+	GpuJoinState	   *gjs = (GpuJoinState *) pgjoin->task.gts;
+	GpuJoinTask		   *jobs[GPUJOIN_PERSISTENT_MAX_JOBS];
+	cl_int				retvals[GPUJOIN_PERSISTENT_MAX_JOBS];
+	cl_int				waits[GPUJOIN_PERSISTENT_MAX_JOBS];
+	kern_gpujoin_queue *kqueue;
+	CUfunction			kern_gpujoin_persistent;
+	CUdeviceptr			m_kqueue;
+	CUdeviceptr			m_kmrels = gjs->m_kmrels;
+	CUresult			rc;
+	size_t				grid_sz;
+	size_t				block_sz;
+	cl_int				i, njobs, nwaits, ncurr;
+	bool				dma_send_timed = false;
+	void			   *kern_args[2];
+
+	/* Lookup GPU kernel function */
+	rc = cuModuleGetFunction(&kern_gpujoin_persistent,
+							 cuda_module,
+							 "gpujoin_main_persistent");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_kqueue,
+							offsetof(kern_gpujoin_queue,
+									 jobs[GPUJOIN_PERSISTENT_MAX_JOBS]),
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		return gpujoin_process_inner_join(pgjoin, cuda_module);
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	kqueue = (kern_gpujoin_queue *) m_kqueue;
+
+	/* pick up the pending siblings */
+	jobs[0] = pgjoin;
+	for (njobs = 1; njobs < GPUJOIN_PERSISTENT_MAX_JOBS; njobs++)
+	{
+		GpuTask	   *gtask;
+
+		gtask = pgstromDequeueSiblingGpuTask(&pgjoin->task,
+											 gpujoin_persistent_sibling);
+		if (!gtask)
+			break;
+		jobs[njobs] = (GpuJoinTask *) gtask;
+	}
+	if (njobs == 1)
+	{
+		gpuMemFree(gcontext, m_kqueue);
+		return gpujoin_process_inner_join(pgjoin, cuda_module);
+	}
+
+	/*
+	 * OK, kick a series of GpuJoin invocations
+	 */
+	pgstromTimeStatEventRecord(&gjs->gts, CU_EVENT1_PER_THREAD);
+	for (i=0; i < njobs; i++)
+	{
+		GpuJoinTask	   *curr = jobs[i];
+
+		gpujoin_prefetch_task_buffers(curr);
+		rc = cuMemPrefetchAsync((CUdeviceptr)&curr->pds_src->kds,
+								curr->pds_src->kds.length,
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		kqueue->jobs[i].kgjoin = &curr->kern;
+		kqueue->jobs[i].kds_src = &curr->pds_src->kds;
+		kqueue->jobs[i].kds_dst = &curr->pds_dst->kds;
+		waits[i] = i;
+		retvals[i] = 0;
+	}
+	kqueue->nitems = nwaits = njobs;
+
+	/* Launch:
+	 * KERNEL_FUNCTION(void)
+	 * gpujoin_main_persistent(kern_gpujoin_queue *kqueue,
+	 *                         kern_multirels *kmrels)
+	 *
+	 * NOTE: pseudo-stack and suspend area of kern_gpujoin are allocated
+	 * for the number of SMs, so grid size shall not exceed it.
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_gpujoin_persistent,
+							 0,		/* max activation */
+							 0,
+							 sizeof(cl_int));
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	grid_sz = Min(grid_sz, devAttrs[gcontext->cuda_dindex].MULTIPROCESSOR_COUNT);
+
+	while (nwaits > 0)
+	{
+		kern_args[0] = &m_kqueue;
+		kern_args[1] = &m_kmrels;
+
+		pgstromTimeStatEventRecord(&gjs->gts, CU_EVENT2_PER_THREAD);
+		rc = cuLaunchKernel(kern_gpujoin_persistent,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							sizeof(cl_int) * block_sz,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+
+		/* Point of synchronization */
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+		if (!dma_send_timed)
+		{
+			pgstromTimeStatAddEvents(&gjs->gts, GpuTaskPhase_DmaSend,
+									 CU_EVENT1_PER_THREAD,
+									 CU_EVENT2_PER_THREAD);
+			dma_send_timed = true;
+		}
+		pgstromTimeStatAddEvents(&gjs->gts, GpuTaskPhase_Kernel,
+								 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
+
+		/* check status of the jobs, and build the queue to be resumed */
+		ncurr = nwaits;
+		nwaits = 0;
+		for (i=0; i < ncurr; i++)
+		{
+			cl_int		index = waits[i];
+			GpuJoinTask *curr = jobs[index];
+			pgstrom_data_store *pds_dst = curr->pds_dst;
+
+			if (pgstrom_cpu_fallback_enabled &&
+				curr->kern.kerror.errcode == StromError_CpuReCheck)
+			{
+				/*
+				 * Run CPU fallback, and release incomplete destination
+				 * buffer immediately.
+				 */
+				gpujoin_release_dest_stores(curr);
+				memset(&curr->task.kerror, 0, sizeof(kern_errorbuf));
+				curr->task.cpu_fallback = true;
+				retvals[index] = 0;
+			}
+			else if (curr->kern.kerror.errcode == StromError_Suspend)
+			{
+				CHECK_WORKER_TERMINATION();
+				memset(&curr->kern.kerror, 0, sizeof(kern_errorbuf));
+				curr->kern.resume_context = true;
+				/* resume GpuJoin kernel after the buffer allocation */
+				gpujoin_prefetch_dest_store(pds_dst);
+				dlist_push_tail(&curr->pds_dst_inactives, &pds_dst->chain);
+				curr->pds_dst = pds_dst =
+					PDS_clone_length(pds_dst,
+									 gpujoin_next_dest_length(pds_dst));
+				rc = cuMemPrefetchAsync((CUdeviceptr)&pds_dst->kds,
+										KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds),
+										CU_DEVICE_PER_THREAD,
+										CU_STREAM_PER_THREAD);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+				kqueue->jobs[nwaits].kgjoin = &curr->kern;
+				kqueue->jobs[nwaits].kds_src = &curr->pds_src->kds;
+				kqueue->jobs[nwaits].kds_dst = &pds_dst->kds;
+				waits[nwaits++] = index;
+			}
+			else if (curr->task.kerror.errcode == StromError_Success)
+			{
+				curr->task.kerror = curr->kern.kerror;
+				gpujoinUpdateRunTimeStat(&gjs->gts, &curr->kern);
+				gpujoin_prefetch_dest_store(pds_dst);
+
+				if (pds_dst->kds.nitems == 0 &&
+					dlist_is_empty(&curr->pds_dst_inactives))
+					retvals[index] = -1;
+				else
+					retvals[index] = 0;
+			}
+			else
+			{
+				/* raise an error */
+				curr->task.kerror = curr->kern.kerror;
+				retvals[index] = 0;
+			}
+		}
+		kqueue->nitems = nwaits;
+	}
+	gpuMemFree(gcontext, m_kqueue);
+
+	/* back the siblings to the backend; pgjoin is handled by the caller */
+	for (i=1; i < njobs; i++)
+		pgstromCompleteGpuTask(&jobs[i]->task, retvals[i]);
+	return retvals[0];
+}
+
 static cl_int
 gpujoin_process_right_outer(GpuJoinTask *pgjoin, CUmodule cuda_module)
 {
@@ -5146,6 +6715,7 @@ gpujoin_process_right_outer(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	 *                     kern_data_store *kds_dst,
 	 *                     kern_parambuf *kparams_gpreagg)
 	 */
+	gpujoin_prefetch_task_buffers(pgjoin);
 resume_gpujoin:
 	rc = gpuOptimalBlockSize(&grid_sz,
 							 &block_sz,
@@ -5159,6 +6729,7 @@ resume_gpujoin:
 	kern_args[3] = &m_kds_dst;
 	kern_args[4] = &m_nullptr;
 
+	pgstromTimeStatEventRecord(&gjs->gts, CU_EVENT2_PER_THREAD);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -5177,6 +6748,8 @@ resume_gpujoin:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromTimeStatAddEvents(&gjs->gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
 
 	pgjoin->task.kerror = pgjoin->kern.kerror;
 	if (pgstrom_cpu_fallback_enabled &&
@@ -5193,14 +6766,23 @@ resume_gpujoin:
 		pgjoin->task.kerror.errcode = StromError_Success;
 		pgjoin->kern.resume_context = true;
 
+		gpujoin_prefetch_dest_store(pds_dst);
 		dlist_push_tail(&pgjoin->pds_dst_inactives, &pds_dst->chain);
-		pgjoin->pds_dst = pds_dst = PDS_clone(pds_dst);
+		pgjoin->pds_dst = pds_dst =
+			PDS_clone_length(pds_dst, gpujoin_next_dest_length(pds_dst));
 		m_kds_dst = (CUdeviceptr)&pds_dst->kds;
+		rc = cuMemPrefetchAsync(m_kds_dst,
+								KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 		goto resume_gpujoin;
 	}
 	if (pgjoin->task.kerror.errcode == StromError_Success)
 	{
 		gpujoinUpdateRunTimeStat(&gjs->gts, &pgjoin->kern);
+		gpujoin_prefetch_dest_store(pds_dst);
 
 		if (pds_dst->kds.nitems == 0 &&
 			dlist_is_empty(&pgjoin->pds_dst_inactives))
@@ -5220,12 +6802,18 @@ int
 gpujoin_process_task(GpuTask *gtask, CUmodule cuda_module)
 {
 	GpuJoinTask *pgjoin = (GpuJoinTask *) gtask;
+	GpuJoinState *gjs = (GpuJoinState *) gtask->gts;
 	int		retval;
 
-	if (pgjoin->pds_src)
-		retval = gpujoin_process_inner_join(pgjoin, cuda_module);
-	else
+	if (!pgjoin->pds_src)
 		retval = gpujoin_process_right_outer(pgjoin, cuda_module);
+	else if (gpujoin_persistent_kernel &&
+			 !gjs->part_batched &&
+			 gjs->m_kmrels_parts == NULL &&
+			 pgjoin->pds_src->kds.format != KDS_FORMAT_BLOCK)
+		retval = gpujoin_process_persistent(pgjoin, cuda_module);
+	else
+		retval = gpujoin_process_inner_join(pgjoin, cuda_module);
 
 	return retval;
 }
@@ -5406,9 +6994,14 @@ gpujoin_compaction_inner_kds(kern_data_store *kds_in)
 	Assert(kds_in->format == KDS_FORMAT_HASH ||
 		   kds_in->nslots == 0);
 	Assert(kds_in->usage == MAXALIGN(kds_in->usage));
-	head_sz = KDS_CALCULATE_FRONTEND_LENGTH(kds_in->ncols,
-											kds_in->nslots,
-											kds_in->nitems);
+	if (kds_in->hash_packed)
+		head_sz = KDS_CALCULATE_PACKED_FRONTEND_LENGTH(kds_in->ncols,
+													   kds_in->nslots,
+													   kds_in->nitems);
+	else
+		head_sz = KDS_CALCULATE_FRONTEND_LENGTH(kds_in->ncols,
+												kds_in->nslots,
+												kds_in->nitems);
 	Assert(head_sz == MAXALIGN(head_sz));
 	Assert(head_sz + kds_in->usage <= kds_in->length);
 	shift = kds_in->length - (head_sz + kds_in->usage);
@@ -5458,43 +7051,200 @@ gpujoin_inner_hash_preload(innerState *istate,
 		 * we don't need to keep this tuple in the 
 		 */
 		if (is_null_keys && (istate->join_type == JOIN_INNER ||
-							 istate->join_type == JOIN_LEFT))
+							 istate->join_type == JOIN_LEFT ||
+							 istate->join_type == JOIN_SEMI ||
+							 istate->join_type == JOIN_ANTI))
+			continue;
+		/* out of the range, if partitioned inner hash table */
+		if (hash < kds_hash->hash_min || hash > kds_hash->hash_max)
 			continue;
 
 		while (!KDS_insert_hashitem(kds_hash, scan_slot, hash))
 			kds_hash = gpujoin_expand_inner_kds(seg, kds_offset);
 	}
 	kds_hash->nslots = __KDS_NSLOTS(kds_hash->nitems);
+	/*
+	 * packed buckets, if the hole between row-index and heap-tuples has
+	 * enough room for the hash_tags[] and hash_refs[]; the inner hash table
+	 * is never expanded for them.
+	 */
+	kds_hash->hash_packed =
+		(gpujoin_packed_hash &&
+		 KDS_CALCULATE_PACKED_FRONTEND_LENGTH(kds_hash->ncols,
+											  kds_hash->nslots,
+											  kds_hash->nitems) +
+		 kds_hash->usage <= kds_hash->length);
 	gpujoin_compaction_inner_kds(kds_hash);
 	/* construction of the hash table */
 	row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
 	hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
-	memset(hash_slot, 0, sizeof(cl_uint) * kds_hash->nslots);
-	for (i=0; i < kds_hash->nitems; i++)
+	if (kds_hash->hash_packed)
 	{
-		kern_hashitem  *khitem = (kern_hashitem *)
-			((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
-		Assert(khitem->rowid == i);
-		j = khitem->hash % kds_hash->nslots;
-		khitem->next = hash_slot[j];
-		hash_slot[j] = (uintptr_t)khitem - (uintptr_t)kds_hash;
+		cl_uint	   *hash_tags = KERN_DATA_STORE_HASHTAGS(kds_hash);
+		cl_uint	   *hash_refs = KERN_DATA_STORE_HASHREFS(kds_hash);
+		cl_uint		curr, next;
+
+		/*
+		 * count items per slot on hash_slot[j+1], then turn them into the
+		 * start position of the slot[j] by prefix sum.
+		 */
+		memset(hash_slot, 0, sizeof(cl_uint) * (kds_hash->nslots + 1));
+		for (i=0; i < kds_hash->nitems; i++)
+		{
+			kern_hashitem  *khitem = (kern_hashitem *)
+				((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
+			j = khitem->hash % kds_hash->nslots;
+			if (j + 1 < kds_hash->nslots)
+				hash_slot[j+2]++;
+		}
+		for (j=2, curr=0; j <= kds_hash->nslots; j++)
+		{
+			next = curr + hash_slot[j];
+			hash_slot[j] = next;
+			curr = next;
+		}
+		/*
+		 * put items on the packed buckets; hash_slot[j+1] is advanced from
+		 * the start to the end of slot[j], that is start of the slot[j+1].
+		 */
+		for (i=0; i < kds_hash->nitems; i++)
+		{
+			kern_hashitem  *khitem = (kern_hashitem *)
+				((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
+			Assert(khitem->rowid == i);
+			j = khitem->hash % kds_hash->nslots;
+			khitem->hindex = hash_slot[j+1]++;
+			hash_tags[khitem->hindex] = khitem->hash;
+			hash_refs[khitem->hindex] = (uintptr_t)khitem - (uintptr_t)kds_hash;
+		}
+		Assert(hash_slot[0] == 0 &&
+			   hash_slot[kds_hash->nslots] == kds_hash->nitems);
+		/* chain the items in the packed order also */
+		for (j=0; j < kds_hash->nslots; j++)
+		{
+			for (i=hash_slot[j]; i < hash_slot[j+1]; i++)
+			{
+				kern_hashitem  *khitem = (kern_hashitem *)
+					((char *)kds_hash + hash_refs[i]);
+				khitem->next = (i + 1 < hash_slot[j+1] ? hash_refs[i+1] : 0);
+			}
+		}
+	}
+	else
+	{
+		memset(hash_slot, 0, sizeof(cl_uint) * kds_hash->nslots);
+		for (i=0; i < kds_hash->nitems; i++)
+		{
+			kern_hashitem  *khitem = (kern_hashitem *)
+				((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
+			Assert(khitem->rowid == i);
+			j = khitem->hash % kds_hash->nslots;
+			khitem->next = hash_slot[j];
+			hash_slot[j] = (uintptr_t)khitem - (uintptr_t)kds_hash;
+		}
+	}
+}
+
+/*
+ * gpujoin_range_bound_value - a bound of the range key in cl_long
+ */
+static cl_long
+gpujoin_range_bound_value(Oid type_oid, Datum datum)
+{
+	switch (type_oid)
+	{
+		case INT4OID:
+		case DATEOID:
+			return (cl_long)DatumGetInt32(datum);
+		case INT8OID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return (cl_long)DatumGetInt64(datum);
+		default:
+			elog(ERROR, "Bug? unexpected range key type: %s",
+				 format_type_be(type_oid));
+	}
+	return 0;	/* not reachable */
+}
+
+/*
+ * get_tuple_range_bounds
+ *
+ * It evaluates the inner range key, for construction of the range index.
+ * Empty range never matches, so it shall be sorted to the tail.
+ */
+static bool
+get_tuple_range_bounds(innerState *istate,
+					   TupleTableSlot *slot,
+					   kern_range_item *ritem)
+{
+	ExprContext	   *econtext = istate->econtext;
+	TypeCacheEntry *typcache;
+	RangeBound		lower;
+	RangeBound		upper;
+	bool			empty;
+	Datum			datum;
+	bool			isnull;
+
+	econtext->ecxt_innertuple = slot;
+#if PG_VERSION_NUM < 100000
+	datum = ExecEvalExpr(istate->range_inner_key, econtext, &isnull, NULL);
+#else
+	datum = ExecEvalExpr(istate->range_inner_key, econtext, &isnull);
+#endif
+	if (isnull)
+		return false;
+
+	typcache = lookup_type_cache(istate->range_inner_type,
+								 TYPECACHE_RANGE_INFO);
+	if (!typcache->rngelemtype)
+	{
+		/* element type */
+		ritem->lower = gpujoin_range_bound_value(istate->range_inner_type,
+												 datum);
+		ritem->upper_max = ritem->lower;
+		return true;
+	}
+	range_deserialize(typcache, DatumGetRangeType(datum),
+					  &lower, &upper, &empty);
+	if (empty)
+	{
+		ritem->lower = LONG_MAX;
+		ritem->upper_max = LONG_MIN;
 	}
+	else
+	{
+		Oid		elem_type = typcache->rngelemtype->type_id;
+
+		ritem->lower = (lower.infinite
+						? LONG_MIN
+						: gpujoin_range_bound_value(elem_type, lower.val));
+		ritem->upper_max = (upper.infinite
+							? LONG_MAX
+							: gpujoin_range_bound_value(elem_type, upper.val));
+	}
+	return true;
 }
 
 /*
  * gpujoin_inner_heap_preload
  *
  * Preload inner relation to the data store with row-format, for nested-
- * loop execution.
+ * loop execution. If range index is used, bounds of the range key are
+ * also returned for each row.
  */
 static void
 gpujoin_inner_heap_preload(innerState *istate,
 						   dsm_segment *seg,
 						   kern_data_store *kds_heap,
-						   size_t kds_offset)
+						   size_t kds_offset,
+						   kern_range_item **p_ritems)
 {
 	PlanState	   *scan_ps = istate->state;
 	TupleTableSlot *scan_slot;
+	kern_range_item *ritems = NULL;
+	cl_uint			nrooms = 0;
+	kern_range_item	ritem;
 
 	for (;;)
 	{
@@ -5502,9 +7252,30 @@ gpujoin_inner_heap_preload(innerState *istate,
 		if (TupIsNull(scan_slot))
 			break;
 		(void)ExecFetchSlotTuple(scan_slot);
+		if (istate->range_inner_key)
+		{
+			/*
+			 * NULL range key never matches, and nest-loop with range index
+			 * is used only for INNER/LEFT/SEMI/ANTI join, so we don't need
+			 * to keep the tuple.
+			 */
+			if (!get_tuple_range_bounds(istate, scan_slot, &ritem))
+				continue;
+			if (kds_heap->nitems >= nrooms)
+			{
+				nrooms = Max(2 * nrooms, 1024);
+				if (!ritems)
+					ritems = palloc(sizeof(kern_range_item) * nrooms);
+				else
+					ritems = repalloc_huge(ritems, (sizeof(kern_range_item) *
+													(Size) nrooms));
+			}
+			ritems[kds_heap->nitems] = ritem;
+		}
 		while (!KDS_insert_tuple(kds_heap, scan_slot))
 			kds_heap = gpujoin_expand_inner_kds(seg, kds_offset);
 	}
+	*p_ritems = ritems;
 	Assert(kds_heap->nslots == 0);
 	gpujoin_compaction_inner_kds(kds_heap);
 	if (kds_heap->length > (size_t)UINT_MAX)
@@ -5512,29 +7283,591 @@ gpujoin_inner_heap_preload(innerState *istate,
 }
 
 /*
- * gpujoin_inner_preload
+ * gpujoin_inner_range_preload
  *
- * It preload inner relation to the DSM buffer once.
+ * It sorts the rows of the inner heap by the lower bound of the range key,
+ * then builds the range index next to the inner heap; that also keeps the
+ * maximum upper bound of the items in front of each position. Device code
+ * probes only the window of the inner rows which can match the outer row.
  */
-static bool
-__gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
+typedef struct
 {
-	GpuContext	   *gcontext = gjs->gts.gcontext;
-	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
-	kern_multirels *h_kmrels;
-	kern_data_store *kds;
-	dsm_segment	   *seg;
-	int				i, num_rels = gjs->num_rels;
-	size_t			ojmaps_usage = 0;
-	size_t			kmrels_usage = 0;
-	size_t			required;
+	kern_range_item	ritem;
+	cl_uint			row_index;
+} range_sort_item;
 
-	Assert(!IsParallelWorker());
+static int
+range_sort_item_comp(const void *__a, const void *__b)
+{
+	const range_sort_item *a = __a;
+	const range_sort_item *b = __b;
+
+	if (a->ritem.lower < b->ritem.lower)
+		return -1;
+	if (a->ritem.lower > b->ritem.lower)
+		return 1;
+	return 0;
+}
+
+static size_t
+gpujoin_inner_range_preload(innerState *istate,
+							dsm_segment *seg,
+							int depth,
+							size_t kmrels_usage,
+							kern_range_item *ritems)
+{
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_data_store *kds_heap = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	kern_range_index *krindex;
+	range_sort_item *sitems;
+	cl_uint		   *row_index;
+	cl_uint			nitems = kds_heap->nitems;
+	cl_long			upper_max = LONG_MIN;
+	cl_uint			i;
+	size_t			dsm_length;
+	size_t			length;
+
+	Assert(kds_heap->format == KDS_FORMAT_ROW);
+	/* sort the inner rows by the lower bound */
+	sitems = palloc_huge(sizeof(range_sort_item) * Max(nitems, 1));
+	row_index = KERN_DATA_STORE_ROWINDEX(kds_heap);
+	for (i=0; i < nitems; i++)
+	{
+		sitems[i].ritem = ritems[i];
+		sitems[i].row_index = row_index[i];
+	}
+	qsort(sitems, nitems, sizeof(range_sort_item), range_sort_item_comp);
+
+	length = STROMALIGN(offsetof(kern_range_index, items[nitems]));
+	/* expand DSM on demand */
+	dsm_length = dsm_segment_map_length(seg);
+	while (kmrels_usage + length > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+		dsm_length = dsm_segment_map_length(seg);
+	}
+	kds_heap = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	row_index = KERN_DATA_STORE_ROWINDEX(kds_heap);
+	krindex = (kern_range_index *)((char *)h_kmrels + kmrels_usage);
+	krindex->nitems = nitems;
+	krindex->range_op = istate->range_op;
+	for (i=0; i < nitems; i++)
+	{
+		row_index[i] = sitems[i].row_index;
+		upper_max = Max(upper_max, sitems[i].ritem.upper_max);
+		krindex->items[i].lower = sitems[i].ritem.lower;
+		krindex->items[i].upper_max = upper_max;
+	}
+	pfree(sitems);
+	h_kmrels->chunks[depth-1].range_offset = kmrels_usage;
+
+	return kmrels_usage + length;
+}
+
+/*
+ * gpujoin_inner_skew_preload
+ *
+ * It picks up the heavy hitter slots of the inner hash table; that have
+ * longer chain than pg_strom.gpujoin_skew_threshold, and lists up their
+ * items next to the inner hash table. Device code splits the items of
+ * these slots to multiple threads, instead of a long walk on the chain
+ * by a particular thread.
+ */
+static size_t
+gpujoin_inner_skew_preload(innerState *istate,
+						   dsm_segment *seg,
+						   int depth,
+						   size_t kmrels_usage)
+{
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_data_store *kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	kern_hash_skew *kskew;
+	kern_hashitem  *khitem;
+	cl_uint			skew_slots[GPUJOIN_SKEW_MAX_SLOTS];
+	cl_uint			skew_nitems[GPUJOIN_SKEW_MAX_SLOTS];
+	cl_uint			nslots = 0;
+	cl_uint			total = 0;
+	cl_uint			i, j, k;
+	size_t			dsm_length;
+	size_t			length;
+
+	if (gpujoin_skew_threshold <= 0 ||
+		kds_hash->length > (size_t)INT_MAX ||
+		kds_hash->nitems < (cl_uint)gpujoin_skew_threshold)
+		return kmrels_usage;
+
+	/* pick up the longest chains */
+	for (i=0; i < kds_hash->nslots; i++)
+	{
+		cl_uint		count = 0;
+
+		for (khitem = KERN_HASH_SLOT_FIRST_ITEM(kds_hash, i);
+			 khitem != NULL;
+			 khitem = KERN_HASH_NEXT_ITEM(kds_hash, khitem))
+			count++;
+		if (count < (cl_uint)gpujoin_skew_threshold)
+			continue;
+		/* insertion in order of the chain length */
+		for (j=0; j < nslots && skew_nitems[j] >= count; j++);
+		if (j >= GPUJOIN_SKEW_MAX_SLOTS)
+			continue;
+		if (nslots < GPUJOIN_SKEW_MAX_SLOTS)
+			nslots++;
+		for (k=nslots-1; k > j; k--)
+		{
+			skew_slots[k] = skew_slots[k-1];
+			skew_nitems[k] = skew_nitems[k-1];
+		}
+		skew_slots[j] = i;
+		skew_nitems[j] = count;
+	}
+	if (nslots == 0)
+		return kmrels_usage;
+	for (i=0; i < nslots; i++)
+		total += skew_nitems[i];
+	length = STROMALIGN(offsetof(kern_hash_skew, items[total]));
+
+	/* expand DSM on demand */
+	dsm_length = dsm_segment_map_length(seg);
+	while (kmrels_usage + length > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+		dsm_length = dsm_segment_map_length(seg);
+	}
+	kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	kskew = (kern_hash_skew *)((char *)h_kmrels + kmrels_usage);
+	memset(kskew, 0, offsetof(kern_hash_skew, items));
+	kskew->nslots = nslots;
+	for (i=0, k=0; i < nslots; i++)
+	{
+		kskew->slots[i].hash_slot = skew_slots[i];
+		kskew->slots[i].nitems = skew_nitems[i];
+		kskew->slots[i].items_index = k;
+		for (khitem = KERN_HASH_SLOT_FIRST_ITEM(kds_hash, skew_slots[i]);
+			 khitem != NULL;
+			 khitem = KERN_HASH_NEXT_ITEM(kds_hash, khitem))
+		{
+			kskew->items[k++] = (cl_uint)((char *)&khitem->t.htup -
+										  (char *)kds_hash);
+		}
+	}
+	Assert(k == total);
+	h_kmrels->chunks[depth-1].skew_offset = kmrels_usage;
+	istate->skew_nslots = nslots;
+
+	return kmrels_usage + length;
+}
+
+/*
+ * __gpujoin_inner_preload_chunk
+ *
+ * It loads an inner relation (or a partition of inner relation, if hash
+ * value range is restricted) at the tail of the inner buffer, then returns
+ * the new usage of the buffer.
+ */
+static size_t
+__gpujoin_inner_preload_chunk(GpuJoinState *gjs,
+							  dsm_segment *seg,
+							  int depth,
+							  size_t kmrels_usage,
+							  cl_uint hash_min,
+							  cl_uint hash_max,
+							  size_t *p_ojmaps_usage)
+{
+	innerState	   *istate = &gjs->inners[depth-1];
+	PlanState	   *scan_ps = istate->state;
+	TupleTableSlot *ps_slot = scan_ps->ps_ResultTupleSlot;
+	TupleDesc		ps_desc = ps_slot->tts_tupleDescriptor;
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_data_store *kds;
+	size_t			dsm_length;
+	size_t			kds_length;
+	size_t			kds_head_sz;
+	kern_range_item *ritems = NULL;
+
+	/* expand DSM on demand */
+	dsm_length = dsm_segment_map_length(seg);
+	kds_head_sz = STROMALIGN(offsetof(kern_data_store,
+									  colmeta[ps_desc->natts]));
+	while (kmrels_usage + kds_head_sz > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+		dsm_length = dsm_segment_map_length(seg);
+	}
+	kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+	kds_length = Min(dsm_length - kmrels_usage, 0x100000000L);
+	init_kernel_data_store(kds,
+						   ps_desc,
+						   kds_length,
+						   (istate->hash_inner_keys != NIL
+							? KDS_FORMAT_HASH
+							: KDS_FORMAT_ROW),
+						   UINT_MAX);
+	kds->hash_min = hash_min;
+	kds->hash_max = hash_max;
+	h_kmrels->chunks[depth-1].chunk_offset = kmrels_usage;
+	if (istate->hash_inner_keys != NIL)
+		gpujoin_inner_hash_preload(istate, seg, kds, kmrels_usage);
+	else
+		gpujoin_inner_heap_preload(istate, seg, kds, kmrels_usage, &ritems);
+
+	/* NOTE: gpujoin_inner_xxxx_preload may expand and remap segment */
+	h_kmrels = dsm_segment_address(seg);
+	kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+
+	istate->runtime_nestloop = false;
+	istate->skew_nslots = 0;
+	if (!istate->hash_outer_keys)
+		h_kmrels->chunks[depth-1].is_nestloop = true;
+	else if (depth != gjs->part_depth &&
+			 kds->nitems <= (cl_uint) gpujoin_nestloop_threshold)
+	{
+		/*
+		 * The inner hash table is actually tiny, so nested-loop is cheaper
+		 * than calculation of the hash value and walk on the hash slot.
+		 * Rows of KDS_FORMAT_HASH are also accessible by index, and the
+		 * join_quals contains the hash-join clauses, so the device code
+		 * generated for hash-join works as is.
+		 */
+		h_kmrels->chunks[depth-1].is_nestloop = true;
+		istate->runtime_nestloop = true;
+	}
+	if (istate->join_type == JOIN_RIGHT ||
+		istate->join_type == JOIN_FULL)
+	{
+		h_kmrels->chunks[depth-1].right_outer = true;
+		h_kmrels->chunks[depth-1].ojmap_offset = *p_ojmaps_usage;
+		*p_ojmaps_usage += STROMALIGN(kds->nitems);
+	}
+	if (istate->join_type == JOIN_LEFT ||
+		istate->join_type == JOIN_FULL)
+	{
+		h_kmrels->chunks[depth-1].left_outer = true;
+	}
+	if (istate->join_type == JOIN_SEMI)
+		h_kmrels->chunks[depth-1].semi_join = true;
+	if (istate->join_type == JOIN_ANTI)
+		h_kmrels->chunks[depth-1].anti_join = true;
+	kmrels_usage += STROMALIGN(kds->length);
+
+	/* range index of the nest-loop */
+	if (istate->range_inner_key)
+	{
+		kmrels_usage = gpujoin_inner_range_preload(istate, seg, depth,
+												   kmrels_usage, ritems);
+		if (ritems)
+			pfree(ritems);
+	}
+
+	/* heavy hitters of the non-partitioned INNER/RIGHT hash-join */
+	if (!h_kmrels->chunks[depth-1].is_nestloop &&
+		depth != gjs->part_depth &&
+		(istate->join_type == JOIN_INNER ||
+		 istate->join_type == JOIN_RIGHT))
+		kmrels_usage = gpujoin_inner_skew_preload(istate, seg, depth,
+												  kmrels_usage);
+	return kmrels_usage;
+}
+
+/*
+ * gpujoin_inner_parallel_preload
+ *
+ * It picks up the depths not loaded yet one by one, and loads the inner
+ * relation onto a private DSM segment, with the identical layout of the
+ * kern_multirels that contains only this depth. Both of the master and
+ * workers run this routine, so the inner relations are loaded concurrently.
+ * The master process merges them into the inner buffer later, and the
+ * private segments must be kept until the completion of preload.
+ */
+static void
+gpujoin_inner_parallel_preload(GpuJoinState *gjs)
+{
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	dsm_handle	   *preload_handles = GPUJOIN_PRELOAD_HANDLES(gj_sstate);
+	int				num_rels = gjs->num_rels;
+	size_t			kmrels_head_sz;
+	size_t			kmrels_usage;
+	size_t			ojmaps_usage;
+	kern_multirels *h_kmrels;
+	dsm_segment	   *seg;
+	int				depth;
+
+	Assert(gj_sstate->parallel_preload);
+	if (!gjs->seg_preloads)
+		gjs->seg_preloads = MemoryContextAllocZero(CurTransactionContext,
+											sizeof(dsm_segment *) * num_rels);
+	kmrels_head_sz = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
+	for (;;)
+	{
+		depth = pg_atomic_fetch_add_u32(&gj_sstate->preload_next, 1) + 1;
+		if (depth > num_rels)
+			break;
+		if (depth == gjs->part_depth)
+			continue;	/* partitioned inner shall be loaded later */
+
+		seg = dsm_create(pgstrom_chunk_size(), 0);
+		h_kmrels = dsm_segment_address(seg);
+		memset(h_kmrels, 0, kmrels_head_sz);
+		ojmaps_usage = 0;
+		kmrels_usage = __gpujoin_inner_preload_chunk(gjs, seg, depth,
+													 kmrels_head_sz,
+													 0, UINT_MAX,
+													 &ojmaps_usage);
+		h_kmrels = dsm_segment_address(seg);
+		h_kmrels->kmrels_length = kmrels_usage;
+		gjs->seg_preloads[depth-1] = seg;
+		preload_handles[depth-1] = dsm_segment_handle(seg);
+		pg_atomic_add_fetch_u32(&gj_sstate->preload_nloaded, 1);
+		/* wake up the master process to merge the inner chunks */
+		if (IsParallelWorker())
+			SetLatch(gj_sstate->masterLatch);
+	}
+}
+
+/*
+ * gpujoin_inner_parallel_merge
+ *
+ * It waits for the completion of gpujoin_inner_parallel_preload by the
+ * master and workers, then copies the inner chunks on the private DSM
+ * segments to the tail of the inner buffer, in order of the depth.
+ */
+static size_t
+gpujoin_inner_parallel_merge(GpuJoinState *gjs,
+							 dsm_segment *seg,
+							 size_t kmrels_usage,
+							 size_t *p_ojmaps_usage)
+{
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	dsm_handle	   *preload_handles = GPUJOIN_PRELOAD_HANDLES(gj_sstate);
+	int				num_rels = gjs->num_rels;
+	uint32			nloads = num_rels - (gjs->part_depth > 0 ? 1 : 0);
+	size_t			kmrels_head_sz;
+	kern_multirels *h_kmrels;
+	int				depth;
+
+	Assert(!IsParallelWorker());
+	gpujoin_inner_parallel_preload(gjs);
+	for (;;)
+	{
+		ResetLatch(&MyProc->procLatch);
+		if (pg_atomic_read_u32(&gj_sstate->preload_nloaded) >= nloads)
+			break;
+		CHECK_FOR_INTERRUPTS();
+
+		WaitLatch(&MyProc->procLatch,
+				  WL_LATCH_SET,
+				  -1
+#if PG_VERSION_NUM >= 100000
+				  ,PG_WAIT_EXTENSION
+#endif
+			);
+	}
+	pg_memory_barrier();
+
+	kmrels_head_sz = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
+	for (depth=1; depth <= num_rels; depth++)
+	{
+		innerState	   *istate = &gjs->inners[depth-1];
+		dsm_segment	   *seg_chunk;
+		kern_multirels *h_chunk;
+		kern_data_store *kds;
+		kern_hash_skew *kskew;
+		size_t			dsm_length;
+		size_t			length;
+
+		if (depth == gjs->part_depth)
+			continue;
+		seg_chunk = gjs->seg_preloads[depth-1];
+		if (!seg_chunk)
+		{
+			seg_chunk = dsm_attach(preload_handles[depth-1]);
+			if (!seg_chunk)
+				elog(ERROR, "could not map dynamic shared memory segment");
+		}
+		h_chunk = dsm_segment_address(seg_chunk);
+		length = h_chunk->kmrels_length - kmrels_head_sz;
+
+		/* expand DSM on demand */
+		dsm_length = dsm_segment_map_length(seg);
+		while (kmrels_usage + length > dsm_length)
+		{
+			dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+			dsm_length = dsm_segment_map_length(seg);
+		}
+		h_kmrels = dsm_segment_address(seg);
+		memcpy((char *)h_kmrels + kmrels_usage,
+			   (char *)h_chunk + kmrels_head_sz,
+			   length);
+		/* relocation of the offsets */
+		h_kmrels->chunks[depth-1] = h_chunk->chunks[depth-1];
+		h_kmrels->chunks[depth-1].chunk_offset = kmrels_usage;
+		if (h_chunk->chunks[depth-1].skew_offset != 0)
+			h_kmrels->chunks[depth-1].skew_offset +=
+				kmrels_usage - kmrels_head_sz;
+		if (h_chunk->chunks[depth-1].range_offset != 0)
+			h_kmrels->chunks[depth-1].range_offset +=
+				kmrels_usage - kmrels_head_sz;
+		kds = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+		if (h_kmrels->chunks[depth-1].right_outer)
+		{
+			h_kmrels->chunks[depth-1].ojmap_offset = *p_ojmaps_usage;
+			*p_ojmaps_usage += STROMALIGN(kds->nitems);
+		}
+		/* runtime properties for EXPLAIN */
+		istate->runtime_nestloop = (istate->hash_outer_keys != NIL &&
+									h_kmrels->chunks[depth-1].is_nestloop);
+		kskew = KERN_MULTIRELS_HASH_SKEW(h_kmrels, depth);
+		istate->skew_nslots = (kskew ? kskew->nslots : 0);
+		kmrels_usage += length;
+
+		if (seg_chunk != gjs->seg_preloads[depth-1])
+			dsm_detach(seg_chunk);
+	}
+	return kmrels_usage;
+}
+
+/*
+ * gpujoin_release_parallel_preload
+ *
+ * It releases the private DSM segments of gpujoin_inner_parallel_preload,
+ * once the inner buffer is built.
+ */
+static void
+gpujoin_release_parallel_preload(GpuJoinState *gjs)
+{
+	int		i;
+
+	if (!gjs->seg_preloads)
+		return;
+	for (i=0; i < gjs->num_rels; i++)
+	{
+		if (gjs->seg_preloads[i])
+			dsm_detach(gjs->seg_preloads[i]);
+	}
+	pfree(gjs->seg_preloads);
+	gjs->seg_preloads = NULL;
+}
+
+/*
+ * gpujoin_build_bloom_filter
+ *
+ * It builds a bloom filter on the hash values of the inner hash table at
+ * the first depth, then puts it on the tail of the inner buffer. Outer rows
+ * not in the bloom filter never produce any joined rows, if the first depth
+ * is INNER, SEMI or RIGHT hash-join.
+ */
+static size_t
+gpujoin_build_bloom_filter(GpuJoinState *gjs,
+						   dsm_segment *seg,
+						   size_t kmrels_usage)
+{
+	innerState	   *istate = &gjs->inners[0];
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_data_store *kds_hash;
+	cl_uint		   *row_index;
+	cl_uint		   *bitmap;
+	size_t			dsm_length;
+	size_t			length;
+	cl_uint			nbits;
+	cl_uint			i;
+
+	if (!enable_gpujoin_bloom_filter ||
+		gjs->part_depth == 1 ||
+		istate->hash_inner_keys == NIL ||
+		istate->nrows_ratio > GPUJOIN_BLOOM_FILTER_MAX_RATIO)
+		return kmrels_usage;
+	if (istate->join_type != JOIN_INNER &&
+		istate->join_type != JOIN_SEMI &&
+		istate->join_type != JOIN_RIGHT)
+		return kmrels_usage;
+
+	kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, 1);
+	if (kds_hash->nitems == 0 ||
+		kds_hash->nitems > GPUJOIN_BLOOM_FILTER_MAX_NITEMS)
+		return kmrels_usage;
+	/* 8 bits per inner row, at least 1024 bits */
+	for (nbits = 1024; nbits < 8 * kds_hash->nitems; nbits <<= 1);
+	length = STROMALIGN(nbits / BITS_PER_BYTE);
+
+	/* expand DSM on demand */
+	dsm_length = dsm_segment_map_length(seg);
+	while (kmrels_usage + length > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+		dsm_length = dsm_segment_map_length(seg);
+	}
+	kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, 1);
+	bitmap = (cl_uint *)((char *)h_kmrels + kmrels_usage);
+	memset(bitmap, 0, length);
+
+	row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	for (i=0; i < kds_hash->nitems; i++)
+	{
+		kern_hashitem  *khitem = (kern_hashitem *)
+			((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
+		gpujoin_bloom_filter_insert(bitmap, nbits, khitem->hash);
+	}
+	h_kmrels->bloom_offset = kmrels_usage;
+	h_kmrels->bloom_nbits = nbits;
+
+	return kmrels_usage + length;
+}
+
+/*
+ * gpujoin_attach_bloom_filter
+ *
+ * It enables the bloom filter on the outer relation scan by CPU, if inner
+ * buffer has the bloom filter and the outer join keys are available.
+ */
+static void
+gpujoin_attach_bloom_filter(GpuJoinState *gjs)
+{
+	kern_multirels *h_kmrels = dsm_segment_address(gjs->seg_kmrels);
+	GpuJoinBloomFilter *bloom = gjs->outer_bloom;
+
+	if (bloom && h_kmrels->bloom_nbits > 0)
+	{
+		bloom->bitmap = KERN_MULTIRELS_BLOOM_FILTER(h_kmrels);
+		bloom->nbits = h_kmrels->bloom_nbits;
+		bloom->nskipped = 0;
+		gjs->gts.outer_bloom = bloom;
+	}
+}
+
+/*
+ * gpujoin_inner_preload
+ *
+ * It preload inner relation to the DSM buffer once.
+ *
+ * If inner hash table is partitioned, the partitions are loaded at the
+ * tail of the buffer, next to the inner relations non-partitioned. Host
+ * side buffer keeps all the partitions for CPU fallback, however, device
+ * buffer of the individual devices contains only one partition.
+ */
+static bool
+__gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
+{
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	kern_multirels *h_kmrels;
+	dsm_segment	   *seg;
+	int				i, num_rels = gjs->num_rels;
+	int				part_depth = gjs->part_depth;
+	size_t			ojmaps_usage = 0;
+	size_t			kmrels_usage = 0;
+	size_t			kmrels_head_sz;
+	size_t			common_usage;
+	size_t		   *part_offsets = NULL;
+	size_t		   *part_lengths = NULL;
+	size_t			required;
+
+	Assert(!IsParallelWorker());
 	gjs->m_kmrels_array = MemoryContextAllocZero(CurTransactionContext,
 											numDevAttrs * sizeof(CUdeviceptr));
 	seg = dsm_create(pgstrom_chunk_size(), 0);
 	h_kmrels = dsm_segment_address(seg);
-	kmrels_usage = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
+	kmrels_head_sz = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
+	kmrels_usage = kmrels_head_sz;
 	memset(h_kmrels, 0, kmrels_usage);
 
 	/*
@@ -5543,61 +7876,70 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
 	memcpy(h_kmrels->pg_crc32_table,
 		   pg_crc32_table,
 		   sizeof(pg_crc32_table));
-	for (i=0; i < num_rels; i++)
+	if (gj_sstate->parallel_preload)
 	{
-		innerState	   *istate = &gjs->inners[i];
-		PlanState	   *scan_ps = istate->state;
-		TupleTableSlot *ps_slot = scan_ps->ps_ResultTupleSlot;
-		TupleDesc		ps_desc = ps_slot->tts_tupleDescriptor;
-		kern_data_store *kds;
-		size_t			dsm_length;
-		size_t			kds_length;
-		size_t			kds_head_sz;
-
-		/* expand DSM on demand */
-		dsm_length = dsm_segment_map_length(seg);
-		kds_head_sz = STROMALIGN(offsetof(kern_data_store,
-										  colmeta[ps_desc->natts]));
-		while (kmrels_usage + kds_head_sz > dsm_length)
+		kmrels_usage = gpujoin_inner_parallel_merge(gjs, seg,
+													kmrels_usage,
+													&ojmaps_usage);
+		gpujoin_release_parallel_preload(gjs);
+	}
+	else
+	{
+		for (i=0; i < num_rels; i++)
 		{
-			h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
-			dsm_length = dsm_segment_map_length(seg);
+			if (i + 1 == part_depth)
+				continue;	/* partitioned inner shall be loaded later */
+			kmrels_usage = __gpujoin_inner_preload_chunk(gjs, seg, i + 1,
+														 kmrels_usage,
+														 0, UINT_MAX,
+														 &ojmaps_usage);
 		}
-		kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
-		kds_length = Min(dsm_length - kmrels_usage, 0x100000000L);
-		init_kernel_data_store(kds,
-							   ps_desc,
-							   kds_length,
-							   (istate->hash_inner_keys != NIL
-								? KDS_FORMAT_HASH
-								: KDS_FORMAT_ROW),
-							   UINT_MAX);
-		h_kmrels->chunks[i].chunk_offset = kmrels_usage;
-		if (istate->hash_inner_keys != NIL)
-			gpujoin_inner_hash_preload(istate, seg, kds, kmrels_usage);
-		else
-			gpujoin_inner_heap_preload(istate, seg, kds, kmrels_usage);
-
-		/* NOTE: gpujoin_inner_xxxx_preload may expand and remap segment */
-		h_kmrels = dsm_segment_address(seg);
-		kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+	}
+	kmrels_usage = gpujoin_build_bloom_filter(gjs, seg, kmrels_usage);
+	common_usage = kmrels_usage;
 
-		if (!istate->hash_outer_keys)
-			h_kmrels->chunks[i].is_nestloop = true;
-		if (istate->join_type == JOIN_RIGHT ||
-			istate->join_type == JOIN_FULL)
-		{
-			h_kmrels->chunks[i].right_outer = true;
-			h_kmrels->chunks[i].ojmap_offset = ojmaps_usage;
-			ojmaps_usage += STROMALIGN(kds->nitems);
-		}
-		if (istate->join_type == JOIN_LEFT ||
-			istate->join_type == JOIN_FULL)
+	/*
+	 * Load partitioned inner hash table, if any
+	 *
+	 * NOTE: Each partition is located at the tail of the DSM segment, so we
+	 * rescan the inner relation for each partition. It is more expensive
+	 * than a single scan, however, this path is chosen only when inner
+	 * relation is too large to load onto a particular device.
+	 */
+	if (part_depth > 0)
+	{
+		innerState *istate = &gjs->inners[part_depth - 1];
+		int			nparts = gjs->part_nums;
+
+		Assert(istate->join_type == JOIN_INNER &&
+			   istate->hash_inner_keys != NIL &&
+			   istate->nparts == nparts &&
+			   (gjs->part_batched || nparts <= numDevAttrs));
+		part_offsets = MemoryContextAlloc(CurTransactionContext,
+										  sizeof(size_t) * nparts);
+		part_lengths = MemoryContextAlloc(CurTransactionContext,
+										  sizeof(size_t) * nparts);
+		for (i=0; i < nparts; i++)
 		{
-			h_kmrels->chunks[i].left_outer = true;
+			cl_uint		hash_min = (((cl_ulong) i) << 32) / nparts;
+			cl_uint		hash_max = ((((cl_ulong)(i+1)) << 32) / nparts) - 1;
+
+			if (i > 0)
+				ExecReScan(istate->state);
+			part_offsets[i] = kmrels_usage;
+			kmrels_usage = __gpujoin_inner_preload_chunk(gjs, seg,
+														 part_depth,
+														 kmrels_usage,
+														 hash_min,
+														 hash_max,
+														 &ojmaps_usage);
+			part_lengths[i] = kmrels_usage - part_offsets[i];
 		}
-		kmrels_usage += STROMALIGN(kds->length);
+		h_kmrels = dsm_segment_address(seg);
+		h_kmrels->chunks[part_depth - 1].chunk_offset = part_offsets[0];
+		Assert(ojmaps_usage == 0);
 	}
+	h_kmrels = dsm_segment_address(seg);
 	Assert(kmrels_usage <= dsm_segment_map_length(seg));
 	h_kmrels->kmrels_length = kmrels_usage;
 	h_kmrels->ojmaps_length = ojmaps_usage;
@@ -5612,11 +7954,14 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
 	 */
 	for (i=num_rels; i > 0; i--)
 	{
-		kds = KERN_MULTIRELS_INNER_KDS(h_kmrels, i);
+		size_t		nitems;
+
 		/* outer join can produce something from empty */
-		if (gjs->inners[i-1].join_type != JOIN_INNER)
+		if (gjs->inners[i-1].join_type != JOIN_INNER &&
+			gjs->inners[i-1].join_type != JOIN_SEMI)
 			break;
-		if (kds->nitems == 0)
+		gpujoin_inner_chunk_stat(h_kmrels, i, &nitems, NULL);
+		if (nitems == 0)
 		{
 			dsm_detach(seg);
 			gjs->seg_kmrels = (void *)(~0UL);
@@ -5638,32 +7983,144 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
 	 * NOTE: It is desirable to use device memory which supports on-demand
 	 * allocation; regardless of unified addressing.
 	 */
-	for (i = (with_cpu_parallel ? gcontext->cuda_dindex : 0);
-		 i < (with_cpu_parallel ? gcontext->cuda_dindex + 1 : numDevAttrs);
-		 i++)
+	if (part_depth > 0 && gjs->part_batched)
 	{
-		CUdeviceptr	m_deviceptr;
+		kern_multirels *d_kmrels_head = palloc(kmrels_head_sz);
+		size_t		part_maxlen = 0;
 		CUresult	rc;
 
-		rc = gpuMemAllocDev(gcontext, i,
-							&m_deviceptr,
-							required,
-							&gj_sstate->pergpu[i].m_handle);
+		/*
+		 * Partitioned inner hash table, but more than the number of devices.
+		 * The device buffer has the common portion and a room for the
+		 * largest partition. The first batch is loaded here, then the later
+		 * ones are loaded by gpujoin_switch_batch().
+		 */
+		for (i=0; i < gjs->part_nums; i++)
+			part_maxlen = Max(part_maxlen, part_lengths[i]);
+		rc = gpuMemAllocDev(gcontext, gcontext->cuda_dindex,
+							&gjs->m_kmrels,
+							common_usage + part_maxlen,
+							&gj_sstate->pergpu[gcontext->cuda_dindex].m_handle);
 		if (rc != CUDA_SUCCESS)
 			elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
-		if (i == gcontext->cuda_dindex)
-			gjs->m_kmrels = m_deviceptr;
-		gjs->m_kmrels_array[i] = m_deviceptr;
+		gjs->m_kmrels_array[gcontext->cuda_dindex] = gjs->m_kmrels;
+
+		memcpy(d_kmrels_head, h_kmrels, kmrels_head_sz);
+		d_kmrels_head->kmrels_length = common_usage + part_lengths[0];
+		d_kmrels_head->cuda_dindex = gcontext->cuda_dindex;
+		d_kmrels_head->chunks[part_depth - 1].chunk_offset = common_usage;
 
-		rc = cuMemcpyHtoD(m_deviceptr, h_kmrels, required);
+		rc = cuMemcpyHtoD(gjs->m_kmrels, d_kmrels_head, kmrels_head_sz);
 		if (rc != CUDA_SUCCESS)
 			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
-		rc = cuMemsetD32(m_deviceptr + offsetof(kern_multirels,
-												cuda_dindex),
-						 (unsigned int)i,
-						 1);
+		rc = cuMemcpyHtoD(gjs->m_kmrels + kmrels_head_sz,
+						  (char *)h_kmrels + kmrels_head_sz,
+						  common_usage - kmrels_head_sz);
 		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuMemsetD32: %s", errorText(rc));
+			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		rc = cuMemcpyHtoD(gjs->m_kmrels + common_usage,
+						  (char *)h_kmrels + part_offsets[0],
+						  part_lengths[0]);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		pfree(d_kmrels_head);
+
+		gjs->curr_part = 0;
+		gjs->part_common = common_usage;
+		gjs->part_offsets = part_offsets;
+		gjs->part_lengths = part_lengths;
+	}
+	else if (part_depth > 0)
+	{
+		kern_multirels *d_kmrels_head = palloc(kmrels_head_sz);
+
+		/*
+		 * Partitioned inner hash table. i-th device has i-th partition of
+		 * the inner hash table, next to the common portion.
+		 */
+		for (i=0; i < gjs->part_nums; i++)
+		{
+			CUdeviceptr	m_deviceptr;
+			CUresult	rc;
+
+			required = common_usage + part_lengths[i];
+			rc = gpuMemAllocDev(gcontext, i,
+								&m_deviceptr,
+								required,
+								&gj_sstate->pergpu[i].m_handle);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+			if (i == gcontext->cuda_dindex)
+				gjs->m_kmrels = m_deviceptr;
+			gjs->m_kmrels_array[i] = m_deviceptr;
+
+			memcpy(d_kmrels_head, h_kmrels, kmrels_head_sz);
+			d_kmrels_head->kmrels_length = required;
+			d_kmrels_head->cuda_dindex = i;
+			d_kmrels_head->chunks[part_depth - 1].chunk_offset = common_usage;
+
+			rc = cuMemcpyHtoD(m_deviceptr, d_kmrels_head, kmrels_head_sz);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+			rc = cuMemcpyHtoD(m_deviceptr + kmrels_head_sz,
+							  (char *)h_kmrels + kmrels_head_sz,
+							  common_usage - kmrels_head_sz);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+			rc = cuMemcpyHtoD(m_deviceptr + common_usage,
+							  (char *)h_kmrels + part_offsets[i],
+							  part_lengths[i]);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+
+			/* enables to access the partition from the current device */
+			if (i != gcontext->cuda_dindex)
+			{
+				SwitchGpuContext(gcontext, gcontext->cuda_dindex);
+				rc = cuCtxEnablePeerAccess(gcontext->cuda_context_multi[i], 0);
+				SwitchGpuContext(gcontext, -1);
+				if (rc != CUDA_SUCCESS &&
+					rc != CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED)
+					elog(ERROR, "failed on cuCtxEnablePeerAccess: %s",
+						 errorText(rc));
+			}
+		}
+		gjs->m_kmrels_parts = gjs->m_kmrels_array;
+		if (!gjs->m_kmrels)
+			gjs->m_kmrels = gjs->m_kmrels_parts[0];
+		pfree(d_kmrels_head);
+		pfree(part_offsets);
+		pfree(part_lengths);
+	}
+	else
+	{
+		for (i = (with_cpu_parallel ? gcontext->cuda_dindex : 0);
+			 i < (with_cpu_parallel ? gcontext->cuda_dindex + 1 : numDevAttrs);
+			 i++)
+		{
+			CUdeviceptr	m_deviceptr;
+			CUresult	rc;
+
+			rc = gpuMemAllocDev(gcontext, i,
+								&m_deviceptr,
+								required,
+								&gj_sstate->pergpu[i].m_handle);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+			if (i == gcontext->cuda_dindex)
+				gjs->m_kmrels = m_deviceptr;
+			gjs->m_kmrels_array[i] = m_deviceptr;
+
+			rc = cuMemcpyHtoD(m_deviceptr, h_kmrels, required);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+			rc = cuMemsetD32(m_deviceptr + offsetof(kern_multirels,
+													cuda_dindex),
+							 (unsigned int)i,
+							 1);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemsetD32: %s", errorText(rc));
+		}
 	}
 	gj_sstate->kmrels_handle = dsm_segment_handle(seg);
 	gjs->seg_kmrels = seg;
@@ -5703,6 +8160,10 @@ GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
 	pg_atomic_add_fetch_u32(&gj_sstate->pergpu[dindex].pg_nworkers, 1);
 	pg_atomic_add_fetch_u32(&gj_sstate->pg_nworkers, 1);
 
+	/* workers also load a part of inner relations, if parallel preload */
+	if (IsParallelWorker() && gj_sstate->parallel_preload)
+		gpujoin_inner_parallel_preload(gjs);
+
 	ResetLatch(&MyProc->procLatch);
 	while ((preload_done = pg_atomic_read_u32(&gj_sstate->preload_done)) == 0)
 	{
@@ -5732,6 +8193,7 @@ GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
 
 			if (preload_done == 1)
 			{
+				gpujoin_attach_bloom_filter(gjs);
 				if (p_m_kmrels)
 					*p_m_kmrels = gjs->m_kmrels;
 				return true;
@@ -5753,6 +8215,8 @@ GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
 			ResetLatch(&MyProc->procLatch);
 		}
 	}
+	/* private inner chunks are already merged by the master */
+	gpujoin_release_parallel_preload(gjs);
 	/* the inner buffer ready? */
 	if (preload_done > 1)
 		return false;
@@ -5761,13 +8225,42 @@ GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
 	if (!gjs->seg_kmrels)
 		elog(ERROR, "could not map dynamic shared memory segment");
 
-	rc = gpuIpcOpenMemHandle(gcontext,
-							 &m_deviceptr,
-							 gj_sstate->pergpu[dindex].m_handle,
-							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
-	if (rc != CUDA_SUCCESS)
-		elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	if (gjs->part_nums > 1)
+	{
+		/*
+		 * Partitioned inner hash table; open all the partitions on the
+		 * individual devices, to be accessed using peer-to-peer access.
+		 */
+		int		i;
+
+		gjs->m_kmrels_parts = MemoryContextAllocZero(CurTransactionContext,
+										sizeof(CUdeviceptr) * gjs->part_nums);
+		for (i=0; i < gjs->part_nums; i++)
+		{
+			rc = gpuIpcOpenMemHandle(gcontext,
+									 &gjs->m_kmrels_parts[i],
+									 gj_sstate->pergpu[i].m_handle,
+									 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuIpcOpenMemHandle: %s",
+					 errorText(rc));
+		}
+		if (dindex < gjs->part_nums)
+			m_deviceptr = gjs->m_kmrels_parts[dindex];
+		else
+			m_deviceptr = gjs->m_kmrels_parts[0];
+	}
+	else
+	{
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &m_deviceptr,
+								 gj_sstate->pergpu[dindex].m_handle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	}
 	gjs->m_kmrels = m_deviceptr;
+	gpujoin_attach_bloom_filter(gjs);
 	if (p_m_kmrels)
 		*p_m_kmrels = m_deviceptr;
 	return true;
@@ -5801,21 +8294,51 @@ GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan)
 			}
 			pfree(gjs->m_kmrels_array);
 			gjs->m_kmrels_array = NULL;
+			gjs->m_kmrels_parts = NULL;
+		}
+		/* Release outer chunks and partitions info, if batched */
+		if (gjs->part_batched)
+		{
+			gpujoin_release_batch_chunks(gjs);
+			if (gjs->part_offsets)
+				pfree(gjs->part_offsets);
+			if (gjs->part_lengths)
+				pfree(gjs->part_lengths);
+			gjs->part_offsets = NULL;
+			gjs->part_lengths = NULL;
+			gjs->curr_part = 0;
+			gjs->fallback_part = -1;
 		}
 		/* Reset GpuJoinSharedState, if rescan */
 		if (is_rescan)
 		{
 			gjs->curr_outer_depth		= -1;
+			gjs->ojmap_detached			= false;
+			gjs->ojmap_runner			= false;
 			gj_sstate->kmrels_handle	= UINT_MAX;	/* DSM */
 			pg_atomic_init_u32(&gj_sstate->needs_colocation,
 							   numDevAttrs > 1 ? 1 : 0);
 			pg_atomic_init_u32(&gj_sstate->preload_done, 0);
 			pg_atomic_init_u32(&gj_sstate->pg_nworkers, 0);
+			pg_atomic_init_u32(&gj_sstate->preload_next, 0);
+			pg_atomic_init_u32(&gj_sstate->preload_nloaded, 0);
 			memset(gj_sstate->pergpu, 0,
 				   offsetof(GpuJoinSharedState, pergpu[numDevAttrs]) -
 				   offsetof(GpuJoinSharedState, pergpu[0]));
 		}
 	}
+	else if (gjs->m_kmrels_parts)
+	{
+		for (i=0; i < gjs->part_nums; i++)
+		{
+			rc = gpuIpcCloseMemHandle(gcontext, gjs->m_kmrels_parts[i]);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuIpcCloseMemHandle: %s",
+					 errorText(rc));
+		}
+		pfree(gjs->m_kmrels_parts);
+		gjs->m_kmrels_parts = NULL;
+	}
 	else
 	{
 		rc = gpuIpcCloseMemHandle(gcontext, gjs->m_kmrels);
@@ -5825,6 +8348,8 @@ GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan)
 	dsm_detach(gjs->seg_kmrels);
 	gjs->m_kmrels = 0UL;
 	gjs->seg_kmrels = NULL;
+	/* bloom filter references the inner buffer */
+	gjs->gts.outer_bloom = NULL;
 }
 
 /*
@@ -5844,7 +8369,8 @@ createGpuJoinSharedState(GpuJoinState *gjs,
 	ss_length = (MAXALIGN(offsetof(GpuJoinSharedState,
 								   pergpu[numDevAttrs])) +
 				 MAXALIGN(offsetof(GpuJoinRuntimeStat,
-								   jstat[gjs->num_rels + 1])));
+								   jstat[gjs->num_rels + 1])) +
+				 MAXALIGN(sizeof(dsm_handle) * gjs->num_rels));
 	if (dsm_addr)
 		gj_sstate = dsm_addr;
 	else
@@ -5854,12 +8380,25 @@ createGpuJoinSharedState(GpuJoinState *gjs,
 	gj_sstate->ss_length = ss_length;
 	gj_sstate->offset_runtime_stat = MAXALIGN(offsetof(GpuJoinSharedState,
 													   pergpu[numDevAttrs]));
+	gj_sstate->offset_preload_handles = gj_sstate->offset_runtime_stat +
+		MAXALIGN(offsetof(GpuJoinRuntimeStat, jstat[gjs->num_rels + 1]));
 	gj_sstate->masterLatch = MyLatch;
 	gj_sstate->kmrels_handle = UINT_MAX;	/* to be set later */
 	pg_atomic_init_u32(&gj_sstate->needs_colocation,
 					   numDevAttrs > 1 ? 1 : 0);
 	pg_atomic_init_u32(&gj_sstate->preload_done, 0);
 	pg_atomic_init_u32(&gj_sstate->pg_nworkers, 0);
+	/*
+	 * Inner relations are loaded by the master and workers concurrently,
+	 * if two or more depths are loaded at once (partitioned inner hash
+	 * table is loaded by the master later, because of rescan per partition)
+	 */
+	gj_sstate->parallel_preload = (pcxt != NULL &&
+								   enable_gpujoin_parallel_preload &&
+								   gjs->num_rels -
+								   (gjs->part_depth > 0 ? 1 : 0) > 1);
+	pg_atomic_init_u32(&gj_sstate->preload_next, 0);
+	pg_atomic_init_u32(&gj_sstate->preload_nloaded, 0);
 
 	return gj_sstate;
 }
@@ -5876,6 +8415,20 @@ gpujoinHasRightOuterJoin(GpuTaskState *gts)
 	return (kmrels->ojmaps_length > 0);
 }
 
+/*
+ * gpujoinHasPartitionedInner
+ *
+ * NOTE: GpuPreAgg cannot combine GpuJoin with partitioned inner hash table,
+ * because it references only the inner buffer of the current device.
+ */
+bool
+gpujoinHasPartitionedInner(GpuTaskState *gts)
+{
+	GpuJoinState   *gjs = (GpuJoinState *) gts;
+
+	return (gjs->part_nums > 1);
+}
+
 /*
  * pgstrom_init_gpujoin
  *
@@ -5902,6 +8455,93 @@ pgstrom_init_gpujoin(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off range index of gpunestloop */
+	DefineCustomBoolVariable("pg_strom.enable_gpurangejoin",
+							 "Enables the range index on GpuNestLoop with range type join clause",
+							 NULL,
+							 &enable_gpurangejoin,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off partitioned gpuhashjoin on multi-GPUs */
+	DefineCustomBoolVariable("pg_strom.enable_partitioned_gpuhashjoin",
+							 "Enables GpuHashJoin with inner hash table partitioned over multiple GPUs or batches",
+							 NULL,
+							 &enable_partitioned_gpuhashjoin,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off bloom filter on the outer relation */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_bloom_filter",
+							 "Enables the bloom filter on the GpuJoin outer relation",
+							 NULL,
+							 &enable_gpujoin_bloom_filter,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off inner preload by the master and workers concurrently */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_parallel_preload",
+							 "Enables to load GpuJoin inner relations by the parallel workers concurrently",
+							 NULL,
+							 &enable_gpujoin_parallel_preload,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* threshold of bulk prefetch of the task buffers */
+	DefineCustomIntVariable("pg_strom.gpujoin_prefetch_limit",
+							"Max size of GpuJoin working buffer to be prefetched at once",
+							NULL,
+							&gpujoin_prefetch_limit_kb,
+							32768,		/* 32MB */
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	/* max number of inner rows to run hash-join as nested-loop */
+	DefineCustomIntVariable("pg_strom.gpujoin_nestloop_threshold",
+							"Max number of inner rows to run GpuHashJoin as nested-loop",
+							NULL,
+							&gpujoin_nestloop_threshold,
+							64,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* min length of the hash chain to be handled as heavy hitter */
+	DefineCustomIntVariable("pg_strom.gpujoin_skew_threshold",
+							"Min length of GpuHashJoin hash chain to be split over multiple threads",
+							NULL,
+							&gpujoin_skew_threshold,
+							2048,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* turn on/off the persistent kernel over multiple tasks */
+	DefineCustomBoolVariable("pg_strom.gpujoin_persistent_kernel",
+							 "Enables GpuJoin kernel to process multiple pending tasks by a single launch",
+							 NULL,
+							 &gpujoin_persistent_kernel,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off the packed buckets of the inner hash table */
+	DefineCustomBoolVariable("pg_strom.gpujoin_packed_hash",
+							 "Enables packed buckets on the inner hash table of GpuHashJoin",
+							 NULL,
+							 &gpujoin_packed_hash,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* setup path methods */
 	gpujoin_path_methods.CustomName				= "GpuJoin";
 	gpujoin_path_methods.PlanCustomPath			= PlanGpuJoinPath;
@@ -18,6 +18,7 @@
 #include "pg_strom.h"
 #include "cuda_gpujoin.h"
 #include "cuda_gpupreagg.h"
+#include "cuda_misc.h"
 
 static create_upper_paths_hook_type create_upper_paths_next;
 static CustomPathMethods		gpupreagg_path_methods;
@@ -25,10 +26,14 @@ static CustomScanMethods		gpupreagg_scan_methods;
 static CustomExecMethods		gpupreagg_exec_methods;
 static bool						enable_gpupreagg;
 static bool						enable_pullup_outer_join;
+static bool						enable_gpupreagg_dictionary;
+static bool						enable_gpupreagg_shared_final;
+static bool						enable_gpupreagg_distinct;
 
 typedef struct
 {
 	cl_int			num_group_keys;	/* number of grouping keys */
+	cl_int			num_dict_keys;	/* number of dictionary encoded keys */
 	double			plan_ngroups;	/* planned number of groups */
 	cl_int			plan_nchunks;	/* planned number of chunks */
 	cl_int			plan_extra_sz;	/* planned size of extra-sz per tuple */
@@ -46,6 +51,7 @@ typedef struct
 	int				extra_flags;
 	List		   *ccache_refs;	/* referenced columns */
 	List		   *used_params;	/* referenced Const/Param */
+	cl_uint			fingerprint;	/* key of the cardinality feedback */
 } GpuPreAggInfo;
 
 static inline void
@@ -55,6 +61,7 @@ form_gpupreagg_info(CustomScan *cscan, GpuPreAggInfo *gpa_info)
 	List	   *exprs = NIL;
 
 	privs = lappend(privs, makeInteger(gpa_info->num_group_keys));
+	privs = lappend(privs, makeInteger(gpa_info->num_dict_keys));
 	privs = lappend(privs, pmakeFloat(gpa_info->plan_ngroups));
 	privs = lappend(privs, makeInteger(gpa_info->plan_nchunks));
 	privs = lappend(privs, makeInteger(gpa_info->plan_extra_sz));
@@ -70,6 +77,7 @@ form_gpupreagg_info(CustomScan *cscan, GpuPreAggInfo *gpa_info)
 	privs = lappend(privs, makeInteger(gpa_info->extra_flags));
 	privs = lappend(privs, gpa_info->ccache_refs);
 	exprs = lappend(exprs, gpa_info->used_params);
+	privs = lappend(privs, makeInteger(gpa_info->fingerprint));
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -85,6 +93,7 @@ deform_gpupreagg_info(CustomScan *cscan)
 	int			eindex = 0;
 
 	gpa_info->num_group_keys = intVal(list_nth(privs, pindex++));
+	gpa_info->num_dict_keys = intVal(list_nth(privs, pindex++));
 	gpa_info->plan_ngroups = floatVal(list_nth(privs, pindex++));
 	gpa_info->plan_nchunks = intVal(list_nth(privs, pindex++));
 	gpa_info->plan_extra_sz = intVal(list_nth(privs, pindex++));
@@ -100,6 +109,7 @@ deform_gpupreagg_info(CustomScan *cscan)
 	gpa_info->extra_flags = intVal(list_nth(privs, pindex++));
 	gpa_info->ccache_refs = list_nth(privs, pindex++);
 	gpa_info->used_params = list_nth(exprs, eindex++);
+	gpa_info->fingerprint = intVal(list_nth(privs, pindex++));
 
 	return gpa_info;
 }
@@ -115,6 +125,7 @@ typedef struct
 	cl_bool			combined_gpujoin;
 	cl_bool			terminator_done;
 	cl_int			num_group_keys;
+	cl_int			num_dict_keys;	/* number of dictionary encoded keys */
 	TupleTableSlot *gpreagg_slot;	/* Slot reflects tlist_dev (w/o junks) */
 #if PG_VERSION_NUM < 100000
 	List		   *outer_quals;	/* List of ExprState */
@@ -131,11 +142,35 @@ typedef struct
 	size_t			f_hashsize;
 	size_t			f_hashlimit;
 	pthread_mutex_t	f_mutex;
+	/*
+	 * Reservation of the final buffer. If it may overflow by the groups of
+	 * the running tasks, the final buffer is spilled to the host as partial
+	 * results, then a new final buffer is set up. (protected by f_mutex)
+	 */
+	pthread_cond_t	f_cond;
+	cl_bool			f_has_extra;	/* final buffer needs extra area */
+	cl_int			f_nrunning;		/* # of tasks running on the buffer */
+	size_t			f_nitems;		/* # of groups at the last check */
+	size_t			f_usage;		/* extra usage at the last check */
+	size_t			f_reserved_nrooms; /* rooms reserved by running tasks */
+	size_t			f_reserved_extra; /* extra reserved by running tasks */
+	/*
+	 * Final buffer and hash-slot on the device memory, shared by the master
+	 * and workers on the same device. Once it becomes full, tasks of this
+	 * process use the private final buffer above.
+	 */
+	CUdeviceptr		m_kds_shared;
+	CUdeviceptr		m_fhash_shared;
+	cl_bool			f_shared_owner;	/* allocated by this process */
+	cl_bool			f_shared_attached; /* tasks may use the shared buffer */
+	cl_bool			f_shared_overflow; /* shared buffer is already full */
 
 	size_t			plan_nrows_per_chunk;	/* planned nrows/chunk */
 	size_t			plan_nrows_in;	/* num of outer rows planned */
 	size_t			plan_ngroups;	/* num of groups planned */
 	size_t			plan_extra_sz;	/* size of varlena planned */
+	cl_uint			fingerprint;	/* key of the cardinality feedback */
+	size_t			final_nitems;	/* # of rows returned by this process */
 } GpuPreAggState;
 
 struct GpuPreAggRuntimeStat
@@ -144,6 +179,8 @@ struct GpuPreAggRuntimeStat
 	pg_atomic_uint64	nitems_filtered;
 	pg_atomic_uint64	num_fallback_rows;
 	pg_atomic_uint64	ccache_count;
+	pg_atomic_uint64	num_final_spills;
+	pg_atomic_uint64	final_nitems_max; /* max of the final_nitems */
 	pg_atomic_uint32	pg_nworkers;
 };
 typedef struct GpuPreAggRuntimeStat	GpuPreAggRuntimeStat;
@@ -153,9 +190,24 @@ struct GpuPreAggSharedState
 	dsm_handle		ss_handle;	/* DSM handle of the SharedState */
 	cl_uint			ss_length;	/* Length of the SharedState */
 	GpuPreAggRuntimeStat gpa_rtstat;	/* Run-time statistics */
+	/* final buffer shared by the processes on the same device, if any */
+	cl_int			f_dindex;	/* device of the shared buffer, or -1 */
+	CUipcMemHandle	f_kds_handle;	/* IPC handle of the kds_final */
+	CUipcMemHandle	f_hash_handle;	/* IPC handle of the f_hash */
+	cl_uint			f_nrooms;	/* capacity of the kds_final */
+	size_t			f_hashsize;
+	size_t			f_hashlimit;
+	pg_atomic_uint32 f_hash_state;	/* 0: not init, 1: in progress, 2: ready */
+	pg_atomic_uint32 f_nattached;	/* # of processes attached, or CLOSED */
+	pg_atomic_uint64 f_reserved_nrooms; /* rooms reserved by running tasks */
 };
 typedef struct GpuPreAggSharedState	GpuPreAggSharedState;
 
+/* no more processes can attach the shared final buffer */
+#define GPUPREAGG_SHARED_FINAL_CLOSED	0x80000000U
+/* upper limit of the shared final buffer on the device memory */
+#define GPUPREAGG_SHARED_FINAL_MAXLEN	(1UL << 30)
+
 /*
  * GpuPreAggTask
  *
@@ -177,11 +229,15 @@ typedef struct
 	GpuTask				task;
 	bool				with_nvme_strom;/* true, if NVMe-Strom */
 	pgstrom_data_store *pds_src;	/* source row/block buffer */
+	CUdeviceptr			m_kds_ccache;	/* kds_src on device tier of ccache,
+										 * if any */
 	size_t				kds_slot_nrooms; /* for kds_slot */
 	size_t				kds_slot_length; /* for kds_slot */
 	kern_gpujoin	   *kgjoin;		/* kern_gpujoin, if combined mode */
 	CUdeviceptr			m_kmrels;	/* kern_multirels, if combined mode */
 	cl_int				outer_depth;/* RIGHT OUTER depth, if combined mode */
+	cl_bool				f_shared;	/* runs on the shared final buffer */
+	dlist_head			pds_final_list; /* final buffers to be returned */
 	kern_gpupreagg		kern;
 } GpuPreAggTask;
 
@@ -193,6 +249,7 @@ static bool		gpupreagg_build_path_target(PlannerInfo *root,
 											PathTarget *target_device,
 											PathTarget *target_input,
 											Bitmapset **p_pfunc_bitmap,
+											List **p_distinct_keys,
 											Node **p_havingQual,
 											bool *p_can_pullup_outerscan);
 static char	   *gpupreagg_codegen(codegen_context *context,
@@ -207,12 +264,15 @@ static GpuPreAggSharedState *createGpuPreAggSharedState(GpuPreAggState *gpas,
 														void *dsm_addr);
 static void releaseGpuPreAggSharedState(GpuPreAggState *gpas);
 static void resetGpuPreAggSharedState(GpuPreAggState *gpas);
+static void gpupreagg_alloc_shared_final_buffer(GpuPreAggState *gpas);
+static void gpupreagg_reset_shared_final_buffer(GpuPreAggState *gpas);
 
 static GpuTask *gpupreagg_next_task(GpuTaskState *gts);
 static GpuTask *gpupreagg_terminator_task(GpuTaskState *gts,
 										  cl_bool *task_is_ready);
 static int  gpupreagg_process_task(GpuTask *gtask, CUmodule cuda_module);
 static void gpupreagg_release_task(GpuTask *gtask);
+static bool gpupreagg_jit_fallback(GpuTaskState *gts, GpuTask *gtask);
 static TupleTableSlot *gpupreagg_next_tuple(GpuTaskState *gts);
 
 /*
@@ -228,6 +288,10 @@ static TupleTableSlot *gpupreagg_next_tuple(GpuTaskState *gts);
 #define ALTFUNC_EXPR_PCOV_X2		108	/* PCOV_X2(X,Y) */
 #define ALTFUNC_EXPR_PCOV_Y2		109	/* PCOV_Y2(X,Y) */
 #define ALTFUNC_EXPR_PCOV_XY		110	/* PCOV_XY(X,Y) */
+#define ALTFUNC_EXPR_PSUM_FIXED_HI	111	/* PSUM(NUMERIC_FIXED_HI(X,scale)) */
+#define ALTFUNC_EXPR_PSUM_FIXED_LO	112	/* PSUM(NUMERIC_FIXED_LO(X,scale)) */
+#define ALTFUNC_CONST_SCALE			113	/* typmod scale of X (host only) */
+#define ALTFUNC_EXPR_HLL_SKETCH		114	/* ARRAY[PMAX(HLL_REGISTER(X,i))] */
 
 /*
  * XXX - GpuPreAgg with Numeric arguments are problematic because
@@ -247,6 +311,9 @@ static TupleTableSlot *gpupreagg_next_tuple(GpuTaskState *gts);
 #ifndef NUMERICARRAYOID
 #define NUMERICARRAYOID		1231	/* see pg_type.h */
 #endif
+#ifndef INT2ARRAYOID
+#define INT2ARRAYOID		1005	/* see pg_type.h */
+#endif
 
 /*
  * List of supported aggregate functions
@@ -868,6 +935,159 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PCOV_Y2,
 	   ALTFUNC_EXPR_PCOV_XY}, 0, SHRT_MAX
 	},
+	/*
+	 * HLL_COUNT(X) = FHLL_COUNT(HLL_SKETCH(ARRAY[PMAX(HLL_REGISTER(X,0)),
+	 *                                            PMAX(HLL_REGISTER(X,1)),
+	 *                                                  :
+	 *                                            PMAX(HLL_REGISTER(X,63))]))
+	 */
+	{ "hll_count", 1, {INT8OID},
+	  "s:fhll_count", BYTEAOID,
+	  "s:hll_sketch", 1, {INT2ARRAYOID},
+	  {ALTFUNC_EXPR_HLL_SKETCH}, 0, INT_MAX
+	},
+};
+
+/*
+ * List of fixed-point alternatives for SUM/AVG(numeric)
+ *
+ * If argument of SUM/AVG(numeric) has bounded precision by its typmod,
+ * like numeric(18,4), device code converts the value to a scaled 64bit
+ * integer (X * 10^scale) at once, then accumulates its upper/lower bits
+ * on a pair of int8 PSUM() independently. Each of them never overflow
+ * unless a group contains more than 2^33 rows, so the pair works as if
+ * 128bit integer accumulator without device side numeric operations.
+ * The partial function reconstructs an exact numeric on the host side.
+ */
+#define NUMERIC_FIXED_MAX_PRECISION		18
+
+static aggfunc_catalog_t  aggfunc_fixed_catalog[] = {
+	/* AVG(X) = EX_AVG(PAVG_FIXED(NROWS(), PSUM(HI), PSUM(LO), SCALE)) */
+	{ "avg",	1, {NUMERICOID},
+	  "s:favg",		NUMERICARRAYOID,
+	  "s:pavg_fixed", 4, {INT8OID, INT8OID, INT8OID, INT4OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM_FIXED_HI,
+	   ALTFUNC_EXPR_PSUM_FIXED_LO,
+	   ALTFUNC_CONST_SCALE}, DEVKERNEL_NEEDS_NUMERIC, INT_MAX
+	},
+	/* SUM(X) = SUM(PSUM_FIXED(PSUM(HI), PSUM(LO), SCALE)) */
+	{ "sum",	1, {NUMERICOID},
+	  "c:sum",		NUMERICOID,
+	  "s:psum_fixed", 3, {INT8OID, INT8OID, INT4OID},
+	  {ALTFUNC_EXPR_PSUM_FIXED_HI,
+	   ALTFUNC_EXPR_PSUM_FIXED_LO,
+	   ALTFUNC_CONST_SCALE}, DEVKERNEL_NEEDS_NUMERIC, INT_MAX
+	},
+};
+
+/*
+ * aggfunc_lookup_fixed_numeric
+ *
+ * It switches SUM/AVG(numeric) to the fixed-point alternative if typmod
+ * of the argument guarantees the scaled value fits in 64bit integer.
+ */
+static const aggfunc_catalog_t *
+aggfunc_lookup_fixed_numeric(const aggfunc_catalog_t *aggfn_cat,
+							 Aggref *aggref, int *p_scale)
+{
+	TargetEntry *tle;
+	int32		typmod;
+	int			precision;
+	int			scale;
+	int			i;
+
+	if (aggfn_cat->aggfn_nargs != 1 ||
+		aggfn_cat->aggfn_argtypes[0] != NUMERICOID ||
+		list_length(aggref->args) != 1)
+		return aggfn_cat;
+	tle = linitial(aggref->args);
+	Assert(IsA(tle, TargetEntry));
+	typmod = exprTypmod((Node *) tle->expr);
+	if (typmod < (int32) VARHDRSZ)
+		return aggfn_cat;
+	precision = ((typmod - VARHDRSZ) >> 16) & 0xffff;
+	scale     = ((typmod - VARHDRSZ) & 0xffff);
+	if (precision > NUMERIC_FIXED_MAX_PRECISION || scale > precision)
+		return aggfn_cat;
+
+	for (i=0; i < lengthof(aggfunc_fixed_catalog); i++)
+	{
+		aggfunc_catalog_t  *catalog = &aggfunc_fixed_catalog[i];
+
+		if (strcmp(catalog->aggfn_name, aggfn_cat->aggfn_name) == 0)
+		{
+			*p_scale = scale;
+			return catalog;
+		}
+	}
+	return aggfn_cat;
+}
+
+/*
+ * List of supported aggregate functions on float2
+ *
+ * float2 is not a built-in data type, so its OID is not a constant.
+ * aggfn_argtypes is InvalidOid here, and aggfunc_lookup_by_oid() picks
+ * up the entries if the argument is float2. Device reads the half-precision
+ * values, then accumulates them in float8.
+ */
+static aggfunc_catalog_t  aggfunc_float2_catalog[] = {
+	/* AVG(X) = EX_AVG(NROWS(), PSUM(X)) */
+	{ "avg",    1, {InvalidOid},
+	  "s:favg",     FLOAT8ARRAYOID,
+	  "s:pavg", 2, {INT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM}, 0, INT_MAX
+	},
+	/* SUM(X) = SUM(PSUM(X)) */
+	{ "sum",    1, {InvalidOid},
+	  "c:sum",      FLOAT8OID,
+	  "varref", 1, {FLOAT8OID},
+	  {ALTFUNC_EXPR_PSUM}, 0, INT_MAX
+	},
+	/* STDDEV/VARIANCE(X) = EX_XXX(NROWS(),PSUM(X),PSUM(X*X)) */
+	{ "stddev",      1, {InvalidOid},
+	  "s:stddev",        FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
+	{ "stddev_pop",  1, {InvalidOid},
+	  "s:stddev_pop",    FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
+	{ "stddev_samp", 1, {InvalidOid},
+	  "s:stddev_samp",   FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
+	{ "variance",    1, {InvalidOid},
+	  "s:variance",      FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
+	{ "var_pop",     1, {InvalidOid},
+	  "s:var_pop",       FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
+	{ "var_samp",    1, {InvalidOid},
+	  "s:var_samp",      FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 };
 
 static const aggfunc_catalog_t *
@@ -882,6 +1102,23 @@ aggfunc_lookup_by_oid(Oid aggfnoid)
 		elog(ERROR, "cache lookup failed for function %u", aggfnoid);
 	proform = (Form_pg_proc) GETSTRUCT(htup);
 
+	if (proform->pronargs == 1 &&
+		proform->proargtypes.values[0] == get_float2_type_oid(true))
+	{
+		for (i=0; i < lengthof(aggfunc_float2_catalog); i++)
+		{
+			aggfunc_catalog_t  *catalog = &aggfunc_float2_catalog[i];
+
+			if (strcmp(catalog->aggfn_name, NameStr(proform->proname)) == 0)
+			{
+				ReleaseSysCache(htup);
+				return catalog;
+			}
+		}
+		ReleaseSysCache(htup);
+		return NULL;
+	}
+
 	for (i=0; i < lengthof(aggfunc_catalog); i++)
 	{
 		aggfunc_catalog_t  *catalog = &aggfunc_catalog[i];
@@ -966,6 +1203,7 @@ cost_gpupreagg(PlannerInfo *root,
 		cost_gpuscan_common(root,
 							input_path->parent,
 							gpa_info->outer_quals,
+							NULL, NIL,
 							parallel_nworkers,
 							&ntuples,
 							&nchunks,
@@ -1113,6 +1351,15 @@ make_gpupreagg_path(PlannerInfo *root,
 	GpuPreAggInfo  *gpa_info = palloc0(sizeof(GpuPreAggInfo));
 	List		   *custom_paths = NIL;
 	int				parallel_nworkers = 0;
+	double			feedback_ngroups;
+
+	/* actual number of groups at the last execution, if any */
+	gpa_info->fingerprint = pgstromPlanFingerprint(root,
+												   input_path->parent->relids,
+												   target_device->exprs);
+	if (pgstromLookupCardinalityFeedback(gpa_info->fingerprint,
+										 &feedback_ngroups, 1))
+		num_groups = Max(feedback_ngroups, 1.0);
 
 	/* obviously, not suitable for GpuPreAgg */
 	if (num_groups < 1.0 || num_groups > (double)INT_MAX)
@@ -1175,8 +1422,10 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 	Path		   *final_path;
 	Path		   *sort_path;
 	Bitmapset	   *pfunc_bitmap;
+	List		   *distinct_keys;
 	Node		   *havingQual;
 	double			num_groups;
+	double			num_device_groups;
 	bool			can_sort;
 	bool			can_hash;
 	bool			can_pullup_outerscan = true;
@@ -1190,6 +1439,7 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 									 target_device,
 									 input_path->pathtarget,
 									 &pfunc_bitmap,
+									 &distinct_keys,
 									 &havingQual,
 									 &can_pullup_outerscan))
 		return;
@@ -1231,8 +1481,11 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 		get_agg_clause_costs(root, havingQual,
 							 AGGSPLIT_SIMPLE, &agg_final_costs);
 	}
-	/* GpuPreAgg does not support ordered aggregation */
-	if (agg_final_costs.numOrderedAggs > 0)
+	/*
+	 * GpuPreAgg does not support ordered aggregation, except for DISTINCT
+	 * aggregates whose arguments are added to the device grouping keys.
+	 */
+	if (agg_final_costs.numOrderedAggs > 0 && distinct_keys == NIL)
 		return;
 
 	/* Estimated number of groups */
@@ -1245,6 +1498,21 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 		num_groups = pathnode->rows;
 	}
 
+	/* device side groups by (grouping-keys, distinct-keys) */
+	if (distinct_keys == NIL)
+		num_device_groups = num_groups;
+	else
+	{
+		List   *group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+													  parse->targetList);
+
+		num_device_groups = estimate_num_groups(root,
+												list_concat(group_exprs,
+															distinct_keys),
+												input_path->rows,
+												NULL);
+	}
+
 	/*
 	 * construction of GpuPreAgg pathnode on top of the cheapest total
 	 * cost pathnode (partial aggregation)
@@ -1254,7 +1522,7 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 								target_device,
 								pfunc_bitmap,
 								input_path,
-								num_groups,
+								num_device_groups,
 								can_pullup_outerscan);
 	if (!cpath)
 		return;
@@ -1796,6 +2064,57 @@ make_altfunc_psum_expr(Aggref *aggref, const char *func_name, Oid psum_typeoid)
 	return make_altfunc_simple_expr(func_name, expr);
 }
 
+/*
+ * make_altfunc_psum_fixed_expr - constructor of a PSUM reference on the
+ * upper or lower bits of the scaled fixed-point numeric
+ */
+static FuncExpr *
+make_altfunc_psum_fixed_expr(Aggref *aggref, const char *func_name,
+							 int scale)
+{
+	Oid				namespace_oid = get_namespace_oid("pgstrom", false);
+	Oid				func_argtypes_oid[2];
+	oidvector	   *func_argtypes;
+	Oid				func_oid;
+	TargetEntry	   *tle;
+	Expr		   *expr;
+
+	Assert(list_length(aggref->args) == 1);
+	tle = linitial(aggref->args);
+	Assert(IsA(tle, TargetEntry) &&
+		   exprType((Node *)tle->expr) == NUMERICOID);
+
+	/* lookup numeric_fixed_XX functions */
+	func_argtypes_oid[0] = NUMERICOID;
+	func_argtypes_oid[1] = INT4OID;
+	func_argtypes = buildoidvector(func_argtypes_oid, 2);
+	func_oid = GetSysCacheOid3(PROCNAMEARGSNSP,
+							   PointerGetDatum(func_name),
+							   PointerGetDatum(func_argtypes),
+							   ObjectIdGetDatum(namespace_oid));
+	if (!OidIsValid(func_oid))
+		elog(ERROR, "alternative function not found: %s",
+			 funcname_signature_string(func_name, 2, NIL, func_argtypes_oid));
+
+	expr = (Expr *)makeFuncExpr(func_oid,
+								INT8OID,
+								list_make2(copyObject(tle->expr),
+										   makeConst(INT4OID,
+													 -1,
+													 InvalidOid,
+													 sizeof(int32),
+													 Int32GetDatum(scale),
+													 false,
+													 true)),
+								InvalidOid,
+								InvalidOid,
+								COERCE_EXPLICIT_CALL);
+	/* make conditional if aggref has any filter */
+	expr = make_expr_conditional(expr, aggref->aggfilter, true);
+
+	return make_altfunc_simple_expr("psum", expr);
+}
+
 /*
  * make_altfunc_pcov_xy - constructor of a co-variance arguments
  */
@@ -1846,6 +2165,95 @@ make_altfunc_pcov_xy(Aggref *aggref, const char *func_name)
 						COERCE_EXPLICIT_CALL);
 }
 
+/*
+ * make_altfunc_hll_register - constructor of a PMAX reference on the
+ * regidx'th register of HyperLogLog sketch
+ */
+static FuncExpr *
+make_altfunc_hll_register(Aggref *aggref, int regidx)
+{
+	Oid				namespace_oid = get_namespace_oid("pgstrom", false);
+	Oid				func_argtypes_oid[2];
+	oidvector	   *func_argtypes;
+	Oid				func_oid;
+	TargetEntry	   *tle;
+	Expr		   *expr;
+
+	Assert(list_length(aggref->args) == 1);
+	tle = linitial(aggref->args);
+	Assert(IsA(tle, TargetEntry));
+
+	/* lookup hll_register function */
+	func_argtypes_oid[0] = INT8OID;
+	func_argtypes_oid[1] = INT4OID;
+	func_argtypes = buildoidvector(func_argtypes_oid, 2);
+	func_oid = GetSysCacheOid3(PROCNAMEARGSNSP,
+							   PointerGetDatum("hll_register"),
+							   PointerGetDatum(func_argtypes),
+							   ObjectIdGetDatum(namespace_oid));
+	if (!OidIsValid(func_oid))
+		elog(ERROR, "alternative function not found: %s",
+			 funcname_signature_string("hll_register", 2, NIL,
+									   func_argtypes_oid));
+
+	expr = (Expr *)makeFuncExpr(func_oid,
+								INT2OID,
+								list_make2(make_expr_typecast(tle->expr,
+															  INT8OID),
+										   makeConst(INT4OID,
+													 -1,
+													 InvalidOid,
+													 sizeof(int32),
+													 Int32GetDatum(regidx),
+													 false,
+													 true)),
+								InvalidOid,
+								InvalidOid,
+								COERCE_EXPLICIT_CALL);
+	/* 0 is identical to an empty register */
+	expr = make_expr_conditional(expr, aggref->aggfilter, true);
+
+	return make_altfunc_simple_expr("pmax", expr);
+}
+
+/*
+ * add_altfunc_device_column
+ *
+ * It appends the partial function on the target_device, if its arguments
+ * are device executable.
+ */
+static bool
+add_altfunc_device_column(Aggref *aggref, FuncExpr *pfunc,
+						  PathTarget *target_device,
+						  PathTarget *target_input,
+						  Bitmapset **p_pfunc_bitmap)
+{
+	/* device executable? */
+	if (pfunc->args)
+	{
+		Node   *temp = replace_expression_by_outerref((Node *)pfunc->args,
+													  target_input);
+		if (!pgstrom_device_expression((Expr *) temp))
+		{
+			elog(DEBUG2, "argument of %s is not device executable: %s",
+				 format_procedure(aggref->aggfnoid),
+				 nodeToString(aggref));
+			return false;
+		}
+	}
+	/*
+	 * Add partial-aggregate function expression
+	 * Also see add_new_column_to_pathtarget().
+	 */
+	if (!list_member(target_device->exprs, pfunc))
+	{
+		add_column_to_pathtarget(target_device, (Expr *)pfunc, 0);
+		*p_pfunc_bitmap = bms_add_member(*p_pfunc_bitmap,
+										 list_length(target_device->exprs) - 1);
+	}
+	return true;
+}
+
 /*
  * make_alternative_aggref
  *
@@ -1871,6 +2279,7 @@ make_alternative_aggref(Aggref *aggref,
 	int			i;
 	Form_pg_proc proc_form;
 	Form_pg_aggregate agg_form;
+	int			fixed_scale = -1;
 
 	if (aggref->aggorder || aggref->aggdistinct)
 	{
@@ -1895,6 +2304,9 @@ make_alternative_aggref(Aggref *aggref,
 			 format_procedure(aggref->aggfnoid));
 		return NULL;
 	}
+	/* numeric with bounded precision can run on fixed-point */
+	aggfn_cat = aggfunc_lookup_fixed_numeric(aggfn_cat, aggref,
+											 &fixed_scale);
 	/* sanity checks */
 	Assert(aggref->aggkind == AGGKIND_NORMAL &&
 		   !aggref->aggvariadic &&
@@ -1941,33 +2353,63 @@ make_alternative_aggref(Aggref *aggref,
 			case ALTFUNC_EXPR_PCOV_XY:  /* PCOV_XY(X,Y) */
 				pfunc = make_altfunc_pcov_xy(aggref, "pcov_xy");
 				break;
+			case ALTFUNC_EXPR_PSUM_FIXED_HI:	/* PSUM(HI(X)) */
+				pfunc = make_altfunc_psum_fixed_expr(aggref,
+													 "numeric_fixed_hi",
+													 fixed_scale);
+				break;
+			case ALTFUNC_EXPR_PSUM_FIXED_LO:	/* PSUM(LO(X)) */
+				pfunc = make_altfunc_psum_fixed_expr(aggref,
+													 "numeric_fixed_lo",
+													 fixed_scale);
+				break;
+			case ALTFUNC_CONST_SCALE:
+				/* only host side partial function references the scale */
+				Assert(argtype == INT4OID && fixed_scale >= 0);
+				altfunc_args = lappend(altfunc_args,
+									   makeConst(INT4OID,
+												 -1,
+												 InvalidOid,
+												 sizeof(int32),
+												 Int32GetDatum(fixed_scale),
+												 false,
+												 true));
+				continue;
+			case ALTFUNC_EXPR_HLL_SKETCH:
+				{
+					/* each register is reduced by the device, individually */
+					ArrayExpr  *hll_array = makeNode(ArrayExpr);
+					int			j;
+
+					Assert(argtype == INT2ARRAYOID);
+					for (j=0; j < HLL_NUM_REGISTERS; j++)
+					{
+						pfunc = make_altfunc_hll_register(aggref, j);
+						if (!add_altfunc_device_column(aggref, pfunc,
+													   target_device,
+													   target_input,
+													   p_pfunc_bitmap))
+							return NULL;
+						hll_array->elements = lappend(hll_array->elements,
+													  pfunc);
+					}
+					hll_array->array_typeid = INT2ARRAYOID;
+					hll_array->array_collid = InvalidOid;
+					hll_array->element_typeid = INT2OID;
+					hll_array->multidims = false;
+					hll_array->location = -1;
+					altfunc_args = lappend(altfunc_args, hll_array);
+				}
+				continue;
 			default:
 				elog(ERROR, "unknown alternative function code: %d", action);
 				break;
 		}
-		/* device executable? */
-		if (pfunc->args)
-		{
-			Node   *temp = replace_expression_by_outerref((Node *)pfunc->args,
-														  target_input);
-			if (!pgstrom_device_expression((Expr *) temp))
-			{
-				elog(DEBUG2, "argument of %s is not device executable: %s",
-					 format_procedure(aggref->aggfnoid),
-					 nodeToString(aggref));
-				return NULL;
-			}
-		}
-		/*
-		 * Add partial-aggregate function expression
-		 * Also see add_new_column_to_pathtarget().
-		 */
-		if (!list_member(target_device->exprs, pfunc))
-		{
-			add_column_to_pathtarget(target_device, (Expr *)pfunc, 0);
-			*p_pfunc_bitmap = bms_add_member(*p_pfunc_bitmap,
-											 list_length(target_device->exprs) - 1);
-		}
+		if (!add_altfunc_device_column(aggref, pfunc,
+									   target_device,
+									   target_input,
+									   p_pfunc_bitmap))
+			return NULL;
 		/* append to the argument list */
 		altfunc_args = lappend(altfunc_args, (Expr *)pfunc);
 	}
@@ -2079,8 +2521,76 @@ typedef struct
 	PathTarget *target_device;
 	PathTarget *target_input;
 	Bitmapset  *pfunc_bitmap;
+	List	   *distinct_keys;
+	Index		distinct_sortgroupref;
 } gpupreagg_build_path_target_context;
 
+/*
+ * make_distinct_aggref
+ *
+ * It handles aggregate with DISTINCT by the two-phase grouping. The
+ * argument of the aggregate is added to the grouping-keys on the device,
+ * so GpuPreAgg eliminates duplicated (grouping-keys, X) at first, then
+ * the final aggregation runs the original Aggref on the reduced rows.
+ * Other partial aggregates are still valid on the finer groups, because
+ * the final aggregation combines them by the original grouping-keys.
+ */
+static Node *
+make_distinct_aggref(Aggref *aggref,
+					 gpupreagg_build_path_target_context *con)
+{
+	PathTarget *target_device = con->target_device;
+	TargetEntry *tle;
+	ListCell   *lc;
+	int			j;
+
+	if (!enable_gpupreagg_distinct ||
+		aggref->aggorder != NIL ||
+		aggref->aggfilter != NULL ||
+		list_length(aggref->args) != 1 ||
+		con->parse->groupingSets != NIL)
+	{
+		elog(DEBUG2, "Aggregate with DISTINCT is not supported: %s",
+			 nodeToString(aggref));
+		return NULL;
+	}
+	tle = linitial(aggref->args);
+	Assert(IsA(tle, TargetEntry));
+
+	/* distinct-key should be on the input items, like grouping-keys */
+	j = 0;
+	foreach (lc, target_device->exprs)
+	{
+		if (equal(tle->expr, lfirst(lc)))
+			break;
+		j++;
+	}
+	if (!lc || !pgstrom_device_expression(tle->expr))
+	{
+		elog(DEBUG2, "argument of DISTINCT is not a device grouping-key: %s",
+			 nodeToString(aggref));
+		return NULL;
+	}
+	if (target_device->sortgrouprefs[j] == 0)
+	{
+		if (con->distinct_sortgroupref == 0)
+		{
+			Index	max_ref = 0;
+
+			foreach (lc, con->parse->targetList)
+				max_ref = Max(max_ref,
+							  ((TargetEntry *)lfirst(lc))->ressortgroupref);
+			con->distinct_sortgroupref = max_ref;
+		}
+		target_device->sortgrouprefs[j] = ++con->distinct_sortgroupref;
+		con->distinct_keys = lappend(con->distinct_keys, tle->expr);
+	}
+	add_new_column_to_pathtarget(con->target_partial,
+								 copyObject(tle->expr));
+	/* final aggregation runs the original one */
+	return copyObject(aggref);
+}
+
 static Node *
 replace_expression_by_altfunc(Node *node,
 							  gpupreagg_build_path_target_context *con)
@@ -2092,11 +2602,16 @@ replace_expression_by_altfunc(Node *node,
 		return NULL;
 	if (IsA(node, Aggref))
 	{
-		Node   *aggfn = make_alternative_aggref((Aggref *)node,
-												con->target_partial,
-												con->target_device,
-												con->target_input,
-												&con->pfunc_bitmap);
+		Node   *aggfn;
+
+		if (((Aggref *)node)->aggdistinct != NIL)
+			aggfn = make_distinct_aggref((Aggref *)node, con);
+		else
+			aggfn = make_alternative_aggref((Aggref *)node,
+											con->target_partial,
+											con->target_device,
+											con->target_input,
+											&con->pfunc_bitmap);
 		if (!aggfn)
 			con->device_executable = false;
 		return aggfn;
@@ -2135,6 +2650,7 @@ gpupreagg_build_path_target(PlannerInfo *root,			/* in */
 							PathTarget *target_device,	/* out */
 							PathTarget *target_input,	/* in */
 							Bitmapset **p_pfunc_bitmap,	/* out */
+							List **p_distinct_keys,		/* out */
 							Node **p_havingQual,		/* out */
 							bool *p_can_pullup_outerscan) /* out */
 {
@@ -2265,6 +2781,7 @@ gpupreagg_build_path_target(PlannerInfo *root,			/* in */
 	set_pathtarget_cost_width(root, target_partial);
 	set_pathtarget_cost_width(root, target_device);
 	*p_pfunc_bitmap = con.pfunc_bitmap;
+	*p_distinct_keys = con.distinct_keys;
 
 	return true;
 }
@@ -2567,6 +3084,26 @@ make_tlist_device_projection(List *tlist_dev,
 	return tlist_dev_alt;
 }
 
+/*
+ * gpupreagg_key_is_dictionary
+ *
+ * It checks whether the grouping key can be encoded by the per-chunk
+ * dictionary. Equality of the key has to be identical to the binary
+ * comparison of the datum, so bpchar is not a candidate.
+ */
+static bool
+gpupreagg_key_is_dictionary(TargetEntry *tle)
+{
+	Oid		type_oid = exprType((Node *)tle->expr);
+
+	if (!enable_gpupreagg_dictionary ||
+		tle->resjunk || !tle->ressortgroupref)
+		return false;
+	return (type_oid == TEXTOID ||
+			type_oid == VARCHAROID ||
+			type_oid == BYTEAOID);
+}
+
 /*
  * gpupreagg_codegen_projection_XXXX - code generator for
  *
@@ -2749,7 +3286,11 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 	StringInfoData	temp;
 	Relation		outer_rel = NULL;
 	TupleDesc		outer_desc = NULL;
-	ListCell	   *lc;
+	List		   *tle_list = NIL;
+	List		   *expr_list = NIL;
+	List		   *null_const_list = NIL;
+	List		   *colvec_list = NIL;
+	ListCell	   *lc, *lc1, *lc2, *lc3;
 	int				i, k, nattrs;
 
 	initStringInfo(&decl);
@@ -2862,9 +3403,10 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 					/* column */
 					appendStringInfo(
 						&cbody,
-						"  addr = kern_get_datum_column(kds_src,%d,src_index);\n"
+						"  addr = kern_colvec_datum(&gpupreagg_projection_cvec[%d],src_index);\n"
 						"  KVAR_%u = pg_%s_datum_ref(kcxt,addr);\n",
-						i-1, i, dtype->type_name);
+						list_length(colvec_list), i, dtype->type_name);
+					colvec_list = lappend_int(colvec_list, i-1);
 					addr_is_valid = true;
 				}
 
@@ -2912,10 +3454,14 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 
 					/* column */
 					if (!addr_is_valid)
+					{
 						appendStringInfo(
 							&cbody,
-							"  addr = kern_get_datum_column(kds_src,%d,src_index);\n",
-							i-1);
+							"  addr = kern_colvec_datum(&gpupreagg_projection_cvec[%d],src_index);\n",
+							list_length(colvec_list));
+						colvec_list = lappend_int(colvec_list, i-1);
+						addr_is_valid = true;
+					}
 					appendStringInfo(
 						&cbody,
 						"  if (!addr)\n"
@@ -2943,16 +3489,13 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 	}
 
 	/*
-	 * Execute expression and store the value on dst_values/dst_isnull
+	 * Pick up expressions to be evaluated; grouping-keys and arguments of
+	 * the partial aggregate functions
 	 */
-	resetStringInfo(&temp);
 	foreach (lc, tlist_alt)
 	{
 		TargetEntry	   *tle = lfirst(lc);
 		Expr		   *expr;
-		devtype_info   *dtype;
-		const char	   *null_const_value = NULL;
-		const char	   *projection_label = NULL;
 
 		if (tle->resjunk)
 			continue;
@@ -2961,21 +3504,51 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 		if (is_altfunc_expression((Node *)tle->expr))
 		{
 			FuncExpr   *f = (FuncExpr *) tle->expr;
+			const char *null_const_value = NULL;
 
 			expr = codegen_projection_partial_funcion(f,
 													  context,
 													  &null_const_value);
-			projection_label = "aggfunc-arg";
+			null_const_list = lappend(null_const_list,
+									  (char *) null_const_value);
 		}
 		else if (tle->ressortgroupref)
 		{
 			expr = tle->expr;
-			null_const_value = "0";
-			projection_label = "grouping-key";
+			null_const_list = lappend(null_const_list, "0");
 		}
 		else
 			elog(ERROR, "Bug? unexpected expression: %s",
                  nodeToString(tle->expr));
+		tle_list = lappend(tle_list, tle);
+		expr_list = lappend(expr_list, expr);
+	}
+
+	/*
+	 * Sub-expressions commonly used by grouping-keys and aggregate function
+	 * arguments (like extract(epoch from a time-bucket column)) are
+	 * evaluated only once per row.
+	 */
+	resetStringInfo(&temp);
+	pgstrom_codegen_common_subexprs(&decl, &temp, expr_list, context);
+
+	/*
+	 * Execute expression and store the value on dst_values/dst_isnull
+	 */
+	forthree (lc1, tle_list,
+			  lc2, expr_list,
+			  lc3, null_const_list)
+	{
+		TargetEntry	   *tle = lfirst(lc1);
+		Expr		   *expr = lfirst(lc2);
+		const char	   *null_const_value = lfirst(lc3);
+		const char	   *projection_label;
+		devtype_info   *dtype;
+
+		if (is_altfunc_expression((Node *)tle->expr))
+			projection_label = "aggfunc-arg";
+		else
+			projection_label = "grouping-key";
 
 		dtype = pgstrom_devtype_lookup_and_track(exprType((Node *)expr),
 												 context);
@@ -3012,9 +3585,28 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 				dtype->type_name,
 				tle->resno-1,
 				dtype->type_name);
-		}
-
-		if (null_const_value)
+			/*
+			 * varlena datum on the per-thread buffer of kern_context is
+			 * not valid after the projection, unless it is copied to the
+			 * dictionary soon.
+			 */
+			if (gpupreagg_key_is_dictionary(tle))
+				appendStringInfoString(
+					&temp,
+					"#ifndef GPUPREAGG_DICTIONARY_ENCODE\n");
+			appendStringInfo(
+				&temp,
+				"  kern_context_check_varlena(kcxt, temp.%s_v.isnull,\n"
+				"                             temp.%s_v.value);\n",
+				dtype->type_name,
+				dtype->type_name);
+			if (gpupreagg_key_is_dictionary(tle))
+				appendStringInfoString(
+					&temp,
+					"#endif /* GPUPREAGG_DICTIONARY_ENCODE */\n");
+		}
+
+		if (null_const_value)
 		{
 			appendStringInfo(
 				&temp,
@@ -3027,11 +3619,14 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 	appendStringInfoString(&tbody, temp.data);
 	appendStringInfoString(&sbody, temp.data);
 	appendStringInfoString(&cbody, temp.data);
+	context->cse_exprs = NIL;
 
 	/* const/params */
 	pgstrom_codegen_param_declarations(&decl, context);
 
 	/* writeout kernel functions */
+	pgstrom_codegen_column_vectors(kern, "gpupreagg_projection",
+								   colvec_list);
 	appendStringInfo(
 		kern,
 		"STATIC_FUNCTION(void)\n"
@@ -3078,6 +3673,65 @@ gpupreagg_codegen_projection_row(StringInfo kern,
 	pfree(sbody.data);
 	pfree(cbody.data);
 	pfree(temp.data);
+	list_free(colvec_list);
+}
+
+/*
+ * gpupreagg_codegen_dictionary_encode - code generator for
+ *
+ * STATIC_FUNCTION(void)
+ * gpupreagg_dictionary_encode(kern_context *kcxt,
+ *                             kern_gpupreagg_dict *kdict,
+ *                             const cl_uint *crc32_table,
+ *                             cl_char *slot_isnull,
+ *                             Datum *slot_values);
+ */
+static int
+gpupreagg_codegen_dictionary_encode(StringInfo kern,
+									codegen_context *context,
+									List *tlist_dev)
+{
+	StringInfoData	body;
+	ListCell	   *lc;
+	int				num_dict_keys = 0;
+
+	initStringInfo(&body);
+	foreach (lc, tlist_dev)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+
+		if (!gpupreagg_key_is_dictionary(tle))
+			continue;
+		appendStringInfo(
+			&body,
+			"  if (!slot_isnull[%d])\n"
+			"    slot_values[%d] = gpupreagg_dictionary_lookup(kcxt, kdict, crc32_table, slot_values[%d]);\n",
+			tle->resno - 1,
+			tle->resno - 1,
+			tle->resno - 1);
+		num_dict_keys++;
+	}
+
+	if (num_dict_keys > 0)
+	{
+		appendStringInfo(
+			kern,
+			"#ifdef GPUPREAGG_DICTIONARY_ENCODE\n"
+			"STATIC_FUNCTION(void)\n"
+			"gpupreagg_dictionary_encode(kern_context *kcxt,\n"
+			"                            kern_gpupreagg_dict *kdict,\n"
+			"                            const cl_uint *crc32_table,\n"
+			"                            cl_char *slot_isnull,\n"
+			"                            Datum *slot_values)\n"
+			"{\n"
+			"%s"
+			"}\n"
+			"#endif /* GPUPREAGG_DICTIONARY_ENCODE */\n\n",
+			body.data);
+	}
+	pfree(body.data);
+
+	return num_dict_keys;
 }
 
 /*
@@ -3089,11 +3743,15 @@ gpupreagg_codegen_projection_row(StringInfo kern,
  *                     cl_uint hash_value,
  *                     cl_bool *slot_isnull,
  *                     Datum *slot_values);
+ *
+ * @func_name allows other logic (like GpuWindowAgg) to generate the same
+ * function for its own keys.
  */
-static void
+void
 gpupreagg_codegen_hashvalue(StringInfo kern,
 							codegen_context *context,
-							List *tlist_dev)
+							List *tlist_dev,
+							const char *func_name)
 {
 	StringInfoData	decl;
 	StringInfoData	load;
@@ -3108,12 +3766,13 @@ gpupreagg_codegen_hashvalue(StringInfo kern,
 	appendStringInfo(
 		&decl,
 		"STATIC_FUNCTION(cl_uint)\n"
-		"gpupreagg_hashvalue(kern_context *kcxt,\n"
-		"                    cl_uint *crc32_table,\n"
-		"                    cl_uint hash_value,\n"
-		"                    cl_bool *slot_isnull,\n"
-		"                    Datum *slot_values)\n"
-		"{\n");
+		"%s(kern_context *kcxt,\n"
+		"    cl_uint *crc32_table,\n"
+		"    cl_uint hash_value,\n"
+		"    cl_bool *slot_isnull,\n"
+		"    Datum *slot_values)\n"
+		"{\n",
+		func_name);
 
 	foreach (lc, tlist_dev)
 	{
@@ -3150,10 +3809,21 @@ gpupreagg_codegen_hashvalue(StringInfo kern,
 				tle->resno - 1, tle->resno - 1,
 				tle->resno, dtype->type_name);
 		/* compute crc32 value */
-		appendStringInfo(
-			&body,
-			"  hash_value = pg_%s_comp_crc32(crc32_table, hash_value, keyval_%u);\n",
-			dtype->type_name, tle->resno);
+		if (gpupreagg_key_is_dictionary(tle))
+			appendStringInfo(
+				&body,
+				"#ifdef GPUPREAGG_DICTIONARY_ENCODE\n"
+				"  hash_value = gpupreagg_dictionary_comp_crc32(crc32_table, hash_value, keyval_%u.isnull, keyval_%u.value);\n"
+				"#else\n"
+				"  hash_value = pg_%s_comp_crc32(crc32_table, hash_value, keyval_%u);\n"
+				"#endif\n",
+				tle->resno, tle->resno,
+				dtype->type_name, tle->resno);
+		else
+			appendStringInfo(
+				&body,
+				"  hash_value = pg_%s_comp_crc32(crc32_table, hash_value, keyval_%u);\n",
+				dtype->type_name, tle->resno);
 	}
 	appendStringInfoString(
 		&decl,
@@ -3164,6 +3834,7 @@ gpupreagg_codegen_hashvalue(StringInfo kern,
 
 	appendStringInfo(kern,
 					 "%s\n"
+					 "  kern_context_reset_varlena(kcxt);\n"
 					 "%s\n"
 					 "%s\n"
 					 "  return hash_value;\n"
@@ -3184,11 +3855,14 @@ gpupreagg_codegen_hashvalue(StringInfo kern,
  * gpupreagg_keymatch(kern_context *kcxt,
  *                    kern_data_store *x_kds, size_t x_index,
  *                    kern_data_store *y_kds, size_t y_index);
+ *
+ * As like gpupreagg_codegen_hashvalue, @func_name is the name of function.
  */
-static void
+void
 gpupreagg_codegen_keymatch(StringInfo kern,
 						   codegen_context *context,
-						   List *tlist_dev)
+						   List *tlist_dev,
+						   const char *func_name)
 {
 	StringInfoData	decl;
 	StringInfoData	body;
@@ -3198,17 +3872,19 @@ gpupreagg_codegen_keymatch(StringInfo kern,
 	initStringInfo(&body);
 	context->param_refs = NULL;
 
-	appendStringInfoString(
+	appendStringInfo(
 		kern,
 		"STATIC_FUNCTION(cl_bool)\n"
-		"gpupreagg_keymatch(kern_context *kcxt,\n"
-		"                   kern_data_store *x_kds, size_t x_index,\n"
-		"                   kern_data_store *y_kds, size_t y_index)\n"
+		"%s(kern_context *kcxt,\n"
+		"    kern_data_store *x_kds, size_t x_index,\n"
+		"    kern_data_store *y_kds, size_t y_index)\n"
 		"{\n"
 		"  pg_anytype_t temp_x  __attribute__((unused));\n"
 		"  pg_anytype_t temp_y  __attribute__((unused));\n"
 		"  void        *datum   __attribute__((unused));\n"
-		"\n");
+		"\n"
+		"  kern_context_reset_varlena(kcxt);\n",
+		func_name);
 
 	foreach (lc, tlist_dev)
 	{
@@ -3251,7 +3927,33 @@ gpupreagg_codegen_keymatch(StringInfo kern,
 			"  datum = kern_get_datum_slot(x_kds,%u,x_index);\n"
 			"  temp_x.%s_v = pg_%s_datum_ref(kcxt,datum);\n"
 			"  datum = kern_get_datum_slot(y_kds,%u,y_index);\n"
-			"  temp_y.%s_v = pg_%s_datum_ref(kcxt,datum);\n"
+			"  temp_y.%s_v = pg_%s_datum_ref(kcxt,datum);\n",
+			tle->resno-1,
+			dtype->type_name, dtype->type_name,
+			tle->resno-1,
+			dtype->type_name, dtype->type_name);
+		/*
+		 * Dictionary encoded keys on the same kds_slot share the pointer
+		 * if and only if they are identical.
+		 */
+		if (gpupreagg_key_is_dictionary(tle))
+			appendStringInfo(
+				kern,
+				"#ifdef GPUPREAGG_DICTIONARY_ENCODE\n"
+				"  if (x_kds == y_kds)\n"
+				"  {\n"
+				"    if (temp_x.%s_v.isnull != temp_y.%s_v.isnull ||\n"
+				"        (!temp_x.%s_v.isnull &&\n"
+				"         temp_x.%s_v.value != temp_y.%s_v.value))\n"
+				"      return false;\n"
+				"  }\n"
+				"  else\n"
+				"#endif\n",
+				dtype->type_name, dtype->type_name,
+				dtype->type_name,
+				dtype->type_name, dtype->type_name);
+		appendStringInfo(
+			kern,
 			"  if (!temp_x.%s_v.isnull && !temp_y.%s_v.isnull)\n"
 			"  {\n"
 			"    if (!EVAL(pgfn_%s(kcxt, temp_x.%s_v, temp_y.%s_v)))\n"
@@ -3261,10 +3963,6 @@ gpupreagg_codegen_keymatch(StringInfo kern,
 			"           (!temp_x.%s_v.isnull && temp_y.%s_v.isnull))\n"
 			"      return false;\n"
 			"\n",
-			tle->resno-1,
-			dtype->type_name, dtype->type_name,
-			tle->resno-1,
-			dtype->type_name, dtype->type_name,
 			dtype->type_name, dtype->type_name,
 			dfunc->func_devname, darg1->type_name, darg2->type_name,
 			dtype->type_name, dtype->type_name,
@@ -3571,9 +4269,14 @@ gpupreagg_codegen(codegen_context *context,
 
 	gpa_info->tlist_fallback = tlist_alt;
 	/* gpupreagg_hashvalue */
-	gpupreagg_codegen_hashvalue(&body, context, tlist_dev);
+	gpupreagg_codegen_hashvalue(&body, context, tlist_dev,
+								"gpupreagg_hashvalue");
 	/* gpupreagg_keymatch */
-	gpupreagg_codegen_keymatch(&body, context, tlist_dev);
+	gpupreagg_codegen_keymatch(&body, context, tlist_dev,
+							   "gpupreagg_keymatch");
+	/* gpupreagg_dictionary_encode (optional) */
+	gpa_info->num_dict_keys =
+		gpupreagg_codegen_dictionary_encode(&body, context, tlist_dev);
 	/* gpupreagg_local_calc */
 	gpupreagg_codegen_local_calc(&body, context, tlist_dev);
 	/* gpupreagg_global_calc */
@@ -3658,7 +4361,21 @@ assign_gpupreagg_session_info(StringInfo buf, GpuTaskState *gts)
 	if (gpas->outer_quals)
 		appendStringInfo(buf, "#define GPUPREAGG_HAS_OUTER_QUALS 1\n");
 	if (gpas->combined_gpujoin)
+	{
 		appendStringInfo(buf, "#define GPUPREAGG_COMBINED_JOIN 1\n");
+		/*
+		 * Without grouping keys, GpuJoin reduces the result rows on the
+		 * shared memory prior to materialization on the kds_slot.
+		 */
+		if (gpas->num_group_keys == 0)
+			appendStringInfo(buf, "#define GPUPREAGG_COMBINED_NOGROUP 1\n");
+	}
+	/*
+	 * Dictionary encoding of the grouping keys works on the setup kernels,
+	 * so it is not available when GpuJoin makes the initial projection.
+	 */
+	else if (gpas->num_dict_keys > 0)
+		appendStringInfo(buf, "#define GPUPREAGG_DICTIONARY_ENCODE 1\n");
 }
 
 /*
@@ -3705,10 +4422,13 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 	size_t			length;
 	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
 	bool			has_oid;
+	int				cuda_dindex = -1;
 
 	Assert(scan_rel ? outerPlan(node) == NULL : outerPlan(cscan) != NULL);
 	/* activate a GpuContext for CUDA kernel execution */
-	gpas->gts.gcontext = AllocGpuContext(-1, false);
+	if (scan_rel && !explain_only)
+		cuda_dindex = RelationOptimalGpuForNvmeStrom(scan_rel);
+	gpas->gts.gcontext = AllocGpuContext(cuda_dindex, false);
 	if (!explain_only)
 		ActivateGpuContext(gpas->gts.gcontext);
 
@@ -3724,9 +4444,13 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 	gpas->gts.cb_next_tuple      = gpupreagg_next_tuple;
 	gpas->gts.cb_process_task    = gpupreagg_process_task;
 	gpas->gts.cb_release_task    = gpupreagg_release_task;
+	gpas->gts.cb_jit_fallback    = gpupreagg_jit_fallback;
 	gpas->gts.outer_nrows_per_block = gpa_info->outer_nrows_per_block;
+	/* direct scan can run on the device tier image of ccache */
+	gpas->gts.ccache_device_tier = (scan_rel != NULL);
 
 	gpas->num_group_keys     = gpa_info->num_group_keys;
+	gpas->num_dict_keys      = gpa_info->num_dict_keys;
 
 	/* initialization of the outer relation */
 	if (outerPlan(cscan))
@@ -3738,10 +4462,14 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 		outer_ps = ExecInitNode(outerPlan(cscan), estate, eflags);
 		if (enable_pullup_outer_join &&
 			pgstrom_planstate_is_gpujoin(outer_ps) &&
+			!gpujoinHasPartitionedInner((GpuTaskState *) outer_ps) &&
 			!outer_ps->ps_ProjInfo)
 		{
 			gpas->combined_gpujoin = true;
 		}
+		else
+			gpas->gts.outer_bulkexec = pgstromBulkExecEnabled(&gpas->gts,
+															  outer_ps);
 		outerPlanState(gpas) = outer_ps;
 		/* GpuPreAgg don't need re-initialization of projection info */
 		outer_tupdesc = outer_ps->ps_ResultTupleSlot->tts_tupleDescriptor;
@@ -3758,6 +4486,8 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 #else
 		gpas->outer_quals = outer_quals_state;
 #endif
+		pgstrom_ccache_init_zonemap(&gpas->gts,
+									make_ands_implicit(gpa_info->outer_quals));
 		outer_tupdesc = RelationGetDescr(scan_rel);
 	}
 
@@ -3806,6 +4536,18 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
     gpas->plan_nrows_in		= gpa_info->outer_nrows;
 	gpas->plan_ngroups		= gpa_info->plan_ngroups;
 	gpas->plan_extra_sz		= gpa_info->plan_extra_sz;
+	gpas->fingerprint		= gpa_info->fingerprint;
+	/* prefer the actual number of groups, if executed after planning */
+	if (gpas->num_group_keys > 0)
+	{
+		double	feedback_ngroups;
+
+		if (pgstromLookupCardinalityFeedback(gpas->fingerprint,
+											 &feedback_ngroups, 1))
+			gpas->plan_ngroups = Max(feedback_ngroups, 1.0);
+	}
+	pthreadMutexInit(&gpas->f_mutex, 0);
+	pthreadCondInit(&gpas->f_cond);
 
 	/* Get CUDA program and async build if any */
 	if (gpas->combined_gpujoin)
@@ -3891,6 +4633,31 @@ ExecEndGpuPreAgg(CustomScanState *node)
 		PDS_release(gpas->pds_final);
 	if (gpas->m_fhash)
 		gpuMemFree(gcontext, gpas->m_fhash);
+	if (gpas->f_shared_owner)
+	{
+		gpuMemFree(gcontext, gpas->m_kds_shared);
+		gpuMemFree(gcontext, gpas->m_fhash_shared);
+	}
+	else if (gpas->m_kds_shared)
+	{
+		gpuIpcCloseMemHandle(gcontext, gpas->m_kds_shared);
+		gpuIpcCloseMemHandle(gcontext, gpas->m_fhash_shared);
+	}
+
+	/* record the actual number of groups for the next time */
+	if (!IsParallelWorker() &&
+		gpas->num_group_keys > 0 &&
+		gpas->gts.scan_done &&
+		gpas->gpa_rtstat)
+	{
+		double	actual_ngroups
+			= Max(pg_atomic_read_u64(&gpas->gpa_rtstat->final_nitems_max),
+				  gpas->final_nitems);
+
+		if (actual_ngroups > 0.0)
+			pgstromUpdateCardinalityFeedback(gpas->fingerprint,
+											 &actual_ngroups, 1);
+	}
 
 	/* release any other resources */
 	if (gpas->gpreagg_slot)
@@ -3921,6 +4688,9 @@ ExecReScanGpuPreAgg(CustomScanState *node)
 	pgstromRescanGpuTaskState(&gpas->gts);
 	/* reset other stuff */
 	gpas->terminator_done = false;
+	gpas->f_shared_attached = false;
+	gpas->f_shared_overflow = false;
+	gpas->final_nitems = 0;
 }
 
 /*
@@ -3951,6 +4721,7 @@ ExecGpuPreAggInitDSM(CustomScanState *node,
 	/* allocation of shared state */
 	gpas->gpa_sstate = createGpuPreAggSharedState(gpas, pcxt, coordinate);
 	gpas->gpa_rtstat = &gpas->gpa_sstate->gpa_rtstat;
+	gpupreagg_alloc_shared_final_buffer(gpas);
 	coordinate = (char *)coordinate + gpas->gpa_sstate->ss_length;
 
 	pgstromInitDSMGpuTaskState(&gpas->gts, pcxt, coordinate);
@@ -3986,6 +4757,10 @@ static void
 ExecGpuPreAggReInitializeDSM(CustomScanState *node,
 							 ParallelContext *pcxt, void *coordinate)
 {
+	GpuPreAggState *gpas = (GpuPreAggState *) node;
+
+	if (gpas->f_shared_owner)
+		gpupreagg_reset_shared_final_buffer(gpas);
 	pgstromReInitializeDSMGpuTaskState((GpuTaskState *) node);
 }
 
@@ -3998,6 +4773,8 @@ ExecShutdownGpuPreAgg(CustomScanState *node)
 	GpuPreAggState	   *gpas = (GpuPreAggState *) node;
 	GpuPreAggRuntimeStat *gpa_rtstat_old = gpas->gpa_rtstat;
 
+	/* move the timing statistics from DSM also */
+	pgstromShutdownDSMGpuTaskState(&gpas->gts);
 	if (!gpa_rtstat_old)
 	{
 		/*
@@ -4008,6 +4785,21 @@ ExecShutdownGpuPreAgg(CustomScanState *node)
 		Assert(IsParallelWorker());
 		return;
 	}
+	/*
+	 * Number of rows returned by this process, for the cardinality
+	 * feedback. Each process has its own final buffer unless it is
+	 * shared, so the largest one is close to the number of groups.
+	 */
+	for (;;)
+	{
+		uint64	curval = pg_atomic_read_u64(&gpa_rtstat_old->final_nitems_max);
+
+		if (curval >= gpas->final_nitems ||
+			pg_atomic_compare_exchange_u64(&gpa_rtstat_old->final_nitems_max,
+										   &curval,
+										   gpas->final_nitems))
+			break;
+	}
 	gpas->gpa_rtstat = MemoryContextAlloc(CurTransactionContext,
 										  sizeof(GpuPreAggRuntimeStat));
 	memcpy(gpas->gpa_rtstat,
@@ -4084,9 +4876,15 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 		uint64		num_fallback_rows
 			= pg_atomic_read_u64(&gpa_rtstat->num_fallback_rows);
 
+		uint64		num_final_spills
+			= pg_atomic_read_u64(&gpa_rtstat->num_final_spills);
+
 		if (num_fallback_rows > 0)
 			ExplainPropertyLong("Num of CPU fallback rows",
 								num_fallback_rows, es);
+		if (num_final_spills > 0)
+			ExplainPropertyLong("Num of final buffer spills",
+								num_final_spills, es);
 	}
 }
 
@@ -4110,6 +4908,7 @@ createGpuPreAggSharedState(GpuPreAggState *gpas,
 	gpa_sstate->ss_handle = (pcxt ? dsm_segment_handle(pcxt->seg) : UINT_MAX);
 	gpa_sstate->ss_length = ss_length;
 	pg_atomic_init_u32(&gpa_sstate->gpa_rtstat.pg_nworkers, 0);
+	gpa_sstate->f_dindex = -1;		/* set later, if shared final buffer */
 
 	return gpa_sstate;
 }
@@ -4133,29 +4932,16 @@ resetGpuPreAggSharedState(GpuPreAggState *gpas)
 }
 
 /*
- * gpupreagg_alloc_final_buffer
+ * gpupreagg_final_hashsize
+ *
+ * It determines the initial size of the final hash-slot by the number of
+ * groups planned.
  */
-static void
-gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
+static size_t
+gpupreagg_final_hashsize(GpuPreAggState *gpas)
 {
-	GpuContext	   *gcontext = gpas->gts.gcontext;
-	TupleTableSlot *gpa_slot = gpas->gpreagg_slot;
-	TupleDesc		gpa_tupdesc = gpa_slot->tts_tupleDescriptor;
-	pgstrom_data_store *pds_final;
 	size_t			f_hashsize;
-	size_t			f_hashlimit;
-	CUdeviceptr		m_fhash;
-	CUresult		rc;
 
-	if (gpas->pds_final)
-		return;
-
-	/* final buffer allocation */
-	pds_final = PDS_create_slot(gcontext,
-								gpa_tupdesc,
-								0xffff8000UL);	/* 4GB - 32KB */
-	/* final hash-slot allocation */
-	f_hashlimit = (size_t)((double)pds_final->kds.nrooms * 1.33);
 	if (gpas->plan_ngroups < 400000)
 		f_hashsize = 4 * gpas->plan_ngroups;
 	else if (gpas->plan_ngroups < 1200000)
@@ -4175,6 +4961,35 @@ gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
 											 hash_slot[0]))
 			/ sizeof(pagg_hashslot);
 	}
+	return f_hashsize;
+}
+
+/*
+ * gpupreagg_alloc_final_buffer
+ */
+static void
+gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
+{
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleTableSlot *gpa_slot = gpas->gpreagg_slot;
+	TupleDesc		gpa_tupdesc = gpa_slot->tts_tupleDescriptor;
+	pgstrom_data_store *pds_final;
+	size_t			f_hashsize;
+	size_t			f_hashlimit;
+	CUdeviceptr		m_fhash;
+	CUresult		rc;
+	int				i;
+
+	if (gpas->pds_final)
+		return;
+
+	/* final buffer allocation */
+	pds_final = PDS_create_slot(gcontext,
+								gpa_tupdesc,
+								0xffff8000UL);	/* 4GB - 32KB */
+	/* final hash-slot allocation */
+	f_hashlimit = (size_t)((double)pds_final->kds.nrooms * 1.33);
+	f_hashsize = gpupreagg_final_hashsize(gpas);
 
 	/*
 	 * Hash table allocation up to @f_hashlimit items, however, it initially
@@ -4193,6 +5008,415 @@ gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
 	gpas->ev_init_fhash	= NULL;
 	gpas->f_hashsize	= f_hashsize;
 	gpas->f_hashlimit	= f_hashlimit;
+	gpas->f_has_extra	= false;
+	for (i=0; i < pds_final->kds.ncols; i++)
+	{
+		if (!pds_final->kds.colmeta[i].attbyval)
+			gpas->f_has_extra = true;
+	}
+	gpas->f_nrunning	= 0;
+	gpas->f_nitems		= 0;
+	gpas->f_usage		= 0;
+	gpas->f_reserved_nrooms = 0;
+	gpas->f_reserved_extra = 0;
+}
+
+/*
+ * gpupreagg_alloc_shared_final_buffer
+ *
+ * It allocates the final buffer and hash-slot on the device memory of the
+ * master process, to be shared with the workers on the same device by IPC
+ * handles. All the processes merge their groups on this buffer, so Gather
+ * receives the groups already reduced on the device, instead of partial
+ * results per process. It is available only for GROUP BY with fixed-length
+ * columns by value, because the address of the extra area on kds_final is
+ * not identical across the processes.
+ */
+static void
+gpupreagg_alloc_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleDesc		gpa_tupdesc = gpas->gpreagg_slot->tts_tupleDescriptor;
+	int				dindex = gcontext->cuda_dindex;
+	size_t			unit_sz;
+	size_t			nrooms;
+	size_t			f_length;
+	size_t			f_hashsize;
+	size_t			f_hashlimit;
+	CUdeviceptr		m_kds_shared;
+	CUdeviceptr		m_fhash_shared;
+	CUresult		rc;
+	int				i;
+
+	if (!enable_gpupreagg_shared_final || gpas->num_group_keys == 0)
+		return;
+	for (i=0; i < gpa_tupdesc->natts; i++)
+	{
+		if (!gpa_tupdesc->attrs[i]->attbyval)
+			return;
+	}
+	/* twice of the groups planned, but 64K rooms at least */
+	unit_sz = LONGALIGN((sizeof(Datum) + sizeof(char)) * gpa_tupdesc->natts);
+	nrooms = Max(2 * gpas->plan_ngroups, 65536);
+	f_length = KDS_CALCULATE_SLOT_LENGTH(gpa_tupdesc->natts, nrooms);
+	if (f_length > GPUPREAGG_SHARED_FINAL_MAXLEN)
+	{
+		nrooms = (GPUPREAGG_SHARED_FINAL_MAXLEN -
+				  KDS_CALCULATE_HEAD_LENGTH(gpa_tupdesc->natts)) / unit_sz;
+		f_length = KDS_CALCULATE_SLOT_LENGTH(gpa_tupdesc->natts, nrooms);
+	}
+	f_hashlimit = (size_t)((double)nrooms * 1.33);
+	f_hashsize = Min(gpupreagg_final_hashsize(gpas), f_hashlimit);
+
+	rc = gpuMemAllocDev(gcontext, dindex,
+						&m_kds_shared,
+						f_length,
+						&gpa_sstate->f_kds_handle);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+	rc = gpuMemAllocDev(gcontext, dindex,
+						&m_fhash_shared,
+						offsetof(kern_global_hashslot,
+								 hash_slot[f_hashlimit]),
+						&gpa_sstate->f_hash_handle);
+	if (rc != CUDA_SUCCESS)
+	{
+		gpuMemFree(gcontext, m_kds_shared);
+		elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+	}
+	gpa_sstate->f_dindex	= dindex;
+	gpa_sstate->f_nrooms	= nrooms;
+	gpa_sstate->f_hashsize	= f_hashsize;
+	gpa_sstate->f_hashlimit	= f_hashlimit;
+	gpas->m_kds_shared		= m_kds_shared;
+	gpas->m_fhash_shared	= m_fhash_shared;
+	gpas->f_shared_owner	= true;
+
+	gpupreagg_reset_shared_final_buffer(gpas);
+}
+
+/*
+ * gpupreagg_reset_shared_final_buffer
+ *
+ * It sets up an empty kds_final on the shared final buffer. The hash-slot
+ * is initialized by the first task on the buffer.
+ */
+static void
+gpupreagg_reset_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleDesc		gpa_tupdesc = gpas->gpreagg_slot->tts_tupleDescriptor;
+	kern_data_store *kds_head;
+	size_t			head_sz = KDS_CALCULATE_HEAD_LENGTH(gpa_tupdesc->natts);
+	CUresult		rc;
+
+	Assert(gpas->f_shared_owner);
+	kds_head = palloc(head_sz);
+	init_kernel_data_store(kds_head,
+						   gpa_tupdesc,
+						   KDS_CALCULATE_SLOT_LENGTH(gpa_tupdesc->natts,
+													 gpa_sstate->f_nrooms),
+						   KDS_FORMAT_SLOT,
+						   gpa_sstate->f_nrooms);
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	rc = cuMemcpyHtoD(gpas->m_kds_shared, kds_head, head_sz);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	pfree(kds_head);
+
+	pg_atomic_init_u32(&gpa_sstate->f_hash_state, 0);
+	pg_atomic_init_u32(&gpa_sstate->f_nattached, 0);
+	pg_atomic_init_u64(&gpa_sstate->f_reserved_nrooms, 0);
+}
+
+/*
+ * gpupreagg_attach_shared_final_buffer
+ *
+ * It makes the shared final buffer available for the tasks of this
+ * process, unless the last process already closed the buffer.
+ */
+static void
+gpupreagg_attach_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	uint32			oldval;
+	CUresult		rc;
+
+	if (gpas->f_shared_attached ||
+		gpa_sstate->f_dindex != gcontext->cuda_dindex)
+		return;
+	oldval = pg_atomic_read_u32(&gpa_sstate->f_nattached);
+	do {
+		if ((oldval & GPUPREAGG_SHARED_FINAL_CLOSED) != 0)
+			return;		/* groups on the buffer are already returned */
+	} while (!pg_atomic_compare_exchange_u32(&gpa_sstate->f_nattached,
+											 &oldval, oldval + 1));
+	if (!gpas->m_kds_shared)
+	{
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &gpas->m_kds_shared,
+								 gpa_sstate->f_kds_handle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &gpas->m_fhash_shared,
+								 gpa_sstate->f_hash_handle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	}
+	gpas->f_shared_attached = true;
+}
+
+/*
+ * gpupreagg_detach_shared_final_buffer
+ *
+ * It detaches the shared final buffer after completion of all the tasks
+ * of this process. The last process closes the buffer, then returns the
+ * groups on the buffer as a host final buffer.
+ */
+static pgstrom_data_store *
+gpupreagg_detach_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleDesc		gpa_tupdesc = gpas->gpreagg_slot->tts_tupleDescriptor;
+	pgstrom_data_store *pds_final;
+	kern_data_store	kds_head;
+	size_t			head_sz = KDS_CALCULATE_HEAD_LENGTH(gpa_tupdesc->natts);
+	uint32			expected = 0;
+	CUresult		rc;
+
+	if (!gpas->f_shared_attached)
+		return NULL;
+	gpas->f_shared_attached = false;
+	if (pg_atomic_sub_fetch_u32(&gpa_sstate->f_nattached, 1) > 0)
+		return NULL;
+	/* someone attached the buffer in the meantime, it is responsible */
+	if (!pg_atomic_compare_exchange_u32(&gpa_sstate->f_nattached,
+										&expected,
+										GPUPREAGG_SHARED_FINAL_CLOSED))
+		return NULL;
+
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	rc = cuMemcpyDtoH(&kds_head, gpas->m_kds_shared,
+					  offsetof(kern_data_store, colmeta));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	pds_final = PDS_create_slot(gcontext,
+								gpa_tupdesc,
+								STROMALIGN(offsetof(pgstrom_data_store, kds) +
+										   KDS_CALCULATE_SLOT_LENGTH(
+											   gpa_tupdesc->natts,
+											   kds_head.nitems + 1)));
+	if (kds_head.nitems > 0)
+	{
+		rc = cuMemcpyDtoH(KERN_DATA_STORE_VALUES(&pds_final->kds, 0),
+						  gpas->m_kds_shared + head_sz,
+						  KDS_CALCULATE_SLOT_LENGTH(gpa_tupdesc->natts,
+													kds_head.nitems) - head_sz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	}
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	pds_final->kds.nitems = kds_head.nitems;
+
+	return pds_final;
+}
+
+/*
+ * gpupreagg_spill_final_buffer
+ *
+ * It detaches the current final buffer, then hands it to the supplied task
+ * to return the groups in the buffer as partial results. GpuPreAgg is
+ * a partial aggregation, so the upper Agg node merges partial results of
+ * the same group. Then, a new final buffer and hash-slot are set up.
+ * Caller must hold f_mutex, and no tasks must run on the final buffer.
+ */
+static void
+gpupreagg_spill_final_buffer(GpuPreAggTask *gpreagg)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleDesc		gpa_tupdesc = gpas->gpreagg_slot->tts_tupleDescriptor;
+	kern_global_hashslot *f_hash = (kern_global_hashslot *) gpas->m_fhash;
+	pgstrom_data_store *pds_final;
+	CUdeviceptr		m_fhash;
+	CUresult		rc;
+
+	Assert(gpas->f_nrunning == 0);
+	pds_final = PDS_create_slot(gcontext,
+								gpa_tupdesc,
+								0xffff8000UL);	/* 4GB - 32KB */
+	rc = gpuMemAllocManaged(gcontext,
+							&m_fhash,
+							offsetof(kern_global_hashslot,
+									 hash_slot[gpas->f_hashlimit]),
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+	{
+		PDS_release(pds_final);
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	}
+	/* next hash-slot begins with the size expanded by the kernel */
+	if (gpas->ev_init_fhash &&
+		f_hash->hash_size > gpas->f_hashsize &&
+		f_hash->hash_size <= gpas->f_hashlimit)
+		gpas->f_hashsize = f_hash->hash_size;
+	if (gpas->ev_init_fhash)
+	{
+		rc = cuEventDestroy(gpas->ev_init_fhash);
+		if (rc != CUDA_SUCCESS)
+			wnotice("failed on cuEventDestroy: %s", errorText(rc));
+	}
+	rc = gpuMemFree(gcontext, gpas->m_fhash);
+	if (rc != CUDA_SUCCESS)
+		wnotice("failed on gpuMemFree: %s", errorText(rc));
+
+	dlist_push_tail(&gpreagg->pds_final_list, &gpas->pds_final->chain);
+	gpas->pds_final		= pds_final;
+	gpas->m_fhash		= m_fhash;
+	gpas->ev_init_fhash	= NULL;
+	gpas->f_nitems		= 0;
+	gpas->f_usage		= 0;
+	pg_atomic_add_fetch_u64(&gpas->gpa_rtstat->num_final_spills, 1);
+}
+
+/*
+ * gpupreagg_reserve_final_buffer
+ *
+ * It reserves the final buffer for the groups to be produced by the task,
+ * in the worst case; every input row makes a new group. If the reservation
+ * may exceed the capacity of the final buffer, it waits for completion of
+ * the running tasks, then spills the final buffer.
+ */
+static void
+gpupreagg_reserve_final_buffer(GpuPreAggTask *gpreagg,
+							   size_t nrooms, size_t extra_sz)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+
+	/*
+	 * Try the shared final buffer first. Running tasks of all the processes
+	 * reserve the rooms in the worst case, so it never overflows.
+	 */
+	gpreagg->f_shared = false;
+	if (gpas->f_shared_attached && !gpas->f_shared_overflow)
+	{
+		cl_uint		nitems;
+		uint64		reserved;
+		CUresult	rc;
+
+		reserved = pg_atomic_add_fetch_u64(&gpa_sstate->f_reserved_nrooms,
+										   nrooms);
+		rc = cuMemcpyDtoH(&nitems,
+						  gpas->m_kds_shared + offsetof(kern_data_store,
+														nitems),
+						  sizeof(cl_uint));
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyDtoH: %s", errorText(rc));
+		if (nitems + reserved <= gpa_sstate->f_nrooms &&
+			nitems + reserved <=
+			GLOBAL_HASHSLOT_THRESHOLD(gpa_sstate->f_hashlimit))
+		{
+			gpreagg->f_shared = true;
+			return;
+		}
+		pg_atomic_sub_fetch_u64(&gpa_sstate->f_reserved_nrooms, nrooms);
+		gpas->f_shared_overflow = true;
+	}
+
+	if (!gpas->f_has_extra)
+		extra_sz = 0;
+	pthreadMutexLock(&gpas->f_mutex);
+	STROM_TRY();
+	{
+		for (;;)
+		{
+			kern_data_store *kds_final = &gpas->pds_final->kds;
+			size_t		nitems = (gpas->f_nitems +
+								  gpas->f_reserved_nrooms + nrooms);
+			size_t		usage = (gpas->f_usage +
+								 gpas->f_reserved_extra + extra_sz);
+
+			if (nitems <= kds_final->nrooms &&
+				nitems <= GLOBAL_HASHSLOT_THRESHOLD(gpas->f_hashlimit) &&
+				(KERN_DATA_STORE_SLOT_LENGTH(kds_final, nitems) +
+				 usage) < (size_t)kds_final->length)
+				break;
+			/* nothing to be spilled, so kernel may report an error */
+			if (gpas->f_nitems == 0 && gpas->f_nrunning == 0)
+				break;
+			if (gpas->f_nrunning == 0)
+			{
+				gpupreagg_spill_final_buffer(gpreagg);
+				continue;
+			}
+			/* wait for completion of the tasks on the final buffer */
+			pthreadCondWaitTimeout(&gpas->f_cond, &gpas->f_mutex, 400L);
+			pthreadMutexUnlock(&gpas->f_mutex);
+			CHECK_WORKER_TERMINATION();
+			pthreadMutexLock(&gpas->f_mutex);
+		}
+		gpas->f_nrunning++;
+		gpas->f_reserved_nrooms += nrooms;
+		gpas->f_reserved_extra += extra_sz;
+	}
+	STROM_CATCH();
+	{
+		pthreadMutexUnlock(&gpas->f_mutex);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+	pthreadMutexUnlock(&gpas->f_mutex);
+}
+
+/*
+ * gpupreagg_release_final_buffer
+ *
+ * It releases the reservation by gpupreagg_reserve_final_buffer, and
+ * updates the usage of the final buffer.
+ */
+static void
+gpupreagg_release_final_buffer(GpuPreAggTask *gpreagg,
+							   size_t nrooms, size_t extra_sz)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
+	kern_data_store *kds_final;
+
+	if (gpreagg->f_shared)
+	{
+		pg_atomic_sub_fetch_u64(&gpas->gpa_sstate->f_reserved_nrooms, nrooms);
+		return;
+	}
+	if (!gpas->f_has_extra)
+		extra_sz = 0;
+	pthreadMutexLock(&gpas->f_mutex);
+	kds_final = &gpas->pds_final->kds;
+	gpas->f_nitems = Max(gpas->f_nitems, kds_final->nitems);
+	gpas->f_usage = Max(gpas->f_usage, kds_final->usage);
+	Assert(gpas->f_nrunning > 0 &&
+		   gpas->f_reserved_nrooms >= nrooms &&
+		   gpas->f_reserved_extra >= extra_sz);
+	gpas->f_nrunning--;
+	gpas->f_reserved_nrooms -= nrooms;
+	gpas->f_reserved_extra -= extra_sz;
+	pthreadCondBroadcast(&gpas->f_cond);
+	pthreadMutexUnlock(&gpas->f_mutex);
 }
 
 /*
@@ -4219,7 +5443,10 @@ gpupreagg_create_task(GpuPreAggState *gpas,
 
 	/* allocation of the final-buffer on demand */
 	if (!gpas->pds_final)
+	{
 		gpupreagg_alloc_final_buffer(gpas);
+		gpupreagg_attach_shared_final_buffer(gpas);
+	}
 
 	/* rough estimation of the result buffer */
 	if (!pds_src)
@@ -4273,6 +5500,7 @@ gpupreagg_create_task(GpuPreAggState *gpas,
 	memset(gpreagg, 0, offsetof(GpuPreAggTask, kern.kparams));
 
 	pgstromInitGpuTask(&gpas->gts, &gpreagg->task);
+	dlist_init(&gpreagg->pds_final_list);
 	gpreagg->with_nvme_strom = with_nvme_strom;
 	gpreagg->pds_src = pds_src;
 	gpreagg->kds_slot_nrooms = kds_slot_nrooms;
@@ -4330,8 +5558,24 @@ gpupreagg_next_task(GpuTaskState *gts)
 	else if (gpas->gts.css.ss.ss_currentRelation)
 	{
 		pds = gpuscanExecScanChunk(&gpas->gts);
-		if (pds && pds->kds.format == KDS_FORMAT_COLUMN)
+		if (pds && pds->kds.format == KDS_FORMAT_COLUMN &&
+			!gpas->gts.af_state)
 			pg_atomic_add_fetch_u64(&gpa_rtstat->ccache_count, 1);
+		if (pds && pds->kds.format == KDS_FORMAT_COLUMN &&
+			gpas->gts.ccache_m_kds != 0UL)
+		{
+			/* runs on the device tier image of the ccache chunk */
+			gtask = gpupreagg_create_task(gpas, pds, m_kmrels, -1);
+			((GpuPreAggTask *)gtask)->m_kds_ccache = gpas->gts.ccache_m_kds;
+			gpas->gts.ccache_m_kds = 0UL;
+			return gtask;
+		}
+	}
+	else if (gpas->gts.outer_bulkexec)
+	{
+		/* results of the outer GPU node are already on the managed memory */
+		pds = pgstromBulkExecGpuTaskState((GpuTaskState *)
+										  outerPlanState(gpas));
 	}
 	else
 	{
@@ -4385,6 +5629,8 @@ static GpuTask *
 gpupreagg_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
 {
 	GpuPreAggState *gpas = (GpuPreAggState *) gts;
+	GpuPreAggTask  *gpreagg;
+	pgstrom_data_store *pds_shared;
 
 	if (gpas->terminator_done)
 		return NULL;
@@ -4401,8 +5647,7 @@ gpupreagg_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
 		/* Has RIGHT/FULL OUTER JOIN? */
 		if (gpujoinHasRightOuterJoin(outer_gts))
 		{
-			gpujoinSyncRightOuterJoin(outer_gts);
-			if (!IsParallelWorker() &&
+			if (gpujoinSyncRightOuterJoin(outer_gts) &&
 				(outer_depth = gpujoinNextRightOuterJoin(outer_gts)) > 0)
 			{
 				if (GpuJoinInnerPreload(outer_gts, &m_kmrels))
@@ -4412,10 +5657,17 @@ gpupreagg_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
 			}
 		}
 	}
-	/* setup a terminator task */
+	/* setup a terminator task; that returns the current final buffer */
 	gpas->terminator_done = true;
 	*task_is_ready = true;
-	return gpupreagg_create_task(gpas, NULL, 0UL, -1);
+	gpreagg = (GpuPreAggTask *) gpupreagg_create_task(gpas, NULL, 0UL, -1);
+	dlist_push_tail(&gpreagg->pds_final_list,
+					&PDS_retain(gpas->pds_final)->chain);
+	/* the last process also returns the shared final buffer */
+	pds_shared = gpupreagg_detach_shared_final_buffer(gpas);
+	if (pds_shared)
+		dlist_push_tail(&gpreagg->pds_final_list, &pds_shared->chain);
+	return &gpreagg->task;
 }
 
 /*
@@ -4499,18 +5751,97 @@ gpupreagg_next_tuple(GpuTaskState *gts)
 {
 	GpuPreAggState	   *gpas = (GpuPreAggState *) gts;
 	GpuPreAggTask	   *gpreagg = (GpuPreAggTask *) gpas->gts.curr_task;
-	pgstrom_data_store *pds_final = gpas->pds_final;
+	pgstrom_data_store *pds_final;
 	TupleTableSlot	   *slot = NULL;
+	dlist_node		   *dnode;
 
+	/* final buffers (terminator or spilled) returned by the task, if any */
+	while (!dlist_is_empty(&gpreagg->pds_final_list))
+	{
+		dnode = dlist_head_node(&gpreagg->pds_final_list);
+		pds_final = dlist_container(pgstrom_data_store, chain, dnode);
+		if (gpas->gts.curr_index < pds_final->kds.nitems)
+		{
+			slot = gpas->gpreagg_slot;
+			ExecClearTuple(slot);
+			PDS_fetch_tuple(slot, pds_final, &gpas->gts);
+			return slot;
+		}
+		gpas->final_nitems += pds_final->kds.nitems;
+		dlist_delete(dnode);
+		PDS_fetch_tuple_restore(&gpas->gts);
+		PDS_release(pds_final);
+		gpas->gts.curr_index = 0;	/* rewind the index */
+	}
 	if (gpreagg->task.cpu_fallback)
 		slot = gpupreagg_next_tuple_fallback(gpas, gpreagg);
-	else if (gpas->gts.curr_index < pds_final->kds.nitems)
+	return slot;
+}
+
+/*
+ * gpupreagg_init_shared_final_hash
+ *
+ * It initializes the shared final hash-slot once, by the first task of any
+ * processes. Other tasks wait for the completion.
+ */
+static void
+gpupreagg_init_shared_final_hash(GpuPreAggTask *gpreagg,
+								 CUmodule cuda_module)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *)gpreagg->task.gts;
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	CUfunction	kern_init_fhash;
+	CUresult	rc;
+	uint32		expected = 0;
+	size_t		grid_sz;
+	size_t		block_sz;
+	void	   *kern_args[3];
+
+	if (pg_atomic_read_u32(&gpa_sstate->f_hash_state) == 2)
+		return;
+	if (!pg_atomic_compare_exchange_u32(&gpa_sstate->f_hash_state,
+										&expected, 1))
 	{
-		slot = gpas->gpreagg_slot;
-		ExecClearTuple(slot);
-		PDS_fetch_tuple(slot, pds_final, &gpas->gts);
+		/* wait for the initialization by other task */
+		while (pg_atomic_read_u32(&gpa_sstate->f_hash_state) != 2)
+		{
+			CHECK_WORKER_TERMINATION();
+			pg_usleep(1000L);	/* 1ms */
+		}
+		return;
 	}
-	return slot;
+
+	rc = cuModuleGetFunction(&kern_init_fhash,
+							 cuda_module,
+							 "gpupreagg_init_final_hash");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_init_fhash,
+							 gpa_sstate->f_hashsize,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+
+	kern_args[0] = &gpas->m_fhash_shared;
+	kern_args[1] = &gpa_sstate->f_hashsize;
+	kern_args[2] = &gpa_sstate->f_hashlimit;
+	rc = cuLaunchKernel(kern_init_fhash,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						0,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+
+	rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuStreamSynchronize: %s", errorText(rc));
+	pg_atomic_write_u32(&gpa_sstate->f_hash_state, 2);
 }
 
 /*
@@ -4528,6 +5859,11 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 	size_t		block_sz;
 	void	   *kern_args[3];
 
+	if (gpreagg->f_shared)
+	{
+		gpupreagg_init_shared_final_hash(gpreagg, cuda_module);
+		return;
+	}
 	pthreadMutexLock(&gpas->f_mutex);
 	STROM_TRY();
 	{
@@ -4607,6 +5943,44 @@ gpupreaggUpdateRunTimeStat(GpuTaskState *gts, kern_gpupreagg *kgpreagg)
 							(int64)kgpreagg->nitems_filtered);
 }
 
+/*
+ * gpupreagg_copyback_ccache_image
+ *
+ * It copies back the entire image on the device tier of ccache, for CPU
+ * fallback. The header-only PDS is released.
+ */
+static pgstrom_data_store *
+gpupreagg_copyback_ccache_image(GpuPreAggTask *gpreagg)
+{
+	GpuContext	   *gcontext = gpreagg->task.gts->gcontext;
+	pgstrom_data_store *pds_src = gpreagg->pds_src;
+	pgstrom_data_store *pds_temp;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store, kds) +
+							pds_src->kds.length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	pds_temp = (pgstrom_data_store *) m_deviceptr;
+	memcpy(pds_temp, pds_src, offsetof(pgstrom_data_store, kds));
+	memset(&pds_temp->chain, 0, sizeof(dlist_node));
+	pg_atomic_init_u32(&pds_temp->refcnt, 1);
+
+	rc = cuMemcpyDtoH(&pds_temp->kds,
+					  gpreagg->m_kds_ccache,
+					  pds_src->kds.length);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemcpyDtoH: %s", errorText(rc));
+	PDS_release(pds_src);
+	gpreagg->m_kds_ccache = 0UL;
+
+	return pds_temp;
+}
+
 /*
  * gpupreagg_process_reduction_task
  *
@@ -4618,7 +5992,6 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 {
 	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
 	GpuContext	   *gcontext = gpas->gts.gcontext;
-	pgstrom_data_store *pds_final = gpas->pds_final;
 	pgstrom_data_store *pds_src = gpreagg->pds_src;
 	cl_char			kds_src_format = pds_src->kds.format;
 	const char	   *kfunc_setup;
@@ -4628,8 +6001,9 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	CUdeviceptr		m_nullptr = 0UL;
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_slot = 0UL;
-	CUdeviceptr		m_kds_final = (CUdeviceptr)&pds_final->kds;
-	CUdeviceptr		m_fhash = gpas->m_fhash;
+	CUdeviceptr		m_kdict = 0UL;
+	CUdeviceptr		m_kds_final;
+	CUdeviceptr		m_fhash;
 	int				sm_count;
 	size_t			grid_sz;
 	size_t			block_sz;
@@ -4637,11 +6011,6 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	CUresult		rc;
 	int				retval = 1;
 
-	/*
-	 * Ensure the final buffer & hashslot are ready to use
-	 */
-	gpupreagg_init_final_hash(gpreagg, cuda_module);
-
 	/*
 	 * Lookup kernel functions
 	 */
@@ -4672,7 +6041,9 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	 * Device memory allocation for short term
 	 */
 	/* kds_src */
-	if (kds_src_format != KDS_FORMAT_BLOCK)
+	if (gpreagg->m_kds_ccache != 0UL)
+		m_kds_src = gpreagg->m_kds_ccache;
+	else if (kds_src_format != KDS_FORMAT_BLOCK)
 		m_kds_src = (CUdeviceptr)&pds_src->kds;
 	else
 	{
@@ -4717,12 +6088,59 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	((kern_data_store *)m_kds_slot)->length = gpreagg->kds_slot_length;
 	((kern_data_store *)m_kds_slot)->nrooms = gpreagg->kds_slot_nrooms;
 
+	/*
+	 * kern_gpupreagg_dict, if any dictionary encoded grouping keys
+	 *
+	 * The hash-slot has twice width of the possible number of keys, and
+	 * the string pool can store the whole source chunk in addition to the
+	 * header of entries. Key values made by device functions may exceed
+	 * the estimation; it leads CPU fallback.
+	 */
+	if (gpas->num_dict_keys > 0)
+	{
+		kern_gpupreagg_dict *kdict;
+		size_t		nslots = 2 * gpreagg->kds_slot_nrooms *
+							 gpas->num_dict_keys;
+		size_t		pool_size = pds_src->kds.length +
+							 2 * MAXIMUM_ALIGNOF * gpreagg->kds_slot_nrooms *
+							 gpas->num_dict_keys;
+
+		nslots = Max(nslots, 1024);
+		pool_size = Min(pool_size, (size_t)INT_MAX);
+		rc = gpuMemAllocManaged(gcontext,
+								&m_kdict,
+								KERN_GPUPREAGG_DICT_LENGTH(nslots, pool_size),
+								CU_MEM_ATTACH_GLOBAL);
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+			goto out_of_resource;
+		else if (rc != CUDA_SUCCESS)
+			werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+		kdict = (kern_gpupreagg_dict *)m_kdict;
+		kdict->nslots = nslots;
+		kdict->nitems = 0;
+		kdict->pool_size = pool_size;
+		kdict->pool_usage = 0;
+		/* all the hash-slots are initialized to (-1, -1); EMPTY */
+		rc = cuMemsetD32Async(m_kdict + offsetof(kern_gpupreagg_dict,
+												 hash_slot),
+							  0xffffffffU,
+							  2 * nslots,
+							  CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemsetD32Async: %s", errorText(rc));
+	}
+
 	/*
 	 * OK, kick a series of GpuPreAgg invocations
 	 */
 
 	/* source data to be reduced */
-	if (kds_src_format != KDS_FORMAT_BLOCK)
+	pgstromTimeStatEventRecord(&gpas->gts, CU_EVENT1_PER_THREAD);
+	if (gpreagg->m_kds_ccache != 0UL)
+	{
+		/* ccache image is already on the device memory */
+	}
+	else if (kds_src_format != KDS_FORMAT_BLOCK)
 	{
 		rc = cuMemPrefetchAsync(m_kds_src,
 								pds_src->kds.length,
@@ -4742,14 +6160,15 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	}
 	else
 	{
-		gpuMemCopyFromSSD(m_kds_src, pds_src);
+		gpuMemCopyFromSSDAsync(m_kds_src, pds_src);
 	}
 
 	/*
 	 * Launch:
 	 * gpupreagg_setup_XXXX(kern_gpupreagg *kgpreagg,
 	 *                      kern_data_store *kds_src,
-	 *                      kern_data_store *kds_slot)
+	 *                      kern_data_store *kds_slot,
+	 *                      kern_gpupreagg_dict *kdict)
 	 */
 	largest_workgroup_size(&grid_sz,
 						   &block_sz,
@@ -4763,6 +6182,10 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	kern_args[0] = &m_gpreagg;
 	kern_args[1] = &m_kds_src;
 	kern_args[2] = &m_kds_slot;
+	kern_args[3] = &m_kdict;
+	/* kds_src has to be loaded prior to the kernel launch */
+	gpuMemCopyFromSSDWait();
+	pgstromTimeStatEventRecord(&gpas->gts, CU_EVENT2_PER_THREAD);
 	rc = cuLaunchKernel(kern_setup,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -4773,6 +6196,25 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuLaunchKernel: %s", errorText(rc));
 
+	/*
+	 * Ensure the final buffer & hashslot are ready to use, with enough
+	 * space for the groups of this task
+	 */
+	gpupreagg_reserve_final_buffer(gpreagg,
+								   gpreagg->kds_slot_nrooms,
+								   pds_src->kds.length);
+	gpupreagg_init_final_hash(gpreagg, cuda_module);
+	if (gpreagg->f_shared)
+	{
+		m_kds_final = gpas->m_kds_shared;
+		m_fhash = gpas->m_fhash_shared;
+	}
+	else
+	{
+		m_kds_final = (CUdeviceptr)&gpas->pds_final->kds;
+		m_fhash = gpas->m_fhash;
+	}
+
 	/*
 	 * Launch:
 	 * KERNEL_FUNCTION_MAXTHREADS(void)
@@ -4814,6 +6256,13 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromTimeStatAddEvents(&gpas->gts, GpuTaskPhase_DmaSend,
+							 CU_EVENT1_PER_THREAD, CU_EVENT2_PER_THREAD);
+	pgstromTimeStatAddEvents(&gpas->gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
+	gpupreagg_release_final_buffer(gpreagg,
+								   gpreagg->kds_slot_nrooms,
+								   pds_src->kds.length);
 
 	/*
 	 * XXX - Even though we speculatively allocate large virtual device
@@ -4837,6 +6286,12 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	{
 		gpreagg->task.kerror.errcode = StromError_Success;
 		gpreagg->task.cpu_fallback = true;
+		/*
+		 * In case of device tier of ccache, PDS has only header portion
+		 * of the image, so we have to copy back the entire image.
+		 */
+		if (gpreagg->m_kds_ccache != 0UL)
+			gpreagg->pds_src = gpupreagg_copyback_ccache_image(gpreagg);
 		retval = 0;
 	}
 	else if (gpreagg->task.kerror.errcode != StromError_Success)
@@ -4844,13 +6299,16 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	else
 	{
 		gpupreaggUpdateRunTimeStat(gpreagg->task.gts, &gpreagg->kern);
-		retval = -1;
+		/* returns the final buffer spilled by this task, if any */
+		retval = (dlist_is_empty(&gpreagg->pds_final_list) ? -1 : 0);
 	}
 out_of_resource:
 	if (kds_src_format == KDS_FORMAT_BLOCK && m_kds_src != 0UL)
 		gpuMemFree(gcontext, m_kds_src);
 	if (m_kds_slot != 0UL)
 		gpuMemFree(gcontext, m_kds_slot);
+	if (m_kdict != 0UL)
+		gpuMemFree(gcontext, m_kdict);
 	return retval;
 }
 
@@ -4864,7 +6322,6 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 {
 	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
 	GpuContext	   *gcontext = gpas->gts.gcontext;
-	pgstrom_data_store *pds_final = gpas->pds_final;
 	pgstrom_data_store *pds_src = gpreagg->pds_src;
 	kern_gpujoin   *kgjoin = gpreagg->kgjoin;
 	CUfunction		kern_gpujoin_main;
@@ -4874,21 +6331,20 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 	CUdeviceptr		m_kmrels = gpreagg->m_kmrels;
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_slot = 0UL;
-	CUdeviceptr		m_kds_final = (CUdeviceptr)&pds_final->kds;
-	CUdeviceptr		m_fhash = gpas->m_fhash;
+	CUdeviceptr		m_kds_final;
+	CUdeviceptr		m_fhash;
 	CUdeviceptr		m_kparams = ((CUdeviceptr)&gpreagg->kern +
 								 offsetof(kern_gpupreagg, kparams));
 	CUresult		rc;
 	size_t			grid_sz;
 	size_t			block_sz;
+	size_t			extra_sz;
+	size_t			shmem_per_block = 0;
+	size_t			shmem_per_thread = sizeof(cl_int);
 	void		   *kern_args[10];
+	bool			dma_send_timed = false;
 	int				retval = 1;
 
-	/*
-	 * Ensure the final buffer & hashslot are ready to use
-	 */
-	gpupreagg_init_final_hash(gpreagg, cuda_module);
-
 	/*
 	 * Lookup kernel functions
 	 *
@@ -4955,9 +6411,22 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 	else if (rc != CUDA_SUCCESS)
 		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
 
+	/*
+	 * Staging area of the initial projection on the shared memory, if
+	 * GpuJoin reduces the result rows without grouping keys.
+	 * See gpujoin_projection_nogroup().
+	 */
+	if (gpreagg->kern.num_group_keys == 0)
+	{
+		shmem_per_block = MAXIMUM_ALIGNOF;
+		shmem_per_thread += ((sizeof(Datum) + sizeof(cl_bool)) *
+							 gpas->kds_slot_head->ncols);
+	}
+
 	/*
 	 * OK, kick a series of GpuPreAgg invocations
 	 */
+	pgstromTimeStatEventRecord(&gpas->gts, CU_EVENT1_PER_THREAD);
 	if (pds_src)
 	{
 		if (pds_src->kds.format != KDS_FORMAT_BLOCK)
@@ -4980,7 +6449,7 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 		}
 		else
 		{
-			gpuMemCopyFromSSD(m_kds_src, pds_src);
+			gpuMemCopyFromSSDAsync(m_kds_src, pds_src);
 		}
 	}
 	else
@@ -5018,8 +6487,8 @@ resume_kernel:
 							 &block_sz,
 							 kern_gpujoin_main,
 							 0,		/* max activation */
-							 0,
-							 sizeof(int));
+							 shmem_per_block,
+							 shmem_per_thread);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
 
@@ -5032,16 +6501,39 @@ resume_kernel:
 	kern_args[3] = &m_kds_slot;
 	kern_args[4] = &m_kparams;
 
+	/* kds_src has to be loaded prior to the kernel launch */
+	gpuMemCopyFromSSDWait();
+	pgstromTimeStatEventRecord(&gpas->gts, CU_EVENT2_PER_THREAD);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
-						sizeof(cl_int) * block_sz,
+						shmem_per_block + shmem_per_thread * block_sz,
 						CU_STREAM_PER_THREAD,
 						kern_args,
 						NULL);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuLaunchKernel: %s", errorText(rc));
 
+	/*
+	 * Ensure the final buffer & hashslot are ready to use, with enough
+	 * space for the groups of this kernel invocation
+	 */
+	extra_sz = (pds_src ? pds_src->kds.length : pgstrom_chunk_size());
+	gpupreagg_reserve_final_buffer(gpreagg,
+								   gpreagg->kds_slot_nrooms,
+								   extra_sz);
+	gpupreagg_init_final_hash(gpreagg, cuda_module);
+	if (gpreagg->f_shared)
+	{
+		m_kds_final = gpas->m_kds_shared;
+		m_fhash = gpas->m_fhash_shared;
+	}
+	else
+	{
+		m_kds_final = (CUdeviceptr)&gpas->pds_final->kds;
+		m_fhash = gpas->m_fhash;
+	}
+
 	/*
 	 * Launch:
 	 * KERNEL_FUNCTION_MAXTHREADS(void)
@@ -5083,6 +6575,17 @@ resume_kernel:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	if (!dma_send_timed)
+	{
+		pgstromTimeStatAddEvents(&gpas->gts, GpuTaskPhase_DmaSend,
+								 CU_EVENT1_PER_THREAD, CU_EVENT2_PER_THREAD);
+		dma_send_timed = true;
+	}
+	pgstromTimeStatAddEvents(&gpas->gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
+	gpupreagg_release_final_buffer(gpreagg,
+								   gpreagg->kds_slot_nrooms,
+								   extra_sz);
 
 	if (pgstrom_cpu_fallback_enabled &&
 		kgjoin->kerror.errcode == StromError_CpuReCheck)
@@ -5122,7 +6625,8 @@ resume_kernel:
 		gpujoinUpdateRunTimeStat(gjs, gpreagg->kgjoin);
 		gpupreaggUpdateRunTimeStat(gpreagg->task.gts, &gpreagg->kern);
 		gpreagg->task.kerror = gpreagg->kern.kerror;
-		retval = -1;
+		/* returns the final buffer spilled by this task, if any */
+		retval = (dlist_is_empty(&gpreagg->pds_final_list) ? -1 : 0);
 	}
 	else
 	{
@@ -5156,6 +6660,27 @@ gpupreagg_process_task(GpuTask *gtask, CUmodule cuda_module)
 	return retval;
 }
 
+/*
+ * gpupreagg_jit_fallback
+ */
+static bool
+gpupreagg_jit_fallback(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gts;
+	GpuPreAggTask  *gpreagg = (GpuPreAggTask *) gtask;
+
+	/* GpuJoin combined needs the inner buffer on the device */
+	if (gpas->combined_gpujoin || !gpreagg->pds_src)
+		return false;
+	/* header-only PDS of the device tier of ccache */
+	if (gpreagg->m_kds_ccache != 0UL)
+		return false;
+	/* blocks not loaded onto the host RAM by NVMe-Strom */
+	if (gpreagg->with_nvme_strom && gpreagg->pds_src->nblocks_uncached > 0)
+		return false;
+	return true;
+}
+
 /*
  * gpupreagg_release_task
  */
@@ -5164,7 +6689,13 @@ gpupreagg_release_task(GpuTask *gtask)
 {
 	GpuPreAggTask  *gpreagg = (GpuPreAggTask *)gtask;
 	GpuContext	   *gcontext = gtask->gts->gcontext;
+	dlist_node	   *dnode;
 
+	while (!dlist_is_empty(&gpreagg->pds_final_list))
+	{
+		dnode = dlist_pop_head_node(&gpreagg->pds_final_list);
+		PDS_release(dlist_container(pgstrom_data_store, chain, dnode));
+	}
 	if (gpreagg->pds_src)
 		PDS_release(gpreagg->pds_src);
 	gpuMemFree(gcontext, (CUdeviceptr)gpreagg);
@@ -5194,6 +6725,33 @@ pgstrom_init_gpupreagg(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_dictionary */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_dictionary",
+							 "Enables dictionary encoding of variable-length grouping keys",
+							 NULL,
+							 &enable_gpupreagg_dictionary,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off final buffer shared by the parallel workers */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_shared_final",
+							 "Enables the final buffer of GpuPreAgg shared by the parallel workers on the same device",
+							 NULL,
+							 &enable_gpupreagg_shared_final,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_distinct */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_distinct",
+							 "Enables aggregate with DISTINCT by the two-phase grouping of GpuPreAgg",
+							 NULL,
+							 &enable_gpupreagg_distinct,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* initialization of path method table */
 	memset(&gpupreagg_path_methods, 0, sizeof(CustomPathMethods));
 	gpupreagg_path_methods.CustomName          = "GpuPreAgg";
@@ -25,6 +25,9 @@ static CustomScanMethods	gpuscan_plan_methods;
 static CustomExecMethods	gpuscan_exec_methods;
 static bool					enable_gpuscan;
 static bool					enable_pullup_outer_scan;
+static bool					enable_brin_index_scan;
+static bool					enable_bitmap_gpuscan;
+static double				late_materialization_threshold;
 
 /*
  * form/deform interface of private field of CustomScan(GpuScan)
@@ -36,9 +39,14 @@ typedef struct {
 	cl_uint		proj_tuple_sz;	/* nbytes of the expected result tuple size */
 	cl_uint		proj_extra_sz;	/* length of extra-buffer on kernel */
 	cl_uint		nrows_per_block;/* estimated tuple density per block */
+	cl_bool		late_materialization; /* true, if kernel returns only
+									   * selection vector */
+	cl_bool		tablesample;	/* true, if TABLESAMPLE BERNOULLI */
+	Oid			bitmap_index;	/* index to build the block map, if any */
 	List	   *ccache_refs;	/* attributed to be referenced by ccache */
 	List	   *used_params;
 	List	   *dev_quals;		/* implicitly-ANDed device quals */
+	List	   *tablesample_args; /* percentage and repeatable seed */
 } GpuScanInfo;
 
 static inline void
@@ -52,9 +60,13 @@ form_gpuscan_info(CustomScan *cscan, GpuScanInfo *gs_info)
 	privs = lappend(privs, makeInteger(gs_info->proj_tuple_sz));
 	privs = lappend(privs, makeInteger(gs_info->proj_extra_sz));
 	privs = lappend(privs, makeInteger(gs_info->nrows_per_block));
+	privs = lappend(privs, makeInteger(gs_info->late_materialization));
+	privs = lappend(privs, makeInteger(gs_info->tablesample));
+	privs = lappend(privs, makeInteger(gs_info->bitmap_index));
 	privs = lappend(privs, gs_info->ccache_refs);
 	exprs = lappend(exprs, gs_info->used_params);
 	exprs = lappend(exprs, gs_info->dev_quals);
+	exprs = lappend(exprs, gs_info->tablesample_args);
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -74,9 +86,13 @@ deform_gpuscan_info(CustomScan *cscan)
 	gs_info->proj_tuple_sz = intVal(list_nth(privs, pindex++));
 	gs_info->proj_extra_sz = intVal(list_nth(privs, pindex++));
 	gs_info->nrows_per_block = intVal(list_nth(privs, pindex++));
+	gs_info->late_materialization = intVal(list_nth(privs, pindex++));
+	gs_info->tablesample = intVal(list_nth(privs, pindex++));
+	gs_info->bitmap_index = intVal(list_nth(privs, pindex++));
 	gs_info->ccache_refs = list_nth(privs, pindex++);
 	gs_info->used_params = list_nth(exprs, eindex++);
 	gs_info->dev_quals = list_nth(exprs, eindex++);
+	gs_info->tablesample_args = list_nth(exprs, eindex++);
 
 	return gs_info;
 }
@@ -84,11 +100,14 @@ deform_gpuscan_info(CustomScan *cscan)
 typedef struct {
 	pg_atomic_uint64 nitems_filtered;
 	pg_atomic_uint64 ccache_count;
+	pg_atomic_uint64 brin_skipped;
 } GpuScanRuntimeStat;
 
 typedef struct {
 	dsm_handle		ss_handle;		/* DSM handle of the SharedState */
 	cl_uint			ss_length;		/* Length of the SharedState */
+	pg_atomic_uint32 gstore_images;	/* bitmap of gstore_fdw images already
+									 * taken by any of the processes */
 	GpuScanRuntimeStat gs_rtstat;
 } GpuScanSharedState;
 
@@ -103,11 +122,23 @@ typedef struct {
 	ExprState	   *dev_quals;		/* quals to be run on the device */
 #endif
 	bool			dev_projection;	/* true, if device projection is valid */
+	bool			late_materialization; /* true, if only selection vector
+										   * is written back */
+	/* TABLESAMPLE BERNOULLI, if any */
+	bool			tablesample;
+	cl_ulong		tablesample_cutoff;
+	cl_uint			tablesample_seed;
 	cl_uint			proj_tuple_sz;
 	cl_uint			proj_extra_sz;
 	/* resource for CPU fallback */
 	TupleTableSlot *base_slot;
 	ProjectionInfo *base_proj;
+	/* gstore_fdw image on the device memory, if any */
+	cl_int			gstore_nimages;	/* number of the images (shards and
+									 * delta chunks) */
+	cl_int		   *gstore_devices;	/* GPU device of each image */
+	pgstrom_data_store **gstore_pds; /* header portion of each image */
+	CUdeviceptr	   *gstore_m_kds;	/* device address of each image */
 } GpuScanState;
 
 typedef struct
@@ -115,13 +146,29 @@ typedef struct
 	GpuTask				task;
 	bool				with_nvme_strom;
 	bool				with_projection;
+	CUdeviceptr			m_kds_gstore;	/* kds_src on gstore_fdw or device
+										 * tier of ccache, if any */
 	/* DMA buffers */
 	pgstrom_data_store *pds_src;
 	pgstrom_data_store *pds_dst;
 	kern_resultbuf	   *kresults;
+	cl_uint				recheck_index;	/* next row to be rechecked */
 	kern_gpuscan		kern;
 } GpuScanTask;
 
+/*
+ * GpuScanBrinKey - a scan key to check BRIN summary of the block ranges
+ */
+typedef struct
+{
+	AttrNumber		idxcol;		/* column number of the BRIN index */
+	StrategyNumber	strategy;	/* strategy number in the opfamily */
+	Oid				subtype;	/* right-hand type of the operator */
+	Oid				collid;		/* collation of the operator */
+	RegProcedure	opproc;		/* function of the operator */
+	ExprState	   *arg_state;	/* right-hand argument */
+} GpuScanBrinKey;
+
 /*
  * static functions
  */
@@ -130,11 +177,14 @@ static TupleTableSlot *gpuscan_next_tuple(GpuTaskState *gts);
 static void gpuscan_switch_task(GpuTaskState *gts, GpuTask *gtask);
 static int gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module);
 static void gpuscan_release_task(GpuTask *gtask);
+static bool gpuscan_jit_fallback(GpuTaskState *gts, GpuTask *gtask);
 
 static GpuScanSharedState *createGpuScanSharedState(GpuScanState *gss,
 													ParallelContext *pcxt,
 													void *dsm_addr);
 static void resetGpuScanSharedState(GpuScanState *gss);
+static void gpuscan_init_brin_index(GpuTaskState *gts, List *quals,
+									Oid bitmap_index);
 
 /*
  * cost_gpuscan_common - common part of cost estimation for GpuScan
@@ -143,11 +193,15 @@ static void resetGpuScanSharedState(GpuScanState *gss);
  * the jobs of relation scan and execution of outer qualifiers instead of
  * execution of GpuScan node. So, its cost needs to be added to the upper
  * node.
+ * If @bitmap_index is given, only the blocks picked up by the bitmap scan
+ * on the index with @bitmap_quals are loaded, like BitmapHeapScan.
  */
 void
 cost_gpuscan_common(PlannerInfo *root,
 					RelOptInfo *scan_rel,
 					Expr *scan_quals,
+					IndexOptInfo *bitmap_index,
+					List *bitmap_quals,
 					int parallel_workers,
 					double *p_parallel_divisor,
 					double *p_scan_ntuples,
@@ -156,6 +210,7 @@ cost_gpuscan_common(PlannerInfo *root,
 					Cost *p_startup_cost,
 					Cost *p_run_cost)
 {
+	RangeTblEntry *rte = root->simple_rte_array[scan_rel->relid];
 	Cost		startup_cost = 0.0;
 	Cost		run_cost = 0.0;
 	double		gpu_ratio = pgstrom_gpu_operator_cost / cpu_operator_cost;
@@ -164,6 +219,12 @@ cost_gpuscan_common(PlannerInfo *root,
 	double		nchunks;
 	double		selectivity;
 	double		spc_seq_page_cost;
+	double		spc_random_page_cost;
+	double		heap_pages = scan_rel->pages;
+	double		heap_page_cost;
+	double		ccache_ratio = 0.0;
+	double		column_ratio = 1.0;
+	bool		is_arrow = baseRelIsArrowFdw(scan_rel);
 	cl_uint		nrows_per_block;
 	Size		heap_size;
 	Size		htup_size;
@@ -181,11 +242,62 @@ cost_gpuscan_common(PlannerInfo *root,
 									 NULL);
 
 	/* fetch estimated page cost for tablespace containing the table */
+	get_tablespace_page_costs(scan_rel->reltablespace,
+							  &spc_random_page_cost,
+							  &spc_seq_page_cost);
+	heap_page_cost = spc_seq_page_cost;
+
 	/*
-	 * TODO: we may need to discount page cost if NVMe-Strom is capable
+	 * Bitmap index scan to pick up the blocks to be loaded, if any.
+	 * Like cost_bitmap_heap_scan(), cost per page is interpolated between
+	 * random_page_cost and seq_page_cost by the ratio of the blocks to be
+	 * fetched. Qualifiers are evaluated on all the rows in these blocks,
+	 * so GPU kernel also rechecks the index quals.
 	 */
-	get_tablespace_page_costs(scan_rel->reltablespace,
-							  NULL, &spc_seq_page_cost);
+	if (bitmap_index && scan_rel->pages > 0)
+	{
+		double		index_sel;
+		double		index_ntuples;
+		double		heap_ratio;
+
+		index_sel = clauselist_selectivity(root,
+										   bitmap_quals,
+										   scan_rel->relid,
+										   JOIN_INNER,
+										   NULL);
+		index_ntuples = clamp_row_est(index_sel * scan_rel->tuples);
+		heap_pages = index_pages_fetched(index_ntuples,
+										 scan_rel->pages,
+										 bitmap_index->pages,
+										 root);
+		heap_pages = Max(Min(heap_pages, (double)scan_rel->pages), 1.0);
+		heap_ratio = heap_pages / (double)scan_rel->pages;
+		if (heap_pages >= 2.0)
+			heap_page_cost = (spc_random_page_cost -
+							  (spc_random_page_cost -
+							   spc_seq_page_cost) * sqrt(heap_ratio));
+		else
+			heap_page_cost = spc_random_page_cost;
+
+		/* cost to walk on the index and to build the TIDBitmap */
+		startup_cost += (spc_random_page_cost *
+						 ceil(index_sel * bitmap_index->pages) +
+						 (cpu_index_tuple_cost +
+						  cpu_operator_cost * list_length(bitmap_quals)) *
+						 index_sel * bitmap_index->tuples +
+						 0.1 * cpu_operator_cost * index_ntuples);
+		/* rows only in the fetched blocks are evaluated on the device */
+		ntuples *= heap_ratio;
+		selectivity = Min(selectivity / heap_ratio, 1.0);
+	}
+
+	/*
+	 * Portion of the relation already held by the columnar cache. These
+	 * blocks involve neither heap i/o nor transfer of unreferenced columns.
+	 */
+	if (rte->relkind != RELKIND_FOREIGN_TABLE)
+		ccache_ratio = pgstrom_ccache_residency_ratio(rte->relid,
+													  scan_rel->pages);
 
 	/*
 	 * Discount page scan cost if NVMe-Strom is capable
@@ -195,24 +307,29 @@ cost_gpuscan_common(PlannerInfo *root,
 	 * Once NVMe-Strom driver supports hardware configuration info,
 	 * we follow it.
 	 */
-	if (ScanPathWillUseNvmeStrom(root, scan_rel))
+	if (rte->relkind != RELKIND_FOREIGN_TABLE &&
+		ScanPathWillUseNvmeStrom(root, scan_rel))
 	{
 		/* FIXME: discount 50% if NVMe-Strom is ready */
 		spc_seq_page_cost /= 1.5;
+		heap_page_cost /= 1.5;
 		/*
 		 * FIXME: i/o concurrency will effective throughput according
 		 * to the number of parallel workers
 		 */
 		if (parallel_workers > 0)
+		{
 			spc_seq_page_cost /= (Cost)(1 + Min(parallel_workers, 4));
+			heap_page_cost /= (Cost)(1 + Min(parallel_workers, 4));
+		}
 	}
 
 	/*
-	 * Disk i/o cost; we may add special treatment for NVMe-Strom.
-	 * On the other hands, planner usually choose PG-Strom's path
-	 * for large scale of data.
+	 * Disk i/o cost; blocks on the columnar cache are loaded from the
+	 * cache file, usually on /dev/shm, so we charge no page cost for them.
 	 */
-	run_cost += spc_seq_page_cost * (double)scan_rel->pages;
+	if (rte->relkind != RELKIND_FOREIGN_TABLE)
+		run_cost += (heap_page_cost * heap_pages * (1.0 - ccache_ratio));
 
 	/*
 	 * Cost adjustment by CPU parallelism, if used.
@@ -264,7 +381,6 @@ cost_gpuscan_common(PlannerInfo *root,
 		nrows_per_block = ceil(scan_rel->tuples / (double)scan_rel->pages);
 	else
 	{
-		RangeTblEntry *rte = root->simple_rte_array[scan_rel->relid];
 		size_t		tuple_width = get_relation_data_width(rte->relid, NULL);
 
 		tuple_width += MAXALIGN(SizeofHeapTupleHeader);
@@ -279,8 +395,27 @@ cost_gpuscan_common(PlannerInfo *root,
 	run_cost += qcost.per_tuple * gpu_ratio * ntuples;
 	ntuples *= selectivity;
 
-	/* Cost for DMA transfer (host/storage --> GPU) */
-	run_cost += pgstrom_gpu_dma_cost * nchunks;
+	/*
+	 * Cost for DMA transfer (host/storage --> GPU)
+	 * gstore_fdw is already loaded onto the device memory. Columnar cache
+	 * sends only the referenced columns. arrow_fdw also reads only the
+	 * referenced columns from the files.
+	 */
+	if (rte->relkind != RELKIND_FOREIGN_TABLE)
+	{
+		if (ccache_ratio > 0.0)
+			column_ratio = Min((double)scan_rel->reltarget->width /
+							   (double)Max(htup_size, 1), 1.0);
+		run_cost += pgstrom_gpu_dma_cost * nchunks *
+			((1.0 - ccache_ratio) + ccache_ratio * column_ratio);
+	}
+	else if (is_arrow)
+	{
+		column_ratio = Min((double)scan_rel->reltarget->width /
+						   (double)Max(htup_size, 1), 1.0);
+		run_cost += (spc_seq_page_cost * (double)scan_rel->pages +
+					 pgstrom_gpu_dma_cost * nchunks) * column_ratio;
+	}
 
 	*p_parallel_divisor = parallel_divisor;
 	*p_scan_ntuples = ntuples / parallel_divisor;
@@ -318,6 +453,8 @@ create_gpuscan_path(PlannerInfo *root,
 					RelOptInfo *baserel,
 					List *dev_quals,
 					List *host_quals,
+					IndexOptInfo *bitmap_index,
+					List *bitmap_quals,
 					int parallel_nworkers)
 {
 	GpuScanInfo	   *gs_info = palloc0(sizeof(GpuScanInfo));
@@ -334,6 +471,12 @@ create_gpuscan_path(PlannerInfo *root,
 	double			scan_nchunks;
 	double			cpu_per_tuple = 0.0;
 
+	/* TABLESAMPLE BERNOULLI is applied on the GPU kernel */
+	gs_info->tablesample =
+		(planner_rt_fetch(baserel->relid, root)->tablesample != NULL);
+	/* block map by the bitmap index scan, if any */
+	gs_info->bitmap_index = (bitmap_index ? bitmap_index->indexoid : InvalidOid);
+
 	/* cost for disk i/o + GPU qualifiers */
 	if (dev_quals != NIL)
 	{
@@ -342,6 +485,8 @@ create_gpuscan_path(PlannerInfo *root,
 	}
 	cost_gpuscan_common(root, baserel,
 						dev_quals_expr,
+						bitmap_index,
+						extract_actual_clauses(bitmap_quals, false),
 						parallel_nworkers,
 						&parallel_divisor,
 						&scan_ntuples,
@@ -408,6 +553,109 @@ create_gpuscan_path(PlannerInfo *root,
 	return &cpath->path;
 }
 
+/*
+ * gpuscan_bitmap_index_quals
+ *
+ * It returns the device qualifiers of (Var OP Const/Param) form which can
+ * be used as the scan keys of the index. Executor picks up the same
+ * qualifiers on gpuscan_init_brin_index().
+ */
+static List *
+gpuscan_bitmap_index_quals(IndexOptInfo *index, List *dev_quals)
+{
+	List	   *index_quals = NIL;
+	ListCell   *lc;
+	int			i;
+
+	foreach (lc, dev_quals)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+		OpExpr	   *op = (OpExpr *) rinfo->clause;
+		Node	   *larg;
+		Node	   *rarg;
+		Var		   *var;
+		Oid			opno;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+		larg = linitial(op->args);
+		rarg = lsecond(op->args);
+		if (IsA(larg, Var) && (IsA(rarg, Const) || IsA(rarg, Param)))
+		{
+			var = (Var *)larg;
+			opno = op->opno;
+		}
+		else if (IsA(rarg, Var) && (IsA(larg, Const) || IsA(larg, Param)))
+		{
+			var = (Var *)rarg;
+			opno = get_commutator(op->opno);
+		}
+		else
+			continue;
+		if (var->varattno <= 0 || !OidIsValid(opno))
+			continue;
+
+		for (i=0; i < index->ncolumns; i++)
+		{
+			if (index->indexkeys[i] == var->varattno &&
+				op_in_opfamily(opno, index->opfamily[i]))
+			{
+				index_quals = lappend(index_quals, rinfo);
+				break;
+			}
+		}
+	}
+	return index_quals;
+}
+
+/*
+ * gpuscan_choose_bitmap_index
+ *
+ * It chooses the most selective index which supports bitmap scan with the
+ * device qualifiers. BRIN index is not a candidate because it is always
+ * used to skip block ranges, if pg_strom.enable_brin is on.
+ */
+static IndexOptInfo *
+gpuscan_choose_bitmap_index(PlannerInfo *root,
+							RelOptInfo *baserel,
+							List *dev_quals,
+							List **p_bitmap_quals)
+{
+	IndexOptInfo *best_index = NULL;
+	List	   *best_quals = NIL;
+	Selectivity	best_sel = 1.0;
+	ListCell   *lc;
+
+	foreach (lc, baserel->indexlist)
+	{
+		IndexOptInfo *index = lfirst(lc);
+		List	   *index_quals;
+		Selectivity	index_sel;
+
+		if (!index->amhasgetbitmap ||
+			index->relam == BRIN_AM_OID ||
+			(index->indpred != NIL && !index->predOK))
+			continue;
+		index_quals = gpuscan_bitmap_index_quals(index, dev_quals);
+		if (index_quals == NIL)
+			continue;
+		index_sel = clauselist_selectivity(root,
+										   extract_actual_clauses(index_quals,
+																  false),
+										   baserel->relid,
+										   JOIN_INNER,
+										   NULL);
+		if (index_sel < best_sel)
+		{
+			best_index = index;
+			best_quals = index_quals;
+			best_sel = index_sel;
+		}
+	}
+	*p_bitmap_quals = best_quals;
+	return best_index;
+}
+
 /*
  * gpuscan_add_scan_path - entrypoint of the set_rel_pathlist_hook
  */
@@ -420,6 +668,8 @@ gpuscan_add_scan_path(PlannerInfo *root,
 	Path	   *pathnode;
 	List	   *dev_quals = NIL;
 	List	   *host_quals = NIL;
+	IndexOptInfo *bitmap_index = NULL;
+	List	   *bitmap_quals = NIL;
 	ListCell   *lc;
 
 	/* call the secondary hook */
@@ -441,8 +691,29 @@ gpuscan_add_scan_path(PlannerInfo *root,
 	/* only base relation we can handle */
 	if (rte->rtekind != RTE_RELATION)
 		return;
-	if (rte->relkind != RELKIND_RELATION &&
-		rte->relkind != RELKIND_MATVIEW)
+	if (rte->relkind == RELKIND_FOREIGN_TABLE)
+	{
+		/*
+		 * gstore_fdw foreign table keeps its contents on the device memory
+		 * already, so GpuScan can run on the image without data loading.
+		 * arrow_fdw foreign table provides record batches as columnar
+		 * chunks.
+		 */
+		if (!relation_is_gstore_fdw(rte->relid) &&
+			!baseRelIsArrowFdw(baserel))
+			return;
+	}
+	else if (rte->relkind != RELKIND_RELATION &&
+			 rte->relkind != RELKIND_MATVIEW)
+		return;
+
+	/*
+	 * TABLESAMPLE BERNOULLI is a per-tuple decision, so GPU kernel can
+	 * apply it with the qualifiers. Other methods (like SYSTEM) pick up
+	 * blocks to be read, thus we leave them to the built-in SampleScan.
+	 */
+	if (rte->tablesample &&
+		rte->tablesample->tsmhandler != F_BERNOULLI)
 		return;
 
 	/* Check whether the qualifier can run on GPU device */
@@ -455,23 +726,59 @@ gpuscan_add_scan_path(PlannerInfo *root,
 		else
 			host_quals = lappend(host_quals, rinfo);
 	}
-	if (dev_quals == NIL)
+	if (dev_quals == NIL && !rte->tablesample)
 		return;
 
 	/* add GpuScan path in single process */
 	pathnode = create_gpuscan_path(root, baserel,
 								   dev_quals,
 								   host_quals,
+								   NULL, NIL,
 								   0);
 	add_path(baserel, pathnode);
 
-	/* If appropriate, consider parallel GpuScan */
+	/*
+	 * GpuScan which loads only the blocks picked up by the bitmap index
+	 * scan, for the qualifiers of medium selectivity.
+	 */
+	if (enable_bitmap_gpuscan &&
+		rte->relkind != RELKIND_FOREIGN_TABLE &&
+		!rte->tablesample)
+	{
+		bitmap_index = gpuscan_choose_bitmap_index(root, baserel,
+												   dev_quals,
+												   &bitmap_quals);
+		if (bitmap_index)
+		{
+			pathnode = create_gpuscan_path(root, baserel,
+										   dev_quals,
+										   host_quals,
+										   bitmap_index,
+										   bitmap_quals,
+										   0);
+			add_path(baserel, pathnode);
+		}
+	}
+
+	/*
+	 * If appropriate, consider parallel GpuScan
+	 *
+	 * NOTE: image of gstore_fdw is a unit of the device memory, so we cannot
+	 * split it into multiple workers, but individual shards can be scanned
+	 * concurrently if it is sharded to multiple GPU devices.
+	 */
 	if (baserel->consider_parallel && baserel->lateral_relids == NULL)
 	{
 		int		parallel_nworkers;
 
-		parallel_nworkers = compute_parallel_worker(baserel,
-													baserel->pages, -1.0);
+		if (rte->relkind != RELKIND_FOREIGN_TABLE)
+			parallel_nworkers = compute_parallel_worker(baserel,
+														baserel->pages, -1.0);
+		else if (relation_is_gstore_fdw(rte->relid))
+			parallel_nworkers = Min(gstore_fdw_num_shards(rte->relid) - 1,
+									max_parallel_workers_per_gather);
+		else
+			parallel_nworkers = 0;	/* arrow_fdw is not parallel aware */
 		/*
 		 * XXX - Do we need a something specific logic for GpuScan to adjust
 		 * parallel_workers.
@@ -483,8 +790,19 @@ gpuscan_add_scan_path(PlannerInfo *root,
 		pathnode = create_gpuscan_path(root, baserel,
 									   dev_quals,
 									   host_quals,
+									   NULL, NIL,
 									   parallel_nworkers);
 		add_partial_path(baserel, pathnode);
+		if (bitmap_index)
+		{
+			pathnode = create_gpuscan_path(root, baserel,
+										   dev_quals,
+										   host_quals,
+										   bitmap_index,
+										   bitmap_quals,
+										   parallel_nworkers);
+			add_partial_path(baserel, pathnode);
+		}
 
 		/* then, potentially generate Gather + GpuScan path */
 		generate_gather_paths(root, baserel);
@@ -506,20 +824,28 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 	devtype_info   *dtype;
 	StringInfoData	tfunc;
 	StringInfoData	cfunc;
+	StringInfoData	cse_decl;
+	StringInfoData	cse_body;
 	StringInfoData	temp;
 	Var			   *var;
 	char		   *expr_code = NULL;
+	List		   *colvec_list = NIL;
 	ListCell	   *lc;
 
 	initStringInfo(&tfunc);
 	initStringInfo(&cfunc);
+	initStringInfo(&cse_decl);
+	initStringInfo(&cse_body);
 	initStringInfo(&temp);
 
 	if (!dev_quals)
 		goto output;
 
 	/* Let's walk on the device expression tree */
+	pgstrom_codegen_common_subexprs(&cse_decl, &cse_body,
+									list_make1(dev_quals), context);
 	expr_code = pgstrom_codegen_expression((Node *)dev_quals, context);
+	context->cse_exprs = NIL;
 	/* Const/Param declarations */
 	pgstrom_codegen_param_declarations(&cfunc, context);
 	pgstrom_codegen_param_declarations(&tfunc, context);
@@ -570,15 +896,16 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 			appendStringInfo(
 				&cfunc,
 				"  pg_%s_t %s_%u;\n\n"
-				"  addr = kern_get_datum_column(kds,%u,row_index);\n"
+				"  addr = kern_colvec_datum(&gpuscan_quals_cvec[%d],row_index);\n"
 				"  %s_%u = pg_%s_datum_ref(kcxt,addr);\n",
 				dtype->type_name,
 				context->var_label,
 				var->varattno,
-				var->varattno - 1,
+				list_length(colvec_list),
 				context->var_label,
 				var->varattno,
 				dtype->type_name);
+			colvec_list = lappend_int(colvec_list, var->varattno - 1);
 		}
 	}
 	else
@@ -626,12 +953,13 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 						dtype->type_name);
 					appendStringInfo(
 						&cfunc,
-						"  addr = kern_get_datum_column(kds,%u,row_index);\n"
+						"  addr = kern_colvec_datum(&gpuscan_quals_cvec[%d],row_index);\n"
 						"  %s_%u = pg_%s_datum_ref(kcxt,addr);\n",
-						var->varattno - 1,
+						list_length(colvec_list),
 						context->var_label,
 						var->varattno,
 						dtype->type_name);
+					colvec_list = lappend_int(colvec_list, var->varattno - 1);
 					break;	/* no need to read same value twice */
 				}
 			}
@@ -645,7 +973,14 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 			&tfunc,
 			"  EXTRACT_HEAP_TUPLE_END();\n");
 	}
+	/* common sub-expressions, if any */
+	if (cse_decl.len > 0)
+	{
+		appendStringInfo(&tfunc, "%s%s", cse_decl.data, cse_body.data);
+		appendStringInfo(&cfunc, "%s%s", cse_decl.data, cse_body.data);
+	}
 output:
+	pgstrom_codegen_column_vectors(kern, "gpuscan_quals", colvec_list);
 	appendStringInfo(
 		kern,
 		"STATIC_FUNCTION(cl_bool)\n"
@@ -691,16 +1026,20 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 	bool			has_extract_tuple = false;
 	size_t			extra_size = 0;
 	devtype_info   *dtype;
+	List		   *cse_exprs = NIL;
+	List		   *colvec_list = NIL;
 	StringInfoData	tdecl;
 	StringInfoData	cdecl;
 	StringInfoData	tbody;
 	StringInfoData	cbody;
+	StringInfoData	cse_body;
 	StringInfoData	temp;
 
 	initStringInfo(&tdecl);
 	initStringInfo(&tbody);
 	initStringInfo(&cdecl);
 	initStringInfo(&cbody);
+	initStringInfo(&cse_body);
 	initStringInfo(&temp);
 	/*
 	 * step.0 - extract non-junk attributes
@@ -907,10 +1246,13 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 
 			/* column */
 			if (!referenced)
+			{
 				appendStringInfo(
 					&cbody,
-					"  addr = kern_get_datum_column(kds_src,%u,src_index);\n",
-					attr->attnum - 1);
+					"  addr = kern_colvec_datum(&gpuscan_projection_cvec[%d],src_index);\n",
+					list_length(colvec_list));
+				colvec_list = lappend_int(colvec_list, attr->attnum - 1);
+			}
 
 			if (attr->attbyval)
 			{
@@ -945,10 +1287,13 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 
 			/* column */
 			if (!referenced)
+			{
 				appendStringInfo(
 					&cbody,
-					"  addr = kern_get_datum_column(kds_src,%u,src_index);\n",
-					attr->attnum - 1);
+					"  addr = kern_colvec_datum(&gpuscan_projection_cvec[%d],src_index);\n",
+					list_length(colvec_list));
+				colvec_list = lappend_int(colvec_list, attr->attnum - 1);
+			}
 			appendStringInfo(
 				&cbody,
 				"  KVAR_%u = pg_%s_datum_ref(kcxt,addr);\n",
@@ -975,7 +1320,24 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 
 	/*
 	 * step.3 - execute expression node, then store the result onto KVAR_xx
+	 *
+	 * NOTE: sub-expressions commonly used in multiple target-entries are
+	 * evaluated only once, and stored on the CSE_xx variables.
 	 */
+	resetStringInfo(&temp);
+	foreach (lc, tlist_dev)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+
+		if (!IsA(tle->expr, Var))
+			cse_exprs = lappend(cse_exprs, tle->expr);
+	}
+	pgstrom_codegen_common_subexprs(&temp, &cse_body, cse_exprs, context);
+	appendStringInfoString(&tdecl, temp.data);
+	appendStringInfoString(&cdecl, temp.data);
+	appendStringInfoString(&tbody, cse_body.data);
+	appendStringInfoString(&cbody, cse_body.data);
+
     foreach (lc, tlist_dev)
     {
         TargetEntry    *tle = lfirst(lc);
@@ -1008,6 +1370,7 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 		appendStringInfoString(&tbody, temp.data);
         appendStringInfoString(&cbody, temp.data);
 	}
+	context->cse_exprs = NIL;
 
 	/*
 	 * step.5 - Store the expressions on the slot.
@@ -1066,9 +1429,13 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 			appendStringInfo(
 				&temp,
 				"  if (!expr_%u_v.isnull)\n"
-				"    tup_values[%d] = PointerGetDatum(expr_%u_v.value);\n",
+				"    tup_values[%d] = PointerGetDatum(expr_%u_v.value);\n"
+				"  kern_context_check_varlena(kcxt, expr_%u_v.isnull,\n"
+				"                             expr_%u_v.value);\n",
 				tle->resno,
 				tle->resno - 1,
+				tle->resno,
+				tle->resno,
 				tle->resno);
 		}
 	}
@@ -1080,6 +1447,7 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 	pgstrom_codegen_param_declarations(&cdecl, context);
 
 	/* OK, write back the kernel source */
+	pgstrom_codegen_column_vectors(kern, "gpuscan_projection", colvec_list);
 	appendStringInfo(
 		kern,
 		"%s\n%s\n%s\n%s",
@@ -1087,6 +1455,7 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 		tbody.data,
 		cdecl.data,
 		cbody.data);
+	list_free(colvec_list);
 	list_free(tlist_dev);
 	pfree(temp.data);
 	pfree(tdecl.data);
@@ -1385,6 +1754,36 @@ out:
 	*p_proj_extra_sz = proj_extra_sz;
 }
 
+/*
+ * gpuscan_choose_late_materialization
+ *
+ * It decides whether GpuScan kernel writes back only a selection vector
+ * (offset of the tuples survived the device qualifiers), instead of the
+ * projected tuples. In this mode, host-side fetches and projects the tuples
+ * from the source buffer, so DMA receive is almost negligible. It makes
+ * sense only if qualifiers are highly selective.
+ */
+static bool
+gpuscan_choose_late_materialization(PlannerInfo *root,
+									RelOptInfo *baserel,
+									List *dev_quals)
+{
+	RangeTblEntry *rte = root->simple_rte_array[baserel->relid];
+	Selectivity	selectivity;
+
+	if (dev_quals == NIL || late_materialization_threshold <= 0.0)
+		return false;
+	/* gstore_fdw does not have source buffer on the host side */
+	if (rte->relkind == RELKIND_FOREIGN_TABLE)
+		return false;
+	selectivity = clauselist_selectivity(root,
+										 dev_quals,
+										 baserel->relid,
+										 JOIN_INNER,
+										 NULL);
+	return (selectivity <= late_materialization_threshold);
+}
+
 /*
  * PlanGpuScanPath - construction of a new GpuScan plan node
  */
@@ -1500,9 +1899,20 @@ PlanGpuScanPath(PlannerInfo *root,
 		DEVKERNEL_NEEDS_DYNPARA | DEVKERNEL_NEEDS_GPUSCAN;
 	gs_info->proj_tuple_sz = proj_tuple_sz;
 	gs_info->proj_extra_sz = proj_extra_sz;
+	gs_info->late_materialization =
+		gpuscan_choose_late_materialization(root, baserel, dev_quals);
 	gs_info->ccache_refs = ccache_refs;
 	gs_info->used_params = context.used_params;
 	gs_info->dev_quals = dev_quals;
+	if (gs_info->tablesample)
+	{
+		TableSampleClause *tsc = rte->tablesample;
+
+		Assert(tsc->tsmhandler == F_BERNOULLI &&
+			   list_length(tsc->args) == 1);
+		gs_info->tablesample_args = list_make2(linitial(tsc->args),
+											   tsc->repeatable);
+	}
 	form_gpuscan_info(cscan, gs_info);
 
 	return &cscan->scan.plan;
@@ -1530,7 +1940,20 @@ pgstrom_pullup_outer_scan(const Path *outer_path,
 		if (outer_path->pathtype == T_SeqScan)
 			break;	/* OK */
 		if (pgstrom_path_is_gpuscan(outer_path))
+		{
+			GpuScanInfo *gs_info = linitial(((CustomPath *)
+											 outer_path)->custom_private);
+			/* TABLESAMPLE is only implemented in GpuScan kernel */
+			if (gs_info->tablesample)
+				return false;
+			/* so is the block map by the bitmap index scan */
+			if (OidIsValid(gs_info->bitmap_index))
+				return false;
 			break;	/* OK, only if GpuScan */
+		}
+		if (outer_path->pathtype == T_ForeignScan &&
+			baseRelIsArrowFdw(outer_path->parent))
+			break;	/* OK, arrow_fdw provides columnar chunks */
 		if (outer_path->pathtype == T_Result)
 		{
 			ProjectionPath *ppath = (ProjectionPath *) outer_path;
@@ -1544,6 +1967,13 @@ pgstrom_pullup_outer_scan(const Path *outer_path,
 		return false;	/* Elsewhere, we cannot pull-up the scan path */
 	}
 
+	/*
+	 * GpuScan on gstore_fdw references the device image as is, but upper
+	 * nodes expect the outer scan on the host buffer.
+	 */
+	if (baserel->fdwroutine != NULL && !baseRelIsArrowFdw(baserel))
+		return false;
+
 	/* qualifier has to be device executable */
 	foreach (lc, baserel->baserestrictinfo)
 	{
@@ -1684,6 +2114,12 @@ assign_gpuscan_session_info(StringInfo buf, GpuTaskState *gts)
 				buf,
 				"#define GPUSCAN_HAS_WHERE_QUALS                1\n");
 		}
+		if (gss->tablesample)
+		{
+			appendStringInfoString(
+				buf,
+				"#define GPUSCAN_HAS_TABLESAMPLE                1\n");
+		}
 	}
 }
 
@@ -1706,6 +2142,78 @@ gpuscan_create_scan_state(CustomScan *cscan)
 	return (Node *) gss;
 }
 
+/*
+ * gpuscan_init_tablesample
+ *
+ * It evaluates the arguments of TABLESAMPLE BERNOULLI, then sets up the
+ * cutoff and seed in the same manner as the built-in SampleScan. GPU kernel
+ * and CPU fallback pick up tuples using the parameters on kern_parambuf.
+ */
+static void
+gpuscan_init_tablesample(GpuScanState *gss, List *tablesample_args)
+{
+	ExprContext	   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
+	kern_parambuf  *kparams = gss->gts.kern_params;
+	Expr		   *percent_expr = linitial(tablesample_args);
+	Expr		   *repeatable_expr = lsecond(tablesample_args);
+	ExprState	   *estate;
+	Datum			datum;
+	bool			isnull;
+	float4			percent;
+
+	estate = ExecInitExpr(percent_expr, &gss->gts.css.ss.ps);
+#if PG_VERSION_NUM < 100000
+	datum = ExecEvalExprSwitchContext(estate, econtext, &isnull, NULL);
+#else
+	datum = ExecEvalExprSwitchContext(estate, econtext, &isnull);
+#endif
+	percent = DatumGetFloat4(datum);
+	if (isnull || percent < 0 || percent > 100 || isnan(percent))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLESAMPLE_ARGUMENT),
+				 errmsg("sample percentage must be between 0 and 100")));
+	gss->tablesample_cutoff = rint(((double)PG_UINT32_MAX + 1) *
+								   percent / 100);
+	if (repeatable_expr)
+	{
+		estate = ExecInitExpr(repeatable_expr, &gss->gts.css.ss.ps);
+#if PG_VERSION_NUM < 100000
+		datum = ExecEvalExprSwitchContext(estate, econtext, &isnull, NULL);
+#else
+		datum = ExecEvalExprSwitchContext(estate, econtext, &isnull);
+#endif
+		if (isnull)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLESAMPLE_REPEAT),
+					 errmsg("TABLESAMPLE REPEATABLE parameter cannot be null")));
+		gss->tablesample_seed = DatumGetUInt32(DirectFunctionCall1(hashfloat8,
+																   datum));
+	}
+	else
+		gss->tablesample_seed = random();
+	gss->tablesample = true;
+
+	kparams->tablesample_cutoff = gss->tablesample_cutoff;
+	kparams->tablesample_seed = gss->tablesample_seed;
+}
+
+/*
+ * gpuscan_tablesample_check - CPU version of gpuscan_tablesample_bernoulli
+ */
+static bool
+gpuscan_tablesample_check(GpuScanState *gss, ItemPointer tid)
+{
+	uint32		hashinput[3];
+	uint32		hash;
+
+	hashinput[0] = ItemPointerGetBlockNumber(tid);
+	hashinput[1] = ItemPointerGetOffsetNumber(tid);
+	hashinput[2] = gss->tablesample_seed;
+	hash = DatumGetUInt32(hash_any((const unsigned char *) hashinput,
+								   (int) sizeof(hashinput)));
+	return (hash < gss->tablesample_cutoff);
+}
+
 /*
  * ExecInitGpuScan
  */
@@ -1717,6 +2225,7 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	CustomScan	   *cscan = (CustomScan *)node->ss.ps.plan;
 	GpuScanInfo	   *gs_info = deform_gpuscan_info(cscan);
 	GpuContext	   *gcontext;
+	int				cuda_dindex = -1;
 	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
 	List		   *dev_tlist = NIL;
 	List		   *dev_quals_raw;
@@ -1730,8 +2239,33 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	Assert(outerPlan(node) == NULL);
 	Assert(innerPlan(node) == NULL);
 
+	/*
+	 * gstore_fdw has to be processed on the device where it is pinned.
+	 * If sharded, each process prefers the device of the shard according
+	 * to its worker number. Delta chunks are also scanned as individual
+	 * images.
+	 */
+	if (relation_is_gstore_fdw(RelationGetRelid(scan_rel)))
+	{
+		int		nimages;
+		int		i;
+
+		gss->gstore_devices = palloc0(sizeof(cl_int) * GSTORE_FDW_MAX_IMAGES);
+		nimages = gstore_fdw_device_images(scan_rel, gss->gstore_devices);
+		gss->gstore_nimages = nimages;
+		gss->gstore_pds = palloc0(sizeof(pgstrom_data_store *) * nimages);
+		gss->gstore_m_kds = palloc0(sizeof(CUdeviceptr) * nimages);
+		i = (IsParallelWorker() ? ParallelWorkerNumber + 1 : 0);
+		cuda_dindex = gss->gstore_devices[i % nimages];
+	}
+	else if (!explain_only)
+	{
+		/* SSD-to-GPU Direct prefers the GPU close to the SSD */
+		cuda_dindex = RelationOptimalGpuForNvmeStrom(scan_rel);
+	}
+
 	/* setup GpuContext for CUDA kernel execution */
-	gcontext = AllocGpuContext(-1, false);
+	gcontext = AllocGpuContext(cuda_dindex, false);
 	if (!explain_only)
 		ActivateGpuContext(gcontext);
 	gss->gts.gcontext = gcontext;
@@ -1765,8 +2299,35 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	gss->gts.cb_switch_task = gpuscan_switch_task;
 	gss->gts.cb_process_task = gpuscan_process_task;
 	gss->gts.cb_release_task = gpuscan_release_task;
+	gss->gts.cb_jit_fallback = gpuscan_jit_fallback;
 	/* estimated number of rows per block */
 	gss->gts.outer_nrows_per_block = gs_info->nrows_per_block;
+	/* GpuScan can run on the device tier image of ccache */
+	gss->gts.ccache_device_tier = true;
+
+	/*
+	 * TABLESAMPLE BERNOULLI needs ctid of the tuples, so columnar-cache
+	 * shall not be used.
+	 */
+	if (gs_info->tablesample)
+	{
+		gss->gts.ccache_refs = NULL;
+		if (!explain_only)
+			gpuscan_init_tablesample(gss, gs_info->tablesample_args);
+		else
+			gss->tablesample = true;
+	}
+
+	/*
+	 * Distribute chunks over multiple GPUs, if this process scans the
+	 * whole relation by itself. gstore_fdw is pinned to its device, and
+	 * arrow_fdw has no heap blocks to be distributed.
+	 */
+	if (!explain_only &&
+		!cscan->scan.plan.parallel_aware &&
+		RelationGetForm(scan_rel)->relkind != RELKIND_FOREIGN_TABLE)
+		pgstromSetupMultiGpuTaskState(&gss->gts,
+									  RelationGetNumberOfBlocks(scan_rel));
 
 	/*
 	 * initialize device qualifiers/projection stuff, for CPU fallback
@@ -1784,6 +2345,10 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	gss->dev_quals = ExecInitExpr(dev_quals_expr,
 								  &gss->gts.css.ss.ps);
 #endif
+	/* zone-map of columnar cache, if any */
+	pgstrom_ccache_init_zonemap(&gss->gts, dev_quals_raw);
+	/* BRIN or bitmap index to skip blocks, if any */
+	gpuscan_init_brin_index(&gss->gts, dev_quals_raw, gs_info->bitmap_index);
 
 	foreach (lc, cscan->custom_scan_tlist)
 	{
@@ -1805,6 +2370,7 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	}
 
 	/* device projection related resource consumption */
+	gss->late_materialization = gs_info->late_materialization;
 	gss->proj_tuple_sz = gs_info->proj_tuple_sz;
 	gss->proj_extra_sz = gs_info->proj_extra_sz;
 	/* 'tableoid' should not change during relation scan */
@@ -1918,12 +2484,24 @@ static void
 ExecEndGpuScan(CustomScanState *node)
 {
 	GpuScanState	   *gss = (GpuScanState *)node;
+	int					i;
 
 	/* wait for completion of asynchronous GpuTaks */
+	for (i=0; i < gss->gts.num_gcontext_multi; i++)
+		SynchronizeGpuContext(gss->gts.gcontext_multi[i]);
 	SynchronizeGpuContext(gss->gts.gcontext);
 	/* reset fallback resources */
 	if (gss->base_slot)
 		ExecDropSingleTupleTableSlot(gss->base_slot);
+	/* release gstore_fdw images, if any */
+	for (i=0; i < gss->gstore_nimages; i++)
+	{
+		if (gss->gstore_pds[i])
+			PDS_release(gss->gstore_pds[i]);
+	}
+	/* close BRIN index, if any */
+	if (gss->gts.outer_brin_index)
+		index_close(gss->gts.outer_brin_index, AccessShareLock);
 	pgstromReleaseGpuTaskState(&gss->gts);
 }
 
@@ -1934,11 +2512,21 @@ static void
 ExecReScanGpuScan(CustomScanState *node)
 {
 	GpuScanState	   *gss = (GpuScanState *) node;
+	int					i;
 
 	/* wait for completion of asynchronous GpuTaks */
+	for (i=0; i < gss->gts.num_gcontext_multi; i++)
+		SynchronizeGpuContext(gss->gts.gcontext_multi[i]);
 	SynchronizeGpuContext(gss->gts.gcontext);
 	/* reset shared state */
 	resetGpuScanSharedState(gss);
+	/* BRIN block map shall be rebuilt, because parameters may change */
+	if (gss->gts.outer_brin_map)
+	{
+		pfree(gss->gts.outer_brin_map);
+		gss->gts.outer_brin_map = NULL;
+		gss->gts.outer_brin_nblocks = 0;
+	}
 	/* common rescan handling */
 	pgstromRescanGpuTaskState(&gss->gts);
 }
@@ -2010,6 +2598,9 @@ ExecShutdownGpuScan(CustomScanState *node)
 	GpuScanState   *gss = (GpuScanState *) node;
 	GpuScanRuntimeStat *gs_rtstat_old = gss->gs_rtstat;
 
+	/* move the timing statistics from DSM also */
+	pgstromShutdownDSMGpuTaskState(&gss->gts);
+
 	/*
 	 * Note that GpuScan may not be executed if GpuScan node is located
 	 * under the GpuJoin at parallel background worker context, because
@@ -2089,6 +2680,38 @@ ExplainGpuScan(CustomScanState *node, List *ancestors, ExplainState *es)
 								nitems_filtered / instr->nloops, es);
 		}
 	}
+	/* Show TABLESAMPLE, if any */
+	if (gs_info->tablesample)
+	{
+		exprstr = deparse_expression(linitial(gs_info->tablesample_args),
+									 dcontext, es->verbose, false);
+		ExplainPropertyText("GPU Sampling",
+							psprintf("bernoulli (%s)", exprstr), es);
+		if (lsecond(gs_info->tablesample_args))
+		{
+			exprstr = deparse_expression(lsecond(gs_info->tablesample_args),
+										 dcontext, es->verbose, false);
+			ExplainPropertyText("Repeatable Seed", exprstr, es);
+		}
+	}
+	if (es->verbose && gss->late_materialization)
+		ExplainPropertyText("Late Materialization", "enabled", es);
+	/* Show BRIN or bitmap index, if any */
+	if (gss->gts.outer_brin_index)
+	{
+		Relation	index = gss->gts.outer_brin_index;
+		bool		is_brin = (index->rd_rel->relam == BRIN_AM_OID);
+
+		ExplainPropertyText(is_brin ? "BRIN Index" : "Bitmap Index",
+							RelationGetRelationName(index),
+							es);
+		if (es->analyze && gs_rtstat)
+			ExplainPropertyLong(is_brin
+								? "BRIN Skipped Blocks"
+								: "Bitmap Skipped Blocks",
+								pg_atomic_read_u64(&gs_rtstat->brin_skipped),
+								es);
+	}
 
 	/* common portion of EXPLAIN */
 	pgstromExplainGpuTaskState(&gss->gts, es);
@@ -2123,7 +2746,11 @@ createGpuScanSharedState(GpuScanState *gss,
 static void
 resetGpuScanSharedState(GpuScanState *gss)
 {
-	/* do nothing */
+	GpuScanSharedState *gs_sstate = gss->gs_sstate;
+
+	/* gstore_fdw images shall be scanned again */
+	if (gs_sstate)
+		pg_atomic_write_u32(&gs_sstate->gstore_images, 0);
 }
 
 /*
@@ -2148,6 +2775,20 @@ gpuscan_create_task(GpuScanState *gss,
 	 */
 	if (pds_src->kds.format == KDS_FORMAT_ROW && !gss->dev_projection)
 		nresults = pds_src->kds.nitems;
+	else if (gss->late_materialization &&
+			 pds_src->kds.format == KDS_FORMAT_ROW)
+		nresults = pds_src->kds.nitems;
+	else if (gss->late_materialization &&
+			 pds_src->kds.format == KDS_FORMAT_BLOCK &&
+			 pds_src->nblocks_uncached == 0)
+	{
+		/*
+		 * Late materialization needs the source blocks being kept on the
+		 * host memory, so it is not available if some blocks are loaded
+		 * by SSD-to-GPU Direct.
+		 */
+		nresults = pds_src->kds.nitems * MaxHeapTuplesPerPage;
+	}
 	else
 	{
 		double	ntuples = pds_src->kds.nitems;
@@ -2205,6 +2846,65 @@ gpuscan_create_task(GpuScanState *gss,
 	return gscan;
 }
 
+/*
+ * gpuscan_load_ccache_chunk
+ *
+ * It loads the columnar cache chunk, unless zone-map tells us the chunk
+ * has no rows to match. Dirty blocks of the chunk are saved on the GTS,
+ * to be read from the heap on the next call of gpuscanExecScanChunk().
+ * If the chunk has an image on the device tier, and the caller can run
+ * GPU kernels on the image in place, it returns header portion of the
+ * image and saves the device address on gts->ccache_m_kds.
+ */
+static pgstrom_data_store *
+gpuscan_load_ccache_chunk(GpuTaskState *gts,
+						  struct ccacheChunk *cc_chunk,
+						  Relation relation)
+{
+	pgstrom_data_store *pds_column = NULL;
+	EState	   *estate = gts->css.ss.ps.state;
+	MemoryContext oldcxt;
+	BlockNumber *delta_blocks = NULL;
+	cl_uint		delta_nblocks = 0;
+
+	Assert(gts->ccache_delta_index >= gts->ccache_delta_nblocks);
+	gts->ccache_m_kds = 0UL;
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	PG_TRY();
+	{
+		if (!pgstrom_ccache_skip_chunk(cc_chunk, gts))
+		{
+			if (gts->ccache_device_tier)
+				pds_column = pgstrom_ccache_open_device_image(cc_chunk,
+														gts->gcontext,
+														&gts->ccache_m_kds);
+			if (!pds_column)
+				pds_column = pgstrom_ccache_load_chunk(cc_chunk,
+													   gts->gcontext,
+													   relation,
+													   gts->ccache_refs,
+													   &delta_blocks,
+													   &delta_nblocks);
+		}
+	}
+	PG_CATCH();
+	{
+		pgstrom_ccache_put_chunk(cc_chunk);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	pgstrom_ccache_put_chunk(cc_chunk);
+	MemoryContextSwitchTo(oldcxt);
+
+	if (gts->ccache_delta_blocks)
+		pfree(gts->ccache_delta_blocks);
+	gts->ccache_delta_blocks = delta_blocks;
+	gts->ccache_delta_nblocks = delta_nblocks;
+	gts->ccache_delta_index = 0;
+
+	return pds_column;
+}
+
 /*
  * gpuscan_parallel_nextpage
  *
@@ -2217,7 +2917,6 @@ gpuscan_parallel_nextpage(GpuTaskState *gts, cl_uint nr_blocks)
 {
 	GpuTaskSharedState *gtss = gts->gtss;
 	HeapScanDesc	scan = gts->css.ss.ss_currentScanDesc;
-	GpuContext	   *gcontext = gts->gcontext;
 	Relids			ccache_refs = gts->ccache_refs;
 	Relation		relation = scan->rs_rd;
 	BlockNumber		sync_startpage = InvalidBlockNumber;
@@ -2227,6 +2926,7 @@ gpuscan_parallel_nextpage(GpuTaskState *gts, cl_uint nr_blocks)
 	cl_long			nr_allocated;
 	struct ccacheChunk *cc_chunk = NULL;
 	pgstrom_data_store *pds_column = NULL;
+	cl_uint			nr_blocks_req = nr_blocks;
 
 	Assert(scan->rs_numblocks == 0);
 	Assert(scan->rs_parallel);
@@ -2281,7 +2981,7 @@ retry:
 		 base + CCACHE_CHUNK_NBLOCKS <= startblock) &&
 		(base + CCACHE_CHUNK_NBLOCKS <= scan->rs_nblocks))
 	{
-		cc_chunk = pgstrom_ccache_get_chunk(relation, base);
+		cc_chunk = pgstrom_ccache_get_chunk(relation, base, ccache_refs);
 		if (cc_chunk)
 		{
 			nr_blocks = base - page;
@@ -2328,20 +3028,19 @@ out_unlock:
 	 */
 	if (cc_chunk)
 	{
-		PG_TRY();
-		{
-			pds_column = pgstrom_ccache_load_chunk(cc_chunk,
-												   gcontext,
-												   relation,
-												   ccache_refs);
-		}
-		PG_CATCH();
+		pds_column = gpuscan_load_ccache_chunk(gts, cc_chunk, relation);
+
+		/*
+		 * If zone-map told us the chunk has no rows to match, and no gap
+		 * blocks are allocated, we try to allocate the next blocks.
+		 */
+		if (!pds_column && nr_blocks == 0)
 		{
-			pgstrom_ccache_put_chunk(cc_chunk);
-			PG_RE_THROW();
+			cc_chunk = NULL;
+			nr_blocks = nr_blocks_req;
+			page = -1;
+			goto retry;
 		}
-		PG_END_TRY();
-		pgstrom_ccache_put_chunk(cc_chunk);
 	}
 	Assert(page < MaxBlockNumber);
 	scan->rs_cblock = (page < 0 ? InvalidBlockNumber : (BlockNumber)page);
@@ -2350,6 +3049,212 @@ out_unlock:
 	return pds_column;
 }
 
+/*
+ * gpuscan_init_brin_index
+ *
+ * It looks up a BRIN index which can check the device qualifiers of
+ * (Var OP Const/Param) form. If any, block ranges which never match to
+ * the qualifiers are not loaded (nor DMA'd) on the relation scan.
+ * If planner chose @bitmap_index, it is used instead, and only the blocks
+ * picked up by its bitmap scan are loaded. In both cases, rows in the
+ * blocks to be loaded are rechecked by the device qualifiers.
+ */
+static void
+gpuscan_init_brin_index(GpuTaskState *gts, List *quals, Oid bitmap_index)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	Relation	best_index = NULL;
+	List	   *best_keys = NIL;
+	List	   *index_oids;
+	ListCell   *lc1, *lc2;
+
+	if (OidIsValid(bitmap_index))
+		index_oids = list_make1_oid(bitmap_index);
+	else if (enable_brin_index_scan)
+		index_oids = RelationGetIndexList(relation);
+	else
+		return;
+	foreach (lc1, index_oids)
+	{
+		Relation	index = index_open(lfirst_oid(lc1), AccessShareLock);
+		List	   *index_keys = NIL;
+		int			i;
+
+		if ((!OidIsValid(bitmap_index) &&
+			 index->rd_rel->relam != BRIN_AM_OID) ||
+			!IndexIsValid(index->rd_index))
+		{
+			index_close(index, AccessShareLock);
+			continue;
+		}
+
+		foreach (lc2, quals)
+		{
+			OpExpr	   *op = lfirst(lc2);
+			Node	   *larg;
+			Node	   *rarg;
+			Var		   *var;
+			Expr	   *arg;
+			Oid			opno;
+			int			strategy;
+			Oid			lefttype;
+			Oid			righttype;
+			GpuScanBrinKey *bkey;
+
+			if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+				continue;
+			larg = linitial(op->args);
+			rarg = lsecond(op->args);
+			if (IsA(larg, Var) && (IsA(rarg, Const) || IsA(rarg, Param)))
+			{
+				var = (Var *)larg;
+				arg = (Expr *)rarg;
+				opno = op->opno;
+			}
+			else if (IsA(rarg, Var) && (IsA(larg, Const) || IsA(larg, Param)))
+			{
+				var = (Var *)rarg;
+				arg = (Expr *)larg;
+				opno = get_commutator(op->opno);
+			}
+			else
+				continue;
+			if (var->varattno <= 0 || !OidIsValid(opno))
+				continue;
+
+			for (i=0; i < index->rd_index->indnatts; i++)
+			{
+				if (index->rd_index->indkey.values[i] != var->varattno)
+					continue;
+				if (!op_in_opfamily(opno, index->rd_opfamily[i]))
+					continue;
+				get_op_opfamily_properties(opno, index->rd_opfamily[i],
+										   false,
+										   &strategy,
+										   &lefttype,
+										   &righttype);
+				bkey = palloc0(sizeof(GpuScanBrinKey));
+				bkey->idxcol = i + 1;
+				bkey->strategy = strategy;
+				bkey->subtype = righttype;
+				bkey->collid = op->inputcollid;
+				bkey->opproc = get_opcode(opno);
+				bkey->arg_state = ExecInitExpr(arg, &gts->css.ss.ps);
+				index_keys = lappend(index_keys, bkey);
+				break;
+			}
+		}
+		/* choose the index with the largest number of keys */
+		if (list_length(index_keys) > list_length(best_keys))
+		{
+			if (best_index)
+				index_close(best_index, AccessShareLock);
+			best_index = index;
+			best_keys = index_keys;
+		}
+		else
+			index_close(index, AccessShareLock);
+	}
+	list_free(index_oids);
+
+	gts->outer_brin_index = best_index;
+	gts->outer_brin_keys = best_keys;
+}
+
+/*
+ * gpuscan_build_brin_map
+ *
+ * It builds a bitmap of the blocks to be scanned according to the BRIN
+ * summary, or the bitmap index scan. Unsummarized ranges are always
+ * included by BRIN itself, and lossy pages of the TIDBitmap are also
+ * included as is.
+ */
+static void
+gpuscan_build_brin_map(GpuTaskState *gts, BlockNumber nblocks)
+{
+	Relation	index = gts->outer_brin_index;
+	EState	   *estate = gts->css.ss.ps.state;
+	ExprContext *econtext = gts->css.ss.ps.ps_ExprContext;
+	IndexScanDesc iscan;
+	ScanKey		scan_keys;
+	TIDBitmap  *tbm;
+	TBMIterator *tbm_iter;
+	TBMIterateResult *tbm_res;
+	int			nkeys = list_length(gts->outer_brin_keys);
+	int			i = 0;
+	ListCell   *lc;
+
+	gts->outer_brin_map = MemoryContextAllocZero(estate->es_query_cxt,
+												 nblocks / BITS_PER_BYTE + 1);
+	gts->outer_brin_nblocks = nblocks;
+
+	scan_keys = palloc0(sizeof(ScanKeyData) * nkeys);
+	foreach (lc, gts->outer_brin_keys)
+	{
+		GpuScanBrinKey *bkey = lfirst(lc);
+		Datum		datum;
+		bool		isnull;
+
+#if PG_VERSION_NUM < 100000
+		datum = ExecEvalExpr(bkey->arg_state, econtext, &isnull, NULL);
+#else
+		datum = ExecEvalExpr(bkey->arg_state, econtext, &isnull);
+#endif
+		/* strict operators never match to NULL; no blocks to be scanned */
+		if (isnull)
+		{
+			pfree(scan_keys);
+			return;
+		}
+		ScanKeyEntryInitialize(&scan_keys[i++],
+							   0,
+							   bkey->idxcol,
+							   bkey->strategy,
+							   bkey->subtype,
+							   bkey->collid,
+							   bkey->opproc,
+							   datum);
+	}
+
+	iscan = index_beginscan_bitmap(index, estate->es_snapshot, nkeys);
+	index_rescan(iscan, scan_keys, nkeys, NULL, 0);
+#if PG_VERSION_NUM < 100000
+	tbm = tbm_create(work_mem * 1024L);
+#else
+	tbm = tbm_create(work_mem * 1024L, NULL);
+#endif
+	index_getbitmap(iscan, tbm);
+	index_endscan(iscan);
+
+	tbm_iter = tbm_begin_iterate(tbm);
+	while ((tbm_res = tbm_iterate(tbm_iter)) != NULL)
+	{
+		if (tbm_res->blockno < nblocks)
+			gts->outer_brin_map[tbm_res->blockno / BITS_PER_BYTE]
+				|= (1 << (tbm_res->blockno % BITS_PER_BYTE));
+	}
+	tbm_end_iterate(tbm_iter);
+	tbm_free(tbm);
+	pfree(scan_keys);
+}
+
+/*
+ * gpuscan_brin_skip_block
+ *
+ * It returns true, if BRIN summary told us the block has no rows to match
+ */
+static inline bool
+gpuscan_brin_skip_block(GpuTaskState *gts, BlockNumber blknum)
+{
+	if (!gts->outer_brin_map || blknum >= gts->outer_brin_nblocks)
+		return false;
+	if ((gts->outer_brin_map[blknum / BITS_PER_BYTE] &
+		 (1 << (blknum % BITS_PER_BYTE))) != 0)
+		return false;
+	gts->outer_brin_skipped++;
+	return true;
+}
+
 /*
  * gpuscanExecScanChunk - read the relation by one chunk
  */
@@ -2361,6 +3266,16 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 	pgstrom_data_store *pds = NULL;
 	pgstrom_data_store *pds_column = NULL;
 
+	/* arrow_fdw loads a record batch per chunk */
+	if (gts->af_state)
+	{
+		InstrStartNode(&gts->outer_instrument);
+		pds = ExecScanChunkArrowFdw(gts);
+		InstrStopNode(&gts->outer_instrument,
+					  !pds ? 0.0 : (double)pds->kds.nitems);
+		return pds;
+	}
+
 	/*
 	 * Setup scan-descriptor, if the scan is not parallel, of if we're
 	 * executing a scan that was intended to be parallel serially.
@@ -2380,6 +3295,9 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 		PDS_init_heapscan_state(gts, gts->outer_nrows_per_block);
 	}
 	scan = gts->css.ss.ss_currentScanDesc;
+	/* construction of the block map by BRIN index, if any */
+	if (gts->outer_brin_index && !gts->outer_brin_map)
+		gpuscan_build_brin_map(gts, scan->rs_nblocks);
 	InstrStartNode(&gts->outer_instrument);
 
 	/* fetch suspended PDS, if any */
@@ -2387,6 +3305,36 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 	gts->outer_pds_suspend = NULL;
 	for (;;)
 	{
+		/*
+		 * Dirty blocks of the columnar cache last loaded are read from
+		 * the heap, prior to move the scan position.
+		 */
+		if (gts->ccache_delta_index < gts->ccache_delta_nblocks)
+		{
+			BlockNumber	curr_block = scan->rs_cblock;
+			bool		status;
+
+			if (!pds)
+			{
+				if (gts->nvme_sstate)
+					pds = PDS_create_block(gts->gcontext,
+										   RelationGetDescr(base_rel),
+										   gts->nvme_sstate);
+				else
+					pds = PDS_create_row(gts->gcontext,
+										 RelationGetDescr(base_rel),
+										 pgstrom_chunk_size());
+				pds->kds.table_oid = RelationGetRelid(base_rel);
+			}
+			scan->rs_cblock = gts->ccache_delta_blocks[gts->ccache_delta_index];
+			status = PDS_exec_heapscan(gts, pds);
+			scan->rs_cblock = curr_block;
+			if (!status)
+				break;		/* no more rooms in this PDS */
+			gts->ccache_delta_index++;
+			continue;
+		}
+
 		if (!scan->rs_inited)
 		{
 			if (scan->rs_nblocks == 0)
@@ -2426,24 +3374,12 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 				 page + CCACHE_CHUNK_NBLOCKS <= scan->rs_startblock) &&
 				(page + CCACHE_CHUNK_NBLOCKS <= scan->rs_nblocks))
 			{
-				cc_chunk = pgstrom_ccache_get_chunk(scan->rs_rd, page);
+				cc_chunk = pgstrom_ccache_get_chunk(scan->rs_rd, page,
+													gts->ccache_refs);
 				if (cc_chunk)
 				{
-					PG_TRY();
-					{
-						pds_column =
-							pgstrom_ccache_load_chunk(cc_chunk,
-													  gts->gcontext,
-													  scan->rs_rd,
-													  gts->ccache_refs);
-					}
-					PG_CATCH();
-					{
-						pgstrom_ccache_put_chunk(cc_chunk);
-						PG_RE_THROW();
-					}
-					PG_END_TRY();
-					pgstrom_ccache_put_chunk(cc_chunk);
+					pds_column = gpuscan_load_ccache_chunk(gts, cc_chunk,
+														   scan->rs_rd);
 
 					scan->rs_cblock += CCACHE_CHUNK_NBLOCKS;
 					if (scan->rs_cblock >= scan->rs_nblocks)
@@ -2453,6 +3389,9 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 						ss_report_location(scan->rs_rd, scan->rs_cblock);
 					if (scan->rs_cblock == scan->rs_startblock)
 						scan->rs_cblock = InvalidBlockNumber;
+					/* chunk was skipped by zone-map */
+					if (!pds_column)
+						continue;
 					break;
 				}
 			}
@@ -2515,8 +3454,10 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 									 pgstrom_chunk_size());
 			pds->kds.table_oid = RelationGetRelid(base_rel);
 		}
-		/* scan next block */
-		if (scan->rs_cblock == InvalidBlockNumber ||
+		/* scan next block, unless BRIN index tells it has no rows to match */
+		if (scan->rs_cblock == InvalidBlockNumber)
+			break;
+		if (!gpuscan_brin_skip_block(gts, scan->rs_cblock) &&
 			!PDS_exec_heapscan(gts, pds))
 			break;
 
@@ -2536,6 +3477,10 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 			scan->rs_cblock = InvalidBlockNumber;
 	}
 
+	/* copy the tuples deferred by the host loader, if any */
+	if (pds)
+		PDS_flush_heapscan(pds);
+
 	if (pds_column)
 	{
 		gts->outer_pds_suspend = pds;
@@ -2587,6 +3532,36 @@ gpuscan_switch_task(GpuTaskState *gts, GpuTask *gtask)
 		= (GpuScanTask *) gtask;
 }
 
+/*
+ * gpuscan_claim_gstore_image
+ *
+ * It takes an image of gstore_fdw not scanned yet, or returns -1. Images
+ * on the device of our GpuContext are preferred, then the others are
+ * scanned using peer access, if no other processes take them.
+ */
+static int
+gpuscan_claim_gstore_image(GpuScanState *gss)
+{
+	GpuScanSharedState *gs_sstate = gss->gs_sstate;
+	cl_int		cuda_dindex = gss->gts.gcontext->cuda_dindex;
+	cl_uint		mask;
+	int			loop, i;
+
+	for (loop=0; loop < 2; loop++)
+	{
+		for (i=0; i < gss->gstore_nimages; i++)
+		{
+			if (loop == 0 && gss->gstore_devices[i] != cuda_dindex)
+				continue;
+			mask = (1U << i);
+			if ((pg_atomic_fetch_or_u32(&gs_sstate->gstore_images,
+										mask) & mask) == 0)
+				return i;
+		}
+	}
+	return -1;
+}
+
 /*
  * gpuscan_next_task
  */
@@ -2598,35 +3573,75 @@ gpuscan_next_task(GpuTaskState *gts)
 	GpuScanTask		   *gscan;
 	pgstrom_data_store *pds;
 
+	/*
+	 * gstore_fdw foreign table has its entire contents on the device memory,
+	 * so a task per image runs GPU kernel on the image without data loading.
+	 */
+	if (gss->gstore_nimages > 0)
+	{
+		int		image_id = gpuscan_claim_gstore_image(gss);
+
+		if (image_id < 0)
+			return NULL;
+		if (!gss->gstore_pds[image_id])
+			gss->gstore_pds[image_id] =
+				gstore_fdw_open_data_store(gts->gcontext,
+										   gts->css.ss.ss_currentRelation,
+										   image_id,
+										   &gss->gstore_m_kds[image_id]);
+		pds = PDS_retain(gss->gstore_pds[image_id]);
+		gscan = gpuscan_create_task(gss, pds);
+		gscan->m_kds_gstore = gss->gstore_m_kds[image_id];
+
+		return &gscan->task;
+	}
+
 	pds = gpuscanExecScanChunk(gts);
+	if (gts->outer_brin_skipped > 0)
+	{
+		pg_atomic_add_fetch_u64(&gs_rtstat->brin_skipped,
+								gts->outer_brin_skipped);
+		gts->outer_brin_skipped = 0;
+	}
 	if (!pds)
 		return NULL;
-	if (pds->kds.format == KDS_FORMAT_COLUMN)
+	if (pds->kds.format == KDS_FORMAT_COLUMN && !gts->af_state)
 		pg_atomic_add_fetch_u64(&gs_rtstat->ccache_count, 1);
 	gscan = gpuscan_create_task(gss, pds);
+	if (pds->kds.format == KDS_FORMAT_COLUMN && gts->ccache_m_kds != 0UL)
+	{
+		/* runs on the device tier image of the ccache chunk */
+		gscan->m_kds_gstore = gts->ccache_m_kds;
+		gts->ccache_m_kds = 0UL;
+	}
 
 	return &gscan->task;
 }
 
 /*
- * gpuscan_next_tuple_fallback - GPU fallback case
+ * gpuscan_fallback_eval - evaluates the tuple on gss->base_slot by CPU,
+ * then returns the projected slot, or NULL if it is filtered out.
  */
 static TupleTableSlot *
-gpuscan_next_tuple_fallback(GpuScanState *gss, GpuScanTask *gscan)
+gpuscan_fallback_eval(GpuScanState *gss)
 {
-	pgstrom_data_store *pds_src = gscan->pds_src;
 	GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
 	ExprContext		   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
 	TupleTableSlot	   *slot = NULL;
 
-retry_next:
-	ExecClearTuple(gss->base_slot);
-	if (!PDS_fetch_tuple(gss->base_slot, pds_src, &gss->gts))
-		return NULL;
-
 	ResetExprContext(econtext);
 	econtext->ecxt_scantuple = gss->base_slot;
 
+	/*
+	 * (0) - TABLESAMPLE BERNOULLI if any
+	 */
+	if (gss->tablesample &&
+		!gpuscan_tablesample_check(gss, &gss->base_slot->tts_tuple->t_self))
+	{
+		pg_atomic_add_fetch_u64(&gs_rtstat->nitems_filtered, 1);
+		return NULL;
+	}
+
 	/*
 	 * (1) - Evaluation of dev_quals if any
 	 */
@@ -2641,7 +3656,7 @@ retry_next:
 		if (!retval)
 		{
 			pg_atomic_add_fetch_u64(&gs_rtstat->nitems_filtered, 1);
-			goto retry_next;
+			return NULL;
 		}
 	}
 
@@ -2667,6 +3682,61 @@ retry_next:
 	return slot;
 }
 
+/*
+ * gpuscan_next_tuple_fallback - GPU fallback case
+ */
+static TupleTableSlot *
+gpuscan_next_tuple_fallback(GpuScanState *gss, GpuScanTask *gscan)
+{
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	TupleTableSlot	   *slot;
+
+	do {
+		ExecClearTuple(gss->base_slot);
+		if (!PDS_fetch_tuple(gss->base_slot, pds_src, &gss->gts))
+			return NULL;
+		slot = gpuscan_fallback_eval(gss);
+	} while (!slot);
+
+	return slot;
+}
+
+/*
+ * gpuscan_next_tuple_recheck - CPU recheck of the rows which raised
+ * CpuReCheck error on the device side, but the rest of rows in the chunk
+ * were processed by GPU.
+ */
+static TupleTableSlot *
+gpuscan_next_tuple_recheck(GpuScanState *gss, GpuScanTask *gscan)
+{
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	cl_uint				nitems_recheck;
+	TupleTableSlot	   *slot = NULL;
+
+	nitems_recheck = Min(gscan->kern.nitems_recheck,
+						 GPUSCAN_RECHECK_NROOMS);
+	while (!slot && gscan->recheck_index < nitems_recheck)
+	{
+		HeapTuple	tuple = &gss->scan_tuple;
+		cl_uint		kds_offset;
+
+		kds_offset = gscan->kern.recheck_rows[gscan->recheck_index++];
+		if (pds_src->kds.format == KDS_FORMAT_ROW)
+			tuple->t_data = KDS_ROW_REF_HTUP(&pds_src->kds,
+											 kds_offset,
+											 &tuple->t_self,
+											 &tuple->t_len);
+		else
+			tuple->t_data = KDS_BLOCK_REF_HTUP(&pds_src->kds,
+											   kds_offset,
+											   &tuple->t_self,
+											   &tuple->t_len);
+		ExecStoreTuple(tuple, gss->base_slot, InvalidBuffer, false);
+		slot = gpuscan_fallback_eval(gss);
+	}
+	return slot;
+}
+
 /*
  * gpuscan_next_tuple
  */
@@ -2686,7 +3756,7 @@ gpuscan_next_tuple(GpuTaskState *gts)
 		slot = gss->gts.css.ss.ss_ScanTupleSlot;
 		ExecClearTuple(slot);
 		if (!PDS_fetch_tuple(slot, pds_dst, &gss->gts))
-			slot = NULL;
+			slot = gpuscan_next_tuple_recheck(gss, gscan);
 	}
 	else
 	{
@@ -2697,7 +3767,8 @@ gpuscan_next_tuple(GpuTaskState *gts)
 		 * We should not inject GpuScan for all-visible with no device
 		 * projection; GPU has no actual works in other words.
 		 * NOTE: kresults->results[] keeps offset from the head of
-		 * kds_src.
+		 * kds_src. If late materialization mode, device projection is
+		 * applied here, only for the tuples survived the device quals.
 		 */
 		Assert(!kresults->all_visible);
 		if (gss->gts.curr_index < kresults->nitems)
@@ -2720,9 +3791,30 @@ gpuscan_next_tuple(GpuTaskState *gts)
 												   &tuple->t_self,
 												   &tuple->t_len);
 			}
-			slot = gss->gts.css.ss.ss_ScanTupleSlot;
-			ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+			if (!gss->base_proj)
+			{
+				slot = gss->gts.css.ss.ss_ScanTupleSlot;
+				ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+			}
+			else
+			{
+				ExprContext	   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
+#if PG_VERSION_NUM < 100000
+				ExprDoneCond	is_done;
+#endif
+				Assert(gss->late_materialization);
+				ExecStoreTuple(tuple, gss->base_slot, InvalidBuffer, false);
+				ResetExprContext(econtext);
+				econtext->ecxt_scantuple = gss->base_slot;
+#if PG_VERSION_NUM < 100000
+				slot = ExecProject(gss->base_proj, &is_done);
+#else
+				slot = ExecProject(gss->base_proj);
+#endif
+			}
 		}
+		else
+			slot = gpuscan_next_tuple_recheck(gss, gscan);
 	}
 	return slot;
 }
@@ -2755,6 +3847,42 @@ gpuscanRewindScanChunk(GpuTaskState *gts)
 	ExecScanReScan(&gts->css.ss);
 }
 
+/*
+ * gpuscan_writeback_uncached_blocks
+ *
+ * In case of NVMe-Strom, some blocks are not loaded onto CPU RAM, but
+ * CPU fallback or recheck needs them.
+ */
+static void
+gpuscan_writeback_uncached_blocks(GpuScanTask *gscan, CUdeviceptr m_kds_src)
+{
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	void	   *p_dest;
+	size_t		offset;
+	CUresult	rc;
+
+	if (!gscan->with_nvme_strom || pds_src->nblocks_uncached == 0)
+		return;
+
+	p_dest = KERN_DATA_STORE_BLOCK_PGPAGE(&pds_src->kds, 0);
+	offset = (uintptr_t)p_dest - (uintptr_t)&pds_src->kds;
+	rc = cuMemcpyDtoHAsync(p_dest,
+						   m_kds_src + offset,
+						   pds_src->nblocks_uncached * BLCKSZ,
+						   CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemcpyDtoHAsync: %s", errorText(rc));
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+}
+
 /*
  * gpuscan_process_task
  */
@@ -2763,12 +3891,14 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 {
 	GpuContext	   *gcontext = GpuWorkerCurrentContext;
 	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+	GpuTaskState   *gts = gscan->task.gts;
 	pgstrom_data_store *pds_src = gscan->pds_src;
 	pgstrom_data_store *pds_dst = gscan->pds_dst;
 	CUfunction		kern_gpuscan_quals;
 	CUdeviceptr		m_gpuscan = (CUdeviceptr)&gscan->kern;
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_dst = (pds_dst ? (CUdeviceptr)&pds_dst->kds : 0UL);
+	CUdeviceptr		m_deviceptr;
 	const char	   *kern_fname;
 	void		   *kern_args[5];
 	size_t			offset;
@@ -2778,6 +3908,7 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	size_t			nitems_in;
 	size_t			nitems_out;
 	size_t			extra_size;
+	size_t			nitems_recheck;
 	CUresult		rc;
 	int				retval = 100001;
 
@@ -2808,7 +3939,9 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	 * So, if we cannot allocate i/o mapped device memory, we try to read
 	 * the blocks synchronously then kicks usual RAM->GPU DMA.
 	 */
-	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+	if (gscan->m_kds_gstore != 0UL)
+		m_kds_src = gscan->m_kds_gstore;
+	else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 		m_kds_src = (CUdeviceptr)&pds_src->kds;
 	else
 	{
@@ -2840,6 +3973,7 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	/*
 	 * OK, enqueue a series of requests
 	 */
+	pgstromTimeStatEventRecord(gts, CU_EVENT1_PER_THREAD);
 	length = KERN_GPUSCAN_DMASEND_LENGTH(&gscan->kern);
 	rc = cuMemPrefetchAsync((CUdeviceptr)&gscan->kern,
 							length,
@@ -2849,7 +3983,11 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 
 	/* kern_data_store *kds_src */
-	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+	if (gscan->m_kds_gstore != 0UL)
+	{
+		/* gstore_fdw or ccache image is already on the device memory */
+	}
+	else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 	{
 		rc = cuMemPrefetchAsync(m_kds_src,
 								pds_src->kds.length,
@@ -2870,7 +4008,7 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	else
 	{
 		Assert(pds_src->kds.format == KDS_FORMAT_BLOCK);
-		gpuMemCopyFromSSD(m_kds_src, pds_src);
+		gpuMemCopyFromSSDAsync(m_kds_src, pds_src);
 	}
 
 	/* head of the kds_dst, if any */
@@ -2901,6 +4039,9 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	kern_args[1] = &m_kds_src;
 	kern_args[2] = &m_kds_dst;
 
+	/* kds_src has to be loaded prior to the kernel launch */
+	gpuMemCopyFromSSDWait();
+	pgstromTimeStatEventRecord(gts, CU_EVENT2_PER_THREAD);
 	rc = cuLaunchKernel(kern_gpuscan_quals,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -2919,6 +4060,10 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromTimeStatAddEvents(gts, GpuTaskPhase_DmaSend,
+							 CU_EVENT1_PER_THREAD, CU_EVENT2_PER_THREAD);
+	pgstromTimeStatAddEvents(gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
 
 	/*
 	 * Check GPU kernel status and nitems/usage
@@ -2928,14 +4073,29 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	nitems_out = gscan->kern.nitems_out;
 	extra_size = gscan->kern.extra_size;
 
+	nitems_recheck = Min(gscan->kern.nitems_recheck,
+						 GPUSCAN_RECHECK_NROOMS);
+
 	gscan->task.kerror = ((kern_gpuscan *)m_gpuscan)->kerror;
+	/*
+	 * Rows to be rechecked are referenced by the offset from kds_src, but
+	 * PDS has only header portion in case of gstore_fdw or device tier of
+	 * ccache. So, we fall back the whole chunk.
+	 */
+	if (gscan->task.kerror.errcode == StromError_Success &&
+		nitems_recheck > 0 && gscan->m_kds_gstore != 0UL)
+		gscan->task.kerror.errcode = StromError_CpuReCheck;
+
 	if (gscan->task.kerror.errcode == StromError_Success)
 	{
 		GpuScanState	   *gss = (GpuScanState *)gscan->task.gts;
 		GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
 
+		/* rows to be rechecked are counted on CPU side */
 		pg_atomic_add_fetch_u64(&gs_rtstat->nitems_filtered,
-								nitems_in - nitems_out);
+								nitems_in - nitems_out - nitems_recheck);
+		if (nitems_recheck > 0)
+			gpuscan_writeback_uncached_blocks(gscan, m_kds_src);
 	}
 	else
 	{
@@ -2950,33 +4110,47 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 			 * In case of NVMe-Strom, we have to write-back blocks that are
 			 * not loaded onto CPU RAM yet, for fallback processing.
 			 */
-			if (gscan->with_nvme_strom &&
-				pds_dst->nblocks_uncached > 0)
-			{
-				void  *p_dest = KERN_DATA_STORE_BLOCK_PGPAGE(&pds_src->kds, 0);
+			gpuscan_writeback_uncached_blocks(gscan, m_kds_src);
 
-				offset = (uintptr_t)p_dest - (uintptr_t)&pds_src->kds;
-				rc = cuMemcpyDtoHAsync(p_dest,
-									   m_kds_src + offset,
-									   pds_src->nblocks_uncached * BLCKSZ,
-									   CU_STREAM_PER_THREAD);
+			/*
+			 * In case of gstore_fdw or device tier of ccache, PDS has only
+			 * header portion of the image, so we have to copy back the
+			 * entire image for fallback.
+			 */
+			if (gscan->m_kds_gstore != 0UL)
+			{
+				pgstrom_data_store *pds_temp;
+
+				length = pds_src->kds.length;
+				rc = gpuMemAllocManaged(gcontext,
+										&m_deviceptr,
+										offsetof(pgstrom_data_store,
+												 kds) + length,
+										CU_MEM_ATTACH_GLOBAL);
 				if (rc != CUDA_SUCCESS)
-					werror("failed on cuMemcpyDtoHAsync: %s", errorText(rc));
-
-				rc = cuEventRecord(CU_EVENT0_PER_THREAD,
-								   CU_STREAM_PER_THREAD);
+					werror("failed on gpuMemAllocManaged: %s",
+						   errorText(rc));
+				pds_temp = (pgstrom_data_store *) m_deviceptr;
+				memcpy(pds_temp, pds_src,
+					   offsetof(pgstrom_data_store, kds));
+				memset(&pds_temp->chain, 0, sizeof(dlist_node));
+				pg_atomic_init_u32(&pds_temp->refcnt, 1);
+
+				rc = cuMemcpyDtoH(&pds_temp->kds,
+								  gscan->m_kds_gstore,
+								  length);
 				if (rc != CUDA_SUCCESS)
-					werror("failed on cuEventRecord: %s", errorText(rc));
+					werror("failed on cuMemcpyDtoH: %s", errorText(rc));
 
-				/* Point of synchronization */
-				rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
-				if (rc != CUDA_SUCCESS)
-					werror("failed on cuEventSynchronize: %s", errorText(rc));
+				PDS_release(pds_src);
+				pds_src = gscan->pds_src = pds_temp;
+				gscan->m_kds_gstore = 0UL;
 			}
 		}
 		goto out_of_resource;
 	}
 
+	pgstromTimeStatEventRecord(gts, CU_EVENT1_PER_THREAD);
 	if (pds_dst)
 	{
 		if (nitems_out > 0)
@@ -3012,6 +4186,23 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	}
 
+	/*
+	 * DtoH prefetch is not waited for usually, because the backend will
+	 * touch the result buffer later. Synchronize only if timing statistics
+	 * are collected.
+	 */
+	if (gts->tm_stat)
+	{
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+		pgstromTimeStatAddEvents(gts, GpuTaskPhase_DmaRecv,
+								 CU_EVENT1_PER_THREAD, CU_EVENT0_PER_THREAD);
+	}
+
 out_of_resource:
 	if (retval > 0)
 		wnotice("GpuScan: out of resource");
@@ -3020,6 +4211,23 @@ out_of_resource:
 	return retval;
 }
 
+/*
+ * gpuscan_jit_fallback
+ */
+static bool
+gpuscan_jit_fallback(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+
+	/* header-only PDS of gstore_fdw or the device tier of ccache */
+	if (!gscan->pds_src || gscan->m_kds_gstore != 0UL)
+		return false;
+	/* blocks not loaded onto the host RAM by NVMe-Strom */
+	if (gscan->with_nvme_strom && gscan->pds_src->nblocks_uncached > 0)
+		return false;
+	return true;
+}
+
 /*
  * gpuscan_release_task
  */
@@ -3060,6 +4268,35 @@ pgstrom_init_gpuscan(void)
 							 PGC_USERSET,
                              GUC_NOT_IN_SAMPLE,
                              NULL, NULL, NULL);
+	/* pg_strom.enable_brin */
+	DefineCustomBoolVariable("pg_strom.enable_brin",
+							 "Enables to skip block ranges by BRIN index on GpuScan",
+							 NULL,
+							 &enable_brin_index_scan,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_bitmap_gpuscan */
+	DefineCustomBoolVariable("pg_strom.enable_bitmap_gpuscan",
+							 "Enables GpuScan to load only the blocks picked up by bitmap index scan",
+							 NULL,
+							 &enable_bitmap_gpuscan,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.late_materialization_threshold */
+	DefineCustomRealVariable("pg_strom.late_materialization_threshold",
+							 "Selectivity of GPU filter to write back only selection vector",
+							 "GpuScan with device qualifiers more selective than this value returns only offset of the survived tuples, then host fetches them. 0 disables late materialization.",
+							 &late_materialization_threshold,
+							 0.01,
+							 0.0,
+							 1.0,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 
 	/* setup path methods */
 	memset(&gpuscan_path_methods, 0, sizeof(gpuscan_path_methods));
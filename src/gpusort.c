@@ -0,0 +1,2234 @@
+/*
+ * gpusort.c
+ *
+ * GPU accelerated sorting and Top-N of the input stream
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "pg_strom.h"
+#include "cuda_gpusort.h"
+
+static create_upper_paths_hook_type create_upper_paths_next;
+static CustomPathMethods		gpusort_path_methods;
+static CustomScanMethods		gpusort_scan_methods;
+static CustomExecMethods		gpusort_exec_methods;
+static bool						enable_gpusort;
+
+#define LOG2(x)		(log(x) / 0.693147180559945)
+
+typedef struct
+{
+	double			outer_nrows;	/* number of estimated outer nrows */
+	double			bound;			/* LIMIT k, or 0 if unbounded */
+	List		   *key_attnos;		/* resno of the keys on the outer-tlist */
+	List		   *key_sortops;	/* sort operator of the keys */
+	List		   *key_collids;	/* collation of the keys */
+	List		   *key_nulls_first; /* NULLS FIRST, if true */
+	char		   *kern_source;
+	int				extra_flags;
+	List		   *used_params;	/* referenced Const/Param */
+} GpuSortInfo;
+
+static inline void
+form_gpusort_info(CustomScan *cscan, GpuSortInfo *gs_info)
+{
+	List	   *privs = NIL;
+	List	   *exprs = NIL;
+
+	privs = lappend(privs, pmakeFloat(gs_info->outer_nrows));
+	privs = lappend(privs, pmakeFloat(gs_info->bound));
+	privs = lappend(privs, gs_info->key_attnos);
+	privs = lappend(privs, gs_info->key_sortops);
+	privs = lappend(privs, gs_info->key_collids);
+	privs = lappend(privs, gs_info->key_nulls_first);
+	privs = lappend(privs, makeString(gs_info->kern_source));
+	privs = lappend(privs, makeInteger(gs_info->extra_flags));
+	exprs = lappend(exprs, gs_info->used_params);
+
+	cscan->custom_private = privs;
+	cscan->custom_exprs = exprs;
+}
+
+static inline GpuSortInfo *
+deform_gpusort_info(CustomScan *cscan)
+{
+	GpuSortInfo *gs_info = palloc0(sizeof(GpuSortInfo));
+	List	   *privs = cscan->custom_private;
+	List	   *exprs = cscan->custom_exprs;
+	int			pindex = 0;
+	int			eindex = 0;
+
+	gs_info->outer_nrows = floatVal(list_nth(privs, pindex++));
+	gs_info->bound = floatVal(list_nth(privs, pindex++));
+	gs_info->key_attnos = list_nth(privs, pindex++);
+	gs_info->key_sortops = list_nth(privs, pindex++);
+	gs_info->key_collids = list_nth(privs, pindex++);
+	gs_info->key_nulls_first = list_nth(privs, pindex++);
+	gs_info->kern_source = strVal(list_nth(privs, pindex++));
+	gs_info->extra_flags = intVal(list_nth(privs, pindex++));
+	gs_info->used_params = list_nth(exprs, eindex++);
+
+	return gs_info;
+}
+
+/*
+ * GpuSortTask
+ *
+ * Host side representation of kern_gpusort; a task per chunk of the input
+ * stream. Each chunk is sorted individually, then merged on CPU.
+ */
+typedef struct
+{
+	GpuTask			task;
+	pgstrom_data_store *pds_src;	/* source chunk in KDS_FORMAT_ROW */
+	kern_gpusort	kern;
+} GpuSortTask;
+
+/*
+ * GpuSortRun - a sorted chunk being merged
+ */
+typedef struct
+{
+	GpuSortTask	   *gstask;
+	cl_uint			index;			/* current position in results[] */
+	HeapTupleData	tuple;
+	TupleTableSlot *slot;
+} GpuSortRun;
+
+/*
+ * GpuSortState
+ */
+typedef struct
+{
+	GpuTaskState	gts;
+	cl_int			num_keys;
+	SortSupport		sortkeys;		/* ssup_attno points the outer row */
+	AttrNumber	   *key_attnos;
+	Oid			   *key_sortops;
+	Oid			   *key_collids;
+	bool		   *key_nulls_first;
+	cl_long			bound;			/* LIMIT k, or 0 if unbounded */
+	kern_data_store *kds_slot_head;	/* template of the kds_slot */
+
+	/* stuff to merge the sorted chunks */
+	bool			sort_done;
+	cl_int			num_runs;
+	cl_int			max_runs;
+	GpuSortRun	   *runs;
+	binaryheap	   *heap;			/* k-way merge over the runs */
+	cl_int			curr_run;		/* run of the last tuple, or -1 */
+	Tuplesortstate *tuplesort;		/* bounded heap for Top-N */
+
+	/* stuff for CPU fallback */
+	pgstrom_data_store *fallback_pds; /* chunk being sorted on CPU */
+	TupleTableSlot *slot_x;
+	TupleTableSlot *slot_y;
+	HeapTupleData	tuple_x;
+	HeapTupleData	tuple_y;
+
+	/* run-time statistics */
+	cl_ulong		num_sorted_chunks;
+	cl_ulong		num_fallback_rows;
+} GpuSortState;
+
+/* static functions */
+static GpuTask *gpusort_next_task(GpuTaskState *gts);
+static int  gpusort_process_task(GpuTask *gtask, CUmodule cuda_module);
+static void gpusort_release_task(GpuTask *gtask);
+
+/*
+ * gpusort_lookup_limit
+ *
+ * It returns the number of rows to be fetched by LIMIT/OFFSET, if they are
+ * constant. root->limit_tuples is not available if query has aggregation,
+ * but LIMIT is still applied on the sorted result.
+ */
+static double
+gpusort_lookup_limit(PlannerInfo *root)
+{
+	Query	   *parse = root->parse;
+	Const	   *con;
+	double		limit_tuples;
+
+	if (!parse->limitCount || parse->hasTargetSRFs || parse->rowMarks)
+		return 0.0;
+	con = (Const *) parse->limitCount;
+	if (!IsA(con, Const) || con->constisnull)
+		return 0.0;
+	limit_tuples = (double) DatumGetInt64(con->constvalue);
+	if (parse->limitOffset)
+	{
+		con = (Const *) parse->limitOffset;
+		if (!IsA(con, Const))
+			return 0.0;
+		if (!con->constisnull)
+			limit_tuples += (double) DatumGetInt64(con->constvalue);
+	}
+	return (limit_tuples > 0.0 ? limit_tuples : 0.0);
+}
+
+/*
+ * gpusort_setup_sort_keys
+ *
+ * It checks whether the sort keys are executable on the device. Every key
+ * has to be an entry of the input target-list, so the outer node computes
+ * the keys and GpuSort references them as a plain column.
+ */
+static bool
+gpusort_setup_sort_keys(List *pathkeys,
+						PathTarget *target_input,
+						GpuSortInfo *gs_info)
+{
+	ListCell   *lc1, *lc2, *lc3;
+
+	foreach (lc1, pathkeys)
+	{
+		PathKey	   *pathkey = lfirst(lc1);
+		EquivalenceClass *ec = pathkey->pk_eclass;
+		EquivalenceMember *em = NULL;
+		TypeCacheEntry *tcache;
+		devtype_info *dtype;
+		Oid			sortop;
+		int			resno = 0;
+
+		if (ec->ec_has_volatile)
+			return false;
+		foreach (lc2, ec->ec_members)
+		{
+			em = lfirst(lc2);
+			if (em->em_is_const || em->em_is_child)
+				continue;
+			resno = 1;
+			foreach (lc3, target_input->exprs)
+			{
+				if (equal(em->em_expr, lfirst(lc3)))
+					break;
+				resno++;
+			}
+			if (lc3 != NULL)
+				break;
+			resno = 0;
+		}
+		if (resno == 0)
+			return false;
+
+		/* only default btree operator family is supported */
+		tcache = lookup_type_cache(em->em_datatype,
+								   TYPECACHE_BTREE_OPFAMILY);
+		if (tcache->btree_opf != pathkey->pk_opfamily)
+			return false;
+		if (pathkey->pk_strategy != BTLessStrategyNumber &&
+			pathkey->pk_strategy != BTGreaterStrategyNumber)
+			return false;
+		sortop = get_opfamily_member(pathkey->pk_opfamily,
+									 em->em_datatype,
+									 em->em_datatype,
+									 pathkey->pk_strategy);
+		if (!OidIsValid(sortop))
+			return false;
+		dtype = pgstrom_devtype_lookup(exprType((Node *)em->em_expr));
+		if (!dtype || !OidIsValid(dtype->type_cmpfunc))
+			return false;
+		if (!pgstrom_devfunc_lookup_type_compare(dtype, ec->ec_collation))
+			return false;
+
+		gs_info->key_attnos = lappend_int(gs_info->key_attnos, resno);
+		gs_info->key_sortops = lappend_oid(gs_info->key_sortops, sortop);
+		gs_info->key_collids = lappend_oid(gs_info->key_collids,
+										   ec->ec_collation);
+		gs_info->key_nulls_first = lappend_int(gs_info->key_nulls_first,
+											   pathkey->pk_nulls_first);
+	}
+	return true;
+}
+
+/*
+ * gpusort_add_ordered_paths
+ *
+ * entrypoint to add GpuSort path on the UPPERREL_ORDERED stage. It sorts
+ * each chunk of the input stream on the device, then merges the sorted
+ * chunks on CPU. If query has a constant LIMIT, only the top-N rows of
+ * each chunk are merged by the bounded heap.
+ */
+static void
+gpusort_add_ordered_paths(PlannerInfo *root,
+						  UpperRelationKind stage,
+						  RelOptInfo *input_rel,
+						  RelOptInfo *ordered_rel)
+{
+	PathTarget	   *target_ordered;
+	PathTarget	   *target_input;
+	Path		   *input_path;
+	CustomPath	   *cpath;
+	GpuSortInfo	   *gs_info;
+	int				num_keys;
+	double			nrows;
+	double			bound;
+	double			width;
+	double			chunk_nrows;
+	double			nchunks;
+	double			merge_nrows;
+	Cost			comparison_cost;
+	Cost			startup_cost;
+	Cost			run_cost;
+
+	if (create_upper_paths_next)
+		(*create_upper_paths_next)(root, stage, input_rel, ordered_rel);
+
+	if (stage != UPPERREL_ORDERED)
+		return;
+
+	if (!pgstrom_enabled || !enable_gpusort)
+		return;
+
+	if (root->sort_pathkeys == NIL)
+		return;
+	input_path = input_rel->cheapest_total_path;
+	if (pathkeys_contained_in(root->sort_pathkeys, input_path->pathkeys))
+		return;		/* already sorted */
+	target_input = input_path->pathtarget;
+
+	/* CPU projection cannot handle set-returning functions */
+	target_ordered = root->upper_targets[UPPERREL_ORDERED];
+	if (expression_returns_set((Node *)target_ordered->exprs))
+		return;
+
+	gs_info = palloc0(sizeof(GpuSortInfo));
+	if (!gpusort_setup_sort_keys(root->sort_pathkeys,
+								 target_input,
+								 gs_info))
+		return;
+	num_keys = list_length(gs_info->key_attnos);
+	bound = gpusort_lookup_limit(root);
+
+	/*
+	 * cost estimation; bitonic sorting of the chunks on the device, then
+	 * k-way merge (or bounded heap) of the sorted chunks on CPU.
+	 */
+	nrows = input_path->rows;
+	width = (MAXALIGN(target_input->width) +
+			 MAXALIGN(offsetof(kern_tupitem, htup) + SizeofHeapTupleHeader) +
+			 sizeof(cl_uint));
+	chunk_nrows = Max((double)pgstrom_chunk_size() / width, 1.0);
+	nchunks = Max(ceil(nrows / chunk_nrows), 1.0);
+	comparison_cost = 2.0 * cpu_operator_cost;
+
+	startup_cost = (input_path->total_cost +
+					pgstrom_gpu_setup_cost +
+					pgstrom_gpu_operator_cost * (double) num_keys * nrows *
+					LOG2(Max(Min(nrows, chunk_nrows), 2.0)) +
+					cost_for_dma_receive(input_rel, nrows));
+	if (bound > 0.0 && bound < chunk_nrows)
+	{
+		merge_nrows = nchunks * Min(bound, nrows);
+		startup_cost += comparison_cost * merge_nrows *
+			LOG2(Max(2.0 * bound, 2.0));
+	}
+	else
+	{
+		bound = 0.0;
+		if (nchunks > 1.0)
+			startup_cost += comparison_cost * nrows * LOG2(nchunks);
+	}
+	run_cost = cpu_tuple_cost * nrows;
+
+	gs_info->outer_nrows = nrows;
+	gs_info->bound = bound;
+
+	cpath = makeNode(CustomPath);
+	cpath->path.pathtype = T_CustomScan;
+	cpath->path.parent = ordered_rel;
+	cpath->path.pathtarget = target_ordered;
+	cpath->path.param_info = NULL;
+	cpath->path.parallel_aware = false;
+	cpath->path.parallel_safe = false;
+	cpath->path.parallel_workers = 0;
+	cpath->path.rows = nrows;
+	cpath->path.startup_cost = startup_cost;
+	cpath->path.total_cost = startup_cost + run_cost;
+	cpath->path.pathkeys = root->sort_pathkeys;
+	cpath->flags = 0;
+	cpath->custom_paths = list_make1(input_path);
+	cpath->custom_private = list_make1(gs_info);
+	cpath->methods = &gpusort_path_methods;
+
+	add_path(ordered_rel, &cpath->path);
+}
+
+/*
+ * gpusort_codegen_projection
+ *
+ * It makes a device function to load the sort keys from a row of the
+ * source chunk onto the slot.
+ */
+static void
+gpusort_codegen_projection(StringInfo kern,
+						   codegen_context *context,
+						   GpuSortInfo *gs_info,
+						   List *outer_tlist)
+{
+	StringInfoData	decl;
+	StringInfoData	body;
+	StringInfoData	temp;
+	Bitmapset	   *outer_refs = NULL;
+	ListCell	   *lc;
+	int				i, k, nattrs = list_length(outer_tlist);
+
+	initStringInfo(&decl);
+	initStringInfo(&body);
+	initStringInfo(&temp);
+
+	appendStringInfoString(
+		&decl,
+		"  void        *addr    __attribute__((unused));\n");
+
+	foreach (lc, gs_info->key_attnos)
+		outer_refs = bms_add_member(outer_refs, lfirst_int(lc));
+
+	/* extract the supplied tuple and load the keys */
+	appendStringInfoString(
+		&body,
+		"\n"
+		"  /* extract the given htup and load the keys */\n"
+		"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds_src, htup);\n");
+	for (i=1; i <= nattrs; i++)
+	{
+		if (bms_is_member(i, outer_refs))
+		{
+			TargetEntry	   *tle = list_nth(outer_tlist, i-1);
+			Oid				type_oid = exprType((Node *)tle->expr);
+			devtype_info   *dtype;
+
+			dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+			if (!dtype)
+				elog(ERROR, "device type lookup failed: %s",
+					 format_type_be(type_oid));
+			appendStringInfo(
+				&decl,
+				"  pg_%s_t KVAR_%u;\n",
+				dtype->type_name, i);
+			appendStringInfoString(&body, temp.data);
+			resetStringInfo(&temp);
+			appendStringInfo(
+				&body,
+				"  KVAR_%u = pg_%s_datum_ref(kcxt,addr);\n",
+				i, dtype->type_name);
+		}
+		appendStringInfoString(
+			&temp,
+			"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n");
+	}
+	appendStringInfoString(
+		&body,
+		"  EXTRACT_HEAP_TUPLE_END();\n");
+
+	/* put the keys on the slot */
+	k = 0;
+	foreach (lc, gs_info->key_attnos)
+	{
+		int				resno = lfirst_int(lc);
+		TargetEntry	   *tle = list_nth(outer_tlist, resno-1);
+		Oid				type_oid = exprType((Node *)tle->expr);
+		devtype_info   *dtype;
+
+		dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+		if (!dtype)
+			elog(ERROR, "device type lookup failed: %s",
+				 format_type_be(type_oid));
+		appendStringInfo(
+			&body,
+			"\n"
+			"  /* sort key %d (outer attribute %d) */\n"
+			"  dst_isnull[%d] = KVAR_%u.isnull;\n",
+			k + 1, resno,
+			k, resno);
+		if (dtype->type_byval)
+			appendStringInfo(
+				&body,
+				"  if (!KVAR_%u.isnull)\n"
+				"    dst_values[%d] = pg_%s_as_datum(&KVAR_%u.value);\n",
+				resno, k, dtype->type_name, resno);
+		else
+			appendStringInfo(
+				&body,
+				"  if (!KVAR_%u.isnull)\n"
+				"    dst_values[%d] = PointerGetDatum(KVAR_%u.value);\n",
+				resno, k, resno);
+		k++;
+	}
+
+	appendStringInfo(
+		kern,
+		"STATIC_FUNCTION(void)\n"
+		"gpusort_projection_row(kern_context *kcxt,\n"
+		"                       kern_data_store *kds_src,\n"
+		"                       HeapTupleHeaderData *htup,\n"
+		"                       Datum *dst_values,\n"
+		"                       cl_bool *dst_isnull)\n"
+		"{\n"
+		"%s"
+		"%s"
+		"}\n\n",
+		decl.data,
+		body.data);
+
+	pfree(decl.data);
+	pfree(body.data);
+	pfree(temp.data);
+}
+
+/*
+ * gpusort_codegen_keycomp
+ *
+ * It makes a device function to compare the sort keys of two rows on the
+ * slot, according to the direction and NULLS FIRST/LAST of the keys.
+ */
+static void
+gpusort_codegen_keycomp(StringInfo kern,
+						codegen_context *context,
+						GpuSortInfo *gs_info,
+						List *outer_tlist)
+{
+	ListCell   *lc1, *lc2, *lc3;
+	int			k = 0;
+
+	appendStringInfoString(
+		kern,
+		"STATIC_FUNCTION(cl_int)\n"
+		"gpusort_keycomp(kern_context *kcxt,\n"
+		"                kern_data_store *kds_slot,\n"
+		"                size_t x_index,\n"
+		"                size_t y_index)\n"
+		"{\n"
+		"  pg_anytype_t temp_x  __attribute__((unused));\n"
+		"  pg_anytype_t temp_y  __attribute__((unused));\n"
+		"  pg_int4_t    comp    __attribute__((unused));\n"
+		"  void        *datum   __attribute__((unused));\n"
+		"\n"
+		"  kern_context_reset_varlena(kcxt);\n");
+
+	forthree (lc1, gs_info->key_attnos,
+			  lc2, gs_info->key_sortops,
+			  lc3, gs_info->key_collids)
+	{
+		TargetEntry	   *tle = list_nth(outer_tlist, lfirst_int(lc1) - 1);
+		Oid				type_oid = exprType((Node *)tle->expr);
+		Oid				coll_oid = lfirst_oid(lc3);
+		bool			nulls_first = list_nth_int(gs_info->key_nulls_first, k);
+		bool			reverse;
+		Oid				opfamily;
+		Oid				opcintype;
+		int16			strategy;
+		devtype_info   *dtype;
+		devfunc_info   *dfunc;
+		devtype_info   *darg1;
+		devtype_info   *darg2;
+
+		if (!get_ordering_op_properties(lfirst_oid(lc2),
+										&opfamily, &opcintype, &strategy))
+			elog(ERROR, "operator %u is not a valid ordering operator",
+				 lfirst_oid(lc2));
+		reverse = (strategy == BTGreaterStrategyNumber);
+
+		/* find the function to compare this data-type */
+		dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+		if (!dtype)
+			elog(ERROR, "Bug? type (%s) is not supported at GPU",
+				 format_type_be(type_oid));
+		dfunc = pgstrom_devfunc_lookup_type_compare(dtype, coll_oid);
+		if (!dfunc)
+			elog(ERROR, "Bug? type (%s) has no device comparison function",
+				 format_type_be(type_oid));
+		pgstrom_devfunc_track(context, dfunc);
+		darg1 = linitial(dfunc->func_args);
+		darg2 = lsecond(dfunc->func_args);
+
+		appendStringInfo(
+			kern,
+			"\n"
+			"  /* sort key %d%s%s */\n"
+			"  datum = kern_get_datum_slot(kds_slot,%u,x_index);\n"
+			"  temp_x.%s_v = pg_%s_datum_ref(kcxt,datum);\n"
+			"  datum = kern_get_datum_slot(kds_slot,%u,y_index);\n"
+			"  temp_y.%s_v = pg_%s_datum_ref(kcxt,datum);\n"
+			"  if (!temp_x.%s_v.isnull && !temp_y.%s_v.isnull)\n"
+			"  {\n"
+			"    comp = pgfn_%s(kcxt, temp_x.%s_v, temp_y.%s_v);\n"
+			"    if (!comp.isnull && comp.value != 0)\n"
+			"      return (comp.value < 0 ? %d : %d);\n"
+			"  }\n"
+			"  else if (!temp_x.%s_v.isnull)\n"
+			"    return %d;\n"
+			"  else if (!temp_y.%s_v.isnull)\n"
+			"    return %d;\n",
+			k + 1,
+			reverse ? " DESC" : "",
+			nulls_first ? " NULLS FIRST" : " NULLS LAST",
+			k,
+			dtype->type_name, dtype->type_name,
+			k,
+			dtype->type_name, dtype->type_name,
+			dtype->type_name, dtype->type_name,
+			dfunc->func_devname, darg1->type_name, darg2->type_name,
+			reverse ? 1 : -1,
+			reverse ? -1 : 1,
+			dtype->type_name,
+			nulls_first ? 1 : -1,
+			dtype->type_name,
+			nulls_first ? -1 : 1);
+		k++;
+	}
+	appendStringInfoString(
+		kern,
+		"  return 0;\n"
+		"}\n\n");
+}
+
+/*
+ * PlanGpuSortPath
+ *
+ * Entrypoint to create CustomScan(GpuSort) node. The custom_scan_tlist is
+ * a copy of the outer target-list, and rows are returned as is, but sorted.
+ */
+static Plan *
+PlanGpuSortPath(PlannerInfo *root,
+				RelOptInfo *rel,
+				struct CustomPath *best_path,
+				List *tlist,
+				List *clauses,
+				List *custom_plans)
+{
+	CustomScan	   *cscan = makeNode(CustomScan);
+	GpuSortInfo	   *gs_info;
+	Plan		   *outer_plan;
+	List		   *tlist_dev = NIL;
+	ListCell	   *lc;
+	StringInfoData	kern;
+	codegen_context	context;
+
+	Assert(list_length(best_path->custom_private) == 1);
+	gs_info = linitial(best_path->custom_private);
+
+	Assert(list_length(custom_plans) == 1);
+	outer_plan = linitial(custom_plans);
+
+	foreach (lc, outer_plan->targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		tlist_dev = lappend(tlist_dev,
+							makeTargetEntry(copyObject(tle->expr),
+											list_length(tlist_dev) + 1,
+											NULL,
+											false));
+	}
+
+	/* setup CustomScan node */
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = NIL;
+	outerPlan(cscan) = outer_plan;
+	cscan->scan.scanrelid = 0;
+	cscan->flags = best_path->flags;
+	cscan->custom_scan_tlist = tlist_dev;
+	cscan->methods = &gpusort_scan_methods;
+
+	/*
+	 * construction of the GPU kernel code
+	 */
+	pgstrom_init_codegen_context(&context);
+	context.extra_flags |= DEVKERNEL_NEEDS_GPUSORT;
+	initStringInfo(&kern);
+	gpusort_codegen_projection(&kern, &context, gs_info,
+							   outer_plan->targetlist);
+	gpusort_codegen_keycomp(&kern, &context, gs_info,
+							outer_plan->targetlist);
+	gs_info->kern_source = kern.data;
+	gs_info->extra_flags = context.extra_flags;
+	gs_info->used_params = context.used_params;
+
+	form_gpusort_info(cscan, gs_info);
+
+	return &cscan->scan.plan;
+}
+
+/*
+ * pgstrom_path_is_gpusort
+ */
+bool
+pgstrom_path_is_gpusort(const Path *pathnode)
+{
+	if (IsA(pathnode, CustomPath) &&
+		pathnode->pathtype == T_CustomScan &&
+		((CustomPath *) pathnode)->methods == &gpusort_path_methods)
+		return true;
+	return false;
+}
+
+/*
+ * pgstrom_plan_is_gpusort
+ */
+bool
+pgstrom_plan_is_gpusort(const Plan *plan)
+{
+	if (IsA(plan, CustomScan) &&
+		((CustomScan *) plan)->methods == &gpusort_scan_methods)
+		return true;
+	return false;
+}
+
+/*
+ * pgstrom_planstate_is_gpusort
+ */
+bool
+pgstrom_planstate_is_gpusort(const PlanState *ps)
+{
+	if (IsA(ps, CustomScanState) &&
+		((CustomScanState *) ps)->methods == &gpusort_exec_methods)
+		return true;
+	return false;
+}
+
+/*
+ * CreateGpuSortScanState
+ */
+static Node *
+CreateGpuSortScanState(CustomScan *cscan)
+{
+	/*
+	 * NOTE: GpuSortState is referenced by the worker threads, so it must
+	 * be kept as long as the worker threads can live. See the comment at
+	 * CreateGpuPreAggScanState also.
+	 */
+	GpuSortState *gss = MemoryContextAllocZero(CurTransactionContext,
+											   sizeof(GpuSortState));
+	/* Set tag and executor callbacks */
+	NodeSetTag(gss, T_CustomScanState);
+	gss->gts.css.flags = cscan->flags;
+	gss->gts.css.methods = &gpusort_exec_methods;
+
+	return (Node *) gss;
+}
+
+/*
+ * gpusort_init_sort_keys
+ *
+ * It sets up the properties of the sort keys, the slots to compare the rows
+ * on CPU, and the template of kds_slot, according to the GpuSortInfo.
+ */
+static void
+gpusort_init_sort_keys(GpuSortState *gss, GpuSortInfo *gs_info,
+					   TupleDesc outer_tupdesc)
+{
+	TupleDesc		slot_tupdesc;
+	ListCell	   *lc1, *lc2, *lc3;
+	size_t			length;
+	int				index;
+
+	gss->num_keys = list_length(gs_info->key_attnos);
+	gss->bound = (cl_long) gs_info->bound;
+	gss->sortkeys = palloc0(sizeof(SortSupportData) * gss->num_keys);
+	gss->key_attnos = palloc0(sizeof(AttrNumber) * gss->num_keys);
+	gss->key_sortops = palloc0(sizeof(Oid) * gss->num_keys);
+	gss->key_collids = palloc0(sizeof(Oid) * gss->num_keys);
+	gss->key_nulls_first = palloc0(sizeof(bool) * gss->num_keys);
+	slot_tupdesc = CreateTemplateTupleDesc(gss->num_keys, false);
+	index = 0;
+	forthree (lc1, gs_info->key_attnos,
+			  lc2, gs_info->key_sortops,
+			  lc3, gs_info->key_collids)
+	{
+		SortSupport	ssup = &gss->sortkeys[index];
+		Form_pg_attribute attr = outer_tupdesc->attrs[lfirst_int(lc1) - 1];
+
+		gss->key_attnos[index] = lfirst_int(lc1);
+		gss->key_sortops[index] = lfirst_oid(lc2);
+		gss->key_collids[index] = lfirst_oid(lc3);
+		gss->key_nulls_first[index] = list_nth_int(gs_info->key_nulls_first,
+												   index);
+
+		ssup->ssup_cxt = CurrentMemoryContext;
+		ssup->ssup_collation = gss->key_collids[index];
+		ssup->ssup_nulls_first = gss->key_nulls_first[index];
+		ssup->ssup_attno = gss->key_attnos[index];
+		ssup->abbreviate = false;
+		PrepareSortSupportFromOrderingOp(gss->key_sortops[index], ssup);
+
+		TupleDescInitEntry(slot_tupdesc, (AttrNumber)(index + 1), NULL,
+						   attr->atttypid, attr->atttypmod, 0);
+		TupleDescInitEntryCollation(slot_tupdesc, (AttrNumber)(index + 1),
+									attr->attcollation);
+		index++;
+	}
+	gss->slot_x = MakeSingleTupleTableSlot(outer_tupdesc);
+	gss->slot_y = MakeSingleTupleTableSlot(outer_tupdesc);
+	gss->curr_run = -1;
+
+	/* Template of kds_slot */
+	length = STROMALIGN(offsetof(kern_data_store,
+								 colmeta[slot_tupdesc->natts]));
+	gss->kds_slot_head = MemoryContextAllocZero(CurTransactionContext,
+												length);
+	init_kernel_data_store(gss->kds_slot_head,
+						   slot_tupdesc,
+						   INT_MAX,		/* to be set individually */
+						   KDS_FORMAT_SLOT,
+						   INT_MAX);	/* to be set individually */
+}
+
+/*
+ * ExecInitGpuSort
+ */
+static void
+ExecInitGpuSort(CustomScanState *node, EState *estate, int eflags)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuSortInfo	   *gs_info = deform_gpusort_info(cscan);
+	PlanState	   *outer_ps;
+	TupleDesc		outer_tupdesc;
+	StringInfoData	kern_define;
+	ProgramId		program_id;
+	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
+
+	Assert(cscan->scan.scanrelid == 0 && outerPlan(cscan) != NULL);
+	/* activate a GpuContext for CUDA kernel execution */
+	gss->gts.gcontext = AllocGpuContext(-1, false);
+	if (!explain_only)
+		ActivateGpuContext(gss->gts.gcontext);
+
+	/* setup common GpuTaskState fields */
+	pgstromInitGpuTaskState(&gss->gts,
+							gss->gts.gcontext,
+							GpuTaskKind_GpuSort,
+							NIL,
+							gs_info->used_params,
+							estate);
+	gss->gts.cb_next_task       = gpusort_next_task;
+	gss->gts.cb_process_task    = gpusort_process_task;
+	gss->gts.cb_release_task    = gpusort_release_task;
+
+	/* initialization of the outer relation */
+	outer_ps = ExecInitNode(outerPlan(cscan), estate, eflags);
+	outerPlanState(gss) = outer_ps;
+	outer_tupdesc = ExecGetResultType(outer_ps);
+
+	/* properties of the sort keys */
+	gpusort_init_sort_keys(gss, gs_info, outer_tupdesc);
+
+	/* Get CUDA program and async build if any */
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gss->gts,
+							   gs_info->extra_flags);
+	program_id = pgstrom_create_cuda_program(gss->gts.gcontext,
+											 gs_info->extra_flags,
+											 gs_info->kern_source,
+											 kern_define.data,
+											 false,
+											 explain_only);
+	pfree(kern_define.data);
+	gss->gts.program_id = program_id;
+}
+
+/*
+ * gpusort_fetch_row - load a row of the chunk on the slot
+ */
+static TupleTableSlot *
+gpusort_fetch_row(pgstrom_data_store *pds, cl_uint index,
+				  HeapTuple tuple, TupleTableSlot *slot)
+{
+	kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(&pds->kds, index);
+
+	tuple->t_len = tupitem->t_len;
+	tuple->t_self = tupitem->t_self;
+	tuple->t_tableOid = InvalidOid;
+	tuple->t_data = &tupitem->htup;
+
+	return ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+}
+
+/*
+ * gpusort_compare_slots - compare the sort keys of two outer rows on CPU
+ */
+static int
+gpusort_compare_slots(GpuSortState *gss,
+					  TupleTableSlot *slot_x,
+					  TupleTableSlot *slot_y)
+{
+	int		k;
+
+	for (k=0; k < gss->num_keys; k++)
+	{
+		SortSupport	ssup = &gss->sortkeys[k];
+		Datum		x_datum, y_datum;
+		bool		x_isnull, y_isnull;
+		int			compare;
+
+		x_datum = slot_getattr(slot_x, ssup->ssup_attno, &x_isnull);
+		y_datum = slot_getattr(slot_y, ssup->ssup_attno, &y_isnull);
+		compare = ApplySortComparator(x_datum, x_isnull,
+									  y_datum, y_isnull,
+									  ssup);
+		if (compare != 0)
+			return compare;
+	}
+	return 0;
+}
+
+/*
+ * gpusort_create_task
+ */
+static GpuTask *
+gpusort_create_task(GpuSortState *gss, pgstrom_data_store *pds_src)
+{
+	GpuContext	   *gcontext = gss->gts.gcontext;
+	GpuSortTask	   *gstask;
+	kern_gpusort   *kgpusort;
+	cl_uint			nitems = pds_src->kds.nitems;
+	cl_uint			kparams_offset;
+	cl_uint			results_offset;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	Size			length;
+
+	kparams_offset = STROMALIGN(sizeof(kern_gpusort));
+	results_offset = kparams_offset +
+		STROMALIGN(gss->gts.kern_params->length);
+	length = offsetof(GpuSortTask, kern) + results_offset +
+		STROMALIGN(sizeof(cl_uint) * nitems);
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gstask = (GpuSortTask *)m_deviceptr;
+	memset(gstask, 0, offsetof(GpuSortTask, kern) + kparams_offset);
+
+	pgstromInitGpuTask(&gss->gts, &gstask->task);
+	gstask->pds_src = pds_src;
+
+	kgpusort = &gstask->kern;
+	kgpusort->nitems = nitems;
+	kgpusort->kparams_offset = kparams_offset;
+	kgpusort->results_offset = results_offset;
+	/* kern_parambuf */
+	memcpy(KERN_GPUSORT_PARAMBUF(kgpusort),
+		   gss->gts.kern_params,
+		   gss->gts.kern_params->length);
+
+	return &gstask->task;
+}
+
+/*
+ * gpusort_next_task
+ *
+ * callback to construct a new GpuSortTask task object based on the input
+ * stream. Chunks are sorted individually, so no order is kept over tasks.
+ */
+static GpuTask *
+gpusort_next_task(GpuTaskState *gts)
+{
+	GpuSortState   *gss = (GpuSortState *) gts;
+	PlanState	   *outer_ps = outerPlanState(gss);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	pgstrom_data_store *pds = NULL;
+	TupleTableSlot *slot;
+
+	while (true)
+	{
+		if (gss->gts.scan_overflow)
+		{
+			if (gss->gts.scan_overflow == (void *)(~0UL))
+				break;
+			slot = gss->gts.scan_overflow;
+			gss->gts.scan_overflow = NULL;
+		}
+		else
+		{
+			slot = ExecProcNode(outer_ps);
+			if (TupIsNull(slot))
+			{
+				gss->gts.scan_overflow = (void *)(~0UL);
+				break;
+			}
+		}
+
+		/* create a new data-store on demand */
+		if (!pds)
+		{
+			pds = PDS_create_row(gss->gts.gcontext,
+								 tupdesc,
+								 pgstrom_chunk_size());
+		}
+
+		if (!PDS_insert_tuple(pds, slot))
+		{
+			gss->gts.scan_overflow = slot;
+			break;
+		}
+	}
+	if (!pds)
+		return NULL;
+	return gpusort_create_task(gss, pds);
+}
+
+/*
+ * gpusort_launch_kernel
+ */
+static void
+gpusort_launch_kernel(CUfunction kern_func,
+					  size_t grid_sz,
+					  size_t block_sz,
+					  size_t shmem_sz,
+					  void **kern_args)
+{
+	CUresult	rc;
+
+	rc = cuLaunchKernel(kern_func,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						shmem_sz,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+}
+
+/*
+ * gpusort_process_task
+ */
+static int
+gpusort_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuSortTask	   *gstask = (GpuSortTask *) gtask;
+	GpuSortState   *gss = (GpuSortState *) gtask->gts;
+	GpuContext	   *gcontext = gss->gts.gcontext;
+	pgstrom_data_store *pds_src = gstask->pds_src;
+	kern_gpusort   *kgpusort = &gstask->kern;
+	kern_data_store *kds_slot_head = gss->kds_slot_head;
+	CUfunction		kern_setup_row;
+	CUfunction		kern_bitonic_local;
+	CUfunction		kern_bitonic_step;
+	CUfunction		kern_bitonic_merge;
+	CUdeviceptr		m_kgpusort = (CUdeviceptr)kgpusort;
+	CUdeviceptr		m_kds_src = (CUdeviceptr)&pds_src->kds;
+	CUdeviceptr		m_kds_slot = 0UL;
+	cl_uint			nitems = kgpusort->nitems;
+	size_t			kds_slot_length;
+	size_t			grid_sz;
+	size_t			block_sz;
+	size_t			__grid_sz;
+	size_t			__block_sz;
+	size_t			part_sz;
+	size_t			nparts;
+	size_t			i, j;
+	void		   *kern_args[4];
+	CUresult		rc;
+	int				retval = 1;
+
+	/*
+	 * Lookup kernel functions
+	 */
+	rc = cuModuleGetFunction(&kern_setup_row, cuda_module,
+							 "gpusort_setup_row");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_bitonic_local, cuda_module,
+							 "gpusort_bitonic_local");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_bitonic_step, cuda_module,
+							 "gpusort_bitonic_step");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_bitonic_merge, cuda_module,
+							 "gpusort_bitonic_merge");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/*
+	 * Device memory allocation for short term
+	 */
+	kds_slot_length = KERN_DATA_STORE_HEAD_LENGTH(kds_slot_head) +
+		STROMALIGN(LONGALIGN((sizeof(Datum) + sizeof(char)) *
+							 kds_slot_head->ncols) * nitems);
+	rc = gpuMemAllocManaged(gcontext,
+							&m_kds_slot,
+							kds_slot_length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		goto out_of_resource;
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	memcpy((void *)m_kds_slot, kds_slot_head,
+		   KERN_DATA_STORE_HEAD_LENGTH(kds_slot_head));
+	((kern_data_store *)m_kds_slot)->length = kds_slot_length;
+	((kern_data_store *)m_kds_slot)->nrooms = nitems;
+	((kern_data_store *)m_kds_slot)->nitems = nitems;
+
+	/*
+	 * OK, kick a series of GpuSort invocations
+	 */
+	pgstromTimeStatEventRecord(&gss->gts, CU_EVENT1_PER_THREAD);
+	rc = cuMemPrefetchAsync(m_kds_src,
+							pds_src->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	rc = cuMemPrefetchAsync(m_kgpusort,
+							KERN_GPUSORT_LENGTH(kgpusort),
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	pgstromTimeStatEventRecord(&gss->gts, CU_EVENT2_PER_THREAD);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * gpusort_setup_row(kern_gpusort *kgpusort,
+	 *                   kern_data_store *kds_src,
+	 *                   kern_data_store *kds_slot)
+	 */
+	largest_workgroup_size(&grid_sz,
+						   &block_sz,
+						   kern_setup_row,
+						   CU_DEVICE_PER_THREAD,
+						   nitems,
+						   0, 0);
+	kern_args[0] = &m_kgpusort;
+	kern_args[1] = &m_kds_src;
+	kern_args[2] = &m_kds_slot;
+	gpusort_launch_kernel(kern_setup_row, grid_sz, block_sz, 0, kern_args);
+
+	/*
+	 * Bitonic sorting of the results[]; block size must be power of 2, and
+	 * a block sorts 2 * block_sz items on the shared memory.
+	 */
+	if (nitems > 1)
+	{
+		largest_workgroup_size(&grid_sz,
+							   &block_sz,
+							   kern_bitonic_local,
+							   CU_DEVICE_PER_THREAD,
+							   (nitems + 1) / 2,
+							   0, 2 * sizeof(cl_uint));
+		largest_workgroup_size(&__grid_sz,
+							   &__block_sz,
+							   kern_bitonic_merge,
+							   CU_DEVICE_PER_THREAD,
+							   (nitems + 1) / 2,
+							   0, 2 * sizeof(cl_uint));
+		block_sz = Min(block_sz, __block_sz);
+		block_sz = 1UL << (get_next_log2(block_sz + 1) - 1);
+		part_sz = 2 * block_sz;
+		nparts = (nitems + part_sz - 1) / part_sz;
+
+		/*
+		 * KERNEL_FUNCTION_MAXTHREADS(void)
+		 * gpusort_bitonic_local(kern_gpusort *kgpusort,
+		 *                       kern_data_store *kds_slot)
+		 */
+		kern_args[0] = &m_kgpusort;
+		kern_args[1] = &m_kds_slot;
+		gpusort_launch_kernel(kern_bitonic_local,
+							  nparts, block_sz,
+							  sizeof(cl_uint) * part_sz,
+							  kern_args);
+
+		for (i = part_sz; i < nitems; i *= 2)
+		{
+			for (j = 2 * i; j > part_sz; j /= 2)
+			{
+				cl_uint		unitsz = j;
+				cl_bool		reversing = (j == 2 * i);
+				size_t		work_sz;
+
+				/*
+				 * KERNEL_FUNCTION_MAXTHREADS(void)
+				 * gpusort_bitonic_step(kern_gpusort *kgpusort,
+				 *                      kern_data_store *kds_slot,
+				 *                      cl_uint unitsz,
+				 *                      cl_bool reversing)
+				 */
+				work_sz = (((nitems + unitsz - 1) / unitsz) * unitsz / 2);
+				largest_workgroup_size(&__grid_sz,
+									   &__block_sz,
+									   kern_bitonic_step,
+									   CU_DEVICE_PER_THREAD,
+									   work_sz,
+									   0, 0);
+				kern_args[2] = &unitsz;
+				kern_args[3] = &reversing;
+				gpusort_launch_kernel(kern_bitonic_step,
+									  __grid_sz, __block_sz, 0,
+									  kern_args);
+			}
+
+			/*
+			 * KERNEL_FUNCTION_MAXTHREADS(void)
+			 * gpusort_bitonic_merge(kern_gpusort *kgpusort,
+			 *                       kern_data_store *kds_slot)
+			 */
+			gpusort_launch_kernel(kern_bitonic_merge,
+								  nparts, block_sz,
+								  sizeof(cl_uint) * part_sz,
+								  kern_args);
+		}
+	}
+
+	/* write back the results */
+	rc = cuMemPrefetchAsync(m_kgpusort,
+							KERN_GPUSORT_LENGTH(kgpusort),
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromTimeStatAddEvents(&gss->gts, GpuTaskPhase_DmaSend,
+							 CU_EVENT1_PER_THREAD, CU_EVENT2_PER_THREAD);
+	pgstromTimeStatAddEvents(&gss->gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
+
+	/*
+	 * Clear the error code if CPU fallback case.
+	 */
+	gstask->task.kerror = kgpusort->kerror;
+	if (pgstrom_cpu_fallback_enabled &&
+		gstask->task.kerror.errcode == StromError_CpuReCheck)
+	{
+		gstask->task.kerror.errcode = StromError_Success;
+		gstask->task.cpu_fallback = true;
+	}
+	retval = 0;
+
+out_of_resource:
+	if (m_kds_slot != 0UL)
+		gpuMemFree(gcontext, m_kds_slot);
+	return retval;
+}
+
+/*
+ * gpusort_fallback_compare - qsort_arg comparator for CPU fallback
+ */
+static int
+gpusort_fallback_compare(const void *a, const void *b, void *arg)
+{
+	GpuSortState   *gss = (GpuSortState *) arg;
+	pgstrom_data_store *pds = gss->fallback_pds;
+	TupleTableSlot *slot_x;
+	TupleTableSlot *slot_y;
+
+	slot_x = gpusort_fetch_row(pds, *((const cl_uint *) a),
+							   &gss->tuple_x, gss->slot_x);
+	slot_y = gpusort_fetch_row(pds, *((const cl_uint *) b),
+							   &gss->tuple_y, gss->slot_y);
+	return gpusort_compare_slots(gss, slot_x, slot_y);
+}
+
+/*
+ * gpusort_fallback_task
+ *
+ * It sorts the results[] of the chunk on CPU, if GPU kernel reported
+ * a CPU-recheck error.
+ */
+static void
+gpusort_fallback_task(GpuSortState *gss, GpuSortTask *gstask)
+{
+	kern_gpusort   *kgpusort = &gstask->kern;
+	cl_uint		   *results = KERN_GPUSORT_RESULTS(kgpusort);
+	cl_uint			nitems = kgpusort->nitems;
+	cl_uint			i;
+
+	for (i=0; i < nitems; i++)
+		results[i] = i;
+	gss->fallback_pds = gstask->pds_src;
+	qsort_arg(results, nitems, sizeof(cl_uint),
+			  gpusort_fallback_compare, gss);
+	gss->fallback_pds = NULL;
+	ExecClearTuple(gss->slot_x);
+	ExecClearTuple(gss->slot_y);
+
+	gss->num_fallback_rows += nitems;
+}
+
+/*
+ * gpusort_heap_compare - binaryheap comparator for k-way merge
+ *
+ * binaryheap is a max-heap, so the comparison is inverted to get the
+ * smallest run at the top, like nodeMergeAppend.c.
+ */
+static int32
+gpusort_heap_compare(Datum a, Datum b, void *arg)
+{
+	GpuSortState   *gss = (GpuSortState *) arg;
+	GpuSortRun	   *run_a = &gss->runs[DatumGetInt32(a)];
+	GpuSortRun	   *run_b = &gss->runs[DatumGetInt32(b)];
+
+	return -gpusort_compare_slots(gss, run_a->slot, run_b->slot);
+}
+
+/*
+ * gpusort_fetch_run - load the current row of the run
+ */
+static TupleTableSlot *
+gpusort_fetch_run(GpuSortRun *run)
+{
+	kern_gpusort   *kgpusort = &run->gstask->kern;
+	cl_uint		   *results = KERN_GPUSORT_RESULTS(kgpusort);
+
+	Assert(run->index < kgpusort->nitems);
+	return gpusort_fetch_row(run->gstask->pds_src,
+							 results[run->index],
+							 &run->tuple,
+							 run->slot);
+}
+
+/*
+ * gpusort_exec_sort
+ *
+ * It waits for completion of the sorting of all the chunks, then sets up
+ * either of k-way merge or bounded heap (Top-N) over the sorted chunks.
+ */
+static void
+gpusort_exec_sort(GpuSortState *gss)
+{
+	GpuTaskState   *gts = &gss->gts;
+	EState		   *estate = gts->css.ss.ps.state;
+	TupleDesc		outer_tupdesc = gss->slot_x->tts_tupleDescriptor;
+	GpuSortTask	   *gstask;
+	GpuTask		   *gtask;
+	MemoryContext	oldcxt;
+	cl_int			index;
+
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	if (gss->bound > 0)
+	{
+		gss->tuplesort = tuplesort_begin_heap(outer_tupdesc,
+											  gss->num_keys,
+											  gss->key_attnos,
+											  gss->key_sortops,
+											  gss->key_collids,
+											  gss->key_nulls_first,
+											  work_mem,
+											  false);
+		tuplesort_set_bound(gss->tuplesort, gss->bound);
+	}
+
+	while ((gtask = fetch_next_gputask(gts)) != NULL)
+	{
+		gstask = (GpuSortTask *) gtask;
+		if (gtask->cpu_fallback)
+		{
+			instr_time	tv_start;
+
+			gts->num_cpu_fallbacks++;
+			if (gts->tm_stat)
+				INSTR_TIME_SET_CURRENT(tv_start);
+			gpusort_fallback_task(gss, gstask);
+			if (gts->tm_stat)
+				pgstromTimeStatAddElapsed(gts, GpuTaskPhase_CpuFallback,
+										  &tv_start);
+		}
+		gss->num_sorted_chunks++;
+
+		if (gss->tuplesort)
+		{
+			cl_uint	   *results = KERN_GPUSORT_RESULTS(&gstask->kern);
+			cl_uint		nitems = gstask->kern.nitems;
+			cl_uint		i;
+
+			/* only top-N rows of the chunk can appear in the result */
+			if (nitems > gss->bound)
+				nitems = gss->bound;
+			for (i=0; i < nitems; i++)
+			{
+				TupleTableSlot *slot;
+
+				slot = gpusort_fetch_row(gstask->pds_src, results[i],
+										 &gss->tuple_x, gss->slot_x);
+				tuplesort_puttupleslot(gss->tuplesort, slot);
+			}
+			ExecClearTuple(gss->slot_x);
+			gts->cb_release_task(gtask);
+		}
+		else if (gstask->kern.nitems == 0)
+			gts->cb_release_task(gtask);
+		else
+		{
+			GpuSortRun *run;
+
+			if (gss->num_runs == gss->max_runs)
+			{
+				gss->max_runs = Max(2 * gss->max_runs, 32);
+				if (!gss->runs)
+					gss->runs = palloc0(sizeof(GpuSortRun) * gss->max_runs);
+				else
+					gss->runs = repalloc(gss->runs,
+										 sizeof(GpuSortRun) * gss->max_runs);
+			}
+			run = &gss->runs[gss->num_runs++];
+			run->gstask = gstask;
+			run->index = 0;
+			run->slot = MakeSingleTupleTableSlot(outer_tupdesc);
+		}
+	}
+
+	if (gss->tuplesort)
+		tuplesort_performsort(gss->tuplesort);
+	else
+	{
+		gss->heap = binaryheap_allocate(Max(gss->num_runs, 1),
+										gpusort_heap_compare,
+										gss);
+		for (index=0; index < gss->num_runs; index++)
+		{
+			gpusort_fetch_run(&gss->runs[index]);
+			binaryheap_add_unordered(gss->heap, Int32GetDatum(index));
+		}
+		binaryheap_build(gss->heap);
+	}
+	gss->curr_run = -1;
+	gss->sort_done = true;
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * gpusort_exec_scan
+ *
+ * It returns the next row of the sorted result. Rows are referenced on
+ * the chunks as is, so a run is advanced on the next call, and chunks are
+ * kept until end of the scan.
+ */
+static TupleTableSlot *
+gpusort_exec_scan(GpuSortState *gss)
+{
+	TupleTableSlot *slot = gss->gts.css.ss.ss_ScanTupleSlot;
+	GpuSortRun	   *run;
+
+	if (!gss->sort_done)
+		gpusort_exec_sort(gss);
+
+	if (gss->tuplesort)
+	{
+#if PG_VERSION_NUM < 100000
+		if (!tuplesort_gettupleslot(gss->tuplesort, true, slot, NULL))
+#else
+		if (!tuplesort_gettupleslot(gss->tuplesort, true, false, slot, NULL))
+#endif
+			return NULL;
+		return slot;
+	}
+
+	/* advance the run of the last tuple */
+	if (gss->curr_run >= 0)
+	{
+		run = &gss->runs[gss->curr_run];
+		if (++run->index < run->gstask->kern.nitems)
+		{
+			gpusort_fetch_run(run);
+			binaryheap_replace_first(gss->heap,
+									 Int32GetDatum(gss->curr_run));
+		}
+		else
+		{
+			ExecClearTuple(run->slot);
+			(void) binaryheap_remove_first(gss->heap);
+		}
+		gss->curr_run = -1;
+	}
+	if (binaryheap_empty(gss->heap))
+		return NULL;
+
+	gss->curr_run = DatumGetInt32(binaryheap_first(gss->heap));
+	run = &gss->runs[gss->curr_run];
+	return ExecStoreTuple(&run->tuple, slot, InvalidBuffer, false);
+}
+
+/*
+ * gpusort_release_runs
+ */
+static void
+gpusort_release_runs(GpuSortState *gss)
+{
+	GpuTaskState   *gts = &gss->gts;
+	cl_int			index;
+
+	for (index=0; index < gss->num_runs; index++)
+	{
+		GpuSortRun *run = &gss->runs[index];
+
+		ExecDropSingleTupleTableSlot(run->slot);
+		gts->cb_release_task(&run->gstask->task);
+	}
+	gss->num_runs = 0;
+	if (gss->heap)
+	{
+		binaryheap_free(gss->heap);
+		gss->heap = NULL;
+	}
+	if (gss->tuplesort)
+	{
+		tuplesort_end(gss->tuplesort);
+		gss->tuplesort = NULL;
+	}
+	gss->curr_run = -1;
+	gss->sort_done = false;
+}
+
+/*
+ * ExecReCheckGpuSort
+ */
+static bool
+ExecReCheckGpuSort(CustomScanState *node, TupleTableSlot *slot)
+{
+	/*
+	 * GpuSort shall be never located under the LockRows, so we don't
+	 * expect that we need to have valid EPQ recheck here.
+	 */
+	return true;
+}
+
+/*
+ * ExecGpuSort
+ */
+static TupleTableSlot *
+ExecGpuSort(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) gpusort_exec_scan,
+					(ExecScanRecheckMtd) ExecReCheckGpuSort);
+}
+
+/*
+ * ExecEndGpuSort
+ */
+static void
+ExecEndGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gss->gts.gcontext);
+	ExecClearTuple(gss->gts.css.ss.ss_ScanTupleSlot);
+	gpusort_release_runs(gss);
+	/* clean up subtree */
+	ExecEndNode(outerPlanState(node));
+
+	/* release any other resources */
+	if (gss->slot_x)
+		ExecDropSingleTupleTableSlot(gss->slot_x);
+	if (gss->slot_y)
+		ExecDropSingleTupleTableSlot(gss->slot_y);
+	pgstromReleaseGpuTaskState(&gss->gts);
+}
+
+/*
+ * ExecReScanGpuSort
+ */
+static void
+ExecReScanGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gss->gts.gcontext);
+	ExecClearTuple(gss->gts.css.ss.ss_ScanTupleSlot);
+	gpusort_release_runs(gss);
+	/* common rescan handling */
+	pgstromRescanGpuTaskState(&gss->gts);
+	/* reset other stuff */
+	gss->gts.scan_done = false;
+	gss->gts.scan_overflow = NULL;
+	/* also rescan subtree */
+	ExecReScan(outerPlanState(node));
+}
+
+/*
+ * ExplainGpuSort
+ */
+static void
+ExplainGpuSort(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	List		   *dcontext;
+	List		   *sort_keys = NIL;
+	StringInfoData	buf;
+	int				k;
+
+	/* Set up deparsing context */
+	dcontext = set_deparse_context_planstate(es->deparse_cxt,
+											 (Node *)&gss->gts.css.ss.ps,
+											 ancestors);
+	/* Show sort keys, like show_sort_group_keys() */
+	initStringInfo(&buf);
+	for (k=0; k < gss->num_keys; k++)
+	{
+		SortSupport	ssup = &gss->sortkeys[k];
+		TargetEntry *tle = list_nth(cscan->custom_scan_tlist,
+									ssup->ssup_attno - 1);
+		Var		   *var;
+
+		var = makeVar(INDEX_VAR,
+					  tle->resno,
+					  exprType((Node *)tle->expr),
+					  exprTypmod((Node *)tle->expr),
+					  exprCollation((Node *)tle->expr),
+					  0);
+		resetStringInfo(&buf);
+		appendStringInfoString(&buf, deparse_expression((Node *)var,
+														dcontext,
+														es->verbose,
+														false));
+		if (ssup->ssup_reverse)
+			appendStringInfoString(&buf, " DESC");
+		if (ssup->ssup_nulls_first != ssup->ssup_reverse)
+			appendStringInfoString(&buf, ssup->ssup_nulls_first
+								   ? " NULLS FIRST"
+								   : " NULLS LAST");
+		sort_keys = lappend(sort_keys, pstrdup(buf.data));
+	}
+	ExplainPropertyList("Sort Key", sort_keys, es);
+	if (gss->bound > 0)
+		ExplainPropertyLong("Top-N", gss->bound, es);
+
+	/* other common fields */
+	pgstromExplainGpuTaskState(&gss->gts, es);
+	/* other run-time statistics, if any */
+	if (es->analyze)
+		ExplainPropertyLong("Num of sorted chunks",
+							gss->num_sorted_chunks, es);
+	if (gss->num_fallback_rows > 0)
+		ExplainPropertyLong("Num of CPU fallback rows",
+							gss->num_fallback_rows, es);
+	pfree(buf.data);
+}
+
+/*
+ * gpusort_release_task
+ */
+static void
+gpusort_release_task(GpuTask *gtask)
+{
+	GpuSortTask	   *gstask = (GpuSortTask *)gtask;
+	GpuContext	   *gcontext = gtask->gts->gcontext;
+
+	if (gstask->pds_src)
+		PDS_release(gstask->pds_src);
+	gpuMemFree(gcontext, (CUdeviceptr)gstask);
+}
+
+/*
+ * GpuSortClusterState
+ *
+ * A dummy GpuSortState to rewrite a table in order of the index keys, like
+ * CLUSTER command. It has no CustomScan, then the input stream is the heap
+ * scan of the table using SnapshotAny. The heap rewrite and visibility
+ * handling follow copy_heap_data() at commands/cluster.c.
+ */
+typedef struct
+{
+	GpuSortState	gss;			/* must be the first */
+	CustomScan	   *cscan;			/* dummy */
+	EState		   *estate;			/* dummy */
+	Relation		old_heap;
+	HeapScanDesc	scan;
+	TupleTableSlot *scan_slot;
+	RewriteState	rwstate;
+	TransactionId	OldestXmin;
+	double			num_tuples;
+	double			tups_vacuumed;
+	double			tups_recently_dead;
+} GpuSortClusterState;
+
+/*
+ * gpusort_cluster_setup_keys
+ *
+ * It sets up GpuSortInfo according to the btree index. Only simple column
+ * references with default btree operator family of the data type, which
+ * has device comparison function, are supported.
+ */
+static GpuSortInfo *
+gpusort_cluster_setup_keys(Relation old_heap, Relation old_index)
+{
+	TupleDesc		tupdesc = RelationGetDescr(old_heap);
+	GpuSortInfo	   *gs_info = palloc0(sizeof(GpuSortInfo));
+	int				k, nkeys = IndexRelationGetNumberOfAttributes(old_index);
+
+	if (old_index->rd_rel->relam != BTREE_AM_OID)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("GpuSort supports only btree index: \"%s\"",
+						RelationGetRelationName(old_index))));
+
+	for (k=0; k < nkeys; k++)
+	{
+		AttrNumber		anum = old_index->rd_index->indkey.values[k];
+		Oid				opfamily = old_index->rd_opfamily[k];
+		Oid				opcintype = old_index->rd_opcintype[k];
+		int16			indoption = old_index->rd_indoption[k];
+		Oid				collid = old_index->rd_indcollation[k];
+		Form_pg_attribute attr;
+		TypeCacheEntry *tcache;
+		devtype_info   *dtype;
+		Oid				sortop;
+
+		if (anum <= 0 || anum > tupdesc->natts)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("GpuSort does not support expression index: \"%s\"",
+							RelationGetRelationName(old_index))));
+		attr = tupdesc->attrs[anum - 1];
+
+		/* only default btree operator family is supported */
+		tcache = lookup_type_cache(attr->atttypid,
+								   TYPECACHE_BTREE_OPFAMILY);
+		sortop = get_opfamily_member(opfamily, opcintype, opcintype,
+									 (indoption & INDOPTION_DESC) != 0
+									 ? BTGreaterStrategyNumber
+									 : BTLessStrategyNumber);
+		dtype = pgstrom_devtype_lookup(attr->atttypid);
+		if (tcache->btree_opf != opfamily ||
+			!OidIsValid(sortop) ||
+			!dtype || !OidIsValid(dtype->type_cmpfunc) ||
+			!pgstrom_devfunc_lookup_type_compare(dtype, collid))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("GpuSort cannot compare \"%s\" of \"%s\" on GPU",
+							NameStr(attr->attname),
+							RelationGetRelationName(old_heap))));
+
+		gs_info->key_attnos = lappend_int(gs_info->key_attnos, anum);
+		gs_info->key_sortops = lappend_oid(gs_info->key_sortops, sortop);
+		gs_info->key_collids = lappend_oid(gs_info->key_collids, collid);
+		gs_info->key_nulls_first = lappend_int(gs_info->key_nulls_first,
+									(indoption & INDOPTION_NULLS_FIRST) != 0);
+	}
+	return gs_info;
+}
+
+/*
+ * gpusort_cluster_next_task
+ *
+ * callback to load the next chunk from the heap scan. Dead tuples are not
+ * sorted, but the heap rewrite module still needs to see them.
+ */
+static GpuTask *
+gpusort_cluster_next_task(GpuTaskState *gts)
+{
+	GpuSortClusterState *gcs = (GpuSortClusterState *) gts;
+	Relation		old_heap = gcs->old_heap;
+	pgstrom_data_store *pds = NULL;
+	HeapTuple		tuple;
+	Buffer			buf;
+	bool			isdead;
+
+	while (true)
+	{
+		if (gts->scan_overflow)
+		{
+			if (gts->scan_overflow == (void *)(~0UL))
+				break;
+			gts->scan_overflow = NULL;
+		}
+		else
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			tuple = heap_getnext(gcs->scan, ForwardScanDirection);
+			if (!tuple)
+			{
+				gts->scan_overflow = (void *)(~0UL);
+				break;
+			}
+			buf = gcs->scan->rs_cbuf;
+
+			LockBuffer(buf, BUFFER_LOCK_SHARE);
+			switch (HeapTupleSatisfiesVacuum(tuple, gcs->OldestXmin, buf))
+			{
+				case HEAPTUPLE_DEAD:
+					isdead = true;
+					break;
+				case HEAPTUPLE_RECENTLY_DEAD:
+					gcs->tups_recently_dead += 1;
+					/* fall through */
+				case HEAPTUPLE_LIVE:
+					isdead = false;
+					break;
+				case HEAPTUPLE_INSERT_IN_PROGRESS:
+					if (!TransactionIdIsCurrentTransactionId(
+							HeapTupleHeaderGetXmin(tuple->t_data)))
+						elog(WARNING, "concurrent insert in progress within table \"%s\"",
+							 RelationGetRelationName(old_heap));
+					isdead = false;
+					break;
+				case HEAPTUPLE_DELETE_IN_PROGRESS:
+					if (!TransactionIdIsCurrentTransactionId(
+							HeapTupleHeaderGetUpdateXid(tuple->t_data)))
+						elog(WARNING, "concurrent delete in progress within table \"%s\"",
+							 RelationGetRelationName(old_heap));
+					gcs->tups_recently_dead += 1;
+					isdead = false;
+					break;
+				default:
+					elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+					isdead = false;		/* keep compiler quiet */
+					break;
+			}
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+			if (isdead)
+			{
+				gcs->tups_vacuumed += 1;
+				if (rewrite_heap_dead_tuple(gcs->rwstate, tuple))
+				{
+					/* A previous recently-dead tuple is now known dead */
+					gcs->tups_vacuumed += 1;
+					gcs->tups_recently_dead -= 1;
+				}
+				continue;
+			}
+			/* scan_slot keeps the buffer pinned, even if overflow */
+			ExecStoreTuple(tuple, gcs->scan_slot, buf, false);
+		}
+
+		/* create a new data-store on demand */
+		if (!pds)
+		{
+			pds = PDS_create_row(gts->gcontext,
+								 RelationGetDescr(old_heap),
+								 pgstrom_chunk_size());
+		}
+
+		if (!PDS_insert_tuple(pds, gcs->scan_slot))
+		{
+			gts->scan_overflow = gcs->scan_slot;
+			break;
+		}
+		gcs->num_tuples += 1;
+	}
+	if (!pds)
+		return NULL;
+	return gpusort_create_task(&gcs->gss, pds);
+}
+
+/*
+ * gpusort_cluster_begin
+ *
+ * It sets up GpuSortClusterState, and builds GPU kernel to sort the table
+ * by the index keys.
+ */
+static GpuSortClusterState *
+gpusort_cluster_begin(Relation old_heap, Relation old_index)
+{
+	TupleDesc		tupdesc = RelationGetDescr(old_heap);
+	GpuSortClusterState *gcs;
+	GpuSortState   *gss;
+	GpuSortInfo	   *gs_info;
+	List		   *outer_tlist = NIL;
+	StringInfoData	kern;
+	StringInfoData	kern_define;
+	codegen_context	context;
+	int				j;
+
+	gs_info = gpusort_cluster_setup_keys(old_heap, old_index);
+
+	/* construction of the GPU kernel code */
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+
+		outer_tlist = lappend(outer_tlist,
+							  makeTargetEntry((Expr *)makeVar(1,
+															  attr->attnum,
+															  attr->atttypid,
+															  attr->atttypmod,
+															  attr->attcollation,
+															  0),
+											  attr->attnum,
+											  NULL,
+											  false));
+	}
+	pgstrom_init_codegen_context(&context);
+	context.extra_flags |= DEVKERNEL_NEEDS_GPUSORT;
+	initStringInfo(&kern);
+	gpusort_codegen_projection(&kern, &context, gs_info, outer_tlist);
+	gpusort_codegen_keycomp(&kern, &context, gs_info, outer_tlist);
+
+	/*
+	 * NOTE: GpuSortState is referenced by the worker threads, so it must
+	 * be kept as long as the worker threads can live, like PL/CUDA.
+	 */
+	gcs = MemoryContextAllocZero(CurTransactionContext,
+								 sizeof(GpuSortClusterState));
+	gss = &gcs->gss;
+	gcs->cscan = makeNode(CustomScan);
+	gcs->estate = CreateExecutorState();
+	gcs->estate->es_snapshot = SnapshotAny;
+	gss->gts.css.ss.ps.plan = &gcs->cscan->scan.plan;
+	gss->gts.css.ss.ps.state = gcs->estate;
+	gss->gts.css.ss.ps.ps_ExprContext = CreateExprContext(gcs->estate);
+	gss->gts.css.ss.ss_ScanTupleSlot = MakeSingleTupleTableSlot(tupdesc);
+
+	/* activate a GpuContext for CUDA kernel execution */
+	gss->gts.gcontext = AllocGpuContext(-1, false);
+	ActivateGpuContext(gss->gts.gcontext);
+	pgstromInitGpuTaskState(&gss->gts,
+							gss->gts.gcontext,
+							GpuTaskKind_GpuSort,
+							NIL,
+							NIL,
+							gcs->estate);
+	gss->gts.cb_next_task       = gpusort_cluster_next_task;
+	gss->gts.cb_process_task    = gpusort_process_task;
+	gss->gts.cb_release_task    = gpusort_release_task;
+	gpusort_init_sort_keys(gss, gs_info, tupdesc);
+
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gss->gts,
+							   context.extra_flags);
+	gss->gts.program_id = pgstrom_create_cuda_program(gss->gts.gcontext,
+													  context.extra_flags,
+													  kern.data,
+													  kern_define.data,
+													  true,
+													  false);
+	pfree(kern_define.data);
+	pfree(kern.data);
+
+	gcs->scan_slot = MakeSingleTupleTableSlot(tupdesc);
+
+	return gcs;
+}
+
+/*
+ * gpusort_cluster_end
+ */
+static void
+gpusort_cluster_end(GpuSortClusterState *gcs)
+{
+	GpuSortState   *gss = &gcs->gss;
+
+	SynchronizeGpuContext(gss->gts.gcontext);
+	ExecDropSingleTupleTableSlot(gss->gts.css.ss.ss_ScanTupleSlot);
+	gpusort_release_runs(gss);
+	ExecDropSingleTupleTableSlot(gss->slot_x);
+	ExecDropSingleTupleTableSlot(gss->slot_y);
+	ExecDropSingleTupleTableSlot(gcs->scan_slot);
+	pgstromReleaseGpuTaskState(&gss->gts);
+	FreeExecutorState(gcs->estate);
+}
+
+/*
+ * gpusort_reform_and_rewrite_tuple - same as reform_and_rewrite_tuple()
+ */
+static void
+gpusort_reform_and_rewrite_tuple(HeapTuple tuple,
+								 TupleDesc oldTupDesc,
+								 TupleDesc newTupDesc,
+								 Datum *values,
+								 bool *isnull,
+								 bool newRelHasOids,
+								 RewriteState rwstate)
+{
+	HeapTuple	copiedTuple;
+	int			i;
+
+	heap_deform_tuple(tuple, oldTupDesc, values, isnull);
+
+	/* Be sure to null out any dropped columns */
+	for (i=0; i < newTupDesc->natts; i++)
+	{
+		if (newTupDesc->attrs[i]->attisdropped)
+			isnull[i] = true;
+	}
+	copiedTuple = heap_form_tuple(newTupDesc, values, isnull);
+
+	/* Preserve OID, if any */
+	if (newRelHasOids)
+		HeapTupleSetOid(copiedTuple, HeapTupleGetOid(tuple));
+
+	/* The heap rewrite module does the rest */
+	rewrite_heap_tuple(rwstate, tuple, copiedTuple);
+
+	heap_freetuple(copiedTuple);
+}
+
+/*
+ * gpusort_copy_heap_data
+ *
+ * It copies the tuples of the old heap to the new heap in order of the
+ * index keys, sorted by GPU.
+ */
+static double
+gpusort_copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
+					   bool *pSwapToastByContent,
+					   TransactionId *pFreezeXid,
+					   MultiXactId *pCutoffMulti)
+{
+	Relation		NewHeap;
+	Relation		OldHeap;
+	Relation		OldIndex;
+	Relation		relRelation;
+	TupleDesc		oldTupDesc;
+	TupleDesc		newTupDesc;
+	Datum		   *values;
+	bool		   *isnull;
+	TransactionId	OldestXmin;
+	TransactionId	FreezeXid;
+	MultiXactId		MultiXactCutoff;
+	bool			use_wal;
+	BlockNumber		num_pages;
+	HeapTuple		reltup;
+	Form_pg_class	relform;
+	GpuSortClusterState *gcs;
+	TupleTableSlot *slot;
+	double			num_tuples;
+
+	/* Open relations */
+	NewHeap = heap_open(OIDNewHeap, AccessExclusiveLock);
+	OldHeap = heap_open(OIDOldHeap, AccessExclusiveLock);
+	OldIndex = index_open(OIDOldIndex, AccessExclusiveLock);
+	oldTupDesc = RelationGetDescr(OldHeap);
+	newTupDesc = RelationGetDescr(NewHeap);
+	Assert(newTupDesc->natts == oldTupDesc->natts);
+
+	/* Preallocate values/isnull arrays */
+	values = palloc(sizeof(Datum) * newTupDesc->natts);
+	isnull = palloc(sizeof(bool) * newTupDesc->natts);
+
+	/*
+	 * If both tables have TOAST tables, perform toast swap by content;
+	 * see the comment at copy_heap_data().
+	 */
+	if (OldHeap->rd_rel->reltoastrelid)
+		LockRelationOid(OldHeap->rd_rel->reltoastrelid, AccessExclusiveLock);
+	if (OldHeap->rd_rel->reltoastrelid && NewHeap->rd_rel->reltoastrelid)
+	{
+		*pSwapToastByContent = true;
+		NewHeap->rd_toastoid = OldHeap->rd_rel->reltoastrelid;
+	}
+	else
+		*pSwapToastByContent = false;
+
+	use_wal = XLogIsNeeded() && RelationNeedsWAL(NewHeap);
+	Assert(RelationGetTargetBlock(NewHeap) == InvalidBlockNumber);
+
+	/* Compute xids used to freeze and weed out dead tuples */
+	vacuum_set_xid_limits(OldHeap, 0, 0, 0, 0,
+						  &OldestXmin, &FreezeXid, NULL,
+						  &MultiXactCutoff, NULL);
+	if (TransactionIdPrecedes(FreezeXid, OldHeap->rd_rel->relfrozenxid))
+		FreezeXid = OldHeap->rd_rel->relfrozenxid;
+	if (MultiXactIdPrecedes(MultiXactCutoff, OldHeap->rd_rel->relminmxid))
+		MultiXactCutoff = OldHeap->rd_rel->relminmxid;
+	*pFreezeXid = FreezeXid;
+	*pCutoffMulti = MultiXactCutoff;
+
+	/* setup GpuSort, then kick the heap scan and sorting */
+	gcs = gpusort_cluster_begin(OldHeap, OldIndex);
+	gcs->old_heap = OldHeap;
+	gcs->OldestXmin = OldestXmin;
+	gcs->rwstate = begin_heap_rewrite(OldHeap, NewHeap, OldestXmin,
+									  FreezeXid, MultiXactCutoff, use_wal);
+	gcs->scan = heap_beginscan(OldHeap, SnapshotAny, 0, (ScanKey) NULL);
+
+	/* write out the sorted tuples */
+	while ((slot = gpusort_exec_scan(&gcs->gss)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		gpusort_reform_and_rewrite_tuple(slot->tts_tuple,
+										 oldTupDesc,
+										 newTupDesc,
+										 values,
+										 isnull,
+										 NewHeap->rd_rel->relhasoids,
+										 gcs->rwstate);
+	}
+	heap_endscan(gcs->scan);
+	end_heap_rewrite(gcs->rwstate);
+	num_tuples = gcs->num_tuples;
+
+	ereport(DEBUG2,
+			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions, %.0f dead row versions cannot be removed yet, %lu chunks sorted by GPU",
+					RelationGetRelationName(OldHeap),
+					gcs->tups_vacuumed, gcs->num_tuples,
+					gcs->tups_recently_dead,
+					gcs->gss.num_sorted_chunks)));
+	gpusort_cluster_end(gcs);
+
+	/* Reset rd_toastoid just to be tidy */
+	NewHeap->rd_toastoid = InvalidOid;
+	num_pages = RelationGetNumberOfBlocks(NewHeap);
+
+	pfree(values);
+	pfree(isnull);
+	index_close(OldIndex, NoLock);
+	heap_close(OldHeap, NoLock);
+	heap_close(NewHeap, NoLock);
+
+	/* Update pg_class to reflect the correct values of pages and tuples */
+	relRelation = heap_open(RelationRelationId, RowExclusiveLock);
+	reltup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(OIDNewHeap));
+	if (!HeapTupleIsValid(reltup))
+		elog(ERROR, "cache lookup failed for relation %u", OIDNewHeap);
+	relform = (Form_pg_class) GETSTRUCT(reltup);
+	relform->relpages = num_pages;
+	relform->reltuples = num_tuples;
+#if PG_VERSION_NUM < 100000
+	simple_heap_update(relRelation, &reltup->t_self, reltup);
+	CatalogUpdateIndexes(relRelation, reltup);
+#else
+	CatalogTupleUpdate(relRelation, &reltup->t_self, reltup);
+#endif
+	heap_freetuple(reltup);
+	heap_close(relRelation, RowExclusiveLock);
+
+	/* Make the update visible */
+	CommandCounterIncrement();
+
+	return num_tuples;
+}
+
+/*
+ * pgstrom_gpusort_cluster
+ *
+ * pgstrom_gpusort_cluster(regclass, regclass) rewrites the table in order
+ * of the supplied btree index, like CLUSTER command, but the tuples are
+ * sorted by GPU. Then, all the indexes are rebuilt on the sorted heap, so
+ * the tuplesort of the index build on the index keys receives pre-sorted
+ * input.
+ */
+Datum
+pgstrom_gpusort_cluster(PG_FUNCTION_ARGS)
+{
+	Oid			table_oid = PG_GETARG_OID(0);
+	Oid			index_oid = PG_GETARG_OID(1);
+	Relation	OldHeap;
+	Oid			OIDNewHeap;
+	Oid			tablespace;
+	char		relpersistence;
+	bool		swap_toast_by_content;
+	TransactionId frozenXid;
+	MultiXactId	cutoffMulti;
+	double		num_tuples;
+
+	if (!pgstrom_enabled || !enable_gpusort)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("GpuSort is disabled")));
+
+	OldHeap = heap_open(table_oid, AccessExclusiveLock);
+	if (!pg_class_ownercheck(table_oid, GetUserId()))
+		aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS,
+					   RelationGetRelationName(OldHeap));
+	if (OldHeap->rd_rel->relkind != RELKIND_RELATION &&
+		OldHeap->rd_rel->relkind != RELKIND_MATVIEW)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table or materialized view",
+						RelationGetRelationName(OldHeap))));
+	if (IsSystemRelation(OldHeap))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("GpuSort does not support system catalog: \"%s\"",
+						RelationGetRelationName(OldHeap))));
+	if (RELATION_IS_OTHER_TEMP(OldHeap))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot cluster temporary tables of other sessions")));
+	if (IndexGetRelation(index_oid, false) != table_oid)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not an index for table \"%s\"",
+						get_rel_name(index_oid),
+						RelationGetRelationName(OldHeap))));
+	CheckTableNotInUse(OldHeap, "CLUSTER");
+	check_index_is_clusterable(OldHeap, index_oid, false,
+							   AccessExclusiveLock);
+	TransferPredicateLocksToHeapRelation(OldHeap);
+
+	/* see rebuild_relation() */
+	mark_index_clustered(OldHeap, index_oid, true);
+	tablespace = OldHeap->rd_rel->reltablespace;
+	relpersistence = OldHeap->rd_rel->relpersistence;
+	heap_close(OldHeap, NoLock);
+
+	OIDNewHeap = make_new_heap(table_oid, tablespace, relpersistence,
+							   AccessExclusiveLock);
+	num_tuples = gpusort_copy_heap_data(OIDNewHeap, table_oid, index_oid,
+										&swap_toast_by_content,
+										&frozenXid, &cutoffMulti);
+	/* swap the relfilenodes, then rebuild all the indexes */
+	finish_heap_swap(table_oid, OIDNewHeap, false,
+					 swap_toast_by_content, false, true,
+					 frozenXid, cutoffMulti, relpersistence);
+
+	PG_RETURN_INT64((int64) num_tuples);
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpusort_cluster);
+
+/*
+ * entrypoint of GpuSort
+ */
+void
+pgstrom_init_gpusort(void)
+{
+	/* enable_gpusort parameter */
+	DefineCustomBoolVariable("pg_strom.enable_gpusort",
+							 "Enables the use of GPU sorting",
+							 NULL,
+							 &enable_gpusort,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* initialization of path method table */
+	memset(&gpusort_path_methods, 0, sizeof(CustomPathMethods));
+	gpusort_path_methods.CustomName          = "GpuSort";
+	gpusort_path_methods.PlanCustomPath      = PlanGpuSortPath;
+
+	/* initialization of plan method table */
+	memset(&gpusort_scan_methods, 0, sizeof(CustomScanMethods));
+	gpusort_scan_methods.CustomName          = "GpuSort";
+	gpusort_scan_methods.CreateCustomScanState
+		= CreateGpuSortScanState;
+	RegisterCustomScanMethods(&gpusort_scan_methods);
+
+	/* initialization of exec method table */
+	memset(&gpusort_exec_methods, 0, sizeof(CustomExecMethods));
+	gpusort_exec_methods.CustomName          = "GpuSort";
+	gpusort_exec_methods.BeginCustomScan     = ExecInitGpuSort;
+	gpusort_exec_methods.ExecCustomScan      = ExecGpuSort;
+	gpusort_exec_methods.EndCustomScan       = ExecEndGpuSort;
+	gpusort_exec_methods.ReScanCustomScan    = ExecReScanGpuSort;
+	gpusort_exec_methods.ExplainCustomScan   = ExplainGpuSort;
+	/* hook registration */
+	create_upper_paths_next = create_upper_paths_hook;
+	create_upper_paths_hook = gpusort_add_ordered_paths;
+}
@@ -0,0 +1,2346 @@
+/*
+ * gpuwinagg.c
+ *
+ * Window functions over the sorted input stream using GPU
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "pg_strom.h"
+#include "cuda_gpuwinagg.h"
+
+static create_upper_paths_hook_type create_upper_paths_next;
+static CustomPathMethods		gpuwinagg_path_methods;
+static CustomScanMethods		gpuwinagg_scan_methods;
+static CustomExecMethods		gpuwinagg_exec_methods;
+static bool						enable_gpuwinagg;
+
+/*
+ * Host side finalization of the device results
+ */
+#define GPUWINAGG_FINAL__INT8			1
+#define GPUWINAGG_FINAL__FLOAT4			2
+#define GPUWINAGG_FINAL__FLOAT8			3
+#define GPUWINAGG_FINAL__NUMERIC_AVG	4	/* numeric of int8 sum / count */
+#define GPUWINAGG_FINAL__FLOAT8_AVG		5	/* float8 sum / count */
+
+typedef struct
+{
+	cl_int			num_part_keys;	/* number of PARTITION BY keys */
+	cl_int			num_order_keys;	/* number of ORDER BY keys */
+	bool			peer_frame;		/* true, if frame ends at the last peer */
+	double			outer_nrows;	/* number of estimated outer nrows */
+	List		   *tlist_slot;		/* keys and arguments on the kds_slot;
+									 * INDEX_VAR references the outer-tlist */
+	List		   *key_eqfuncs;	/* equality function of the keys */
+	List		   *func_kinds;		/* GPUWINAGG_FUNC__* */
+	List		   *func_finals;	/* GPUWINAGG_FINAL__* */
+	List		   *func_argidx;	/* index of the argument on tlist_slot */
+	char		   *kern_source;
+	int				extra_flags;
+	List		   *used_params;	/* referenced Const/Param */
+} GpuWinAggInfo;
+
+static inline void
+form_gpuwinagg_info(CustomScan *cscan, GpuWinAggInfo *gwa_info)
+{
+	List	   *privs = NIL;
+	List	   *exprs = NIL;
+
+	privs = lappend(privs, makeInteger(gwa_info->num_part_keys));
+	privs = lappend(privs, makeInteger(gwa_info->num_order_keys));
+	privs = lappend(privs, makeInteger(gwa_info->peer_frame));
+	privs = lappend(privs, pmakeFloat(gwa_info->outer_nrows));
+	privs = lappend(privs, gwa_info->tlist_slot);
+	privs = lappend(privs, gwa_info->key_eqfuncs);
+	privs = lappend(privs, gwa_info->func_kinds);
+	privs = lappend(privs, gwa_info->func_finals);
+	privs = lappend(privs, gwa_info->func_argidx);
+	privs = lappend(privs, makeString(gwa_info->kern_source));
+	privs = lappend(privs, makeInteger(gwa_info->extra_flags));
+	exprs = lappend(exprs, gwa_info->used_params);
+
+	cscan->custom_private = privs;
+	cscan->custom_exprs = exprs;
+}
+
+static inline GpuWinAggInfo *
+deform_gpuwinagg_info(CustomScan *cscan)
+{
+	GpuWinAggInfo *gwa_info = palloc0(sizeof(GpuWinAggInfo));
+	List	   *privs = cscan->custom_private;
+	List	   *exprs = cscan->custom_exprs;
+	int			pindex = 0;
+	int			eindex = 0;
+
+	gwa_info->num_part_keys = intVal(list_nth(privs, pindex++));
+	gwa_info->num_order_keys = intVal(list_nth(privs, pindex++));
+	gwa_info->peer_frame = intVal(list_nth(privs, pindex++));
+	gwa_info->outer_nrows = floatVal(list_nth(privs, pindex++));
+	gwa_info->tlist_slot = list_nth(privs, pindex++);
+	gwa_info->key_eqfuncs = list_nth(privs, pindex++);
+	gwa_info->func_kinds = list_nth(privs, pindex++);
+	gwa_info->func_finals = list_nth(privs, pindex++);
+	gwa_info->func_argidx = list_nth(privs, pindex++);
+	gwa_info->kern_source = strVal(list_nth(privs, pindex++));
+	gwa_info->extra_flags = intVal(list_nth(privs, pindex++));
+	gwa_info->used_params = list_nth(exprs, eindex++);
+
+	return gwa_info;
+}
+
+/*
+ * GpuWinAggState
+ */
+typedef struct
+{
+	GpuTaskState	gts;
+	cl_int			num_part_keys;
+	cl_int			num_order_keys;
+	cl_int			num_funcs;
+	bool			peer_frame;
+	bool			peer_aligned;	/* chunks are split at the peer boundary */
+	cl_char		   *func_kinds;
+	cl_char		   *func_finals;
+	cl_int		   *func_argidx;
+	Oid			   *func_argtypes;
+	FmgrInfo	   *key_eqfuncs;	/* equality functions of the keys */
+	Oid			   *key_collids;	/* collation of the keys */
+	kern_data_store *kds_slot_head;	/* template of the kds_slot */
+
+	/* stuff to load the source chunks in order */
+	pgstrom_data_store *pds_pending; /* rows to be loaded to the next chunk */
+	cl_uint			next_task_seqno; /* seqno of the next task to be loaded */
+	cl_uint			curr_task_seqno; /* seqno of the next task to be scanned */
+	dlist_head		pending_tasks;	/* tasks completed earlier than order */
+
+	/* stuff to reference the keys on CPU */
+	ExprContext	   *key_econtext;
+	TupleTableSlot *outer_slot;		/* a row of the source chunk */
+	HeapTupleData	outer_tuple;
+	TupleTableSlot *slot_x;
+	TupleTableSlot *slot_y;
+	ProjectionInfo *proj_x;			/* outer_slot -> slot_x */
+	ProjectionInfo *proj_y;			/* outer_slot -> slot_y */
+
+	/* carry from the previous chunk */
+	bool			carry_valid;
+	TupleTableSlot *carry_slot;		/* keys of the last row */
+	cl_long			carry_nrows;	/* # of rows in the last partition */
+	cl_long			carry_npeers;	/* # of peers in the last partition */
+	cl_long			carry_peer_nrows; /* # of rows in the last peer */
+	gpuwinagg_value *carry_values;	/* values of the last row */
+	cl_long		   *carry_counts;	/* counts of the last row */
+
+	/* run-time statistics */
+	cl_ulong		num_fallback_rows;
+} GpuWinAggState;
+
+/*
+ * GpuWinAggTask
+ *
+ * Host side representation of kern_gpuwinagg; a task per chunk of the
+ * input stream. It shall be scanned in the order of @task_seqno.
+ */
+typedef struct
+{
+	GpuTask			task;
+	cl_uint			task_seqno;		/* order of the chunk in the input */
+	pgstrom_data_store *pds_src;	/* source chunk in KDS_FORMAT_ROW */
+	kern_gpuwinagg	kern;
+} GpuWinAggTask;
+
+/* static functions */
+static GpuTask *gpuwinagg_next_task(GpuTaskState *gts);
+static void gpuwinagg_switch_task(GpuTaskState *gts, GpuTask *gtask);
+static TupleTableSlot *gpuwinagg_next_tuple(GpuTaskState *gts);
+static int  gpuwinagg_process_task(GpuTask *gtask, CUmodule cuda_module);
+static void gpuwinagg_release_task(GpuTask *gtask);
+
+/*
+ * Catalog of the supported window functions
+ */
+typedef struct
+{
+	const char *func_name;
+	int			func_nargs;
+	Oid			func_argtype;
+	int			func_kind;		/* GPUWINAGG_FUNC__* */
+	int			func_final;		/* GPUWINAGG_FINAL__* */
+} winfunc_catalog_t;
+
+static winfunc_catalog_t	winfunc_catalog[] = {
+	/* ranking functions */
+	{ "row_number", 0, InvalidOid,
+	  GPUWINAGG_FUNC__ROW_NUMBER, GPUWINAGG_FINAL__INT8 },
+	{ "rank",       0, InvalidOid,
+	  GPUWINAGG_FUNC__RANK,       GPUWINAGG_FINAL__INT8 },
+	{ "dense_rank", 0, InvalidOid,
+	  GPUWINAGG_FUNC__DENSE_RANK, GPUWINAGG_FINAL__INT8 },
+	/* COUNT(*) / COUNT(X) */
+	{ "count", 0, InvalidOid, GPUWINAGG_FUNC__COUNT, GPUWINAGG_FINAL__INT8 },
+	{ "count", 1, ANYOID,     GPUWINAGG_FUNC__COUNT, GPUWINAGG_FINAL__INT8 },
+	/* SUM(X) */
+	{ "sum", 1, INT2OID,   GPUWINAGG_FUNC__SUM_INT, GPUWINAGG_FINAL__INT8 },
+	{ "sum", 1, INT4OID,   GPUWINAGG_FUNC__SUM_INT, GPUWINAGG_FINAL__INT8 },
+	{ "sum", 1, FLOAT4OID, GPUWINAGG_FUNC__SUM_FP,  GPUWINAGG_FINAL__FLOAT4 },
+	{ "sum", 1, FLOAT8OID, GPUWINAGG_FUNC__SUM_FP,  GPUWINAGG_FINAL__FLOAT8 },
+	/* AVG(X) */
+	{ "avg", 1, INT2OID,   GPUWINAGG_FUNC__SUM_INT,
+	  GPUWINAGG_FINAL__NUMERIC_AVG },
+	{ "avg", 1, INT4OID,   GPUWINAGG_FUNC__SUM_INT,
+	  GPUWINAGG_FINAL__NUMERIC_AVG },
+	{ "avg", 1, FLOAT4OID, GPUWINAGG_FUNC__SUM_FP,
+	  GPUWINAGG_FINAL__FLOAT8_AVG },
+	{ "avg", 1, FLOAT8OID, GPUWINAGG_FUNC__SUM_FP,
+	  GPUWINAGG_FINAL__FLOAT8_AVG },
+	{ NULL, 0, InvalidOid, 0, 0 },
+};
+
+static winfunc_catalog_t *
+winfunc_catalog_lookup(Oid winfnoid)
+{
+	winfunc_catalog_t *entry = NULL;
+	HeapTuple	tuple;
+	Form_pg_proc proc;
+	int			i;
+
+	tuple = SearchSysCache1(PROCOID, ObjectIdGetDatum(winfnoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for function %u", winfnoid);
+	proc = (Form_pg_proc) GETSTRUCT(tuple);
+
+	if (proc->pronamespace == PG_CATALOG_NAMESPACE)
+	{
+		for (i=0; winfunc_catalog[i].func_name != NULL; i++)
+		{
+			winfunc_catalog_t *curr = &winfunc_catalog[i];
+
+			if (strcmp(NameStr(proc->proname), curr->func_name) != 0 ||
+				proc->pronargs != curr->func_nargs)
+				continue;
+			if (curr->func_nargs > 0 &&
+				proc->proargtypes.values[0] != curr->func_argtype)
+				continue;
+			entry = curr;
+			break;
+		}
+	}
+	ReleaseSysCache(tuple);
+
+	return entry;
+}
+
+/*
+ * replace_winagg_expression_by_outerref
+ *
+ * It transforms expression into the form of execution time; references to
+ * the input target-list by INDEX_VAR. Unlike GpuPreAgg, expression may not
+ * be computable from the input, then it sets @not_found.
+ */
+typedef struct
+{
+	PathTarget *target_input;
+	bool		not_found;
+} replace_winagg_outerref_context;
+
+static Node *
+__replace_winagg_expression_by_outerref(Node *node,
+										replace_winagg_outerref_context *con)
+{
+	ListCell   *lc;
+	cl_int		resno = 1;
+
+	if (!node)
+		return NULL;
+	foreach (lc, con->target_input->exprs)
+	{
+		if (equal(node, lfirst(lc)))
+		{
+			return (Node *)makeVar(INDEX_VAR,
+								   resno,
+								   exprType(node),
+								   exprTypmod(node),
+								   exprCollation(node),
+								   0);
+		}
+		resno++;
+	}
+
+	if (IsA(node, Var) ||
+		IsA(node, PlaceHolderVar) ||
+		IsA(node, Aggref) ||
+		IsA(node, WindowFunc))
+	{
+		con->not_found = true;
+		return node;
+	}
+	return expression_tree_mutator(node,
+								   __replace_winagg_expression_by_outerref,
+								   con);
+}
+
+static Expr *
+replace_winagg_expression_by_outerref(Expr *expr, PathTarget *target_input)
+{
+	replace_winagg_outerref_context con;
+	Node	   *result;
+
+	con.target_input = target_input;
+	con.not_found = false;
+	result = __replace_winagg_expression_by_outerref((Node *)expr, &con);
+	if (con.not_found)
+		return NULL;
+	return (Expr *)result;
+}
+
+/*
+ * gpuwinagg_add_slot_expr
+ *
+ * It adds an expression onto the tlist_slot, if not present yet, then
+ * returns its index.
+ */
+static int
+gpuwinagg_add_slot_expr(List **p_slot_exprs, Expr *expr)
+{
+	ListCell   *lc;
+	int			index = 0;
+
+	foreach (lc, *p_slot_exprs)
+	{
+		if (equal(expr, lfirst(lc)))
+			return index;
+		index++;
+	}
+	*p_slot_exprs = lappend(*p_slot_exprs, expr);
+	return index;
+}
+
+/*
+ * gpuwinagg_setup_window_keys
+ *
+ * It checks whether the PARTITION BY / ORDER BY keys are executable on the
+ * device, then adds them onto the slot expressions.
+ */
+static bool
+gpuwinagg_setup_window_keys(PlannerInfo *root,
+							List *sortcl_list,
+							PathTarget *target_input,
+							List **p_slot_exprs,
+							List **p_key_eqfuncs)
+{
+	ListCell   *lc;
+
+	foreach (lc, sortcl_list)
+	{
+		SortGroupClause *sgc = lfirst(lc);
+		Expr	   *expr;
+		Oid			type_oid;
+		devtype_info *dtype;
+
+		expr = (Expr *)get_sortgroupclause_expr(sgc, root->processed_tlist);
+		expr = replace_winagg_expression_by_outerref(expr, target_input);
+		if (!expr)
+			return false;
+		type_oid = exprType((Node *)expr);
+		dtype = pgstrom_devtype_lookup(type_oid);
+		if (!dtype || !OidIsValid(dtype->type_eqfunc))
+			return false;
+		if (!pgstrom_devfunc_lookup_type_equal(dtype,
+											   exprCollation((Node *)expr)))
+			return false;
+		if (!pgstrom_device_expression(expr))
+			return false;
+		if (!OidIsValid(sgc->eqop))
+			return false;
+		/* keys must be on the individual slot, even if duplicated */
+		*p_slot_exprs = lappend(*p_slot_exprs, expr);
+		*p_key_eqfuncs = lappend_oid(*p_key_eqfuncs, get_opcode(sgc->eqop));
+	}
+	return true;
+}
+
+/*
+ * gpuwinagg_add_window_paths
+ *
+ * entrypoint to add GpuWindowAgg path on the UPPERREL_WINDOW stage.
+ * It handles a single window clause whose frame starts at the head of the
+ * partition and ends at the current row (or its last peer), and the window
+ * functions listed in the winfunc_catalog.
+ */
+static void
+gpuwinagg_add_window_paths(PlannerInfo *root,
+						   UpperRelationKind stage,
+						   RelOptInfo *input_rel,
+						   RelOptInfo *window_rel)
+{
+	Query		   *parse = root->parse;
+	PathTarget	   *target_window;
+	PathTarget	   *target_input;
+	Path		   *input_path;
+	CustomPath	   *cpath;
+	GpuWinAggInfo  *gwa_info;
+	WindowFuncLists *wflists;
+	WindowClause   *wc = NULL;
+	List		   *window_funcs = NIL;
+	List		   *slot_exprs = NIL;
+	List		   *key_eqfuncs = NIL;
+	List		   *func_kinds = NIL;
+	List		   *func_finals = NIL;
+	List		   *func_argidx = NIL;
+	List		   *window_clauses;
+	List		   *window_pathkeys;
+	List		   *tlist_slot = NIL;
+	bool			has_aggregate = false;
+	bool			peer_frame = true;
+	ListCell	   *lc;
+	Index			winref;
+	int				num_keys;
+	int				resno;
+	double			nrows;
+	Cost			startup_cost;
+	Cost			run_cost;
+
+	if (create_upper_paths_next)
+		(*create_upper_paths_next)(root, stage, input_rel, window_rel);
+
+	if (stage != UPPERREL_WINDOW)
+		return;
+
+	if (!pgstrom_enabled || !enable_gpuwinagg)
+		return;
+
+	/* lookup the window functions in the target-list */
+	target_window = root->upper_targets[UPPERREL_WINDOW];
+	wflists = find_window_functions((Node *)target_window->exprs,
+									list_length(parse->windowClause));
+	if (wflists->numWindowFuncs == 0)
+		return;
+	for (winref=0; winref <= wflists->maxWinRef; winref++)
+	{
+		if (wflists->windowFuncs[winref] == NIL)
+			continue;
+		/* only a single window clause is supported right now */
+		if (window_funcs != NIL)
+			return;
+		foreach (lc, wflists->windowFuncs[winref])
+		{
+			if (!list_member(window_funcs, lfirst(lc)))
+				window_funcs = lappend(window_funcs, lfirst(lc));
+		}
+		foreach (lc, parse->windowClause)
+		{
+			if (((WindowClause *) lfirst(lc))->winref == winref)
+			{
+				wc = lfirst(lc);
+				break;
+			}
+		}
+	}
+	if (!wc || list_length(window_funcs) > GPUWINAGG_MAX_NUM_FUNCS)
+		return;
+
+	input_path = input_rel->cheapest_total_path;
+	target_input = input_path->pathtarget;
+
+	/* PARTITION BY and ORDER BY keys */
+	if (!grouping_is_sortable(wc->partitionClause) ||
+		!grouping_is_sortable(wc->orderClause))
+		return;
+	if (!gpuwinagg_setup_window_keys(root, wc->partitionClause,
+									 target_input,
+									 &slot_exprs, &key_eqfuncs) ||
+		!gpuwinagg_setup_window_keys(root, wc->orderClause,
+									 target_input,
+									 &slot_exprs, &key_eqfuncs))
+		return;
+	num_keys = list_length(slot_exprs);
+
+	/* window functions and arguments */
+	foreach (lc, window_funcs)
+	{
+		WindowFunc *wfunc = lfirst(lc);
+		winfunc_catalog_t *entry;
+		int			argidx = -1;
+
+		if (wfunc->aggfilter)
+			return;
+		entry = winfunc_catalog_lookup(wfunc->winfnoid);
+		if (!entry)
+			return;
+		if (GPUWINAGG_FUNC_IS_AGGREGATE(entry->func_kind))
+			has_aggregate = true;
+		if (entry->func_nargs > 0)
+		{
+			Expr   *arg;
+
+			Assert(list_length(wfunc->args) == 1);
+			arg = replace_winagg_expression_by_outerref(linitial(wfunc->args),
+														target_input);
+			if (!arg ||
+				!pgstrom_devtype_lookup(exprType((Node *)arg)) ||
+				!pgstrom_device_expression(arg))
+				return;
+			argidx = gpuwinagg_add_slot_expr(&slot_exprs, arg);
+		}
+		func_kinds = lappend_int(func_kinds, entry->func_kind);
+		func_finals = lappend_int(func_finals, entry->func_final);
+		func_argidx = lappend_int(func_argidx, argidx);
+	}
+
+	/*
+	 * Frame of the aggregate functions must start at the head of partition,
+	 * and end at the current row (ROWS mode) or its last peer (RANGE mode).
+	 * It is not a matter for the ranking functions.
+	 */
+	if (has_aggregate)
+	{
+		int		frame = (wc->frameOptions & ~(FRAMEOPTION_NONDEFAULT |
+											  FRAMEOPTION_BETWEEN));
+
+		if (frame == (FRAMEOPTION_RANGE |
+					  FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+					  FRAMEOPTION_END_CURRENT_ROW))
+			peer_frame = true;
+		else if (frame == (FRAMEOPTION_ROWS |
+						   FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+						   FRAMEOPTION_END_CURRENT_ROW))
+			peer_frame = false;
+		else
+			return;
+	}
+
+	/* transform the slot expressions to TLE form */
+	resno = 1;
+	foreach (lc, slot_exprs)
+	{
+		TargetEntry *tle = makeTargetEntry((Expr *)lfirst(lc),
+										   resno, NULL, false);
+		if (resno <= num_keys)
+			tle->ressortgroupref = resno;
+		tlist_slot = lappend(tlist_slot, tle);
+		resno++;
+	}
+
+	/* input stream has to be sorted by the window keys */
+	window_clauses = list_concat(list_copy(wc->partitionClause),
+								 list_copy(wc->orderClause));
+	window_pathkeys = make_pathkeys_for_sortclauses(root,
+													window_clauses,
+													root->processed_tlist);
+	if (!pathkeys_contained_in(window_pathkeys, input_path->pathkeys))
+		input_path = (Path *) create_sort_path(root,
+											   window_rel,
+											   input_path,
+											   window_pathkeys,
+											   -1.0);
+
+	/* cost estimation */
+	nrows = input_path->rows;
+	startup_cost = input_path->startup_cost + pgstrom_gpu_setup_cost;
+	run_cost = (input_path->total_cost - input_path->startup_cost +
+				pgstrom_gpu_operator_cost * (double)(num_keys +
+													 list_length(func_kinds))
+				* nrows +
+				cost_for_dma_receive(input_rel, nrows) +
+				cpu_tuple_cost * nrows);
+
+	gwa_info = palloc0(sizeof(GpuWinAggInfo));
+	gwa_info->num_part_keys = list_length(wc->partitionClause);
+	gwa_info->num_order_keys = list_length(wc->orderClause);
+	gwa_info->peer_frame = peer_frame;
+	gwa_info->outer_nrows = nrows;
+	gwa_info->tlist_slot = tlist_slot;
+	gwa_info->key_eqfuncs = key_eqfuncs;
+	gwa_info->func_kinds = func_kinds;
+	gwa_info->func_finals = func_finals;
+	gwa_info->func_argidx = func_argidx;
+
+	cpath = makeNode(CustomPath);
+	cpath->path.pathtype = T_CustomScan;
+	cpath->path.parent = window_rel;
+	cpath->path.pathtarget = target_window;
+	cpath->path.param_info = NULL;
+	cpath->path.parallel_aware = false;
+	cpath->path.parallel_safe = false;
+	cpath->path.parallel_workers = 0;
+	cpath->path.rows = nrows;
+	cpath->path.startup_cost = startup_cost;
+	cpath->path.total_cost = startup_cost + run_cost;
+	cpath->path.pathkeys = window_pathkeys;
+	cpath->flags = 0;
+	cpath->custom_paths = list_make1(input_path);
+	cpath->custom_private = list_make2(gwa_info, window_funcs);
+	cpath->methods = &gpuwinagg_path_methods;
+
+	add_path(window_rel, &cpath->path);
+}
+
+/*
+ * gpuwinagg_codegen_projection
+ *
+ * It makes a device function to load the keys and arguments of window
+ * functions from a row of the source chunk onto the slot.
+ */
+static void
+gpuwinagg_codegen_projection(StringInfo kern,
+							 codegen_context *context,
+							 List *tlist_slot,
+							 List *outer_tlist)
+{
+	StringInfoData	decl;
+	StringInfoData	body;
+	StringInfoData	temp;
+	Bitmapset	   *outer_refs = NULL;
+	ListCell	   *lc;
+	int				i, k, nattrs = list_length(outer_tlist);
+
+	initStringInfo(&decl);
+	initStringInfo(&body);
+	initStringInfo(&temp);
+	context->param_refs = NULL;
+
+	appendStringInfoString(
+		&decl,
+		"  void        *addr    __attribute__((unused));\n"
+		"  pg_anytype_t temp    __attribute__((unused));\n");
+
+	foreach (lc, tlist_slot)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		pull_varattnos((Node *)tle->expr, INDEX_VAR, &outer_refs);
+	}
+
+	/* extract the supplied tuple and load variables */
+	if (!bms_is_empty(outer_refs))
+	{
+		for (i=0; i > FirstLowInvalidHeapAttributeNumber; i--)
+		{
+			k = i - FirstLowInvalidHeapAttributeNumber;
+			if (bms_is_member(k, outer_refs))
+				elog(ERROR, "Bug? system column or whole-row is referenced");
+		}
+
+		appendStringInfoString(
+			&body,
+			"\n"
+			"  /* extract the given htup and load variables */\n"
+			"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds_src, htup);\n");
+		for (i=1; i <= nattrs; i++)
+		{
+			k = i - FirstLowInvalidHeapAttributeNumber;
+			if (bms_is_member(k, outer_refs))
+			{
+				TargetEntry	   *tle = list_nth(outer_tlist, i-1);
+				Oid				type_oid = exprType((Node *)tle->expr);
+				devtype_info   *dtype;
+
+				dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+				if (!dtype)
+					elog(ERROR, "device type lookup failed: %s",
+						 format_type_be(type_oid));
+				appendStringInfo(
+					&decl,
+					"  pg_%s_t KVAR_%u;\n",
+					dtype->type_name, i);
+				appendStringInfoString(&body, temp.data);
+				resetStringInfo(&temp);
+				appendStringInfo(
+					&body,
+					"  KVAR_%u = pg_%s_datum_ref(kcxt,addr);\n",
+					i, dtype->type_name);
+			}
+			appendStringInfoString(
+				&temp,
+				"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n");
+		}
+		appendStringInfoString(
+			&body,
+			"  EXTRACT_HEAP_TUPLE_END();\n");
+	}
+
+	/* evaluation of the keys and arguments */
+	foreach (lc, tlist_slot)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+		Oid				type_oid = exprType((Node *)tle->expr);
+		devtype_info   *dtype;
+
+		dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+		if (!dtype)
+			elog(ERROR, "device type lookup failed: %s",
+				 format_type_be(type_oid));
+		appendStringInfo(
+			&body,
+			"\n"
+			"  /* slot attribute %d (%s) */\n"
+			"  temp.%s_v = %s;\n"
+			"  dst_isnull[%d] = temp.%s_v.isnull;\n",
+			tle->resno,
+			tle->ressortgroupref ? "window-key" : "winfunc-arg",
+			dtype->type_name,
+			pgstrom_codegen_expression((Node *)tle->expr, context),
+			tle->resno - 1, dtype->type_name);
+		if (dtype->type_byval)
+			appendStringInfo(
+				&body,
+				"  if (!temp.%s_v.isnull)\n"
+				"    dst_values[%d] = pg_%s_as_datum(&temp.%s_v.value);\n",
+				dtype->type_name,
+				tle->resno - 1,
+				dtype->type_name,
+				dtype->type_name);
+		else
+			appendStringInfo(
+				&body,
+				"  if (!temp.%s_v.isnull)\n"
+				"    dst_values[%d] = PointerGetDatum(temp.%s_v.value);\n"
+				"  kern_context_check_varlena(kcxt, temp.%s_v.isnull,\n"
+				"                             temp.%s_v.value);\n",
+				dtype->type_name,
+				tle->resno - 1,
+				dtype->type_name,
+				dtype->type_name,
+				dtype->type_name);
+	}
+	/* const/params */
+	pgstrom_codegen_param_declarations(&decl, context);
+
+	appendStringInfo(
+		kern,
+		"STATIC_FUNCTION(void)\n"
+		"gpuwinagg_projection_row(kern_context *kcxt,\n"
+		"                         kern_data_store *kds_src,\n"
+		"                         HeapTupleHeaderData *htup,\n"
+		"                         Datum *dst_values,\n"
+		"                         cl_bool *dst_isnull)\n"
+		"{\n"
+		"%s"
+		"%s"
+		"}\n\n",
+		decl.data,
+		body.data);
+
+	pfree(decl.data);
+	pfree(body.data);
+	pfree(temp.data);
+}
+
+/*
+ * gpuwinagg_codegen_init_value
+ *
+ * It makes a device function to set up the initial value of the window
+ * functions for each row; running values are accumulated from them.
+ */
+static void
+gpuwinagg_codegen_init_value(StringInfo kern,
+							 codegen_context *context,
+							 List *tlist_slot,
+							 GpuWinAggInfo *gwa_info)
+{
+	ListCell   *lc1, *lc2;
+	int			fn_index = 0;
+
+	appendStringInfoString(
+		kern,
+		"STATIC_FUNCTION(void)\n"
+		"gpuwinagg_init_value(kern_context *kcxt,\n"
+		"                     cl_int fn_index,\n"
+		"                     cl_bool *slot_isnull,\n"
+		"                     Datum *slot_values,\n"
+		"                     gpuwinagg_value *p_value,\n"
+		"                     cl_long *p_count)\n"
+		"{\n"
+		"  void        *addr    __attribute__((unused));\n"
+		"  pg_anytype_t temp    __attribute__((unused));\n"
+		"\n"
+		"  switch (fn_index)\n"
+		"  {\n");
+
+	forboth (lc1, gwa_info->func_kinds,
+			 lc2, gwa_info->func_argidx)
+	{
+		int		kind = lfirst_int(lc1);
+		int		argidx = lfirst_int(lc2);
+
+		appendStringInfo(kern, "  case %d:\n", fn_index++);
+		if (!GPUWINAGG_FUNC_IS_AGGREGATE(kind))
+		{
+			appendStringInfoString(
+				kern,
+				"    p_value->ival = 0;\n"
+				"    *p_count = 1;\n");
+		}
+		else if (kind == GPUWINAGG_FUNC__COUNT)
+		{
+			if (argidx < 0)
+				appendStringInfoString(
+					kern,
+					"    p_value->ival = 1;\n"
+					"    *p_count = 1;\n");
+			else
+				appendStringInfo(
+					kern,
+					"    p_value->ival = (slot_isnull[%d] ? 0 : 1);\n"
+					"    *p_count = p_value->ival;\n",
+					argidx);
+		}
+		else
+		{
+			TargetEntry	   *tle = list_nth(tlist_slot, argidx);
+			Oid				type_oid = exprType((Node *)tle->expr);
+			devtype_info   *dtype;
+
+			dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+			if (!dtype)
+				elog(ERROR, "device type lookup failed: %s",
+					 format_type_be(type_oid));
+			appendStringInfo(
+				kern,
+				"    addr = (slot_isnull[%d] ? NULL : slot_values + %d);\n"
+				"    temp.%s_v = pg_%s_datum_ref(kcxt,addr);\n"
+				"    if (temp.%s_v.isnull)\n"
+				"    {\n"
+				"      p_value->ival = 0;\n"
+				"      *p_count = 0;\n"
+				"    }\n"
+				"    else\n"
+				"    {\n"
+				"      p_value->%s = (%s)temp.%s_v.value;\n"
+				"      *p_count = 1;\n"
+				"    }\n",
+				argidx, argidx,
+				dtype->type_name, dtype->type_name,
+				dtype->type_name,
+				kind == GPUWINAGG_FUNC__SUM_FP ? "fval" : "ival",
+				kind == GPUWINAGG_FUNC__SUM_FP ? "cl_double" : "cl_long",
+				dtype->type_name);
+		}
+		appendStringInfoString(kern, "    break;\n");
+	}
+	appendStringInfoString(
+		kern,
+		"  default:\n"
+		"    break;\n"
+		"  }\n"
+		"}\n\n");
+}
+
+/*
+ * gpuwinagg_codegen
+ */
+static char *
+gpuwinagg_codegen(codegen_context *context,
+				  GpuWinAggInfo *gwa_info,
+				  List *outer_tlist)
+{
+	StringInfoData	kern;
+	List		   *tlist_part = NIL;
+	List		   *tlist_peer = NIL;
+	ListCell	   *lc;
+	int				index = 0;
+
+	foreach (lc, gwa_info->tlist_slot)
+	{
+		if (index < gwa_info->num_part_keys)
+			tlist_part = lappend(tlist_part, lfirst(lc));
+		else if (index < gwa_info->num_part_keys + gwa_info->num_order_keys)
+			tlist_peer = lappend(tlist_peer, lfirst(lc));
+		index++;
+	}
+
+	initStringInfo(&kern);
+	gpuwinagg_codegen_projection(&kern, context,
+								 gwa_info->tlist_slot,
+								 outer_tlist);
+	gpupreagg_codegen_hashvalue(&kern, context, tlist_part,
+								"gpuwinagg_part_hashvalue");
+	gpupreagg_codegen_keymatch(&kern, context, tlist_part,
+							   "gpuwinagg_part_keymatch");
+	gpupreagg_codegen_keymatch(&kern, context, tlist_peer,
+							   "gpuwinagg_peer_keymatch");
+	gpuwinagg_codegen_init_value(&kern, context,
+								 gwa_info->tlist_slot,
+								 gwa_info);
+	return kern.data;
+}
+
+/*
+ * PlanGpuWinAggPath
+ *
+ * Entrypoint to create CustomScan(GpuWindowAgg) node. The custom_scan_tlist
+ * consists of the outer target-list, then results of the window functions.
+ */
+static Plan *
+PlanGpuWinAggPath(PlannerInfo *root,
+				  RelOptInfo *rel,
+				  struct CustomPath *best_path,
+				  List *tlist,
+				  List *clauses,
+				  List *custom_plans)
+{
+	CustomScan	   *cscan = makeNode(CustomScan);
+	GpuWinAggInfo  *gwa_info;
+	List		   *window_funcs;
+	Plan		   *outer_plan;
+	List		   *tlist_dev = NIL;
+	ListCell	   *lc;
+	codegen_context	context;
+
+	Assert(list_length(best_path->custom_private) == 2);
+	gwa_info = linitial(best_path->custom_private);
+	window_funcs = lsecond(best_path->custom_private);
+
+	Assert(list_length(custom_plans) == 1);
+	outer_plan = linitial(custom_plans);
+
+	/* outer target-list, then window functions */
+	foreach (lc, outer_plan->targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		tlist_dev = lappend(tlist_dev,
+							makeTargetEntry(copyObject(tle->expr),
+											list_length(tlist_dev) + 1,
+											NULL,
+											false));
+	}
+	foreach (lc, window_funcs)
+	{
+		tlist_dev = lappend(tlist_dev,
+							makeTargetEntry(copyObject(lfirst(lc)),
+											list_length(tlist_dev) + 1,
+											NULL,
+											false));
+	}
+
+	/* setup CustomScan node */
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = NIL;
+	outerPlan(cscan) = outer_plan;
+	cscan->scan.scanrelid = 0;
+	cscan->flags = best_path->flags;
+	cscan->custom_scan_tlist = tlist_dev;
+	cscan->methods = &gpuwinagg_scan_methods;
+
+	/*
+	 * construction of the GPU kernel code
+	 */
+	pgstrom_init_codegen_context(&context);
+	context.extra_flags |= DEVKERNEL_NEEDS_GPUWINAGG;
+	gwa_info->kern_source = gpuwinagg_codegen(&context,
+											  gwa_info,
+											  outer_plan->targetlist);
+	gwa_info->extra_flags = context.extra_flags;
+	gwa_info->used_params = context.used_params;
+
+	form_gpuwinagg_info(cscan, gwa_info);
+
+	return &cscan->scan.plan;
+}
+
+/*
+ * pgstrom_path_is_gpuwinagg
+ */
+bool
+pgstrom_path_is_gpuwinagg(const Path *pathnode)
+{
+	if (IsA(pathnode, CustomPath) &&
+		pathnode->pathtype == T_CustomScan &&
+		((CustomPath *) pathnode)->methods == &gpuwinagg_path_methods)
+		return true;
+	return false;
+}
+
+/*
+ * pgstrom_plan_is_gpuwinagg
+ */
+bool
+pgstrom_plan_is_gpuwinagg(const Plan *plan)
+{
+	if (IsA(plan, CustomScan) &&
+		((CustomScan *) plan)->methods == &gpuwinagg_scan_methods)
+		return true;
+	return false;
+}
+
+/*
+ * pgstrom_planstate_is_gpuwinagg
+ */
+bool
+pgstrom_planstate_is_gpuwinagg(const PlanState *ps)
+{
+	if (IsA(ps, CustomScanState) &&
+		((CustomScanState *) ps)->methods == &gpuwinagg_exec_methods)
+		return true;
+	return false;
+}
+
+/*
+ * CreateGpuWinAggScanState
+ */
+static Node *
+CreateGpuWinAggScanState(CustomScan *cscan)
+{
+	/*
+	 * NOTE: GpuWinAggState is referenced by the worker threads, so it must
+	 * be kept as long as the worker threads can live. See the comment at
+	 * CreateGpuPreAggScanState also.
+	 */
+	GpuWinAggState *gwas = MemoryContextAllocZero(CurTransactionContext,
+												  sizeof(GpuWinAggState));
+	/* Set tag and executor callbacks */
+	NodeSetTag(gwas, T_CustomScanState);
+	gwas->gts.css.flags = cscan->flags;
+	gwas->gts.css.methods = &gpuwinagg_exec_methods;
+
+	return (Node *) gwas;
+}
+
+/*
+ * ExecInitGpuWinAgg
+ */
+static void
+ExecInitGpuWinAgg(CustomScanState *node, EState *estate, int eflags)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuWinAggInfo  *gwa_info = deform_gpuwinagg_info(cscan);
+	List		   *tlist_slot = gwa_info->tlist_slot;
+	List		   *tlist_state;
+	PlanState	   *outer_ps;
+	TupleDesc		outer_tupdesc;
+	TupleDesc		slot_tupdesc;
+	StringInfoData	kern_define;
+	ProgramId		program_id;
+	ListCell	   *lc1, *lc2, *lc3;
+	size_t			length;
+	int				index;
+	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
+
+	Assert(cscan->scan.scanrelid == 0 && outerPlan(cscan) != NULL);
+	/* activate a GpuContext for CUDA kernel execution */
+	gwas->gts.gcontext = AllocGpuContext(-1, false);
+	if (!explain_only)
+		ActivateGpuContext(gwas->gts.gcontext);
+
+	/* setup common GpuTaskState fields */
+	pgstromInitGpuTaskState(&gwas->gts,
+							gwas->gts.gcontext,
+							GpuTaskKind_GpuWindowAgg,
+							NIL,
+							gwa_info->used_params,
+							estate);
+	gwas->gts.cb_next_task       = gpuwinagg_next_task;
+	gwas->gts.cb_switch_task     = gpuwinagg_switch_task;
+	gwas->gts.cb_next_tuple      = gpuwinagg_next_tuple;
+	gwas->gts.cb_process_task    = gpuwinagg_process_task;
+	gwas->gts.cb_release_task    = gpuwinagg_release_task;
+
+	/* initialization of the outer relation */
+	outer_ps = ExecInitNode(outerPlan(cscan), estate, eflags);
+	outerPlanState(gwas) = outer_ps;
+	outer_tupdesc = ExecGetResultType(outer_ps);
+
+	/* properties of the window keys and functions */
+	gwas->num_part_keys = gwa_info->num_part_keys;
+	gwas->num_order_keys = gwa_info->num_order_keys;
+	gwas->num_funcs = list_length(gwa_info->func_kinds);
+	gwas->peer_frame = gwa_info->peer_frame;
+
+	gwas->key_eqfuncs = palloc0(sizeof(FmgrInfo) *
+								list_length(gwa_info->key_eqfuncs));
+	gwas->key_collids = palloc0(sizeof(Oid) *
+								list_length(gwa_info->key_eqfuncs));
+	index = 0;
+	forboth (lc1, gwa_info->key_eqfuncs,
+			 lc2, tlist_slot)
+	{
+		TargetEntry *tle = lfirst(lc2);
+
+		fmgr_info(lfirst_oid(lc1), &gwas->key_eqfuncs[index]);
+		gwas->key_collids[index] = exprCollation((Node *)tle->expr);
+		index++;
+	}
+
+	gwas->func_kinds = palloc0(sizeof(cl_char) * gwas->num_funcs);
+	gwas->func_finals = palloc0(sizeof(cl_char) * gwas->num_funcs);
+	gwas->func_argidx = palloc0(sizeof(cl_int) * gwas->num_funcs);
+	gwas->func_argtypes = palloc0(sizeof(Oid) * gwas->num_funcs);
+	index = 0;
+	forthree (lc1, gwa_info->func_kinds,
+			  lc2, gwa_info->func_finals,
+			  lc3, gwa_info->func_argidx)
+	{
+		cl_int		argidx = lfirst_int(lc3);
+
+		gwas->func_kinds[index] = lfirst_int(lc1);
+		gwas->func_finals[index] = lfirst_int(lc2);
+		gwas->func_argidx[index] = argidx;
+		if (argidx >= 0)
+		{
+			TargetEntry *tle = list_nth(tlist_slot, argidx);
+
+			gwas->func_argtypes[index] = exprType((Node *)tle->expr);
+		}
+		if (GPUWINAGG_FUNC_IS_AGGREGATE(gwas->func_kinds[index]) &&
+			gwas->peer_frame)
+			gwas->peer_aligned = true;
+		index++;
+	}
+	gwas->carry_values = palloc0(sizeof(gpuwinagg_value) * gwas->num_funcs);
+	gwas->carry_counts = palloc0(sizeof(cl_long) * gwas->num_funcs);
+
+	/*
+	 * Initialization of the stuff to reference the keys on CPU; boundary
+	 * of the chunks, and CPU fallback.
+	 */
+	slot_tupdesc = ExecCleanTypeFromTL(tlist_slot, false);
+	gwas->outer_slot = MakeSingleTupleTableSlot(outer_tupdesc);
+	gwas->slot_x = MakeSingleTupleTableSlot(slot_tupdesc);
+	gwas->slot_y = MakeSingleTupleTableSlot(slot_tupdesc);
+	gwas->carry_slot = MakeSingleTupleTableSlot(slot_tupdesc);
+	gwas->key_econtext = CreateExprContext(estate);
+#if PG_VERSION_NUM < 100000
+	tlist_state = (List *)ExecInitExpr((Expr *)tlist_slot,
+									   &gwas->gts.css.ss.ps);
+#else
+	tlist_state = tlist_slot;
+#endif
+	gwas->proj_x = ExecBuildProjectionInfo(tlist_state,
+										   gwas->key_econtext,
+										   gwas->slot_x,
+#if PG_VERSION_NUM >= 100000
+										   &gwas->gts.css.ss.ps,
+#endif
+										   outer_tupdesc);
+	gwas->proj_y = ExecBuildProjectionInfo(tlist_state,
+										   gwas->key_econtext,
+										   gwas->slot_y,
+#if PG_VERSION_NUM >= 100000
+										   &gwas->gts.css.ss.ps,
+#endif
+										   outer_tupdesc);
+	dlist_init(&gwas->pending_tasks);
+
+	/* Template of kds_slot */
+	length = STROMALIGN(offsetof(kern_data_store,
+								 colmeta[slot_tupdesc->natts]));
+	gwas->kds_slot_head = MemoryContextAllocZero(CurTransactionContext,
+												 length);
+	init_kernel_data_store(gwas->kds_slot_head,
+						   slot_tupdesc,
+						   INT_MAX,		/* to be set individually */
+						   KDS_FORMAT_SLOT,
+						   INT_MAX);	/* to be set individually */
+
+	/* Get CUDA program and async build if any */
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gwas->gts,
+							   gwa_info->extra_flags);
+	program_id = pgstrom_create_cuda_program(gwas->gts.gcontext,
+											 gwa_info->extra_flags,
+											 gwa_info->kern_source,
+											 kern_define.data,
+											 false,
+											 explain_only);
+	pfree(kern_define.data);
+	gwas->gts.program_id = program_id;
+}
+
+/*
+ * gpuwinagg_fetch_row - load a row of the chunk on the outer_slot
+ */
+static TupleTableSlot *
+gpuwinagg_fetch_row(GpuWinAggState *gwas,
+					pgstrom_data_store *pds, cl_uint index)
+{
+	kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(&pds->kds, index);
+	HeapTuple		tuple = &gwas->outer_tuple;
+
+	tuple->t_len = tupitem->t_len;
+	tuple->t_self = tupitem->t_self;
+	tuple->t_tableOid = InvalidOid;
+	tuple->t_data = &tupitem->htup;
+
+	return ExecStoreTuple(tuple, gwas->outer_slot, InvalidBuffer, false);
+}
+
+/*
+ * gpuwinagg_project_keys - projection from the outer row to the slot form
+ */
+static TupleTableSlot *
+gpuwinagg_project_keys(GpuWinAggState *gwas,
+					   ProjectionInfo *proj,
+					   TupleTableSlot *outer_slot)
+{
+#if PG_VERSION_NUM < 100000
+	ExprDoneCond	is_done;
+#endif
+
+	gwas->key_econtext->ecxt_scantuple = outer_slot;
+#if PG_VERSION_NUM < 100000
+	return ExecProject(proj, &is_done);
+#else
+	return ExecProject(proj);
+#endif
+}
+
+/*
+ * gpuwinagg_keys_equal
+ *
+ * It compares the keys of the two slots in [@keyidx_start, @keyidx_end).
+ * NULLs are equivalent to each other, like window peers on the executor.
+ */
+static bool
+gpuwinagg_keys_equal(GpuWinAggState *gwas,
+					 TupleTableSlot *slot_x,
+					 TupleTableSlot *slot_y,
+					 int keyidx_start, int keyidx_end)
+{
+	int		k;
+
+	for (k = keyidx_start; k < keyidx_end; k++)
+	{
+		Datum	x_datum, y_datum;
+		bool	x_isnull, y_isnull;
+
+		x_datum = slot_getattr(slot_x, k+1, &x_isnull);
+		y_datum = slot_getattr(slot_y, k+1, &y_isnull);
+		if (x_isnull || y_isnull)
+		{
+			if (x_isnull != y_isnull)
+				return false;
+			continue;
+		}
+		if (!DatumGetBool(FunctionCall2Coll(&gwas->key_eqfuncs[k],
+											gwas->key_collids[k],
+											x_datum, y_datum)))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * gpuwinagg_align_chunk
+ *
+ * If frame of the aggregate functions ends at the last peer of the current
+ * row, a peer group must not be split into two chunks. It moves the peers
+ * of the overflow row at the tail of the chunk to @pds_pending, to be
+ * loaded to the next chunk. If the whole chunk is a peer group, it expands
+ * the chunk, then returns false.
+ */
+static bool
+gpuwinagg_align_chunk(GpuWinAggState *gwas,
+					  pgstrom_data_store **p_pds,
+					  TupleTableSlot *overflow_slot)
+{
+	pgstrom_data_store *pds = *p_pds;
+	pgstrom_data_store *pds_new;
+	TupleDesc	tupdesc = ExecGetResultType(outerPlanState(gwas));
+	TupleTableSlot *slot_y;
+	TupleTableSlot *slot_x;
+	cl_uint		nitems = pds->kds.nitems;
+	cl_uint		index;
+	cl_uint		i;
+	int			nkeys = gwas->num_part_keys + gwas->num_order_keys;
+
+	slot_y = gpuwinagg_project_keys(gwas, gwas->proj_y, overflow_slot);
+	for (index = nitems; index > 0; index--)
+	{
+		slot_x = gpuwinagg_project_keys(gwas, gwas->proj_x,
+										gpuwinagg_fetch_row(gwas, pds,
+															index - 1));
+		if (!gpuwinagg_keys_equal(gwas, slot_x, slot_y, 0, nkeys))
+			break;
+	}
+	ResetExprContext(gwas->key_econtext);
+	if (index == nitems)
+		return true;	/* no peers of the overflow row */
+
+	pds_new = PDS_create_row(gwas->gts.gcontext,
+							 tupdesc,
+							 index > 0
+							 ? pds->kds.length
+							 : 2 * pds->kds.length);
+	for (i = index; i < nitems; i++)
+	{
+		if (!PDS_insert_tuple(pds_new, gpuwinagg_fetch_row(gwas, pds, i)))
+			elog(ERROR, "Bug? peer group of GpuWindowAgg cannot move");
+	}
+	ExecClearTuple(gwas->outer_slot);
+
+	if (index == 0)
+	{
+		/* expand the chunk, then continue to load */
+		PDS_release(pds);
+		*p_pds = pds_new;
+		return false;
+	}
+	pds->kds.nitems = index;
+	gwas->pds_pending = pds_new;
+	return true;
+}
+
+/*
+ * gpuwinagg_create_task
+ */
+static GpuTask *
+gpuwinagg_create_task(GpuWinAggState *gwas, pgstrom_data_store *pds_src)
+{
+	GpuContext	   *gcontext = gwas->gts.gcontext;
+	GpuWinAggTask  *gwtask;
+	kern_gpuwinagg *kgwagg;
+	cl_uint			nitems = pds_src->kds.nitems;
+	cl_uint			nfuncs = gwas->num_funcs;
+	cl_uint			kparams_offset;
+	cl_ulong		values_offset;
+	cl_ulong		counts_offset;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	Size			length;
+
+	kparams_offset = STROMALIGN(sizeof(kern_gpuwinagg));
+	values_offset = kparams_offset +
+		STROMALIGN(gwas->gts.kern_params->length);
+	counts_offset = values_offset +
+		STROMALIGN(sizeof(gpuwinagg_value) * (size_t)nfuncs * nitems);
+	length = offsetof(GpuWinAggTask, kern) + counts_offset +
+		STROMALIGN(sizeof(cl_long) * (size_t)nfuncs * nitems);
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gwtask = (GpuWinAggTask *)m_deviceptr;
+	memset(gwtask, 0, offsetof(GpuWinAggTask, kern) + kparams_offset);
+
+	pgstromInitGpuTask(&gwas->gts, &gwtask->task);
+	gwtask->task_seqno = gwas->next_task_seqno++;
+	gwtask->pds_src = pds_src;
+
+	kgwagg = &gwtask->kern;
+	kgwagg->nitems = nitems;
+	kgwagg->nfuncs = nfuncs;
+	kgwagg->has_order_keys = (gwas->num_order_keys > 0);
+	kgwagg->peer_frame = gwas->peer_frame;
+	kgwagg->kparams_offset = kparams_offset;
+	kgwagg->values_offset = values_offset;
+	kgwagg->counts_offset = counts_offset;
+	memcpy(kgwagg->func_kinds, gwas->func_kinds, sizeof(cl_char) * nfuncs);
+	memcpy(kgwagg->pg_crc32_table,
+		   pg_crc32_table,
+		   sizeof(uint32) * 256);
+	/* kern_parambuf */
+	memcpy(KERN_GPUWINAGG_PARAMBUF(kgwagg),
+		   gwas->gts.kern_params,
+		   gwas->gts.kern_params->length);
+
+	return &gwtask->task;
+}
+
+/*
+ * gpuwinagg_next_task
+ *
+ * callback to construct a new GpuWinAggTask task object based on the
+ * sorted input stream.
+ */
+static GpuTask *
+gpuwinagg_next_task(GpuTaskState *gts)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) gts;
+	PlanState	   *outer_ps = outerPlanState(gwas);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	pgstrom_data_store *pds = gwas->pds_pending;
+	TupleTableSlot *slot;
+
+	gwas->pds_pending = NULL;
+	while (true)
+	{
+		if (gwas->gts.scan_overflow)
+		{
+			if (gwas->gts.scan_overflow == (void *)(~0UL))
+				break;
+			slot = gwas->gts.scan_overflow;
+			gwas->gts.scan_overflow = NULL;
+		}
+		else
+		{
+			slot = ExecProcNode(outer_ps);
+			if (TupIsNull(slot))
+			{
+				gwas->gts.scan_overflow = (void *)(~0UL);
+				break;
+			}
+		}
+
+		/* create a new data-store on demand */
+		if (!pds)
+		{
+			pds = PDS_create_row(gwas->gts.gcontext,
+								 tupdesc,
+								 pgstrom_chunk_size());
+		}
+
+		if (!PDS_insert_tuple(pds, slot))
+		{
+			gwas->gts.scan_overflow = slot;
+			if (gwas->peer_aligned &&
+				!gpuwinagg_align_chunk(gwas, &pds, slot))
+				continue;
+			break;
+		}
+	}
+	if (!pds)
+		return NULL;
+	return gpuwinagg_create_task(gwas, pds);
+}
+
+/*
+ * gpuwinagg_launch_kernel
+ */
+static void
+gpuwinagg_launch_kernel(CUfunction kern_func,
+						size_t nitems,
+						bool single_block,
+						size_t shmem_per_thread,
+						void **kern_args)
+{
+	size_t		grid_sz;
+	size_t		block_sz;
+	CUresult	rc;
+
+	largest_workgroup_size(&grid_sz,
+						   &block_sz,
+						   kern_func,
+						   CU_DEVICE_PER_THREAD,
+						   nitems,
+						   0,
+						   shmem_per_thread);
+	if (single_block)
+		grid_sz = 1;
+	rc = cuLaunchKernel(kern_func,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						shmem_per_thread * block_sz,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+}
+
+/*
+ * gpuwinagg_process_task
+ */
+static int
+gpuwinagg_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *) gtask;
+	GpuWinAggState *gwas = (GpuWinAggState *) gtask->gts;
+	GpuContext	   *gcontext = gwas->gts.gcontext;
+	pgstrom_data_store *pds_src = gwtask->pds_src;
+	kern_gpuwinagg *kgwagg = &gwtask->kern;
+	kern_data_store *kds_slot_head = gwas->kds_slot_head;
+	CUfunction		kern_setup_row;
+	CUfunction		kern_setup_flags;
+	CUfunction		kern_scan_local;
+	CUfunction		kern_scan_spans;
+	CUfunction		kern_scan_final;
+	CUfunction		kern_finalize;
+	CUdeviceptr		m_kgwagg = (CUdeviceptr)kgwagg;
+	CUdeviceptr		m_kds_src = (CUdeviceptr)&pds_src->kds;
+	CUdeviceptr		m_kds_slot = 0UL;
+	CUdeviceptr		m_kwork = 0UL;
+	cl_uint			nitems = kgwagg->nitems;
+	cl_uint			nfuncs = kgwagg->nfuncs;
+	cl_uint			nspans;
+	cl_uint			span_sz;
+	size_t			kds_slot_length;
+	size_t			offset;
+	int				sm_count;
+	void		   *kern_args[4];
+	CUresult		rc;
+	int				retval = 1;
+
+	/*
+	 * Lookup kernel functions
+	 */
+	rc = cuModuleGetFunction(&kern_setup_row, cuda_module,
+							 "gpuwinagg_setup_row");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_setup_flags, cuda_module,
+							 "gpuwinagg_setup_flags");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_scan_local, cuda_module,
+							 "gpuwinagg_scan_local");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_scan_spans, cuda_module,
+							 "gpuwinagg_scan_spans");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_scan_final, cuda_module,
+							 "gpuwinagg_scan_final");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_finalize, cuda_module,
+							 "gpuwinagg_finalize");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/*
+	 * Layout of the working area. Spans are sized so that the summaries of
+	 * spans can be scanned by a single block.
+	 */
+	sm_count = devAttrs[CU_DINDEX_PER_THREAD].MULTIPROCESSOR_COUNT;
+	span_sz = (nitems + sm_count * 1024 - 1) / (sm_count * 1024);
+	span_sz = Max(span_sz, GPUWINAGG_MIN_SPAN_SIZE);
+	nspans = (nitems + span_sz - 1) / span_sz;
+	kgwagg->span_sz = span_sz;
+	kgwagg->nspans = nspans;
+
+	offset = 0;
+	kgwagg->work_row_flags = offset;
+	offset += STROMALIGN(sizeof(cl_uchar) * nitems);
+	kgwagg->work_part_hash = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * nitems);
+	kgwagg->work_part_seq = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * nitems);
+	kgwagg->work_peer_seq = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * nitems);
+	kgwagg->work_part_pos = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * (nitems + 2));
+	kgwagg->work_peer_pos = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * (nitems + 2));
+	kgwagg->work_span_part = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * nspans);
+	kgwagg->work_span_peer = offset;
+	offset += STROMALIGN(sizeof(cl_uint) * nspans);
+	kgwagg->work_span_values = offset;
+	offset += STROMALIGN(sizeof(gpuwinagg_value) * (size_t)nfuncs * nspans);
+	kgwagg->work_span_counts = offset;
+	offset += STROMALIGN(sizeof(cl_long) * (size_t)nfuncs * nspans);
+	kgwagg->work_length = offset;
+
+	/*
+	 * Device memory allocation for short term
+	 */
+	kds_slot_length = KERN_DATA_STORE_HEAD_LENGTH(kds_slot_head) +
+		STROMALIGN(LONGALIGN((sizeof(Datum) + sizeof(char)) *
+							 kds_slot_head->ncols) * nitems);
+	rc = gpuMemAllocManaged(gcontext,
+							&m_kds_slot,
+							kds_slot_length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		goto out_of_resource;
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	memcpy((void *)m_kds_slot, kds_slot_head,
+		   KERN_DATA_STORE_HEAD_LENGTH(kds_slot_head));
+	((kern_data_store *)m_kds_slot)->length = kds_slot_length;
+	((kern_data_store *)m_kds_slot)->nrooms = nitems;
+	((kern_data_store *)m_kds_slot)->nitems = nitems;
+
+	rc = gpuMemAlloc(gcontext, &m_kwork, kgwagg->work_length);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		goto out_of_resource;
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAlloc: %s", errorText(rc));
+
+	/*
+	 * OK, kick a series of GpuWindowAgg invocations
+	 */
+	pgstromTimeStatEventRecord(&gwas->gts, CU_EVENT1_PER_THREAD);
+	rc = cuMemPrefetchAsync(m_kds_src,
+							pds_src->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	rc = cuMemPrefetchAsync(m_kgwagg,
+							KERN_GPUWINAGG_LENGTH(kgwagg),
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	pgstromTimeStatEventRecord(&gwas->gts, CU_EVENT2_PER_THREAD);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * gpuwinagg_setup_row(kern_gpuwinagg *kgwagg,
+	 *                     kern_data_store *kds_src,
+	 *                     kern_data_store *kds_slot,
+	 *                     char *kwork)
+	 */
+	kern_args[0] = &m_kgwagg;
+	kern_args[1] = &m_kds_src;
+	kern_args[2] = &m_kds_slot;
+	kern_args[3] = &m_kwork;
+	gpuwinagg_launch_kernel(kern_setup_row, nitems, false, 0, kern_args);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * gpuwinagg_setup_flags(kern_gpuwinagg *kgwagg,
+	 *                       kern_data_store *kds_slot,
+	 *                       char *kwork)
+	 */
+	kern_args[0] = &m_kgwagg;
+	kern_args[1] = &m_kds_slot;
+	kern_args[2] = &m_kwork;
+	gpuwinagg_launch_kernel(kern_setup_flags, nitems, false, 0, kern_args);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * gpuwinagg_scan_XXXX(kern_gpuwinagg *kgwagg,
+	 *                     char *kwork)
+	 */
+	kern_args[0] = &m_kgwagg;
+	kern_args[1] = &m_kwork;
+	gpuwinagg_launch_kernel(kern_scan_local, nspans, false, 0, kern_args);
+	gpuwinagg_launch_kernel(kern_scan_spans, nspans, true,
+							sizeof(gpuwinagg_value) +
+							sizeof(cl_long) +
+							sizeof(cl_uint),	/* for segmented scan */
+							kern_args);
+	gpuwinagg_launch_kernel(kern_scan_final, nspans, false, 0, kern_args);
+	gpuwinagg_launch_kernel(kern_finalize, nitems, false, 0, kern_args);
+
+	/* write back the results */
+	rc = cuMemPrefetchAsync(m_kgwagg,
+							KERN_GPUWINAGG_LENGTH(kgwagg),
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromTimeStatAddEvents(&gwas->gts, GpuTaskPhase_DmaSend,
+							 CU_EVENT1_PER_THREAD, CU_EVENT2_PER_THREAD);
+	pgstromTimeStatAddEvents(&gwas->gts, GpuTaskPhase_Kernel,
+							 CU_EVENT2_PER_THREAD, CU_EVENT0_PER_THREAD);
+
+	/*
+	 * Clear the error code if CPU fallback case.
+	 */
+	gwtask->task.kerror = kgwagg->kerror;
+	if (pgstrom_cpu_fallback_enabled &&
+		gwtask->task.kerror.errcode == StromError_CpuReCheck)
+	{
+		gwtask->task.kerror.errcode = StromError_Success;
+		gwtask->task.cpu_fallback = true;
+	}
+	retval = 0;
+
+out_of_resource:
+	if (m_kds_slot != 0UL)
+		gpuMemFree(gcontext, m_kds_slot);
+	if (m_kwork != 0UL)
+		gpuMemFree(gcontext, m_kwork);
+	return retval;
+}
+
+/*
+ * gpuwinagg_fallback_task
+ *
+ * It computes the window functions of the chunk on CPU, with the same
+ * semantics as the device code; results are relative to the chunk head.
+ */
+static void
+gpuwinagg_fallback_task(GpuWinAggState *gwas, GpuWinAggTask *gwtask)
+{
+	kern_gpuwinagg *kgwagg = &gwtask->kern;
+	pgstrom_data_store *pds_src = gwtask->pds_src;
+	cl_uint		nitems = kgwagg->nitems;
+	cl_uint		nfuncs = kgwagg->nfuncs;
+	int			npart = gwas->num_part_keys;
+	int			nkeys = gwas->num_part_keys + gwas->num_order_keys;
+	cl_uchar   *row_flags = palloc(sizeof(cl_uchar) * nitems);
+	gpuwinagg_value *accum = palloc0(sizeof(gpuwinagg_value) * nfuncs);
+	cl_long	   *acc_counts = palloc0(sizeof(cl_long) * nfuncs);
+	cl_uint		num_parts = 0;
+	cl_uint		num_peers = 0;
+	cl_uint		part_head = 0;
+	cl_uint		peer_head = 0;
+	cl_long		dense_rank = 0;
+	cl_uint		index;
+	cl_uint		fn_index;
+
+	kgwagg->first_part_nitems = nitems;
+	kgwagg->first_peer_nitems = nitems;
+	for (index=0; index < nitems; index++)
+	{
+		TupleTableSlot *slot;
+		cl_uchar	flags;
+
+		slot = gpuwinagg_project_keys(gwas, gwas->proj_y,
+									  gpuwinagg_fetch_row(gwas, pds_src,
+														  index));
+		if (index == 0 ||
+			!gpuwinagg_keys_equal(gwas, gwas->slot_x, slot, 0, npart))
+			flags = (GPUWINAGG_ROW__PART_HEAD | GPUWINAGG_ROW__PEER_HEAD);
+		else if (gwas->num_order_keys > 0 &&
+				 !gpuwinagg_keys_equal(gwas, gwas->slot_x, slot, npart, nkeys))
+			flags = GPUWINAGG_ROW__PEER_HEAD;
+		else
+			flags = 0;
+
+		if ((flags & GPUWINAGG_ROW__PART_HEAD) != 0)
+		{
+			if (num_parts++ == 1)
+				kgwagg->first_part_nitems = index;
+			part_head = index;
+			dense_rank = 0;
+			memset(accum, 0, sizeof(gpuwinagg_value) * nfuncs);
+			memset(acc_counts, 0, sizeof(cl_long) * nfuncs);
+		}
+		if ((flags & GPUWINAGG_ROW__PEER_HEAD) != 0)
+		{
+			if (num_peers++ == 1)
+				kgwagg->first_peer_nitems = index;
+			peer_head = index;
+			dense_rank++;
+		}
+		row_flags[index] = flags;
+
+		for (fn_index=0; fn_index < nfuncs; fn_index++)
+		{
+			gpuwinagg_value *values = KERN_GPUWINAGG_VALUES(kgwagg,fn_index);
+			cl_long	   *counts = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index);
+			cl_int		argidx = gwas->func_argidx[fn_index];
+			Oid			argtype = gwas->func_argtypes[fn_index];
+			Datum		datum = 0;
+			bool		isnull = true;
+
+			if (argidx >= 0)
+				datum = slot_getattr(slot, argidx + 1, &isnull);
+
+			switch (gwas->func_kinds[fn_index])
+			{
+				case GPUWINAGG_FUNC__ROW_NUMBER:
+					values[index].ival = index - part_head + 1;
+					counts[index] = 1;
+					continue;
+				case GPUWINAGG_FUNC__RANK:
+					values[index].ival = peer_head - part_head + 1;
+					counts[index] = 1;
+					continue;
+				case GPUWINAGG_FUNC__DENSE_RANK:
+					values[index].ival = dense_rank;
+					counts[index] = 1;
+					continue;
+				case GPUWINAGG_FUNC__COUNT:
+					if (argidx < 0 || !isnull)
+						acc_counts[fn_index]++;
+					accum[fn_index].ival = acc_counts[fn_index];
+					break;
+				case GPUWINAGG_FUNC__SUM_INT:
+					if (!isnull)
+					{
+						if (argtype == INT2OID)
+							accum[fn_index].ival += DatumGetInt16(datum);
+						else
+							accum[fn_index].ival += DatumGetInt32(datum);
+						acc_counts[fn_index]++;
+					}
+					break;
+				case GPUWINAGG_FUNC__SUM_FP:
+					if (!isnull)
+					{
+						if (argtype == FLOAT4OID)
+							accum[fn_index].fval += DatumGetFloat4(datum);
+						else
+							accum[fn_index].fval += DatumGetFloat8(datum);
+						acc_counts[fn_index]++;
+					}
+					break;
+				default:
+					elog(ERROR, "Bug? unexpected GpuWindowAgg function: %d",
+						 (int)gwas->func_kinds[fn_index]);
+			}
+			values[index] = accum[fn_index];
+			counts[index] = acc_counts[fn_index];
+		}
+		/* keep the keys of the previous row */
+		ExecCopySlot(gwas->slot_x, slot);
+		ResetExprContext(gwas->key_econtext);
+	}
+	kgwagg->num_parts = num_parts;
+	kgwagg->num_peers = num_peers;
+	kgwagg->last_part_nitems = nitems - part_head;
+	kgwagg->last_peer_nitems = nitems - peer_head;
+	kgwagg->last_part_npeers = dense_rank;
+
+	/* broadcast the value of the last peer, if RANGE mode */
+	if (gwas->peer_frame)
+	{
+		for (index = nitems - 1; index > 0; index--)
+		{
+			if ((row_flags[index] & GPUWINAGG_ROW__PEER_HEAD) != 0)
+				continue;
+			for (fn_index=0; fn_index < nfuncs; fn_index++)
+			{
+				gpuwinagg_value *values
+					= KERN_GPUWINAGG_VALUES(kgwagg,fn_index);
+				cl_long	   *counts = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index);
+
+				if (!GPUWINAGG_FUNC_IS_AGGREGATE(gwas->func_kinds[fn_index]))
+					continue;
+				values[index - 1] = values[index];
+				counts[index - 1] = counts[index];
+			}
+		}
+	}
+	ExecClearTuple(gwas->slot_x);
+	gwas->num_fallback_rows += nitems;
+
+	pfree(row_flags);
+	pfree(accum);
+	pfree(acc_counts);
+}
+
+/*
+ * gpuwinagg_switch_task
+ *
+ * It adds the carry from the previous chunk on the first partition of the
+ * chunk, if it continues, then saves the carry for the next chunk.
+ */
+static void
+gpuwinagg_switch_task(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) gts;
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *) gtask;
+	kern_gpuwinagg *kgwagg = &gwtask->kern;
+	TupleTableSlot *slot;
+	cl_uint			nitems = kgwagg->nitems;
+	cl_uint			index;
+	cl_uint			fn_index;
+	int				npart = gwas->num_part_keys;
+	int				nkeys = gwas->num_part_keys + gwas->num_order_keys;
+	bool			part_cont = false;
+	bool			peer_cont = false;
+
+	if (gtask->cpu_fallback)
+	{
+		instr_time	tv_start;
+
+		if (gts->tm_stat)
+			INSTR_TIME_SET_CURRENT(tv_start);
+		gpuwinagg_fallback_task(gwas, gwtask);
+		if (gts->tm_stat)
+			pgstromTimeStatAddElapsed(gts, GpuTaskPhase_CpuFallback,
+									  &tv_start);
+	}
+	if (nitems == 0)
+		return;
+
+	/* Does the partition (or peer group) continue from the previous one? */
+	if (gwas->carry_valid)
+	{
+		slot = gpuwinagg_project_keys(gwas, gwas->proj_y,
+									  gpuwinagg_fetch_row(gwas,
+														  gwtask->pds_src,
+														  0));
+		part_cont = gpuwinagg_keys_equal(gwas, gwas->carry_slot, slot,
+										 0, npart);
+		if (part_cont)
+			peer_cont = gpuwinagg_keys_equal(gwas, gwas->carry_slot, slot,
+											 npart, nkeys);
+		ResetExprContext(gwas->key_econtext);
+	}
+
+	/* apply the carry on the first partition */
+	if (part_cont)
+	{
+		for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+		{
+			gpuwinagg_value *values = KERN_GPUWINAGG_VALUES(kgwagg,fn_index);
+			cl_long	   *counts = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index);
+			cl_char		kind = gwas->func_kinds[fn_index];
+
+			for (index=0; index < kgwagg->first_part_nitems; index++)
+			{
+				switch (kind)
+				{
+					case GPUWINAGG_FUNC__ROW_NUMBER:
+						values[index].ival += gwas->carry_nrows;
+						break;
+					case GPUWINAGG_FUNC__RANK:
+						if (peer_cont && index < kgwagg->first_peer_nitems)
+							values[index].ival = (gwas->carry_nrows -
+												  gwas->carry_peer_nrows + 1);
+						else
+							values[index].ival += gwas->carry_nrows;
+						break;
+					case GPUWINAGG_FUNC__DENSE_RANK:
+						values[index].ival += (gwas->carry_npeers -
+											   (peer_cont ? 1 : 0));
+						break;
+					case GPUWINAGG_FUNC__SUM_FP:
+						values[index].fval += gwas->carry_values[fn_index].fval;
+						counts[index] += gwas->carry_counts[fn_index];
+						break;
+					default:
+						values[index].ival += gwas->carry_values[fn_index].ival;
+						counts[index] += gwas->carry_counts[fn_index];
+						break;
+				}
+			}
+		}
+	}
+
+	/* save the carry for the next chunk */
+	if (part_cont && kgwagg->num_parts == 1)
+	{
+		if (peer_cont && kgwagg->num_peers == 1)
+			gwas->carry_peer_nrows += kgwagg->last_peer_nitems;
+		else
+			gwas->carry_peer_nrows = kgwagg->last_peer_nitems;
+		gwas->carry_npeers += (kgwagg->last_part_npeers -
+							   (peer_cont ? 1 : 0));
+		gwas->carry_nrows += kgwagg->last_part_nitems;
+	}
+	else
+	{
+		gwas->carry_peer_nrows = kgwagg->last_peer_nitems;
+		gwas->carry_npeers = kgwagg->last_part_npeers;
+		gwas->carry_nrows = kgwagg->last_part_nitems;
+	}
+	for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+	{
+		gwas->carry_values[fn_index]
+			= KERN_GPUWINAGG_VALUES(kgwagg,fn_index)[nitems - 1];
+		gwas->carry_counts[fn_index]
+			= KERN_GPUWINAGG_COUNTS(kgwagg,fn_index)[nitems - 1];
+	}
+	slot = gpuwinagg_project_keys(gwas, gwas->proj_x,
+								  gpuwinagg_fetch_row(gwas,
+													  gwtask->pds_src,
+													  nitems - 1));
+	ExecCopySlot(gwas->carry_slot, slot);
+	ResetExprContext(gwas->key_econtext);
+	gwas->carry_valid = true;
+}
+
+/*
+ * gpuwinagg_final_value
+ */
+static void
+gpuwinagg_final_value(GpuWinAggState *gwas,
+					  kern_gpuwinagg *kgwagg,
+					  cl_uint fn_index, cl_uint index,
+					  Datum *p_value, bool *p_isnull)
+{
+	gpuwinagg_value	value = KERN_GPUWINAGG_VALUES(kgwagg,fn_index)[index];
+	cl_long		count = KERN_GPUWINAGG_COUNTS(kgwagg,fn_index)[index];
+	cl_char		kind = gwas->func_kinds[fn_index];
+
+	/* SUM() and AVG() of no valid values are NULL */
+	if ((kind == GPUWINAGG_FUNC__SUM_INT ||
+		 kind == GPUWINAGG_FUNC__SUM_FP) && count == 0)
+	{
+		*p_value = 0;
+		*p_isnull = true;
+		return;
+	}
+	*p_isnull = false;
+
+	switch (gwas->func_finals[fn_index])
+	{
+		case GPUWINAGG_FINAL__INT8:
+			*p_value = Int64GetDatum(value.ival);
+			break;
+		case GPUWINAGG_FINAL__FLOAT4:
+			*p_value = Float4GetDatum((float4) value.fval);
+			break;
+		case GPUWINAGG_FINAL__FLOAT8:
+			*p_value = Float8GetDatum(value.fval);
+			break;
+		case GPUWINAGG_FINAL__NUMERIC_AVG:
+			*p_value = DirectFunctionCall2(numeric_div,
+							DirectFunctionCall1(int8_numeric,
+												Int64GetDatum(value.ival)),
+							DirectFunctionCall1(int8_numeric,
+												Int64GetDatum(count)));
+			break;
+		case GPUWINAGG_FINAL__FLOAT8_AVG:
+			*p_value = Float8GetDatum(value.fval / (double) count);
+			break;
+		default:
+			elog(ERROR, "Bug? unexpected GpuWindowAgg finalization: %d",
+				 (int)gwas->func_finals[fn_index]);
+	}
+}
+
+/*
+ * gpuwinagg_next_tuple
+ *
+ * It returns a row of the source chunk, with results of window functions.
+ */
+static TupleTableSlot *
+gpuwinagg_next_tuple(GpuTaskState *gts)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) gts;
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *) gts->curr_task;
+	kern_gpuwinagg *kgwagg = &gwtask->kern;
+	TupleTableSlot *slot = gts->css.ss.ss_ScanTupleSlot;
+	TupleTableSlot *outer_slot;
+	ExprContext	   *econtext = gts->css.ss.ps.ps_ExprContext;
+	MemoryContext	oldcxt;
+	cl_uint			index;
+	cl_uint			fn_index;
+	int				natts;
+
+	if (gts->curr_index >= kgwagg->nitems)
+		return NULL;
+	index = gts->curr_index++;
+
+	outer_slot = gpuwinagg_fetch_row(gwas, gwtask->pds_src, index);
+	slot_getallattrs(outer_slot);
+	natts = outer_slot->tts_tupleDescriptor->natts;
+
+	ExecClearTuple(slot);
+	memcpy(slot->tts_values, outer_slot->tts_values, sizeof(Datum) * natts);
+	memcpy(slot->tts_isnull, outer_slot->tts_isnull, sizeof(bool) * natts);
+	oldcxt = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+	for (fn_index=0; fn_index < kgwagg->nfuncs; fn_index++)
+	{
+		gpuwinagg_final_value(gwas, kgwagg, fn_index, index,
+							  &slot->tts_values[natts + fn_index],
+							  &slot->tts_isnull[natts + fn_index]);
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	return ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * gpuwinagg_fetch_next_task
+ *
+ * fetch_next_gputask() returns tasks in order of completion, however,
+ * window functions need the chunks in order of the input stream.
+ */
+static GpuWinAggTask *
+gpuwinagg_fetch_next_task(GpuWinAggState *gwas)
+{
+	GpuWinAggTask  *gwtask;
+	GpuTask		   *gtask;
+	dlist_iter		iter;
+
+	for (;;)
+	{
+		dlist_foreach(iter, &gwas->pending_tasks)
+		{
+			gwtask = dlist_container(GpuWinAggTask, task.chain, iter.cur);
+			if (gwtask->task_seqno == gwas->curr_task_seqno)
+			{
+				dlist_delete(&gwtask->task.chain);
+				gwas->curr_task_seqno++;
+				return gwtask;
+			}
+		}
+
+		gtask = fetch_next_gputask(&gwas->gts);
+		if (!gtask)
+		{
+			if (!dlist_is_empty(&gwas->pending_tasks))
+				elog(ERROR, "Bug? GpuWindowAgg task (seqno=%u) was lost",
+					 gwas->curr_task_seqno);
+			return NULL;
+		}
+		gwtask = (GpuWinAggTask *) gtask;
+		if (gwtask->task_seqno == gwas->curr_task_seqno)
+		{
+			gwas->curr_task_seqno++;
+			return gwtask;
+		}
+		dlist_push_tail(&gwas->pending_tasks, &gtask->chain);
+	}
+}
+
+/*
+ * gpuwinagg_exec_scan
+ *
+ * Like pgstromExecGpuTaskState, but tasks are scanned in order.
+ */
+static TupleTableSlot *
+gpuwinagg_exec_scan(GpuWinAggState *gwas)
+{
+	GpuTaskState   *gts = &gwas->gts;
+	GpuWinAggTask  *gwtask;
+	TupleTableSlot *slot = NULL;
+
+	while (!gts->curr_task || !(slot = gts->cb_next_tuple(gts)))
+	{
+		if (gts->curr_task)
+		{
+			gts->cb_release_task(gts->curr_task);
+			gts->curr_task = NULL;
+			gts->curr_index = 0;
+			gts->curr_lp_index = 0;
+		}
+		gwtask = gpuwinagg_fetch_next_task(gwas);
+		if (!gwtask)
+			return NULL;
+		if (gwtask->task.cpu_fallback)
+			gts->num_cpu_fallbacks++;
+		gts->curr_task = &gwtask->task;
+		gts->curr_index = 0;
+		gts->curr_lp_index = 0;
+		gts->cb_switch_task(gts, &gwtask->task);
+	}
+	return slot;
+}
+
+/*
+ * gpuwinagg_release_pending
+ */
+static void
+gpuwinagg_release_pending(GpuWinAggState *gwas)
+{
+	GpuTaskState   *gts = &gwas->gts;
+	dlist_node	   *dnode;
+
+	if (gts->curr_task)
+	{
+		gts->cb_release_task(gts->curr_task);
+		gts->curr_task = NULL;
+		gts->curr_index = 0;
+	}
+	while (!dlist_is_empty(&gwas->pending_tasks))
+	{
+		dnode = dlist_pop_head_node(&gwas->pending_tasks);
+		gts->cb_release_task(dlist_container(GpuTask, chain, dnode));
+	}
+	if (gwas->pds_pending)
+	{
+		PDS_release(gwas->pds_pending);
+		gwas->pds_pending = NULL;
+	}
+}
+
+/*
+ * ExecReCheckGpuWinAgg
+ */
+static bool
+ExecReCheckGpuWinAgg(CustomScanState *node, TupleTableSlot *slot)
+{
+	/*
+	 * GpuWindowAgg shall be never located under the LockRows, so we don't
+	 * expect that we need to have valid EPQ recheck here.
+	 */
+	return true;
+}
+
+/*
+ * ExecGpuWinAgg
+ */
+static TupleTableSlot *
+ExecGpuWinAgg(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) gpuwinagg_exec_scan,
+					(ExecScanRecheckMtd) ExecReCheckGpuWinAgg);
+}
+
+/*
+ * ExecEndGpuWinAgg
+ */
+static void
+ExecEndGpuWinAgg(CustomScanState *node)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gwas->gts.gcontext);
+	gpuwinagg_release_pending(gwas);
+	/* clean up subtree */
+	ExecEndNode(outerPlanState(node));
+
+	/* release any other resources */
+	if (gwas->outer_slot)
+		ExecDropSingleTupleTableSlot(gwas->outer_slot);
+	if (gwas->slot_x)
+		ExecDropSingleTupleTableSlot(gwas->slot_x);
+	if (gwas->slot_y)
+		ExecDropSingleTupleTableSlot(gwas->slot_y);
+	if (gwas->carry_slot)
+		ExecDropSingleTupleTableSlot(gwas->carry_slot);
+	pgstromReleaseGpuTaskState(&gwas->gts);
+}
+
+/*
+ * ExecReScanGpuWinAgg
+ */
+static void
+ExecReScanGpuWinAgg(CustomScanState *node)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gwas->gts.gcontext);
+	gpuwinagg_release_pending(gwas);
+	/* common rescan handling */
+	pgstromRescanGpuTaskState(&gwas->gts);
+	/* reset other stuff */
+	gwas->gts.scan_done = false;
+	gwas->gts.scan_overflow = NULL;
+	gwas->next_task_seqno = 0;
+	gwas->curr_task_seqno = 0;
+	gwas->carry_valid = false;
+	ExecClearTuple(gwas->carry_slot);
+	/* also rescan subtree */
+	ExecReScan(outerPlanState(node));
+}
+
+/*
+ * ExplainGpuWinAgg
+ */
+static void
+ExplainGpuWinAgg(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuWinAggInfo  *gwa_info = deform_gpuwinagg_info(cscan);
+	List		   *dcontext;
+	List		   *part_keys = NIL;
+	List		   *order_keys = NIL;
+	List		   *window_funcs = NIL;
+	ListCell	   *lc;
+	int				index;
+	int				nouters;
+	char		   *exprstr;
+
+	/* Set up deparsing context */
+	dcontext = set_deparse_context_planstate(es->deparse_cxt,
+											 (Node *)&gwas->gts.css.ss.ps,
+											 ancestors);
+	index = 0;
+	foreach (lc, gwa_info->tlist_slot)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		if (index < gwa_info->num_part_keys)
+			part_keys = lappend(part_keys, tle->expr);
+		else if (index < gwa_info->num_part_keys + gwa_info->num_order_keys)
+			order_keys = lappend(order_keys, tle->expr);
+		index++;
+	}
+	nouters = list_length(cscan->custom_scan_tlist) - gwas->num_funcs;
+	index = 0;
+	foreach (lc, cscan->custom_scan_tlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		if (index++ >= nouters)
+			window_funcs = lappend(window_funcs, tle->expr);
+	}
+
+	/* Show partition keys, sort keys and window functions */
+	if (part_keys != NIL)
+	{
+		exprstr = deparse_expression((Node *)part_keys, dcontext,
+									 es->verbose, false);
+		ExplainPropertyText("Partition By", exprstr, es);
+	}
+	if (order_keys != NIL)
+	{
+		exprstr = deparse_expression((Node *)order_keys, dcontext,
+									 es->verbose, false);
+		ExplainPropertyText("Order By", exprstr, es);
+	}
+	exprstr = deparse_expression((Node *)window_funcs, dcontext,
+								 es->verbose, false);
+	ExplainPropertyText("Window Functions", exprstr, es);
+	if (gwas->peer_aligned)
+		ExplainPropertyText("Frame", "RANGE (aligned to peers)", es);
+	else if (es->format != EXPLAIN_FORMAT_TEXT)
+		ExplainPropertyText("Frame", gwas->peer_frame ? "RANGE" : "ROWS", es);
+
+	/* other common fields */
+	pgstromExplainGpuTaskState(&gwas->gts, es);
+	/* other run-time statistics, if any */
+	if (gwas->num_fallback_rows > 0)
+		ExplainPropertyLong("Num of CPU fallback rows",
+							gwas->num_fallback_rows, es);
+}
+
+/*
+ * gpuwinagg_release_task
+ */
+static void
+gpuwinagg_release_task(GpuTask *gtask)
+{
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *)gtask;
+	GpuContext	   *gcontext = gtask->gts->gcontext;
+
+	if (gwtask->pds_src)
+		PDS_release(gwtask->pds_src);
+	gpuMemFree(gcontext, (CUdeviceptr)gwtask);
+}
+
+/*
+ * entrypoint of GpuWindowAgg
+ */
+void
+pgstrom_init_gpuwinagg(void)
+{
+	/* enable_gpuwinagg parameter */
+	DefineCustomBoolVariable("pg_strom.enable_gpuwinagg",
+							 "Enables the use of GPU window functions",
+							 NULL,
+							 &enable_gpuwinagg,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* initialization of path method table */
+	memset(&gpuwinagg_path_methods, 0, sizeof(CustomPathMethods));
+	gpuwinagg_path_methods.CustomName          = "GpuWindowAgg";
+	gpuwinagg_path_methods.PlanCustomPath      = PlanGpuWinAggPath;
+
+	/* initialization of plan method table */
+	memset(&gpuwinagg_scan_methods, 0, sizeof(CustomScanMethods));
+	gpuwinagg_scan_methods.CustomName          = "GpuWindowAgg";
+	gpuwinagg_scan_methods.CreateCustomScanState
+		= CreateGpuWinAggScanState;
+	RegisterCustomScanMethods(&gpuwinagg_scan_methods);
+
+	/* initialization of exec method table */
+	memset(&gpuwinagg_exec_methods, 0, sizeof(CustomExecMethods));
+	gpuwinagg_exec_methods.CustomName          = "GpuWindowAgg";
+	gpuwinagg_exec_methods.BeginCustomScan     = ExecInitGpuWinAgg;
+	gpuwinagg_exec_methods.ExecCustomScan      = ExecGpuWinAgg;
+	gpuwinagg_exec_methods.EndCustomScan       = ExecEndGpuWinAgg;
+	gpuwinagg_exec_methods.ReScanCustomScan    = ExecReScanGpuWinAgg;
+	gpuwinagg_exec_methods.ExplainCustomScan   = ExplainGpuWinAgg;
+	/* hook registration */
+	create_upper_paths_next = create_upper_paths_hook;
+	create_upper_paths_hook = gpuwinagg_add_window_paths;
+}
@@ -33,6 +33,10 @@ typedef struct
 	bool			xmax_committed;
 	bool			xmin_committed;
 	cl_int			pinning;	/* CUDA device index */
+	cl_int			shard_id;	/* index of the shard in this revision */
+	cl_int			nshards;	/* number of shards in this revision */
+	cl_int			delta_id;	/* sequence number of the delta chunk
+								 * appended to the shards, or 0 */
 	cl_int			format;		/* one of GSTORE_FDW_FORMAT__* */
 	size_t			rawsize;	/* rawsize regardless of the internal format */
 	size_t			nitems;		/* nitems regardless of the internal format */
@@ -68,19 +72,30 @@ typedef struct
 typedef struct
 {
 	Oid				table_oid;	/* oid of the gstore_fdw */
-	cl_int			pinning;	/* CUDA device index */
+	cl_int			nshards;	/* number of shards */
+	cl_int			shards[GSTORE_FDW_MAX_SHARDS];	/* CUDA device index
+													 * of each shard */
+	cl_int			ndeltas;	/* number of delta chunks on the device */
 	cl_int			format;		/* one of GSTORE_FDW_FORMAT__* */
-	cl_uint			revision;	/* revision number of the buffer */
+	cl_uint			revision;	/* latest revision number of the chunks */
 	bool			read_only;	/* true, if read-write buffer is not ready */
+	bool			append_only; /* true, if read-write buffer has only rows
+								  * to be appended to the device image */
 	bool			is_dirty;	/* true, if any updates happen on the read-
 								 * write buffer, thus read-only buffer is
 								 * not uptodata any more. */
 	MemoryContext	memcxt;		/* context for the buffers below */
-	/* read-only buffer */
+	/* read-only buffer (loaded on demand) */
 	union {
 		kern_data_store *kds;	/* copy of GPU device memory, if any */
 		void	   *buffer;
 	} h;
+	kern_data_store *h_chunks[GSTORE_FDW_MAX_IMAGES];	/* KDS of the shards
+														 * and delta chunks
+														 * in the h.buffer */
+	size_t			h_nitems;	/* total nitems of the device image */
+	size_t			h_base_nitems; /* nitems of the shards, except for
+									* the delta chunks */
 	size_t			rawsize;
 	/* read/write buffer */
 	MVCCAttrs	   *cs_mvcc;	/* t_xmin/t_xmax/t_cid and flags */
@@ -95,16 +110,34 @@ typedef struct
 	GpuStoreBuffer *gs_buffer;
 	cl_ulong		gs_index;
 	AttrNumber		ctid_anum;	/* only UPDATE or DELETE */
+	/* only lookup by hash-index */
+	AttrNumber		index_anum;	/* key column, or InvalidAttrNumber */
+	ExprState	   *index_key;	/* key expression */
+	devtype_info   *index_dtype; /* device type of the key */
+	bool			index_ready; /* true, if index_hash is ready */
+	bool			index_done;	/* true, if lookup on the device images
+								 * is already done */
+	cl_uint			index_hash;	/* hash value of the key */
+	cl_int			index_chunk; /* current chunk of the device images */
+	cl_uint			index_pos;	/* current position in the chunk */
+	size_t			index_base;	/* first row index of the delta chunk */
 } GpuStoreExecState;
 
 /* ---- static functions ---- */
 static void	gstore_fdw_table_options(Oid gstore_oid,
 									int *p_pinning, int *p_format);
+static int	gstore_fdw_table_shards(Oid gstore_oid, cl_int *shards);
 static void gstore_fdw_column_options(Oid gstore_oid, AttrNumber attnum,
-									  int *p_compression);
+									  int *p_compression, bool *p_hash_index);
+static AttrNumber gstore_fdw_index_column(Relation frel,
+										  devtype_info **p_dtype);
+static bool gstore_fdw_hash_key(devtype_info *dtype, Datum datum,
+								bool isnull, cl_uint *p_hash);
 
 /* ---- static variables ---- */
 static int				gstore_max_relations;		/* GUC */
+static int				gstore_max_delta_chunks;	/* GUC */
+static int				gstore_load_nthreads;		/* GUC */
 static shmem_startup_hook_type shmem_startup_next;
 static object_access_hook_type object_access_next;
 static GpuStoreHead	   *gstore_head = NULL;
@@ -123,6 +156,7 @@ Datum pgstrom_reggstore_out(PG_FUNCTION_ARGS);
 Datum pgstrom_reggstore_recv(PG_FUNCTION_ARGS);
 Datum pgstrom_reggstore_send(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_export_ipchandle(PG_FUNCTION_ARGS);
+Datum pgstrom_gstore_fdw_load(PG_FUNCTION_ARGS);
 
 /*
  * gstore_fdw_chunk_visibility - equivalent to HeapTupleSatisfiesMVCC,
@@ -286,43 +320,92 @@ gstore_fdw_chunk_hashvalue(Oid gstore_oid)
 }
 
 /*
- * gstore_fdw_lookup_chunk
+ * gstore_fdw_lookup_chunks
+ *
+ * It looks up all the shards of the GpuStoreChunk visible to the snapshot,
+ * and the delta chunks appended to them, then returns number of the chunks
+ * (or 0 if no visible chunks). The shards are stored on the head of @chunks
+ * in order of the shard_id, then the delta chunks follow in order of the
+ * delta_id. @chunks must have GSTORE_FDW_MAX_IMAGES items at least.
  */
-static GpuStoreChunk *
-gstore_fdw_lookup_chunk_nolock(Oid gstore_oid, Snapshot snapshot)
+static int
+gstore_fdw_lookup_chunks_nolock(Oid gstore_oid, Snapshot snapshot,
+								GpuStoreChunk **chunks, int *p_nshards)
 {
-	GpuStoreChunk *gs_chunk = NULL;
 	pg_crc32	hash = gstore_fdw_chunk_hashvalue(gstore_oid);
 	int			index = hash % GSTORE_CHUNK_HASH_NSLOTS;
+	GpuStoreChunk *deltas[GSTORE_FDW_MAX_DELTAS];
+	int			nshards = 0;
+	int			ndeltas = 0;
+	int			i;
 	dlist_iter	iter;
 
+	memset(chunks, 0, sizeof(GpuStoreChunk *) * GSTORE_FDW_MAX_IMAGES);
+	memset(deltas, 0, sizeof(deltas));
 	dlist_foreach(iter, &gstore_head->active_chunks[index])
 	{
 		GpuStoreChunk  *gs_temp = dlist_container(GpuStoreChunk,
 												  chain, iter.cur);
-		if (gs_temp->hash == hash &&
-			gs_temp->database_oid == MyDatabaseId &&
-			gs_temp->table_oid == gstore_oid &&
-			gstore_fdw_chunk_visibility(gs_temp, snapshot))
+		if (gs_temp->hash != hash ||
+			gs_temp->database_oid != MyDatabaseId ||
+			gs_temp->table_oid != gstore_oid ||
+			!gstore_fdw_chunk_visibility(gs_temp, snapshot))
+			continue;
+
+		if (gs_temp->delta_id > 0)
 		{
-			if (!gs_chunk)
-				gs_chunk = gs_temp;
-			else
+			if (gs_temp->delta_id > GSTORE_FDW_MAX_DELTAS)
+				elog(ERROR, "Bug? GpuStoreChunk has corrupted delta %d",
+					 gs_temp->delta_id);
+			if (deltas[gs_temp->delta_id - 1] != NULL)
 				elog(ERROR, "Bug? multiple GpuStoreChunks are visible");
+			deltas[gs_temp->delta_id - 1] = gs_temp;
+			ndeltas = Max(ndeltas, gs_temp->delta_id);
+			continue;
 		}
+		if (gs_temp->shard_id < 0 ||
+			gs_temp->shard_id >= gs_temp->nshards ||
+			gs_temp->nshards > GSTORE_FDW_MAX_SHARDS)
+			elog(ERROR, "Bug? GpuStoreChunk has corrupted shard %d of %d",
+				 gs_temp->shard_id, gs_temp->nshards);
+		if (nshards == 0)
+			nshards = gs_temp->nshards;
+		else if (nshards != gs_temp->nshards ||
+				 chunks[gs_temp->shard_id] != NULL)
+			elog(ERROR, "Bug? multiple GpuStoreChunks are visible");
+		chunks[gs_temp->shard_id] = gs_temp;
 	}
-	return gs_chunk;
+	for (i=0; i < nshards; i++)
+	{
+		if (!chunks[i] || chunks[i]->revision != chunks[0]->revision)
+			elog(ERROR, "Bug? shard %d of GpuStoreChunk is missing", i);
+	}
+	if (ndeltas > 0 && nshards == 0)
+		elog(ERROR, "Bug? delta chunks are visible without shards");
+	for (i=0; i < ndeltas; i++)
+	{
+		if (!deltas[i])
+			elog(ERROR, "Bug? delta %d of GpuStoreChunk is missing", i+1);
+		chunks[nshards + i] = deltas[i];
+	}
+	if (p_nshards)
+		*p_nshards = nshards;
+	return nshards + ndeltas;
 }
 
-static GpuStoreChunk *
-gstore_fdw_lookup_chunk(Oid gstore_oid, Snapshot snapshot)
+static int
+gstore_fdw_lookup_chunks(Oid gstore_oid, Snapshot snapshot,
+						 GpuStoreChunk **chunks, int *p_nshards)
 {
-	GpuStoreChunk  *gs_chunk = NULL;
+	int			nchunks = 0;
 
 	SpinLockAcquire(&gstore_head->lock);
 	PG_TRY();
 	{
-		gs_chunk = gstore_fdw_lookup_chunk_nolock(gstore_oid, snapshot);
+		nchunks = gstore_fdw_lookup_chunks_nolock(gstore_oid,
+												  snapshot,
+												  chunks,
+												  p_nshards);
 	}
 	PG_CATCH();
 	{
@@ -332,22 +415,74 @@ gstore_fdw_lookup_chunk(Oid gstore_oid, Snapshot snapshot)
 	PG_END_TRY();
 	SpinLockRelease(&gstore_head->lock);
 
-	return gs_chunk;
+	return nchunks;
 }
 
 /*
- * gstore_fdw_insert_chunk - host-to-device DMA
+ * gstore_fdw_latest_revision
+ *
+ * It returns the revision number of the last chunk; delta chunks always
+ * have newer revision than the shards they are appended to.
+ */
+static inline cl_uint
+gstore_fdw_latest_revision(GpuStoreChunk **chunks, int nchunks)
+{
+	return (nchunks > 0 ? chunks[nchunks - 1]->revision : 0);
+}
+
+/*
+ * gstore_fdw_lookup_chunk
+ *
+ * It returns the first chunk of the gstore_fdw visible to the snapshot.
+ */
+static GpuStoreChunk *
+gstore_fdw_lookup_chunk(Oid gstore_oid, Snapshot snapshot)
+{
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+
+	if (gstore_fdw_lookup_chunks(gstore_oid, snapshot, chunks, NULL) == 0)
+		return NULL;
+	return chunks[0];
+}
+
+/*
+ * gstore_fdw_discard_chunk
+ *
+ * It releases a GpuStoreChunk not linked to the shared hash table yet.
  */
 static void
-gstore_fdw_insert_chunk(GpuStoreBuffer *gs_buffer, size_t nrooms)
+gstore_fdw_discard_chunk(GpuStoreChunk *gs_chunk)
+{
+	gpuMemFreePreserved(gs_chunk->pinning,
+						gs_chunk->ipc_mhandle);
+	memset(gs_chunk, 0, sizeof(GpuStoreChunk));
+	SpinLockAcquire(&gstore_head->lock);
+	dlist_push_head(&gstore_head->free_chunks, &gs_chunk->chain);
+	SpinLockRelease(&gstore_head->lock);
+}
+
+/*
+ * gstore_fdw_insert_chunk - host-to-device DMA
+ *
+ * It constructs a shard of the new revision on the device memory. The new
+ * GpuStoreChunk is invisible until gstore_fdw_publish_chunks().
+ * If @delta_id is positive, it constructs a delta chunk on the device
+ * where the @shard_id is pinned, instead of the shard itself.
+ */
+static GpuStoreChunk *
+gstore_fdw_insert_chunk(GpuStoreBuffer *gs_buffer,
+						cl_uint revision, cl_int shard_id, cl_int delta_id,
+						size_t nrooms, size_t rawsize,
+						void (*stream_cb)(GpuIpcMemStream *gstream,
+										  void *cb_private),
+						void *cb_private)
 {
 	CUresult		rc;
 	dlist_node	   *dnode;
 	GpuStoreChunk  *gs_chunk;
-	int				index;
-	dlist_iter		iter;
 
-	Assert(gs_buffer->pinning < numDevAttrs);
+	Assert(shard_id >= 0 && shard_id < gs_buffer->nshards);
+	Assert(gs_buffer->shards[shard_id] < numDevAttrs);
 
 	/* setup GpuStoreChunk */
 	SpinLockAcquire(&gstore_head->lock);
@@ -360,65 +495,148 @@ gstore_fdw_insert_chunk(GpuStoreBuffer *gs_buffer, size_t nrooms)
 	gs_chunk = dlist_container(GpuStoreChunk, chain, dnode);
 	SpinLockRelease(&gstore_head->lock);
 
-	gs_chunk->revision
-		= pg_atomic_add_fetch_u32(&gstore_head->revision_seed, 1);
+	gs_chunk->revision = revision;
 	gs_chunk->hash = gstore_fdw_chunk_hashvalue(gs_buffer->table_oid);
 	gs_chunk->database_oid = MyDatabaseId;
 	gs_chunk->table_oid = gs_buffer->table_oid;
 	gs_chunk->xmax = InvalidTransactionId;
 	gs_chunk->xmin = GetCurrentTransactionId();
-	gs_chunk->pinning = gs_buffer->pinning;
+	gs_chunk->pinning = gs_buffer->shards[shard_id];
+	if (delta_id > 0)
+	{
+		gs_chunk->shard_id = 0;
+		gs_chunk->nshards = 1;
+		gs_chunk->delta_id = delta_id;
+	}
+	else
+	{
+		gs_chunk->shard_id = shard_id;
+		gs_chunk->nshards = gs_buffer->nshards;
+		gs_chunk->delta_id = 0;
+	}
 	gs_chunk->format = gs_buffer->format;
-	gs_chunk->rawsize = gs_buffer->rawsize;
+	gs_chunk->rawsize = rawsize;
 	gs_chunk->nitems = nrooms;
 
 	/* DMA to device */
-	rc = gpuMemAllocPreserved(gs_buffer->pinning,
+	rc = gpuMemAllocPreserved(gs_chunk->pinning,
 							  &gs_chunk->ipc_mhandle,
-							  gs_buffer->rawsize);
+							  rawsize);
 	if (rc != CUDA_SUCCESS)
+	{
+		memset(gs_chunk, 0, sizeof(GpuStoreChunk));
+		SpinLockAcquire(&gstore_head->lock);
+		dlist_push_head(&gstore_head->free_chunks, &gs_chunk->chain);
+		SpinLockRelease(&gstore_head->lock);
 		elog(ERROR, "failed on gpuMemAllocPreserved: %s", errorText(rc));
+	}
 
 	PG_TRY();
 	{
-		gpuIpcMemCopyFromHost(gs_chunk->pinning,
-							  gs_chunk->ipc_mhandle,
-							  0,
-							  gs_buffer->h.buffer,
-							  gs_buffer->rawsize);
+		size_t		length;
+
+		length = gpuIpcMemCopyFromHostStream(gs_chunk->pinning,
+											 gs_chunk->ipc_mhandle,
+											 0,
+											 stream_cb,
+											 cb_private);
+		if (length != rawsize)
+			elog(ERROR, "gstore_fdw: Bug? length of the chunk mismatch (%zu of %zu)",
+				 length, rawsize);
 	}
 	PG_CATCH();
 	{
-		gpuMemFreePreserved(gs_buffer->pinning,
-							gs_chunk->ipc_mhandle);
-		memset(gs_chunk, 0, sizeof(GpuStoreChunk));
-		SpinLockAcquire(&gstore_head->lock);
-		dlist_push_head(&gstore_head->free_chunks, &gs_chunk->chain);
-		SpinLockRelease(&gstore_head->lock);
+		gstore_fdw_discard_chunk(gs_chunk);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
-	gs_buffer->revision = gs_chunk->revision;
 
-	/* add GpuStoreChunk to the shared hash table */
-	index = gs_chunk->hash % GSTORE_CHUNK_HASH_NSLOTS;
+	return gs_chunk;
+}
+
+/*
+ * gstore_fdw_publish_chunks
+ *
+ * It adds all the shards of the new revision to the shared hash table at
+ * once, then older revision (including its delta chunks) shall become
+ * invisible on commit. A delta chunk is published alone, and it does not
+ * affect to the visibility of the existing chunks.
+ */
+static void
+gstore_fdw_publish_chunks(GpuStoreBuffer *gs_buffer,
+						  GpuStoreChunk **shards, int nshards)
+{
+	pg_crc32		hash = gstore_fdw_chunk_hashvalue(gs_buffer->table_oid);
+	int				index = hash % GSTORE_CHUNK_HASH_NSLOTS;
+	int				i;
+	dlist_iter		iter;
+
 	SpinLockAcquire(&gstore_head->lock);
-	dlist_foreach(iter, &gstore_head->active_chunks[index])
+	if (shards[0]->delta_id > 0)
 	{
-		GpuStoreChunk  *gs_temp = dlist_container(GpuStoreChunk,
-												  chain, iter.cur);
-		if (gs_temp->hash == gs_chunk->hash &&
-			gs_temp->database_oid == gs_chunk->database_oid &&
-			gs_temp->table_oid == gs_chunk->table_oid &&
-			gs_temp->xmax == InvalidTransactionId)
+		int		nlive_shards = 0;
+		int		nlive_deltas = 0;
+		cl_uint	revision = 0;
+
+		/*
+		 * Delta chunk assumes the device image is not changed since the
+		 * local buffer was built. It is usually protected by the lock,
+		 * however, the snapshot may be older than the last writer.
+		 */
+		dlist_foreach(iter, &gstore_head->active_chunks[index])
+		{
+			GpuStoreChunk  *gs_temp = dlist_container(GpuStoreChunk,
+													  chain, iter.cur);
+			if (gs_temp->hash == hash &&
+				gs_temp->database_oid == MyDatabaseId &&
+				gs_temp->table_oid == gs_buffer->table_oid &&
+				gs_temp->xmax == InvalidTransactionId)
+			{
+				if (gs_temp->delta_id > 0)
+					nlive_deltas++;
+				else
+					nlive_shards++;
+				revision = Max(revision, gs_temp->revision);
+			}
+		}
+		if (nlive_shards != gs_buffer->nshards ||
+			nlive_deltas != gs_buffer->ndeltas ||
+			revision != gs_buffer->revision)
 		{
-			gs_temp->xmax = gs_chunk->xmin;
+			SpinLockRelease(&gstore_head->lock);
+			ereport(ERROR,
+					(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+					 errmsg("gstore_fdw: could not append rows due to concurrent update")));
 		}
 	}
-	dlist_push_head(&gstore_head->active_chunks[index],
-					&gs_chunk->chain);
+	else
+	{
+		dlist_foreach(iter, &gstore_head->active_chunks[index])
+		{
+			GpuStoreChunk  *gs_temp = dlist_container(GpuStoreChunk,
+													  chain, iter.cur);
+			if (gs_temp->hash == hash &&
+				gs_temp->database_oid == MyDatabaseId &&
+				gs_temp->table_oid == gs_buffer->table_oid &&
+				gs_temp->xmax == InvalidTransactionId)
+			{
+				gs_temp->xmax = GetCurrentTransactionId();
+			}
+		}
+	}
+	for (i=0; i < nshards; i++)
+	{
+		Assert(shards[i]->hash == hash &&
+			   (shards[i]->delta_id > 0
+				? nshards == 1
+				: shards[i]->shard_id == i));
+		dlist_push_head(&gstore_head->active_chunks[index],
+						&shards[i]->chain);
+	}
 	pg_atomic_add_fetch_u32(&gstore_head->has_warm_chunks, 1);
 	SpinLockRelease(&gstore_head->lock);
+
+	gs_buffer->revision = shards[0]->revision;
 }
 
 /*
@@ -438,34 +656,146 @@ gstore_fdw_release_chunk(GpuStoreChunk *gs_chunk)
 }
 
 /*
- * gstore_fdw_make_buffer_writable
+ * gstore_fdw_fetch_readonly_row
+ *
+ * It fetches a row from the read-only buffer. Rows on the shards come first
+ * in round-robin, then rows on the delta chunks follow in order.
+ */
+static bool
+gstore_fdw_fetch_readonly_row(GpuStoreBuffer *gs_buffer,
+							  TupleTableSlot *slot, size_t row_index)
+{
+	int			nshards = gs_buffer->nshards;
+	int			k;
+
+	Assert(gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM);
+	if (row_index >= gs_buffer->h_nitems)
+		return false;
+	if (row_index < gs_buffer->h_base_nitems)
+		return KDS_fetch_tuple_column(slot,
+									  gs_buffer->h_chunks[row_index % nshards],
+									  row_index / nshards);
+	row_index -= gs_buffer->h_base_nitems;
+	for (k = nshards; k < nshards + gs_buffer->ndeltas; k++)
+	{
+		kern_data_store *kds = gs_buffer->h_chunks[k];
+
+		if (row_index < kds->nitems)
+			return KDS_fetch_tuple_column(slot, kds, row_index);
+		row_index -= kds->nitems;
+	}
+	return false;
+}
+
+/*
+ * gstore_fdw_fetch_buffer_row
+ *
+ * It fetches a row from the read-write buffer, regardless of the visibility.
  */
 static void
-gstore_fdw_make_buffer_writable(Relation frel, GpuStoreBuffer *gs_buffer)
+gstore_fdw_fetch_buffer_row(TupleDesc tupdesc, ccacheBuffer *cc_buf,
+							TupleTableSlot *slot, size_t index)
 {
-	TupleDesc		tupdesc = RelationGetDescr(frel);
-	ccacheBuffer   *cc_buf = &gs_buffer->cc_buf;
-	size_t			nrooms;
-	size_t			nitems;
-	size_t			i;
+	cl_int		j;
 
-	/* already done? */
-	if (!gs_buffer->read_only)
-		return;
-	/* calculation of nrooms */
-	if (!gs_buffer->h.buffer)
+	ExecClearTuple(slot);
+	for (j=0; j < tupdesc->natts; j++)
 	{
-		nitems = 0;
-		nrooms = 10000;
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		vl_dict_key	*vkey;
+		int			unitsz;
+		void	   *addr;
+
+		if (att_isnull(j, cc_buf->nullmap[j]))
+		{
+			slot->tts_isnull[j] = true;
+			continue;
+		}
+		slot->tts_isnull[j] = false;
+		if (attr->attlen < 0)
+		{
+			vkey = ((vl_dict_key **)cc_buf->values[j])[index];
+			slot->tts_values[j] = PointerGetDatum(vkey->vl_datum);
+		}
+		else
+		{
+			unitsz = att_align_nominal(attr->attlen,
+									   attr->attalign);
+			addr = (char *)cc_buf->values[j] + unitsz * index;
+			if (!attr->attbyval)
+				slot->tts_values[j] = PointerGetDatum(addr);
+			else if (attr->attlen == sizeof(cl_char))
+				slot->tts_values[j] = CharGetDatum(*((cl_char *)addr));
+			else if (attr->attlen == sizeof(cl_short))
+				slot->tts_values[j] = Int16GetDatum(*((cl_short *)addr));
+			else if (attr->attlen == sizeof(cl_int))
+				slot->tts_values[j] = Int32GetDatum(*((cl_int *)addr));
+			else if (attr->attlen == sizeof(cl_long))
+				slot->tts_values[j] = Int64GetDatum(*((cl_long *)addr));
+			else
+				elog(ERROR, "gstore_fdw: unexpected attlen: %d",
+					 attr->attlen);
+		}
 	}
-	else if (gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM)
+	ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * gstore_fdw_load_readonly_buffer
+ *
+ * It copies the shards and delta chunks on the device memory to the
+ * read-only buffer, if not loaded yet.
+ */
+static void
+gstore_fdw_load_readonly_buffer(Relation frel, GpuStoreBuffer *gs_buffer,
+								Snapshot snapshot)
+{
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+	int				nchunks, nshards;
+	size_t			rawsize = 0;
+	char		   *hbuf;
+	int				i;
+
+	if (gs_buffer->h.buffer || gs_buffer->revision == 0)
+		return;
+	nchunks = gstore_fdw_lookup_chunks(RelationGetRelid(frel),
+									   snapshot, chunks, &nshards);
+	if (gstore_fdw_latest_revision(chunks, nchunks) != gs_buffer->revision ||
+		nshards != gs_buffer->nshards ||
+		nchunks != nshards + gs_buffer->ndeltas)
+		elog(ERROR, "gstore_fdw: local buffer of \"%s\" is not up-to-date",
+			 RelationGetRelationName(frel));
+
+	for (i=0; i < nchunks; i++)
+		rawsize += STROMALIGN(chunks[i]->rawsize);
+	hbuf = MemoryContextAllocHuge(gs_buffer->memcxt, rawsize);
+
+	/* chunks are placed on the read-only buffer in order */
+	rawsize = 0;
+	for (i=0; i < nchunks; i++)
 	{
-		nitems = gs_buffer->h.kds->nitems;
-		nrooms = gs_buffer->h.kds->nitems + 10000;
+		gpuIpcMemCopyToHost(hbuf + rawsize,
+							chunks[i]->pinning,
+							chunks[i]->ipc_mhandle,
+							0,
+							chunks[i]->rawsize);
+		gs_buffer->h_chunks[i] = (kern_data_store *)(hbuf + rawsize);
+		rawsize += STROMALIGN(chunks[i]->rawsize);
 	}
-	else
-		elog(ERROR, "gstore_fdw: Bug? unknown buffer format: %d",
-			 gs_buffer->format);
+	gs_buffer->h.buffer = hbuf;
+	gs_buffer->rawsize  = rawsize;
+}
+
+/*
+ * gstore_fdw_setup_writable_buffer
+ */
+static void
+gstore_fdw_setup_writable_buffer(Relation frel, GpuStoreBuffer *gs_buffer,
+								 size_t nrooms)
+{
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	int				j;
+
 	gs_buffer->cs_mvcc = MemoryContextAllocHuge(gs_buffer->memcxt,
 												sizeof(MVCCAttrs) * nrooms);
 	ccache_setup_buffer(tupdesc,
@@ -473,27 +803,95 @@ gstore_fdw_make_buffer_writable(Relation frel, GpuStoreBuffer *gs_buffer)
 						false,	/* no system columns */
 						nrooms,
 						gs_buffer->memcxt);
-	for (i=0; i < tupdesc->natts; i++)
+	for (j=0; j < tupdesc->natts; j++)
 	{
-		Form_pg_attribute attr = tupdesc->attrs[i];
+		Form_pg_attribute attr = tupdesc->attrs[j];
 		int		vl_compress;
 
 		gstore_fdw_column_options(attr->attrelid, attr->attnum,
-								  &vl_compress);
-		gs_buffer->cc_buf.vl_compress[i] = vl_compress;
+								  &vl_compress, NULL);
+		gs_buffer->cc_buf.vl_compress[j] = vl_compress;
 	}
-	gs_buffer->cc_buf.nitems = nitems;
+	gs_buffer->cc_buf.nitems = 0;
+}
+
+/*
+ * gstore_fdw_make_buffer_writable
+ *
+ * If @append_only, read-write buffer keeps only the rows to be appended,
+ * then they shall be loaded as a delta chunk on commit, without copy of
+ * the existing device image. Once rows on the device image get updated
+ * or deleted, the read-write buffer is materialized with all the rows,
+ * then the whole image shall be rebuilt on commit. It is also used to
+ * merge the delta chunks onto the shards, if too many.
+ */
+static void
+gstore_fdw_make_buffer_writable(Relation frel, GpuStoreBuffer *gs_buffer,
+								Snapshot snapshot, bool append_only)
+{
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	ccacheBuffer   *cc_buf = &gs_buffer->cc_buf;
+	ccacheBuffer	old_cc_buf;
+	MVCCAttrs	   *old_mvcc = NULL;
+	TupleTableSlot *slot = NULL;
+	size_t			nrooms;
+	size_t			nitems;
+	size_t			i;
+
+	if (gs_buffer->format != GSTORE_FDW_FORMAT__PGSTROM)
+		elog(ERROR, "gstore_fdw: Bug? unknown buffer format: %d",
+			 gs_buffer->format);
+
+	if (!gs_buffer->read_only)
+	{
+		/* already done? */
+		if (!gs_buffer->append_only || append_only)
+			return;
+		/* rows to be appended are moved to the materialized buffer */
+		memcpy(&old_cc_buf, cc_buf, sizeof(ccacheBuffer));
+		old_mvcc = gs_buffer->cs_mvcc;
+	}
+	else if (append_only &&
+			 gs_buffer->revision != 0 &&
+			 gs_buffer->ndeltas < gstore_max_delta_chunks)
+	{
+		gstore_fdw_setup_writable_buffer(frel, gs_buffer, 10000);
+		gs_buffer->append_only = true;
+		gs_buffer->read_only = false;
+		return;
+	}
+
+	/* calculation of nrooms */
+	nitems = gs_buffer->h_nitems;
+	nrooms = nitems + (old_mvcc ? old_cc_buf.nitems : 0) + 10000;
+	gstore_fdw_load_readonly_buffer(frel, gs_buffer, snapshot);
+	gstore_fdw_setup_writable_buffer(frel, gs_buffer, nrooms);
 	if (nitems > 0)
 	{
-		if (gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM)
+		if (gs_buffer->nshards == 1 && gs_buffer->ndeltas == 0)
 		{
+			cc_buf->nitems = nitems;
 			ccache_copy_buffer_from_kds(tupdesc, cc_buf,
 										gs_buffer->h.kds,
 										gs_buffer->memcxt);
 		}
 		else
-			elog(ERROR, "gstore_fdw: Bug? unknown buffer format: %d",
-				 gs_buffer->format);
+		{
+			slot = MakeSingleTupleTableSlot(tupdesc);
+			for (i=0; i < nitems; i++)
+			{
+				if (!gstore_fdw_fetch_readonly_row(gs_buffer, slot, i))
+					elog(ERROR, "gstore_fdw: Bug? row %zu is missing", i);
+				slot_getallattrs(slot);
+				ccache_buffer_append_row(tupdesc,
+										 cc_buf,
+										 NULL,	/* no system columns */
+										 slot->tts_isnull,
+										 slot->tts_values,
+										 gs_buffer->memcxt);
+				cc_buf->nitems++;
+			}
+		}
 		/* initial tuples are all visible */
 		for (i=0; i < nitems; i++)
 		{
@@ -506,9 +904,58 @@ gstore_fdw_make_buffer_writable(Relation frel, GpuStoreBuffer *gs_buffer)
 			mvcc->xmax_committed = false;
 		}
 	}
+
+	if (old_mvcc)
+	{
+		if (!slot)
+			slot = MakeSingleTupleTableSlot(tupdesc);
+		for (i=0; i < old_cc_buf.nitems; i++)
+		{
+			gstore_fdw_fetch_buffer_row(tupdesc, &old_cc_buf, slot, i);
+			ccache_buffer_append_row(tupdesc,
+									 cc_buf,
+									 NULL,	/* no system columns */
+									 slot->tts_isnull,
+									 slot->tts_values,
+									 gs_buffer->memcxt);
+			memcpy(&gs_buffer->cs_mvcc[cc_buf->nitems++],
+				   &old_mvcc[i], sizeof(MVCCAttrs));
+		}
+		ccache_release_buffer(&old_cc_buf);
+		pfree(old_mvcc);
+	}
+	if (slot)
+		ExecDropSingleTupleTableSlot(slot);
+	gs_buffer->append_only = false;
 	gs_buffer->read_only = false;
 }
 
+/*
+ * gstore_fdw_writable_index
+ *
+ * It translates the row_index carried by ctid to the index on the read-write
+ * buffer. The buffer is materialized if row on the device image is touched.
+ */
+static size_t
+gstore_fdw_writable_index(Relation frel, GpuStoreBuffer *gs_buffer,
+						  Snapshot snapshot, cl_ulong row_index,
+						  const char *cmd_name)
+{
+	size_t		index = row_index;
+
+	gstore_fdw_make_buffer_writable(frel, gs_buffer, snapshot,
+									!gs_buffer->read_only &&
+									row_index >= gs_buffer->h_nitems);
+	if (gs_buffer->append_only)
+		index -= gs_buffer->h_nitems;
+	if (index >= gs_buffer->cc_buf.nitems)
+		elog(ERROR, "gstore_fdw: %s row out of range (%lu of %zu)",
+			 cmd_name, row_index,
+			 gs_buffer->cc_buf.nitems +
+			 (gs_buffer->append_only ? gs_buffer->h_nitems : 0));
+	return index;
+}
+
 /*
  * gstore_fdw_create_buffer - make a local buffer of GpuStore
  */
@@ -516,7 +963,9 @@ static GpuStoreBuffer *
 gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 {
 	GpuStoreBuffer *gs_buffer = NULL;
-	GpuStoreChunk  *gs_chunk = NULL;
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+	int				nchunks, nshards;
+	cl_uint			revision;
 	MemoryContext	memcxt = NULL;
 	bool			found;
 
@@ -539,81 +988,64 @@ gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 							&RelationGetRelid(frel),
 							HASH_ENTER,
 							&found);
+	nchunks = gstore_fdw_lookup_chunks(RelationGetRelid(frel),
+									   snapshot, chunks, &nshards);
+	revision = gstore_fdw_latest_revision(chunks, nchunks);
 	if (found)
 	{
 		Assert(gs_buffer->table_oid == RelationGetRelid(frel));
-		gs_chunk = gstore_fdw_lookup_chunk(RelationGetRelid(frel), snapshot);
-		if (!gs_chunk)
-		{
-			if (gs_buffer->revision == 0)
-				return gs_buffer;	/* no gs_chunk right now */
-		}
-		else if (gs_buffer->revision == gs_chunk->revision)
+		if (gs_buffer->revision == revision)
 			return gs_buffer;		/* ok local buffer is up to date */
 		/* oops, local cache is older than in-GPU image... */
 		MemoryContextDelete(gs_buffer->memcxt);
 	}
-	else
-	{
-		gs_chunk = gstore_fdw_lookup_chunk(RelationGetRelid(frel), snapshot);
-	}
 
 	/*
 	 * Local buffer is not found, or invalid. So, re-initialize it again.
+	 * Read-only buffer shall be loaded from the device memory on demand.
 	 */
 	PG_TRY();
 	{
-		cl_int		pinning;
 		cl_int		format;
-		cl_uint		revision;
+		int			i;
 
 		memcxt = AllocSetContextCreate(CacheMemoryContext,
 									   "GpuStoreBuffer",
 									   ALLOCSET_DEFAULT_SIZES);
-		if (!gs_chunk)
-		{
-			gstore_fdw_table_options(RelationGetRelid(frel),
-									 &pinning, &format);
-			gs_buffer->pinning   = pinning;
-			gs_buffer->format    = format;
-			gs_buffer->revision  = 0;
-			gs_buffer->read_only = true;
-			gs_buffer->is_dirty  = false;
-			gs_buffer->memcxt    = memcxt;
-			gs_buffer->h.buffer  = NULL;
-			gs_buffer->cs_mvcc   = NULL;
-			memset(&gs_buffer->cc_buf, 0, sizeof(ccacheBuffer));
-			gstore_fdw_make_buffer_writable(frel, gs_buffer);
-		}
-		else
+		gstore_fdw_table_options(RelationGetRelid(frel),
+								 NULL, &format);
+		Assert(gs_buffer->table_oid == RelationGetRelid(frel));
+		gs_buffer->nshards   =
+			gstore_fdw_table_shards(RelationGetRelid(frel),
+									gs_buffer->shards);
+		gs_buffer->ndeltas   = nchunks - nshards;
+		gs_buffer->format    = (nchunks > 0 ? chunks[0]->format : format);
+		gs_buffer->revision  = revision;
+		gs_buffer->read_only = true;
+		gs_buffer->append_only = false;
+		gs_buffer->is_dirty  = false;
+		gs_buffer->memcxt    = memcxt;
+		gs_buffer->h.buffer  = NULL;
+		memset(gs_buffer->h_chunks, 0, sizeof(gs_buffer->h_chunks));
+		gs_buffer->h_nitems  = 0;
+		gs_buffer->h_base_nitems = 0;
+		gs_buffer->rawsize   = 0;
+		gs_buffer->cs_mvcc   = NULL;
+		memset(&gs_buffer->cc_buf, 0, sizeof(ccacheBuffer));
+		if (nshards > 0)
+			gs_buffer->nshards = nshards;
+		for (i=0; i < nchunks; i++)
 		{
-			size_t		rawsize;
-			void	   *hbuf;
-
-			pinning  = gs_chunk->pinning;
-			format   = gs_chunk->format;
-			revision = gs_chunk->revision;
-			rawsize  = gs_chunk->rawsize;
-			hbuf = MemoryContextAllocHuge(memcxt, rawsize);
-
-			gpuIpcMemCopyToHost(hbuf,
-								gs_chunk->pinning,
-								gs_chunk->ipc_mhandle,
-								0,
-								rawsize);
-
-			Assert(gs_buffer->table_oid == RelationGetRelid(frel));
-			gs_buffer->pinning   = pinning;
-			gs_buffer->format    = format;
-			gs_buffer->revision  = revision;
-			gs_buffer->read_only = true;
-			gs_buffer->is_dirty  = false;
-			gs_buffer->memcxt    = memcxt;
-			gs_buffer->h.buffer  = hbuf;
-			gs_buffer->rawsize   = rawsize;
-			gs_buffer->cs_mvcc   = NULL;
-			memset(&gs_buffer->cc_buf, 0, sizeof(ccacheBuffer));
+			if (i < nshards)
+			{
+				gs_buffer->shards[i] = chunks[i]->pinning;
+				gs_buffer->h_base_nitems += chunks[i]->nitems;
+			}
+			gs_buffer->h_nitems += chunks[i]->nitems;
+			gs_buffer->rawsize  += STROMALIGN(chunks[i]->rawsize);
 		}
+		if (nchunks == 0)
+			gstore_fdw_make_buffer_writable(frel, gs_buffer, snapshot, false);
 	}
 	PG_CATCH();
 	{
@@ -643,23 +1075,82 @@ gstoreGetForeignRelSize(PlannerInfo *root,
 						Oid ftable_oid)
 {
 	Snapshot		snapshot;
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+	size_t			nitems = 0;
+	size_t			rawsize = 0;
+	int				i, nchunks;
 
 	snapshot = RegisterSnapshot(GetTransactionSnapshot());
-	gs_chunk = gstore_fdw_lookup_chunk(ftable_oid, snapshot);
+	nchunks = gstore_fdw_lookup_chunks(ftable_oid, snapshot, chunks, NULL);
+	for (i=0; i < nchunks; i++)
+	{
+		nitems  += chunks[i]->nitems;
+		rawsize += chunks[i]->rawsize;
+	}
 	UnregisterSnapshot(snapshot);
 
-	baserel->rows	= (gs_chunk ? gs_chunk->nitems : 0);
-	baserel->pages	= (gs_chunk ? gs_chunk->rawsize / BLCKSZ : 0);
+	baserel->rows	= nitems;
+	baserel->pages	= rawsize / BLCKSZ;
 }
 
 /*
- * gstoreGetForeignPaths
+ * gstore_fdw_index_clause
+ *
+ * It checks whether the clause is 'key = expr' form that is available for
+ * lookup by the hash-index, then returns the 'expr', or NULL if not.
+ */
+static Expr *
+gstore_fdw_index_clause(RelOptInfo *baserel, RestrictInfo *rinfo,
+						AttrNumber anum, Oid atttypid)
+{
+	OpExpr	   *op = (OpExpr *) rinfo->clause;
+	TypeCacheEntry *tcache;
+	Node	   *arg1;
+	Node	   *arg2;
+	Node	   *other;
+
+	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+		return NULL;
+	tcache = lookup_type_cache(atttypid, TYPECACHE_EQ_OPR);
+	if (op->opno != tcache->eq_opr)
+		return NULL;
+	arg1 = linitial(op->args);
+	arg2 = lsecond(op->args);
+	if (IsA(arg1, Var) &&
+		((Var *) arg1)->varno == baserel->relid &&
+		((Var *) arg1)->varattno == anum &&
+		((Var *) arg1)->varlevelsup == 0)
+		other = arg2;
+	else if (IsA(arg2, Var) &&
+			 ((Var *) arg2)->varno == baserel->relid &&
+			 ((Var *) arg2)->varattno == anum &&
+			 ((Var *) arg2)->varlevelsup == 0)
+		other = arg1;
+	else
+		return NULL;
+
+	if (exprType(other) != atttypid ||
+		bms_is_member(baserel->relid, pull_varnos(other)) ||
+		contain_volatile_functions(other))
+		return NULL;
+
+	return (Expr *) other;
+}
+
+/*
+ * gstore_fdw_add_index_path
+ *
+ * It adds a path to lookup rows by the hash-index. The key expression is
+ * evaluated once per scan, and the clause is rechecked by the scan quals
+ * because of hash collision.
  */
 static void
-gstoreGetForeignPaths(PlannerInfo *root,
-					  RelOptInfo *baserel,
-					  Oid foreigntableid)
+gstore_fdw_add_index_path(PlannerInfo *root,
+						  RelOptInfo *baserel,
+						  RestrictInfo *rinfo,
+						  Expr *key_expr,
+						  AttrNumber anum,
+						  Relids required_outer)
 {
 	ParamPathInfo *param_info;
 	ForeignPath *fpath;
@@ -667,42 +1158,137 @@ gstoreGetForeignPaths(PlannerInfo *root,
 	Cost		per_tuple = baserel->baserestrictcost.per_tuple;
 	Cost		run_cost;
 	QualCost	qcost;
+	Selectivity	selectivity;
+	double		nrows;
 
-	param_info = get_baserel_parampathinfo(root, baserel, NULL);
+	param_info = get_baserel_parampathinfo(root, baserel, required_outer);
 	if (param_info)
 	{
 		cost_qual_eval(&qcost, param_info->ppi_clauses, root);
 		startup_cost += qcost.startup;
 		per_tuple += qcost.per_tuple;
 	}
-	run_cost = per_tuple * baserel->rows;
+	cost_qual_eval_node(&qcost, (Node *) key_expr, root);
+	startup_cost += qcost.startup + qcost.per_tuple;
+
+	selectivity = clause_selectivity(root, (Node *) rinfo, 0,
+									 JOIN_INNER, NULL);
+	nrows = clamp_row_est(baserel->rows * selectivity);
+	run_cost = (per_tuple + cpu_operator_cost) * nrows;
 
 	fpath = create_foreignscan_path(root,
 									baserel,
 									NULL,	/* default pathtarget */
-									baserel->rows,
+									nrows,
 									startup_cost,
 									startup_cost + run_cost,
 									NIL,	/* no pathkeys */
-									NULL,	/* no outer rel either */
+									required_outer,
 									NULL,	/* no extra plan */
-									NIL);	/* no fdw_private */
+									list_make2(makeInteger(anum),
+											   key_expr));
 	add_path(baserel, (Path *) fpath);
 }
 
 /*
- * gstoreGetForeignPlan
+ * gstoreGetForeignPaths
  */
-static ForeignScan *
-gstoreGetForeignPlan(PlannerInfo *root,
-					 RelOptInfo *baserel,
-					 Oid foreigntableid,
-					 ForeignPath *best_path,
-					 List *tlist,
-					 List *scan_clauses,
-					 Plan *outer_plan)
-{
+static void
+gstoreGetForeignPaths(PlannerInfo *root,
+					  RelOptInfo *baserel,
+					  Oid foreigntableid)
+{
+	ParamPathInfo *param_info;
+	ForeignPath *fpath;
+	Relation	frel;
+	AttrNumber	anum;
+	ListCell   *lc;
+	Cost		startup_cost = baserel->baserestrictcost.startup;
+	Cost		per_tuple = baserel->baserestrictcost.per_tuple;
+	Cost		run_cost;
+	QualCost	qcost;
+
+	param_info = get_baserel_parampathinfo(root, baserel, NULL);
+	if (param_info)
+	{
+		cost_qual_eval(&qcost, param_info->ppi_clauses, root);
+		startup_cost += qcost.startup;
+		per_tuple += qcost.per_tuple;
+	}
+	run_cost = per_tuple * baserel->rows;
+
+	fpath = create_foreignscan_path(root,
+									baserel,
+									NULL,	/* default pathtarget */
+									baserel->rows,
+									startup_cost,
+									startup_cost + run_cost,
+									NIL,	/* no pathkeys */
+									NULL,	/* no outer rel either */
+									NULL,	/* no extra plan */
+									NIL);	/* no fdw_private */
+	add_path(baserel, (Path *) fpath);
+
+	/* lookup by hash-index, if equality clause on the key column */
+	frel = heap_open(foreigntableid, NoLock);
+	anum = gstore_fdw_index_column(frel, NULL);
+	if (anum != InvalidAttrNumber)
+	{
+		Oid		atttypid = RelationGetDescr(frel)->attrs[anum-1]->atttypid;
+		Expr   *key_expr;
+
+		foreach (lc, baserel->baserestrictinfo)
+		{
+			RestrictInfo *rinfo = lfirst(lc);
+
+			key_expr = gstore_fdw_index_clause(baserel, rinfo,
+											   anum, atttypid);
+			if (key_expr)
+			{
+				gstore_fdw_add_index_path(root, baserel, rinfo,
+										  key_expr, anum, NULL);
+				break;
+			}
+		}
+
+		/* parameterized by the outer relation, like a dimension table */
+		foreach (lc, baserel->joininfo)
+		{
+			RestrictInfo *rinfo = lfirst(lc);
+			Relids		required_outer;
+
+			if (!join_clause_is_movable_to(rinfo, baserel))
+				continue;
+			key_expr = gstore_fdw_index_clause(baserel, rinfo,
+											   anum, atttypid);
+			if (!key_expr)
+				continue;
+			required_outer = bms_difference(rinfo->clause_relids,
+											baserel->relids);
+			if (bms_is_empty(required_outer))
+				continue;
+			gstore_fdw_add_index_path(root, baserel, rinfo,
+									  key_expr, anum, required_outer);
+		}
+	}
+	heap_close(frel, NoLock);
+}
+
+/*
+ * gstoreGetForeignPlan
+ */
+static ForeignScan *
+gstoreGetForeignPlan(PlannerInfo *root,
+					 RelOptInfo *baserel,
+					 Oid foreigntableid,
+					 ForeignPath *best_path,
+					 List *tlist,
+					 List *scan_clauses,
+					 Plan *outer_plan)
+{
 	List	   *scan_quals = NIL;
+	List	   *fdw_exprs = NIL;
+	List	   *fdw_private = NIL;
 	ListCell   *lc;
 
 	foreach (lc, scan_clauses)
@@ -715,11 +1301,19 @@ gstoreGetForeignPlan(PlannerInfo *root,
 		scan_quals = lappend(scan_quals, rinfo->clause);
 	}
 
+	/* lookup by hash-index; the key clause is also kept in scan_quals */
+	if (best_path->fdw_private != NIL)
+	{
+		Assert(list_length(best_path->fdw_private) == 2);
+		fdw_private = list_make1(linitial(best_path->fdw_private));
+		fdw_exprs = list_make1(lsecond(best_path->fdw_private));
+	}
+
 	return make_foreignscan(tlist,
 							scan_quals,
 							baserel->relid,
-							NIL,		/* fdw_exprs */
-							NIL,		/* fdw_private */
+							fdw_exprs,
+							fdw_private,
 							NIL,		/* fdw_scan_tlist */
 							NIL,		/* fdw_recheck_quals */
 							NULL);		/* outer_plan */
@@ -765,6 +1359,7 @@ static void
 gstoreBeginForeignScan(ForeignScanState *node, int eflags)
 {
 	EState	   *estate = node->ss.ps.state;
+	ForeignScan *fscan = (ForeignScan *) node->ss.ps.plan;
 	GpuStoreExecState *gstate;
 
 	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
@@ -774,9 +1369,113 @@ gstoreBeginForeignScan(ForeignScanState *node, int eflags)
 		elog(ERROR, "cannot scan gstore_fdw table without MVCC snapshot");
 
 	gstate = palloc0(sizeof(GpuStoreExecState));
+	if (fscan->fdw_private != NIL)
+	{
+		Expr	   *key_expr = linitial(fscan->fdw_exprs);
+
+		gstate->index_anum = intVal(linitial(fscan->fdw_private));
+		gstate->index_key = ExecInitExpr(key_expr, &node->ss.ps);
+		gstate->index_dtype = pgstrom_devtype_lookup(exprType((Node *)
+															  key_expr));
+		if (!gstate->index_dtype || !gstate->index_dtype->hash_func)
+			elog(ERROR, "gstore_fdw: hash-index is not supported on type %s",
+				 format_type_be(exprType((Node *) key_expr)));
+	}
 	node->fdw_state = (void *) gstate;
 }
 
+/*
+ * gstore_fdw_index_lookup
+ *
+ * It fetches the next row with the same hash value of the key from the
+ * device images, using the hash-index of the chunks. Chunks without hash-
+ * index are scanned entirely. The key clause is rechecked by scan_quals.
+ */
+static bool
+gstore_fdw_index_lookup(ForeignScanState *node,
+						GpuStoreExecState *gstate,
+						GpuStoreBuffer *gs_buffer,
+						TupleTableSlot *slot,
+						size_t *p_row_index)
+{
+	int			nshards = gs_buffer->nshards;
+	int			nchunks = nshards + gs_buffer->ndeltas;
+
+	/* no device images */
+	if (!gs_buffer->h.buffer)
+		return false;
+
+	if (!gstate->index_ready)
+	{
+		ExprContext *econtext = node->ss.ps.ps_ExprContext;
+		Datum		datum;
+		bool		isnull;
+
+#if PG_VERSION_NUM < 100000
+		datum = ExecEvalExpr(gstate->index_key, econtext, &isnull, NULL);
+#else
+		datum = ExecEvalExpr(gstate->index_key, econtext, &isnull);
+#endif
+		/* NULL key never matches */
+		if (!gstore_fdw_hash_key(gstate->index_dtype, datum, isnull,
+								 &gstate->index_hash))
+			return false;
+		gstate->index_chunk = 0;
+		gstate->index_pos = 0;
+		gstate->index_base = gs_buffer->h_base_nitems;
+		gstate->index_ready = true;
+	}
+
+	while (gstate->index_chunk < nchunks)
+	{
+		int				chunk_id = gstate->index_chunk;
+		kern_data_store *kds = gs_buffer->h_chunks[chunk_id];
+		kern_colindex  *kci = KERN_DATA_STORE_COLINDEX(kds);
+		cl_uint			rowid;
+
+		if (!kci || kci->attnum != gstate->index_anum)
+		{
+			/* no hash-index on the chunk, so walk on all the rows */
+			if (gstate->index_pos >= kds->nitems)
+				goto next_chunk;
+			rowid = gstate->index_pos++;
+		}
+		else
+		{
+			cl_uint	   *hash_tags = KERN_COLINDEX_HASHTAGS(kci);
+			cl_uint		hindex = gstate->index_hash % kci->nslots;
+			cl_uint		pos = Max(gstate->index_pos,
+								  kci->hash_slot[hindex]);
+			cl_uint		end = kci->hash_slot[hindex + 1];
+
+			while (pos < end && hash_tags[pos] != gstate->index_hash)
+				pos++;
+			if (pos >= end)
+				goto next_chunk;
+			gstate->index_pos = pos + 1;
+			rowid = KERN_COLINDEX_HASHROWS(kci)[pos];
+		}
+
+		if (KDS_fetch_tuple_column(slot, kds, rowid))
+		{
+			/* see gstore_fdw_fetch_readonly_row */
+			if (chunk_id < nshards)
+				*p_row_index = (size_t)rowid * nshards + chunk_id;
+			else
+				*p_row_index = gstate->index_base + rowid;
+			return true;
+		}
+		continue;
+
+	next_chunk:
+		if (chunk_id >= nshards)
+			gstate->index_base += kds->nitems;
+		gstate->index_chunk++;
+		gstate->index_pos = 0;
+	}
+	return false;
+}
+
 /*
  * gstoreIterateForeignScan
  */
@@ -792,22 +1491,43 @@ gstoreIterateForeignScan(ForeignScanState *node)
 	ForeignScan	   *fscan = (ForeignScan *)node->ss.ps.plan;
 	GpuStoreBuffer *gs_buffer;
 	size_t			row_index;
+	ssize_t			cs_index;
 
 	ExecClearTuple(slot);
 	if (!gstate->gs_buffer)
 		gstate->gs_buffer = gstore_fdw_create_buffer(frel, snapshot);
 	gs_buffer = gstate->gs_buffer;
+
+	/*
+	 * lookup by hash-index on the device images first, then rows on the
+	 * read-write buffer follow, if any.
+	 */
+	if (gstate->index_key && !gstate->index_done)
+	{
+		if (gs_buffer->read_only || gs_buffer->append_only)
+		{
+			gstore_fdw_load_readonly_buffer(frel, gs_buffer, snapshot);
+			if (gstore_fdw_index_lookup(node, gstate, gs_buffer,
+										slot, &row_index))
+			{
+				cs_index = -1;
+				goto found;
+			}
+			gstate->gs_index = gs_buffer->h_nitems;
+		}
+		gstate->index_done = true;
+	}
 lnext:
 	row_index = gstate->gs_index++;
-	if (gs_buffer->h.buffer)
+	if (gs_buffer->read_only ||
+		(gs_buffer->append_only && row_index < gs_buffer->h_nitems))
 	{
 		/* read from read-only buffer */
+		gstore_fdw_load_readonly_buffer(frel, gs_buffer, snapshot);
 		switch (gs_buffer->format)
 		{
 			case GSTORE_FDW_FORMAT__PGSTROM:
-				if (!KDS_fetch_tuple_column(slot,
-											gs_buffer->h.kds,
-											row_index))
+				if (!gstore_fdw_fetch_readonly_row(gs_buffer, slot, row_index))
 					ExecClearTuple(slot);
 				break;
 
@@ -816,62 +1536,25 @@ lnext:
 					 gs_buffer->format);
 				break;
 		}
-	}
-	else if (row_index < gs_buffer->cc_buf.nitems)
-	{
-		ccacheBuffer   *cc_buf = &gs_buffer->cc_buf;
-		cl_int			j;
-
-		if (!gstore_fdw_tuple_visibility(&gs_buffer->cs_mvcc[row_index],
-										 snapshot))
-			goto lnext;
-
-		/* OK, tuple is visible */
-		for (j=0; j < tupdesc->natts; j++)
-		{
-			Form_pg_attribute attr = tupdesc->attrs[j];
-			vl_dict_key	*vkey;
-			int			unitsz;
-			void	   *addr;
-
-			if (att_isnull(j, cc_buf->nullmap[j]))
-			{
-				slot->tts_isnull[j] = true;
-				continue;
-			}
-			slot->tts_isnull[j] = false;
-			if (attr->attlen < 0)
-			{
-				vkey = ((vl_dict_key **)cc_buf->values[j])[row_index];
-				slot->tts_values[j] = PointerGetDatum(vkey->vl_datum);
-			}
-			else
-			{
-				unitsz = att_align_nominal(attr->attlen,
-										   attr->attalign);
-				addr = (char *)cc_buf->values[j] + unitsz * row_index;
-				if (!attr->attbyval)
-					slot->tts_values[j] = PointerGetDatum(addr);
-				else if (attr->attlen == sizeof(cl_char))
-					slot->tts_values[j] = CharGetDatum(*((cl_char *)addr));
-				else if (attr->attlen == sizeof(cl_short))
-					slot->tts_values[j] = Int16GetDatum(*((cl_short *)addr));
-				else if (attr->attlen == sizeof(cl_int))
-					slot->tts_values[j] = Int32GetDatum(*((cl_int *)addr));
-				else if (attr->attlen == sizeof(cl_long))
-					slot->tts_values[j] = Int64GetDatum(*((cl_long *)addr));
-				else
-					elog(ERROR, "gstore_fdw: unexpected attlen: %d",
-						 attr->attlen);
-			}
-		}
-		ExecStoreVirtualTuple(slot);
+		cs_index = -1;
 	}
 	else
 	{
-		ExecClearTuple(slot);
+		/* read from read-write buffer */
+		cs_index = row_index;
+		if (gs_buffer->append_only)
+			cs_index -= gs_buffer->h_nitems;
+		if ((size_t)cs_index >= gs_buffer->cc_buf.nitems)
+			ExecClearTuple(slot);
+		else if (!gstore_fdw_tuple_visibility(&gs_buffer->cs_mvcc[cs_index],
+											  snapshot))
+			goto lnext;
+		else
+			gstore_fdw_fetch_buffer_row(tupdesc, &gs_buffer->cc_buf,
+										slot, cs_index);
 	}
 
+found:
 	/*
 	 * Add system column information if required
 	 */
@@ -883,7 +1566,7 @@ lnext:
 		tup->t_self.ip_blkid.bi_lo = (row_index >> 16) & 0x0000ffff;
 		tup->t_self.ip_posid       = (row_index & 0x0000ffff);
 		tup->t_tableOid = RelationGetRelid(frel);
-		if (gs_buffer->read_only)
+		if (cs_index < 0)
 		{
 			tup->t_data->t_choice.t_heap.t_xmin = FrozenTransactionId;
 			tup->t_data->t_choice.t_heap.t_xmax = InvalidTransactionId;
@@ -891,7 +1574,7 @@ lnext:
 		}
 		else
 		{
-			MVCCAttrs  *mvcc = &gs_buffer->cs_mvcc[row_index];
+			MVCCAttrs  *mvcc = &gs_buffer->cs_mvcc[cs_index];
 			tup->t_data->t_choice.t_heap.t_xmin = mvcc->xmin;
 			tup->t_data->t_choice.t_heap.t_xmax = mvcc->xmax;
 			tup->t_data->t_choice.t_heap.t_field3.t_cid = mvcc->cid;
@@ -909,6 +1592,8 @@ gstoreReScanForeignScan(ForeignScanState *node)
 	GpuStoreExecState *gstate = (GpuStoreExecState *) node->fdw_state;
 
 	gstate->gs_index = 0;
+	gstate->index_ready = false;
+	gstate->index_done = false;
 }
 
 /*
@@ -926,7 +1611,10 @@ gstoreEndForeignScan(ForeignScanState *node)
 		 * Once buffer gets dirty, read-only buffer shall not
 		 * contain valid image no longer.
 		 */
-		if (gs_buffer->is_dirty && gs_buffer->h.buffer)
+		if (gs_buffer &&
+			gs_buffer->is_dirty &&
+			!gs_buffer->append_only &&
+			gs_buffer->h.buffer)
 		{
 			pfree(gs_buffer->h.buffer);
 			gs_buffer->h.buffer = NULL;
@@ -934,6 +1622,47 @@ gstoreEndForeignScan(ForeignScanState *node)
 	}
 }
 
+/*
+ * gstoreExplainForeignScan
+ */
+static void
+gstoreExplainForeignScan(ForeignScanState *node, ExplainState *es)
+{
+	ForeignScan	   *fscan = (ForeignScan *) node->ss.ps.plan;
+	Relation		frel = node->ss.ss_currentRelation;
+	AttrNumber		anum;
+
+	if (fscan->fdw_private == NIL)
+		return;
+	anum = intVal(linitial(fscan->fdw_private));
+	ExplainPropertyText("Hash Index",
+						get_attname(RelationGetRelid(frel), anum),
+						es);
+}
+
+/*
+ * gstoreIsForeignScanParallelSafe
+ *
+ * Parallel workers can see only the committed image on the device memory,
+ * so it is not parallel safe once local buffer has uncommitted updates.
+ */
+static bool
+gstoreIsForeignScanParallelSafe(PlannerInfo *root,
+								RelOptInfo *rel,
+								RangeTblEntry *rte)
+{
+	GpuStoreBuffer *gs_buffer;
+	bool		found;
+
+	if (!gstore_buffer_htab)
+		return true;
+	gs_buffer = hash_search(gstore_buffer_htab,
+							&rte->relid,
+							HASH_FIND,
+							&found);
+	return (!gs_buffer || !gs_buffer->is_dirty);
+}
+
 /*
  * gstorePlanForeignModify
  */
@@ -1015,7 +1744,7 @@ gstoreExecForeignInsert(EState *estate,
 		gstate->gs_buffer = gstore_fdw_create_buffer(frel, snapshot);
 	gs_buffer = gstate->gs_buffer;
 	if (gs_buffer->read_only)
-		gstore_fdw_make_buffer_writable(frel, gs_buffer);
+		gstore_fdw_make_buffer_writable(frel, gs_buffer, snapshot, true);
 	cc_buf = &gs_buffer->cc_buf;
 
 	/* expand buffer on demand */
@@ -1071,8 +1800,6 @@ gstoreExecForeignUpdate(EState *estate,
 	if (!gstate->gs_buffer)
 		gstate->gs_buffer = gstore_fdw_create_buffer(frel, snapshot);
 	gs_buffer = gstate->gs_buffer;
-	if (gs_buffer->read_only)
-		gstore_fdw_make_buffer_writable(frel, gs_buffer);
 	cc_buf = &gs_buffer->cc_buf;
 
 	/* extract ctid from a resjunk column */
@@ -1085,9 +1812,8 @@ gstoreExecForeignUpdate(EState *estate,
 	index = ((cl_ulong)t_self->ip_blkid.bi_hi << 32 |
 			 (cl_ulong)t_self->ip_blkid.bi_lo << 16 |
 			 (cl_ulong)t_self->ip_posid);
-	if (index >= gs_buffer->cc_buf.nitems)
-		elog(ERROR, "gstore_fdw: UPDATE row out of range (%lu of %zu)",
-			 index, gs_buffer->cc_buf.nitems);
+	index = gstore_fdw_writable_index(frel, gs_buffer, snapshot,
+									  index, "UPDATE");
 	mvcc = &gs_buffer->cs_mvcc[index];
 	mvcc->xmax = GetCurrentTransactionId();
 	mvcc->cid  = snapshot->curcid;
@@ -1097,7 +1823,7 @@ gstoreExecForeignUpdate(EState *estate,
 	{
 		ccache_expand_buffer(tupdesc, cc_buf, gs_buffer->memcxt);
 		gs_buffer->cs_mvcc = repalloc_huge(gs_buffer->cs_mvcc,
-										   sizeof(HeapTupleFields) *
+										   sizeof(MVCCAttrs) *
 										   cc_buf->nrooms);
 	}
 	slot_getallattrs(slot);
@@ -1145,8 +1871,6 @@ gstoreExecForeignDelete(EState *estate,
 	if (!gstate->gs_buffer)
 		gstate->gs_buffer = gstore_fdw_create_buffer(frel, snapshot);
 	gs_buffer = gstate->gs_buffer;
-	if (gs_buffer->read_only)
-		gstore_fdw_make_buffer_writable(frel, gs_buffer);
 
 	/* extract ctid from a resjunk column */
 	datum = ExecGetJunkAttribute(planSlot,
@@ -1158,9 +1882,8 @@ gstoreExecForeignDelete(EState *estate,
 	index = ((cl_ulong)t_self->ip_blkid.bi_hi << 32 |
 			 (cl_ulong)t_self->ip_blkid.bi_lo << 16 |
 			 (cl_ulong)t_self->ip_posid);
-	if (index >= gs_buffer->cc_buf.nitems)
-		elog(ERROR, "gstore_fdw: DELETE row out of range (%lu of %zu)",
-			 index, gs_buffer->cc_buf.nitems);
+	index = gstore_fdw_writable_index(frel, gs_buffer, snapshot,
+									  index, "DELETE");
 	/* negative command id means the tuple was removed */
 	mvcc = &gs_buffer->cs_mvcc[index];
 	mvcc->xmax = GetCurrentTransactionId();
@@ -1185,7 +1908,8 @@ gstoreEndForeignModify(EState *estate,
 	/* release read-only buffer, if it is not up-to-date */
 	if (gs_buffer &&
 		gs_buffer->h.buffer &&
-		gs_buffer->is_dirty)
+		gs_buffer->is_dirty &&
+		!gs_buffer->append_only)
 	{
 		pfree(gs_buffer->h.buffer);
 		gs_buffer->h.buffer = NULL;
@@ -1193,72 +1917,559 @@ gstoreEndForeignModify(EState *estate,
 }
 
 /*
- * gstore_fdw_alloc_pgstrom_buffer
+ * gstore_fdw_hash_key - hash value of the key column, compatible to the
+ * hash value of GpuHashJoin for a single key
  */
-static void
-gstore_fdw_alloc_pgstrom_buffer(Relation frel,
-								GpuStoreBuffer *gs_buffer,
-								bits8 *rowmap, size_t nrooms)
+static bool
+gstore_fdw_hash_key(devtype_info *dtype, Datum datum, bool isnull,
+					cl_uint *p_hash)
+{
+	struct varlena *vl_datum = NULL;
+	pg_crc32	hash;
+
+	if (isnull)
+		return false;
+	/* compressed varlena shall be hashed by the raw image */
+	if (dtype->type_length < 0)
+	{
+		vl_datum = pg_detoast_datum_packed((struct varlena *)
+										   DatumGetPointer(datum));
+		if (vl_datum == (struct varlena *)DatumGetPointer(datum))
+			vl_datum = NULL;
+		else
+			datum = PointerGetDatum(vl_datum);
+	}
+	INIT_LEGACY_CRC32(hash);
+	hash = dtype->hash_func(dtype, hash, datum, false);
+	FIN_LEGACY_CRC32(hash);
+	if (vl_datum)
+		pfree(vl_datum);
+	*p_hash = hash;
+
+	return true;
+}
+
+/*
+ * gstore_fdw_build_colindex
+ *
+ * It builds the hash-index on the key column of the visible rows, in order
+ * of the rows on the device image.
+ */
+static kern_colindex *
+gstore_fdw_build_colindex(Form_pg_attribute attr, devtype_info *dtype,
+						  ccacheBuffer *cc_buf, bits8 *rowmap, size_t nrooms)
+{
+	kern_colindex *kci;
+	cl_uint	   *hashes;
+	bits8	   *keymap;
+	cl_uint	   *hash_slot;
+	cl_uint	   *hash_tags;
+	cl_uint	   *hash_rows;
+	cl_uint		nslots;
+	cl_uint		nitems = 0;
+	cl_uint		s, curr, next;
+	size_t		i, k;
+	int			j = attr->attnum - 1;
+
+	hashes = palloc_huge(sizeof(cl_uint) * Max(nrooms, 1));
+	keymap = palloc0(BITMAPLEN(nrooms));
+	for (i=0, k=0; i < cc_buf->nitems; i++)
+	{
+		Datum		datum = 0;
+		bool		isnull;
+
+		if (rowmap && att_isnull(i, rowmap))
+			continue;
+		if (attr->attlen < 0)
+		{
+			vl_dict_key *entry = ((vl_dict_key **)cc_buf->values[j])[i];
+
+			isnull = (entry == NULL);
+			if (!isnull)
+				datum = PointerGetDatum(entry->vl_datum);
+		}
+		else
+		{
+			char   *addr = ((char *)cc_buf->values[j] +
+							att_align_nominal(attr->attlen,
+											  attr->attalign) * i);
+			isnull = att_isnull(i, cc_buf->nullmap[j]);
+			if (!isnull)
+				datum = fetch_att(addr, attr->attbyval, attr->attlen);
+		}
+		if (gstore_fdw_hash_key(dtype, datum, isnull, &hashes[k]))
+		{
+			keymap[k / BITS_PER_BYTE] |= (1 << (k % BITS_PER_BYTE));
+			nitems++;
+		}
+		k++;
+	}
+	Assert(k == nrooms);
+
+	nslots = __KDS_NSLOTS(nitems);
+	kci = palloc_huge(offsetof(kern_colindex,
+							   hash_slot[nslots + 1 + 2 * nitems]));
+	kci->attnum = attr->attnum;
+	kci->nslots = nslots;
+	hash_slot = kci->hash_slot;
+	hash_tags = hash_slot + nslots + 1;
+	hash_rows = hash_tags + nitems;
+	/*
+	 * count entries per slot on hash_slot[s+1], then turn them into the
+	 * start position of the slot[s] by prefix sum. hash_slot[s+1] is
+	 * advanced to the end of slot[s] during the placement below.
+	 */
+	memset(hash_slot, 0, sizeof(cl_uint) * (nslots + 1));
+	for (k=0; k < nrooms; k++)
+	{
+		if (att_isnull(k, keymap))
+			continue;
+		s = hashes[k] % nslots;
+		if (s + 1 < nslots)
+			hash_slot[s+2]++;
+	}
+	for (s=2, curr=0; s <= nslots; s++)
+	{
+		next = curr + hash_slot[s];
+		hash_slot[s] = next;
+		curr = next;
+	}
+	for (k=0; k < nrooms; k++)
+	{
+		cl_uint		pos;
+
+		if (att_isnull(k, keymap))
+			continue;
+		pos = hash_slot[hashes[k] % nslots + 1]++;
+		hash_tags[pos] = hashes[k];
+		hash_rows[pos] = k;
+	}
+	Assert(hash_slot[nslots] == nitems);
+	pfree(keymap);
+	pfree(hashes);
+
+	return kci;
+}
+
+/*
+ * gstore_fdw_setup_pgstrom_load
+ *
+ * It determines the layout of the KDS_FORMAT_COLUMN image to be loaded onto
+ * the GPU device memory, without construction of the whole image on the
+ * host memory. gstore_fdw_stream_pgstrom_chunk() writes out the image
+ * according to the header portion built here.
+ */
+typedef struct
+{
+	ccacheBuffer   *cc_buf;
+	bits8		   *rowmap;		/* visible rows, or NULL if all visible */
+	size_t			nrooms;		/* number of visible rows */
+	kern_data_store *kds_head;	/* header portion of the image */
+	kern_colindex  *kci;		/* hash-index at the tail, if any */
+} GpuStoreLoadState;
+
+static GpuStoreLoadState *
+gstore_fdw_setup_pgstrom_load(Relation frel,
+							  GpuStoreBuffer *gs_buffer,
+							  bits8 *rowmap, size_t nrooms)
 {
 	TupleDesc	tupdesc = RelationGetDescr(frel);
 	ccacheBuffer *cc_buf = &gs_buffer->cc_buf;
+	GpuStoreLoadState *gs_load;
 	kern_data_store *kds;
-	size_t		length;
+	devtype_info *dtype;
+	AttrNumber	anum;
+	size_t		offset;
+	size_t		i;
 	int			j, ncols;
 
 	Assert(tupdesc->natts == gs_buffer->cc_buf.nattrs);
-	/* 1. size estimation */
 	ncols = tupdesc->natts + NumOfSystemAttrs;
-	length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
-	for (j=0; j < tupdesc->natts; j++)
+	offset = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
+	kds = palloc0(offset);
+	init_kernel_data_store(kds,
+						   tupdesc,
+						   SIZE_MAX,	/* to be set later */
+						   KDS_FORMAT_COLUMN,
+						   nrooms);
+	for (j=0; j < cc_buf->nattrs; j++)
 	{
 		Form_pg_attribute attr = tupdesc->attrs[j];
+		kern_colmeta   *cmeta = &kds->colmeta[j];
 
-		if (attr->attisdropped)
+		/* skip dropped columns */
+		if (attr->attisdropped || !cc_buf->values[j])
 			continue;
-		if (attr->attlen < 0)
+
+		Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
+		cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
+		if (cmeta->attlen < 0)
 		{
-			length += (MAXALIGN(sizeof(cl_uint) * nrooms) +
-					   MAXALIGN(cc_buf->extra_sz[j]));
+			vl_dict_key **vl_entries = (vl_dict_key **)cc_buf->values[j];
+			size_t		base_sz = MAXALIGN(sizeof(cl_uint) * nrooms);
+			size_t		extra_sz = 0;
+
+			/* reset offset assigned by the previous shard, if any */
+			for (i=0; i < cc_buf->nitems; i++)
+			{
+				if (vl_entries[i])
+					vl_entries[i]->offset = 0;
+			}
+			/* assign offset of the unique varlena datum */
+			for (i=0; i < cc_buf->nitems; i++)
+			{
+				vl_dict_key *entry = vl_entries[i];
+
+				if ((rowmap && att_isnull(i, rowmap)) ||
+					!entry || entry->offset != 0)
+					continue;
+				entry->offset = (base_sz + extra_sz) / MAXIMUM_ALIGNOF;
+				extra_sz += MAXALIGN(VARSIZE_ANY(entry->vl_datum));
+			}
+			cmeta->extra_sz = extra_sz / MAXIMUM_ALIGNOF;
+			offset += base_sz + extra_sz;
 		}
 		else
 		{
-			int		unitsz = att_align_nominal(attr->attlen,
-											   attr->attalign);
-			length += MAXALIGN(unitsz * nrooms);
-			if (cc_buf->hasnull[j])
-				length += MAXALIGN(BITMAPLEN(nrooms));
+			int		unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+			bool	meet_null = false;
+
+			offset += MAXALIGN(unitsz * nrooms);
+			if (!cc_buf->hasnull[j])
+				meet_null = false;
+			else if (!rowmap)
+				meet_null = true;
+			else
+			{
+				for (i=0; i < cc_buf->nitems; i++)
+				{
+					if (!att_isnull(i, rowmap) &&
+						att_isnull(i, cc_buf->nullmap[j]))
+					{
+						meet_null = true;
+						break;
+					}
+				}
+			}
+			if (meet_null)
+			{
+				cmeta->extra_sz = MAXALIGN(BITMAPLEN(nrooms)) / MAXIMUM_ALIGNOF;
+				offset += MAXALIGN(BITMAPLEN(nrooms));
+			}
 		}
 	}
-	/* 2. allocation */
-	kds = MemoryContextAllocHuge(gs_buffer->memcxt, length);
+	kds->nitems = nrooms;
 
-	/* 3. write out kern_data_store */
-	ccache_copy_buffer_to_kds(kds, tupdesc, cc_buf, rowmap, nrooms);
-	Assert(kds->length <= length);
+	gs_load = palloc0(sizeof(GpuStoreLoadState));
+	gs_load->cc_buf = cc_buf;
+	gs_load->rowmap = rowmap;
+	gs_load->nrooms = nrooms;
+	gs_load->kds_head = kds;
+
+	/* hash-index on the key column follows the column data, if any */
+	anum = gstore_fdw_index_column(frel, &dtype);
+	if (anum != InvalidAttrNumber)
+	{
+		kern_colindex *kci;
+
+		kci = gstore_fdw_build_colindex(tupdesc->attrs[anum - 1], dtype,
+										cc_buf, rowmap, nrooms);
+		Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
+		kds->index_offset = offset / MAXIMUM_ALIGNOF;
+		offset += KDS_CALCULATE_COLINDEX_LENGTH(kci->nslots,
+												KERN_COLINDEX_NITEMS(kci));
+		gs_load->kci = kci;
+	}
+	kds->length = offset;
 
 	gs_buffer->rawsize = kds->length;
-	gs_buffer->h.kds = kds;
+
+	return gs_load;
 }
 
 /*
- * gstoreXactCallbackOnPreCommit
+ * gstore_fdw_stream_pgstrom_chunk
+ *
+ * It writes out the KDS_FORMAT_COLUMN image to the stream, column by
+ * column. Host-to-device DMA runs in pipeline, so we don't need to build
+ * the whole image on the host memory.
  */
 static void
-gstoreXactCallbackOnPreCommit(void)
+gstore_fdw_stream_pgstrom_chunk(GpuIpcMemStream *gstream, void *cb_private)
 {
-	HASH_SEQ_STATUS	status;
-	GpuStoreBuffer *gs_buffer;
+	GpuStoreLoadState *gs_load = (GpuStoreLoadState *) cb_private;
+	kern_data_store *kds = gs_load->kds_head;
+	ccacheBuffer   *cc_buf = gs_load->cc_buf;
+	bits8		   *rowmap = gs_load->rowmap;
+	size_t			nrooms = gs_load->nrooms;
+	size_t			nbytes;
+	size_t			i, k;
+	int				j;
+
+	/* header portion */
+	gpuIpcMemStreamWrite(gstream, kds,
+						 STROMALIGN(offsetof(kern_data_store,
+											 colmeta[kds->ncols])));
+	for (j=0; j < cc_buf->nattrs; j++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[j];
 
-	if (!gstore_buffer_htab)
-		return;
+		if (cmeta->va_offset == 0)
+			continue;	/* dropped columns */
+		if (cmeta->attlen < 0)
+		{
+			vl_dict_key **vl_entries = (vl_dict_key **)cc_buf->values[j];
+			vl_dict_key *entry;
+			size_t		extra_pos;
 
-	hash_seq_init(&status, gstore_buffer_htab);
-	while ((gs_buffer = hash_seq_search(&status)) != NULL)
-	{
-		Relation	frel;
-		bits8	   *rowmap;
-		size_t		nrooms = gs_buffer->cc_buf.nitems;
+			/* array of offsets */
+			for (i=0; i < cc_buf->nitems; i++)
+			{
+				cl_uint		vl_offset;
+
+				if (rowmap && att_isnull(i, rowmap))
+					continue;
+				entry = vl_entries[i];
+				vl_offset = (!entry ? 0 : entry->offset);
+				gpuIpcMemStreamWrite(gstream, &vl_offset, sizeof(cl_uint));
+			}
+			nbytes = sizeof(cl_uint) * nrooms;
+			gpuIpcMemStreamWrite(gstream, NULL, MAXALIGN(nbytes) - nbytes);
+
+			/* unique varlena datum in order of the first appearance */
+			extra_pos = MAXALIGN(nbytes) / MAXIMUM_ALIGNOF;
+			for (i=0; i < cc_buf->nitems; i++)
+			{
+				if (rowmap && att_isnull(i, rowmap))
+					continue;
+				entry = vl_entries[i];
+				if (!entry || entry->offset != extra_pos)
+					continue;
+				nbytes = VARSIZE_ANY(entry->vl_datum);
+				gpuIpcMemStreamWrite(gstream, entry->vl_datum, nbytes);
+				gpuIpcMemStreamWrite(gstream, NULL, MAXALIGN(nbytes) - nbytes);
+				extra_pos += MAXALIGN(nbytes) / MAXIMUM_ALIGNOF;
+			}
+			Assert(extra_pos == (MAXALIGN(sizeof(cl_uint) * nrooms)
+								 / MAXIMUM_ALIGNOF + cmeta->extra_sz));
+		}
+		else
+		{
+			char	   *values = cc_buf->values[j];
+			bits8	   *nullmap = cc_buf->nullmap[j];
+			int			unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+
+			/* array of values */
+			if (!rowmap)
+				gpuIpcMemStreamWrite(gstream, values, unitsz * nrooms);
+			else
+			{
+				for (i=0; i < cc_buf->nitems; i++)
+				{
+					if (!att_isnull(i, rowmap))
+						gpuIpcMemStreamWrite(gstream, values + unitsz * i,
+											 unitsz);
+				}
+			}
+			nbytes = unitsz * nrooms;
+			gpuIpcMemStreamWrite(gstream, NULL, MAXALIGN(nbytes) - nbytes);
+
+			/* null bitmap, if any */
+			if (cmeta->extra_sz == 0)
+				continue;
+			nbytes = BITMAPLEN(nrooms);
+			if (!rowmap)
+				gpuIpcMemStreamWrite(gstream, nullmap, nbytes);
+			else
+			{
+				bits8	curr = 0;
+
+				for (i=0, k=0; i < cc_buf->nitems; i++)
+				{
+					if (att_isnull(i, rowmap))
+						continue;
+					if (!att_isnull(i, nullmap))
+						curr |= (1 << (k & (BITS_PER_BYTE - 1)));
+					if ((++k & (BITS_PER_BYTE - 1)) == 0)
+					{
+						gpuIpcMemStreamWrite(gstream, &curr, sizeof(bits8));
+						curr = 0;
+					}
+				}
+				if ((k & (BITS_PER_BYTE - 1)) != 0)
+					gpuIpcMemStreamWrite(gstream, &curr, sizeof(bits8));
+				Assert(k == nrooms);
+			}
+			gpuIpcMemStreamWrite(gstream, NULL, MAXALIGN(nbytes) - nbytes);
+		}
+	}
+
+	/* hash-index, if any */
+	if (gs_load->kci)
+	{
+		kern_colindex *kci = gs_load->kci;
+		cl_uint		nitems = KERN_COLINDEX_NITEMS(kci);
+
+		nbytes = offsetof(kern_colindex,
+						  hash_slot[kci->nslots + 1 + 2 * nitems]);
+		gpuIpcMemStreamWrite(gstream, kci, nbytes);
+		gpuIpcMemStreamWrite(gstream, NULL,
+							 KDS_CALCULATE_COLINDEX_LENGTH(kci->nslots,
+														   nitems) - nbytes);
+	}
+}
+
+/*
+ * gstore_fdw_load_pgstrom_shards
+ *
+ * It distributes the visible rows to the shards in round-robin, then
+ * loads each shard onto the GPU device where it is pinned.
+ */
+static void
+gstore_fdw_load_pgstrom_shards(Relation frel,
+							   GpuStoreBuffer *gs_buffer,
+							   bits8 *rowmap, size_t nrooms)
+{
+	GpuStoreChunk  *shards[GSTORE_FDW_MAX_SHARDS];
+	bits8		   *shard_rowmap[GSTORE_FDW_MAX_SHARDS];
+	size_t			shard_nrooms[GSTORE_FDW_MAX_SHARDS];
+	int				nshards = gs_buffer->nshards;
+	cl_uint			revision;
+	size_t			i, k;
+	int				j;
+
+	Assert(nshards > 0 && nshards <= GSTORE_FDW_MAX_SHARDS);
+	if (nshards == 1)
+	{
+		shard_rowmap[0] = rowmap;
+		shard_nrooms[0] = nrooms;
+	}
+	else
+	{
+		for (j=0; j < nshards; j++)
+		{
+			shard_rowmap[j] = palloc0(BITMAPLEN(gs_buffer->cc_buf.nitems));
+			shard_nrooms[j] = 0;
+		}
+		for (i=0, k=0; i < gs_buffer->cc_buf.nitems; i++)
+		{
+			if (rowmap && att_isnull(i, rowmap))
+				continue;
+			j = k++ % nshards;
+			shard_rowmap[j][i / BITS_PER_BYTE] |= (1 << (i % BITS_PER_BYTE));
+			shard_nrooms[j]++;
+		}
+		Assert(k == nrooms);
+	}
+
+	revision = pg_atomic_add_fetch_u32(&gstore_head->revision_seed, 1);
+	memset(shards, 0, sizeof(shards));
+	PG_TRY();
+	{
+		for (j=0; j < nshards; j++)
+		{
+			GpuStoreLoadState *gs_load;
+
+			gs_load = gstore_fdw_setup_pgstrom_load(frel, gs_buffer,
+													shard_rowmap[j],
+													shard_nrooms[j]);
+			shards[j] = gstore_fdw_insert_chunk(gs_buffer,
+												revision, j, 0,
+												shard_nrooms[j],
+												gs_load->kds_head->length,
+												gstore_fdw_stream_pgstrom_chunk,
+												gs_load);
+			pfree(gs_load->kds_head);
+			if (gs_load->kci)
+				pfree(gs_load->kci);
+			pfree(gs_load);
+		}
+	}
+	PG_CATCH();
+	{
+		for (j=0; j < nshards; j++)
+		{
+			if (shards[j])
+				gstore_fdw_discard_chunk(shards[j]);
+		}
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	gstore_fdw_publish_chunks(gs_buffer, shards, nshards);
+
+	if (nshards > 1)
+	{
+		for (j=0; j < nshards; j++)
+			pfree(shard_rowmap[j]);
+	}
+}
+
+/*
+ * gstore_fdw_load_pgstrom_delta
+ *
+ * It loads the visible rows on the append-only buffer as a delta chunk,
+ * on the device of the shards in round-robin. Existing chunks are not
+ * touched, so cost of the commit is proportional to the rows appended.
+ */
+static void
+gstore_fdw_load_pgstrom_delta(Relation frel,
+							  GpuStoreBuffer *gs_buffer,
+							  bits8 *rowmap, size_t nrooms)
+{
+	GpuStoreLoadState *gs_load;
+	GpuStoreChunk  *gs_chunk;
+	cl_uint			revision;
+	cl_int			delta_id = gs_buffer->ndeltas + 1;
+
+	Assert(gs_buffer->append_only &&
+		   gs_buffer->nshards > 0 &&
+		   delta_id <= GSTORE_FDW_MAX_DELTAS);
+	revision = pg_atomic_add_fetch_u32(&gstore_head->revision_seed, 1);
+	gs_load = gstore_fdw_setup_pgstrom_load(frel, gs_buffer, rowmap, nrooms);
+	gs_chunk = gstore_fdw_insert_chunk(gs_buffer,
+									   revision,
+									   gs_buffer->ndeltas % gs_buffer->nshards,
+									   delta_id,
+									   nrooms,
+									   gs_load->kds_head->length,
+									   gstore_fdw_stream_pgstrom_chunk,
+									   gs_load);
+	pfree(gs_load->kds_head);
+	if (gs_load->kci)
+		pfree(gs_load->kci);
+	pfree(gs_load);
+	PG_TRY();
+	{
+		gstore_fdw_publish_chunks(gs_buffer, &gs_chunk, 1);
+	}
+	PG_CATCH();
+	{
+		gstore_fdw_discard_chunk(gs_chunk);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+}
+
+/*
+ * gstoreXactCallbackOnPreCommit
+ */
+static void
+gstoreXactCallbackOnPreCommit(void)
+{
+	HASH_SEQ_STATUS	status;
+	GpuStoreBuffer *gs_buffer;
+
+	if (!gstore_buffer_htab)
+		return;
+
+	hash_seq_init(&status, gstore_buffer_htab);
+	while ((gs_buffer = hash_seq_search(&status)) != NULL)
+	{
+		Relation	frel;
+		bits8	   *rowmap;
+		size_t		nrooms = gs_buffer->cc_buf.nitems;
+		Oid			gstore_oid;
+		bool		found;
 
 		/* any writes happen? */
 		if (!gs_buffer->is_dirty)
@@ -1272,6 +2483,29 @@ gstoreXactCallbackOnPreCommit(void)
 		/* check visibility for each rows (if any) */
 		rowmap = gstore_fdw_visibility_bitmap(gs_buffer, &nrooms);
 
+		/*
+		 * rows appended to the device image are loaded as a delta chunk,
+		 * unless all of them are already removed.
+		 */
+		if (gs_buffer->append_only)
+		{
+			if (nrooms > 0)
+			{
+				if (nrooms == gs_buffer->cc_buf.nitems)
+				{
+					pfree(rowmap);
+					rowmap = NULL;
+				}
+				frel = heap_open(gs_buffer->table_oid, NoLock);
+				gstore_fdw_load_pgstrom_delta(frel, gs_buffer,
+											  rowmap, nrooms);
+				heap_close(frel, NoLock);
+			}
+			if (rowmap)
+				pfree(rowmap);
+			goto release;
+		}
+
 		/*
 		 * once all the rows are removed from the gstore_fdw, we don't
 		 * add new version of GpuStoreChunk/GpuStoreBuffer.
@@ -1280,12 +2514,13 @@ gstoreXactCallbackOnPreCommit(void)
 		 */
 		if (nrooms == 0)
 		{
-			Oid			gstore_oid = gs_buffer->table_oid;
-			pg_crc32	hash = gstore_fdw_chunk_hashvalue(gstore_oid);
-			int			index = hash % GSTORE_CHUNK_HASH_NSLOTS;
+			pg_crc32	hash;
+			int			index;
 			dlist_iter	iter;
-			bool		found;
 
+			gstore_oid = gs_buffer->table_oid;
+			hash = gstore_fdw_chunk_hashvalue(gstore_oid);
+			index = hash % GSTORE_CHUNK_HASH_NSLOTS;
 			SpinLockAcquire(&gstore_head->lock);
 			dlist_foreach(iter, &gstore_head->active_chunks[index])
 			{
@@ -1312,25 +2547,38 @@ gstoreXactCallbackOnPreCommit(void)
 			continue;
 		}
 
-		/* construction of new version of GPU device memory image */
+		/* no need to check visibility, if all the rows are visible */
+		if (nrooms == gs_buffer->cc_buf.nitems)
+		{
+			pfree(rowmap);
+			rowmap = NULL;
+		}
+
+		/*
+		 * construction of new version of GPU device memory image, and
+		 * host-to-device DMA in pipeline.
+		 */
 		frel = heap_open(gs_buffer->table_oid, NoLock);
 		if (gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM)
-			gstore_fdw_alloc_pgstrom_buffer(frel, gs_buffer, rowmap, nrooms);
+			gstore_fdw_load_pgstrom_shards(frel, gs_buffer, rowmap, nrooms);
 		else
 			elog(ERROR, "gstore_fdw: unknown format %d", gs_buffer->format);
 		heap_close(frel, NoLock);
-		pfree(rowmap);
-
-		/* host-to-device DMA */
-		gstore_fdw_insert_chunk(gs_buffer, nrooms);
+		if (rowmap)
+			pfree(rowmap);
 
-		/* release read-write buffer */
-		pfree(gs_buffer->cs_mvcc);
-		gs_buffer->cs_mvcc = NULL;
-		ccache_release_buffer(&gs_buffer->cc_buf);
-
-		gs_buffer->read_only = true;
-		gs_buffer->is_dirty = false;
+		/*
+		 * release the local buffer; we have no read-only image on the host
+		 * side, so it shall be reloaded from the device memory on demand.
+		 */
+	release:
+		gstore_oid = gs_buffer->table_oid;
+		MemoryContextDelete(gs_buffer->memcxt);
+		hash_search(gstore_buffer_htab,
+					&gstore_oid,
+					HASH_REMOVE,
+					&found);
+		Assert(found);
 	}
 }
 
@@ -1491,7 +2739,7 @@ gstoreSubXactCallback(SubXactEvent event, SubTransactionId mySubid,
 /*
  * relation_is_gstore_fdw
  */
-static bool
+bool
 relation_is_gstore_fdw(Oid table_oid)
 {
 	HeapTuple	tup;
@@ -1557,10 +2805,14 @@ relation_is_gstore_fdw(Oid table_oid)
 static void
 __gstore_fdw_table_options(List *options,
 						  int *p_pinning,
+						  int *p_nshards,
+						  cl_int *p_shards,
 						  int *p_format)
 {
 	ListCell   *lc;
 	int			pinning = -1;
+	int			nshards = 0;
+	cl_int		shards[GSTORE_FDW_MAX_SHARDS];
 	int			format = -1;
 
 	foreach (lc, options)
@@ -1569,15 +2821,50 @@ __gstore_fdw_table_options(List *options,
 
 		if (strcmp(defel->defname, "pinning") == 0)
 		{
+			char   *temp;
+			char   *tok;
+			char   *pos;
+			int		i;
+
 			if (pinning >= 0)
 				ereport(ERROR,
 						(errcode(ERRCODE_SYNTAX_ERROR),
 						 errmsg("\"pinning\" option appears twice")));
-			pinning = atoi(defGetString(defel));
-			if (pinning < 0 || pinning >= numDevAttrs)
+			/*
+			 * comma separated list of the GPU devices, if gstore_fdw is
+			 * sharded to multiple GPUs.
+			 */
+			temp = pstrdup(defGetString(defel));
+			for (tok = strtok_r(temp, ",", &pos);
+				 tok != NULL;
+				 tok = strtok_r(NULL, ",", &pos))
+			{
+				int		dindex = atoi(tok);
+
+				if (dindex < 0 || dindex >= numDevAttrs)
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("\"pinning\" on unavailable GPU device")));
+				for (i=0; i < nshards; i++)
+				{
+					if (shards[i] == dindex)
+						ereport(ERROR,
+								(errcode(ERRCODE_SYNTAX_ERROR),
+								 errmsg("\"pinning\" has GPU device %d twice",
+										dindex)));
+				}
+				if (nshards >= GSTORE_FDW_MAX_SHARDS)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+							 errmsg("\"pinning\" has too many GPU devices")));
+				shards[nshards++] = dindex;
+			}
+			pfree(temp);
+			if (nshards == 0)
 				ereport(ERROR,
-						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-						 errmsg("\"pinning\" on unavailable GPU device")));
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"pinning\" has no GPU devices")));
+			pinning = shards[0];
 		}
 		else if (strcmp(defel->defname, "format") == 0)
 		{
@@ -1618,12 +2905,16 @@ __gstore_fdw_table_options(List *options,
 	/* result the results */
 	if (p_pinning)
 		*p_pinning = pinning;
+	if (p_nshards)
+		*p_nshards = nshards;
+	if (p_shards)
+		memcpy(p_shards, shards, sizeof(cl_int) * nshards);
 	if (p_format)
 		*p_format = format;
 }
 
-static void
-gstore_fdw_table_options(Oid gstore_oid, int *p_pinning, int *p_format)
+static List *
+gstore_fdw_table_options_list(Oid gstore_oid)
 {
 	HeapTuple	tup;
 	Datum		datum;
@@ -1638,19 +2929,46 @@ gstore_fdw_table_options(Oid gstore_oid, int *p_pinning, int *p_format)
 							&isnull);
 	if (!isnull)
 		options = untransformRelOptions(datum);
-	__gstore_fdw_table_options(options, p_pinning, p_format);
 	ReleaseSysCache(tup);
+
+	return options;
+}
+
+static void
+gstore_fdw_table_options(Oid gstore_oid, int *p_pinning, int *p_format)
+{
+	List	   *options = gstore_fdw_table_options_list(gstore_oid);
+
+	__gstore_fdw_table_options(options, p_pinning, NULL, NULL, p_format);
+}
+
+/*
+ * gstore_fdw_table_shards
+ *
+ * It returns number of the shards and GPU device index of each shard.
+ */
+static int
+gstore_fdw_table_shards(Oid gstore_oid, cl_int *shards)
+{
+	List	   *options = gstore_fdw_table_options_list(gstore_oid);
+	int			nshards;
+
+	__gstore_fdw_table_options(options, NULL, &nshards, shards, NULL);
+
+	return nshards;
 }
 
 /*
  * gstore_fdw_column_options
  */
 static void
-__gstore_fdw_column_options(List *options, int *p_compression)
+__gstore_fdw_column_options(List *options, int *p_compression,
+							bool *p_hash_index)
 {
 	ListCell   *lc;
 	char	   *temp;
 	int			compression = -1;
+	int			hash_index = -1;
 
 	foreach (lc, options)
 	{
@@ -1672,6 +2990,22 @@ __gstore_fdw_column_options(List *options, int *p_compression)
 						(errcode(ERRCODE_SYNTAX_ERROR),
 						 errmsg("unknown compression logic: %s", temp)));
 		}
+		else if (strcmp(defel->defname, "index") == 0)
+		{
+			if (hash_index >= 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"index\" option appears twice")));
+			temp = defGetString(defel);
+			if (pg_strcasecmp(temp, "none") == 0)
+				hash_index = 0;
+			else if (pg_strcasecmp(temp, "hash") == 0)
+				hash_index = 1;
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("unknown index type: %s", temp)));
+		}
 		else
 		{
 			ereport(ERROR,
@@ -1683,19 +3017,67 @@ __gstore_fdw_column_options(List *options, int *p_compression)
 	/* set default, if no valid options were supplied */
 	if (compression < 0)
 		compression = GSTORE_COMPRESSION__NONE;
+	if (hash_index < 0)
+		hash_index = 0;
 
 	/* set results */
 	if (p_compression)
 		*p_compression = compression;
+	if (p_hash_index)
+		*p_hash_index = (hash_index > 0);
 }
 
 static void
 gstore_fdw_column_options(Oid gstore_oid, AttrNumber attnum,
-						  int *p_compression)
+						  int *p_compression, bool *p_hash_index)
 {
 	List	   *options = GetForeignColumnOptions(gstore_oid, attnum);
 
-	__gstore_fdw_column_options(options, p_compression);
+	__gstore_fdw_column_options(options, p_compression, p_hash_index);
+}
+
+/*
+ * gstore_fdw_index_column
+ *
+ * It returns attribute number of the column with hash-index, or
+ * InvalidAttrNumber if none. Only one column can have hash-index.
+ */
+static AttrNumber
+gstore_fdw_index_column(Relation frel, devtype_info **p_dtype)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	devtype_info *dtype = NULL;
+	AttrNumber	anum = InvalidAttrNumber;
+	int			j;
+
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		bool		hash_index;
+
+		if (attr->attisdropped)
+			continue;
+		gstore_fdw_column_options(RelationGetRelid(frel), attr->attnum,
+								  NULL, &hash_index);
+		if (!hash_index)
+			continue;
+		if (anum != InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("gstore_fdw: \"%s\" has hash-index on multiple columns",
+							RelationGetRelationName(frel))));
+		dtype = pgstrom_devtype_lookup(attr->atttypid);
+		if (!dtype || !dtype->hash_func)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("gstore_fdw: hash-index is not supported on column \"%s\" of type %s",
+							NameStr(attr->attname),
+							format_type_be(attr->atttypid))));
+		anum = attr->attnum;
+	}
+	if (p_dtype)
+		*p_dtype = dtype;
+	return anum;
 }
 
 /*
@@ -1704,6 +3086,7 @@ gstore_fdw_column_options(Oid gstore_oid, AttrNumber attnum,
 static void
 gstore_fdw_post_alter(Oid relid, AttrNumber attnum)
 {
+	Relation		frel;
 	GpuStoreBuffer *gs_buffer;
 	GpuStoreChunk  *gs_chunk;
 	bool			found;
@@ -1712,6 +3095,11 @@ gstore_fdw_post_alter(Oid relid, AttrNumber attnum)
 	if (!relation_is_gstore_fdw(relid))
 		return;
 
+	/* hash-index must be on a supported column */
+	frel = heap_open(relid, NoLock);
+	(void) gstore_fdw_index_column(frel, NULL);
+	heap_close(frel, NoLock);
+
 	/* we don't allow ALTER FOREIGN TABLE onto non-empty gstore_fdw */
 	if (gstore_buffer_htab)
 	{
@@ -1837,11 +3225,11 @@ pgstrom_gstore_fdw_validator(PG_FUNCTION_ARGS)
 	switch (catalog)
 	{
 		case ForeignTableRelationId:
-			__gstore_fdw_table_options(options, NULL, NULL);
+			__gstore_fdw_table_options(options, NULL, NULL, NULL, NULL);
 			break;
 
 		case AttributeRelationId:
-			__gstore_fdw_column_options(options, NULL);
+			__gstore_fdw_column_options(options, NULL, NULL);
 			break;
 
 		case ForeignServerRelationId:
@@ -1880,6 +3268,8 @@ pgstrom_gstore_fdw_handler(PG_FUNCTION_ARGS)
 	routine->IterateForeignScan	= gstoreIterateForeignScan;
 	routine->ReScanForeignScan	= gstoreReScanForeignScan;
 	routine->EndForeignScan		= gstoreEndForeignScan;
+	routine->ExplainForeignScan	= gstoreExplainForeignScan;
+	routine->IsForeignScanParallelSafe = gstoreIsForeignScanParallelSafe;
 
 	/* functions for INSERT/UPDATE/DELETE foreign tables */
 
@@ -2003,7 +3393,9 @@ pgstrom_gstore_export_ipchandle(PG_FUNCTION_ARGS)
 	Oid				gstore_oid = PG_GETARG_OID(0);
 	AclResult		aclresult;
 	cl_int			pinning;
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
 	GpuStoreChunk  *gs_chunk;
+	int				nchunks;
 	char		   *result;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
@@ -2022,9 +3414,20 @@ pgstrom_gstore_export_ipchandle(PG_FUNCTION_ARGS)
 		elog(ERROR, "gstore_fdw: \"%s\" is not pinned on valid GPU device",
 			 get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (!gs_chunk)
+	nchunks = gstore_fdw_lookup_chunks(gstore_oid, GetActiveSnapshot(),
+									   chunks, NULL);
+	if (nchunks == 0)
 		PG_RETURN_NULL();
+	gs_chunk = chunks[0];
+	if (gs_chunk->nshards > 1)
+		elog(ERROR, "gstore_fdw: \"%s\" is sharded to multiple GPU devices",
+			 get_rel_name(gstore_oid));
+	if (nchunks > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("gstore_fdw: \"%s\" has delta chunks not merged yet",
+						get_rel_name(gstore_oid)),
+				 errhint("Write the table with pg_strom.gstore_max_delta_chunks = 0 to merge the delta chunks.")));
 
 	result = palloc(VARHDRSZ + sizeof(CUipcMemHandle));
 	memcpy(result + VARHDRSZ, &gs_chunk->ipc_mhandle, sizeof(CUipcMemHandle));
@@ -2077,89 +3480,60 @@ type_is_reggstore(Oid type_oid)
 	return true;
 }
 
-static CUdeviceptr
-gstore_open_device_memory(GpuContext *gcontext, Relation frel)
+/*
+ * gstore_fdw_lookup_images
+ *
+ * It looks up the chunks of gstore_fdw foreign table to be opened as device
+ * images, then returns number of the images. Local buffer, if it has
+ * updates not loaded to the device yet, replaces the whole image (or is
+ * appended to the chunks if append-only). At least one image is returned
+ * even if empty.
+ */
+static int
+gstore_fdw_lookup_images(Relation frel, GpuStoreChunk **chunks,
+						 GpuStoreBuffer **p_gs_buffer)
 {
-	TupleDesc		tupdesc = RelationGetDescr(frel);
 	GpuStoreBuffer *gs_buffer;
-	GpuStoreChunk  *gs_chunk;
-	CUdeviceptr		m_deviceptr;
-	CUresult		rc;
-	bool			found;
-	size_t			nrooms;
-	size_t			length;
-	cl_int			j, ncols;
-	bits8		   *rowmap;
+	int			nchunks;
+	bool		found;
 
-	gs_chunk = gstore_fdw_lookup_chunk(RelationGetRelid(frel),
-									   GetActiveSnapshot());
+	nchunks = gstore_fdw_lookup_chunks(RelationGetRelid(frel),
+									   GetActiveSnapshot(), chunks, NULL);
 	gs_buffer = (!gstore_buffer_htab
 				 ? NULL
 				 : hash_search(gstore_buffer_htab,
 							   &RelationGetRelid(frel),
 							   HASH_FIND,
 							   &found));
-	if (gs_chunk)
-	{
-		/*
-		 * If device memory is valid and up-to-date, open IpcHandle
-		 * and returns this device address.
-		 */
-		if (!gs_buffer || (gs_buffer->revision == gs_chunk->revision &&
-						   !gs_buffer->is_dirty))
-		{
-			if (gcontext->cuda_dindex != gs_chunk->pinning)
-				elog(ERROR, "Bug? gstore_fdw: \"%s\" has wrong pinning",
-					 RelationGetRelationName(frel));
-
-			rc = cuCtxPushCurrent(gcontext->cuda_context);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
-			rc = gpuIpcOpenMemHandle(gcontext,
-									 &m_deviceptr,
-									 gs_chunk->ipc_mhandle,
-									 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on gpuIpcOpenMemHandle: %s",
-					 errorText(rc));
+	if (gs_buffer && !gs_buffer->is_dirty)
+		gs_buffer = NULL;
+	*p_gs_buffer = gs_buffer;
 
-			rc = cuCtxPopCurrent(NULL);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
-
-			return m_deviceptr;
-		}
-		/* Hmm... on device image is not up to date... */
-	}
-	/*
-	 * corner case: we have neither device memory nor local buffer.
-	 * in this case, we make an empty store.
-	 */
 	if (!gs_buffer)
-	{
-		ncols = tupdesc->natts + NumOfSystemAttrs;
-		length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
-		rc = gpuMemAllocManaged(gcontext,
-								&m_deviceptr,
-								length,
-								CU_MEM_ATTACH_GLOBAL);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+		return Max(nchunks, 1);
+	if (gs_buffer->append_only)
+		return nchunks + 1;
+	return 1;
+}
 
-		init_kernel_data_store((kern_data_store *)m_deviceptr,
-							   tupdesc,
-							   length,
-							   KDS_FORMAT_COLUMN,
-							   0);
-		return m_deviceptr;
-	}
+/*
+ * gstore_fdw_local_device_image
+ *
+ * It constructs in-kernel image of the visible rows on the local read-write
+ * buffer. Logic is almost same to ccache_copy_buffer_to_kds()
+ */
+static CUdeviceptr
+gstore_fdw_local_device_image(GpuContext *gcontext, Relation frel,
+							  GpuStoreBuffer *gs_buffer)
+{
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	size_t			nrooms;
+	size_t			length;
+	cl_int			j, ncols;
+	bits8		   *rowmap;
 
-	/*
-	 * local read-write buffer is up-to-date.
-	 * So, we need to construct in-kernel image.
-	 *
-	 * Logic is almost same to gstore_fdw_alloc_pgstrom_buffer()
-	 */
 	rowmap = gstore_fdw_visibility_bitmap(gs_buffer, &nrooms);
 	ncols = tupdesc->natts + NumOfSystemAttrs;
 	length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
@@ -2192,29 +3566,147 @@ gstore_open_device_memory(GpuContext *gcontext, Relation frel)
 
 	ccache_copy_buffer_to_kds((kern_data_store *)m_deviceptr,
 							  tupdesc, &gs_buffer->cc_buf, rowmap, nrooms);
+	if (rowmap)
+		pfree(rowmap);
 
 	return m_deviceptr;
 }
 
 /*
- * gstore_fdw_preferable_device
+ * gstore_open_device_memory
+ *
+ * It opens the device memory of the image of gstore_fdw foreign table;
+ * either of the shards, the delta chunks or the local buffer.
+ * If local buffer has updates not loaded to the device yet, the whole image
+ * is constructed on the first image, and the others shall be empty.
  */
-int
-gstore_fdw_preferable_device(FunctionCallInfo fcinfo)
+static CUdeviceptr
+gstore_open_device_memory(GpuContext *gcontext, Relation frel, int image_id,
+						  bool *p_ipc_mapped)
 {
-	FmgrInfo   *flinfo = fcinfo->flinfo;
-	HeapTuple	protup;
-	oidvector  *proargtypes;
-	cl_int		i, cuda_dindex = -1;
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	GpuStoreBuffer *gs_buffer;
+	GpuStoreChunk  *gs_chunk = NULL;
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	size_t			length;
+	int				nimages;
+	cl_int			ncols;
 
-	protup = SearchSysCache1(PROCOID, ObjectIdGetDatum(flinfo->fn_oid));
-	if (!HeapTupleIsValid(protup))
-		elog(ERROR, "cache lookup failed function %u", flinfo->fn_oid);
-	proargtypes = &((Form_pg_proc)GETSTRUCT(protup))->proargtypes;
-	for (i=0; i < proargtypes->dim1; i++)
+	if (p_ipc_mapped)
+		*p_ipc_mapped = false;
+	nimages = gstore_fdw_lookup_images(frel, chunks, &gs_buffer);
+	if (image_id < nimages)
 	{
-		Oid		gstore_oid;
-		int		pinning;
+		if (!gs_buffer || gs_buffer->append_only)
+			gs_chunk = chunks[image_id];
+		/* local read-write buffer is up-to-date */
+		if (!gs_chunk && gs_buffer)
+			return gstore_fdw_local_device_image(gcontext, frel, gs_buffer);
+	}
+
+	if (gs_chunk)
+	{
+		/*
+		 * Shards on the other devices are accessed using peer access
+		 * (CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS), if any.
+		 */
+		if (gs_chunk->nshards == 1 &&
+			gs_chunk->delta_id == 0 &&
+			gcontext->cuda_dindex != gs_chunk->pinning)
+			elog(ERROR, "Bug? gstore_fdw: \"%s\" has wrong pinning",
+				 RelationGetRelationName(frel));
+
+		rc = cuCtxPushCurrent(gcontext->cuda_context);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &m_deviceptr,
+								 gs_chunk->ipc_mhandle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s",
+				 errorText(rc));
+
+		rc = cuCtxPopCurrent(NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
+
+		if (p_ipc_mapped)
+			*p_ipc_mapped = true;
+		return m_deviceptr;
+	}
+
+	/*
+	 * corner case: we have neither device memory nor local buffer.
+	 * in this case, we make an empty store. It is also used for the
+	 * images out of range.
+	 */
+	ncols = tupdesc->natts + NumOfSystemAttrs;
+	length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+
+	init_kernel_data_store((kern_data_store *)m_deviceptr,
+						   tupdesc,
+						   length,
+						   KDS_FORMAT_COLUMN,
+						   0);
+	return m_deviceptr;
+}
+
+/*
+ * gstore_open_merged_device_memory
+ *
+ * It opens the device memory of gstore_fdw foreign table as a single image.
+ * If the table has delta chunks not merged yet, the image is constructed
+ * from the local buffer which materialized all the rows.
+ * *p_ipc_mapped is set if the device memory is mapped by IPC handle.
+ * Elsewhere, it is allocated newly, thus caller has to release it.
+ */
+static CUdeviceptr
+gstore_open_merged_device_memory(GpuContext *gcontext, Relation frel,
+								 bool *p_ipc_mapped)
+{
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+	GpuStoreBuffer *gs_buffer;
+	Snapshot		snapshot = GetActiveSnapshot();
+
+	if (gstore_fdw_lookup_images(frel, chunks, &gs_buffer) == 1)
+		return gstore_open_device_memory(gcontext, frel, 0, p_ipc_mapped);
+
+	*p_ipc_mapped = false;
+
+	gs_buffer = gstore_fdw_create_buffer(frel, snapshot);
+	gstore_fdw_make_buffer_writable(frel, gs_buffer, snapshot, false);
+
+	return gstore_fdw_local_device_image(gcontext, frel, gs_buffer);
+}
+
+/*
+ * gstore_fdw_preferable_device
+ */
+int
+gstore_fdw_preferable_device(FunctionCallInfo fcinfo)
+{
+	FmgrInfo   *flinfo = fcinfo->flinfo;
+	HeapTuple	protup;
+	oidvector  *proargtypes;
+	cl_int		i, cuda_dindex = -1;
+
+	protup = SearchSysCache1(PROCOID, ObjectIdGetDatum(flinfo->fn_oid));
+	if (!HeapTupleIsValid(protup))
+		elog(ERROR, "cache lookup failed function %u", flinfo->fn_oid);
+	proargtypes = &((Form_pg_proc)GETSTRUCT(protup))->proargtypes;
+	for (i=0; i < proargtypes->dim1; i++)
+	{
+		Oid		gstore_oid;
+		int		pinning;
 
 		if (proargtypes->values[i] != REGGSTOREOID)
 			continue;
@@ -2222,6 +3714,9 @@ gstore_fdw_preferable_device(FunctionCallInfo fcinfo)
 		if (!relation_is_gstore_fdw(gstore_oid))
 			elog(ERROR, "relation %u is not gstore_fdw foreign table",
 				 gstore_oid);
+		if (gstore_fdw_table_shards(gstore_oid, NULL) > 1)
+			elog(ERROR, "function %s: gstore_fdw \"%s\" is sharded to multiple GPU devices",
+				 format_procedure(flinfo->fn_oid), get_rel_name(gstore_oid));
 		gstore_fdw_table_options(gstore_oid, &pinning, NULL);
 		if (pinning < 0 || pinning >= numDevAttrs)
 			elog(ERROR, "gstore_fdw: \"%s\" is pinned on unknown device %d",
@@ -2266,6 +3761,7 @@ gstore_fdw_load_function_args(GpuContext *gcontext,
 		Oid			gstore_oid;
 		int			pinning;
 		CUdeviceptr	m_deviceptr;
+		bool		ipc_mapped;
 
 		if (proargtypes->values[i] != REGGSTOREOID)
 			continue;
@@ -2289,13 +3785,20 @@ gstore_fdw_load_function_args(GpuContext *gcontext,
 				 get_rel_name(gstore_oid), pinning, gcontext->cuda_dindex);
 
 		frel = heap_open(gstore_oid, AccessShareLock);
-		m_deviceptr = gstore_open_device_memory(gcontext, frel);
+		m_deviceptr = gstore_open_merged_device_memory(gcontext, frel,
+													   &ipc_mapped);
 		heap_close(frel, NoLock);
 
+		/*
+		 * Device memory mapped by IPC handle is passed to the kernel as is,
+		 * without copy. Elsewhere, negative dindex informs the caller to
+		 * release the device memory constructed on the fly.
+		 */
 		gstore_oid_list = lappend_oid(gstore_oid_list, gstore_oid);
 		gstore_devptr_list = lappend(gstore_devptr_list,
 									 (void *)m_deviceptr);
-		gstore_dindex_list = lappend_int(gstore_dindex_list, pinning);
+		gstore_dindex_list = lappend_int(gstore_dindex_list,
+										 ipc_mapped ? pinning : -1);
 	}
 	ReleaseSysCache(protup);
 	*p_gstore_oid_list = gstore_oid_list;
@@ -2303,6 +3806,103 @@ gstore_fdw_load_function_args(GpuContext *gcontext,
 	*p_gstore_dindex_list = gstore_dindex_list;
 }
 
+/*
+ * gstore_fdw_num_shards
+ *
+ * It returns number of the shards of gstore_fdw foreign table.
+ */
+int
+gstore_fdw_num_shards(Oid gstore_oid)
+{
+	if (!relation_is_gstore_fdw(gstore_oid))
+		elog(ERROR, "relation %u is not gstore_fdw foreign table",
+			 gstore_oid);
+	return gstore_fdw_table_shards(gstore_oid, NULL);
+}
+
+/*
+ * gstore_fdw_device_images
+ *
+ * It returns number of the device images of gstore_fdw foreign table to be
+ * scanned, and the device index where each image is located. @devices must
+ * have GSTORE_FDW_MAX_IMAGES items at least.
+ */
+int
+gstore_fdw_device_images(Relation frel, cl_int *devices)
+{
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
+	GpuStoreBuffer *gs_buffer;
+	cl_int			shards[GSTORE_FDW_MAX_SHARDS];
+	int				i, nimages;
+
+	if (!relation_is_gstore_fdw(RelationGetRelid(frel)))
+		elog(ERROR, "relation %u is not gstore_fdw foreign table",
+			 RelationGetRelid(frel));
+	gstore_fdw_table_shards(RelationGetRelid(frel), shards);
+	nimages = gstore_fdw_lookup_images(frel, chunks, &gs_buffer);
+	for (i=0; i < nimages; i++)
+	{
+		if (chunks[i] && (!gs_buffer || gs_buffer->append_only))
+			devices[i] = chunks[i]->pinning;
+		else
+			devices[i] = shards[0];
+	}
+	return nimages;
+}
+
+/*
+ * gstore_fdw_open_data_store
+ *
+ * It opens the device memory of the image of gstore_fdw foreign table, for
+ * GpuScan to run its kernel on the KDS_FORMAT_COLUMN image directly. The PDS returned
+ * has only the header portion of the KDS (kds.length still represents the
+ * length of the device image), because the contents are never touched
+ * unless CPU fallback happen. In this case, caller has to copy back the
+ * entire image from *p_m_kds by itself.
+ */
+pgstrom_data_store *
+gstore_fdw_open_data_store(GpuContext *gcontext, Relation frel,
+						   int image_id, CUdeviceptr *p_m_kds)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	pgstrom_data_store *pds;
+	CUdeviceptr	m_kds;
+	CUdeviceptr	m_deviceptr;
+	CUresult	rc;
+	size_t		head_sz;
+
+	m_kds = gstore_open_device_memory(gcontext, frel, image_id, NULL);
+	head_sz = STROMALIGN(offsetof(kern_data_store,
+								  colmeta[tupdesc->natts +
+										  NumOfSystemAttrs]));
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store, kds) + head_sz,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	pds = (pgstrom_data_store *) m_deviceptr;
+	memset(&pds->chain, 0, sizeof(dlist_node));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = -1;
+
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	rc = cuMemcpyDtoH(&pds->kds, m_kds, head_sz);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	Assert(pds->kds.format == KDS_FORMAT_COLUMN);
+
+	*p_m_kds = m_kds;
+	return pds;
+}
+
 /*
  * pgstrom_gstore_fdw_format
  */
@@ -2336,9 +3936,10 @@ Datum
 pgstrom_gstore_fdw_nitems(PG_FUNCTION_ARGS)
 {
 	Oid				gstore_oid = PG_GETARG_OID(0);
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
 	AclResult		aclresult;
 	int64			retval = 0;
+	int				i, nchunks;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
 		PG_RETURN_NULL();
@@ -2347,9 +3948,10 @@ pgstrom_gstore_fdw_nitems(PG_FUNCTION_ARGS)
 		aclcheck_error(aclresult, ACL_KIND_CLASS,
 					   get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (gs_chunk)
-		retval = gs_chunk->nitems;
+	nchunks = gstore_fdw_lookup_chunks(gstore_oid, GetActiveSnapshot(),
+									   chunks, NULL);
+	for (i=0; i < nchunks; i++)
+		retval += chunks[i]->nitems;
 
 	PG_RETURN_INT64(retval);
 }
@@ -2389,8 +3991,9 @@ pgstrom_gstore_fdw_rawsize(PG_FUNCTION_ARGS)
 {
 	Oid				gstore_oid = PG_GETARG_OID(0);
 	AclResult		aclresult;
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *chunks[GSTORE_FDW_MAX_IMAGES];
 	int64			retval = 0;
+	int				i, nchunks;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
 		PG_RETURN_NULL();
@@ -2399,9 +4002,10 @@ pgstrom_gstore_fdw_rawsize(PG_FUNCTION_ARGS)
 		aclcheck_error(aclresult, ACL_KIND_CLASS,
 					   get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (gs_chunk)
-		retval = gs_chunk->rawsize;
+	nchunks = gstore_fdw_lookup_chunks(gstore_oid, GetActiveSnapshot(),
+									   chunks, NULL);
+	for (i=0; i < nchunks; i++)
+		retval += chunks[i]->rawsize;
 
 	PG_RETURN_INT64(retval);
 }
@@ -2417,8 +4021,8 @@ pgstrom_gstore_fdw_chunk_info(PG_FUNCTION_ARGS)
 	GpuStoreChunk  *gs_chunk;
 	GpuStoreChunk  *gs_temp;
 	List	   *chunks_list;
-	Datum		values[9];
-	bool		isnull[9];
+	Datum		values[12];
+	bool		isnull[12];
 	HeapTuple	tuple;
 
 	if (SRF_IS_FIRSTCALL())
@@ -2429,7 +4033,7 @@ pgstrom_gstore_fdw_chunk_info(PG_FUNCTION_ARGS)
 		fncxt = SRF_FIRSTCALL_INIT();
 		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
 
-		tupdesc = CreateTemplateTupleDesc(9, false);
+		tupdesc = CreateTemplateTupleDesc(12, false);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "database_oid",
 						   OIDOID, -1, 0);
         TupleDescInitEntry(tupdesc, (AttrNumber) 2, "table_oid",
@@ -2448,6 +4052,12 @@ pgstrom_gstore_fdw_chunk_info(PG_FUNCTION_ARGS)
 						   INT8OID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 9, "nitems",
 						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "shard_id",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 11, "nshards",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 12, "delta_id",
+						   INT4OID, -1, 0);
 		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
 
 		chunks_list = NIL;
@@ -2512,6 +4122,9 @@ pgstrom_gstore_fdw_chunk_info(PG_FUNCTION_ARGS)
 												 gs_chunk->format));
 	values[7] = Int64GetDatum(gs_chunk->rawsize);
 	values[8] = Int64GetDatum(gs_chunk->nitems);
+	values[9] = Int32GetDatum(gs_chunk->shard_id);
+	values[10] = Int32GetDatum(gs_chunk->nshards);
+	values[11] = Int32GetDatum(gs_chunk->delta_id);
 
 	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
 
@@ -2519,6 +4132,657 @@ pgstrom_gstore_fdw_chunk_info(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_chunk_info);
 
+/*
+ * Bulk-load of CSV/TSV file
+ *
+ * gstore_fdw_load() loads the records of a server-side CSV or TSV file onto
+ * the read-write buffer directly, instead of COPY's per-row parser and
+ * gstoreExecForeignInsert(). The file is read by GSTORE_LOAD_BUFSZ, then
+ * the backend splits the records (quoted newline needs a sequential scan,
+ * but it is cheap) and assigns ranges of them to pg_strom.gstore_load_threads
+ * threads. The threads tokenize the records in place, and convert the
+ * fields of by-value types which we can parse without the type input
+ * function. The other fields are converted by the backend, because type
+ * input functions may allocate memory or raise an error. Errors in the
+ * threads are recorded, then raised by the backend after the join.
+ */
+#define GSTORE_LOAD_BUFSZ			(32UL << 20)
+#define GSTORE_LOAD_MAX_THREADS		64
+#define GSTORE_LOAD_MIN_ROWS		4096	/* per thread */
+#define GSTORE_LOAD_MAX_ROWS		65536	/* per batch */
+
+typedef struct
+{
+	TupleDesc	tupdesc;
+	bool		is_csv;
+	int			encoding;
+	bool	   *fast_conv;	/* [natts] converted by the threads */
+	char	  **records;	/* [nrecords] nul-terminated records */
+	char	  **fields;		/* [nrecords * natts] fields, or NULL */
+	Datum	   *values;		/* [nrecords * natts] */
+	bool	   *isnull;		/* [nrecords * natts] */
+} gstoreLoadBatch;
+
+typedef struct
+{
+	gstoreLoadBatch *batch;
+	size_t		row_start;
+	size_t		row_end;
+	/* error status */
+	size_t		err_row;
+	int			err_attnum;	/* 0, if not column specific */
+	const char *err_msg;
+} gstoreLoadThread;
+
+/*
+ * gstore_load_tokenize_csv - splits a CSV record into the fields in place.
+ * It returns the number of fields, or -1 if too many.
+ */
+static int
+gstore_load_tokenize_csv(char *pos, char **fields, int nfields)
+{
+	int		count = 0;
+
+	for (;;)
+	{
+		char   *wpos = pos;
+		bool	quoted = false;
+		bool	in_quote = false;
+
+		if (count >= nfields)
+			return -1;
+		fields[count] = pos;
+		while (*pos != '\0')
+		{
+			if (in_quote)
+			{
+				if (*pos != '"')
+					*wpos++ = *pos++;
+				else if (pos[1] == '"')
+				{
+					*wpos++ = '"';
+					pos += 2;
+				}
+				else
+				{
+					in_quote = false;
+					pos++;
+				}
+			}
+			else if (*pos == '"')
+			{
+				quoted = in_quote = true;
+				pos++;
+			}
+			else if (*pos == ',')
+				break;
+			else
+				*wpos++ = *pos++;
+		}
+		/* unquoted empty string means NULL */
+		if (!quoted && wpos == fields[count])
+			fields[count] = NULL;
+		count++;
+		if (*pos == '\0')
+		{
+			*wpos = '\0';
+			break;
+		}
+		*wpos = '\0';
+		pos++;
+	}
+	return count;
+}
+
+/*
+ * gstore_load_tokenize_tsv - splits a TSV (COPY text format) record into
+ * the fields in place. It returns the number of fields, or -1 if too many.
+ */
+static int
+gstore_load_tokenize_tsv(char *pos, char **fields, int nfields)
+{
+	int		count = 0;
+
+	for (;;)
+	{
+		char   *wpos = pos;
+
+		if (count >= nfields)
+			return -1;
+		fields[count] = pos;
+		while (*pos != '\0' && *pos != '\t')
+		{
+			if (*pos != '\\' || pos[1] == '\0')
+			{
+				*wpos++ = *pos++;
+				continue;
+			}
+			switch (pos[1])
+			{
+				case 'b':	*wpos++ = '\b';	break;
+				case 'f':	*wpos++ = '\f';	break;
+				case 'n':	*wpos++ = '\n';	break;
+				case 'r':	*wpos++ = '\r';	break;
+				case 't':	*wpos++ = '\t';	break;
+				case 'v':	*wpos++ = '\v';	break;
+				default:	*wpos++ = pos[1]; break;
+			}
+			pos += 2;
+		}
+		/* \N means NULL */
+		if (pos - fields[count] == 2 && strncmp(fields[count], "\\N", 2) == 0)
+			fields[count] = NULL;
+		count++;
+		if (*pos == '\0')
+		{
+			*wpos = '\0';
+			break;
+		}
+		*wpos = '\0';
+		pos++;
+	}
+	return count;
+}
+
+/*
+ * gstore_load_convert_fast - converts a field without the input function.
+ * It returns an error message, or NULL on success.
+ */
+static const char *
+gstore_load_convert_fast(Form_pg_attribute attr, char *str, Datum *p_value)
+{
+	char	   *end;
+
+	while (isspace((unsigned char) *str))
+		str++;
+	errno = 0;
+	switch (attr->atttypid)
+	{
+		case BOOLOID:
+			{
+				size_t	len = strlen(str);
+				bool	bval;
+
+				while (len > 0 && isspace((unsigned char) str[len-1]))
+					len--;
+				if (!parse_bool_with_len(str, len, &bval))
+					return "invalid input syntax for type boolean";
+				*p_value = BoolGetDatum(bval);
+				return NULL;
+			}
+		case INT2OID:
+		case INT4OID:
+			{
+				long	ival = strtol(str, &end, 10);
+
+				if (end == str)
+					return "invalid input syntax for integer";
+				if (errno == ERANGE ||
+					(attr->atttypid == INT2OID
+					 ? (ival < SHRT_MIN || ival > SHRT_MAX)
+					 : (ival < INT_MIN || ival > INT_MAX)))
+					return "value out of range for integer";
+				*p_value = (attr->atttypid == INT2OID
+							? Int16GetDatum((int16) ival)
+							: Int32GetDatum((int32) ival));
+			}
+			break;
+		case INT8OID:
+			{
+				long long	ival = strtoll(str, &end, 10);
+
+				if (end == str)
+					return "invalid input syntax for integer";
+				if (errno == ERANGE)
+					return "value out of range for type bigint";
+				*p_value = Int64GetDatum((int64) ival);
+			}
+			break;
+		case FLOAT4OID:
+		case FLOAT8OID:
+			{
+				double	fval = strtod(str, &end);
+
+				if (end == str)
+					return "invalid input syntax for type double precision";
+				if (errno == ERANGE && fval != 0.0)
+					return "value out of range for type double precision";
+				if (attr->atttypid == FLOAT4OID)
+				{
+					if (!isinf(fval) && fabs(fval) > FLT_MAX)
+						return "value out of range for type real";
+					*p_value = Float4GetDatum((float4) fval);
+				}
+				else
+					*p_value = Float8GetDatum(fval);
+			}
+			break;
+		default:
+			return "Bug? unexpected data type for fast conversion";
+	}
+	/* only trailing white-spaces are allowed */
+	while (isspace((unsigned char) *end))
+		end++;
+	if (*end != '\0')
+		return "invalid input syntax";
+	return NULL;
+}
+
+static void *
+gstore_load_thread_main(void *__arg)
+{
+	gstoreLoadThread *glt = __arg;
+	gstoreLoadBatch *batch = glt->batch;
+	TupleDesc	tupdesc = batch->tupdesc;
+	int			natts = tupdesc->natts;
+	char	   *tokens[MaxTupleAttributeNumber + 1];
+	size_t		row;
+	int			i, j, nvalid = 0;
+
+	for (j=0; j < natts; j++)
+	{
+		if (!tupdesc->attrs[j]->attisdropped)
+			nvalid++;
+	}
+
+	for (row = glt->row_start; row < glt->row_end; row++)
+	{
+		char   *rec = batch->records[row];
+		size_t	len = strlen(rec);
+		char  **fields = batch->fields + row * natts;
+		Datum  *values = batch->values + row * natts;
+		bool   *isnull = batch->isnull + row * natts;
+		int		ntokens;
+
+		if (!pg_verify_mbstr(batch->encoding, rec, len, true))
+		{
+			glt->err_msg = "invalid byte sequence";
+			goto error;
+		}
+		if (len > 0 && rec[len-1] == '\r')
+			rec[len-1] = '\0';
+		if (batch->is_csv)
+			ntokens = gstore_load_tokenize_csv(rec, tokens, nvalid + 1);
+		else
+			ntokens = gstore_load_tokenize_tsv(rec, tokens, nvalid + 1);
+		if (ntokens < 0 || ntokens > nvalid)
+		{
+			glt->err_msg = "extra data after last expected column";
+			goto error;
+		}
+		if (ntokens < nvalid)
+		{
+			glt->err_msg = "missing data for column";
+			goto error;
+		}
+
+		for (i=0, j=0; j < natts; j++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[j];
+			const char *errmsg;
+
+			values[j] = 0;
+			isnull[j] = true;
+			fields[j] = NULL;
+			if (attr->attisdropped)
+				continue;
+			fields[j] = tokens[i++];
+			if (!fields[j])
+				continue;
+			if (batch->fast_conv[j])
+			{
+				errmsg = gstore_load_convert_fast(attr, fields[j],
+												  &values[j]);
+				if (errmsg)
+				{
+					glt->err_msg = errmsg;
+					glt->err_attnum = j+1;
+					goto error;
+				}
+			}
+			isnull[j] = false;
+		}
+	}
+	return NULL;
+
+error:
+	glt->err_row = row;
+	return NULL;
+}
+
+/*
+ * gstore_load_split_records
+ *
+ * It splits the buffer into up to GSTORE_LOAD_MAX_ROWS records, and returns
+ * the length consumed. A partial record at the tail is not consumed unless
+ * @is_eof. @buf must have a room for the terminator at buf[length].
+ */
+static size_t
+gstore_load_split_records(char *buf, size_t length, bool is_csv, bool is_eof,
+						  char **records, size_t *p_nrecords)
+{
+	size_t		nrecords = 0;
+	size_t		head = 0;
+	size_t		i;
+	bool		in_quote = false;
+
+	for (i=0; i < length; i++)
+	{
+		if (is_csv && buf[i] == '"')
+			in_quote = !in_quote;
+		else if (buf[i] == '\n' && !in_quote)
+		{
+			buf[i] = '\0';
+			records[nrecords++] = buf + head;
+			head = i + 1;
+			if (nrecords >= GSTORE_LOAD_MAX_ROWS)
+				goto out;
+		}
+	}
+	if (is_eof && head < length)
+	{
+		buf[length] = '\0';
+		records[nrecords++] = buf + head;
+		head = length;
+	}
+out:
+	*p_nrecords = nrecords;
+	return head;
+}
+
+/*
+ * gstore_load_exec_batch - converts the records and puts them onto the
+ * read-write buffer
+ */
+static void
+gstore_load_exec_batch(Relation frel, GpuStoreBuffer *gs_buffer,
+					   gstoreLoadBatch *batch, size_t nrecords,
+					   FmgrInfo *in_functions, Oid *typioparams,
+					   CommandId cid, size_t lineno)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	ccacheBuffer *cc_buf = &gs_buffer->cc_buf;
+	int			natts = tupdesc->natts;
+	gstoreLoadThread *threads;
+	pthread_t  *thread_ids;
+	bool	   *thread_valid;
+	size_t		unitsz;
+	size_t		row;
+	int			nthreads;
+	int			i, j;
+
+	nthreads = Min(gstore_load_nthreads,
+				   (nrecords + GSTORE_LOAD_MIN_ROWS - 1) /
+				   GSTORE_LOAD_MIN_ROWS);
+	nthreads = Max(nthreads, 1);
+	unitsz = (nrecords + nthreads - 1) / nthreads;
+
+	threads = palloc0(sizeof(gstoreLoadThread) * nthreads);
+	thread_ids = palloc0(sizeof(pthread_t) * nthreads);
+	thread_valid = palloc0(sizeof(bool) * nthreads);
+	for (i=0; i < nthreads; i++)
+	{
+		threads[i].batch = batch;
+		threads[i].row_start = Min(unitsz * i, nrecords);
+		threads[i].row_end = Min(unitsz * (i+1), nrecords);
+	}
+
+	/*
+	 * The first range is processed by the backend itself, and so are the
+	 * ranges whose thread could not be launched, because we must not raise
+	 * an error while other threads are running.
+	 */
+	for (i=1; i < nthreads; i++)
+	{
+		if (pthread_create(&thread_ids[i], NULL,
+						   gstore_load_thread_main,
+						   &threads[i]) == 0)
+			thread_valid[i] = true;
+	}
+	gstore_load_thread_main(&threads[0]);
+	for (i=1; i < nthreads; i++)
+	{
+		if (!thread_valid[i])
+			gstore_load_thread_main(&threads[i]);
+	}
+	for (i=1; i < nthreads; i++)
+	{
+		if (thread_valid[i] && (errno = pthread_join(thread_ids[i], NULL)) != 0)
+			elog(FATAL, "failed on pthread_join: %m");
+	}
+	/* raise an error of the earliest record, if any */
+	for (i=0; i < nthreads; i++)
+	{
+		gstoreLoadThread *glt = &threads[i];
+
+		if (!glt->err_msg)
+			continue;
+		if (glt->err_attnum > 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+					 errmsg("gstore_fdw: %s, record %zu, column %s",
+							glt->err_msg, lineno + glt->err_row,
+							NameStr(tupdesc->attrs[glt->err_attnum-1]->attname))));
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("gstore_fdw: %s, record %zu",
+						glt->err_msg, lineno + glt->err_row)));
+	}
+
+	/* convert the remaining fields, then put the rows */
+	for (row=0; row < nrecords; row++)
+	{
+		char  **fields = batch->fields + row * natts;
+		Datum  *values = batch->values + row * natts;
+		bool   *isnull = batch->isnull + row * natts;
+		MVCCAttrs *mvcc;
+		size_t	index;
+
+		CHECK_FOR_INTERRUPTS();
+		for (j=0; j < natts; j++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[j];
+
+			if (attr->attisdropped || !fields[j] || batch->fast_conv[j])
+				continue;
+			values[j] = InputFunctionCall(&in_functions[j],
+										  fields[j],
+										  typioparams[j],
+										  attr->atttypmod);
+		}
+		while (cc_buf->nitems >= cc_buf->nrooms)
+		{
+			ccache_expand_buffer(tupdesc, cc_buf, gs_buffer->memcxt);
+			gs_buffer->cs_mvcc = repalloc_huge(gs_buffer->cs_mvcc,
+											   sizeof(MVCCAttrs) *
+											   cc_buf->nrooms);
+		}
+		ccache_buffer_append_row(tupdesc,
+								 cc_buf,
+								 NULL,	/* no system columns */
+								 isnull,
+								 values,
+								 gs_buffer->memcxt);
+		index = cc_buf->nitems++;
+		mvcc = &gs_buffer->cs_mvcc[index];
+		memset(mvcc, 0, sizeof(MVCCAttrs));
+		mvcc->xmin = GetCurrentTransactionId();
+		mvcc->xmax = InvalidTransactionId;
+		mvcc->cid  = cid;
+	}
+	gs_buffer->is_dirty = true;
+	pfree(threads);
+	pfree(thread_ids);
+	pfree(thread_valid);
+}
+
+/*
+ * pgstrom_gstore_fdw_load
+ */
+Datum
+pgstrom_gstore_fdw_load(PG_FUNCTION_ARGS)
+{
+	Oid				gstore_oid = PG_GETARG_OID(0);
+	char		   *filename = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	char		   *format = text_to_cstring(PG_GETARG_TEXT_PP(2));
+	bool			header = PG_GETARG_BOOL(3);
+	Snapshot		snapshot = GetActiveSnapshot();
+	Relation		frel;
+	TupleDesc		tupdesc;
+	GpuStoreBuffer *gs_buffer;
+	gstoreLoadBatch	batch;
+	FmgrInfo	   *in_functions;
+	Oid			   *typioparams;
+	AclResult		aclresult;
+	MemoryContext	batch_cxt;
+	MemoryContext	oldcxt;
+	CommandId		cid;
+	FILE		   *filp;
+	char		   *buf;
+	char		  **records;
+	size_t			length = 0;
+	size_t			offset = 0;
+	size_t			lineno = 1;
+	size_t			nloaded = 0;
+	bool			is_eof = false;
+	int				j, natts;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to load a file to gstore_fdw")));
+	if (!relation_is_gstore_fdw(gstore_oid))
+		elog(ERROR, "relation %u is not gstore_fdw foreign table",
+			 gstore_oid);
+	aclresult = pg_class_aclcheck(gstore_oid, GetUserId(), ACL_INSERT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, ACL_KIND_CLASS,
+					   get_rel_name(gstore_oid));
+	memset(&batch, 0, sizeof(gstoreLoadBatch));
+	if (strcmp(format, "csv") == 0)
+		batch.is_csv = true;
+	else if (strcmp(format, "tsv") == 0 || strcmp(format, "text") == 0)
+		batch.is_csv = false;
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("gstore_fdw: unknown file format \"%s\"", format)));
+
+	/* same lock level with gstoreBeginForeignModify */
+	frel = heap_open(gstore_oid, ShareUpdateExclusiveLock);
+	tupdesc = RelationGetDescr(frel);
+	natts = tupdesc->natts;
+	if (snapshot->curcid > INT_MAX)
+		elog(ERROR, "gstore_fdw: too much sub-transactions");
+	cid = GetCurrentCommandId(true);
+
+	gs_buffer = gstore_fdw_create_buffer(frel, snapshot);
+	if (gs_buffer->read_only)
+		gstore_fdw_make_buffer_writable(frel, gs_buffer, snapshot, true);
+
+	/* setup type input functions */
+	batch.tupdesc = tupdesc;
+	batch.encoding = GetDatabaseEncoding();
+	batch.fast_conv = palloc0(sizeof(bool) * natts);
+	in_functions = palloc0(sizeof(FmgrInfo) * natts);
+	typioparams = palloc0(sizeof(Oid) * natts);
+	for (j=0; j < natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		Oid		infunc;
+
+		if (attr->attisdropped)
+			continue;
+		if (attr->attbyval &&
+			(attr->atttypid == BOOLOID  ||
+			 attr->atttypid == INT2OID   ||
+			 attr->atttypid == INT4OID   ||
+			 attr->atttypid == INT8OID   ||
+			 attr->atttypid == FLOAT4OID ||
+			 attr->atttypid == FLOAT8OID))
+			batch.fast_conv[j] = true;
+		getTypeInputInfo(attr->atttypid, &infunc, &typioparams[j]);
+		fmgr_info(infunc, &in_functions[j]);
+	}
+
+	filp = AllocateFile(filename, PG_BINARY_R);
+	if (!filp)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\" for reading: %m",
+						filename)));
+	/* +1 for the terminator of the last record without newline */
+	buf = palloc_huge(GSTORE_LOAD_BUFSZ + 1);
+	records = palloc(sizeof(char *) * GSTORE_LOAD_MAX_ROWS);
+	batch_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "gstore_fdw load batch",
+									  ALLOCSET_DEFAULT_SIZES);
+	for (;;)
+	{
+		char	  **recs = records;
+		size_t		nrecords;
+
+		CHECK_FOR_INTERRUPTS();
+		offset += gstore_load_split_records(buf + offset, length - offset,
+											batch.is_csv, is_eof,
+											records, &nrecords);
+		if (nrecords == 0)
+		{
+			size_t	nbytes;
+
+			if (is_eof)
+				break;
+			/* move the partial record to the head, then read more */
+			memmove(buf, buf + offset, length - offset);
+			length -= offset;
+			offset = 0;
+			if (length >= GSTORE_LOAD_BUFSZ)
+				ereport(ERROR,
+						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+						 errmsg("gstore_fdw: too long record at record %zu",
+								lineno)));
+			nbytes = fread(buf + length, 1, GSTORE_LOAD_BUFSZ - length, filp);
+			if (ferror(filp))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read from file \"%s\": %m",
+								filename)));
+			length += nbytes;
+			is_eof = (feof(filp) != 0);
+			continue;
+		}
+
+		/* skip the header line */
+		if (header && lineno == 1)
+		{
+			recs++;
+			nrecords--;
+			lineno++;
+			if (nrecords == 0)
+				continue;
+		}
+		oldcxt = MemoryContextSwitchTo(batch_cxt);
+		batch.records = recs;
+		batch.fields = palloc_huge(sizeof(char *) * natts * nrecords);
+		batch.values = palloc_huge(sizeof(Datum) * natts * nrecords);
+		batch.isnull = palloc_huge(sizeof(bool) * natts * nrecords);
+		gstore_load_exec_batch(frel, gs_buffer, &batch, nrecords,
+							   in_functions, typioparams, cid, lineno);
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextReset(batch_cxt);
+		lineno += nrecords;
+		nloaded += nrecords;
+	}
+	FreeFile(filp);
+	MemoryContextDelete(batch_cxt);
+	pfree(buf);
+	pfree(records);
+	heap_close(frel, NoLock);
+
+	PG_RETURN_INT64(nloaded);
+}
+PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_load);
+
 /*
  * pgstrom_startup_gstore_fdw
  */
@@ -2568,6 +4832,26 @@ pgstrom_init_gstore_fdw(void)
 							PGC_POSTMASTER,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.gstore_max_delta_chunks",
+							"maximum number of delta chunks per gstore_fdw relation",
+							NULL,
+							&gstore_max_delta_chunks,
+							8,
+							0,
+							GSTORE_FDW_MAX_DELTAS,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.gstore_load_threads",
+							"number of threads to parse the file loaded by gstore_fdw_load()",
+							NULL,
+							&gstore_load_nthreads,
+							4,
+							1,
+							GSTORE_LOAD_MAX_THREADS,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 	RequestAddinShmemSpace(MAXALIGN(offsetof(GpuStoreHead,
 											gs_chunks[gstore_max_relations])));
 	shmem_startup_next = shmem_startup_hook;
@@ -39,6 +39,45 @@ Datum pgstrom_lo_export_gpu(PG_FUNCTION_ARGS);
 #define fn__lo_lseek64		be_lo_lseek64
 #endif
 
+/*
+ * __lo_get_size - returns length of the opened largeobject, then rewinds
+ * the position to the head.
+ */
+static size_t
+__lo_get_size(int lo_fd)
+{
+	Datum		datum;
+
+	datum = DirectFunctionCall3(fn__lo_lseek64,
+								Int32GetDatum(lo_fd),
+								Int64GetDatum(0),
+								Int32GetDatum(SEEK_END));
+	DirectFunctionCall3(fn__lo_lseek64,
+						Int32GetDatum(lo_fd),
+						Int64GetDatum(0),
+						Int32GetDatum(SEEK_SET));
+	return DatumGetInt64(datum);
+}
+
+/*
+ * __lo_read_fully - reads @length bytes from the current position
+ */
+static void
+__lo_read_fully(int lo_fd, char *buf, size_t length)
+{
+	while (length > 0)
+	{
+		int		nbytes = Min(length, (1U << 30));	/* up to 1GB at once */
+		int		nread;
+
+		nread = lo_read(lo_fd, buf, nbytes);
+		if (nread <= 0)
+			elog(ERROR, "largeobject was truncated during the read");
+		buf += nread;
+		length -= nread;
+	}
+}
+
 /*
  * oid pgstrom_lo_import_gpu(
  *         int    cuda_dindex, -- index of the source GPU device
@@ -50,7 +89,27 @@ Datum pgstrom_lo_export_gpu(PG_FUNCTION_ARGS);
  * This routine imports content of the GPU memory region into new or existing
  * PG largeobject. GPU memory regision is identified with (ipc_handle + offset
  * + length).
+ * The region is read by chunks on the page-locked staging buffers, and DMA
+ * of the next chunk is overlapped with lo_write() of the current one, so we
+ * don't need to have host buffer for the whole region.
  */
+static void
+__lo_import_gpu_callback(const void *data, size_t length, void *cb_private)
+{
+	int			lo_fd = *((int *)cb_private);
+	const char *pos = data;
+
+	while (length > 0)
+	{
+		int		nbytes = Min(length, (1U << 30));	/* up to 1GB at once */
+		int		nwritten;
+
+		nwritten = lo_write(lo_fd, pos, nbytes);
+		pos += nwritten;
+		length -= nwritten;
+	}
+}
+
 Datum
 pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 {
@@ -60,8 +119,6 @@ pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 	int64		length = PG_GETARG_INT64(3);
 	Oid			loid = PG_GETARG_OID(4);
 	int			lo_fd;
-	char	   *hbuffer;
-	char	   *pos;
 	Datum		datum;
 	CUipcMemHandle ipc_mhandle;
 
@@ -74,17 +131,11 @@ pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 			 VARSIZE_ANY_EXHDR(handle), sizeof(CUipcMemHandle));
 	memcpy(&ipc_mhandle, VARDATA_ANY(handle), sizeof(CUipcMemHandle));
 
-	if (offset <= 0)
+	if (offset < 0)
 		elog(ERROR, "wrong offset of GPU memory block: %ld", offset);
 	if (length <= 0)
 		elog(ERROR, "wrong length of GPU memory block: %ld", length);
 
-	hbuffer = MemoryContextAllocHuge(CurrentMemoryContext, length);
-	gpuIpcMemCopyToHost(hbuffer,
-						cuda_dindex,
-						ipc_mhandle,
-						offset,
-						length);
 	/*
 	 * Try to create a new largeobject, if loid is not valid.
 	 * Then, open the largeobject and truncate it if any.
@@ -103,23 +154,17 @@ pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 						Int32GetDatum(lo_fd),
 						Int64GetDatum(0));
 	/*
-	 * Write out the buffer to largeobject
+	 * Write out the GPU memory region to largeobject
 	 */
-	pos = hbuffer;
-	while (length > 0)
-	{
-		int		nbytes = Min(length, (1U << 30));	/* up to 1GB at once */
-		int		nwritten;
-
-		nwritten = lo_write(lo_fd, pos, nbytes);
-		pos += nwritten;
-		length -= nwritten;
-	}
-
+	gpuIpcMemCopyToHostStream(cuda_dindex,
+							  ipc_mhandle,
+							  offset,
+							  length,
+							  __lo_import_gpu_callback,
+							  &lo_fd);
 	/* close the largeobject */
 	DirectFunctionCall1(fn__lo_close,
 						Int32GetDatum(lo_fd));
-	pfree(hbuffer);
 
 	PG_RETURN_OID(loid);
 }
@@ -134,8 +179,39 @@ PG_FUNCTION_INFO_V1(pgstrom_lo_import_gpu);
  *            bigint length)      -- length of the GPU memory block
  *
  * This routine exports content of the PG largeobject to the specified GPU
- * memory region.
+ * memory region. Largeobject is read by chunks, and DMA of the filled
+ * staging buffer is overlapped with lo_read() of the next chunk.
  */
+#define LO_EXPORT_GPU_BUFSZ		(1UL << 20)
+
+typedef struct
+{
+	int			lo_fd;
+	size_t		lo_size;	/* length of the largeobject to be read */
+	size_t		length;		/* length of the GPU memory region */
+} lo_export_gpu_context;
+
+static void
+__lo_export_gpu_callback(GpuIpcMemStream *gstream, void *cb_private)
+{
+	lo_export_gpu_context *con = cb_private;
+	char	   *buf = palloc(LO_EXPORT_GPU_BUFSZ);
+	size_t		lo_offset = 0;
+
+	while (lo_offset < con->lo_size)
+	{
+		size_t	nbytes = Min(con->lo_size - lo_offset, LO_EXPORT_GPU_BUFSZ);
+
+		__lo_read_fully(con->lo_fd, buf, nbytes);
+		gpuIpcMemStreamWrite(gstream, buf, nbytes);
+		lo_offset += nbytes;
+	}
+	/* zero clear the remaining region */
+	if (con->lo_size < con->length)
+		gpuIpcMemStreamWrite(gstream, NULL, con->length - con->lo_size);
+	pfree(buf);
+}
+
 Datum
 pgstrom_lo_export_gpu(PG_FUNCTION_ARGS)
 {
@@ -144,11 +220,10 @@ pgstrom_lo_export_gpu(PG_FUNCTION_ARGS)
 	bytea	   *handle = PG_GETARG_BYTEA_PP(2);
 	int64		offset = PG_GETARG_INT64(3);
 	int64		length = PG_GETARG_INT64(4);
-	int			lo_fd;
 	size_t		lo_size;
-	size_t		lo_offset;
+	size_t		nwritten;
 	Datum		datum;
-	char	   *hbuffer;
+	lo_export_gpu_context con;
 	CUipcMemHandle ipc_mhandle;
 
 	/* sanity checks */
@@ -160,53 +235,137 @@ pgstrom_lo_export_gpu(PG_FUNCTION_ARGS)
 			 VARSIZE_ANY_EXHDR(handle), sizeof(CUipcMemHandle));
 	memcpy(&ipc_mhandle, VARDATA_ANY(handle), sizeof(CUipcMemHandle));
 
-	if (offset <= 0)
+	if (offset < 0)
 		elog(ERROR, "wrong offset of GPU memory block: %ld", offset);
 	if (length <= 0)
 		elog(ERROR, "wrong length of GPU memory block: %ld", length);
-	hbuffer = MemoryContextAllocHuge(CurrentMemoryContext, length);
 
 	/* get length of the largeobject */
+	datum = DirectFunctionCall2(fn__lo_open,
+								ObjectIdGetDatum(loid),
+								Int32GetDatum(INV_READ));
+	con.lo_fd = DatumGetInt32(datum);
+	lo_size = __lo_get_size(con.lo_fd);
+	con.lo_size = Min(lo_size, length);
+	con.length = length;
+
+	/* send to GPU memory chunk */
+	nwritten = gpuIpcMemCopyFromHostStream(cuda_dindex,
+										   ipc_mhandle,
+										   offset,
+										   __lo_export_gpu_callback,
+										   &con);
+	if (nwritten != length)
+		elog(ERROR, "Bug? length of the written region mismatch (%zu of %ld)",
+			 nwritten, length);
+
+	/* release resources */
+	DirectFunctionCall1(fn__lo_close,
+						Int32GetDatum(con.lo_fd));
+
+	PG_RETURN_INT64(con.lo_size);
+}
+PG_FUNCTION_INFO_V1(pgstrom_lo_export_gpu);
+
+/*
+ * pgstrom_lo_load_device
+ *
+ * It loads the contents of largeobject onto the device memory acquired on
+ * the supplied GpuContext, then returns its device pointer. Largeobject is
+ * read into a pair of page-locked staging buffers in turn, and host-to-device
+ * DMA of the one buffer runs while the next portion is read.
+ * PL/CUDA uses this routine for the arguments of #plcuda_largeobject.
+ */
+CUdeviceptr
+pgstrom_lo_load_device(GpuContext *gcontext, Oid loid, size_t *p_length)
+{
+	size_t		unitsz = pgstrom_chunk_size();
+	char	   *hbuffer[2];
+	CUevent		events[2];
+	bool		busy[2] = {false, false};
+	CUdeviceptr	m_deviceptr;
+	size_t		lo_size;
+	size_t		lo_offset;
+	int			lo_fd;
+	int			i, curr;
+	Datum		datum;
+	CUresult	rc;
+
 	datum = DirectFunctionCall2(fn__lo_open,
 								ObjectIdGetDatum(loid),
 								Int32GetDatum(INV_READ));
 	lo_fd = DatumGetInt32(datum);
+	lo_size = __lo_get_size(lo_fd);
 
+	rc = gpuMemAlloc(gcontext, &m_deviceptr, Max(lo_size, 1));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAlloc: %s", errorText(rc));
+	for (i=0; i < 2; i++)
+	{
+		rc = gpuMemAllocHost(gcontext, (void **)&hbuffer[i], unitsz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+	}
 
-	datum = DirectFunctionCall3(fn__lo_lseek64,
-								Int32GetDatum(lo_fd),
-								Int64GetDatum(0),
-								Int32GetDatum(SEEK_END));
-	lo_size = DatumGetInt64(datum);
-	/* rewind to the head, then read the large object */
-	DirectFunctionCall3(fn__lo_lseek64,
-						lo_fd,
-						Int64GetDatum(0),
-						Int32GetDatum(SEEK_SET));
-	lo_offset = 0;
-	while (lo_offset < lo_size)
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	for (i=0; i < 2; i++)
 	{
-		int		nbytes = Min(lo_size - lo_offset, (1U << 30));
-		int		nread;
+		rc = cuEventCreate(&events[i], CU_EVENT_DISABLE_TIMING);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventCreate: %s", errorText(rc));
+	}
+
+	for (lo_offset = 0, curr = 0;
+		 lo_offset < lo_size;
+		 curr = (curr + 1) % 2)
+	{
+		size_t	nbytes = Min(lo_size - lo_offset, unitsz);
+
+		/* wait for completion of the previous DMA from this buffer */
+		if (busy[curr])
+		{
+			rc = cuEventSynchronize(events[curr]);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuEventSynchronize: %s",
+					 errorText(rc));
+			busy[curr] = false;
+		}
+		__lo_read_fully(lo_fd, hbuffer[curr], nbytes);
 
-		nread = lo_read(lo_fd, hbuffer + lo_offset, nbytes);
-		lo_offset += nread;
+		rc = cuMemcpyHtoDAsync(m_deviceptr + lo_offset,
+							   hbuffer[curr],
+							   nbytes,
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+		rc = cuEventRecord(events[curr], CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventRecord: %s", errorText(rc));
+		busy[curr] = true;
+		lo_offset += nbytes;
 	}
-	if (lo_size < length)
-		memset(hbuffer + lo_size, 0, length - lo_size);
+	rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuStreamSynchronize: %s", errorText(rc));
 
-	/* send to GPU memory chunk */
-	gpuIpcMemCopyFromHost(cuda_dindex,
-						  ipc_mhandle,
-						  offset,
-						  hbuffer,
-						  length);
+	for (i=0; i < 2; i++)
+	{
+		rc = cuEventDestroy(events[i]);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuEventDestroy: %s", errorText(rc));
+	}
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
 
 	/* release resources */
+	for (i=0; i < 2; i++)
+		gpuMemFreeHost(gcontext, hbuffer[i]);
 	DirectFunctionCall1(fn__lo_close,
 						Int32GetDatum(lo_fd));
-	pfree(hbuffer);
 
-	PG_RETURN_INT64(lo_size);
+	*p_length = lo_size;
+	return m_deviceptr;
 }
-PG_FUNCTION_INFO_V1(pgstrom_lo_export_gpu);
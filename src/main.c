@@ -25,6 +25,9 @@ PG_MODULE_MAGIC;
 bool		pgstrom_enabled;
 bool		pgstrom_debug_kernel_source;
 bool		pgstrom_cpu_fallback_enabled;
+bool		pgstrom_jit_cpu_fallback;
+int			pgstrom_heapscan_loader_threads;
+bool		pgstrom_bulkexec_enabled;
 static int	pgstrom_chunk_size_kb;
 
 /* cost factors */
@@ -49,6 +52,9 @@ pgstrom_chunk_size(void)
 static void
 pgstrom_init_misc_guc(void)
 {
+	double		default_gpu_dma_cost = 10 * DEFAULT_SEQ_PAGE_COST;
+	double		default_gpu_operator_cost = DEFAULT_CPU_OPERATOR_COST / 16.0;
+
 	/* turn on/off PG-Strom feature */
 	DefineCustomBoolVariable("pg_strom.enabled",
 							 "Enables the planner's use of PG-Strom",
@@ -67,6 +73,24 @@ pgstrom_init_misc_guc(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off CPU fallback while CUDA program is built */
+	DefineCustomBoolVariable("pg_strom.jit_cpu_fallback",
+							 "Enables CPU fallback until GPU kernel gets built",
+							 NULL,
+							 &pgstrom_jit_cpu_fallback,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off bulk execution between GPU nodes */
+	DefineCustomBoolVariable("pg_strom.bulkexec",
+							 "Enables to hand over the results of GPU node to the upper GPU node as-is",
+							 NULL,
+							 &pgstrom_bulkexec_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* turn on/off cuda kernel source saving */
 	DefineCustomBoolVariable("pg_strom.debug_kernel_source",
 							 "Turn on/off to display the kernel source path",
@@ -87,6 +111,21 @@ pgstrom_init_misc_guc(void)
 							PGC_INTERNAL,
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
+	/* number of host threads to load heap tuples onto row-format PDS */
+	DefineCustomIntVariable("pg_strom.heapscan_loader_threads",
+							"number of threads to load tuples onto row-format data store",
+							NULL,
+							&pgstrom_heapscan_loader_threads,
+							4,
+							1,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* adjust the default cost factors according to the installed GPUs */
+	pgstrom_calibrate_gpu_cost(pgstrom_chunk_size(),
+							   &default_gpu_dma_cost,
+							   &default_gpu_operator_cost);
 	/* cost factor for Gpu setup */
 	DefineCustomRealVariable("pg_strom.gpu_setup_cost",
 							 "Cost to setup GPU device to run",
@@ -103,7 +142,7 @@ pgstrom_init_misc_guc(void)
 							 "Cost to send/recv data via DMA",
 							 NULL,
 							 &pgstrom_gpu_dma_cost,
-							 10 * DEFAULT_SEQ_PAGE_COST,
+							 default_gpu_dma_cost,
 							 0,
 							 DBL_MAX,
                              PGC_USERSET,
@@ -114,7 +153,7 @@ pgstrom_init_misc_guc(void)
 							 "Cost of processing each operators by GPU",
 							 NULL,
 							 &pgstrom_gpu_operator_cost,
-							 DEFAULT_CPU_OPERATOR_COST / 16.0,
+							 default_gpu_operator_cost,
 							 0,
 							 DBL_MAX,
 							 PGC_USERSET,
@@ -579,8 +618,8 @@ _PG_init(void)
 	check_nvidia_mps();
 
 	/* init GPU/CUDA infrastracture */
-	pgstrom_init_misc_guc();
 	pgstrom_init_gpu_device();
+	pgstrom_init_misc_guc();
 	pgstrom_init_gpu_mmgr();
 	pgstrom_init_gpu_context();
 	pgstrom_init_cuda_program();
@@ -590,10 +629,13 @@ _PG_init(void)
 	pgstrom_init_gpuscan();
 	pgstrom_init_gpujoin();
 	pgstrom_init_gpupreagg();
+	pgstrom_init_gpusort();
+	pgstrom_init_gpuwinagg();
 
 	/* miscellaneous initializations */
 	pgstrom_init_codegen();
 	pgstrom_init_plcuda();
+	pgstrom_init_matrix();
 	pgstrom_init_ccache();
 	pgstrom_init_gstore_fdw();
 
@@ -22,12 +22,16 @@
 /* function declarations */
 extern Datum array_matrix_accum(PG_FUNCTION_ARGS);
 extern Datum array_matrix_accum_varbit(PG_FUNCTION_ARGS);
+extern Datum array_matrix_combine(PG_FUNCTION_ARGS);
+extern Datum array_matrix_serialize(PG_FUNCTION_ARGS);
+extern Datum array_matrix_deserialize(PG_FUNCTION_ARGS);
 extern Datum varbit_to_int4_array(PG_FUNCTION_ARGS);
 extern Datum int4_array_to_varbit(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_bool(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_int2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_int4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_int8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_final_float2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_float4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_float8(PG_FUNCTION_ARGS);
 extern Datum array_matrix_unnest(PG_FUNCTION_ARGS);
@@ -72,21 +76,29 @@ extern Datum array_matrix_rbind_final_bool(PG_FUNCTION_ARGS);
 extern Datum array_matrix_rbind_final_int2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_rbind_final_int4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_rbind_final_int8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_rbind_final_float2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_rbind_final_float4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_rbind_final_float8(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_accum(PG_FUNCTION_ARGS);
+extern Datum array_matrix_cbind_combine(PG_FUNCTION_ARGS);
+extern Datum array_matrix_cbind_serialize(PG_FUNCTION_ARGS);
+extern Datum array_matrix_cbind_deserialize(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_final_bool(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_final_int2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_final_int4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_final_int8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_cbind_final_float2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_final_float4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_cbind_final_float8(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_bool(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_int2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_int4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_int8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_transpose_float2(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_float4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_float8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_multiply_float4(PG_FUNCTION_ARGS);
+extern Datum array_matrix_multiply_float8(PG_FUNCTION_ARGS);
 extern Datum float4_as_int4(PG_FUNCTION_ARGS);
 extern Datum int4_as_float4(PG_FUNCTION_ARGS);
 extern Datum float8_as_int8(PG_FUNCTION_ARGS);
@@ -110,6 +122,261 @@ extern Datum composite_type_rawsize(PG_FUNCTION_ARGS);
 	DatumGetMatrixTypePCopy(PG_GETARG_DATUM(n))
 #define PG_RETURN_MATRIXTYPE_P(x)		PG_RETURN_POINTER(x)
 
+/*
+ * GPU acceleration of the array-matrix operators
+ *
+ * transpose and matrix multiplication, on the data larger than
+ * pg_strom.matrix_gpu_threshold, are processed by the
+ * GPU kernels in cuda_matrix.h (MATRIX_GPU_OPERATORS). Host buffers are
+ * page-locked during the DMA transfer.
+ */
+static int		matrix_gpu_threshold_kb;	/* GUC */
+
+typedef struct
+{
+	GpuContext *gcontext;
+	ProgramId	program_id;
+	CUmodule	cuda_module;
+} matrix_gpu_state;
+
+/*
+ * matrix_gpu_available - checks whether the GPU operator is worth to run
+ * for the supplied data size.
+ */
+static bool
+matrix_gpu_available(Size length)
+{
+	if (!pgstrom_enabled || numDevAttrs == 0 || matrix_gpu_threshold_kb < 0)
+		return false;
+	return (length >= ((Size)matrix_gpu_threshold_kb << 10));
+}
+
+/*
+ * matrix_gpu_begin - acquire GpuContext and load the GPU operators
+ */
+static void
+matrix_gpu_begin(matrix_gpu_state *mgstate)
+{
+	GpuContext *gcontext;
+	CUresult	rc;
+
+	gcontext = AllocGpuContext(-1, false);
+	ActivateGpuContext(gcontext);
+	mgstate->gcontext = gcontext;
+	mgstate->program_id =
+		pgstrom_create_cuda_program(gcontext,
+									DEVKERNEL_NEEDS_MATRIX,
+									"",
+									"#define MATRIX_GPU_OPERATORS 1\n",
+									true,
+									false);
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	mgstate->cuda_module = pgstrom_load_cuda_program(mgstate->program_id, 0);
+}
+
+/*
+ * matrix_gpu_end - release the resources acquired by matrix_gpu_begin
+ */
+static void
+matrix_gpu_end(matrix_gpu_state *mgstate)
+{
+	CUresult	rc;
+
+	rc = cuModuleUnload(mgstate->cuda_module);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuModuleUnload: %s", errorText(rc));
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	pgstrom_put_cuda_program(mgstate->gcontext, mgstate->program_id);
+	PutGpuContext(mgstate->gcontext);
+}
+
+/*
+ * matrix_gpu_alloc - allocation of device memory
+ */
+static CUdeviceptr
+matrix_gpu_alloc(matrix_gpu_state *mgstate, Size length)
+{
+	CUdeviceptr	m_devptr;
+	CUresult	rc;
+
+	rc = gpuMemAlloc(mgstate->gcontext, &m_devptr, length);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAlloc: %s", errorText(rc));
+	return m_devptr;
+}
+
+/*
+ * matrix_gpu_memcpy - DMA transfer between host buffer and device memory.
+ * The host buffer is page-locked during the transfer, like direct DMA of
+ * PL/CUDA arguments.
+ */
+static void
+matrix_gpu_memcpy(CUdeviceptr m_devptr, void *hbuf, Size length,
+				  bool host_to_device)
+{
+	CUresult	rc;
+	bool		host_registered = false;
+
+	rc = cuMemHostRegister(hbuf, length, 0);
+	if (rc == CUDA_SUCCESS)
+		host_registered = true;
+	else if (rc != CUDA_ERROR_HOST_MEMORY_ALREADY_REGISTERED)
+		elog(DEBUG1, "failed on cuMemHostRegister: %s, uses pageable copy",
+			 errorText(rc));
+
+	if (host_to_device)
+	{
+		rc = cuMemcpyHtoD(m_devptr, hbuf, length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	}
+	else
+	{
+		rc = cuMemcpyDtoH(hbuf, m_devptr, length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	}
+
+	if (host_registered)
+	{
+		rc = cuMemHostUnregister(hbuf);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemHostUnregister: %s", errorText(rc));
+	}
+}
+
+/*
+ * matrix_gpu_launch - launch a GPU operator and wait for its completion.
+ * If block_x is zero, 1D grid/block size is determined by the occupancy
+ * for 'nitems' threads.
+ */
+static void
+matrix_gpu_launch(matrix_gpu_state *mgstate, const char *kfunc_name,
+				  size_t grid_x, size_t grid_y,
+				  size_t block_x, size_t block_y,
+				  size_t nitems, void **kern_args)
+{
+	CUfunction	kern_func;
+	CUresult	rc;
+
+	rc = cuModuleGetFunction(&kern_func, mgstate->cuda_module, kfunc_name);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuModuleGetFunction('%s'): %s",
+			 kfunc_name, errorText(rc));
+	if (block_x == 0)
+	{
+		rc = gpuOptimalBlockSize(&grid_x, &block_x, kern_func,
+								 nitems, 0, 0);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuOptimalBlockSize: %s", errorText(rc));
+		grid_y = block_y = 1;
+	}
+	if (grid_x > INT_MAX || grid_y > USHRT_MAX)
+		elog(ERROR, "matrix is too large to launch %s", kfunc_name);
+
+	rc = cuLaunchKernel(kern_func,
+						grid_x, grid_y, 1,
+						block_x, block_y, 1,
+						0,
+						NULL,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuLaunchKernel(%s): %s",
+			 kfunc_name, errorText(rc));
+	rc = cuCtxSynchronize();
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on GPU operator %s: %s",
+			 kfunc_name, errorText(rc));
+}
+
+/*
+ * matrix_gpu_transpose - dst(width x height) = transpose(src(height x width))
+ *
+ * 'src' and 'dst' are data portion of the host buffers.
+ */
+static void
+matrix_gpu_transpose(char *dst, char *src, int typlen,
+					 cl_uint height, cl_uint width)
+{
+	matrix_gpu_state mgstate;
+	CUdeviceptr	m_src;
+	CUdeviceptr	m_dst;
+	Size		length = (Size)typlen * (Size)height * (Size)width;
+	size_t		ntiles_x = (height + MATRIX_GPU_TILE_SZ - 1) / MATRIX_GPU_TILE_SZ;
+	size_t		ntiles_y = (width + MATRIX_GPU_TILE_SZ - 1) / MATRIX_GPU_TILE_SZ;
+	char		kfunc_name[80];
+	void	   *kern_args[4];
+
+	matrix_gpu_begin(&mgstate);
+	m_src = matrix_gpu_alloc(&mgstate, length);
+	m_dst = matrix_gpu_alloc(&mgstate, length);
+	matrix_gpu_memcpy(m_src, src, length, true);
+
+	snprintf(kfunc_name, sizeof(kfunc_name), "matrixGpuTranspose%d", typlen);
+	kern_args[0] = &m_dst;
+	kern_args[1] = &m_src;
+	kern_args[2] = &height;
+	kern_args[3] = &width;
+	matrix_gpu_launch(&mgstate, kfunc_name,
+					  ntiles_x, Min(ntiles_y, USHRT_MAX),
+					  MATRIX_GPU_TILE_SZ, MATRIX_GPU_TILE_ROWS,
+					  0, kern_args);
+
+	matrix_gpu_memcpy(m_dst, dst, length, false);
+	gpuMemFree(mgstate.gcontext, m_dst);
+	gpuMemFree(mgstate.gcontext, m_src);
+	matrix_gpu_end(&mgstate);
+}
+
+/*
+ * matrix_gpu_gemm - C(m x n) = A(m x k) * B(k x n)
+ */
+static void
+matrix_gpu_gemm(char *C, char *A, char *B, int typlen, const char *suffix,
+				cl_uint m, cl_uint n, cl_uint k)
+{
+	matrix_gpu_state mgstate;
+	CUdeviceptr	m_A;
+	CUdeviceptr	m_B;
+	CUdeviceptr	m_C;
+	Size		A_length = (Size)typlen * (Size)m * (Size)k;
+	Size		B_length = (Size)typlen * (Size)k * (Size)n;
+	Size		C_length = (Size)typlen * (Size)m * (Size)n;
+	char		kfunc_name[80];
+	void	   *kern_args[6];
+
+	matrix_gpu_begin(&mgstate);
+	m_A = matrix_gpu_alloc(&mgstate, A_length);
+	m_B = matrix_gpu_alloc(&mgstate, B_length);
+	m_C = matrix_gpu_alloc(&mgstate, C_length);
+	matrix_gpu_memcpy(m_A, A, A_length, true);
+	matrix_gpu_memcpy(m_B, B, B_length, true);
+
+	snprintf(kfunc_name, sizeof(kfunc_name), "matrixGpuGemm%s", suffix);
+	kern_args[0] = &m_C;
+	kern_args[1] = &m_A;
+	kern_args[2] = &m_B;
+	kern_args[3] = &m;
+	kern_args[4] = &n;
+	kern_args[5] = &k;
+	matrix_gpu_launch(&mgstate, kfunc_name,
+					  (m + MATRIX_GPU_GEMM_SZ - 1) / MATRIX_GPU_GEMM_SZ,
+					  (n + MATRIX_GPU_GEMM_SZ - 1) / MATRIX_GPU_GEMM_SZ,
+					  MATRIX_GPU_GEMM_SZ, MATRIX_GPU_GEMM_SZ,
+					  0, kern_args);
+
+	matrix_gpu_memcpy(m_C, C, C_length, false);
+	gpuMemFree(mgstate.gcontext, m_C);
+	gpuMemFree(mgstate.gcontext, m_B);
+	gpuMemFree(mgstate.gcontext, m_A);
+	matrix_gpu_end(&mgstate);
+}
+
 /*
  * create_empty_matrix
  */
@@ -142,14 +409,210 @@ create_empty_matrix(Oid type_oid, cl_uint width, cl_uint height)
 
 /*
  * Constructor of Matrix-like Array
+ *
+ * The supplied rows are accumulated on a list of column-major chunks, then
+ * the final function copies every column of the chunks onto the result.
+ * The capacity of chunks increases twice from ARRAY_MATRIX_CHUNK_MIN_NROWS
+ * until ARRAY_MATRIX_CHUNK_MAX_SIZE, so the unused space of the aggregation
+ * state is small and no enlargement of the buffer happen. rbind aggregate
+ * also uses the same state.
  */
+#define ARRAY_MATRIX_CHUNK_MIN_NROWS	64
+#define ARRAY_MATRIX_CHUNK_MAX_SIZE		(4UL << 20)		/* 4MB */
+
+typedef struct
+{
+	cl_uint		nrows;		/* number of rows in this chunk */
+	cl_uint		nrooms;		/* capacity of rows in this chunk */
+	cl_uint		width;		/* number of columns in this chunk */
+	char		values[FLEXIBLE_ARRAY_MEMBER];	/* nrooms x width */
+} array_matrix_chunk;
+
 typedef struct
 {
 	Oid			elemtype;	/* element type of the input array */
+	int16		typlen;		/* length of the element type */
 	cl_uint		width;		/* max width of the input vector */
-	List	   *rows;		/* list of the supplied vector */
+	Size		height;		/* total number of the rows */
+	List	   *chunks;		/* list of array_matrix_chunk */
 } array_matrix_state;
 
+static array_matrix_state *
+array_matrix_create_state(Oid elemtype)
+{
+	array_matrix_state *amstate = palloc0(sizeof(array_matrix_state));
+
+	amstate->elemtype = elemtype;
+	amstate->typlen = get_typlen(elemtype);
+	Assert(amstate->typlen == 1 || amstate->typlen == 2 ||
+		   amstate->typlen == 4 || amstate->typlen == 8);
+	return amstate;
+}
+
+/*
+ * array_matrix_get_chunk - returns a chunk to write rows with 'width'
+ * columns at least. Caller must switch the aggregation context.
+ */
+static array_matrix_chunk *
+array_matrix_get_chunk(array_matrix_state *amstate, cl_uint width)
+{
+	array_matrix_chunk *chunk = NULL;
+	Size		unitsz;
+	Size		nrooms;
+
+	if (amstate->chunks != NIL)
+	{
+		chunk = llast(amstate->chunks);
+		if (chunk->nrows < chunk->nrooms && chunk->width >= width)
+			return chunk;
+	}
+	width = Max(width, amstate->width);
+	unitsz = (Size)amstate->typlen * (Size)Max(width, 1);
+	if (!chunk)
+		nrooms = ARRAY_MATRIX_CHUNK_MIN_NROWS;
+	else
+		nrooms = Max(2 * (Size)chunk->nrooms, ARRAY_MATRIX_CHUNK_MIN_NROWS);
+	nrooms = Min(nrooms, Max(ARRAY_MATRIX_CHUNK_MAX_SIZE / unitsz, 1));
+
+	chunk = palloc(offsetof(array_matrix_chunk, values) + unitsz * nrooms);
+	chunk->nrows = 0;
+	chunk->nrooms = nrooms;
+	chunk->width = width;
+	amstate->chunks = lappend(amstate->chunks, chunk);
+
+	return chunk;
+}
+
+/*
+ * array_matrix_append_row - appends a 1D array as a row of the matrix.
+ * NULL elements and the elements out of the lower/upper bounds are zero.
+ */
+static void
+array_matrix_append_row(array_matrix_state *amstate, ArrayType *array)
+{
+	array_matrix_chunk *chunk;
+	int			typlen = amstate->typlen;
+	cl_int		lbound = ARR_LBOUND(array)[0];
+	cl_uint		nitems = ARR_DIMS(array)[0];
+	cl_uint		width;
+	cl_uint		i, offset;
+	bits8	   *nullmap = ARR_NULLBITMAP(array);
+	char	   *src = ARR_DATA_PTR(array);
+	char	   *dst;
+	Size		pitch;
+
+	Assert(ARR_NDIM(array) == 1 && ARR_ELEMTYPE(array) == amstate->elemtype);
+	if (lbound < 1)
+		elog(ERROR, "lower bound of the input array must be positive");
+	offset = lbound - 1;
+	width = offset + nitems;
+
+	chunk = array_matrix_get_chunk(amstate, width);
+	pitch = (Size)typlen * (Size)chunk->nrooms;
+	dst = chunk->values + typlen * chunk->nrows;
+	for (i=0; i < offset; i++, dst += pitch)
+		memset(dst, 0, typlen);
+	for (i=0; i < nitems; i++, dst += pitch)
+	{
+		/* elements of fixed-length types are packed without padding */
+		if (nullmap && (nullmap[i / BITS_PER_BYTE] &
+						(1 << (i % BITS_PER_BYTE))) == 0)
+			memset(dst, 0, typlen);
+		else
+		{
+			memcpy(dst, src, typlen);
+			src += typlen;
+		}
+	}
+	for (i = width; i < chunk->width; i++, dst += pitch)
+		memset(dst, 0, typlen);
+	chunk->nrows++;
+
+	amstate->width = Max(amstate->width, width);
+	amstate->height++;
+}
+
+/*
+ * array_matrix_append_block - appends all the rows of the matrix
+ */
+static void
+array_matrix_append_block(array_matrix_state *amstate, MatrixType *X)
+{
+	array_matrix_chunk *chunk;
+	int			typlen = amstate->typlen;
+	cl_uint		x_height = ARRAY_MATRIX_HEIGHT(X);
+	cl_uint		x_width = ARRAY_MATRIX_WIDTH(X);
+	cl_uint		row_index = 0;
+	cl_uint		i, nrows;
+	char	   *src, *dst;
+
+	Assert(ARRAY_MATRIX_ELEMTYPE(X) == amstate->elemtype);
+	while (row_index < x_height)
+	{
+		chunk = array_matrix_get_chunk(amstate, x_width);
+		nrows = Min(chunk->nrooms - chunk->nrows, x_height - row_index);
+		src = ARRAY_MATRIX_DATAPTR(X) + typlen * row_index;
+		dst = chunk->values + typlen * chunk->nrows;
+		for (i=0; i < chunk->width; i++)
+		{
+			if (i < x_width)
+				memcpy(dst, src, typlen * nrows);
+			else
+				memset(dst, 0, typlen * nrows);
+			src += (Size)typlen * (Size)x_height;
+			dst += (Size)typlen * (Size)chunk->nrooms;
+		}
+		chunk->nrows += nrows;
+		row_index += nrows;
+	}
+	amstate->width = Max(amstate->width, x_width);
+	amstate->height += x_height;
+}
+
+/*
+ * array_matrix_final - constructs a matrix from the chunks
+ */
+static MatrixType *
+array_matrix_final(array_matrix_state *amstate)
+{
+	MatrixType *R;
+	int			typlen = amstate->typlen;
+	Size		height = amstate->height;
+	Size		width = amstate->width;
+	Size		length;
+	Size		row_index = 0;
+	Size		i;
+	char	   *src, *dst;
+	ListCell   *lc;
+
+	length = ARRAY_MATRIX_RAWSIZE(typlen, height, width);
+	if (!AllocSizeIsValid(length))
+		elog(ERROR, "supplied array-matrix is too big");
+	R = palloc(length);
+	INIT_ARRAY_MATRIX(R, amstate->elemtype, typlen, height, width);
+
+	foreach (lc, amstate->chunks)
+	{
+		array_matrix_chunk *chunk = lfirst(lc);
+
+		src = chunk->values;
+		dst = ARRAY_MATRIX_DATAPTR(R) + typlen * row_index;
+		for (i=0; i < width; i++)
+		{
+			if (i < chunk->width)
+				memcpy(dst, src, typlen * chunk->nrows);
+			else
+				memset(dst, 0, typlen * chunk->nrows);
+			src += (Size)typlen * (Size)chunk->nrooms;
+			dst += typlen * height;
+		}
+		row_index += chunk->nrows;
+	}
+	Assert(row_index == height);
+
+	return R;
+}
+
 Datum
 array_matrix_accum(PG_FUNCTION_ARGS)
 {
@@ -157,16 +620,13 @@ array_matrix_accum(PG_FUNCTION_ARGS)
 	MemoryContext	aggcxt;
 	MemoryContext	oldcxt;
 	ArrayType	   *array;
-	cl_uint			width;
 
 	if (!AggCheckCallContext(fcinfo, &aggcxt))
 		elog(ERROR, "aggregate function called in non-aggregate context");
 
 	if (PG_ARGISNULL(1))
 		elog(ERROR, "null-array was supplied");
-
-	oldcxt = MemoryContextSwitchTo(aggcxt);
-	array = PG_GETARG_ARRAYTYPE_P_COPY(1);
+	array = PG_GETARG_ARRAYTYPE_P(1);
 
 	/* sanity check */
 	if (ARR_NDIM(array) != 1)
@@ -176,28 +636,118 @@ array_matrix_accum(PG_FUNCTION_ARGS)
 		ARR_ELEMTYPE(array) != INT4OID &&
 		ARR_ELEMTYPE(array) != INT8OID &&
 		ARR_ELEMTYPE(array) != FLOAT4OID &&
-		ARR_ELEMTYPE(array) != FLOAT8OID)
+		ARR_ELEMTYPE(array) != FLOAT8OID &&
+		ARR_ELEMTYPE(array) != FLOAT2OID)
 		elog(ERROR, "unsupported element type: %s",
 			 format_type_be(ARR_ELEMTYPE(array)));
 
-	width = ARR_LBOUND(array)[0] + ARR_DIMS(array)[0] - 1;
-
+	oldcxt = MemoryContextSwitchTo(aggcxt);
 	if (PG_ARGISNULL(0))
-	{
-		amstate = palloc0(sizeof(array_matrix_state));
-		amstate->elemtype = array->elemtype;
-	}
+		amstate = array_matrix_create_state(ARR_ELEMTYPE(array));
 	else
 		amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	array_matrix_append_row(amstate, array);
+	MemoryContextSwitchTo(oldcxt);
 
-	amstate->width = Max(amstate->width, width);
-	amstate->rows = lappend(amstate->rows, array);
+	PG_RETURN_POINTER(amstate);
+}
+PG_FUNCTION_INFO_V1(array_matrix_accum);
+
+/*
+ * Support routines of parallel aggregation; the partial state is
+ * serialized as a matrix, so the order of rows across the workers is
+ * not defined.  These are also used by rbind aggregate.
+ */
+Datum
+array_matrix_combine(PG_FUNCTION_ARGS)
+{
+	array_matrix_state *amstate1;
+	array_matrix_state *amstate2;
+	MemoryContext	aggcxt;
+	MemoryContext	oldcxt;
+	ListCell	   *lc;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+	amstate2 = (array_matrix_state *)PG_GETARG_POINTER(1);
+
+	oldcxt = MemoryContextSwitchTo(aggcxt);
+	if (PG_ARGISNULL(0))
+		amstate1 = array_matrix_create_state(amstate2->elemtype);
+	else
+	{
+		amstate1 = (array_matrix_state *)PG_GETARG_POINTER(0);
+		if (amstate1->elemtype != amstate2->elemtype)
+			elog(ERROR, "element type of partial state mismatch '%s' for '%s'",
+				 format_type_be(amstate2->elemtype),
+				 format_type_be(amstate1->elemtype));
+	}
+	/* state2 may be on the per-tuple memory, so chunks are copied */
+	foreach (lc, amstate2->chunks)
+	{
+		array_matrix_chunk *chunk = lfirst(lc);
+		array_matrix_chunk *copy;
+		int			typlen = amstate2->typlen;
+		cl_uint		i;
 
+		if (chunk->nrows == 0)
+			continue;
+		copy = palloc(offsetof(array_matrix_chunk, values) +
+					  (Size)typlen * (Size)chunk->nrows *
+					  (Size)Max(chunk->width, 1));
+		copy->nrows = chunk->nrows;
+		copy->nrooms = chunk->nrows;
+		copy->width = chunk->width;
+		for (i=0; i < chunk->width; i++)
+		{
+			memcpy(copy->values + (Size)typlen * (Size)copy->nrooms * i,
+				   chunk->values + (Size)typlen * (Size)chunk->nrooms * i,
+				   typlen * chunk->nrows);
+		}
+		amstate1->chunks = lappend(amstate1->chunks, copy);
+	}
+	amstate1->width = Max(amstate1->width, amstate2->width);
+	amstate1->height += amstate2->height;
 	MemoryContextSwitchTo(oldcxt);
 
+	PG_RETURN_POINTER(amstate1);
+}
+PG_FUNCTION_INFO_V1(array_matrix_combine);
+
+Datum
+array_matrix_serialize(PG_FUNCTION_ARGS)
+{
+	array_matrix_state *amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	PG_RETURN_MATRIXTYPE_P(array_matrix_final(amstate));
+}
+PG_FUNCTION_INFO_V1(array_matrix_serialize);
+
+Datum
+array_matrix_deserialize(PG_FUNCTION_ARGS)
+{
+	MatrixType *X = PG_GETARG_MATRIXTYPE_P(0);
+	array_matrix_state *amstate;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	/* width may be zero if all the supplied varbit were NULL */
+	if (!VARATT_IS_4B(X) || X->ndim != 2 || X->dataoffset != 0)
+		elog(ERROR, "partial state is not a valid matrix-like array");
+	amstate = array_matrix_create_state(ARRAY_MATRIX_ELEMTYPE(X));
+	array_matrix_append_block(amstate, X);
+
 	PG_RETURN_POINTER(amstate);
 }
-PG_FUNCTION_INFO_V1(array_matrix_accum);
+PG_FUNCTION_INFO_V1(array_matrix_deserialize);
 
 static MatrixType *
 __varbit_to_int_vector(VarBit *varbit)
@@ -281,98 +831,34 @@ array_matrix_accum_varbit(PG_FUNCTION_ARGS)
 	if (!AggCheckCallContext(fcinfo, &aggcxt))
 		elog(ERROR, "aggregate function called in non-aggregate context");
 
-	oldcxt = MemoryContextSwitchTo(aggcxt);
 	if (!PG_ARGISNULL(1))
 		varbit = PG_GETARG_VARBIT_P(1);
 	matrix = __varbit_to_int_vector(varbit);
 
+	oldcxt = MemoryContextSwitchTo(aggcxt);
 	if (PG_ARGISNULL(0))
-	{
-		amstate = palloc0(sizeof(array_matrix_state));
-		amstate->elemtype = INT4OID;
-	}
+		amstate = array_matrix_create_state(INT4OID);
 	else
 		amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
-
-	amstate->width = Max(amstate->width, ARRAY_MATRIX_HEIGHT(matrix));
-	amstate->rows = lappend(amstate->rows, matrix);
-
+	/* int4 vector has compatible layout with 1D ArrayType */
+	array_matrix_append_row(amstate, (ArrayType *)matrix);
 	MemoryContextSwitchTo(oldcxt);
+	pfree(matrix);
 
 	PG_RETURN_POINTER(amstate);
 }
 PG_FUNCTION_INFO_V1(array_matrix_accum_varbit);
 
-#define ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,BASETYPE)					\
-	do {																\
-		Size		width = (amstate)->width;							\
-		Size		height = list_length((amstate)->rows);				\
-		Size		length;												\
-		Size		row_index;											\
-		int16		typlen;												\
-		bool		typbyval;											\
-		char		typalign;											\
-		ListCell   *lc;													\
-																		\
-		get_typlenbyvalalign((amstate)->elemtype,						\
-							 &typlen, &typbyval, &typalign);			\
-		Assert(typlen == sizeof(BASETYPE));								\
-		length = ARRAY_MATRIX_RAWSIZE(typlen, height, width);			\
-		if (!AllocSizeIsValid(length))									\
-			elog(ERROR, "supplied array-matrix is too big");			\
-		R = palloc(length);												\
-		INIT_ARRAY_MATRIX(R, (amstate)->elemtype, typlen, height, width); \
-																		\
-		row_index = 0;													\
-		foreach (lc, (amstate)->rows)									\
-		{																\
-			ArrayType  *array = lfirst(lc);								\
-			Size		offset = ARR_LBOUND(array)[0] - 1;				\
-			Size		i, nitems = ARR_DIMS(array)[0];					\
-			BASETYPE   *dest;											\
-			array_iter	iter;											\
-			Datum		datum;											\
-			Datum		mask;											\
-			bool		isnull;											\
-																		\
-			/* sanity checks */											\
-			Assert(ARR_ELEMTYPE(array) == (amstate)->elemtype &&		\
-				   ARR_NDIM(array) == 1);								\
-			dest = ((BASETYPE *)ARRAY_MATRIX_DATAPTR(R)) + row_index;	\
-			mask = (sizeof(BASETYPE) < sizeof(Datum)					\
-					? ((1UL << (sizeof(BASETYPE) * 8)) - 1)				\
-					: ~0UL);											\
-			for (i=0; i < offset; i++, dest += height)					\
-				*dest = 0;												\
-			array_iter_setup(&iter, (AnyArrayType *)array);				\
-			for (i=0; i < nitems; i++, dest += height)					\
-			{															\
-				datum = array_iter_next(&iter, &isnull, i,				\
-										typlen, typbyval, typalign);	\
-				if (isnull)												\
-					datum = 0;											\
-				*dest = (BASETYPE)(datum & mask);						\
-			}															\
-																		\
-			for (i = offset + nitems; i < width; i++, dest += height)	\
-				*dest = 0;												\
-																		\
-			row_index++;												\
-		}																\
-	} while(0)
-
 Datum
 array_matrix_final_bool(PG_FUNCTION_ARGS)
 {
 	array_matrix_state *amstate;
-	MatrixType *R;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
 	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
 	Assert(amstate->elemtype == BOOLOID);
-	ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,cl_uchar);
-	PG_RETURN_POINTER(R);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_final_bool);
 
@@ -380,14 +866,12 @@ Datum
 array_matrix_final_int2(PG_FUNCTION_ARGS)
 {
 	array_matrix_state *amstate;
-	MatrixType *R;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
 	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
 	Assert(amstate->elemtype == INT2OID);
-	ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,cl_ushort);
-	PG_RETURN_POINTER(R);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_final_int2);
 
@@ -395,14 +879,12 @@ Datum
 array_matrix_final_int4(PG_FUNCTION_ARGS)
 {
 	array_matrix_state *amstate;
-	MatrixType *R;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
 	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
 	Assert(amstate->elemtype == INT4OID);
-	ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,cl_uint);
-	PG_RETURN_POINTER(R);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_final_int4);
 
@@ -410,29 +892,38 @@ Datum
 array_matrix_final_int8(PG_FUNCTION_ARGS)
 {
 	array_matrix_state *amstate;
-	MatrixType *R;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
 	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
 	Assert(amstate->elemtype == INT8OID);
-	ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,cl_ulong);
-	PG_RETURN_POINTER(R);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_final_int8);
 
+Datum
+array_matrix_final_float2(PG_FUNCTION_ARGS)
+{
+	array_matrix_state *amstate;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == FLOAT2OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
+}
+PG_FUNCTION_INFO_V1(array_matrix_final_float2);
+
 Datum
 array_matrix_final_float4(PG_FUNCTION_ARGS)
 {
 	array_matrix_state *amstate;
-	MatrixType *R;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
 	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
 	Assert(amstate->elemtype == FLOAT4OID);
-	ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,cl_uint);
-	PG_RETURN_POINTER(R);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_final_float4);
 
@@ -440,14 +931,12 @@ Datum
 array_matrix_final_float8(PG_FUNCTION_ARGS)
 {
 	array_matrix_state *amstate;
-	MatrixType *R;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
 	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
 	Assert(amstate->elemtype == FLOAT8OID);
-	ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,cl_ulong);
-	PG_RETURN_POINTER(R);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_final_float8);
 
@@ -486,8 +975,12 @@ array_matrix_rawsize(PG_FUNCTION_ARGS)
 			typlen = get_typlen(elemtype);
 			break;
 		default:
-			elog(ERROR, "unable to make array-matrix with '%s' type",
-				 format_type_be(elemtype));
+			/* float2 is not a built-in type */
+			if (elemtype != FLOAT2OID)
+				elog(ERROR, "unable to make array-matrix with '%s' type",
+					 format_type_be(elemtype));
+			typlen = sizeof(cl_ushort);
+			break;
 	}
 	PG_RETURN_INT64(ARRAY_CUBE_RAWSIZE(typlen, depth, height, width));
 }
@@ -1322,19 +1815,14 @@ PG_FUNCTION_INFO_V1(array_matrix_cbind_scalar_float8r);
 
 /*
  * rbind as aggregate function
+ *
+ * It shares the aggregation state with array_matrix, but rows are
+ * supplied by the blocks of matrix.
  */
-typedef struct
-{
-	Oid		elemtype;
-	Size	width;
-	Size	height;
-	List   *matrix_list;
-} matrix_rbind_state;
-
 Datum
 array_matrix_rbind_accum(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 	MemoryContext	aggcxt;
 	MemoryContext	oldcxt;
 	MatrixType	   *X;
@@ -1345,173 +1833,116 @@ array_matrix_rbind_accum(PG_FUNCTION_ARGS)
 	if (PG_ARGISNULL(1))
 		elog(ERROR, "null-array was supplied");
 
-	oldcxt = MemoryContextSwitchTo(aggcxt);
-    X = PG_GETARG_MATRIXTYPE_P_COPY(1);
+	X = PG_GETARG_MATRIXTYPE_P(1);
 	if (!VALIDATE_ARRAY_MATRIX(X))
 		elog(ERROR, "input array is not a valid matrix-like array");
 
+	oldcxt = MemoryContextSwitchTo(aggcxt);
 	if (PG_ARGISNULL(0))
-	{
-		mrstate = palloc0(sizeof(matrix_rbind_state));
-		mrstate->elemtype = ARRAY_MATRIX_ELEMTYPE(X);
-	}
+		amstate = array_matrix_create_state(ARRAY_MATRIX_ELEMTYPE(X));
 	else
 	{
-		mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-		if (mrstate->elemtype != ARRAY_MATRIX_ELEMTYPE(X))
+		amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+		if (amstate->elemtype != ARRAY_MATRIX_ELEMTYPE(X))
 			elog(ERROR, "element type of input array mismatch '%s' for '%s'",
 				 format_type_be(ARRAY_MATRIX_ELEMTYPE(X)),
-				 format_type_be(mrstate->elemtype));
+				 format_type_be(amstate->elemtype));
 	}
-
-	mrstate->width = Max(mrstate->width, ARRAY_MATRIX_WIDTH(X));
-	mrstate->height += ARRAY_MATRIX_HEIGHT(X);
-	mrstate->matrix_list = lappend(mrstate->matrix_list, X);
-
+	array_matrix_append_block(amstate, X);
 	MemoryContextSwitchTo(oldcxt);
 
-	PG_RETURN_POINTER(mrstate);
+	PG_RETURN_POINTER(amstate);
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_accum);
 
-static MatrixType *
-array_matrix_rbind_final(matrix_rbind_state *mrstate)
-{
-	MatrixType *R;
-	int			typlen;
-	Size		height = mrstate->height;
-	Size		width = mrstate->width;
-	Size		length;
-	Size		row_index;
-	char	   *src, *dst;
-	ListCell   *lc;
-
-	switch (mrstate->elemtype)
-	{
-		case BOOLOID:
-			typlen = sizeof(cl_char);
-			break;
-		case INT2OID:
-			typlen = sizeof(cl_short);
-			break;
-		case INT4OID:
-		case FLOAT4OID:
-			typlen = sizeof(cl_int);
-			break;
-		case INT8OID:
-		case FLOAT8OID:
-			typlen = sizeof(cl_long);
-			break;
-		default:
-			elog(ERROR, "unsupported element type: %s",
-				 format_type_be(mrstate->elemtype));
-	}
-	length = ARRAY_MATRIX_RAWSIZE(typlen, height, width);
-	if (!AllocSizeIsValid(length))
-		elog(ERROR, "supplied array-matrix is too big");
-	R = palloc(length);
-	INIT_ARRAY_MATRIX(R, mrstate->elemtype, typlen, height, width);
-
-	row_index = 0;
-	foreach (lc, mrstate->matrix_list)
-	{
-		MatrixType *X = lfirst(lc);
-		cl_int		x_width = ARRAY_MATRIX_WIDTH(X);
-		cl_int		x_height = ARRAY_MATRIX_HEIGHT(X);
-		cl_int		i;
-
-		Assert(VALIDATE_ARRAY_MATRIX(X));
-		src = ARRAY_MATRIX_DATAPTR(X);
-		dst = ARRAY_MATRIX_DATAPTR(R) + typlen * row_index;
-		for (i=0; i < width; i++)
-		{
-			if (i < x_width)
-				memcpy(dst, src, typlen * x_height);
-			else
-				memset(dst, 0, typlen * x_height);
-			src += typlen * x_height;
-			dst += typlen * height;
-		}
-		row_index += x_height;
-	}
-	return R;
-}
-
 Datum
 array_matrix_rbind_final_bool(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
-	mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-	Assert(mrstate->elemtype == BOOLOID);
-	PG_RETURN_POINTER(array_matrix_rbind_final(mrstate));
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == BOOLOID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_final_bool);
 
 Datum
 array_matrix_rbind_final_int2(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
-	mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-	Assert(mrstate->elemtype == INT2OID);
-	PG_RETURN_POINTER(array_matrix_rbind_final(mrstate));
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == INT2OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_final_int2);
 
 Datum
 array_matrix_rbind_final_int4(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
-	mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-	Assert(mrstate->elemtype == INT4OID);
-	PG_RETURN_POINTER(array_matrix_rbind_final(mrstate));
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == INT4OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_final_int4);
 
 Datum
 array_matrix_rbind_final_int8(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
-	mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-	Assert(mrstate->elemtype == INT8OID);
-	PG_RETURN_POINTER(array_matrix_rbind_final(mrstate));
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == INT8OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_final_int8);
 
+Datum
+array_matrix_rbind_final_float2(PG_FUNCTION_ARGS)
+{
+	array_matrix_state *amstate;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == FLOAT2OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
+}
+PG_FUNCTION_INFO_V1(array_matrix_rbind_final_float2);
+
 Datum
 array_matrix_rbind_final_float4(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
-	mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-	Assert(mrstate->elemtype == FLOAT4OID);
-	PG_RETURN_POINTER(array_matrix_rbind_final(mrstate));
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == FLOAT4OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_final_float4);
 
 Datum
 array_matrix_rbind_final_float8(PG_FUNCTION_ARGS)
 {
-	matrix_rbind_state *mrstate;
+	array_matrix_state *amstate;
 
 	if (PG_ARGISNULL(0))
 		PG_RETURN_NULL();
-	mrstate = (matrix_rbind_state *)PG_GETARG_POINTER(0);
-	Assert(mrstate->elemtype == FLOAT8OID);
-	PG_RETURN_POINTER(array_matrix_rbind_final(mrstate));
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+	Assert(amstate->elemtype == FLOAT8OID);
+	PG_RETURN_POINTER(array_matrix_final(amstate));
 }
 PG_FUNCTION_INFO_V1(array_matrix_rbind_final_float8);
 
@@ -1579,26 +2010,7 @@ array_matrix_cbind_final(matrix_cbind_state *mcstate)
 	ListCell   *lc;
 	char	   *src, *dst;
 
-	switch (mcstate->elemtype)
-	{
-		case BOOLOID:
-			typlen = sizeof(cl_char);
-			break;
-		case INT2OID:
-			typlen = sizeof(cl_short);
-			break;
-		case INT4OID:
-		case FLOAT4OID:
-			typlen = sizeof(cl_int);
-			break;
-		case INT8OID:
-		case FLOAT8OID:
-			typlen = sizeof(cl_long);
-			break;
-		default:
-			elog(ERROR, "unsupported element type: %s",
-				 format_type_be(mcstate->elemtype));
-    }
+	typlen = get_typlen(mcstate->elemtype);
 	length = ARRAY_MATRIX_RAWSIZE(typlen, height, width);
 	if (!AllocSizeIsValid(length))
 		elog(ERROR, "supplied array-matrix is too big");
@@ -1615,6 +2027,13 @@ array_matrix_cbind_final(matrix_cbind_state *mcstate)
 
 		Assert(VALIDATE_ARRAY_MATRIX(X));
 		src = ARRAY_MATRIX_DATAPTR(X);
+		/* columns are already contiguous, if same height */
+		if (x_height == height)
+		{
+			memcpy(dst, src, typlen * x_height * x_width);
+			dst += typlen * height * x_width;
+			continue;
+		}
 		for (i=0; i < x_width; i++)
 		{
 			memcpy(dst, src, typlen * x_height);
@@ -1628,6 +2047,92 @@ array_matrix_cbind_final(matrix_cbind_state *mcstate)
 	return R;
 }
 
+/*
+ * Support routines of parallel aggregation; the partial state is
+ * serialized as a matrix, so the order of columns across the workers is
+ * not defined.
+ */
+Datum
+array_matrix_cbind_combine(PG_FUNCTION_ARGS)
+{
+	matrix_cbind_state *mcstate1;
+	matrix_cbind_state *mcstate2;
+	MemoryContext	aggcxt;
+	MemoryContext	oldcxt;
+	ListCell	   *lc;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+	mcstate2 = (matrix_cbind_state *)PG_GETARG_POINTER(1);
+
+	oldcxt = MemoryContextSwitchTo(aggcxt);
+	if (PG_ARGISNULL(0))
+	{
+		mcstate1 = palloc0(sizeof(matrix_cbind_state));
+		mcstate1->elemtype = mcstate2->elemtype;
+	}
+	else
+	{
+		mcstate1 = (matrix_cbind_state *)PG_GETARG_POINTER(0);
+		if (mcstate1->elemtype != mcstate2->elemtype)
+			elog(ERROR, "element type of partial state mismatch '%s' for '%s'",
+				 format_type_be(mcstate2->elemtype),
+				 format_type_be(mcstate1->elemtype));
+	}
+	/* state2 may be on the per-tuple memory, so matrices are copied */
+	foreach (lc, mcstate2->matrix_list)
+	{
+		MatrixType *X = lfirst(lc);
+		MatrixType *copy = palloc(VARSIZE(X));
+
+		memcpy(copy, X, VARSIZE(X));
+		mcstate1->matrix_list = lappend(mcstate1->matrix_list, copy);
+	}
+	mcstate1->width += mcstate2->width;
+	mcstate1->height = Max(mcstate1->height, mcstate2->height);
+	MemoryContextSwitchTo(oldcxt);
+
+	PG_RETURN_POINTER(mcstate1);
+}
+PG_FUNCTION_INFO_V1(array_matrix_cbind_combine);
+
+Datum
+array_matrix_cbind_serialize(PG_FUNCTION_ARGS)
+{
+	matrix_cbind_state *mcstate = (matrix_cbind_state *)PG_GETARG_POINTER(0);
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	PG_RETURN_MATRIXTYPE_P(array_matrix_cbind_final(mcstate));
+}
+PG_FUNCTION_INFO_V1(array_matrix_cbind_serialize);
+
+Datum
+array_matrix_cbind_deserialize(PG_FUNCTION_ARGS)
+{
+	MatrixType *X = PG_GETARG_MATRIXTYPE_P(0);
+	matrix_cbind_state *mcstate;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (!VALIDATE_ARRAY_MATRIX(X))
+		elog(ERROR, "partial state is not a valid matrix-like array");
+	mcstate = palloc0(sizeof(matrix_cbind_state));
+	mcstate->elemtype = ARRAY_MATRIX_ELEMTYPE(X);
+	mcstate->width = ARRAY_MATRIX_WIDTH(X);
+	mcstate->height = ARRAY_MATRIX_HEIGHT(X);
+	mcstate->matrix_list = list_make1(X);
+
+	PG_RETURN_POINTER(mcstate);
+}
+PG_FUNCTION_INFO_V1(array_matrix_cbind_deserialize);
+
 Datum
 array_matrix_cbind_final_bool(PG_FUNCTION_ARGS)
 {
@@ -1680,6 +2185,19 @@ array_matrix_cbind_final_int8(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(array_matrix_cbind_final_int8);
 
+Datum
+array_matrix_cbind_final_float2(PG_FUNCTION_ARGS)
+{
+	matrix_cbind_state *mcstate;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	mcstate = (matrix_cbind_state *)PG_GETARG_POINTER(0);
+	Assert(mcstate->elemtype == FLOAT2OID);
+	PG_RETURN_POINTER(array_matrix_cbind_final(mcstate));
+}
+PG_FUNCTION_INFO_V1(array_matrix_cbind_final_float2);
+
 Datum
 array_matrix_cbind_final_float4(PG_FUNCTION_ARGS)
 {
@@ -1725,6 +2243,12 @@ PG_FUNCTION_INFO_V1(array_matrix_cbind_final_float8);
 		INIT_ARRAY_MATRIX(T, ARRAY_MATRIX_ELEMTYPE(M),					\
 						  sizeof(BASETYPE), width, height);				\
 		T_values = ARRAY_MATRIX_DATAPTR(T);								\
+		if (matrix_gpu_available(length))								\
+		{																\
+			matrix_gpu_transpose(T_values, M_values, sizeof(BASETYPE),	\
+								 height, width);						\
+			break;														\
+		}																\
 		for (i=0; i < nitems; i++)										\
 		{																\
 			*((BASETYPE *)(T_values + sizeof(BASETYPE) *				\
@@ -1773,7 +2297,7 @@ array_matrix_transpose_int4(PG_FUNCTION_ARGS)
 		!VALIDATE_ARRAY_MATRIX(matrix))
 		elog(ERROR, "Array is not like Matrix");
 	Assert(matrix->elemtype == INT4OID);
-	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ushort);
+	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_uint);
 	PG_RETURN_POINTER(result);
 }
 PG_FUNCTION_INFO_V1(array_matrix_transpose_int4);
@@ -1788,11 +2312,26 @@ array_matrix_transpose_int8(PG_FUNCTION_ARGS)
 		!VALIDATE_ARRAY_MATRIX(matrix))
 		elog(ERROR, "Array is not like Matrix");
 	Assert(matrix->elemtype == INT8OID);
-	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ushort);
+	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ulong);
 	PG_RETURN_POINTER(result);
 }
 PG_FUNCTION_INFO_V1(array_matrix_transpose_int8);
 
+Datum
+array_matrix_transpose_float2(PG_FUNCTION_ARGS)
+{
+	MatrixType *matrix = PG_GETARG_MATRIXTYPE_P(0);
+	MatrixType *result;
+
+	if (VARATT_IS_EXPANDED_HEADER(matrix) ||
+		!VALIDATE_ARRAY_MATRIX(matrix))
+		elog(ERROR, "Array is not like Matrix");
+	Assert(matrix->elemtype == FLOAT2OID);
+	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ushort);
+	PG_RETURN_POINTER(result);
+}
+PG_FUNCTION_INFO_V1(array_matrix_transpose_float2);
+
 Datum
 array_matrix_transpose_float4(PG_FUNCTION_ARGS)
 {
@@ -1803,7 +2342,7 @@ array_matrix_transpose_float4(PG_FUNCTION_ARGS)
 		!VALIDATE_ARRAY_MATRIX(matrix))
 		elog(ERROR, "Array is not like Matrix");
 	Assert(matrix->elemtype == FLOAT4OID);
-	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ushort);
+	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_uint);
 	PG_RETURN_POINTER(result);
 }
 PG_FUNCTION_INFO_V1(array_matrix_transpose_float4);
@@ -1818,11 +2357,89 @@ array_matrix_transpose_float8(PG_FUNCTION_ARGS)
 		!VALIDATE_ARRAY_MATRIX(matrix))
 		elog(ERROR, "Array is not like Matrix");
 	Assert(matrix->elemtype == FLOAT8OID);
-	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ushort);
+	ARRAY_MATRIX_TRANSPOSE_TEMPLATE(result,matrix,cl_ulong);
 	PG_RETURN_POINTER(result);
 }
 PG_FUNCTION_INFO_V1(array_matrix_transpose_float8);
 
+/*
+ * matrix_multiply - C(m x n) = A(m x k) * B(k x n)
+ */
+#define ARRAY_MATRIX_MULTIPLY_TEMPLATE(C,A,B,BASETYPE,SUFFIX)			\
+	do {																\
+		Size		m = ARRAY_MATRIX_HEIGHT(A);							\
+		Size		k = ARRAY_MATRIX_WIDTH(A);							\
+		Size		n = ARRAY_MATRIX_WIDTH(B);							\
+		Size		length;												\
+		BASETYPE   *A_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(A);		\
+		BASETYPE   *B_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(B);		\
+		BASETYPE   *C_values;											\
+		Size		i, j, l;											\
+																		\
+		if (ARRAY_MATRIX_HEIGHT(B) != k)								\
+			elog(ERROR, "matrix size mismatch: (%zu x %zu) * (%d x %zu)", \
+				 m, k, ARRAY_MATRIX_HEIGHT(B), n);						\
+		length = ARRAY_MATRIX_RAWSIZE(sizeof(BASETYPE), m, n);			\
+		if (!AllocSizeIsValid(length))									\
+			elog(ERROR, "matrix array size too large");					\
+		C = palloc(length);												\
+		INIT_ARRAY_MATRIX(C, ARRAY_MATRIX_ELEMTYPE(A),					\
+						  sizeof(BASETYPE), m, n);						\
+		C_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(C);					\
+		if (matrix_gpu_available(sizeof(BASETYPE) * m * n * k) &&		\
+			m <= UINT_MAX && n <= UINT_MAX && k <= UINT_MAX)			\
+		{																\
+			matrix_gpu_gemm((char *)C_values,							\
+							(char *)A_values,							\
+							(char *)B_values,							\
+							sizeof(BASETYPE), #SUFFIX, m, n, k);		\
+			break;														\
+		}																\
+		memset(C_values, 0, sizeof(BASETYPE) * m * n);					\
+		for (j=0; j < n; j++)											\
+		{																\
+			for (l=0; l < k; l++)										\
+			{															\
+				BASETYPE	b = B_values[j * k + l];					\
+																		\
+				for (i=0; i < m; i++)									\
+					C_values[j * m + i] += A_values[l * m + i] * b;		\
+			}															\
+		}																\
+	} while(0)
+
+Datum
+array_matrix_multiply_float4(PG_FUNCTION_ARGS)
+{
+	MatrixType *A = PG_GETARG_MATRIXTYPE_P(0);
+	MatrixType *B = PG_GETARG_MATRIXTYPE_P(1);
+	MatrixType *C;
+
+	if (VARATT_IS_EXPANDED_HEADER(A) || !VALIDATE_ARRAY_MATRIX(A) ||
+		VARATT_IS_EXPANDED_HEADER(B) || !VALIDATE_ARRAY_MATRIX(B))
+		elog(ERROR, "Array is not like Matrix");
+	Assert(A->elemtype == FLOAT4OID && B->elemtype == FLOAT4OID);
+	ARRAY_MATRIX_MULTIPLY_TEMPLATE(C,A,B,cl_float,FP32);
+	PG_RETURN_POINTER(C);
+}
+PG_FUNCTION_INFO_V1(array_matrix_multiply_float4);
+
+Datum
+array_matrix_multiply_float8(PG_FUNCTION_ARGS)
+{
+	MatrixType *A = PG_GETARG_MATRIXTYPE_P(0);
+	MatrixType *B = PG_GETARG_MATRIXTYPE_P(1);
+	MatrixType *C;
+
+	if (VARATT_IS_EXPANDED_HEADER(A) || !VALIDATE_ARRAY_MATRIX(A) ||
+		VARATT_IS_EXPANDED_HEADER(B) || !VALIDATE_ARRAY_MATRIX(B))
+		elog(ERROR, "Array is not like Matrix");
+	Assert(A->elemtype == FLOAT8OID && B->elemtype == FLOAT8OID);
+	ARRAY_MATRIX_MULTIPLY_TEMPLATE(C,A,B,cl_double,FP64);
+	PG_RETURN_POINTER(C);
+}
+PG_FUNCTION_INFO_V1(array_matrix_multiply_float8);
+
 /*
  * postgresql_type_rawsize on behalf of type_len(regtype)
  */
@@ -1938,3 +2555,21 @@ int8_as_float8(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(GET_8_BYTES(PG_GETARG_DATUM(0)));
 }
 PG_FUNCTION_INFO_V1(int8_as_float8);
+
+/*
+ * pgstrom_init_matrix
+ */
+void
+pgstrom_init_matrix(void)
+{
+	DefineCustomIntVariable("pg_strom.matrix_gpu_threshold",
+							"Threshold of the data size to run array-matrix operators on GPU",
+							"-1 disables GPU operators for array-matrix",
+							&matrix_gpu_threshold_kb,
+							16384,		/* 16MB */
+							-1,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+}
@@ -314,11 +314,18 @@ errorTextKernel(kern_errorbuf *kerror)
 		KERN_ENTRY(gpuscan_exec_quals_column);
 		KERN_ENTRY(gpujoin_main);
 		KERN_ENTRY(gpujoin_right_outer);
+		KERN_ENTRY(gpujoin_main_persistent);
 		KERN_ENTRY(gpupreagg_setup_row);
 		KERN_ENTRY(gpupreagg_setup_block);
 		KERN_ENTRY(gpupreagg_setup_column);
 		KERN_ENTRY(gpupreagg_nogroup_reduction);
 		KERN_ENTRY(gpupreagg_groupby_reduction);
+		KERN_ENTRY(gpusort_setup_row);
+		KERN_ENTRY(gpusort_bitonic_local);
+		KERN_ENTRY(gpusort_bitonic_step);
+		KERN_ENTRY(gpusort_bitonic_merge);
+		KERN_ENTRY(gpuwinagg_setup_row);
+		KERN_ENTRY(gpuwinagg_setup_flags);
 		KERN_ENTRY(plcuda_prep_kernel);
 		KERN_ENTRY(plcuda_main_kernel);
 		KERN_ENTRY(plcuda_post_kernel);
@@ -333,6 +340,72 @@ errorTextKernel(kern_errorbuf *kerror)
 	return buffer;
 }
 
+/*
+ * ----------------------------------------------------------------
+ *
+ * time_bucket(interval, timestamp[tz])
+ *
+ * It rounds down the timestamp to the multiple of the interval width,
+ * aligned to 2000-01-03 00:00:00 (Monday) in UTC. Width must not have
+ * month field because it has no fixed length. The device code has
+ * the equivalent implementation in cuda_timelib.h.
+ *
+ * ----------------------------------------------------------------
+ */
+Datum pgstrom_time_bucket_timestamp(PG_FUNCTION_ARGS);
+Datum pgstrom_time_bucket_timestamptz(PG_FUNCTION_ARGS);
+
+#define TIME_BUCKET_ORIGIN		(2 * USECS_PER_DAY)
+
+static Timestamp
+__pgstrom_time_bucket(Interval *width, Timestamp ts)
+{
+	int64		step;
+	int64		delta;
+	int64		rem;
+
+	if (width->month != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("time_bucket width must not have month field")));
+	step = (int64) width->day * USECS_PER_DAY + width->time;
+	if (step <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("time_bucket width must be positive")));
+	if (TIMESTAMP_NOT_FINITE(ts))
+		return ts;
+	if (ts < PG_INT64_MIN + TIME_BUCKET_ORIGIN)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range")));
+	delta = ts - TIME_BUCKET_ORIGIN;
+	rem = delta % step;
+	if (rem < 0)
+		rem += step;
+	return TIME_BUCKET_ORIGIN + (delta - rem);
+}
+
+Datum
+pgstrom_time_bucket_timestamp(PG_FUNCTION_ARGS)
+{
+	Interval   *width = PG_GETARG_INTERVAL_P(0);
+	Timestamp	ts = PG_GETARG_TIMESTAMP(1);
+
+	PG_RETURN_TIMESTAMP(__pgstrom_time_bucket(width, ts));
+}
+PG_FUNCTION_INFO_V1(pgstrom_time_bucket_timestamp);
+
+Datum
+pgstrom_time_bucket_timestamptz(PG_FUNCTION_ARGS)
+{
+	Interval   *width = PG_GETARG_INTERVAL_P(0);
+	TimestampTz	ts = PG_GETARG_TIMESTAMPTZ(1);
+
+	PG_RETURN_TIMESTAMPTZ(__pgstrom_time_bucket(width, ts));
+}
+PG_FUNCTION_INFO_V1(pgstrom_time_bucket_timestamptz);
+
 /*
  * ----------------------------------------------------------------
  *
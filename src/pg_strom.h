@@ -16,20 +16,27 @@
 #include "access/hash.h"
 #include "access/htup_details.h"
 #include "access/reloptions.h"
+#include "access/rewriteheap.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
 #include "access/tuptoaster.h"
 #include "access/twophase.h"
 #include "access/visibilitymap.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
 #include "catalog/heap.h"
+#include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
 #include "catalog/objectaddress.h"
+#if PG_VERSION_NUM >= 100000
+#include "catalog/partition.h"
+#endif
 #include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_attribute.h"
 #include "catalog/pg_cast.h"
 #include "catalog/pg_class.h"
@@ -37,18 +44,22 @@
 #include "catalog/pg_foreign_data_wrapper.h"
 #include "catalog/pg_foreign_server.h"
 #include "catalog/pg_foreign_table.h"
+#include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_language.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
+#include "commands/cluster.h"
 #include "commands/dbcommands.h"
 #include "commands/defrem.h"
 #include "commands/explain.h"
 #include "commands/proclang.h"
+#include "commands/tablecmds.h"
 #include "commands/tablespace.h"
 #include "commands/trigger.h"
+#include "commands/vacuum.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeCustom.h"
@@ -56,6 +67,7 @@
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
 #include "funcapi.h"
+#include "lib/binaryheap.h"
 #include "lib/ilist.h"
 #include "lib/stringinfo.h"
 #include "libpq/be-fsstubs.h"
@@ -82,6 +94,7 @@
 #include "optimizer/var.h"
 #include "parser/parsetree.h"
 #include "parser/parse_func.h"
+#include "parser/scansup.h"
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "postmaster/bgworker.h"
@@ -107,6 +120,7 @@
 #include "utils/bytea.h"
 #include "utils/cash.h"
 #include "utils/date.h"
+#include "utils/datetime.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
 #include "utils/json.h"
@@ -125,10 +139,13 @@
 #include "utils/rel.h"
 #include "utils/resowner.h"
 #include "utils/ruleutils.h"
+#include "utils/selfuncs.h"
 #include "utils/snapmgr.h"
+#include "utils/sortsupport.h"
 #include "utils/spccache.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
+#include "utils/tuplesort.h"
 #include "utils/typcache.h"
 #include "utils/uuid.h"
 #include "utils/varbit.h"
@@ -142,6 +159,7 @@
 
 #include <assert.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <float.h>
 #include <limits.h>
@@ -214,6 +232,45 @@
 
 #define GPUCTX_CMD__RECLAIM_MEMORY		0x0001
 
+/*
+ * GpuContextWorkerQueue - per-worker deque of the pending GpuTasks.
+ * The owner worker pops from the head, and others steal from the tail.
+ */
+typedef struct GpuContextWorkerQueue
+{
+	pthread_mutex_t	lock;
+	dlist_head		pending_tasks;		/* list of GpuTask */
+} GpuContextWorkerQueue;
+
+/*
+ * GpuContextStat - run-time statistics of GpuContext on the shared memory,
+ * to be exposed by pgstrom.gpu_context_info and pgstrom.gpu_context_meminfo
+ */
+typedef struct GpuContextMemStat
+{
+	pg_atomic_uint32 num_segments;		/* # of memory segments */
+	pg_atomic_uint64 total_size;		/* total bytes of the segments */
+	pg_atomic_uint64 free_size;			/* total bytes of free chunks */
+	pg_atomic_uint64 largest_free;		/* bytes of the largest free chunk */
+} GpuContextMemStat;
+
+typedef struct GpuContextStat
+{
+	pid_t			owner_pid;			/* PID of the backend */
+	cl_int			cuda_dindex;
+	cl_int			num_workers;
+	TimestampTz		ctime;				/* time of creation */
+	pg_atomic_uint32 num_pending_tasks;	/* # of tasks in worker_queues */
+	pg_atomic_uint32 num_running_tasks;	/* # of tasks under processing */
+	pg_atomic_uint64 num_done_tasks;	/* # of tasks already processed */
+	pg_atomic_uint64 busy_time;			/* usec of the worker threads busy */
+	pg_atomic_uint32 sm_occupancy;		/* permill at the last launch */
+	GpuContextMemStat gm_normal;
+	GpuContextMemStat gm_iomap;
+	GpuContextMemStat gm_managed;
+	GpuContextMemStat gm_hostmem;
+} GpuContextStat;
+
 typedef struct GpuContext
 {
 	dlist_node		chain;
@@ -227,6 +284,7 @@ typedef struct GpuContext
 	CUcontext	   *cuda_context_multi;	/* valid only multi-device mode */
 	CUevent		   *cuda_events0; /* per-worker general purpose event */
 	CUevent		   *cuda_events1; /* per-worker general purpose event */
+	CUevent		   *cuda_events2; /* per-worker event for timing stat */
 	pthread_mutex_t	cuda_modules_lock;
 	dlist_head		cuda_modules_slot[CUDA_MODULES_HASHSIZE];
 	/* resource management */
@@ -247,11 +305,17 @@ typedef struct GpuContext
 	/* management of the work-queue */
 	bool			worker_is_running;
 	pg_atomic_uint32 *global_num_running_tasks;
+	struct GpuSchedulerState *gsched;	/* per-device admission control */
+	cl_uint			sched_weight;		/* pg_strom.gpu_task_weight */
+	bool			sched_waiting;		/* true, if refused admission */
 	pthread_mutex_t	*mutex;				/* IPC stuff */
 	pthread_cond_t	*cond;				/* IPC stuff */
 	pg_atomic_uint32 *command;			/* IPC stuff */
+	GpuContextStat	*gc_stat;			/* IPC stuff */
 	pg_atomic_uint32 terminate_workers;
-	dlist_head		pending_tasks;		/* list of GpuTask */
+	pg_atomic_uint32 num_pending_tasks;	/* # of tasks in worker_queues */
+	pg_atomic_uint32 next_queue;		/* round-robin if no affinity */
+	GpuContextWorkerQueue *worker_queues;	/* per-worker deque */
 	cl_int			num_workers;
 	pg_atomic_uint32 worker_index;
 	pthread_t		worker_threads[FLEXIBLE_ARRAY_MEMBER];
@@ -269,6 +333,7 @@ typedef enum {
 	GpuTaskKind_GpuJoin,
 	GpuTaskKind_GpuPreAgg,
 	GpuTaskKind_GpuSort,
+	GpuTaskKind_GpuWindowAgg,
 	GpuTaskKind_PL_CUDA,
 } GpuTaskKind;
 
@@ -276,6 +341,29 @@ typedef struct GpuTask				GpuTask;
 typedef struct GpuTaskState			GpuTaskState;
 typedef struct GpuTaskSharedState	GpuTaskSharedState;
 
+/*
+ * GpuTaskTimeStat
+ *
+ * Run-time timing statistics for each phase of GpuTask, collected only
+ * when EXPLAIN ANALYZE is running. Worker threads update the fields
+ * concurrently, and each parallel worker has its own slot on DSM.
+ */
+typedef enum {
+	GpuTaskPhase_HostLoad = 0,	/* loading a chunk by cb_next_task */
+	GpuTaskPhase_QueueWait,		/* waiting for a worker thread */
+	GpuTaskPhase_DmaSend,		/* HtoD DMA (or SSD-to-GPU) */
+	GpuTaskPhase_Kernel,		/* execution of GPU kernel(s) */
+	GpuTaskPhase_DmaRecv,		/* DtoH DMA */
+	GpuTaskPhase_CpuFallback,	/* CPU fallback on the backend */
+	GpuTaskPhase__NumPhases
+} GpuTaskPhase;
+
+typedef struct GpuTaskTimeStat
+{
+	pg_atomic_uint64 count[GpuTaskPhase__NumPhases];
+	pg_atomic_uint64 usec[GpuTaskPhase__NumPhases];
+} GpuTaskTimeStat;
+
 /*
  * GpuTaskState
  *
@@ -288,11 +376,23 @@ struct GpuTaskState
 {
 	CustomScanState	css;
 	GpuContext	   *gcontext;
+	/* GpuContexts on the other devices to distribute GpuTasks, if any */
+	GpuContext	  **gcontext_multi;
+	cl_int			num_gcontext_multi;
+	cl_uint			next_gcontext;	/* round-robin */
 	GpuTaskKind		task_kind;		/* one of GpuTaskKind_* */
 	ProgramId		program_id;		/* CUDA Program (to be acquired) */
 	kern_parambuf  *kern_params;	/* Const/Param buffer */
 	Relids			ccache_refs;	/* referenced attributed, if ccache */
+	List		   *ccache_zmap_keys; /* keys to check zone-map of ccache */
+	BlockNumber	   *ccache_delta_blocks; /* dirty blocks of the last ccache */
+	cl_uint			ccache_delta_nblocks; /* to be read from the heap */
+	cl_uint			ccache_delta_index;
 	long			ccache_count;	/* # of ccache hit */
+	bool			ccache_device_tier; /* true, if the tasks can run on
+										 * the device tier image */
+	CUdeviceptr		ccache_m_kds;	/* device tier image of the ccache PDS
+									 * last returned, if any */
 	bool			scan_done;		/* True, if no more rows to read */
 
 	/* fields for outer scan */
@@ -303,6 +403,7 @@ struct GpuTaskState
 	cl_uint			outer_nrows_per_block;
 	Instrumentation	outer_instrument; /* runtime statistics, if any */
 	TupleTableSlot *scan_overflow;	/* temporary buffer, if no space on PDS */
+	bool			outer_bulkexec;	/* pulls data stores from the outer GTS */
 	/*
 	 * A pending PDS object. Load from the outer relation can be suspended
 	 * if columnar cache segment is already built and valid.
@@ -315,6 +416,31 @@ struct GpuTaskState
 	 */
 	struct NVMEScanState *nvme_sstate;
 
+	/*
+	 * A state object for arrow_fdw. If not NULL, the outer relation is
+	 * a foreign table on Apache Arrow files, and each record batch is
+	 * loaded as a KDS_FORMAT_COLUMN chunk.
+	 */
+	struct ArrowFdwState *af_state;
+
+	/*
+	 * BRIN index to skip block ranges which never match to the scan
+	 * qualifiers, if any. @outer_brin_map is a bitmap of the blocks to
+	 * be scanned, built on the first call of the relation scan.
+	 */
+	Relation		outer_brin_index;
+	List		   *outer_brin_keys;	/* keys to check BRIN summary */
+	bits8		   *outer_brin_map;
+	BlockNumber		outer_brin_nblocks;	/* # of blocks in the map */
+	cl_ulong		outer_brin_skipped;	/* # of blocks skipped, not flushed */
+
+	/*
+	 * Bloom filter on the join keys pushed down from GpuJoin, if any.
+	 * Rows loaded by CPU are discarded prior to DMA, if its join keys
+	 * never match to the inner hash table.
+	 */
+	struct GpuJoinBloomFilter *outer_bloom;
+
 	/*
 	 * fields to fetch rows from the current task
 	 *
@@ -331,6 +457,22 @@ struct GpuTaskState
 	HeapTupleData	curr_tuple;		/* internal use of PDS_fetch() */
 	struct GpuTask *curr_task;	/* a GpuTask currently processed */
 
+	/*
+	 * PDS_fetch_tuple() makes @zcopy_slot reference the rows of SLOT format,
+	 * or rows of COLUMN format decoded per batch, without copy. The original
+	 * tts_values/tts_isnull of the slot are kept here, and restored by
+	 * PDS_fetch_tuple_restore() prior to the release of the PDS.
+	 */
+	TupleTableSlot *zcopy_slot;
+	Datum		   *zcopy_values;	/* original tts_values of @zcopy_slot */
+	bool		   *zcopy_isnull;	/* original tts_isnull of @zcopy_slot */
+	kern_data_store *cbatch_kds;	/* KDS(column) decoded to the batch */
+	cl_uint			cbatch_base;	/* row index of the head of the batch */
+	cl_uint			cbatch_nitems;	/* number of rows in the batch */
+	cl_int			cbatch_natts;	/* width of the batch buffer */
+	Datum		   *cbatch_values;	/* values of the batch (row-major) */
+	bool		   *cbatch_isnull;	/* isnull of the batch (row-major) */
+
 	/* callbacks used by gputasks.c */
 	GpuTask		 *(*cb_next_task)(GpuTaskState *gts);
 	GpuTask		 *(*cb_terminator_task)(GpuTaskState *gts,
@@ -340,13 +482,41 @@ struct GpuTaskState
 	int			  (*cb_process_task)(GpuTask *gtask,
 									 CUmodule cuda_module);
 	void		  (*cb_release_task)(GpuTask *gtask);
+	/*
+	 * optional; checks whether the task can be processed by CPU fallback
+	 * on the backend, while the CUDA program is still being built.
+	 */
+	bool		  (*cb_jit_fallback)(GpuTaskState *gts, GpuTask *gtask);
+	bool			program_is_ready;	/* true, if CUDA program is built */
+	/*
+	 * optional; detaches a result data store of the task to be handed to
+	 * the upper GPU node as-is, or returns NULL if no more.
+	 */
+	struct pgstrom_data_store *(*cb_bulk_exec)(GpuTaskState *gts,
+											   GpuTask *gtask);
+	TupleTableSlot *bulk_overflow;	/* pending row of pgstromBulkExec... */
+	struct pgstrom_data_store *bulk_pending; /* PDS not coalesced last */
 	/* list of GpuTasks (protexted with GpuContext->mutex) */
 	dlist_head		ready_tasks;	/* list of tasks already processed */
 	cl_uint			num_running_tasks;	/* # of running tasks */
 	cl_uint			num_ready_tasks;	/* # of ready tasks */
+	/* list of GpuTasks loaded ahead, but not kicked yet (backend only) */
+	dlist_head		prefetch_tasks;
+	cl_uint			num_prefetch_tasks;
 
 	/* misc fields */
 	cl_long			num_cpu_fallbacks;	/* # of CPU fallback chunks */
+	cl_long			num_loader_stalls;	/* # of GPU idle by loader */
+	cl_long			num_gpu_stalls;		/* # of loader waits for GPU */
+	cl_long			num_coalesced_chunks; /* # of small PDS packed together */
+	instr_time		queue_wait_start;	/* start time of admission wait */
+	double			queue_wait_time;	/* msec waiting for admission */
+
+	/* timing statistics; NULL unless EXPLAIN ANALYZE */
+	GpuTaskTimeStat *tm_stat;		/* own slot of this process */
+	GpuTaskTimeStat *tm_stat_slots;	/* per-process slots, if parallel */
+	cl_int			tm_stat_nslots;	/* # of tm_stat_slots */
+	GpuTaskTimeStat	tm_stat_local;	/* local slot, if not parallel */
 
 	/* co-operation with CPU parallel */
 	GpuTaskSharedState *gtss;		/* DSM segment of GTS if any */
@@ -366,7 +536,9 @@ struct GpuTaskSharedState
 								 * workers; almost equivalent to the
 								 * @phs_nallocated in PG11 or later.
 								 */
-	ParallelHeapScanDescData	phscan;
+	cl_int		tm_stat_nslots;	/* # of per-process GpuTaskTimeStat */
+	Size		tm_stat_offset;	/* offset to the GpuTaskTimeStat slots */
+	ParallelHeapScanDescData	phscan;	/* must be the last */
 };
 
 /*
@@ -383,6 +555,8 @@ struct GpuTask
 	ProgramId		program_id;		/* same with GTS's one */
 	GpuTaskState   *gts;			/* GTS reference in the backend */
 	bool			cpu_fallback;	/* true, if task needs CPU fallback */
+	cl_int			affinity;		/* preferred worker queue, or -1 */
+	instr_time		tv_enqueue;		/* time of enqueue, if timing stat */
 };
 
 /*
@@ -391,7 +565,8 @@ struct GpuTask
 #define DEVKERNEL_NEEDS_GPUSCAN			0x00000001	/* GpuScan logic */
 #define DEVKERNEL_NEEDS_GPUJOIN			0x00000002	/* GpuJoin logic */
 #define DEVKERNEL_NEEDS_GPUPREAGG		0x00000004	/* GpuPreAgg logic */
-//#define DEVKERNEL_NEEDS_GPUSORT			0x00000008	/* GpuSort logic */
+#define DEVKERNEL_NEEDS_GPUSORT			0x00000008	/* GpuSort logic */
+#define DEVKERNEL_NEEDS_GPUWINAGG		0x00000010	/* GpuWindowAgg logic */
 #define DEVKERNEL_NEEDS_PLCUDA			0x00000080	/* PL/CUDA related */
 
 #define DEVKERNEL_NEEDS_DYNPARA			0x00000100	/* aks, device runtime */
@@ -404,12 +579,19 @@ struct GpuTask
 #define DEVKERNEL_NEEDS_RANGETYPE		0x00008000
 #define DEVKERNEL_NEEDS_PRIMITIVE		0x00010000
 #define DEVKERNEL_NEEDS_TIME_EXTRACT	0x00020000
+#define DEVKERNEL_NEEDS_JSONLIB		   (0x00040000 | DEVKERNEL_NEEDS_TEXTLIB)
 
 #define DEVKERNEL_NEEDS_CURAND			0x00100000
+#define DEVKERNEL_BUILD_AUTO_TUNE		0x40000000	/* tuning of variants */
 #define DEVKERNEL_BUILD_DEBUG_INFO		0x80000000
 //TODO: DYNPARA needs to be renamed?
 #define DEVKERNEL_NEEDS_LINKAGE		   (DEVKERNEL_NEEDS_DYNPARA	|	\
 										DEVKERNEL_NEEDS_CURAND)
+/*
+ * size of the per-thread varlena buffer in kern_context; it also stages
+ * inline-compressed datum decompressed on the device.
+ */
+#define KERN_CONTEXT_VARLENA_BUFSZ_DEFAULT	4096
 struct devtype_info;
 struct devfunc_info;
 
@@ -492,6 +674,8 @@ typedef struct NVMEScanState
 	cl_uint			nblocks_per_chunk;
 	BlockNumber		curr_segno;
 	Buffer			curr_vmbuffer;
+	bool			gpu_visibility;	/* GPU checks visibility of the blocks
+									 * not all-visible, using hint-bits */
 	BlockNumber		nr_segs;
 	int				fdesc[FLEXIBLE_ARRAY_MEMBER];
 } NVMEScanState;
@@ -513,18 +697,34 @@ typedef struct DevAttributes
 	char		DEV_NAME[256];
 	size_t		DEV_TOTAL_MEMSZ;
 	cl_int		CORES_PER_MPU;
+	cl_int		DEV_DMA_BANDWIDTH;	/* MB/s by calibration, or 0 */
+	cl_int		DEV_LAUNCH_LATENCY;	/* ns by calibration, or 0 */
+	cl_int		NUMA_NODE_ID;		/* NUMA node of the device, or -1 */
 #define DEV_ATTR(LABEL,a,b,c)					\
 	cl_int		LABEL;
 #include "device_attrs.h"
 #undef DEV_ATTR
 } DevAttributes;
 
+/*
+ * Reference hardware of the default GPU cost factors; Tesla P100 (PCIe)
+ * on PCIe Gen3 x16 slot. Throughput is (number of CUDA cores) x (clock
+ * rate in kHz).
+ */
+#define GPU_COST_REFERENCE_THROUGHPUT		(3584.0 * 1328500.0)
+#define GPU_COST_REFERENCE_DMA_BANDWIDTH	12000.0		/* MB/s */
+#define GPU_COST_REFERENCE_LAUNCH_LATENCY	10000.0		/* ns */
+
 extern DevAttributes   *devAttrs;
 extern cl_int			numDevAttrs;
 extern cl_ulong			devComputeCapability;
 extern cl_uint			devBaselineMaxThreadsPerBlock;
 
 extern void pgstrom_init_gpu_device(void);
+extern int	pgstrom_choose_gpu_device(int numa_node_id);
+extern void pgstrom_calibrate_gpu_cost(Size chunk_size,
+									   double *p_gpu_dma_cost,
+									   double *p_gpu_operator_cost);
 #if 1
 extern void largest_workgroup_size(size_t *p_grid_size,
 								   size_t *p_block_size,
@@ -605,6 +805,23 @@ extern void gpuIpcMemCopyToHost(void *hbuffer,
 								CUipcMemHandle m_handle,
 								size_t offset,
 								size_t length);
+typedef struct GpuIpcMemStream	GpuIpcMemStream;
+extern void gpuIpcMemStreamWrite(GpuIpcMemStream *gstream,
+								 const void *data, size_t length);
+extern size_t gpuIpcMemCopyFromHostStream(cl_int cuda_dindex,
+										  CUipcMemHandle m_handle,
+										  size_t offset,
+						void (*stream_cb)(GpuIpcMemStream *gstream,
+										  void *cb_private),
+										  void *cb_private);
+extern void gpuIpcMemCopyToHostStream(cl_int cuda_dindex,
+									  CUipcMemHandle m_handle,
+									  size_t offset,
+									  size_t length,
+						void (*stream_cb)(const void *data,
+										  size_t length,
+										  void *cb_private),
+									  void *cb_private);
 #define gpuMemAllocRaw(a,b,c)				\
 	__gpuMemAllocRaw((a),(b),(c),__FILE__,__LINE__)
 #define gpuMemAllocManagedRaw(a,b,c,d)		\
@@ -627,8 +844,14 @@ extern void gpuIpcMemCopyToHost(void *hbuffer,
 	__gpuIpcOpenMemHandle((a),(b),(c),(d),__FILE__,__LINE__)
 
 extern void gpuMemReclaimSegment(GpuContext *gcontext);
+extern void gpuMemPublishStatistics(GpuContext *gcontext);
+extern void gpuMemPoolReturnExtra(void *extra);
 
 extern void gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds);
+extern void gpuMemCopyFromSSDAsync(CUdeviceptr m_kds,
+								   pgstrom_data_store *pds);
+extern void gpuMemCopyFromSSDWait(void);
+extern void gpuMemCopyFromSSDAbort(void);
 
 extern void pgstrom_gpu_mmgr_init_gpucontext(GpuContext *gcontext);
 extern void pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext);
@@ -652,6 +875,8 @@ extern __thread int				GpuWorkerIndex;
 	(GpuWorkerCurrentContext->cuda_events0[GpuWorkerIndex])
 #define CU_EVENT1_PER_THREAD					\
 	(GpuWorkerCurrentContext->cuda_events1[GpuWorkerIndex])
+#define CU_EVENT2_PER_THREAD					\
+	(GpuWorkerCurrentContext->cuda_events2[GpuWorkerIndex])
 
 extern void GpuContextWorkerReportError(int elevel,
 										const char *filename, int lineno,
@@ -695,6 +920,13 @@ extern GpuContext *GetGpuContext(GpuContext *gcontext);
 extern void PutGpuContext(GpuContext *gcontext);
 extern void SwitchGpuContext(GpuContext *gcontext, int cuda_dindex);
 extern void SynchronizeGpuContext(GpuContext *gcontext);
+extern void pgstromEnqueueGpuTask(GpuContext *gcontext, GpuTask *gtask);
+extern bool pgstromGpuTaskAdmission(GpuTaskState *gts,
+									cl_int local_num_running_tasks);
+extern void pgstromGpuTaskAdmissionDone(GpuTaskState *gts);
+extern GpuTask *pgstromDequeueSiblingGpuTask(GpuTask *gtask,
+						bool (*is_sibling)(GpuTask *gtask, GpuTask *sibling));
+extern void pgstromCompleteGpuTask(GpuTask *gtask, cl_int retval);
 extern void SynchronizeGpuContextOnDSMDetach(dsm_segment *seg, Datum arg);
 
 extern bool trackCudaProgram(GpuContext *gcontext, ProgramId program_id,
@@ -812,6 +1044,8 @@ extern void pgstromInitGpuTaskState(GpuTaskState *gts,
 									List *used_params,
 									EState *estate);
 extern TupleTableSlot *pgstromExecGpuTaskState(GpuTaskState *gts);
+extern bool pgstromBulkExecEnabled(GpuTaskState *gts, PlanState *outer_ps);
+extern pgstrom_data_store *pgstromBulkExecGpuTaskState(GpuTaskState *gts);
 extern void pgstromRescanGpuTaskState(GpuTaskState *gts);
 extern void pgstromReleaseGpuTaskState(GpuTaskState *gts);
 extern void pgstromExplainGpuTaskState(GpuTaskState *gts,
@@ -824,7 +1058,15 @@ extern void pgstromInitDSMGpuTaskState(GpuTaskState *gts,
 extern void pgstromInitWorkerGpuTaskState(GpuTaskState *gts,
 										  void *coordinate);
 extern void pgstromReInitializeDSMGpuTaskState(GpuTaskState *gts);
-
+extern void pgstromShutdownDSMGpuTaskState(GpuTaskState *gts);
+extern void pgstromTimeStatEventRecord(GpuTaskState *gts, CUevent cuda_event);
+extern void pgstromTimeStatAddEvents(GpuTaskState *gts, GpuTaskPhase phase,
+									 CUevent ev_start, CUevent ev_stop);
+extern void pgstromTimeStatAddElapsed(GpuTaskState *gts, GpuTaskPhase phase,
+									  instr_time *tv_start);
+
+extern void pgstromSetupMultiGpuTaskState(GpuTaskState *gts,
+										  BlockNumber nblocks);
 extern GpuTask *fetch_next_gputask(GpuTaskState *gts);
 extern void pgstromExplainOuterScan(GpuTaskState *gts,
 									List *deparse_context,
@@ -837,6 +1079,15 @@ extern void pgstromExplainOuterScan(GpuTaskState *gts,
 									int outer_plan_width);
 
 extern void pgstromInitGpuTask(GpuTaskState *gts, GpuTask *gtask);
+
+#define CARDINALITY_FEEDBACK_MAX_VALUES		16
+extern cl_uint pgstromPlanFingerprint(PlannerInfo *root, Relids relids,
+									  List *exprs);
+extern bool pgstromLookupCardinalityFeedback(cl_uint fingerprint,
+											 double *values, int nvalues);
+extern void pgstromUpdateCardinalityFeedback(cl_uint fingerprint,
+											 const double *values,
+											 int nvalues);
 extern void pgstrom_init_gputasks(void);
 
 /*
@@ -852,7 +1103,13 @@ extern ProgramId __pgstrom_create_cuda_program(GpuContext *gcontext,
 											   int lineno);
 #define pgstrom_create_cuda_program(a,b,c,d,e,f)						\
 	__pgstrom_create_cuda_program((a),(b),(c),(d),(e),(f),__FILE__,__LINE__)
-extern CUmodule pgstrom_load_cuda_program(ProgramId program_id);
+extern CUmodule pgstrom_load_cuda_program(ProgramId program_id, int variant);
+extern bool pgstrom_cuda_program_is_ready(ProgramId program_id);
+extern int	pgstrom_select_cuda_program_variant(ProgramId program_id,
+												bool *p_tuning);
+extern void pgstrom_tune_cuda_program_variant(ProgramId program_id,
+											  int variant,
+											  cl_ulong elapsed_usec);
 extern void pgstrom_put_cuda_program(GpuContext *gcontext,
 									 ProgramId program_id);
 extern void pgstrom_build_session_info(StringInfo str,
@@ -880,6 +1137,7 @@ typedef struct {
 	const char *kds_index_label; /* label to reference kds_index, if exist */
 	List	   *pseudo_tlist;/* pseudo tlist expression, if any */
 	int			extra_flags;/* external libraries to be included */
+	List	   *cse_exprs;	/* common sub-expressions in the function */
 } codegen_context;
 
 extern void pgstrom_codegen_typeoid_declarations(StringInfo buf);
@@ -894,8 +1152,15 @@ extern void pgstrom_devfunc_track(codegen_context *context,
 								  devfunc_info *dfunc);
 
 extern char *pgstrom_codegen_expression(Node *expr, codegen_context *context);
+extern void pgstrom_codegen_common_subexprs(StringInfo decl,
+											StringInfo body,
+											List *exprs_list,
+											codegen_context *context);
 extern void pgstrom_codegen_param_declarations(StringInfo buf,
 											   codegen_context *context);
+extern void pgstrom_codegen_column_vectors(StringInfo kern,
+										   const char *prefix,
+										   List *colidx_list);
 extern bool __pgstrom_device_expression(Expr *expr,
 										const char *filename, int lineno);
 #define pgstrom_device_expression(expr)		\
@@ -907,13 +1172,18 @@ extern void pgstrom_init_codegen(void);
  * datastore.c
  */
 extern cl_uint estimate_num_chunks(Path *pathnode);
+extern void KDS_fixup_block_visibility(GpuTaskState *gts,
+									   Relation relation,
+									   BlockNumber block_nr,
+									   PageHeader hpage);
 extern bool KDS_fetch_tuple_column(TupleTableSlot *slot,
 								   kern_data_store *kds,
 								   size_t row_index);
 extern bool PDS_fetch_tuple(TupleTableSlot *slot,
 							pgstrom_data_store *pds,
 							GpuTaskState *gts);
-extern pgstrom_data_store *__PDS_clone(pgstrom_data_store *pds,
+extern void PDS_fetch_tuple_restore(GpuTaskState *gts);
+extern pgstrom_data_store *__PDS_clone(pgstrom_data_store *pds, Size length,
 									   const char *filename, int lineno);
 extern pgstrom_data_store *PDS_retain(pgstrom_data_store *pds);
 extern void PDS_release(pgstrom_data_store *pds);
@@ -949,12 +1219,15 @@ extern pgstrom_data_store *__PDS_create_block(GpuContext *gcontext,
 #define PDS_create_block(a,b,c)					\
 	__PDS_create_block((a),(b),(c),__FILE__,__LINE__)
 #define PDS_clone(a)							\
-	__PDS_clone((a),__FILE__,__LINE__)
+	__PDS_clone((a),(a)->kds.length,__FILE__,__LINE__)
+#define PDS_clone_length(a,b)					\
+	__PDS_clone((a),(b),__FILE__,__LINE__)
 
 //XXX - to be gpu_task.c?
 extern void PDS_init_heapscan_state(GpuTaskState *gts,
 									cl_uint nrows_per_block);
 extern void PDS_end_heapscan_state(GpuTaskState *gts);
+extern void PDS_flush_heapscan(pgstrom_data_store *pds);
 extern bool PDS_exec_heapscan(GpuTaskState *gts,
 							  pgstrom_data_store *pds);
 extern cl_uint NVMESS_NBlocksPerChunk(struct NVMEScanState *nvme_sstate);
@@ -968,15 +1241,19 @@ extern void PDS_fillup_blocks(pgstrom_data_store *pds);
 extern bool KDS_insert_tuple(kern_data_store *kds,
 							 TupleTableSlot *slot);
 #define PDS_insert_tuple(pds,slot)	KDS_insert_tuple(&(pds)->kds,slot)
+extern bool KDS_append_rows(kern_data_store *kds_dst,
+							kern_data_store *kds_src);
 
 extern bool KDS_insert_hashitem(kern_data_store *kds,
 								TupleTableSlot *slot,
 								cl_uint hash_value);
 
+extern bool		nvme_strom_gpu_visibility;	/* GUC */
 extern bool ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel);
 extern bool RelationCanUseNvmeStrom(Relation relation);
 extern bool RelationWillUseNvmeStrom(Relation relation,
 									 BlockNumber *p_nr_blocks);
+extern int	RelationOptimalGpuForNvmeStrom(Relation relation);
 extern void pgstrom_init_datastore(void);
 
 /*
@@ -985,6 +1262,8 @@ extern void pgstrom_init_datastore(void);
 extern void cost_gpuscan_common(PlannerInfo *root,
 								RelOptInfo *scan_rel,
 								Expr *scan_quals,
+								IndexOptInfo *bitmap_index,
+								List *bitmap_quals,
 								int parallel_workers,
 								double *p_parallel_divisor,
 								double *p_scan_ntuples,
@@ -1042,9 +1321,13 @@ extern ProgramId GpuJoinCreateCombinedProgram(PlanState *node,
 extern bool GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels);
 extern void GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan);
 extern pgstrom_data_store *GpuJoinExecOuterScanChunk(GpuTaskState *gts);
+extern bool GpuJoinOuterBloomFilterTest(GpuTaskState *gts,
+										TupleDesc tupdesc,
+										HeapTuple tuple);
 extern bool gpujoinHasRightOuterJoin(GpuTaskState *gts);
+extern bool gpujoinHasPartitionedInner(GpuTaskState *gts);
 extern int  gpujoinNextRightOuterJoin(GpuTaskState *gts);
-extern void gpujoinSyncRightOuterJoin(GpuTaskState *gts);
+extern bool gpujoinSyncRightOuterJoin(GpuTaskState *gts);
 extern void gpujoinColocateOuterJoinMaps(GpuTaskState *gts,
 										 CUmodule cuda_module);
 extern TupleTableSlot *gpujoinNextTupleFallback(GpuTaskState *gts,
@@ -1063,13 +1346,48 @@ extern bool pgstrom_planstate_is_gpupreagg(const PlanState *ps);
 extern void gpupreagg_post_planner(PlannedStmt *pstmt, CustomScan *cscan);
 extern void assign_gpupreagg_session_info(StringInfo buf,
 										  GpuTaskState *gts);
+extern void gpupreagg_codegen_hashvalue(StringInfo kern,
+										codegen_context *context,
+										List *tlist_dev,
+										const char *func_name);
+extern void gpupreagg_codegen_keymatch(StringInfo kern,
+									   codegen_context *context,
+									   List *tlist_dev,
+									   const char *func_name);
 extern void pgstrom_init_gpupreagg(void);
 
+/*
+ * gpuwinagg.c
+ */
+extern bool pgstrom_path_is_gpuwinagg(const Path *pathnode);
+extern bool pgstrom_plan_is_gpuwinagg(const Plan *plan);
+extern bool pgstrom_planstate_is_gpuwinagg(const PlanState *ps);
+extern void pgstrom_init_gpuwinagg(void);
+
+/*
+ * gpusort.c
+ */
+extern bool pgstrom_path_is_gpusort(const Path *pathnode);
+extern bool pgstrom_plan_is_gpusort(const Plan *plan);
+extern bool pgstrom_planstate_is_gpusort(const PlanState *ps);
+extern void pgstrom_init_gpusort(void);
+
 /*
  * pl_cuda.c
  */
 extern void pgstrom_init_plcuda(void);
 
+/*
+ * matrix.c
+ */
+extern void pgstrom_init_matrix(void);
+
+/*
+ * float2.c
+ */
+extern Oid	get_float2_type_oid(bool missing_ok);
+#define FLOAT2OID		get_float2_type_oid(false)
+
 /*
  * ccache.c
  */
@@ -1138,19 +1456,36 @@ extern void pgstrom_ccache_writeout_chunk(kern_data_store *kds,
 
 extern bool RelationCanUseColumnarCache(Relation relation);
 extern struct ccacheChunk *pgstrom_ccache_get_chunk(Relation relation,
-													BlockNumber block_nr);
+													BlockNumber block_nr,
+													Relids ccache_refs);
 extern void pgstrom_ccache_put_chunk(struct ccacheChunk *cc_chunk);
+extern double pgstrom_ccache_residency_ratio(Oid table_oid,
+											 BlockNumber nblocks);
 extern bool pgstrom_ccache_is_empty(struct ccacheChunk *cc_chunk);
 extern pgstrom_data_store *
 pgstrom_ccache_load_chunk(struct ccacheChunk *cc_chunk,
 						  GpuContext *gcontext,
 						  Relation relation,
-						  Relids ccache_refs);
+						  Relids ccache_refs,
+						  BlockNumber **p_delta_blocks,
+						  cl_uint *p_delta_nblocks);
+extern pgstrom_data_store *
+pgstrom_ccache_open_device_image(struct ccacheChunk *cc_chunk,
+								 GpuContext *gcontext,
+								 CUdeviceptr *p_m_kds);
+extern void pgstrom_ccache_init_zonemap(GpuTaskState *gts, List *quals);
+extern bool pgstrom_ccache_skip_chunk(struct ccacheChunk *cc_chunk,
+									  GpuTaskState *gts);
 extern void pgstrom_init_ccache(void);
 
 /*
  * gstore_fdw.c
  */
+#define GSTORE_FDW_MAX_SHARDS	16
+#define GSTORE_FDW_MAX_DELTAS	15
+/* shards, delta chunks and local buffer; must fit 32bit bitmap */
+#define GSTORE_FDW_MAX_IMAGES	(GSTORE_FDW_MAX_SHARDS +	\
+								 GSTORE_FDW_MAX_DELTAS + 1)
 extern bool type_is_reggstore(Oid type_oid);
 extern Oid	get_reggstore_type_oid(void);
 #define REGGSTOREOID		get_reggstore_type_oid()
@@ -1160,8 +1495,33 @@ extern void gstore_fdw_load_function_args(GpuContext *gcontext,
 										  List **p_gstore_oid_list,
 										  List **p_gstore_devptr_list,
 										  List **p_gstore_dindex_list);
+extern bool relation_is_gstore_fdw(Oid table_oid);
+extern int	gstore_fdw_num_shards(Oid gstore_oid);
+extern int	gstore_fdw_device_images(Relation frel, cl_int *devices);
+extern pgstrom_data_store *gstore_fdw_open_data_store(GpuContext *gcontext,
+													  Relation frel,
+													  int image_id,
+													  CUdeviceptr *p_m_kds);
 extern void pgstrom_init_gstore_fdw(void);
 
+/*
+ * arrow_fdw.c
+ */
+typedef struct ArrowFdwState	ArrowFdwState;
+extern bool baseRelIsArrowFdw(RelOptInfo *baserel);
+extern bool RelationIsArrowFdw(Relation frel);
+extern ArrowFdwState *ExecInitArrowFdw(Relation frel, Bitmapset *referenced);
+extern pgstrom_data_store *ExecScanChunkArrowFdw(GpuTaskState *gts);
+extern void ExecReScanArrowFdw(ArrowFdwState *af_state);
+extern void ExecEndArrowFdw(ArrowFdwState *af_state);
+extern void ExplainArrowFdw(Relation frel, ExplainState *es);
+
+/*
+ * largeobject.c
+ */
+extern CUdeviceptr pgstrom_lo_load_device(GpuContext *gcontext, Oid loid,
+										  size_t *p_length);
+
 /*
  * misc.c
  */
@@ -1181,6 +1541,8 @@ extern bool		pgstrom_enabled;
 extern bool		pgstrom_debug_kernel_source;
 extern bool		pgstrom_bulkexec_enabled;
 extern bool		pgstrom_cpu_fallback_enabled;
+extern bool		pgstrom_jit_cpu_fallback;
+extern int		pgstrom_heapscan_loader_threads;
 extern int		pgstrom_max_async_tasks;
 extern double	pgstrom_gpu_setup_cost;
 extern double	pgstrom_gpu_dma_cost;
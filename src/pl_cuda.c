@@ -66,6 +66,8 @@ typedef struct plcudaCodeProperty
 	/* comprehensive functions */
 	Oid			fn_sanity_check;
 	Oid			fn_cpu_fallback;
+	/* bitmap of the oid arguments to be loaded as largeobject */
+	cl_ulong	lobj_args;
 	/* composite type descriptors, if any */
 	List	   *composite_types;
 } plcudaCodeProperty;
@@ -80,6 +82,13 @@ typedef struct plcudaTaskState
 	dlist_node		chain;
 	kern_plcuda	   *kplcuda_head;
 	CUdeviceptr		last_results_buf;	/* results buffer last used */
+	/* state of set-returning function */
+	bool			retset;			/* function is declared with SETOF */
+	bool			retset_running;	/* a round of the kernels is running */
+	struct plcudaTask *retset_task;	/* task in progress, if any */
+	char		   *retset_rows;	/* rows picked up from results buffer */
+	size_t			retset_usage;	/* length of the retset_rows */
+	size_t			retset_offset;	/* current position on the retset_rows */
 	/* property of the code block */
 	plcudaCodeProperty p;
 	/* property of the PL/CUDA kernel functions */
@@ -109,10 +118,15 @@ typedef struct plcudaTask
 	bool			exec_prep_kernel;
 	bool			exec_post_kernel;
 	bool			has_cpu_fallback;
+	bool			retset;			/* set-returning function */
 	CUdeviceptr		m_results_buf;	/* results buffer as unified memory */
+	CUdeviceptr		m_working_buf;	/* working buffer kept across the rounds
+									 * of set-returning function */
 	List		   *gstore_oid_list;	/* OID of GpuStore foreign table */
 	List		   *gstore_devptr_list;	/* CUdeviceptr of GpuStore */
 	List		   *gstore_dindex_list;	/* Preferable dindex if any */
+	List		   *dma_devptr_list;	/* device memory of the arguments
+										 * loaded by direct DMA */
 	kern_plcuda		kern;
 } plcudaTask;
 
@@ -143,6 +157,9 @@ static int	plcuda_kfunc_dynamic_shmsz  = -1;
 static int	plcuda_kfunc_const_memsz    = -1;
 static int	plcuda_kfunc_local_memsz    = -1;
 
+/* GUC variables */
+static int	plcuda_direct_dma_threshold_kb;
+
 Datum
 plcuda_kernel_max_blocksz(PG_FUNCTION_ARGS)
 {
@@ -383,6 +400,7 @@ ident_to_cstring(List *ident)
  * #plcuda_working_bufsz {<value>|<function>}      (default: 0)
  * #plcuda_sanity_check {<function>}             (default: no fallback)
  * #plcuda_cpu_fallback {<function>}             (default: no fallback)
+ * #plcuda_largeobject <argument number>...     (default: none)
  */
 typedef struct {
 	Oid					proowner;
@@ -770,6 +788,32 @@ __plcuda_code_validation(plcuda_code_context *con,
 					EMSG("\"%s\" was not a valid value or function",
 						 ident_to_cstring(options));
 			}
+			else if (strcmp(cmd, "#plcuda_largeobject") == 0)
+			{
+				ListCell   *lc;
+
+				if (list_length(options) == 0)
+					EMSG("syntax error:\n  %s", line);
+				foreach (lc, options)
+				{
+					char   *ident = lfirst(lc);
+					long	anum;
+
+					anum = strtol(ident, &end, 10);
+					if (*ident == '\0' || *end != '\0' ||
+						anum < 1 || anum > con->proargtypes->dim1)
+						EMSG("\"%s\" is not a valid argument number", ident);
+					else if (anum > sizeof(cl_ulong) * BITS_PER_BYTE)
+						EMSG("argument %ld is out of the range of %s",
+							 anum, cmd);
+					else if (con->proargtypes->values[anum-1] != OIDOID)
+						EMSG("argument %ld of %s must be oid, not %s",
+							 anum, cmd,
+							 format_type_be(con->proargtypes->values[anum-1]));
+					else
+						prop->lobj_args |= (1UL << (anum-1));
+				}
+			}
 			else if (strcmp(cmd, "#plcuda_include") == 0)
 			{
 				cl_uint		extra_flags = 0;
@@ -1035,6 +1079,7 @@ plcuda_codegen_part(StringInfo kern,
 					const char *users_code,
 					bool kernel_maxthreads,
 					Form_pg_proc procForm,
+					cl_ulong lobj_args,
 					const char *last_suffix)
 {
 	devtype_info   *dtype;
@@ -1094,6 +1139,15 @@ plcuda_codegen_part(StringInfo kern,
 				i+1);
 			continue;
 		}
+		/* special case if #plcuda_largeobject */
+		if ((lobj_args & (1UL << i)) != 0)
+		{
+			appendStringInfo(
+				kern,
+				"  kern_largeobject_t arg%u __attribute__((unused));\n",
+				i+1);
+			continue;
+		}
 
 		dtype = pgstrom_devtype_lookup(type_oid);
 		if (dtype)
@@ -1135,6 +1189,15 @@ plcuda_codegen_part(StringInfo kern,
 				i+1, i);
 			continue;
 		}
+		/* special case if #plcuda_largeobject */
+		if ((lobj_args & (1UL << i)) != 0)
+		{
+			appendStringInfo(
+				kern,
+				"  arg%u = pg_largeobject_param(kcxt,%d);\n",
+				i+1, i);
+			continue;
+		}
 
 		dtype = pgstrom_devtype_lookup(type_oid);
 		if (dtype)
@@ -1144,10 +1207,18 @@ plcuda_codegen_part(StringInfo kern,
 		else
 			elog(ERROR, "cache lookup failed for type '%s'",
 				 format_type_be(type_oid));
-		appendStringInfo(
-			kern,
-			"  arg%u = pg_%s_param(kcxt,%d);\n",
-			i+1, arg_typename, i);
+
+		/* varlena argument may be loaded by direct DMA */
+		if (get_typlen(type_oid) == -1)
+			appendStringInfo(
+				kern,
+				"  pg_datum_ref(kcxt,arg%u,plcuda_varlena_param(kplcuda,kcxt,%d));\n",
+				i+1, i);
+		else
+			appendStringInfo(
+				kern,
+				"  arg%u = pg_%s_param(kcxt,%d);\n",
+				i+1, arg_typename, i);
 	}
 
 	appendStringInfo(
@@ -1262,6 +1333,7 @@ plcuda_codegen(Form_pg_proc procForm, plcudaCodeProperty *prop)
 							(OidIsValid(prop->fn_prep_kern_blocksz) ||
 							 prop->val_prep_kern_blocksz > 0),
 							procForm,
+							prop->lobj_args,
 							last_stage);
 		last_stage = "prep";
 	}
@@ -1272,6 +1344,7 @@ plcuda_codegen(Form_pg_proc procForm, plcudaCodeProperty *prop)
 							(OidIsValid(prop->fn_main_kern_blocksz) ||
 							 prop->val_main_kern_blocksz > 0),
 							procForm,
+							prop->lobj_args,
 							last_stage);
 		last_stage = "main";
 	}
@@ -1282,6 +1355,7 @@ plcuda_codegen(Form_pg_proc procForm, plcudaCodeProperty *prop)
 							(OidIsValid(prop->fn_post_kern_blocksz) ||
 							 prop->val_post_kern_blocksz > 0),
 							procForm,
+							prop->lobj_args,
 							last_stage);
 		last_stage = "post";
 	}
@@ -1449,7 +1523,7 @@ plcuda_assign_kernel_properties(plcudaTaskState *plts)
 	CUfunction	cuda_function;
 	CUresult	rc;
 
-	cuda_module = pgstrom_load_cuda_program(plts->gts.program_id);
+	cuda_module = pgstrom_load_cuda_program(plts->gts.program_id, 0);
 	/* prep kernel */
 	rc = cuModuleGetFunction(&cuda_function, cuda_module,
 							 "plcuda_prep_kernel_entrypoint");
@@ -1627,6 +1701,7 @@ plcuda_exec_begin(HeapTuple protup, FunctionCallInfo fcinfo)
 	plts->gts.cb_process_task = plcuda_process_task;
 	plts->gts.cb_release_task = plcuda_release_task;
 	dlist_init(&plts->gts.ready_tasks);
+	plts->retset = procForm->proretset;
 
 	/* validate PL/CUDA source code */
 	procForm = (Form_pg_proc) GETSTRUCT(protup);
@@ -1710,11 +1785,6 @@ plcuda_function_validator(PG_FUNCTION_ARGS)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("Unable to use PL/CUDA for window functions")));
-	if (procForm->proretset)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("Righ now, PL/CUDA function does not support set returning function")));
-
 	/*
 	 * Only validation of the CUDA code. Run synchronous code build, then
 	 * raise an error if code block has any error.
@@ -1769,6 +1839,72 @@ kernel_launch_helper(FunctionCallInfo __fcinfo,	/* PL/CUDA's fcinfo */
 	return result;
 }
 
+/*
+ * plcuda_argument_direct_dma
+ *
+ * It checks whether the varlena argument is large enough to be loaded onto
+ * the device memory by direct DMA, instead of copy to the parameter buffer.
+ */
+static bool
+plcuda_argument_direct_dma(kern_colmeta *cmeta, int index, Datum datum)
+{
+	if (cmeta->attlen >= 0 || cmeta->atttypid == REGGSTOREOID)
+		return false;
+	if (index >= sizeof(cl_ulong) * BITS_PER_BYTE)
+		return false;
+	if (plcuda_direct_dma_threshold_kb < 0)
+		return false;
+	return (toast_raw_datum_size(datum) >=
+			(Size)plcuda_direct_dma_threshold_kb * 1024);
+}
+
+/*
+ * plcuda_load_argument_direct
+ *
+ * It loads the varlena argument onto the dedicated device memory.
+ * Host memory is page-locked during the transfer, so DMA engine can copy
+ * the datum directly, without bounce buffer by the driver.
+ */
+static CUdeviceptr
+plcuda_load_argument_direct(GpuContext *gcontext, void *vl_ptr, Size vl_len)
+{
+	CUdeviceptr	m_devptr;
+	CUresult	rc;
+	bool		host_registered = false;
+
+	rc = gpuMemAlloc(gcontext, &m_devptr, vl_len);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAlloc: %s", errorText(rc));
+
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+
+	rc = cuMemHostRegister(vl_ptr, vl_len, 0);
+	if (rc == CUDA_SUCCESS)
+		host_registered = true;
+	else if (rc != CUDA_ERROR_HOST_MEMORY_ALREADY_REGISTERED)
+		elog(DEBUG1, "failed on cuMemHostRegister: %s, uses pageable copy",
+			 errorText(rc));
+
+	rc = cuMemcpyHtoD(m_devptr, vl_ptr, vl_len);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+
+	if (host_registered)
+	{
+		rc = cuMemHostUnregister(vl_ptr);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemHostUnregister: %s", errorText(rc));
+	}
+
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
+
+	return m_devptr;
+}
+
 /*
  * create_plcuda_task
  */
@@ -1817,8 +1953,12 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 			continue;
 		if (cmeta.atttypid == REGGSTOREOID)
 			total_length += MAXALIGN(sizeof(CUdeviceptr));
+		else if ((plts->p.lobj_args & (1UL << i)) != 0)
+			total_length += MAXALIGN(sizeof(kern_largeobject_t));
 		else if (cmeta.attlen > 0)
 			total_length += MAXALIGN(cmeta.attlen);
+		else if (plcuda_argument_direct_dma(&cmeta, i, fcinfo->arg[i]))
+			total_length += MAXALIGN(sizeof(CUdeviceptr));
 		else
 			total_length += MAXALIGN(toast_raw_datum_size(fcinfo->arg[i]));
 	}
@@ -1850,6 +1990,7 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 	ptask->gstore_oid_list = gstore_oid_list;
 	ptask->gstore_devptr_list = gstore_devptr_list;
 	ptask->gstore_dindex_list = gstore_dindex_list;
+	ptask->retset = plts->retset;
 
 	/* setup kern_plcuda */
 	memcpy(&ptask->kern, kplcuda_head, kplcuda_head->length);
@@ -1857,6 +1998,10 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 	ptask->kern.working_usage = 0UL;
 	ptask->kern.results_bufsz = results_bufsz;
 	ptask->kern.results_usage = 0UL;
+	ptask->kern.dma_args = 0UL;
+	ptask->kern.retset_round = 0;
+	ptask->kern.retset_nitems = 0;
+	ptask->kern.retset_more = false;
 
 	/* setup default result value */
 	cmeta = &ptask->kern.retmeta;
@@ -1875,6 +2020,11 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 	kparams = KERN_PLCUDA_PARAMBUF(&ptask->kern);
 	kparams->hostptr = (hostptr_t) kparams;
 	kparams->xactStartTimestamp = GetCurrentTransactionStartTimestamp();
+	kparams->xactSnapshotXmin = 0;
+	kparams->nCommittedXids = 0;
+	kparams->random_seed = ((cl_ulong)random() << 32) ^ (cl_ulong)random();
+	kparams->tablesample_cutoff = 0;
+	kparams->tablesample_seed = 0;
 
 	offset = STROMALIGN(offsetof(kern_parambuf,
 								 poffset[fcinfo->nargs]));
@@ -1910,6 +2060,22 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 				offset += MAXALIGN(sizeof(CUdeviceptr));
 			}
 		}
+		else if ((plts->p.lobj_args & (1UL << i)) != 0)
+		{
+			Oid			loid = DatumGetObjectId(fcinfo->arg[i]);
+			kern_largeobject_t lobj;
+			size_t		length;
+
+			lobj.ptr = pgstrom_lo_load_device(gcontext, loid, &length);
+			lobj.length = length;
+			ptask->dma_devptr_list = lappend(ptask->dma_devptr_list,
+											 (void *)lobj.ptr);
+			kparams->poffset[i] = offset;
+			memcpy((char *)kparams + offset,
+				   &lobj,
+				   sizeof(kern_largeobject_t));
+			offset += MAXALIGN(sizeof(kern_largeobject_t));
+		}
 		else if (cmeta.attbyval)
 		{
 			kparams->poffset[i] = offset;
@@ -1927,6 +2093,23 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 				   cmeta.attlen);
 			offset += MAXALIGN(cmeta.attlen);
 		}
+		else if (plcuda_argument_direct_dma(&cmeta, i, fcinfo->arg[i]))
+		{
+			char	   *vl_ptr = (char *)PG_DETOAST_DATUM(fcinfo->arg[i]);
+			Size		vl_len = VARSIZE_ANY(vl_ptr);
+			CUdeviceptr	m_devptr;
+
+			m_devptr = plcuda_load_argument_direct(gcontext, vl_ptr, vl_len);
+			ptask->dma_devptr_list = lappend(ptask->dma_devptr_list,
+											 (void *)m_devptr);
+			ptask->kern.dma_args |= (1UL << i);
+
+			kparams->poffset[i] = offset;
+			memcpy((char *)kparams + offset,
+				   &m_devptr,
+				   sizeof(CUdeviceptr));
+			offset += MAXALIGN(sizeof(CUdeviceptr));
+		}
 		else
 		{
 			char   *vl_ptr = (char *)PG_DETOAST_DATUM(fcinfo->arg[i]);
@@ -1960,6 +2143,246 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 	return ptask;
 }
 
+/*
+ * plcuda_launch_task
+ */
+static void
+plcuda_launch_task(plcudaTaskState *plts, plcudaTask *ptask)
+{
+	GpuContext	   *gcontext = plts->gts.gcontext;
+
+	pthreadMutexLock(gcontext->mutex);
+	pgstromEnqueueGpuTask(gcontext, &ptask->task);
+	plts->gts.num_running_tasks++;
+	pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
+	pthreadMutexUnlock(gcontext->mutex);
+	plts->gts.scan_done = true;
+}
+
+/*
+ * plcuda_dump_debug_counters
+ *
+ * Dump the debug counter if valid values are set by kernel function
+ */
+static void
+plcuda_dump_debug_counters(plcudaTask *precv)
+{
+	if (precv->kern.plcuda_debug_count0)
+		elog(NOTICE, "PL/CUDA debug count0 => %lu",
+			 precv->kern.plcuda_debug_count0);
+	if (precv->kern.plcuda_debug_count1)
+		elog(NOTICE, "PL/CUDA debug count1 => %lu",
+			 precv->kern.plcuda_debug_count1);
+	if (precv->kern.plcuda_debug_count2)
+		elog(NOTICE, "PL/CUDA debug count2 => %lu",
+			 precv->kern.plcuda_debug_count2);
+	if (precv->kern.plcuda_debug_count3)
+		elog(NOTICE, "PL/CUDA debug count3 => %lu",
+			 precv->kern.plcuda_debug_count3);
+	if (precv->kern.plcuda_debug_count4)
+		elog(NOTICE, "PL/CUDA debug count4 => %lu",
+			 precv->kern.plcuda_debug_count4);
+	if (precv->kern.plcuda_debug_count5)
+		elog(NOTICE, "PL/CUDA debug count5 => %lu",
+			 precv->kern.plcuda_debug_count5);
+	if (precv->kern.plcuda_debug_count6)
+		elog(NOTICE, "PL/CUDA debug count6 => %lu",
+			 precv->kern.plcuda_debug_count6);
+	if (precv->kern.plcuda_debug_count7)
+		elog(NOTICE, "PL/CUDA debug count7 => %lu",
+			 precv->kern.plcuda_debug_count7);
+}
+
+/*
+ * plcuda_cleanup_task
+ *
+ * It releases the device memory acquired for the arguments, and plcudaTask
+ * itself. Results buffer is released by the caller.
+ */
+static void
+plcuda_cleanup_task(plcudaTaskState *plts, plcudaTask *ptask)
+{
+	GpuContext	   *gcontext = plts->gts.gcontext;
+	ListCell	   *lc1, *lc2, *lc3;
+
+	/* close gstore_fdw if any */
+	forthree(lc1, ptask->gstore_oid_list,
+			 lc2, ptask->gstore_devptr_list,
+			 lc3, ptask->gstore_dindex_list)
+	{
+		Oid			gstore_oid __attribute__((unused)) = lfirst_oid(lc1);
+		CUdeviceptr	m_deviceptr = (CUdeviceptr) lfirst(lc2);
+		cl_int		cuda_dindex = lfirst_int(lc3);
+
+		if (cuda_dindex < 0)
+			gpuMemFree(gcontext, m_deviceptr);
+		else
+			gpuIpcCloseMemHandle(gcontext, m_deviceptr);
+	}
+	/* release arguments loaded by direct DMA */
+	foreach (lc1, ptask->dma_devptr_list)
+		gpuMemFree(gcontext, (CUdeviceptr) lfirst(lc1));
+	/* working buffer kept by set-returning function */
+	if (ptask->m_working_buf)
+		gpuMemFree(gcontext, ptask->m_working_buf);
+	gpuMemFree(gcontext, (CUdeviceptr)ptask);
+}
+
+/*
+ * plcuda_retset_shutdown
+ *
+ * It releases the resources of set-returning function, when all the rows
+ * are returned or executor stops the scan in the middle.
+ */
+static void
+plcuda_retset_shutdown(Datum arg)
+{
+	plcudaTaskState *plts = (plcudaTaskState *) DatumGetPointer(arg);
+	plcudaTask	   *ptask = plts->retset_task;
+
+	if (!ptask)
+		return;
+	/* wait for completion of the round in progress */
+	if (plts->retset_running)
+	{
+		fetch_next_gputask(&plts->gts);
+		plts->retset_running = false;
+	}
+	if (ptask->m_results_buf)
+	{
+		if (plts->last_results_buf == ptask->m_results_buf)
+			plts->last_results_buf = 0UL;
+		gpuMemFree(plts->gts.gcontext, ptask->m_results_buf);
+	}
+	plcuda_cleanup_task(plts, ptask);
+
+	if (plts->retset_rows)
+		pfree(plts->retset_rows);
+	plts->retset_task = NULL;
+	plts->retset_rows = NULL;
+	plts->retset_usage = 0;
+	plts->retset_offset = 0;
+}
+
+/*
+ * plcuda_retset_fetch
+ *
+ * It waits for completion of the round of kernels, then picks up the rows
+ * on the results buffer. If kernel has more rows to return, the next round
+ * is launched immediately, so GPU can produce the next rows while backend
+ * returns the current ones.
+ */
+static void
+plcuda_retset_fetch(plcudaTaskState *plts)
+{
+	plcudaTask	   *ptask = plts->retset_task;
+	plcudaTask	   *precv;
+	size_t			usage;
+
+	Assert(plts->retset_running);
+	precv = (plcudaTask *) fetch_next_gputask(&plts->gts);
+	plts->retset_running = false;
+	if (!precv)
+		elog(ERROR, "PL/CUDA GPU Task has gone to somewhere...");
+	Assert(precv == ptask);
+
+	plcuda_dump_debug_counters(precv);
+	if (precv->task.kerror.errcode != StromError_Success)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("PL/CUDA execution error (%s)",
+						errorTextKernel(&precv->task.kerror))));
+
+	usage = precv->kern.results_usage;
+	if (usage > precv->kern.results_bufsz)
+		elog(ERROR, "PL/CUDA: results buffer overflow (usage: %zu of %zu)",
+			 usage, (size_t)precv->kern.results_bufsz);
+	memcpy(plts->retset_rows, (char *)precv->m_results_buf, usage);
+	plts->retset_usage = usage;
+	plts->retset_offset = 0;
+	elog(DEBUG2, "PL/CUDA round %u returned %u rows (%zu bytes)%s",
+		 precv->kern.retset_round,
+		 precv->kern.retset_nitems, usage,
+		 precv->kern.retset_more ? ", more rows" : "");
+
+	if (precv->kern.retset_more)
+	{
+		if (precv->kern.retset_nitems == 0)
+			elog(ERROR, "PL/CUDA: kernel required the next round without returning any rows");
+		/* kick the next round; prep-kernel runs only at the first one */
+		precv->exec_prep_kernel = false;
+		memset(&precv->kern.kerror_main, 0, sizeof(kern_errorbuf));
+		memset(&precv->kern.kerror_post, 0, sizeof(kern_errorbuf));
+		precv->kern.results_usage = 0UL;
+		precv->kern.retset_round++;
+		precv->kern.retset_nitems = 0;
+		precv->kern.retset_more = false;
+		plcuda_launch_task(plts, precv);
+		plts->retset_running = true;
+	}
+}
+
+/*
+ * plcuda_retset_next
+ *
+ * It returns the next row of the set-returning function, in the value-per-
+ * call mode.
+ */
+static Datum
+plcuda_retset_next(FunctionCallInfo fcinfo, plcudaTaskState *plts)
+{
+	ReturnSetInfo  *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	kern_colmeta   *cmeta = &plts->kplcuda_head->retmeta;
+	kern_plcuda_retrow *row;
+	Datum			retval = 0;
+
+	while (plts->retset_offset >= plts->retset_usage)
+	{
+		if (!plts->retset_running)
+		{
+			/* no more rows */
+			UnregisterExprContextCallback(rsinfo->econtext,
+										  plcuda_retset_shutdown,
+										  PointerGetDatum(plts));
+			plcuda_retset_shutdown(PointerGetDatum(plts));
+			rsinfo->isDone = ExprEndResult;
+			PG_RETURN_NULL();
+		}
+		plcuda_retset_fetch(plts);
+	}
+	row = (kern_plcuda_retrow *)(plts->retset_rows + plts->retset_offset);
+	plts->retset_offset += MAXALIGN(offsetof(kern_plcuda_retrow,
+											 data[row->length]));
+	if (plts->retset_offset > plts->retset_usage)
+		elog(ERROR, "PL/CUDA: results buffer is corrupted");
+
+	rsinfo->isDone = ExprMultipleResult;
+	if (row->length == 0)
+		PG_RETURN_NULL();
+	if (cmeta->attlen > 0)
+	{
+		if (row->length != cmeta->attlen)
+			elog(ERROR, "PL/CUDA: length of the result row (%u) mismatch to %s",
+				 row->length, format_type_be(cmeta->atttypid));
+		if (cmeta->attbyval)
+			memcpy(&retval, row->data, cmeta->attlen);
+		else
+		{
+			retval = PointerGetDatum(palloc(cmeta->attlen));
+			memcpy(DatumGetPointer(retval), row->data, cmeta->attlen);
+		}
+	}
+	else
+	{
+		if (VARSIZE_ANY(row->data) != row->length)
+			elog(ERROR, "PL/CUDA: length of the result row (%u) mismatch to its varlena header (%zu)",
+				 row->length, (size_t)VARSIZE_ANY(row->data));
+		retval = PointerGetDatum(palloc(row->length));
+		memcpy(DatumGetPointer(retval), row->data, row->length);
+	}
+	PG_RETURN_DATUM(retval);
+}
+
 Datum
 plcuda_function_handler(PG_FUNCTION_ARGS)
 {
@@ -1967,13 +2390,11 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 	plcudaTaskState *plts;
 	plcudaTask	   *ptask;
 	plcudaTask	   *precv;
-	GpuContext	   *gcontext;
 	Size			working_bufsz;
 	Size			results_bufsz;
 	kern_errorbuf	kerror;
 	Datum			retval = 0;
 	bool			isnull = false;
-	ListCell	   *lc1, *lc2, *lc3;
 
 	if (!flinfo->fn_extra)
 	{
@@ -1995,9 +2416,23 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 	else
 	{
 		plts = (plcudaTaskState *) flinfo->fn_extra;
+		/* continuation of the set-returning function */
+		if (plts->retset_task)
+			return plcuda_retset_next(fcinfo, plts);
 		pgstromRescanGpuTaskState(&plts->gts);
 	}
 
+	if (plts->retset)
+	{
+		ReturnSetInfo  *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+		if (!rsinfo || !IsA(rsinfo, ReturnSetInfo) ||
+			(rsinfo->allowedModes & SFRM_ValuePerCall) == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("set-valued function called in context that cannot accept a set")));
+	}
+
 	/* results buffer of last invocation will not be used no longer */
 	if (plts->last_results_buf)
 	{
@@ -2027,6 +2462,8 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 										   NULL));
 	elog(DEBUG2, "working_bufsz = %zu, results_bufsz = %zu",
 		 working_bufsz, results_bufsz);
+	if (plts->retset && results_bufsz == 0)
+		elog(ERROR, "PL/CUDA set-returning function requires results buffer");
 
 	/* construction of plcudaTask structure */
 	ptask = create_plcuda_task(plts, fcinfo,
@@ -2271,49 +2708,34 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 		PG_END_TRY();
 	}
 
+	/* Stream the rows of set-returning function */
+	if (plts->retset)
+	{
+		ReturnSetInfo  *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+		rsinfo->returnMode = SFRM_ValuePerCall;
+		plts->retset_rows = MemoryContextAllocHuge(flinfo->fn_mcxt,
+												   results_bufsz);
+		plts->retset_task = ptask;
+		RegisterExprContextCallback(rsinfo->econtext,
+									plcuda_retset_shutdown,
+									PointerGetDatum(plts));
+		plcuda_launch_task(plts, ptask);
+		plts->retset_running = true;
+
+		return plcuda_retset_next(fcinfo, plts);
+	}
+
 	/* Exec PL/CUDA function by GPU */
-	gcontext = plts->gts.gcontext;
-	pthreadMutexLock(gcontext->mutex);
-	dlist_push_tail(&gcontext->pending_tasks, &ptask->task.chain);
-	plts->gts.num_running_tasks++;
-	pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
-	pthreadCondSignal(gcontext->cond);
-	pthreadMutexUnlock(gcontext->mutex);
+	plcuda_launch_task(plts, ptask);
 
 	/* Wait for the completion */
-	plts->gts.scan_done = true;
 	precv = (plcudaTask *) fetch_next_gputask(&plts->gts);
 	if (!precv)
 		elog(ERROR, "PL/CUDA GPU Task has gone to somewhere...");
 	Assert(precv == ptask);
 
-	/*
-	 * Dump the debug counter if valid values are set by kernel function
-	 */
-	if (precv->kern.plcuda_debug_count0)
-		elog(NOTICE, "PL/CUDA debug count0 => %lu",
-			 precv->kern.plcuda_debug_count0);
-	if (precv->kern.plcuda_debug_count1)
-		elog(NOTICE, "PL/CUDA debug count1 => %lu",
-			 precv->kern.plcuda_debug_count1);
-	if (precv->kern.plcuda_debug_count2)
-		elog(NOTICE, "PL/CUDA debug count2 => %lu",
-			 precv->kern.plcuda_debug_count2);
-	if (precv->kern.plcuda_debug_count3)
-		elog(NOTICE, "PL/CUDA debug count3 => %lu",
-			 precv->kern.plcuda_debug_count3);
-	if (precv->kern.plcuda_debug_count4)
-		elog(NOTICE, "PL/CUDA debug count4 => %lu",
-			 precv->kern.plcuda_debug_count4);
-	if (precv->kern.plcuda_debug_count5)
-		elog(NOTICE, "PL/CUDA debug count5 => %lu",
-			 precv->kern.plcuda_debug_count5);
-	if (precv->kern.plcuda_debug_count6)
-		elog(NOTICE, "PL/CUDA debug count6 => %lu",
-			 precv->kern.plcuda_debug_count6);
-	if (precv->kern.plcuda_debug_count7)
-		elog(NOTICE, "PL/CUDA debug count7 => %lu",
-			 precv->kern.plcuda_debug_count7);
+	plcuda_dump_debug_counters(precv);
 
 	if (precv->task.kerror.errcode == StromError_Success)
 	{
@@ -2377,21 +2799,7 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 							errorTextKernel(&kerror))));
 		}
 	}
-	/* close gstore_fdw if any */
-	forthree(lc1, ptask->gstore_oid_list,
-			 lc2, ptask->gstore_devptr_list,
-			 lc3, ptask->gstore_dindex_list)
-	{
-		Oid			gstore_oid __attribute__((unused)) = lfirst_oid(lc1);
-		CUdeviceptr	m_deviceptr = (CUdeviceptr) lfirst(lc2);
-		cl_int		cuda_dindex = lfirst_int(lc3);
-
-		if (cuda_dindex < 0)
-			gpuMemFree(plts->gts.gcontext, m_deviceptr);
-		else
-			gpuIpcCloseMemHandle(plts->gts.gcontext, m_deviceptr);
-	}
-	gpuMemFree(plts->gts.gcontext, (CUdeviceptr)ptask);
+	plcuda_cleanup_task(plts, ptask);
 
 	if (isnull)
 		PG_RETURN_NULL();
@@ -2503,7 +2911,9 @@ plcuda_process_task(GpuTask *gtask, CUmodule cuda_module)
 	}
 
 	/* working buffer if required */
-	if (ptask->kern.working_bufsz > 0)
+	if (ptask->m_working_buf != 0UL)
+		m_working_buf = ptask->m_working_buf;	/* kept by the last round */
+	else if (ptask->kern.working_bufsz > 0)
 	{
 		rc = gpuMemAllocManaged(gcontext,
 								&m_working_buf,
@@ -2513,6 +2923,9 @@ plcuda_process_task(GpuTask *gtask, CUmodule cuda_module)
 			goto out_of_resource;
 		else if (rc != CUDA_SUCCESS)
 			werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+		/* set-returning function keeps the working buffer across rounds */
+		if (ptask->retset)
+			ptask->m_working_buf = m_working_buf;
 	}
 
 	/* move the control block + argument buffer */
@@ -2701,7 +3114,7 @@ plcuda_process_task(GpuTask *gtask, CUmodule cuda_module)
 	retval = 0;
 
 out_of_resource:
-	if (m_working_buf != 0UL)
+	if (m_working_buf != 0UL && m_working_buf != ptask->m_working_buf)
 	{
 		rc = gpuMemFree(gcontext, m_working_buf);
 		if (rc != CUDA_SUCCESS)
@@ -2721,6 +3134,8 @@ plcuda_release_task(GpuTask *gtask)
 
 	if (ptask->m_results_buf)
 		gpuMemFree(gcontext, ptask->m_results_buf);
+	if (ptask->m_working_buf)
+		gpuMemFree(gcontext, ptask->m_working_buf);
 	gpuMemFree(gcontext, (CUdeviceptr)ptask);
 }
 
@@ -2730,6 +3145,16 @@ plcuda_release_task(GpuTask *gtask)
 void
 pgstrom_init_plcuda(void)
 {
+	DefineCustomIntVariable("pg_strom.plcuda_direct_dma_threshold",
+							"threshold of PL/CUDA arguments to be loaded by direct DMA",
+							NULL,
+							&plcuda_direct_dma_threshold_kb,
+							4096,		/* 4MB */
+							-1,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	dlist_init(&plcuda_state_list);
 	RegisterResourceReleaseCallback(plcuda_cleanup_resources, NULL);
 }
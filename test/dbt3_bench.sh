@@ -0,0 +1,349 @@
+#!/bin/sh
+#
+# dbt3_bench.sh
+#
+# Benchmark driver that runs the 22 queries of DBT-3 under the combination
+# of PG-Strom on/off, NVMe-Strom on/off and columnar-cache cold/warm, then
+# reports per-query timings and per-phase GPU time in JSON or CSV format.
+# --
+# Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+# Copyright 2014-2018 (C) The PG-Strom Development Team
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+usage()
+{
+	cat <<EOF
+usage: $0 [options]
+
+  -d DBNAME     name of the benchmark database (default: dbt3_bench)
+  -s SCALE      scale factor of the DBT-3 data set (default: 10)
+  -o FILE       output file (default: stdout)
+  -f FORMAT     output format; 'json' or 'csv' (default: json)
+  -n COUNT      number of runs for each query/configuration (default: 3)
+  -q LIST       comma separated query numbers to run (default: 1-22)
+  -c LIST       comma separated configurations to run (default: all)
+                cpu, gpu, gpu+nvme, gpu+ccache, gpu+nvme+ccache
+  -S            skip creation of the database; reuse the existing one
+  -h            print this message
+EOF
+	exit 1
+}
+
+BENCH_DIR=`dirname "$0"`
+DBT3_DBGEN="$BENCH_DIR/dbt3/dbgen"
+PSQL=${PSQL:-psql}
+CREATEDB=${CREATEDB:-createdb}
+
+DBNAME=dbt3_bench
+SCALE=10
+OUTPUT=
+FORMAT=json
+COUNT=3
+QUERIES="1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22"
+CONFIGS="cpu gpu gpu+nvme gpu+ccache gpu+nvme+ccache"
+SKIP_INIT=0
+
+while getopts "d:s:o:f:n:q:c:Sh" opt
+do
+	case $opt in
+		d) DBNAME="$OPTARG" ;;
+		s) SCALE="$OPTARG" ;;
+		o) OUTPUT="$OPTARG" ;;
+		f) FORMAT="$OPTARG" ;;
+		n) COUNT="$OPTARG" ;;
+		q) QUERIES=`echo "$OPTARG" | tr ',' ' '` ;;
+		c) CONFIGS=`echo "$OPTARG" | tr ',' ' '` ;;
+		S) SKIP_INIT=1 ;;
+		*) usage ;;
+	esac
+done
+
+case "$FORMAT" in
+	json|csv) ;;
+	*) echo "unknown output format: $FORMAT" >&2; usage ;;
+esac
+
+for conf in $CONFIGS
+do
+	case "$conf" in
+		cpu|gpu|gpu+nvme|gpu+ccache|gpu+nvme+ccache) ;;
+		*) echo "unknown configuration: $conf" >&2; usage ;;
+	esac
+done
+
+DBT3_TABLES="supplier part partsupp customer orders lineitem nation region"
+
+#
+# init_database - creates DBT-3 tables, then loads the data set
+#
+init_database()
+{
+	if [ ! -x "$DBT3_DBGEN" ]; then
+		echo "$DBT3_DBGEN is not built; run 'make dbgen' first" >&2
+		exit 1
+	fi
+	$CREATEDB -l C "$DBNAME" || exit 1
+	(cd "$BENCH_DIR" && $PSQL -q -v ON_ERROR_STOP=1 "$DBNAME") <<EOF || exit 1
+SET client_min_messages = error;
+CREATE EXTENSION IF NOT EXISTS pg_strom;
+
+CREATE TABLE supplier (
+    s_suppkey  INTEGER,
+    s_name CHAR(25),
+    s_address VARCHAR(40),
+    s_nationkey INTEGER,
+    s_phone CHAR(15),
+    s_acctbal REAL,
+    s_comment VARCHAR(101));
+
+CREATE TABLE part (
+    p_partkey INTEGER,
+    p_name VARCHAR(55),
+    p_mfgr CHAR(25),
+    p_brand CHAR(10),
+    p_type VARCHAR(25),
+    p_size INTEGER,
+    p_container CHAR(10),
+    p_retailprice REAL,
+    p_comment VARCHAR(23));
+
+CREATE TABLE partsupp (
+    ps_partkey INTEGER,
+    ps_suppkey INTEGER,
+    ps_availqty INTEGER,
+    ps_supplycost REAL,
+    ps_comment VARCHAR(199));
+
+CREATE TABLE customer (
+    c_custkey INTEGER,
+    c_name VARCHAR(25),
+    c_address VARCHAR(40),
+    c_nationkey INTEGER,
+    c_phone CHAR(15),
+    c_acctbal REAL,
+    c_mktsegment CHAR(10),
+    c_comment VARCHAR(117));
+
+CREATE TABLE orders (
+    o_orderkey INTEGER,
+    o_custkey INTEGER,
+    o_orderstatus CHAR(1),
+    o_totalprice REAL,
+    o_orderdate DATE,
+    o_orderpriority CHAR(15),
+    o_clerk CHAR(15),
+    o_shippriority INTEGER,
+    o_comment VARCHAR(79));
+
+CREATE TABLE lineitem (
+    l_orderkey INTEGER,
+    l_partkey INTEGER,
+    l_suppkey INTEGER,
+    l_linenumber INTEGER,
+    l_quantity REAL,
+    l_extendedprice REAL,
+    l_discount REAL,
+    l_tax REAL,
+    l_returnflag CHAR(1),
+    l_linestatus CHAR(1),
+    l_shipdate DATE,
+    l_commitdate DATE,
+    l_receiptdate DATE,
+    l_shipinstruct CHAR(25),
+    l_shipmode CHAR(10),
+    l_comment VARCHAR(44));
+
+CREATE TABLE nation (
+    n_nationkey INTEGER,
+    n_name CHAR(25),
+    n_regionkey INTEGER,
+    n_comment VARCHAR(152));
+
+CREATE TABLE region (
+    r_regionkey INTEGER,
+    r_name CHAR(25),
+    r_comment VARCHAR(152));
+
+\copy supplier FROM PROGRAM './dbt3/dbgen -X -T s -s $SCALE' delimiter '|';
+\copy part     FROM PROGRAM './dbt3/dbgen -X -T P -s $SCALE' delimiter '|';
+\copy partsupp FROM PROGRAM './dbt3/dbgen -X -T S -s $SCALE' delimiter '|';
+\copy customer FROM PROGRAM './dbt3/dbgen -X -T c -s $SCALE' delimiter '|';
+\copy orders   FROM PROGRAM './dbt3/dbgen -X -T O -s $SCALE' delimiter '|';
+\copy lineitem FROM PROGRAM './dbt3/dbgen -X -T L -s $SCALE' delimiter '|';
+\copy nation   FROM PROGRAM './dbt3/dbgen -X -T n -s $SCALE' delimiter '|';
+\copy region   FROM PROGRAM './dbt3/dbgen -X -T r -s $SCALE' delimiter '|';
+
+VACUUM ANALYZE;
+EOF
+}
+
+#
+# setup_ccache - enables (warm) or disables (cold) columnar-cache on
+# the DBT-3 tables. Prewarm builds the cache synchronously, so queries
+# in the warm configuration never race with the background builders.
+#
+setup_ccache()
+{
+	for tbl in $DBT3_TABLES
+	do
+		if [ "$1" = "warm" ]; then
+			SQL="SELECT pgstrom_ccache_disabled('$tbl');
+                 SELECT pgstrom_ccache_enabled('$tbl');
+                 SELECT pgstrom_ccache_prewarm('$tbl');"
+		else
+			SQL="SELECT pgstrom_ccache_disabled('$tbl');"
+		fi
+		$PSQL -qAt -v ON_ERROR_STOP=1 "$DBNAME" -c "$SQL" > /dev/null || exit 1
+	done
+}
+
+#
+# build_query - prints the commands of the query file, with EXPLAIN
+# ANALYZE on the SELECT statement. Auxiliary statements like CREATE VIEW
+# of Q15 are kept as is. ':1' of Q1 is replaced by the default DELTA.
+#
+build_query()
+{
+	QFILE=`printf "%s/sql/dbt3-%02d.sql" "$BENCH_DIR" "$1"`
+	if [ ! -r "$QFILE" ]; then
+		echo "query file $QFILE not found" >&2
+		exit 1
+	fi
+	sed -e 's/--.*$//' -e 's/:1/90/g' "$QFILE" | awk '
+		BEGIN { stmt = "" }
+		{
+			stmt = stmt " " $0
+			if (index($0, ";") > 0)
+			{
+				sub(/^[ \t]+/, "", stmt)
+				if (tolower(substr(stmt, 1, 6)) == "select")
+					stmt = "EXPLAIN (ANALYZE, VERBOSE, FORMAT JSON) " stmt
+				print stmt
+				stmt = ""
+			}
+		}'
+}
+
+#
+# summarize_plan - extracts planning/execution time and sum of the
+# per-phase GPU time of all the nodes from EXPLAIN (FORMAT JSON).
+# Per-worker breakdown ("GPU Time (worker N)") is not counted twice.
+#
+summarize_plan()
+{
+	awk '
+		BEGIN {
+			plan = 0; exec = 0; in_gpu = 0
+			split("", phase)
+		}
+		/"Planning Time":/ { v = $0; gsub(/[^0-9.]/, "", v); plan = v }
+		/"Execution Time":/ { v = $0; gsub(/[^0-9.]/, "", v); exec = v }
+		/"GPU Time": \{/ { in_gpu = 1; next }
+		in_gpu && /\}/ { in_gpu = 0; next }
+		in_gpu {
+			split($0, kv, ":")
+			k = kv[1]; gsub(/[" \t]/, "", k)
+			v = kv[2]; gsub(/[^0-9.]/, "", v)
+			phase[k] += v
+		}
+		END {
+			printf "%s,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+				plan, exec,
+				phase["HostLoadTime"], phase["QueueWaitTime"],
+				phase["DMASendTime"], phase["KernelTime"],
+				phase["DMARecvTime"], phase["CPUFallbackTime"]
+		}'
+}
+
+#
+# run_config - runs all the queries under the configuration
+#
+run_config()
+{
+	CONF="$1"
+	case "$CONF" in
+		cpu)         GUCS="SET pg_strom.enabled = off;" ;;
+		gpu|gpu+ccache)
+		             GUCS="SET pg_strom.enabled = on;
+                           SET pg_strom.nvme_strom_enabled = off;" ;;
+		gpu+nvme|gpu+nvme+ccache)
+		             GUCS="SET pg_strom.enabled = on;
+                           SET pg_strom.nvme_strom_enabled = on;" ;;
+	esac
+	case "$CONF" in
+		*ccache) CCACHE=warm ;;
+		*)       CCACHE=cold ;;
+	esac
+	setup_ccache $CCACHE
+
+	for q in $QUERIES
+	do
+		i=1
+		while [ $i -le $COUNT ]
+		do
+			PLAN=`(echo "$GUCS"; build_query $q) | \
+				  $PSQL -qAt -v ON_ERROR_STOP=1 "$DBNAME" 2>&1`
+			if [ $? -ne 0 ]; then
+				echo "query $q failed on $CONF: $PLAN" >&2
+				STATUS=1
+				break
+			fi
+			SUMMARY=`echo "$PLAN" | summarize_plan`
+			ROW="$SCALE,$CONF,$q,$i,$SUMMARY"
+			if [ "$FORMAT" = "csv" ]; then
+				echo "$ROW"
+			else
+				echo "$ROW" | awk -F, '{
+					printf "%s  {\"scale\": %s, \"config\": \"%s\", " \
+						   "\"query\": %d, \"run\": %d, " \
+						   "\"planning_ms\": %s, \"execution_ms\": %s, " \
+						   "\"gpu_time_ms\": {\"load\": %s, \"queue\": %s, " \
+						   "\"dma_send\": %s, \"kernel\": %s, " \
+						   "\"dma_recv\": %s, \"fallback\": %s},\n" \
+						   "   \"plan\": ",
+						   sep, $1, $2, $3, $4, $5, $6,
+						   $7, $8, $9, $10, $11, $12
+				}' sep="$SEP"
+				echo "$PLAN" | sed -e 's/^/    /'
+				echo "  }"
+				SEP=","
+			fi
+			i=`expr $i + 1`
+		done
+	done
+}
+
+#
+# main
+#
+if [ $SKIP_INIT -eq 0 ]; then
+	init_database
+fi
+
+if [ -n "$OUTPUT" ]; then
+	exec > "$OUTPUT"
+fi
+
+STATUS=0
+SEP=
+if [ "$FORMAT" = "csv" ]; then
+	echo "scale,config,query,run,planning_ms,execution_ms,load_ms,queue_ms,dma_send_ms,kernel_ms,dma_recv_ms,fallback_ms"
+else
+	echo "["
+fi
+for conf in $CONFIGS
+do
+	run_config "$conf"
+done
+if [ "$FORMAT" = "json" ]; then
+	echo "]"
+fi
+exit $STATUS
@@ -37,6 +37,7 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <cuda.h>
 #include "../src/nvme_strom.h"
@@ -47,6 +48,7 @@
 static int	machine_format = 0;
 static int	print_license = 0;
 static int	detailed_output = 0;
+static int	device_calibration = 0;
 
 #define lengthof(array)		(sizeof (array) / sizeof ((array)[0]))
 	
@@ -318,6 +320,142 @@ static void output_device(CUdevice device, int dev_id)
 	}
 }
 
+/*
+ * calibrate_device
+ *
+ * It measures the DMA bandwidth from the host to device, and the latency
+ * to launch an empty kernel and wait for its completion, for the planner
+ * to adjust the cost factors according to the actual hardware. Unlike the
+ * device properties, calibration failure is not fatal; we just report
+ * nothing, then the planner uses the default cost factors.
+ */
+#define CALIBRATION_DMA_SIZE		(32UL << 20)	/* 32MB */
+#define CALIBRATION_DMA_LOOPS		8
+#define CALIBRATION_LAUNCH_LOOPS	200
+
+static const char *calibration_ptx =
+	".version 5.0\n"
+	".target sm_60\n"
+	".address_size 64\n"
+	".visible .entry gpuinfo_null_kernel()\n"
+	"{\n"
+	"	ret;\n"
+	"}\n";
+
+static void calibrate_device(CUdevice device, int dev_id)
+{
+	CUcontext	context;
+	CUmodule	module;
+	CUfunction	kern_null;
+	CUdeviceptr	dbuf;
+	void	   *hbuf;
+	CUevent		ev_start;
+	CUevent		ev_stop;
+	float		elapsed;
+	struct timespec tv1, tv2;
+	double		dma_bandwidth;	/* MB/s */
+	double		launch_latency;	/* ns */
+	int			i;
+	CUresult	rc;
+
+	rc = cuCtxCreate(&context, CU_CTX_SCHED_AUTO, device);
+	if (rc != CUDA_SUCCESS)
+	{
+		fprintf(stderr, "GPU%d: calibration failed (%d)\n", dev_id, (int)rc);
+		return;
+	}
+	rc = cuMemAllocHost(&hbuf, CALIBRATION_DMA_SIZE);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	memset(hbuf, 0, CALIBRATION_DMA_SIZE);
+	rc = cuMemAlloc(&dbuf, CALIBRATION_DMA_SIZE);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuEventCreate(&ev_start, CU_EVENT_DEFAULT);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuEventCreate(&ev_stop, CU_EVENT_DEFAULT);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+
+	/* DMA bandwidth (host-to-device); first one is warm-up */
+	rc = cuMemcpyHtoD(dbuf, hbuf, CALIBRATION_DMA_SIZE);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuEventRecord(ev_start, NULL);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	for (i=0; i < CALIBRATION_DMA_LOOPS; i++)
+	{
+		rc = cuMemcpyHtoDAsync(dbuf, hbuf, CALIBRATION_DMA_SIZE, NULL);
+		if (rc != CUDA_SUCCESS)
+			goto failed;
+	}
+	rc = cuEventRecord(ev_stop, NULL);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuEventSynchronize(ev_stop);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuEventElapsedTime(&elapsed, ev_start, ev_stop);
+	if (rc != CUDA_SUCCESS || elapsed <= 0.0)
+		goto failed;
+	/* bytes per microsecond is equivalent to MB/s */
+	dma_bandwidth = ((double)(CALIBRATION_DMA_SIZE * CALIBRATION_DMA_LOOPS) /
+					 ((double)elapsed * 1000.0));
+
+	/* kernel launch latency, including synchronization */
+	rc = cuModuleLoadData(&module, calibration_ptx);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuModuleGetFunction(&kern_null, module, "gpuinfo_null_kernel");
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuLaunchKernel(kern_null, 1, 1, 1, 1, 1, 1, 0, NULL, NULL, NULL);
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	rc = cuCtxSynchronize();
+	if (rc != CUDA_SUCCESS)
+		goto failed;
+	clock_gettime(CLOCK_MONOTONIC, &tv1);
+	for (i=0; i < CALIBRATION_LAUNCH_LOOPS; i++)
+	{
+		rc = cuLaunchKernel(kern_null, 1, 1, 1, 1, 1, 1, 0,
+							NULL, NULL, NULL);
+		if (rc != CUDA_SUCCESS)
+			goto failed;
+		rc = cuStreamSynchronize(NULL);
+		if (rc != CUDA_SUCCESS)
+			goto failed;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &tv2);
+	launch_latency = ((double)(tv2.tv_sec - tv1.tv_sec) * 1000000000.0 +
+					  (double)(tv2.tv_nsec - tv1.tv_nsec)) /
+		(double)CALIBRATION_LAUNCH_LOOPS;
+
+	if (!machine_format)
+	{
+		printf("DMA bandwidth (host to device): %.2fGB/s\n",
+			   dma_bandwidth / 1000.0);
+		printf("Kernel launch latency: %.1fus\n",
+			   launch_latency / 1000.0);
+	}
+	else
+	{
+		printf("DEVICE%d:CALIB_DMA_BANDWIDTH=%d\n",
+			   dev_id, (int)dma_bandwidth);
+		printf("DEVICE%d:CALIB_LAUNCH_LATENCY=%d\n",
+			   dev_id, (int)launch_latency);
+	}
+	cuCtxDestroy(context);
+	return;
+
+failed:
+	fprintf(stderr, "GPU%d: calibration failed (%d)\n", dev_id, (int)rc);
+	/* destroy of the context also releases the resources above */
+	cuCtxDestroy(context);
+}
+
 int main(int argc, char *argv[])
 {
 	CUdevice	device;
@@ -331,7 +469,7 @@ int main(int argc, char *argv[])
 	/*
 	 * Parse options
 	 */
-	while ((opt = getopt(argc, argv, "mldh")) != -1)
+	while ((opt = getopt(argc, argv, "mldch")) != -1)
 	{
 		switch (opt)
 		{
@@ -344,12 +482,16 @@ int main(int argc, char *argv[])
 			case 'd':
 				detailed_output = 1;
 				break;
+			case 'c':
+				device_calibration = 1;
+				break;
 			default:
 				fprintf(stderr, "unknown option: %c\n", opt);
 			case 'h':
 				fprintf(stderr,
-						"usage: %s [-d][-m][-h]\n"
+						"usage: %s [-d][-m][-c][-h]\n"
 						"  -d : detailed output\n"
+						"  -c : calibration of DMA and kernel launch\n"
 						"  -m : machine readable format\n"
 						"  -h : shows this message\n",
 						basename(argv[0]));
@@ -418,6 +560,8 @@ int main(int argc, char *argv[])
 		if (rc != CUDA_SUCCESS)
 			error_exit(rc, "failed on cuDeviceGet");
 		output_device(device, i);
+		if (device_calibration)
+			calibrate_device(device, i);
 	}
 	return 0;
 }
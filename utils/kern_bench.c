@@ -0,0 +1,2248 @@
+/*
+ * kern_bench.c
+ *
+ * Micro-benchmark harness for the GpuScan, GpuJoin and GpuPreAgg kernels.
+ *
+ * It builds the device code of cuda_gpuscan.h, cuda_gpujoin.h and
+ * cuda_gpupreagg.h with NVRTC, as cuda_program.c doing, together with
+ * a hand-written equivalent of the code PG-Strom generates for a simple
+ * synthetic query. Then, it launches the kernels towards synthetic
+ * kern_data_store in row, block and column format, and reports rows/sec,
+ * achieved bandwidth and theoretical SM occupancy for each block size.
+ * It allows to validate the performance of a new GPU generation, or of
+ * a modification of the device code, independently of PostgreSQL.
+ *
+ * The synthetic relation has the following schema:
+ *
+ *   outer (id int4, x float8, p1 float8, ... pN float8)
+ *   inner (id int4, y float8)          -- only GpuJoin
+ *
+ * and the benchmark runs the kernels for the queries below:
+ *
+ *   gpuscan   : SELECT id, x FROM outer WHERE x < $1
+ *   gpupreagg : SELECT count(*), sum(x) FROM outer WHERE x < $1
+ *   gpujoin   : SELECT o.id, o.x, i.y FROM outer o, inner i
+ *                WHERE o.id = i.id AND o.x < $1
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#define FRONTEND 1
+#include "postgres.h"
+#include "access/htup_details.h"
+#include "access/sysattr.h"
+#include "access/transam.h"
+#include "catalog/pg_type.h"
+#include "storage/bufpage.h"
+#include <libgen.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cuda.h>
+#include <nvrtc.h>
+
+#define MAXIMUM_ALIGNOF_SHIFT	3
+#include "../src/cuda_common.h"
+#include "../src/cuda_gpuscan.h"
+#include "../src/cuda_gpujoin.h"
+#include "../src/cuda_gpupreagg.h"
+
+#define NumOfSystemAttrs	(-(1+FirstLowInvalidHeapAttributeNumber))
+
+#define BENCH_MODE_GPUSCAN		1
+#define BENCH_MODE_GPUJOIN		2
+#define BENCH_MODE_GPUPREAGG	3
+
+#define BENCH_MAX_BLOCK_SIZES	32
+
+static const char  *cmdname;
+static int			bench_mode = BENCH_MODE_GPUSCAN;
+static int			bench_formats = 0;		/* bitmap of (1 << KDS_FORMAT_*) */
+static size_t		bench_nrows = 1000000;
+static int			bench_npayloads = 4;
+static double		bench_selectivity = 0.5;
+static size_t		bench_inner_nrows = 100000;
+static int			bench_nloops = 5;
+static int			bench_block_sizes[BENCH_MAX_BLOCK_SIZES];
+static int			bench_num_block_sizes = 0;
+static int			bench_dump_source = 0;
+static const char  *bench_include_path = PGSHAREDIR "/extension";
+
+/* properties of the target device */
+static CUdevice		cuda_device;
+static char			dev_name[256];
+static int			dev_mpu_nums;
+static int			dev_max_threads_per_mpu;
+static int			dev_warp_size;
+static int			dev_cap_major;
+static int			dev_cap_minor;
+
+/* synthetic values of the outer relation */
+static cl_int	   *synth_id;
+static cl_double   *synth_x;
+static cl_uint		pg_crc32_table[256];
+
+static void usage(void)
+{
+	fprintf(stderr,
+			"usage: %s [options...]\n"
+			"  options:\n"
+			"    -m <mode>     : one of gpuscan, gpujoin or gpupreagg\n"
+			"                    (default: gpuscan)\n"
+			"    -f <format>   : one of row, block or column; can be given\n"
+			"                    multiple times (default: all the formats)\n"
+			"    -n <nrows>    : number of outer rows (default: 1000000)\n"
+			"    -w <ncols>    : number of float8 payload columns (default: 4)\n"
+			"    -s <ratio>    : selectivity of the WHERE-clause (default: 0.5)\n"
+			"    -i <nrows>    : number of inner rows, only gpujoin\n"
+			"                    (default: 100000)\n"
+			"    -b <size>     : block size to be measured; can be given\n"
+			"                    multiple times (default: warpSize * 2^N and\n"
+			"                    the one gpuOptimalBlockSize() chooses)\n"
+			"    -l <loops>    : number of runs for each block size; the best\n"
+			"                    one is reported (default: 5)\n"
+			"    -d <device>   : specifies the target device (default: 0)\n"
+			"    -I <dir>      : directory of the PG-Strom device headers\n"
+			"                    (default: " PGSHAREDIR "/extension)\n"
+			"    -k            : dump the kernel source to be built\n"
+			"    -h            : print this message and exit\n",
+			cmdname);
+	exit(1);
+}
+
+static void cuda_error(CUresult rc, const char *apiname)
+{
+	const char *errName;
+	const char *errStr;
+
+	cuGetErrorName(rc, &errName);
+	cuGetErrorString(rc, &errStr);
+
+	fprintf(stderr, "failed on %s: %s - %s\n", apiname, errName, errStr);
+	exit(1);
+}
+
+static void nvrtc_error(nvrtcResult rc, const char *apiname)
+{
+	fprintf(stderr, "failed on %s: %s\n", apiname, nvrtcGetErrorString(rc));
+	exit(1);
+}
+
+static void *
+bench_alloc(size_t sz)
+{
+	void   *ptr = calloc(1, sz);
+
+	if (!ptr)
+	{
+		fputs("out of memory", stderr);
+		exit(1);
+	}
+	return ptr;
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Construction of the kernel source
+ *
+ * ----------------------------------------------------------------
+ */
+typedef struct
+{
+	char	   *data;
+	size_t		len;
+	size_t		size;
+} source_buf;
+
+static void
+appendSource(source_buf *buf, const char *fmt, ...)
+{
+	va_list		args;
+	int			nbytes;
+
+	for (;;)
+	{
+		if (buf->size - buf->len > 0)
+		{
+			va_start(args, fmt);
+			nbytes = vsnprintf(buf->data + buf->len,
+							   buf->size - buf->len, fmt, args);
+			va_end(args);
+			if (buf->len + nbytes < buf->size)
+			{
+				buf->len += nbytes;
+				return;
+			}
+		}
+		buf->size = (buf->size == 0 ? 16384 : 2 * buf->size);
+		buf->data = realloc(buf->data, buf->size);
+		if (!buf->data)
+		{
+			fputs("out of memory", stderr);
+			exit(1);
+		}
+	}
+}
+
+/*
+ * gpuscan_quals_eval(_column) for the WHERE-clause (x < $n)
+ */
+static void
+source_gpuscan_quals(source_buf *buf, int param_id)
+{
+	appendSource(
+		buf,
+		"static __shared__ kern_colvec gpuscan_quals_cvec[1];\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpuscan_quals_colvec_setup(kern_data_store *kds)\n"
+		"{\n"
+		"  if (get_local_id() == 0)\n"
+		"  {\n"
+		"    kern_colvec_init(&gpuscan_quals_cvec[0], kds, 1);\n"
+		"  }\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_bool)\n"
+		"gpuscan_quals_eval(kern_context *kcxt,\n"
+		"                   kern_data_store *kds,\n"
+		"                   ItemPointerData *t_self,\n"
+		"                   HeapTupleHeaderData *htup)\n"
+		"{\n"
+		"  void *addr __attribute__((unused));\n"
+		"  pg_float8_t KPARAM_%d = pg_float8_param(kcxt,%d);\n"
+		"  pg_float8_t KVAR_2;\n"
+		"\n"
+		"  assert(htup != NULL);\n"
+		"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds, htup);\n"
+		"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n"
+		"  KVAR_2 = pg_float8_datum_ref(kcxt,addr);\n"
+		"  EXTRACT_HEAP_TUPLE_END();\n"
+		"\n"
+		"  return EVAL(pgfn_float8lt(kcxt, KVAR_2, KPARAM_%d));\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_bool)\n"
+		"gpuscan_quals_eval_column(kern_context *kcxt,\n"
+		"                          kern_data_store *kds,\n"
+		"                          cl_uint row_index)\n"
+		"{\n"
+		"  void *addr __attribute__((unused));\n"
+		"  pg_float8_t KPARAM_%d = pg_float8_param(kcxt,%d);\n"
+		"  pg_float8_t KVAR_2;\n"
+		"\n"
+		"  addr = kern_colvec_datum(&gpuscan_quals_cvec[0],row_index);\n"
+		"  KVAR_2 = pg_float8_datum_ref(kcxt,addr);\n"
+		"\n"
+		"  return EVAL(pgfn_float8lt(kcxt, KVAR_2, KPARAM_%d));\n"
+		"}\n\n",
+		param_id, param_id, param_id,
+		param_id, param_id, param_id);
+}
+
+/*
+ * gpuscan_projection_(tuple|column) for the target-list (id, x)
+ */
+static void
+source_gpuscan_projection(source_buf *buf)
+{
+	appendSource(
+		buf,
+		"static __shared__ kern_colvec gpuscan_projection_cvec[2];\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpuscan_projection_colvec_setup(kern_data_store *kds)\n"
+		"{\n"
+		"  if (get_local_id() == 0)\n"
+		"  {\n"
+		"    kern_colvec_init(&gpuscan_projection_cvec[0], kds, 0);\n"
+		"    kern_colvec_init(&gpuscan_projection_cvec[1], kds, 1);\n"
+		"  }\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpuscan_projection_tuple(kern_context *kcxt,\n"
+		"                         kern_data_store *kds_src,\n"
+		"                         HeapTupleHeaderData *htup,\n"
+		"                         ItemPointerData *t_self,\n"
+		"                         Datum *tup_values,\n"
+		"                         cl_bool *tup_isnull,\n"
+		"                         char *tup_extra)\n"
+		"{\n"
+		"  void *addr __attribute__((unused));\n"
+		"\n"
+		"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds_src, htup);\n"
+		"  tup_isnull[0] = !addr;\n"
+		"  if (addr)\n"
+		"    tup_values[0] = READ_INT32_PTR(addr);\n"
+		"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n"
+		"  tup_isnull[1] = !addr;\n"
+		"  if (addr)\n"
+		"    tup_values[1] = READ_INT64_PTR(addr);\n"
+		"  EXTRACT_HEAP_TUPLE_END();\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpuscan_projection_column(kern_context *kcxt,\n"
+		"                          kern_data_store *kds_src,\n"
+		"                          size_t src_index,\n"
+		"                          Datum *tup_values,\n"
+		"                          cl_bool *tup_isnull,\n"
+		"                          char *tup_extra)\n"
+		"{\n"
+		"  void *addr __attribute__((unused));\n"
+		"\n"
+		"  addr = kern_colvec_datum(&gpuscan_projection_cvec[0],src_index);\n"
+		"  tup_isnull[0] = !addr;\n"
+		"  if (addr)\n"
+		"    tup_values[0] = READ_INT32_PTR(addr);\n"
+		"  addr = kern_colvec_datum(&gpuscan_projection_cvec[1],src_index);\n"
+		"  tup_isnull[1] = !addr;\n"
+		"  if (addr)\n"
+		"    tup_values[1] = READ_INT64_PTR(addr);\n"
+		"}\n\n");
+}
+
+/*
+ * GpuPreAgg functions for nogroup reduction of count(*) and sum(x)
+ */
+static void
+source_gpupreagg_functions(source_buf *buf)
+{
+	appendSource(
+		buf,
+		"STATIC_FUNCTION(cl_uint)\n"
+		"gpupreagg_hashvalue(kern_context *kcxt,\n"
+		"                    cl_uint *crc32_table,\n"
+		"                    cl_uint hash_value,\n"
+		"                    cl_bool *slot_isnull,\n"
+		"                    Datum *slot_values)\n"
+		"{\n"
+		"  return hash_value;\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_bool)\n"
+		"gpupreagg_keymatch(kern_context *kcxt,\n"
+		"                   kern_data_store *x_kds, size_t x_index,\n"
+		"                   kern_data_store *y_kds, size_t y_index)\n"
+		"{\n"
+		"  return true;\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpupreagg_local_calc(cl_int attnum,\n"
+		"                     cl_bool *p_accum_isnull,\n"
+		"                     Datum   *p_accum_datum,\n"
+		"                     cl_bool  newval_isnull,\n"
+		"                     Datum    newval_datum)\n"
+		"{\n"
+		"  switch (attnum)\n"
+		"  {\n"
+		"  case 0:\n"
+		"    aggcalc_atomic_add_long(p_accum_isnull, p_accum_datum,\n"
+		"                            newval_isnull, newval_datum);\n"
+		"    break;\n"
+		"  case 1:\n"
+		"    aggcalc_atomic_add_double(p_accum_isnull, p_accum_datum,\n"
+		"                              newval_isnull, newval_datum);\n"
+		"    break;\n"
+		"  default:\n"
+		"    break;\n"
+		"  }\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpupreagg_global_calc(cl_bool *accum_isnull,\n"
+		"                      Datum   *accum_values,\n"
+		"                      cl_bool *newval_isnull,\n"
+		"                      Datum   *newval_values)\n"
+		"{\n"
+		"  aggcalc_atomic_add_long(accum_isnull+0, accum_values+0,\n"
+		"                          newval_isnull[0], newval_values[0]);\n"
+		"  aggcalc_atomic_add_double(accum_isnull+1, accum_values+1,\n"
+		"                            newval_isnull[1], newval_values[1]);\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpupreagg_nogroup_calc(cl_int attnum,\n"
+		"                       cl_bool *p_accum_isnull,\n"
+		"                       Datum   *p_accum_datum,\n"
+		"                       cl_bool  newval_isnull,\n"
+		"                       Datum    newval_datum)\n"
+		"{\n"
+		"  switch (attnum)\n"
+		"  {\n"
+		"  case 0:\n"
+		"    aggcalc_normal_add_long(p_accum_isnull, p_accum_datum,\n"
+		"                            newval_isnull, newval_datum);\n"
+		"    break;\n"
+		"  case 1:\n"
+		"    aggcalc_normal_add_double(p_accum_isnull, p_accum_datum,\n"
+		"                              newval_isnull, newval_datum);\n"
+		"    break;\n"
+		"  default:\n"
+		"    break;\n"
+		"  }\n"
+		"}\n"
+		"\n"
+		"static __shared__ kern_colvec gpupreagg_projection_cvec[1];\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpupreagg_projection_colvec_setup(kern_data_store *kds_src)\n"
+		"{\n"
+		"  if (get_local_id() == 0)\n"
+		"  {\n"
+		"    kern_colvec_init(&gpupreagg_projection_cvec[0], kds_src, 1);\n"
+		"  }\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpupreagg_projection_row(kern_context *kcxt,\n"
+		"                         kern_data_store *kds_src,\n"
+		"                         HeapTupleHeaderData *htup,\n"
+		"                         Datum *dst_values,\n"
+		"                         cl_char *dst_isnull)\n"
+		"{\n"
+		"  void *addr __attribute__((unused));\n"
+		"  pg_float8_t KVAR_2;\n"
+		"\n"
+		"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds_src, htup);\n"
+		"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n"
+		"  KVAR_2 = pg_float8_datum_ref(kcxt,addr);\n"
+		"  EXTRACT_HEAP_TUPLE_END();\n"
+		"\n"
+		"  /* initial attribute 1 (nrows) */\n"
+		"  dst_isnull[0] = false;\n"
+		"  dst_values[0] = 1;\n"
+		"  /* initial attribute 2 (psum) */\n"
+		"  dst_isnull[1] = KVAR_2.isnull;\n"
+		"  if (!KVAR_2.isnull)\n"
+		"    dst_values[1] = pg_float8_as_datum(&KVAR_2.value);\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpupreagg_projection_column(kern_context *kcxt,\n"
+		"                            kern_data_store *kds_src,\n"
+		"                            cl_uint src_index,\n"
+		"                            Datum *dst_values,\n"
+		"                            cl_char *dst_isnull)\n"
+		"{\n"
+		"  void *addr __attribute__((unused));\n"
+		"  pg_float8_t KVAR_2;\n"
+		"\n"
+		"  addr = kern_colvec_datum(&gpupreagg_projection_cvec[0],src_index);\n"
+		"  KVAR_2 = pg_float8_datum_ref(kcxt,addr);\n"
+		"\n"
+		"  /* initial attribute 1 (nrows) */\n"
+		"  dst_isnull[0] = false;\n"
+		"  dst_values[0] = 1;\n"
+		"  /* initial attribute 2 (psum) */\n"
+		"  dst_isnull[1] = KVAR_2.isnull;\n"
+		"  if (!KVAR_2.isnull)\n"
+		"    dst_values[1] = pg_float8_as_datum(&KVAR_2.value);\n"
+		"}\n\n");
+}
+
+/*
+ * GpuJoin functions for the hash-join (o.id = i.id) and the projection
+ * of (o.id, o.x, i.y)
+ */
+#define SOURCE_GPUJOIN_LOAD_OUTER_ID							\
+	"  /* variable load in depth-0 (outer KDS) */\n"			\
+	"  offset = (!o_buffer ? 0 : o_buffer[0]);\n"				\
+	"  if (!kds)\n"												\
+	"    datum = NULL;\n"										\
+	"  else if (kds->format != KDS_FORMAT_COLUMN)\n"			\
+	"  {\n"														\
+	"    if (kds->format == KDS_FORMAT_ROW)\n"					\
+	"      htup = KDS_ROW_REF_HTUP(kds,offset,NULL,NULL);\n"	\
+	"    else\n"												\
+	"      htup = KDS_BLOCK_REF_HTUP(kds,offset,NULL,NULL);\n"	\
+	"    datum = GPUJOIN_REF_DATUM(kds->colmeta,htup,0);\n"		\
+	"  }\n"														\
+	"  else if (offset > 0)\n"									\
+	"    datum = kern_get_datum_column(kds,0,offset-1);\n"		\
+	"  else\n"													\
+	"    datum = NULL;\n"										\
+	"  KVAR_1 = pg_int4_datum_ref(kcxt,datum);\n"
+
+static void
+source_gpujoin_functions(source_buf *buf)
+{
+	appendSource(
+		buf,
+		"STATIC_FUNCTION(cl_bool)\n"
+		"gpujoin_join_quals_depth1(kern_context *kcxt,\n"
+		"                          kern_data_store *kds,\n"
+		"                          kern_multirels *kmrels,\n"
+		"                          cl_uint *o_buffer,\n"
+		"                          HeapTupleHeaderData *i_htup,\n"
+		"                          cl_bool *joinquals_matched)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup __attribute__((unused));\n"
+		"  kern_data_store *kds_in __attribute__((unused));\n"
+		"  void *datum __attribute__((unused));\n"
+		"  cl_uint offset __attribute__((unused));\n"
+		"  pg_int4_t KVAR_1;\n"
+		"  pg_int4_t KVAR_3;\n"
+		"\n"
+		SOURCE_GPUJOIN_LOAD_OUTER_ID
+		"\n"
+		"  /* variable load in depth-1 (inner KDS) */\n"
+		"  kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, 1);\n"
+		"  if (!o_buffer)\n"
+		"    htup = NULL;\n"
+		"  else\n"
+		"    htup = i_htup;\n"
+		"  datum = GPUJOIN_REF_DATUM(kds_in->colmeta,htup,0);\n"
+		"  KVAR_3 = pg_int4_datum_ref(kcxt,datum);\n"
+		"\n"
+		"  if (i_htup && o_buffer && !EVAL(pgfn_int4eq(kcxt, KVAR_1, KVAR_3)))\n"
+		"  {\n"
+		"    if (joinquals_matched)\n"
+		"      *joinquals_matched = false;\n"
+		"    return false;\n"
+		"  }\n"
+		"  if (joinquals_matched)\n"
+		"    *joinquals_matched = true;\n"
+		"  return true;\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_uint)\n"
+		"gpujoin_hash_value_depth1(kern_context *kcxt,\n"
+		"                          cl_uint *pg_crc32_table,\n"
+		"                          kern_data_store *kds,\n"
+		"                          kern_multirels *kmrels,\n"
+		"                          cl_uint *o_buffer,\n"
+		"                          cl_bool *p_is_null_keys)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup __attribute__((unused));\n"
+		"  void *datum __attribute__((unused));\n"
+		"  cl_uint offset __attribute__((unused));\n"
+		"  cl_uint hash;\n"
+		"  pg_int4_t KVAR_1;\n"
+		"\n"
+		SOURCE_GPUJOIN_LOAD_OUTER_ID
+		"\n"
+		"  INIT_LEGACY_CRC32(hash);\n"
+		"  hash = pg_int4_comp_crc32(pg_crc32_table, hash, KVAR_1);\n"
+		"  FIN_LEGACY_CRC32(hash);\n"
+		"  *p_is_null_keys = KVAR_1.isnull;\n"
+		"\n"
+		"  return hash;\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_bool)\n"
+		"gpujoin_join_quals(kern_context *kcxt,\n"
+		"                   kern_data_store *kds,\n"
+		"                   kern_multirels *kmrels,\n"
+		"                   int depth,\n"
+		"                   cl_uint *o_buffer,\n"
+		"                   HeapTupleHeaderData *i_htup,\n"
+		"                   cl_bool *needs_outer_row)\n"
+		"{\n"
+		"  switch (depth)\n"
+		"  {\n"
+		"  case 1:\n"
+		"    return gpujoin_join_quals_depth1(kcxt, kds, kmrels, o_buffer, i_htup, needs_outer_row);\n"
+		"  default:\n"
+		"    STROM_SET_ERROR(&kcxt->e, StromError_WrongCodeGeneration);\n"
+		"    break;\n"
+		"  }\n"
+		"  return false;\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_uint)\n"
+		"gpujoin_hash_value(kern_context *kcxt,\n"
+		"                   cl_uint *pg_crc32_table,\n"
+		"                   kern_data_store *kds,\n"
+		"                   kern_multirels *kmrels,\n"
+		"                   cl_int depth,\n"
+		"                   cl_uint *o_buffer,\n"
+		"                   cl_bool *p_is_null_keys)\n"
+		"{\n"
+		"  switch (depth)\n"
+		"  {\n"
+		"  case 1:\n"
+		"    return gpujoin_hash_value_depth1(kcxt,pg_crc32_table,\n"
+		"                                     kds,kmrels,o_buffer,p_is_null_keys);\n"
+		"  default:\n"
+		"    STROM_SET_ERROR(&kcxt->e, StromError_WrongCodeGeneration);\n"
+		"    break;\n"
+		"  }\n"
+		"  return (cl_uint)(-1);\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(cl_int)\n"
+		"gpujoin_range_key(kern_context *kcxt,\n"
+		"                  kern_data_store *kds,\n"
+		"                  kern_multirels *kmrels,\n"
+		"                  cl_int depth,\n"
+		"                  cl_uint *o_buffer,\n"
+		"                  cl_long *p_lower,\n"
+		"                  cl_long *p_upper)\n"
+		"{\n"
+		"  return GPUJOIN_RANGE_KEY__FULL;\n"
+		"}\n"
+		"\n"
+		"STATIC_FUNCTION(void)\n"
+		"gpujoin_projection(kern_context *kcxt,\n"
+		"                   kern_data_store *kds_src,\n"
+		"                   kern_multirels *kmrels,\n"
+		"                   cl_uint *r_buffer,\n"
+		"                   kern_data_store *kds_dst,\n"
+		"                   Datum *tup_values,\n"
+		"                   cl_bool *tup_isnull,\n"
+		"                   cl_bool *use_extra_buf,\n"
+		"                   cl_char *extra_buf,\n"
+		"                   cl_uint *extra_len)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup __attribute__((unused));\n"
+		"  kern_data_store *kds_in __attribute__((unused));\n"
+		"  void *addr __attribute__((unused));\n"
+		"  cl_uint offset __attribute__((unused));\n"
+		"\n"
+		"  if (use_extra_buf)\n"
+		"    memset(use_extra_buf, 0, sizeof(cl_bool) * GPUJOIN_DEVICE_PROJECTION_NFIELDS);\n"
+		"\n"
+		"  /* ---- extract outer relation (depth=0) ---- */\n"
+		"  offset = r_buffer[0];\n"
+		"  if (kds_src->format != KDS_FORMAT_COLUMN)\n"
+		"  {\n"
+		"    if (kds_src->format == KDS_FORMAT_ROW)\n"
+		"      htup = KDS_ROW_REF_HTUP(kds_src,offset,NULL,NULL);\n"
+		"    else\n"
+		"      htup = KDS_BLOCK_REF_HTUP(kds_src,offset,NULL,NULL);\n"
+		"    EXTRACT_HEAP_TUPLE_BEGIN(addr, kds_src, htup);\n"
+		"    tup_isnull[0] = !addr;\n"
+		"    if (addr)\n"
+		"      tup_values[0] = READ_INT32_PTR(addr);\n"
+		"    EXTRACT_HEAP_TUPLE_NEXT(addr);\n"
+		"    tup_isnull[1] = !addr;\n"
+		"    if (addr)\n"
+		"      tup_values[1] = READ_INT64_PTR(addr);\n"
+		"    EXTRACT_HEAP_TUPLE_END();\n"
+		"  }\n"
+		"  else\n"
+		"  {\n"
+		"    addr = (offset == 0 ? NULL : kern_get_datum_column(kds_src,0,offset-1));\n"
+		"    tup_isnull[0] = !addr;\n"
+		"    if (addr)\n"
+		"      tup_values[0] = READ_INT32_PTR(addr);\n"
+		"    addr = (offset == 0 ? NULL : kern_get_datum_column(kds_src,1,offset-1));\n"
+		"    tup_isnull[1] = !addr;\n"
+		"    if (addr)\n"
+		"      tup_values[1] = READ_INT64_PTR(addr);\n"
+		"  }\n"
+		"\n"
+		"  /* ---- extract inner relation (depth=1) ---- */\n"
+		"  kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, 1);\n"
+		"  offset = r_buffer[1];\n"
+		"  htup = KDS_ROW_REF_HTUP(kds_in,offset,NULL,NULL);\n"
+		"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds_in, htup);\n"
+		"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n"
+		"  tup_isnull[2] = !addr;\n"
+		"  if (addr)\n"
+		"    tup_values[2] = READ_INT64_PTR(addr);\n"
+		"  EXTRACT_HEAP_TUPLE_END();\n"
+		"\n"
+		"  *extra_len = 0;\n"
+		"}\n\n");
+}
+
+/*
+ * construct_bench_source - it constructs the kernel source in the same
+ * layout of construct_flat_cuda_source() in cuda_program.c
+ */
+static char *
+construct_bench_source(void)
+{
+	source_buf	buf;
+
+	memset(&buf, 0, sizeof(source_buf));
+	appendSource(&buf,
+				 "#include <cuda_device_runtime_api.h>\n"
+				 "\n"
+				 "#define HOSTPTRLEN %u\n"
+				 "#define DEVICEPTRLEN %lu\n"
+				 "#define BLCKSZ %u\n"
+				 "#define MAXIMUM_ALIGNOF %u\n"
+				 "#define MAXIMUM_ALIGNOF_SHIFT %u\n"
+				 "#include \"cuda_common.h\"\n"
+				 "\n",
+				 SIZEOF_VOID_P,
+				 sizeof(CUdeviceptr),
+				 BLCKSZ,
+				 MAXIMUM_ALIGNOF,
+				 MAXIMUM_ALIGNOF_SHIFT);
+	/* kern_define */
+	switch (bench_mode)
+	{
+		case BENCH_MODE_GPUSCAN:
+			appendSource(&buf,
+						 "#define GPUSCAN_KERNEL_REQUIRED 1\n"
+						 "#define GPUSCAN_HAS_DEVICE_PROJECTION 1\n"
+						 "#define GPUSCAN_DEVICE_PROJECTION_NFIELDS 2\n"
+						 "#define GPUSCAN_DEVICE_PROJECTION_EXTRA_SIZE 0\n"
+						 "#define GPUSCAN_HAS_WHERE_QUALS 1\n");
+			break;
+		case BENCH_MODE_GPUJOIN:
+			appendSource(&buf,
+						 "#define GPUJOIN_MAX_DEPTH 1\n"
+						 "#define GPUJOIN_DEVICE_PROJECTION_NFIELDS 3\n"
+						 "#define GPUJOIN_DEVICE_PROJECTION_EXTRA_SIZE 0\n");
+			break;
+		case BENCH_MODE_GPUPREAGG:
+			appendSource(&buf,
+						 "#define GPUPREAGG_PULLUP_OUTER_SCAN 1\n"
+						 "#define GPUPREAGG_HAS_OUTER_QUALS 1\n");
+			break;
+	}
+	appendSource(&buf,
+				 "\n"
+				 "#include \"cuda_primitive.h\"\n"
+				 "\n"
+				 "typedef union {\n"
+				 "    pg_varlena_t     varlena_v;\n"
+				 "    pg_bool_t        bool_v;\n"
+				 "    pg_int2_t        int2_v;\n"
+				 "    pg_int4_t        int4_v;\n"
+				 "    pg_int8_t        int8_v;\n"
+				 "    pg_float2_t      float2_v;\n"
+				 "    pg_float4_t      float4_v;\n"
+				 "    pg_float8_t      float8_v;\n"
+				 "  } pg_anytype_t;\n"
+				 "\n"
+				 "#include \"cuda_gpuscan.h\"\n");
+	if (bench_mode == BENCH_MODE_GPUJOIN)
+		appendSource(&buf, "#include \"cuda_gpujoin.h\"\n");
+	if (bench_mode == BENCH_MODE_GPUPREAGG)
+		appendSource(&buf, "#include \"cuda_gpupreagg.h\"\n");
+	appendSource(&buf, "\n");
+
+	/* code to be generated on the fly */
+	switch (bench_mode)
+	{
+		case BENCH_MODE_GPUSCAN:
+			source_gpuscan_quals(&buf, 0);
+			source_gpuscan_projection(&buf);
+			break;
+		case BENCH_MODE_GPUJOIN:
+			source_gpuscan_quals(&buf, 0);
+			source_gpujoin_functions(&buf);
+			break;
+		case BENCH_MODE_GPUPREAGG:
+			/* KPARAM_0 is reserved for the attr_is_preagg flags */
+			source_gpuscan_quals(&buf, 1);
+			source_gpupreagg_functions(&buf);
+			break;
+	}
+	appendSource(&buf, "#include \"cuda_terminal.h\"\n");
+
+	return buf.data;
+}
+
+static CUmodule
+build_kernel_source(const char *source)
+{
+	nvrtcProgram	program;
+	nvrtcResult		rc;
+	char			include_buf[1024];
+	char			arch_buf[128];
+	const char	   *options[10];
+	int				opt_index = 0;
+	int				build_failure = 0;
+	char		   *build_log;
+	size_t			build_log_len;
+	char		   *ptx_image;
+	size_t			ptx_image_len;
+	CUmodule		cuda_module;
+	CUresult		cuda_rc;
+
+	rc = nvrtcCreateProgram(&program,
+							source,
+							"kern_bench.cu",
+							0,
+							NULL,
+							NULL);
+	if (rc != NVRTC_SUCCESS)
+		nvrtc_error(rc, "nvrtcCreateProgram");
+
+	/*
+	 * Put command line options as cuda_program.c doing
+	 */
+	options[opt_index++] = "-I " CUDA_INCLUDE_PATH;
+	snprintf(include_buf, sizeof(include_buf), "-I %s", bench_include_path);
+	options[opt_index++] = include_buf;
+	snprintf(arch_buf, sizeof(arch_buf),
+			 "--gpu-architecture=compute_%d%d", dev_cap_major, dev_cap_minor);
+	options[opt_index++] = arch_buf;
+#ifdef PGSTROM_DEBUG
+	options[opt_index++] = "--device-debug";
+	options[opt_index++] = "--generate-line-info";
+#endif
+	options[opt_index++] = "--use_fast_math";
+	options[opt_index++] = "--std=c++11";
+
+	/*
+	 * Kick runtime compiler
+	 */
+	rc = nvrtcCompileProgram(program, opt_index, options);
+	if (rc != NVRTC_SUCCESS)
+	{
+		if (rc == NVRTC_ERROR_COMPILATION)
+			build_failure = 1;
+		else
+			nvrtc_error(rc, "nvrtcCompileProgram");
+	}
+
+	/*
+	 * Print build log
+	 */
+	rc = nvrtcGetProgramLogSize(program, &build_log_len);
+	if (rc != NVRTC_SUCCESS)
+		nvrtc_error(rc, "nvrtcGetProgramLogSize");
+	build_log = bench_alloc(build_log_len + 1);
+	rc = nvrtcGetProgramLog(program, build_log);
+	if (rc != NVRTC_SUCCESS)
+		nvrtc_error(rc, "nvrtcGetProgramLog");
+	if (build_log_len > 1)
+		printf("build log:\n%s\n", build_log);
+	if (build_failure)
+		exit(1);
+
+	/*
+	 * Get PTX Image
+	 */
+	rc = nvrtcGetPTXSize(program, &ptx_image_len);
+	if (rc != NVRTC_SUCCESS)
+		nvrtc_error(rc, "nvrtcGetPTXSize");
+	ptx_image = bench_alloc(ptx_image_len + 1);
+	rc = nvrtcGetPTX(program, ptx_image);
+	if (rc != NVRTC_SUCCESS)
+		nvrtc_error(rc, "nvrtcGetPTX");
+	ptx_image[ptx_image_len] = '\0';
+
+	cuda_rc = cuModuleLoadData(&cuda_module, ptx_image);
+	if (cuda_rc != CUDA_SUCCESS)
+		cuda_error(cuda_rc, "cuModuleLoadData");
+
+	nvrtcDestroyProgram(&program);
+	free(build_log);
+	free(ptx_image);
+
+	return cuda_module;
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Construction of the synthetic kern_data_store
+ *
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * init_synthetic_values - values of the outer relation; id is a sequence
+ * except for GpuJoin, so that 50% of rows find its partner on the inner
+ * relation.
+ */
+static void
+init_synthetic_values(void)
+{
+	size_t		i;
+	cl_uint		j, k, crc;
+
+	synth_id = bench_alloc(sizeof(cl_int) * bench_nrows);
+	synth_x = bench_alloc(sizeof(cl_double) * bench_nrows);
+	srand48(20180401);
+	for (i=0; i < bench_nrows; i++)
+	{
+		if (bench_mode == BENCH_MODE_GPUJOIN)
+			synth_id[i] = lrand48() % (2 * bench_inner_nrows);
+		else
+			synth_id[i] = i;
+		synth_x[i] = drand48();
+	}
+
+	/* CRC32 table for hash-join; same role of kmrels->pg_crc32_table */
+	for (j=0; j < 256; j++)
+	{
+		crc = j << 24;
+		for (k=0; k < 8; k++)
+			crc = (crc & 0x80000000U) ? (crc << 1) ^ 0x04C11DB7U : (crc << 1);
+		pg_crc32_table[j] = crc;
+	}
+}
+
+static cl_uint
+synthetic_hash_value(cl_int id)
+{
+	const unsigned char *pos = (const unsigned char *)&id;
+	cl_uint		hash;
+	int			i;
+
+	/* same as pg_int4_comp_crc32() on the device side */
+	INIT_LEGACY_CRC32(hash);
+	for (i=0; i < sizeof(cl_int); i++)
+		hash = pg_crc32_table[((hash >> 24) ^ pos[i]) & 0xff] ^ (hash << 8);
+	FIN_LEGACY_CRC32(hash);
+
+	return hash;
+}
+
+/*
+ * NOTE: Float8GetDatum() is not available for frontend programs, so we
+ * put float8 values on Datum by ourselves. It assumes 64bit Datum, as
+ * the device code doing.
+ */
+static inline Datum
+double_as_datum(cl_double value)
+{
+	union {
+		cl_double	fval;
+		Datum		datum;
+	} u;
+
+	u.fval = value;
+	return u.datum;
+}
+
+static inline cl_double
+datum_as_double(Datum datum)
+{
+	union {
+		cl_double	fval;
+		Datum		datum;
+	} u;
+
+	u.datum = datum;
+	return u.fval;
+}
+
+static void
+fetch_outer_values(size_t row_index, Datum *values)
+{
+	int		j;
+
+	values[0] = Int32GetDatum(synth_id[row_index]);
+	values[1] = double_as_datum(synth_x[row_index]);
+	for (j=0; j < bench_npayloads; j++)
+		values[j+2] = double_as_datum((double)(row_index % 1000) + j);
+}
+
+/*
+ * init_kds_head - set up the header portion of kern_data_store, as
+ * init_kernel_data_store() doing. All the columns are fixed-length and
+ * not null.
+ */
+static void
+init_kds_head(kern_data_store *kds, size_t length, cl_char format,
+			  cl_uint nrooms, int nattrs, const Oid *atttypids)
+{
+	int		i, attcacheoff;
+
+	memset(kds, 0, offsetof(kern_data_store, colmeta));
+	kds->length = length;
+	kds->nrooms = nrooms;
+	kds->ncols = nattrs;
+	kds->format = format;
+	kds->tdtypeid = RECORDOID;
+	kds->tdtypmod = -1;
+	kds->table_oid = InvalidOid;
+
+	if (format == KDS_FORMAT_ROW ||
+		format == KDS_FORMAT_HASH ||
+		format == KDS_FORMAT_BLOCK)
+		attcacheoff = MAXALIGN(offsetof(HeapTupleHeaderData, t_bits));
+	else
+		attcacheoff = -1;
+
+	for (i=0; i < nattrs; i++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[i];
+		int				attlen = (atttypids[i] == INT4OID
+								  ? sizeof(cl_int)
+								  : sizeof(cl_long));
+
+		cmeta->attbyval = true;
+		cmeta->attalign = attlen;
+		cmeta->attlen = attlen;
+		cmeta->attnum = i+1;
+		if (attcacheoff > 0)
+		{
+			attcacheoff = TYPEALIGN(attlen, attcacheoff);
+			cmeta->attcacheoff = attcacheoff;
+			attcacheoff += attlen;
+		}
+		else
+			cmeta->attcacheoff = -1;
+		cmeta->atttypid = atttypids[i];
+		cmeta->atttypmod = -1;
+		cmeta->va_offset = 0;
+		cmeta->extra_sz = 0;
+	}
+}
+
+static size_t
+synthetic_tuple_length(kern_data_store *kds)
+{
+	kern_colmeta   *cmeta = &kds->colmeta[kds->ncols - 1];
+
+	return cmeta->attcacheoff + cmeta->attlen;
+}
+
+/*
+ * form_synthetic_tuple - write a heap-tuple that is already frozen and
+ * visible to everybody
+ */
+static void
+form_synthetic_tuple(HeapTupleHeader htup, kern_data_store *kds,
+					 const Datum *values, ItemPointer t_self)
+{
+	int		i;
+
+	memset(htup, 0, offsetof(HeapTupleHeaderData, t_bits));
+	htup->t_choice.t_heap.t_xmin = FrozenTransactionId;
+	htup->t_choice.t_heap.t_xmax = InvalidTransactionId;
+	htup->t_ctid = *t_self;
+	HeapTupleHeaderSetNatts(htup, kds->ncols);
+	htup->t_infomask = HEAP_XMIN_FROZEN | HEAP_XMAX_INVALID;
+	htup->t_hoff = MAXALIGN(offsetof(HeapTupleHeaderData, t_bits));
+
+	for (i=0; i < kds->ncols; i++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[i];
+		char		   *addr = (char *)htup + cmeta->attcacheoff;
+
+		if (cmeta->attlen == sizeof(cl_int))
+			*((cl_int *)addr) = DatumGetInt32(values[i]);
+		else
+			*((Datum *)addr) = values[i];
+	}
+}
+
+/*
+ * build_outer_kds - construct the outer relation in the given format
+ */
+static kern_data_store *
+build_outer_kds(cl_char format)
+{
+	kern_data_store *kds;
+	int			nattrs = 2 + bench_npayloads;
+	Oid		   *atttypids = alloca(sizeof(Oid) * nattrs);
+	Datum	   *values = alloca(sizeof(Datum) * nattrs);
+	size_t		head_sz = KDS_CALCULATE_HEAD_LENGTH(nattrs);
+	size_t		tuple_len;
+	size_t		length;
+	size_t		i;
+	int			j;
+
+	atttypids[0] = INT4OID;
+	for (j=1; j < nattrs; j++)
+		atttypids[j] = FLOAT8OID;
+	/* length of the synthetic heap-tuple */
+	kds = bench_alloc(head_sz);
+	init_kds_head(kds, 0, KDS_FORMAT_ROW, 0, nattrs, atttypids);
+	tuple_len = synthetic_tuple_length(kds);
+	free(kds);
+
+	if (format == KDS_FORMAT_ROW)
+	{
+		cl_uint	   *row_index;
+		size_t		item_sz;
+		size_t		usage = 0;
+
+		item_sz = MAXALIGN(offsetof(kern_tupitem, htup) + tuple_len);
+		length = KDS_CALCULATE_ROW_LENGTH(nattrs, bench_nrows,
+										  item_sz * bench_nrows);
+		kds = bench_alloc(length);
+		init_kds_head(kds, length, format, bench_nrows, nattrs, atttypids);
+
+		row_index = KERN_DATA_STORE_ROWINDEX(kds);
+		for (i=0; i < bench_nrows; i++)
+		{
+			kern_tupitem   *tupitem;
+
+			/* tuples are put from the tail, as PDS_insert_tuple doing */
+			usage += item_sz;
+			tupitem = (kern_tupitem *)((char *)kds + length - usage);
+			tupitem->t_len = tuple_len;
+			ItemPointerSet(&tupitem->t_self, i / MaxHeapTuplesPerPage,
+						   i % MaxHeapTuplesPerPage + 1);
+			fetch_outer_values(i, values);
+			form_synthetic_tuple(&tupitem->htup, kds, values,
+								 &tupitem->t_self);
+			row_index[i] = (char *)tupitem - (char *)kds;
+		}
+		kds->nitems = bench_nrows;
+		kds->usage = usage;
+	}
+	else if (format == KDS_FORMAT_BLOCK)
+	{
+		size_t		ntups_per_page;
+		size_t		nblocks;
+		size_t		row_index = 0;
+
+		ntups_per_page = ((BLCKSZ - SizeOfPageHeaderData) /
+						  (sizeof(ItemIdData) + MAXALIGN(tuple_len)));
+		if (ntups_per_page > MaxHeapTuplesPerPage)
+			ntups_per_page = MaxHeapTuplesPerPage;
+		nblocks = (bench_nrows + ntups_per_page - 1) / ntups_per_page;
+		length = (head_sz +
+				  STROMALIGN(sizeof(BlockNumber) * nblocks) +
+				  BLCKSZ * nblocks);
+		kds = bench_alloc(length);
+		init_kds_head(kds, length, format, nblocks, nattrs, atttypids);
+		kds->nrows_per_block = ntups_per_page;
+
+		for (i=0; i < nblocks; i++)
+		{
+			PageHeader	page = (PageHeader)
+				KERN_DATA_STORE_BLOCK_PGPAGE(kds, i);
+			size_t		ntups = Min(ntups_per_page, bench_nrows - row_index);
+			size_t		upper = BLCKSZ;
+			OffsetNumber lineno;
+
+			KERN_DATA_STORE_BLOCK_BLCKNR(kds, i) = i;
+			for (lineno=FirstOffsetNumber; lineno <= ntups; lineno++)
+			{
+				ItemIdData	   *lpp = &page->pd_linp[lineno - 1];
+				ItemPointerData	t_self;
+
+				upper -= MAXALIGN(tuple_len);
+				ItemIdSetNormal(lpp, upper, tuple_len);
+				ItemPointerSet(&t_self, i, lineno);
+				fetch_outer_values(row_index++, values);
+				form_synthetic_tuple((HeapTupleHeader)((char *)page + upper),
+									 kds, values, &t_self);
+			}
+			page->pd_lower = SizeOfPageHeaderData + ntups * sizeof(ItemIdData);
+			page->pd_upper = upper;
+			page->pd_special = BLCKSZ;
+			/* GPU kernel skips MVCC checks on the all-visible pages */
+			page->pd_flags = PD_ALL_VISIBLE;
+			page->pd_pagesize_version = BLCKSZ | PG_PAGE_LAYOUT_VERSION;
+		}
+		kds->nitems = nblocks;
+	}
+	else if (format == KDS_FORMAT_COLUMN)
+	{
+		static struct {
+			cl_short	attnum;
+			Oid			atttypid;
+		} sysattrs[] = {
+			{ TableOidAttributeNumber,        OIDOID },
+			{ MaxCommandIdAttributeNumber,    CIDOID },
+			{ MaxTransactionIdAttributeNumber, XIDOID },
+			{ MinCommandIdAttributeNumber,    CIDOID },
+			{ MinTransactionIdAttributeNumber, XIDOID },
+			{ ObjectIdAttributeNumber,        OIDOID },
+			{ SelfItemPointerAttributeNumber, TIDOID },
+		};
+		int			ncols = nattrs + NumOfSystemAttrs;
+		size_t		offset;
+
+		head_sz = KDS_CALCULATE_HEAD_LENGTH(ncols);
+		length = head_sz;
+		for (j=0; j < nattrs; j++)
+			length += MAXALIGN((atttypids[j] == INT4OID
+								? sizeof(cl_int)
+								: sizeof(cl_long)) * bench_nrows);
+		kds = bench_alloc(length);
+		init_kds_head(kds, length, format, bench_nrows, nattrs, atttypids);
+		kds->ncols = ncols;
+
+		/* system columns are not loaded; va_offset == 0 means NULL */
+		for (j=0; j < NumOfSystemAttrs; j++)
+		{
+			kern_colmeta   *cmeta = &kds->colmeta[nattrs + j];
+
+			memset(cmeta, 0, sizeof(kern_colmeta));
+			if (sysattrs[j].atttypid == TIDOID)
+			{
+				cmeta->attbyval = false;
+				cmeta->attalign = sizeof(cl_short);
+				cmeta->attlen = sizeof(ItemPointerData);
+			}
+			else
+			{
+				cmeta->attbyval = true;
+				cmeta->attalign = sizeof(cl_uint);
+				cmeta->attlen = sizeof(cl_uint);
+			}
+			cmeta->attnum = sysattrs[j].attnum;
+			cmeta->attcacheoff = -1;
+			cmeta->atttypid = sysattrs[j].atttypid;
+			cmeta->atttypmod = -1;
+		}
+
+		offset = head_sz;
+		for (j=0; j < nattrs; j++)
+		{
+			kern_colmeta   *cmeta = &kds->colmeta[j];
+			char		   *values_array = (char *)kds + offset;
+
+			cmeta->va_offset = offset >> MAXIMUM_ALIGNOF_SHIFT;
+			for (i=0; i < bench_nrows; i++)
+			{
+				fetch_outer_values(i, values);
+				if (cmeta->attlen == sizeof(cl_int))
+					((cl_int *)values_array)[i] = DatumGetInt32(values[j]);
+				else
+					((Datum *)values_array)[i] = values[j];
+			}
+			offset += MAXALIGN(cmeta->attlen * bench_nrows);
+		}
+		kds->nitems = bench_nrows;
+	}
+	else
+	{
+		fprintf(stderr, "unexpected KDS format: %d\n", format);
+		exit(1);
+	}
+	return kds;
+}
+
+/*
+ * build_inner_kds - construct the inner hash table (id int4, y float8)
+ */
+static kern_data_store *
+build_inner_kds(void)
+{
+	kern_data_store *kds;
+	Oid			atttypids[2] = { INT4OID, FLOAT8OID };
+	Datum		values[2];
+	size_t		head_sz = KDS_CALCULATE_HEAD_LENGTH(2);
+	size_t		tuple_len;
+	size_t		item_sz;
+	size_t		length;
+	size_t		usage = 0;
+	cl_uint	   *row_index;
+	cl_uint	   *hash_slot;
+	size_t		i;
+
+	kds = bench_alloc(head_sz);
+	init_kds_head(kds, 0, KDS_FORMAT_HASH, bench_inner_nrows, 2, atttypids);
+	tuple_len = synthetic_tuple_length(kds);
+	item_sz = MAXALIGN(offsetof(kern_hashitem, t.htup) + tuple_len);
+	length = KDS_CALCULATE_HASH_LENGTH(2, bench_inner_nrows,
+									   item_sz * bench_inner_nrows);
+	free(kds);
+	kds = bench_alloc(length);
+	init_kds_head(kds, length, KDS_FORMAT_HASH,
+				  bench_inner_nrows, 2, atttypids);
+	kds->nitems = bench_inner_nrows;
+	kds->nslots = __KDS_NSLOTS(bench_inner_nrows);
+	kds->hash_min = 0;
+	kds->hash_max = UINT_MAX;
+
+	row_index = KERN_DATA_STORE_ROWINDEX(kds);
+	hash_slot = KERN_DATA_STORE_HASHSLOT(kds);
+	for (i=0; i < bench_inner_nrows; i++)
+	{
+		kern_hashitem  *khitem;
+		cl_uint			hash = synthetic_hash_value(i);
+		cl_uint			hindex = hash % kds->nslots;
+
+		usage += item_sz;
+		khitem = (kern_hashitem *)((char *)kds + length - usage);
+		khitem->hash = hash;
+		khitem->next = hash_slot[hindex];
+		khitem->rowid = i;
+		khitem->t.t_len = tuple_len;
+		ItemPointerSet(&khitem->t.t_self, i / MaxHeapTuplesPerPage,
+					   i % MaxHeapTuplesPerPage + 1);
+		values[0] = Int32GetDatum(i);
+		values[1] = double_as_datum((double)i);
+		form_synthetic_tuple(&khitem->t.htup, kds, values,
+							 &khitem->t.t_self);
+		hash_slot[hindex] = (char *)khitem - (char *)kds;
+		row_index[i] = (char *)&khitem->t - (char *)kds;
+	}
+	kds->usage = usage;
+
+	return kds;
+}
+
+/*
+ * build_result_kds - construct an empty destination buffer
+ */
+static kern_data_store *
+build_result_kds(cl_char format, cl_uint nrooms, int nattrs,
+				 const Oid *atttypids)
+{
+	kern_data_store *kds;
+	kern_data_store	*kds_temp;
+	size_t		head_sz = KDS_CALCULATE_HEAD_LENGTH(nattrs);
+	size_t		length;
+
+	if (format == KDS_FORMAT_ROW)
+	{
+		kds_temp = bench_alloc(head_sz);
+		init_kds_head(kds_temp, 0, format, nrooms, nattrs, atttypids);
+		length = KDS_CALCULATE_ROW_LENGTH(nattrs, nrooms,
+			MAXALIGN(offsetof(kern_tupitem, htup) +
+					 synthetic_tuple_length(kds_temp)) * nrooms);
+		free(kds_temp);
+	}
+	else
+		length = KDS_CALCULATE_SLOT_LENGTH(nattrs, nrooms);
+
+	kds = bench_alloc(length);
+	init_kds_head(kds, length, format, nrooms, nattrs, atttypids);
+	if (format == KDS_FORMAT_SLOT)
+		memset(KERN_DATA_STORE_ISNULL(kds, 0), -1, nattrs);
+	return kds;
+}
+
+/*
+ * build_kern_parambuf - kparams of the benchmark query; KPARAM_0 is
+ * the attr_is_preagg flags for GpuPreAgg, then the threshold of x
+ * follows.
+ */
+static kern_parambuf *
+build_kern_parambuf(void)
+{
+	kern_parambuf  *kparams;
+	int			nparams = (bench_mode == BENCH_MODE_GPUPREAGG ? 2 : 1);
+	size_t		offset = STROMALIGN(offsetof(kern_parambuf, poffset[nparams]));
+	size_t		length = offset + 2 * STROMALIGN(sizeof(Datum) + VARHDRSZ);
+	int			index = 0;
+
+	kparams = bench_alloc(length);
+	kparams->xactSnapshotXmin = InvalidTransactionId;
+	kparams->nparams = nparams;
+	if (bench_mode == BENCH_MODE_GPUPREAGG)
+	{
+		struct varlena *kparam_0 = (struct varlena *)((char *)kparams + offset);
+
+		SET_VARSIZE(kparam_0, VARHDRSZ + 2 * sizeof(cl_char));
+		memset(VARDATA(kparam_0), 1, 2 * sizeof(cl_char));
+		kparams->poffset[index++] = offset;
+		offset += STROMALIGN(VARSIZE(kparam_0));
+	}
+	*((cl_double *)((char *)kparams + offset)) = bench_selectivity;
+	kparams->poffset[index++] = offset;
+	offset += STROMALIGN(sizeof(cl_double));
+	kparams->length = offset;
+
+	return kparams;
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Kernel launch and measurement
+ *
+ * ----------------------------------------------------------------
+ */
+static size_t		__dynamic_shmem_per_thread;
+
+static size_t
+blocksize_to_shmemsize_helper(int blocksize)
+{
+	return __dynamic_shmem_per_thread * (size_t)blocksize;
+}
+
+static CUfunction
+lookup_kernel_function(CUmodule cuda_module, const char *kfunc_name)
+{
+	CUfunction	kfunc;
+	CUresult	rc;
+
+	rc = cuModuleGetFunction(&kfunc, cuda_module, kfunc_name);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuModuleGetFunction");
+	return kfunc;
+}
+
+/*
+ * setup_block_sizes - block sizes to be measured; the one chosen by
+ * gpuOptimalBlockSize() and warpSize * 2^N up to the limit of kernel.
+ */
+static int
+setup_block_sizes(CUfunction kfunc, size_t shmem_per_thread,
+				  int *block_sizes, int *p_optimal_block_sz)
+{
+	int			min_grid_sz;
+	int			optimal_block_sz;
+	int			max_block_sz;
+	int			i, j, nitems = 0;
+	CUresult	rc;
+
+	__dynamic_shmem_per_thread = shmem_per_thread;
+	rc = cuOccupancyMaxPotentialBlockSize(&min_grid_sz,
+										  &optimal_block_sz,
+										  kfunc,
+										  blocksize_to_shmemsize_helper,
+										  0,
+										  0);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuOccupancyMaxPotentialBlockSize");
+	*p_optimal_block_sz = optimal_block_sz;
+
+	rc = cuFuncGetAttribute(&max_block_sz,
+							CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK,
+							kfunc);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuFuncGetAttribute");
+
+	if (bench_num_block_sizes > 0)
+	{
+		for (i=0; i < bench_num_block_sizes; i++)
+		{
+			if (bench_block_sizes[i] > max_block_sz)
+				fprintf(stderr, "block size %d is larger than the limit"
+						" of the kernel (%d), skipped\n",
+						bench_block_sizes[i], max_block_sz);
+			else
+				block_sizes[nitems++] = bench_block_sizes[i];
+		}
+		return nitems;
+	}
+
+	block_sizes[nitems++] = optimal_block_sz;
+	for (i = dev_warp_size; i <= max_block_sz; i *= 2)
+	{
+		/* keep the list sorted and unique */
+		for (j=0; j < nitems && block_sizes[j] < i; j++);
+		if (j < nitems && block_sizes[j] == i)
+			continue;
+		memmove(block_sizes + j + 1, block_sizes + j,
+				sizeof(int) * (nitems - j));
+		block_sizes[j] = i;
+		nitems++;
+	}
+	return nitems;
+}
+
+/*
+ * compute_grid_size - number of blocks to fill up the device with the
+ * given block size, and its theoretical SM occupancy, as
+ * gpuOptimalBlockSize() doing.
+ */
+static int
+compute_grid_size(CUfunction kfunc, int block_sz, size_t shmem_per_thread,
+				  double *p_occupancy)
+{
+	int			opt_grid_sz;
+	CUresult	rc;
+
+	rc = cuOccupancyMaxActiveBlocksPerMultiprocessor(&opt_grid_sz,
+													 kfunc,
+													 block_sz,
+													 shmem_per_thread *
+													 block_sz);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuOccupancyMaxActiveBlocksPerMultiprocessor");
+	*p_occupancy = ((double)(opt_grid_sz * block_sz) /
+					(double)dev_max_threads_per_mpu);
+	return opt_grid_sz * dev_mpu_nums;
+}
+
+/*
+ * upload_device_memory - allocate device memory of @length bytes, then
+ * copies the first @copy_len bytes of @host_ptr
+ */
+static CUdeviceptr
+upload_device_memory(const void *host_ptr, size_t copy_len, size_t length)
+{
+	CUdeviceptr	m_devptr;
+	CUresult	rc;
+
+	rc = cuMemAlloc(&m_devptr, length);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuMemAlloc");
+	if (host_ptr && copy_len > 0)
+	{
+		rc = cuMemcpyHtoD(m_devptr, host_ptr, copy_len);
+		if (rc != CUDA_SUCCESS)
+			cuda_error(rc, "cuMemcpyHtoD");
+	}
+	return m_devptr;
+}
+
+static void
+write_device_memory(CUdeviceptr m_devptr, const void *host_ptr, size_t length)
+{
+	CUresult	rc = cuMemcpyHtoD(m_devptr, host_ptr, length);
+
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuMemcpyHtoD");
+}
+
+static void
+read_device_memory(void *host_ptr, CUdeviceptr m_devptr, size_t length)
+{
+	CUresult	rc = cuMemcpyDtoH(host_ptr, m_devptr, length);
+
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuMemcpyDtoH");
+}
+
+/*
+ * launch_kernel_timed - launch a kernel and returns its elapsed time in ms
+ */
+static double
+launch_kernel_timed(CUfunction kfunc, int grid_sz, int block_sz,
+					size_t shmem_per_thread, void **kern_args)
+{
+	CUevent		ev_start;
+	CUevent		ev_stop;
+	float		elapsed;
+	CUresult	rc;
+
+	rc = cuEventCreate(&ev_start, CU_EVENT_DEFAULT);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuEventCreate");
+	rc = cuEventCreate(&ev_stop, CU_EVENT_DEFAULT);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuEventCreate");
+
+	rc = cuEventRecord(ev_start, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuEventRecord");
+	rc = cuLaunchKernel(kfunc,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						shmem_per_thread * block_sz,
+						NULL,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuLaunchKernel");
+	rc = cuEventRecord(ev_stop, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuEventRecord");
+	rc = cuEventSynchronize(ev_stop);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuEventSynchronize");
+	rc = cuEventElapsedTime(&elapsed, ev_start, ev_stop);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuEventElapsedTime");
+
+	cuEventDestroy(ev_start);
+	cuEventDestroy(ev_stop);
+
+	return (double)elapsed;
+}
+
+static const char *
+format_name(cl_char format)
+{
+	switch (format)
+	{
+		case KDS_FORMAT_ROW:
+			return "row";
+		case KDS_FORMAT_BLOCK:
+			return "block";
+		case KDS_FORMAT_COLUMN:
+			return "column";
+		default:
+			break;
+	}
+	return "???";
+}
+
+static void
+print_kernel_attrs(CUfunction kfunc, const char *kfunc_name)
+{
+	int			num_regs;
+	int			shared_sz;
+	int			local_sz;
+	CUresult	rc;
+
+	rc = cuFuncGetAttribute(&num_regs, CU_FUNC_ATTRIBUTE_NUM_REGS, kfunc);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuFuncGetAttribute");
+	rc = cuFuncGetAttribute(&shared_sz,
+							CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kfunc);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuFuncGetAttribute");
+	rc = cuFuncGetAttribute(&local_sz,
+							CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, kfunc);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuFuncGetAttribute");
+
+	printf("kernel: %s (regs=%d, static shmem=%d, local=%d)\n",
+		   kfunc_name, num_regs, shared_sz, local_sz);
+}
+
+static void
+print_result_line(cl_char format, int block_sz, int optimal_block_sz,
+				  int grid_sz, double occupancy, double elapsed,
+				  size_t kds_length, size_t nitems, size_t expected,
+				  kern_errorbuf *kerror)
+{
+	printf("%-7s %5d%c %7d %7.1f%% %10.3f %14.0f %9.2f %10zu",
+		   format_name(format),
+		   block_sz, (block_sz == optimal_block_sz ? '*' : ' '),
+		   grid_sz,
+		   100.0 * occupancy,
+		   elapsed,
+		   (double)bench_nrows / (elapsed / 1000.0),
+		   (double)kds_length / (elapsed / 1000.0) / (double)(1UL << 30),
+		   nitems);
+	if (kerror->errcode != StromError_Success)
+		printf("  (error %d at %.*s:%d)",
+			   kerror->errcode,
+			   KERN_ERRORBUF_FILENAME_LEN, kerror->filename,
+			   kerror->lineno);
+	else if (nitems != expected)
+		printf("  (mismatch: expected %zu)", expected);
+	putchar('\n');
+}
+
+static void
+print_result_header(void)
+{
+	printf("%-7s %6s %7s %8s %10s %14s %9s %10s\n",
+		   "format", "block", "grid", "occupy", "time[ms]",
+		   "rows/sec", "GB/s", "nitems");
+}
+
+/*
+ * bench_gpuscan - gpuscan_exec_quals_(row|block|column)
+ */
+static void
+bench_gpuscan(CUmodule cuda_module, cl_char format)
+{
+	static Oid	dst_atttypids[2] = { INT4OID, FLOAT8OID };
+	const char *kfunc_name;
+	CUfunction	kfunc;
+	kern_parambuf *kparams = build_kern_parambuf();
+	kern_gpuscan *kgpuscan;
+	kern_resultbuf *kresults;
+	kern_data_store *kds_src;
+	kern_data_store *kds_dst;
+	kern_data_store	kds_head;
+	size_t		kgpuscan_length;
+	size_t		dst_head_sz;
+	CUdeviceptr	m_kgpuscan;
+	CUdeviceptr	m_kds_src;
+	CUdeviceptr	m_kds_dst;
+	void	   *kern_args[3];
+	int			block_sizes[BENCH_MAX_BLOCK_SIZES];
+	int			optimal_block_sz;
+	int			i, j, nitems;
+	size_t		expected = 0;
+
+	if (format == KDS_FORMAT_ROW)
+		kfunc_name = "gpuscan_exec_quals_row";
+	else if (format == KDS_FORMAT_BLOCK)
+		kfunc_name = "gpuscan_exec_quals_block";
+	else
+		kfunc_name = "gpuscan_exec_quals_column";
+	kfunc = lookup_kernel_function(cuda_module, kfunc_name);
+	print_kernel_attrs(kfunc, kfunc_name);
+
+	for (i=0; i < bench_nrows; i++)
+	{
+		if (synth_x[i] < bench_selectivity)
+			expected++;
+	}
+
+	/* kern_gpuscan with an empty kern_resultbuf */
+	kgpuscan_length = (offsetof(kern_gpuscan, kparams) +
+					   STROMALIGN(kparams->length) +
+					   STROMALIGN(offsetof(kern_resultbuf, results[0])));
+	kgpuscan = bench_alloc(kgpuscan_length);
+	memcpy(&kgpuscan->kparams, kparams, kparams->length);
+	kresults = KERN_GPUSCAN_RESULTBUF(kgpuscan);
+	kresults->nrels = 1;
+	kresults->nrooms = 0;
+
+	kds_src = build_outer_kds(format);
+	kds_dst = build_result_kds(KDS_FORMAT_ROW, bench_nrows,
+							   2, dst_atttypids);
+	dst_head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_dst);
+
+	m_kgpuscan = upload_device_memory(kgpuscan, kgpuscan_length,
+									  kgpuscan_length);
+	m_kds_src = upload_device_memory(kds_src, kds_src->length,
+									 kds_src->length);
+	m_kds_dst = upload_device_memory(kds_dst, dst_head_sz,
+									 kds_dst->length);
+
+	/*
+	 * KERNEL_FUNCTION(void)
+	 * gpuscan_exec_quals_XXX(kern_gpuscan *kgpuscan,
+	 *                        kern_data_store *kds_src,
+	 *                        kern_data_store *kds_dst)
+	 */
+	kern_args[0] = &m_kgpuscan;
+	kern_args[1] = &m_kds_src;
+	kern_args[2] = &m_kds_dst;
+
+	print_result_header();
+	nitems = setup_block_sizes(kfunc, sizeof(cl_int),
+							   block_sizes, &optimal_block_sz);
+	for (i=0; i < nitems; i++)
+	{
+		int			block_sz = block_sizes[i];
+		int			grid_sz;
+		double		occupancy;
+		double		elapsed = 0.0;
+
+		grid_sz = compute_grid_size(kfunc, block_sz, sizeof(cl_int),
+									&occupancy);
+		if (grid_sz == 0)
+			continue;
+		for (j=0; j < bench_nloops; j++)
+		{
+			double	temp;
+
+			write_device_memory(m_kgpuscan, kgpuscan, kgpuscan_length);
+			write_device_memory(m_kds_dst, kds_dst, dst_head_sz);
+			temp = launch_kernel_timed(kfunc, grid_sz, block_sz,
+									   sizeof(cl_int), kern_args);
+			if (j == 0 || temp < elapsed)
+				elapsed = temp;
+		}
+		read_device_memory(kgpuscan, m_kgpuscan,
+						   offsetof(kern_gpuscan, kparams));
+		read_device_memory(&kds_head, m_kds_dst,
+						   offsetof(kern_data_store, colmeta));
+		print_result_line(format, block_sz, optimal_block_sz,
+						  grid_sz, occupancy, elapsed,
+						  kds_src->length, kds_head.nitems, expected,
+						  &kgpuscan->kerror);
+	}
+	cuMemFree(m_kgpuscan);
+	cuMemFree(m_kds_src);
+	cuMemFree(m_kds_dst);
+	free(kgpuscan);
+	free(kds_src);
+	free(kds_dst);
+	free(kparams);
+}
+
+/*
+ * bench_gpupreagg - gpupreagg_setup_(row|block|column) followed by
+ * gpupreagg_nogroup_reduction. Only the setup kernel is measured for
+ * each block size, and the reduction is launched with its own optimal
+ * configuration.
+ */
+static void
+bench_gpupreagg(CUmodule cuda_module, cl_char format)
+{
+	static Oid	slot_atttypids[2] = { INT8OID, FLOAT8OID };
+	const char *kfunc_name;
+	CUfunction	kfunc;
+	CUfunction	kfunc_reduction;
+	kern_parambuf *kparams = build_kern_parambuf();
+	kern_gpupreagg *kgpreagg;
+	kern_data_store *kds_src;
+	kern_data_store *kds_slot;
+	kern_data_store *kds_final;
+	size_t		kgpreagg_length;
+	size_t		slot_head_sz;
+	CUdeviceptr	m_kgpreagg;
+	CUdeviceptr	m_kds_src;
+	CUdeviceptr	m_kds_slot;
+	CUdeviceptr	m_kds_final;
+	CUdeviceptr	m_null = 0UL;
+	void	   *kern_setup_args[4];
+	void	   *kern_reduction_args[5];
+	int			block_sizes[BENCH_MAX_BLOCK_SIZES];
+	int			optimal_block_sz;
+	int			reduction_block_sz;
+	int			reduction_grid_sz;
+	double		reduction_occupancy;
+	int			i, j, nitems;
+	size_t		expected = 0;
+	double		expected_sum = 0.0;
+
+	if (format == KDS_FORMAT_ROW)
+		kfunc_name = "gpupreagg_setup_row";
+	else if (format == KDS_FORMAT_BLOCK)
+		kfunc_name = "gpupreagg_setup_block";
+	else
+		kfunc_name = "gpupreagg_setup_column";
+	kfunc = lookup_kernel_function(cuda_module, kfunc_name);
+	kfunc_reduction = lookup_kernel_function(cuda_module,
+											 "gpupreagg_nogroup_reduction");
+	print_kernel_attrs(kfunc, kfunc_name);
+
+	for (i=0; i < bench_nrows; i++)
+	{
+		if (synth_x[i] < bench_selectivity)
+		{
+			expected++;
+			expected_sum += synth_x[i];
+		}
+	}
+
+	/* kern_gpupreagg */
+	kgpreagg_length = offsetof(kern_gpupreagg, kparams) + kparams->length;
+	kgpreagg = bench_alloc(kgpreagg_length);
+	kgpreagg->num_group_keys = 0;
+	kgpreagg->key_dist_salt = 1;
+	kgpreagg->hash_size = bench_nrows;
+	memcpy(kgpreagg->pg_crc32_table, pg_crc32_table, sizeof(pg_crc32_table));
+	memcpy(&kgpreagg->kparams, kparams, kparams->length);
+
+	kds_src = build_outer_kds(format);
+	kds_slot = build_result_kds(KDS_FORMAT_SLOT, bench_nrows,
+								2, slot_atttypids);
+	kds_final = build_result_kds(KDS_FORMAT_SLOT, 1,
+								 2, slot_atttypids);
+	slot_head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_slot);
+
+	m_kgpreagg = upload_device_memory(kgpreagg, kgpreagg_length,
+									  kgpreagg_length);
+	m_kds_src = upload_device_memory(kds_src, kds_src->length,
+									 kds_src->length);
+	m_kds_slot = upload_device_memory(kds_slot, slot_head_sz,
+									  kds_slot->length);
+	m_kds_final = upload_device_memory(kds_final, kds_final->length,
+									   kds_final->length);
+
+	/*
+	 * KERNEL_FUNCTION(void)
+	 * gpupreagg_setup_XXX(kern_gpupreagg *kgpreagg,
+	 *                     kern_data_store *kds_src,
+	 *                     kern_data_store *kds_slot,
+	 *                     kern_gpupreagg_dict *kdict)
+	 */
+	kern_setup_args[0] = &m_kgpreagg;
+	kern_setup_args[1] = &m_kds_src;
+	kern_setup_args[2] = &m_kds_slot;
+	kern_setup_args[3] = &m_null;
+
+	/*
+	 * KERNEL_FUNCTION_MAXTHREADS(void)
+	 * gpupreagg_nogroup_reduction(kern_gpupreagg *kgpreagg,
+	 *                             kern_errorbuf *kgjoin_errorbuf,
+	 *                             kern_data_store *kds_slot,
+	 *                             kern_data_store *kds_final,
+	 *                             kern_global_hashslot *f_hash)
+	 */
+	kern_reduction_args[0] = &m_kgpreagg;
+	kern_reduction_args[1] = &m_null;
+	kern_reduction_args[2] = &m_kds_slot;
+	kern_reduction_args[3] = &m_kds_final;
+	kern_reduction_args[4] = &m_null;
+
+	setup_block_sizes(kfunc_reduction, sizeof(cl_int),
+					  block_sizes, &reduction_block_sz);
+	reduction_grid_sz = Min(compute_grid_size(kfunc_reduction,
+											  reduction_block_sz,
+											  sizeof(cl_int),
+											  &reduction_occupancy),
+							dev_mpu_nums);
+
+	print_result_header();
+	nitems = setup_block_sizes(kfunc, sizeof(cl_int),
+							   block_sizes, &optimal_block_sz);
+	for (i=0; i < nitems; i++)
+	{
+		int			block_sz = block_sizes[i];
+		int			grid_sz;
+		double		occupancy;
+		double		elapsed = 0.0;
+		Datum	   *values;
+		cl_bool	   *isnull;
+
+		grid_sz = compute_grid_size(kfunc, block_sz, sizeof(cl_int),
+									&occupancy);
+		if (grid_sz == 0)
+			continue;
+		for (j=0; j < bench_nloops; j++)
+		{
+			double	temp;
+
+			write_device_memory(m_kgpreagg, kgpreagg, kgpreagg_length);
+			write_device_memory(m_kds_slot, kds_slot, slot_head_sz);
+			write_device_memory(m_kds_final, kds_final, kds_final->length);
+			temp = launch_kernel_timed(kfunc, grid_sz, block_sz,
+									   sizeof(cl_int), kern_setup_args);
+			if (j == 0 || temp < elapsed)
+				elapsed = temp;
+			launch_kernel_timed(kfunc_reduction,
+								reduction_grid_sz,
+								reduction_block_sz,
+								sizeof(cl_int),
+								kern_reduction_args);
+		}
+		read_device_memory(kgpreagg, m_kgpreagg,
+						   offsetof(kern_gpupreagg, pg_crc32_table[0]));
+		read_device_memory(kds_final, m_kds_final, kds_final->length);
+		values = KERN_DATA_STORE_VALUES(kds_final, 0);
+		isnull = KERN_DATA_STORE_ISNULL(kds_final, 0);
+		print_result_line(format, block_sz, optimal_block_sz,
+						  grid_sz, occupancy, elapsed,
+						  kds_src->length,
+						  isnull[0] ? 0 : (size_t)values[0],
+						  expected,
+						  &kgpreagg->kerror);
+		if (kgpreagg->kerror.errcode == StromError_Success &&
+			!isnull[1] &&
+			fabs(datum_as_double(values[1]) - expected_sum) >
+			1.0e-6 * fabs(expected_sum))
+			printf("  (sum(x) mismatch: %f, expected %f)\n",
+				   datum_as_double(values[1]), expected_sum);
+		/* restore the initial state of kds_final */
+		memset(values, 0, sizeof(Datum) * 2);
+		memset(isnull, -1, sizeof(cl_bool) * 2);
+		kds_final->nitems = 0;
+	}
+	cuMemFree(m_kgpreagg);
+	cuMemFree(m_kds_src);
+	cuMemFree(m_kds_slot);
+	cuMemFree(m_kds_final);
+	free(kgpreagg);
+	free(kds_src);
+	free(kds_slot);
+	free(kds_final);
+	free(kparams);
+}
+
+/*
+ * bench_gpujoin - gpujoin_main with a single depth hash-join
+ */
+static void
+bench_gpujoin(CUmodule cuda_module, cl_char format)
+{
+	static Oid	dst_atttypids[3] = { INT4OID, FLOAT8OID, FLOAT8OID };
+	const char *kfunc_name = "gpujoin_main";
+	CUfunction	kfunc;
+	kern_parambuf *kparams = build_kern_parambuf();
+	kern_gpujoin *kgjoin;
+	kern_multirels *kmrels;
+	kern_data_store *kds_src;
+	kern_data_store *kds_in;
+	kern_data_store *kds_dst;
+	kern_data_store	kds_head;
+	cl_int		nrels = 1;
+	size_t		head_sz;
+	size_t		param_sz;
+	size_t		pstack_sz;
+	size_t		pstack_nrooms;
+	size_t		suspend_sz;
+	size_t		kgjoin_length;
+	size_t		kmrels_head_sz;
+	size_t		dst_head_sz;
+	CUdeviceptr	m_kgjoin = 0UL;
+	CUdeviceptr	m_kmrels;
+	CUdeviceptr	m_kds_src;
+	CUdeviceptr	m_kds_dst;
+	CUdeviceptr	m_null = 0UL;
+	void	   *kern_args[5];
+	int			block_sizes[BENCH_MAX_BLOCK_SIZES];
+	int			optimal_block_sz;
+	int			max_grid_sz = 0;
+	int			i, j, nitems;
+	size_t		expected = 0;
+
+	kfunc = lookup_kernel_function(cuda_module, kfunc_name);
+	print_kernel_attrs(kfunc, kfunc_name);
+
+	for (i=0; i < bench_nrows; i++)
+	{
+		if (synth_x[i] < bench_selectivity &&
+			synth_id[i] < bench_inner_nrows)
+			expected++;
+	}
+
+	/* kern_multirels with a hash table */
+	kds_in = build_inner_kds();
+	kmrels_head_sz = STROMALIGN(offsetof(kern_multirels, chunks[nrels]));
+	kmrels = bench_alloc(kmrels_head_sz + kds_in->length);
+	memcpy(kmrels->pg_crc32_table, pg_crc32_table, sizeof(pg_crc32_table));
+	kmrels->kmrels_length = kmrels_head_sz + kds_in->length;
+	kmrels->nrels = nrels;
+	kmrels->chunks[0].chunk_offset = kmrels_head_sz;
+	memcpy((char *)kmrels + kmrels_head_sz, kds_in, kds_in->length);
+
+	/*
+	 * kern_gpujoin, as GpuJoinSetupTask() doing; except for the pseudo
+	 * stack and suspend context which are allocated for each block of
+	 * the grid to be launched, because they are indexed by
+	 * get_global_index().
+	 */
+	head_sz = STROMALIGN(offsetof(kern_gpujoin, stat_nitems[nrels + 1]));
+	param_sz = STROMALIGN(kparams->length);
+	pstack_nrooms = 2048;
+	pstack_sz = MAXALIGN(sizeof(cl_uint) *
+						 pstack_nrooms * ((nrels+1) * (nrels+2)) / 2);
+	suspend_sz = (sizeof(cl_int) +					/* depth */
+				  sizeof(cl_int) +					/* scan_done */
+				  sizeof(cl_uint) +					/* src_read_pos */
+				  sizeof(cl_uint) * (nrels + 1) +	/* wip_count */
+				  sizeof(cl_uint) * (nrels + 1) +	/* read_pos */
+				  sizeof(cl_uint) * (nrels + 1) +	/* write_pos */
+				  sizeof(cl_uint) +					/* stat_source_nitems */
+				  sizeof(cl_uint) * (nrels + 1) +	/* stat_nitems */
+				  /* threads[] array */
+				  (MAXALIGN(sizeof(cl_uint) * (nrels + 1)) +
+				   MAXALIGN(sizeof(cl_bool) * (nrels + 1))) * 1024);
+	kgjoin = bench_alloc(head_sz + param_sz);
+	kgjoin->kparams_offset = head_sz;
+	kgjoin->pstack_offset = head_sz + param_sz;
+	kgjoin->pstack_nrooms = pstack_nrooms;
+	kgjoin->num_rels = nrels;
+	kgjoin->resume_context = false;
+	kgjoin->src_read_pos = 0;
+	memcpy(KERN_GPUJOIN_PARAMBUF(kgjoin), kparams, kparams->length);
+
+	kds_src = build_outer_kds(format);
+	kds_dst = build_result_kds(KDS_FORMAT_ROW, bench_nrows,
+							   3, dst_atttypids);
+	dst_head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_dst);
+
+	m_kmrels = upload_device_memory(kmrels, kmrels->kmrels_length,
+									kmrels->kmrels_length);
+	m_kds_src = upload_device_memory(kds_src, kds_src->length,
+									 kds_src->length);
+	m_kds_dst = upload_device_memory(kds_dst, dst_head_sz,
+									 kds_dst->length);
+
+	nitems = setup_block_sizes(kfunc, sizeof(cl_int),
+							   block_sizes, &optimal_block_sz);
+	for (i=0; i < nitems; i++)
+	{
+		double	occupancy;
+
+		max_grid_sz = Max(max_grid_sz,
+						  compute_grid_size(kfunc, block_sizes[i],
+											sizeof(cl_int), &occupancy));
+	}
+	kgjoin->suspend_offset = head_sz + param_sz + max_grid_sz * pstack_sz;
+	kgjoin_length = head_sz + param_sz + max_grid_sz * (pstack_sz +
+														suspend_sz);
+	m_kgjoin = upload_device_memory(NULL, 0, kgjoin_length);
+
+	/*
+	 * KERNEL_FUNCTION(void)
+	 * gpujoin_main(kern_gpujoin *kgjoin,
+	 *              kern_multirels *kmrels,
+	 *              kern_data_store *kds_src,
+	 *              kern_data_store *kds_dst,
+	 *              kern_parambuf *kparams_gpreagg)
+	 */
+	kern_args[0] = &m_kgjoin;
+	kern_args[1] = &m_kmrels;
+	kern_args[2] = &m_kds_src;
+	kern_args[3] = &m_kds_dst;
+	kern_args[4] = &m_null;
+
+	print_result_header();
+	for (i=0; i < nitems; i++)
+	{
+		int			block_sz = block_sizes[i];
+		int			grid_sz;
+		double		occupancy;
+		double		elapsed = 0.0;
+
+		grid_sz = compute_grid_size(kfunc, block_sz, sizeof(cl_int),
+									&occupancy);
+		if (grid_sz == 0)
+			continue;
+		for (j=0; j < bench_nloops; j++)
+		{
+			double	temp;
+
+			write_device_memory(m_kgjoin, kgjoin, head_sz + param_sz);
+			write_device_memory(m_kds_dst, kds_dst, dst_head_sz);
+			temp = launch_kernel_timed(kfunc, grid_sz, block_sz,
+									   sizeof(cl_int), kern_args);
+			if (j == 0 || temp < elapsed)
+				elapsed = temp;
+		}
+		read_device_memory(kgjoin, m_kgjoin, head_sz);
+		read_device_memory(&kds_head, m_kds_dst,
+						   offsetof(kern_data_store, colmeta));
+		print_result_line(format, block_sz, optimal_block_sz,
+						  grid_sz, occupancy, elapsed,
+						  kds_src->length, kds_head.nitems, expected,
+						  &kgjoin->kerror);
+	}
+	cuMemFree(m_kgjoin);
+	cuMemFree(m_kmrels);
+	cuMemFree(m_kds_src);
+	cuMemFree(m_kds_dst);
+	free(kgjoin);
+	free(kmrels);
+	free(kds_in);
+	free(kds_src);
+	free(kds_dst);
+	free(kparams);
+}
+
+int main(int argc, char *argv[])
+{
+	CUmodule	cuda_module;
+	CUcontext	cuda_context;
+	CUresult	rc;
+	char	   *source;
+	int			device_id = 0;
+	int			opt;
+	cl_char		format;
+
+	cmdname = basename(strdup(argv[0]));
+	while ((opt = getopt(argc, argv, "m:f:n:w:s:i:b:l:d:I:kh")) >= 0)
+	{
+		switch (opt)
+		{
+			case 'm':
+				if (strcmp(optarg, "gpuscan") == 0)
+					bench_mode = BENCH_MODE_GPUSCAN;
+				else if (strcmp(optarg, "gpujoin") == 0)
+					bench_mode = BENCH_MODE_GPUJOIN;
+				else if (strcmp(optarg, "gpupreagg") == 0)
+					bench_mode = BENCH_MODE_GPUPREAGG;
+				else
+					usage();
+				break;
+			case 'f':
+				if (strcmp(optarg, "row") == 0)
+					bench_formats |= (1 << KDS_FORMAT_ROW);
+				else if (strcmp(optarg, "block") == 0)
+					bench_formats |= (1 << KDS_FORMAT_BLOCK);
+				else if (strcmp(optarg, "column") == 0)
+					bench_formats |= (1 << KDS_FORMAT_COLUMN);
+				else
+					usage();
+				break;
+			case 'n':
+				bench_nrows = atol(optarg);
+				if (bench_nrows == 0 || bench_nrows > INT_MAX)
+					usage();
+				break;
+			case 'w':
+				bench_npayloads = atoi(optarg);
+				if (bench_npayloads < 0 || bench_npayloads > 64)
+					usage();
+				break;
+			case 's':
+				bench_selectivity = atof(optarg);
+				if (bench_selectivity < 0.0 || bench_selectivity > 1.0)
+					usage();
+				break;
+			case 'i':
+				bench_inner_nrows = atol(optarg);
+				if (bench_inner_nrows == 0 || bench_inner_nrows > INT_MAX / 2)
+					usage();
+				break;
+			case 'b':
+				if (bench_num_block_sizes >= BENCH_MAX_BLOCK_SIZES)
+					usage();
+				bench_block_sizes[bench_num_block_sizes] = atoi(optarg);
+				if (bench_block_sizes[bench_num_block_sizes] <= 0)
+					usage();
+				bench_num_block_sizes++;
+				break;
+			case 'l':
+				bench_nloops = atoi(optarg);
+				if (bench_nloops <= 0)
+					usage();
+				break;
+			case 'd':
+				device_id = atoi(optarg);
+				break;
+			case 'I':
+				bench_include_path = optarg;
+				break;
+			case 'k':
+				bench_dump_source = 1;
+				break;
+			case 'h':
+			default:
+				usage();
+				break;
+		}
+	}
+	if (optind != argc)
+		usage();
+	if (bench_formats == 0)
+		bench_formats = ((1 << KDS_FORMAT_ROW) |
+						 (1 << KDS_FORMAT_BLOCK) |
+						 (1 << KDS_FORMAT_COLUMN));
+
+	/* initialize the target device */
+	rc = cuInit(0);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuInit");
+	rc = cuDeviceGet(&cuda_device, device_id);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuDeviceGet");
+	rc = cuDeviceGetName(dev_name, sizeof(dev_name), cuda_device);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuDeviceGetName");
+	{
+		struct {
+			int		attr;
+			int	   *dptr;
+		} catalog[] = {
+			{ CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT,     &dev_mpu_nums },
+			{ CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR,
+			  &dev_max_threads_per_mpu },
+			{ CU_DEVICE_ATTRIBUTE_WARP_SIZE,                &dev_warp_size },
+			{ CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR, &dev_cap_major },
+			{ CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, &dev_cap_minor },
+		};
+		int		i;
+
+		for (i=0; i < lengthof(catalog); i++)
+		{
+			rc = cuDeviceGetAttribute(catalog[i].dptr,
+									  catalog[i].attr,
+									  cuda_device);
+			if (rc != CUDA_SUCCESS)
+				cuda_error(rc, "cuDeviceGetAttribute");
+		}
+	}
+	rc = cuCtxCreate(&cuda_context, 0, cuda_device);
+	if (rc != CUDA_SUCCESS)
+		cuda_error(rc, "cuCtxCreate");
+
+	/* build the kernel */
+	source = construct_bench_source();
+	if (bench_dump_source)
+		printf("----\n%s----\n", source);
+	cuda_module = build_kernel_source(source);
+
+	printf("GPU%d - %s (capability: %d.%d, %d SMs), "
+		   "nrows=%zu, payloads=%d, selectivity=%.2f",
+		   device_id, dev_name, dev_cap_major, dev_cap_minor, dev_mpu_nums,
+		   bench_nrows, bench_npayloads, bench_selectivity);
+	if (bench_mode == BENCH_MODE_GPUJOIN)
+		printf(", inner nrows=%zu", bench_inner_nrows);
+	putchar('\n');
+
+	/* run benchmark for each format */
+	init_synthetic_values();
+	for (format = KDS_FORMAT_ROW; format <= KDS_FORMAT_COLUMN; format++)
+	{
+		if ((bench_formats & (1 << format)) == 0)
+			continue;
+		switch (bench_mode)
+		{
+			case BENCH_MODE_GPUSCAN:
+				bench_gpuscan(cuda_module, format);
+				break;
+			case BENCH_MODE_GPUJOIN:
+				bench_gpujoin(cuda_module, format);
+				break;
+			case BENCH_MODE_GPUPREAGG:
+				bench_gpupreagg(cuda_module, format);
+				break;
+		}
+	}
+	cuModuleUnload(cuda_module);
+	cuCtxDestroy(cuda_context);
+
+	return 0;
+}